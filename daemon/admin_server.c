@@ -180,6 +180,75 @@ adminServerSetThreadPoolParameters(virNetServerPtr srv,
     return 0;
 }
 
+int
+adminServerGetProcStats(virNetServerPtr srv,
+                        virTypedParameterPtr *params,
+                        int *nparams,
+                        unsigned int flags)
+{
+    int ret = -1;
+    int maxparams = 0;
+    virTypedParameterPtr tmpparams = NULL;
+    virNetServerProgramPtr *progs = NULL;
+    int nprogs = 0;
+    size_t i;
+    size_t proc;
+
+    virCheckFlags(0, -1);
+
+    if ((nprogs = virNetServerGetPrograms(srv, &progs)) < 0)
+        goto cleanup;
+
+    for (i = 0; i < nprogs; i++) {
+        unsigned int program = virNetServerProgramGetID(progs[i]);
+        size_t nprocs = virNetServerProgramGetNProcs(progs[i]);
+
+        for (proc = 0; proc < nprocs; proc++) {
+            virNetServerProgramProcStats stats;
+            char field[VIR_TYPED_PARAM_FIELD_LENGTH];
+
+            if (virNetServerProgramGetProcStats(progs[i], proc, &stats) < 0)
+                goto cleanup;
+
+            /* Procedures which were never called would only bloat the
+             * reply with zeros */
+            if (stats.calls == 0)
+                continue;
+
+#define ADMIN_ADD_PROC_PARAM(name, value) \
+            do { \
+                snprintf(field, sizeof(field), "proc.%u.%zu." name, \
+                         program, proc); \
+                if (virTypedParamsAddULLong(&tmpparams, nparams, \
+                                            &maxparams, field, value) < 0) \
+                    goto cleanup; \
+            } while (0)
+
+            ADMIN_ADD_PROC_PARAM("calls", stats.calls);
+            ADMIN_ADD_PROC_PARAM("errors", stats.errors);
+            ADMIN_ADD_PROC_PARAM("time.total", stats.timeTotal);
+            ADMIN_ADD_PROC_PARAM("time.max", stats.timeMax);
+            ADMIN_ADD_PROC_PARAM("queue.total", stats.queueTotal);
+            ADMIN_ADD_PROC_PARAM("queue.max", stats.queueMax);
+            ADMIN_ADD_PROC_PARAM("bytes.in", stats.bytesIn);
+            ADMIN_ADD_PROC_PARAM("bytes.out", stats.bytesOut);
+
+#undef ADMIN_ADD_PROC_PARAM
+        }
+    }
+
+    *params = tmpparams;
+    tmpparams = NULL;
+    ret = 0;
+
+ cleanup:
+    virTypedParamsFree(tmpparams, *nparams);
+    for (i = 0; i < nprogs; i++)
+        virObjectUnref(progs[i]);
+    VIR_FREE(progs);
+    return ret;
+}
+
 int
 adminServerListClients(virNetServerPtr srv,
                        virNetServerClientPtr **clients,
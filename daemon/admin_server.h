@@ -46,6 +46,12 @@ adminServerSetThreadPoolParameters(virNetServerPtr srv,
                                    int nparams,
                                    unsigned int flags);
 
+int
+adminServerGetProcStats(virNetServerPtr srv,
+                        virTypedParameterPtr *params,
+                        int *nparams,
+                        unsigned int flags);
+
 int adminServerListClients(virNetServerPtr srv,
                            virNetServerClientPtr **clients,
                            unsigned int flags);
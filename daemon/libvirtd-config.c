@@ -377,6 +377,8 @@ daemonConfigLoadOptions(struct daemonConfig *data,
         goto error;
     if (virConfGetValueString(conf, "log_outputs", &data->log_outputs) < 0)
         goto error;
+    if (virConfGetValueBool(conf, "log_async", &data->log_async) < 0)
+        goto error;
 
     if (virConfGetValueInt(conf, "keepalive_interval", &data->keepalive_interval) < 0)
         goto error;
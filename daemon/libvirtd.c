@@ -695,6 +695,13 @@ daemonSetupLogging(struct daemonConfig *config,
     /* If there are some environment variables defined, use those instead */
     virLogSetFromEnv();
 
+    /*
+     * Async mode only changes how messages reach the outputs, so it's
+     * not subject to the env/cmdline overrides above
+     */
+    if (config->log_async)
+        ignore_value(virLogSetAsync(true));
+
     /*
      * Command line override for --verbose
      */
@@ -768,6 +775,8 @@ static void daemonReloadHandler(virNetDaemonPtr dmn ATTRIBUTE_UNUSED,
                                 siginfo_t *sig ATTRIBUTE_UNUSED,
                                 void *opaque ATTRIBUTE_UNUSED)
 {
+    virAccessManagerPtr accessMgr;
+
     if (!driversInitialized) {
         VIR_WARN("Drivers are not initialized, reload ignored");
         return;
@@ -776,6 +785,10 @@ static void daemonReloadHandler(virNetDaemonPtr dmn ATTRIBUTE_UNUSED,
     VIR_INFO("Reloading configuration on SIGHUP");
     virHookCall(VIR_HOOK_DRIVER_DAEMON, "-",
                 VIR_HOOK_DAEMON_OP_RELOAD, SIGHUP, "SIGHUP", NULL, NULL);
+    if ((accessMgr = virAccessManagerGetDefault())) {
+        virAccessManagerFlushCache(accessMgr);
+        virObjectUnref(accessMgr);
+    }
     if (virStateReload() < 0)
         VIR_WARN("Error while reloading drivers");
 }
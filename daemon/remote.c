@@ -3831,6 +3831,13 @@ remoteDispatchConnectDomainEventDeregister(virNetServerPtr server ATTRIBUTE_UNUS
     return rv;
 }
 
+/* Encode and queue one event for one client.  The encoded payload
+ * cannot be shared between subscribers: the modern callback protocol
+ * embeds the per-client callbackID in the message body, and the
+ * payloads are small fixed XDR structs (no XML is formatted here),
+ * so per-client encoding is already the cheap part of the fan-out.
+ * The per-client cost that matters is the ACL check in the relay
+ * callbacks. */
 static void
 remoteDispatchObjectEventSend(virNetServerClientPtr client,
                               virNetServerProgramPtr program,
@@ -3857,7 +3864,9 @@ remoteDispatchObjectEventSend(virNetServerClientPtr client,
         goto cleanup;
 
     VIR_DEBUG("Queue event %d %zu", procnr, msg->bufferLength);
-    virNetServerClientSendMessage(client, msg);
+    /* Delivery may be refused if the client's event queue is full */
+    if (virNetServerClientSendMessage(client, msg) < 0)
+        goto cleanup;
 
     xdr_free(proc, data);
     return;
@@ -200,6 +200,15 @@ int virAdmServerSetThreadPoolParameters(virAdmServerPtr srv,
                                         int nparams,
                                         unsigned int flags);
 
+/* Per-procedure dispatch statistics; parameter names have the form
+ * "proc.<program>.<procedure>.<counter>" where <counter> is one of
+ * "calls", "errors", "time.total", "time.max", "queue.total",
+ * "queue.max", "bytes.in" or "bytes.out". Times are in milliseconds. */
+int virAdmServerGetProcStats(virAdmServerPtr srv,
+                             virTypedParameterPtr *params,
+                             int *nparams,
+                             unsigned int flags);
+
 /* virAdmClient object accessors */
 unsigned long long virAdmClientGetID(virAdmClientPtr client);
 long long virAdmClientGetTimestamp(virAdmClientPtr client);
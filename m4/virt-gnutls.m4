@@ -64,6 +64,7 @@ AC_DEFUN([LIBVIRT_CHECK_GNUTLS],[
 
     AC_CHECK_FUNCS([gnutls_rnd])
     AC_CHECK_FUNCS([gnutls_cipher_encrypt])
+    AC_CHECK_FUNCS([gnutls_session_ticket_key_generate])
     CFLAGS="$OLD_CFLAGS"
     LIBS="$OLD_LIBS"
   fi
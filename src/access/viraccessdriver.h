@@ -63,6 +63,7 @@ typedef int (*virAccessDriverCheckStorageVolDrv)(virAccessManagerPtr manager,
 
 typedef int (*virAccessDriverSetupDrv)(virAccessManagerPtr manager);
 typedef void (*virAccessDriverCleanupDrv)(virAccessManagerPtr manager);
+typedef void (*virAccessDriverFlushCacheDrv)(virAccessManagerPtr manager);
 
 typedef struct _virAccessDriver virAccessDriver;
 typedef virAccessDriver *virAccessDriverPtr;
@@ -73,6 +74,7 @@ struct _virAccessDriver {
 
     virAccessDriverSetupDrv setup;
     virAccessDriverCleanupDrv cleanup;
+    virAccessDriverFlushCacheDrv flushCache;
 
     virAccessDriverCheckConnectDrv checkConnect;
     virAccessDriverCheckDomainDrv checkDomain;
@@ -22,12 +22,16 @@
 
 #include "viraccessdriverpolkit.h"
 #include "viralloc.h"
+#include "virbuffer.h"
 #include "vircommand.h"
+#include "virhash.h"
 #include "virlog.h"
 #include "virprocess.h"
 #include "virerror.h"
 #include "virpolkit.h"
 #include "virstring.h"
+#include "virthread.h"
+#include "virtime.h"
 
 #define VIR_FROM_THIS VIR_FROM_ACCESS
 
@@ -39,16 +43,61 @@ VIR_LOG_INIT("access.accessdriverpolkit");
 
 #define VIR_ACCESS_DRIVER_POLKIT_ACTION_PREFIX "org.libvirt.api"
 
+/* Cached decisions are trusted this long before polkit is asked again */
+#define VIR_ACCESS_DRIVER_POLKIT_CACHE_TTL_MS (15 * 1000)
+
+typedef struct _virAccessDriverPolkitCacheEntry virAccessDriverPolkitCacheEntry;
+typedef virAccessDriverPolkitCacheEntry *virAccessDriverPolkitCacheEntryPtr;
+
+struct _virAccessDriverPolkitCacheEntry {
+    int decision;               /* 1 == allowed, 0 == denied */
+    unsigned long long expires; /* ms timestamp after which entry is stale */
+};
+
 typedef struct _virAccessDriverPolkitPrivate virAccessDriverPolkitPrivate;
 typedef virAccessDriverPolkitPrivate *virAccessDriverPolkitPrivatePtr;
 
 struct _virAccessDriverPolkitPrivate {
-    bool ignore;
+    virMutex lock;
+    virHashTablePtr cache;
 };
 
 
-static void virAccessDriverPolkitCleanup(virAccessManagerPtr manager ATTRIBUTE_UNUSED)
+static int virAccessDriverPolkitSetup(virAccessManagerPtr manager)
+{
+    virAccessDriverPolkitPrivatePtr priv = virAccessManagerGetPrivateData(manager);
+
+    if (virMutexInit(&priv->lock) < 0) {
+        virAccessError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to initialize mutex"));
+        return -1;
+    }
+
+    if (!(priv->cache = virHashCreate(10, virHashValueFree))) {
+        virMutexDestroy(&priv->lock);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static void virAccessDriverPolkitCleanup(virAccessManagerPtr manager)
+{
+    virAccessDriverPolkitPrivatePtr priv = virAccessManagerGetPrivateData(manager);
+
+    virHashFree(priv->cache);
+    virMutexDestroy(&priv->lock);
+}
+
+
+static void virAccessDriverPolkitFlushCache(virAccessManagerPtr manager)
 {
+    virAccessDriverPolkitPrivatePtr priv = virAccessManagerGetPrivateData(manager);
+
+    virMutexLock(&priv->lock);
+    ignore_value(virHashRemoveAll(priv->cache));
+    virMutexUnlock(&priv->lock);
 }
 
 
@@ -112,13 +161,95 @@ virAccessDriverPolkitGetCaller(const char *actionid,
 }
 
 
+/*
+ * The key covers every input that virPolkitCheckAuth sees - the
+ * caller identity, the action and the per-object attributes - so
+ * caching cannot widen a decision beyond what polkit itself would
+ * return for the exact same query.
+ */
+static char *
+virAccessDriverPolkitFormatCacheKey(const char *actionid,
+                                    pid_t pid,
+                                    unsigned long long startTime,
+                                    uid_t uid,
+                                    const char **attrs)
+{
+    virBuffer buf = VIR_BUFFER_INITIALIZER;
+
+    virBufferAsprintf(&buf, "%lld %llu %d %s",
+                      (long long)pid, startTime, (int)uid, actionid);
+    while (attrs && attrs[0] && attrs[1]) {
+        virBufferAsprintf(&buf, " %s=%s", attrs[0], attrs[1]);
+        attrs += 2;
+    }
+
+    if (virBufferCheckError(&buf) < 0)
+        return NULL;
+
+    return virBufferContentAndReset(&buf);
+}
+
+
+static int
+virAccessDriverPolkitCacheLookup(virAccessManagerPtr manager,
+                                 const char *key)
+{
+    virAccessDriverPolkitPrivatePtr priv = virAccessManagerGetPrivateData(manager);
+    virAccessDriverPolkitCacheEntryPtr entry;
+    unsigned long long now;
+    int ret = -1;
+
+    if (virTimeMillisNowRaw(&now) < 0)
+        return -1;
+
+    virMutexLock(&priv->lock);
+    if ((entry = virHashLookup(priv->cache, key))) {
+        if (entry->expires > now)
+            ret = entry->decision;
+        else
+            ignore_value(virHashRemoveEntry(priv->cache, key));
+    }
+    virMutexUnlock(&priv->lock);
+
+    return ret;
+}
+
+
+static void
+virAccessDriverPolkitCacheStore(virAccessManagerPtr manager,
+                                const char *key,
+                                int decision)
+{
+    virAccessDriverPolkitPrivatePtr priv = virAccessManagerGetPrivateData(manager);
+    virAccessDriverPolkitCacheEntryPtr entry;
+    unsigned long long now;
+
+    /* Failure to cache is not an error - the next check
+     * simply asks polkit again */
+    if (virTimeMillisNowRaw(&now) < 0)
+        return;
+
+    if (VIR_ALLOC_QUIET(entry) < 0)
+        return;
+
+    entry->decision = decision;
+    entry->expires = now + VIR_ACCESS_DRIVER_POLKIT_CACHE_TTL_MS;
+
+    virMutexLock(&priv->lock);
+    if (virHashUpdateEntry(priv->cache, key, entry) < 0)
+        VIR_FREE(entry);
+    virMutexUnlock(&priv->lock);
+}
+
+
 static int
-virAccessDriverPolkitCheck(virAccessManagerPtr manager ATTRIBUTE_UNUSED,
+virAccessDriverPolkitCheck(virAccessManagerPtr manager,
                            const char *typename,
                            const char *permname,
                            const char **attrs)
 {
     char *actionid = NULL;
+    char *cachekey = NULL;
     int ret = -1;
     pid_t pid;
     uid_t uid;
@@ -134,6 +265,17 @@ virAccessDriverPolkitCheck(virAccessManagerPtr manager ATTRIBUTE_UNUSED,
                                        &uid) < 0)
         goto cleanup;
 
+    if (!(cachekey = virAccessDriverPolkitFormatCacheKey(actionid, pid,
+                                                         startTime, uid,
+                                                         attrs)))
+        goto cleanup;
+
+    if ((ret = virAccessDriverPolkitCacheLookup(manager, cachekey)) >= 0) {
+        VIR_DEBUG("Cached decision %d for action '%s' process '%lld'",
+                  ret, actionid, (long long) pid);
+        goto cleanup;
+    }
+
     VIR_DEBUG("Check action '%s' for process '%lld' time %lld uid %d",
               actionid, (long long) pid, startTime, uid);
 
@@ -154,7 +296,11 @@ virAccessDriverPolkitCheck(virAccessManagerPtr manager ATTRIBUTE_UNUSED,
         }
     }
 
+    if (ret >= 0)
+        virAccessDriverPolkitCacheStore(manager, cachekey, ret);
+
  cleanup:
+    VIR_FREE(cachekey);
     VIR_FREE(actionid);
     return ret;
 }
@@ -402,7 +548,9 @@ virAccessDriverPolkitCheckStorageVol(virAccessManagerPtr manager,
 virAccessDriver accessDriverPolkit = {
     .privateDataLen = sizeof(virAccessDriverPolkitPrivate),
     .name = "polkit",
+    .setup = virAccessDriverPolkitSetup,
     .cleanup = virAccessDriverPolkitCleanup,
+    .flushCache = virAccessDriverPolkitFlushCache,
     .checkConnect = virAccessDriverPolkitCheckConnect,
     .checkDomain = virAccessDriverPolkitCheckDomain,
     .checkInterface = virAccessDriverPolkitCheckInterface,
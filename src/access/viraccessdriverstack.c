@@ -267,10 +267,20 @@ virAccessDriverStackCheckStorageVol(virAccessManagerPtr manager,
     return ret;
 }
 
+static void virAccessDriverStackFlushCache(virAccessManagerPtr manager)
+{
+    virAccessDriverStackPrivatePtr priv = virAccessManagerGetPrivateData(manager);
+    size_t i;
+
+    for (i = 0; i < priv->managersLen; i++)
+        virAccessManagerFlushCache(priv->managers[i]);
+}
+
 virAccessDriver accessDriverStack = {
     .privateDataLen = sizeof(virAccessDriverStackPrivate),
     .name = "stack",
     .cleanup = virAccessDriverStackCleanup,
+    .flushCache = virAccessDriverStackFlushCache,
     .checkConnect = virAccessDriverStackCheckConnect,
     .checkDomain = virAccessDriverStackCheckDomain,
     .checkInterface = virAccessDriverStackCheckInterface,
@@ -182,6 +182,16 @@ void *virAccessManagerGetPrivateData(virAccessManagerPtr mgr)
 }
 
 
+/* Drop any access decisions the driver may have cached, so
+ * that the next check reflects the current security policy.
+ * Invoked when the daemon is told its configuration changed */
+void virAccessManagerFlushCache(virAccessManagerPtr manager)
+{
+    if (manager->drv->flushCache)
+        manager->drv->flushCache(manager);
+}
+
+
 static void virAccessManagerDispose(void *object)
 {
     virAccessManagerPtr mgr = object;
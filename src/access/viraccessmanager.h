@@ -43,6 +43,8 @@ virAccessManagerPtr virAccessManagerNewStack(const char **names);
 
 void *virAccessManagerGetPrivateData(virAccessManagerPtr manager);
 
+void virAccessManagerFlushCache(virAccessManagerPtr manager);
+
 
 /*
  * The virAccessManagerCheckXXX functions will
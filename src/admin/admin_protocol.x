@@ -39,6 +39,9 @@ const ADMIN_SERVER_LIST_MAX = 16384;
 /* Upper limit on number of threadpool parameters */
 const ADMIN_SERVER_THREADPOOL_PARAMETERS_MAX = 32;
 
+/* Upper limit on number of per-procedure statistics parameters */
+const ADMIN_SERVER_PROC_STATS_PARAMETERS_MAX = 16384;
+
 /* Upper limit on list of clients */
 const ADMIN_CLIENT_LIST_MAX = 16384;
 
@@ -133,6 +136,15 @@ struct admin_server_set_threadpool_parameters_args {
     unsigned int flags;
 };
 
+struct admin_server_get_proc_stats_args {
+    admin_nonnull_server srv;
+    unsigned int flags;
+};
+
+struct admin_server_get_proc_stats_ret {
+    admin_typed_param params<ADMIN_SERVER_PROC_STATS_PARAMETERS_MAX>;
+};
+
 struct admin_server_list_clients_args {
     admin_nonnull_server srv;
     unsigned int need_results;
@@ -316,5 +328,10 @@ enum admin_procedure {
     /**
      * @generate: both
      */
-    ADMIN_PROC_CONNECT_SET_LOGGING_FILTERS = 17
+    ADMIN_PROC_CONNECT_SET_LOGGING_FILTERS = 17,
+
+    /**
+     * @generate: none
+     */
+    ADMIN_PROC_SERVER_GET_PROC_STATS = 18
 };
@@ -315,6 +315,43 @@ remoteAdminServerSetThreadPoolParameters(virAdmServerPtr srv,
     return rv;
 }
 
+static int
+remoteAdminServerGetProcStats(virAdmServerPtr srv,
+                              virTypedParameterPtr *params,
+                              int *nparams,
+                              unsigned int flags)
+{
+    int rv = -1;
+    remoteAdminPrivPtr priv = srv->conn->privateData;
+    admin_server_get_proc_stats_args args;
+    admin_server_get_proc_stats_ret ret;
+
+    args.flags = flags;
+    make_nonnull_server(&args.srv, srv);
+
+    memset(&ret, 0, sizeof(ret));
+    virObjectLock(priv);
+
+    if (call(srv->conn, 0, ADMIN_PROC_SERVER_GET_PROC_STATS,
+             (xdrproc_t)xdr_admin_server_get_proc_stats_args, (char *) &args,
+             (xdrproc_t)xdr_admin_server_get_proc_stats_ret, (char *) &ret) == -1)
+        goto cleanup;
+
+    if (virTypedParamsDeserialize((virTypedParameterRemotePtr) ret.params.params_val,
+                                  ret.params.params_len,
+                                  ADMIN_SERVER_PROC_STATS_PARAMETERS_MAX,
+                                  params,
+                                  nparams) < 0)
+        goto cleanup;
+
+    rv = 0;
+    xdr_free((xdrproc_t)xdr_admin_server_get_proc_stats_ret, (char *) &ret);
+
+ cleanup:
+    virObjectUnlock(priv);
+    return rv;
+}
+
 static int
 remoteAdminClientGetInfo(virAdmClientPtr client,
                          virTypedParameterPtr *params,
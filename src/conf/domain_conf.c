@@ -2813,6 +2813,8 @@ static void virDomainObjDispose(void *obj)
     virCondDestroy(&dom->cond);
     virDomainDefFree(dom->def);
     virDomainDefFree(dom->newDef);
+    VIR_FREE(dom->xmlCache);
+    VIR_FREE(dom->statusXML);
 
     if (dom->privateDataFreeFunc)
         (dom->privateDataFreeFunc)(dom->privateData);
@@ -2904,11 +2906,87 @@ virDomainDefNewFull(const char *name,
 }
 
 
+/**
+ * virDomainObjDefGenerationBump:
+ * @domain: domain object
+ *
+ * Increment the definition generation counter of @domain, invalidating
+ * any formatted XML cached via virDomainObjSetXMLCache(). Drivers must
+ * call this whenever they change the content of the live or persistent
+ * definition in place; the conf level helpers that swap whole
+ * definitions do so themselves.
+ */
+void
+virDomainObjDefGenerationBump(virDomainObjPtr domain)
+{
+    domain->defGeneration++;
+}
+
+
+/**
+ * virDomainObjGetXMLCache:
+ * @domain: domain object
+ * @def: definition that is about to be formatted
+ * @flags: bitwise-OR of virDomainXMLFlags
+ *
+ * Look up the formatted XML document remembered by the last call to
+ * virDomainObjSetXMLCache(). The cache hits only if @def, @flags and
+ * the definition generation all match, i.e. formatting @def again
+ * would produce the very same document.
+ *
+ * Returns a copy of the cached document (caller frees), or NULL on a
+ * cache miss.
+ */
+char *
+virDomainObjGetXMLCache(virDomainObjPtr domain,
+                        virDomainDefPtr def,
+                        unsigned int flags)
+{
+    char *ret = NULL;
+
+    if (!domain->xmlCache ||
+        domain->xmlCacheDef != def ||
+        domain->xmlCacheGeneration != domain->defGeneration ||
+        domain->xmlCacheFlags != flags)
+        return NULL;
+
+    ignore_value(VIR_STRDUP_QUIET(ret, domain->xmlCache));
+    return ret;
+}
+
+
+/**
+ * virDomainObjSetXMLCache:
+ * @domain: domain object
+ * @def: definition that @xml was formatted from
+ * @flags: bitwise-OR of virDomainXMLFlags used for formatting
+ * @xml: the formatted document
+ *
+ * Remember @xml as the result of formatting @def with @flags at the
+ * current definition generation, replacing any previously cached
+ * document. Failure to copy @xml merely leaves the cache empty.
+ */
+void
+virDomainObjSetXMLCache(virDomainObjPtr domain,
+                        virDomainDefPtr def,
+                        unsigned int flags,
+                        const char *xml)
+{
+    VIR_FREE(domain->xmlCache);
+    if (VIR_STRDUP_QUIET(domain->xmlCache, xml) < 0)
+        return;
+    domain->xmlCacheDef = def;
+    domain->xmlCacheGeneration = domain->defGeneration;
+    domain->xmlCacheFlags = flags;
+}
+
+
 void virDomainObjAssignDef(virDomainObjPtr domain,
                            virDomainDefPtr def,
                            bool live,
                            virDomainDefPtr *oldDef)
 {
+    virDomainObjDefGenerationBump(domain);
     if (oldDef)
         *oldDef = NULL;
     if (virDomainObjIsActive(domain)) {
@@ -3034,6 +3112,7 @@ virDomainObjSetDefTransient(virCapsPtr caps,
     if (!(domain->newDef = virDomainDefCopy(domain->def, caps, xmlopt, NULL, false)))
         goto out;
 
+    virDomainObjDefGenerationBump(domain);
     ret = 0;
  out:
     return ret;
@@ -3055,6 +3134,7 @@ virDomainObjRemoveTransientDef(virDomainObjPtr domain)
     domain->def = domain->newDef;
     domain->def->id = -1;
     domain->newDef = NULL;
+    virDomainObjDefGenerationBump(domain);
 }
 
 
@@ -3452,15 +3532,17 @@ virDomainDeviceInfoCopy(virDomainDeviceInfoPtr dst,
     dst->alias = NULL;
     dst->romfile = NULL;
 
-    if (VIR_STRDUP(dst->alias, src->alias) < 0 ||
-        VIR_STRDUP(dst->romfile, src->romfile) < 0)
+    if (src->alias && !(dst->alias = virStringIntern(src->alias)))
+        return -1;
+    if (VIR_STRDUP(dst->romfile, src->romfile) < 0)
         return -1;
     return 0;
 }
 
 void virDomainDeviceInfoClear(virDomainDeviceInfoPtr info)
 {
-    VIR_FREE(info->alias);
+    virStringInternFree(info->alias);
+    info->alias = NULL;
     memset(&info->addr, 0, sizeof(info->addr));
     info->type = VIR_DOMAIN_DEVICE_ADDRESS_TYPE_NONE;
     VIR_FREE(info->romfile);
@@ -5656,8 +5738,18 @@ virDomainDeviceInfoParseXML(xmlNodePtr node,
         cur = cur->next;
     }
 
-    if (alias)
-        info->alias = virXMLPropString(alias, "name");
+    if (alias) {
+        char *aliasStr = virXMLPropString(alias, "name");
+
+        /* The same few alias strings repeat across all parsed domains,
+         * so store the shared interned copy instead of this one */
+        if (aliasStr) {
+            info->alias = virStringIntern(aliasStr);
+            VIR_FREE(aliasStr);
+            if (!info->alias)
+                goto cleanup;
+        }
+    }
 
     if (master) {
         info->mastertype = VIR_DOMAIN_CONTROLLER_MASTER_USB;
@@ -5764,8 +5856,10 @@ virDomainDeviceInfoParseXML(xmlNodePtr node,
     ret = 0;
 
  cleanup:
-    if (ret == -1)
-        VIR_FREE(info->alias);
+    if (ret == -1) {
+        virStringInternFree(info->alias);
+        info->alias = NULL;
+    }
     VIR_FREE(type);
     return ret;
 }
@@ -7319,10 +7413,10 @@ virDomainDiskSourceParse(xmlNodePtr node,
         }
 
         /* snapshot currently works only for remote disks */
-        src->snapshot = virXPathString("string(./snapshot/@name)", ctxt);
+        src->snapshot = virXMLChildPropString(node, "snapshot", "name");
 
         /* config file currently only works with remote disks */
-        src->configFile = virXPathString("string(./config/@file)", ctxt);
+        src->configFile = virXMLChildPropString(node, "config", "file");
 
         if (virDomainStorageHostParse(node, &src->hosts, &src->nhosts) < 0)
             goto cleanup;
@@ -8663,11 +8757,17 @@ virDomainControllerDefParseXML(xmlNodePtr node,
     /* node is parsed differently from target attributes because
      * someone thought it should be a subelement instead...
      */
-    rc = virXPathInt("string(./target/node)", ctxt, &numaNode);
-    if (rc == -2 || (rc == 0 && numaNode < 0)) {
-        virReportError(VIR_ERR_XML_ERROR, "%s",
-                       _("invalid NUMA node in target"));
-        goto error;
+    if ((cur = virXMLNodeGetSubelement(node, "target")) &&
+        (cur = virXMLNodeGetSubelement(cur, "node"))) {
+        char *tmp = (char *) xmlNodeGetContent(cur);
+
+        rc = tmp ? virStrToLong_i(tmp, NULL, 10, &numaNode) : -1;
+        VIR_FREE(tmp);
+        if (rc < 0 || numaNode < 0) {
+            virReportError(VIR_ERR_XML_ERROR, "%s",
+                           _("invalid NUMA node in target"));
+            goto error;
+        }
     }
 
     if (queues && virStrToLong_ui(queues, NULL, 10, &def->queues) < 0) {
@@ -9101,6 +9201,7 @@ virDomainActualNetDefParseXML(xmlNodePtr node,
     xmlNodePtr bandwidth_node = NULL;
     xmlNodePtr vlanNode;
     xmlNodePtr virtPortNode;
+    xmlNodePtr sourceNode;
     char *type = NULL;
     char *mode = NULL;
     char *addrtype = NULL;
@@ -9189,11 +9290,14 @@ virDomainActualNetDefParseXML(xmlNodePtr node,
          * passed in as a string, since it is in a different place in
          * NetDef vs HostdevDef.
          */
-        addrtype = virXPathString("string(./source/address/@type)", ctxt);
-        /* if not explicitly stated, source/vendor implies usb device */
-        if (!addrtype && virXPathNode("./source/vendor", ctxt) &&
-            VIR_STRDUP(addrtype, "usb") < 0)
-            goto error;
+        if ((sourceNode = virXMLNodeGetSubelement(node, "source"))) {
+            addrtype = virXMLChildPropString(sourceNode, "address", "type");
+            /* if not explicitly stated, source/vendor implies usb device */
+            if (!addrtype &&
+                virXMLNodeGetSubelement(sourceNode, "vendor") &&
+                VIR_STRDUP(addrtype, "usb") < 0)
+                goto error;
+        }
         hostdev->mode = VIR_DOMAIN_HOSTDEV_MODE_SUBSYS;
         if (virDomainHostdevDefParseXMLSubsys(node, ctxt, addrtype,
                                               hostdev, flags) < 0) {
@@ -9459,11 +9563,11 @@ virDomainNetDefParseXML(virDomainXMLOptionPtr xmlopt,
                 address = virXMLPropString(cur, "address");
                 port = virXMLPropString(cur, "port");
                 if (!localaddr && def->type == VIR_DOMAIN_NET_TYPE_UDP) {
-                    xmlNodePtr tmpnode = ctxt->node;
-                    ctxt->node = cur;
-                    localaddr = virXPathString("string(./local/@address)", ctxt);
-                    localport = virXPathString("string(./local/@port)", ctxt);
-                    ctxt->node = tmpnode;
+                    xmlNodePtr local = virXMLNodeGetSubelement(cur, "local");
+                    if (local) {
+                        localaddr = virXMLPropString(local, "address");
+                        localport = virXMLPropString(local, "port");
+                    }
                 }
             } else if (!ifname &&
                        xmlStrEqual(cur->name, BAD_CAST "target")) {
@@ -9768,11 +9872,14 @@ virDomainNetDefParseXML(virDomainXMLOptionPtr xmlopt,
          * passed in as a string, since it is in a different place in
          * NetDef vs HostdevDef.
          */
-        addrtype = virXPathString("string(./source/address/@type)", ctxt);
-        /* if not explicitly stated, source/vendor implies usb device */
-        if (!addrtype && virXPathNode("./source/vendor", ctxt) &&
-            VIR_STRDUP(addrtype, "usb") < 0)
-            goto error;
+        if ((cur = virXMLNodeGetSubelement(node, "source"))) {
+            addrtype = virXMLChildPropString(cur, "address", "type");
+            /* if not explicitly stated, source/vendor implies usb device */
+            if (!addrtype &&
+                virXMLNodeGetSubelement(cur, "vendor") &&
+                VIR_STRDUP(addrtype, "usb") < 0)
+                goto error;
+        }
         hostdev->mode = VIR_DOMAIN_HOSTDEV_MODE_SUBSYS;
         if (virDomainHostdevDefParseXMLSubsys(node, ctxt, addrtype,
                                               hostdev, flags) < 0) {
@@ -24585,16 +24692,33 @@ virDomainSaveStatus(virDomainXMLOptionPtr xmlopt,
                           VIR_DOMAIN_DEF_FORMAT_CLOCK_ADJUST);
 
     int ret = -1;
-    char *xml;
+    char *xml = NULL;
+    char *statusFile = NULL;
 
     if (!(xml = virDomainObjFormat(xmlopt, obj, caps, flags)))
         goto cleanup;
 
+    /* Most state transitions re-save XML identical to what is already
+     * on disk; comparing against the last written content lets us skip
+     * the write+fsync+rename in that case.  The existence check guards
+     * against the status file having been removed behind our back. */
+    if (obj->statusXML && STREQ(obj->statusXML, xml) &&
+        (statusFile = virDomainConfigFile(statusDir, obj->def->name)) &&
+        virFileExists(statusFile)) {
+        ret = 0;
+        goto cleanup;
+    }
+
     if (virDomainSaveXML(statusDir, obj->def, xml))
         goto cleanup;
 
+    VIR_FREE(obj->statusXML);
+    /* on OOM simply leave the cache empty; the next save rewrites */
+    ignore_value(VIR_STRDUP_QUIET(obj->statusXML, xml));
+
     ret = 0;
  cleanup:
+    VIR_FREE(statusFile);
     VIR_FREE(xml);
     return ret;
 }
@@ -24964,12 +25088,13 @@ virDomainDefCopy(virDomainDefPtr src,
 virDomainDefPtr
 virDomainObjCopyPersistentDef(virDomainObjPtr dom,
                               virCapsPtr caps,
-                              virDomainXMLOptionPtr xmlopt)
+                              virDomainXMLOptionPtr xmlopt,
+                              void *parseOpaque)
 {
     virDomainDefPtr cur;
 
     cur = virDomainObjGetPersistentDef(caps, xmlopt, dom);
-    return virDomainDefCopy(cur, caps, xmlopt, NULL, false);
+    return virDomainDefCopy(cur, caps, xmlopt, parseOpaque, false);
 }
 
 
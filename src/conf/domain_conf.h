@@ -2375,6 +2375,19 @@ struct _virDomainObj {
 
     int taint;
 
+    unsigned long long defGeneration; /* bumped on every definition change;
+                                       * invalidates the formatted XML cache */
+
+    /* single entry cache of the most recently formatted domain XML,
+     * managed via virDomainObjGetXMLCache/virDomainObjSetXMLCache */
+    char *xmlCache;
+    virDomainDefPtr xmlCacheDef; /* compared by pointer, never dereferenced */
+    unsigned long long xmlCacheGeneration;
+    unsigned int xmlCacheFlags;
+
+    char *statusXML; /* content last written to the status dir, used to
+                      * skip rewriting the file when nothing changed */
+
     unsigned long long original_memlock; /* Original RLIMIT_MEMLOCK, zero if no
                                           * restore will be required later */
 };
@@ -2633,6 +2646,14 @@ int virDomainObjSetDefTransient(virCapsPtr caps,
                                 virDomainXMLOptionPtr xmlopt,
                                 virDomainObjPtr domain);
 void virDomainObjRemoveTransientDef(virDomainObjPtr domain);
+void virDomainObjDefGenerationBump(virDomainObjPtr domain);
+char *virDomainObjGetXMLCache(virDomainObjPtr domain,
+                              virDomainDefPtr def,
+                              unsigned int flags);
+void virDomainObjSetXMLCache(virDomainObjPtr domain,
+                             virDomainDefPtr def,
+                             unsigned int flags,
+                             const char *xml);
 virDomainDefPtr
 virDomainObjGetPersistentDef(virCapsPtr caps,
                              virDomainXMLOptionPtr xmlopt,
@@ -2657,7 +2678,8 @@ virDomainDefPtr virDomainDefCopy(virDomainDefPtr src,
                                  bool migratable);
 virDomainDefPtr virDomainObjCopyPersistentDef(virDomainObjPtr dom,
                                               virCapsPtr caps,
-                                              virDomainXMLOptionPtr xmlopt);
+                                              virDomainXMLOptionPtr xmlopt,
+                                              void *parseOpaque);
 
 typedef enum {
     /* parse internal domain status information */
@@ -3302,8 +3302,9 @@ virNetworkObjPtr virNetworkLoadConfig(virNetworkObjListPtr nets,
 {
     char *configFile = NULL, *autostartLink = NULL;
     virNetworkDefPtr def = NULL;
-    virNetworkObjPtr net;
+    virNetworkObjPtr net = NULL;
     int autostart;
+    struct stat sb;
 
     if ((configFile = virNetworkConfigFile(configDir, name)) == NULL)
         goto error;
@@ -3313,6 +3314,23 @@ virNetworkObjPtr virNetworkLoadConfig(virNetworkObjListPtr nets,
     if ((autostart = virFileLinkPointsTo(autostartLink, configFile)) < 0)
         goto error;
 
+    if (stat(configFile, &sb) < 0) {
+        virReportSystemError(errno, _("cannot stat '%s'"), configFile);
+        goto error;
+    }
+
+    /* Reloads walk every config in the directory; reuse the existing
+     * object when the file has not changed since it was last parsed */
+    if ((net = virNetworkObjFindByName(nets, name))) {
+        if (net->configMtime == sb.st_mtime) {
+            net->autostart = autostart;
+            VIR_FREE(configFile);
+            VIR_FREE(autostartLink);
+            return net;
+        }
+        virNetworkObjEndAPI(&net);
+    }
+
     if (!(def = virNetworkDefParseFile(configFile)))
         goto error;
 
@@ -3342,6 +3360,7 @@ virNetworkObjPtr virNetworkLoadConfig(virNetworkObjListPtr nets,
     if (!(net = virNetworkAssignDef(nets, def, 0)))
         goto error;
 
+    net->configMtime = sb.st_mtime;
     net->autostart = autostart;
 
     VIR_FREE(configFile);
@@ -32,6 +32,7 @@
 #include "datatypes.h"
 #include "viralloc.h"
 #include "virerror.h"
+#include "virhash.h"
 #include "virobject.h"
 #include "virstring.h"
 
@@ -47,6 +48,7 @@ struct _virObjectEventCallback {
     int remoteID;
     bool key_filter;
     char *key;
+    char *idxkey; /* key in the list's keyIndex, if the callback is indexed */
     virObjectEventCallbackFilter filter;
     void *filter_opaque;
     virConnectObjectEventGenericCallback cb;
@@ -62,8 +64,22 @@ struct _virObjectEventCallbackList {
     unsigned int nextID;
     size_t count;
     virObjectEventCallbackPtr *callbacks;
+    /* Index of the per-object callbacks, mapping "eventID-key" to a
+     * virObjectEventCallbackIndexBucket so that dispatching an event
+     * only has to consider the callbacks registered against that
+     * object rather than rescanning every registration.  Callbacks
+     * with an extra filter function and global (non-keyed) callbacks
+     * are not indexed. */
+    virHashTablePtr keyIndex;
 };
 
+struct _virObjectEventCallbackIndexBucket {
+    size_t count;
+    virObjectEventCallbackPtr *callbacks;
+};
+typedef struct _virObjectEventCallbackIndexBucket virObjectEventCallbackIndexBucket;
+typedef virObjectEventCallbackIndexBucket *virObjectEventCallbackIndexBucketPtr;
+
 struct _virObjectEventQueue {
     size_t count;
     virObjectEventPtr *events;
@@ -151,9 +167,94 @@ virObjectEventCallbackFree(virObjectEventCallbackPtr cb)
 
     virObjectUnref(cb->conn);
     VIR_FREE(cb->key);
+    VIR_FREE(cb->idxkey);
     VIR_FREE(cb);
 }
 
+
+static void
+virObjectEventCallbackIndexBucketFree(void *payload,
+                                      const void *name ATTRIBUTE_UNUSED)
+{
+    virObjectEventCallbackIndexBucketPtr bucket = payload;
+
+    VIR_FREE(bucket->callbacks);
+    VIR_FREE(bucket);
+}
+
+
+/**
+ * virObjectEventCallbackListIndexAdd:
+ * @cbList: the list owning the index
+ * @cb: the callback to index
+ *
+ * Internal function to record @cb in the key index, if it is a plain
+ * per-object callback.  Global callbacks and callbacks using an extra
+ * filter function are left for the linear walk at dispatch time.
+ *
+ * Returns: 0 on success, -1 on failure
+ */
+static int
+virObjectEventCallbackListIndexAdd(virObjectEventCallbackListPtr cbList,
+                                   virObjectEventCallbackPtr cb)
+{
+    virObjectEventCallbackIndexBucketPtr bucket;
+    virObjectEventCallbackPtr tmp = cb;
+
+    if (!cbList->keyIndex || !cb->key_filter || cb->filter)
+        return 0;
+
+    if (virAsprintf(&cb->idxkey, "%d-%s", cb->eventID, cb->key) < 0)
+        return -1;
+
+    if (!(bucket = virHashLookup(cbList->keyIndex, cb->idxkey))) {
+        if (VIR_ALLOC(bucket) < 0)
+            return -1;
+        if (virHashAddEntry(cbList->keyIndex, cb->idxkey, bucket) < 0) {
+            VIR_FREE(bucket);
+            return -1;
+        }
+    }
+
+    /* An empty bucket left behind on failure here is harmless */
+    if (VIR_APPEND_ELEMENT(bucket->callbacks, bucket->count, tmp) < 0)
+        return -1;
+    return 0;
+}
+
+
+/**
+ * virObjectEventCallbackListIndexRemove:
+ * @cbList: the list owning the index
+ * @cb: the callback to unindex
+ *
+ * Internal function to drop @cb from the key index before it is
+ * removed from the list.
+ */
+static void
+virObjectEventCallbackListIndexRemove(virObjectEventCallbackListPtr cbList,
+                                      virObjectEventCallbackPtr cb)
+{
+    virObjectEventCallbackIndexBucketPtr bucket;
+    size_t i;
+
+    if (!cbList->keyIndex || !cb->idxkey)
+        return;
+
+    if (!(bucket = virHashLookup(cbList->keyIndex, cb->idxkey)))
+        return;
+
+    for (i = 0; i < bucket->count; i++) {
+        if (bucket->callbacks[i] == cb) {
+            VIR_DELETE_ELEMENT(bucket->callbacks, i, bucket->count);
+            break;
+        }
+    }
+
+    if (bucket->count == 0)
+        ignore_value(virHashRemoveEntry(cbList->keyIndex, cb->idxkey));
+}
+
 /**
  * virObjectEventCallbackListFree:
  * @list: event callback list head
@@ -173,6 +274,7 @@ virObjectEventCallbackListFree(virObjectEventCallbackListPtr list)
             (*freecb)(list->callbacks[i]->opaque);
         VIR_FREE(list->callbacks[i]);
     }
+    virHashFree(list->keyIndex);
     VIR_FREE(list->callbacks);
     VIR_FREE(list);
 }
@@ -258,6 +360,7 @@ virObjectEventCallbackListRemoveID(virConnectPtr conn,
 
             if (cb->freecb)
                 (*cb->freecb)(cb->opaque);
+            virObjectEventCallbackListIndexRemove(cbList, cb);
             virObjectEventCallbackFree(cb);
             VIR_DELETE_ELEMENT(cbList->callbacks, i, cbList->count);
             return ret;
@@ -307,6 +410,7 @@ virObjectEventCallbackListPurgeMarked(virObjectEventCallbackListPtr cbList)
             virFreeCallback freecb = cbList->callbacks[n]->freecb;
             if (freecb)
                 (*freecb)(cbList->callbacks[n]->opaque);
+            virObjectEventCallbackListIndexRemove(cbList, cbList->callbacks[n]);
             virObjectEventCallbackFree(cbList->callbacks[n]);
 
             VIR_DELETE_ELEMENT(cbList->callbacks, n, cbList->count);
@@ -405,6 +509,7 @@ virObjectEventCallbackListAddID(virConnectPtr conn,
                                 bool serverFilter)
 {
     virObjectEventCallbackPtr cb;
+    virObjectEventCallbackPtr added;
     int ret = -1;
     int remoteID = -1;
 
@@ -449,9 +554,16 @@ virObjectEventCallbackListAddID(virConnectPtr conn,
     cb->filter_opaque = filter_opaque;
     cb->legacy = legacy;
 
+    added = cb;
     if (VIR_APPEND_ELEMENT(cbList->callbacks, cbList->count, cb) < 0)
         goto cleanup;
 
+    if (virObjectEventCallbackListIndexAdd(cbList, added) < 0) {
+        VIR_DELETE_ELEMENT(cbList->callbacks, cbList->count - 1, cbList->count);
+        cb = added;
+        goto cleanup;
+    }
+
     /* When additional filtering is being done, every client callback
      * is matched to exactly one server callback.  */
     if (filter) {
@@ -575,6 +687,10 @@ virObjectEventStateNew(void)
     if (VIR_ALLOC(state->callbacks) < 0)
         goto error;
 
+    if (!(state->callbacks->keyIndex =
+          virHashCreate(53, virObjectEventCallbackIndexBucketFree)))
+        goto error;
+
     if (!(state->queue = virObjectEventQueueNew()))
         goto error;
 
@@ -694,14 +810,51 @@ virObjectEventStateDispatchCallbacks(virObjectEventStatePtr state,
                                      virObjectEventCallbackListPtr callbacks)
 {
     size_t i;
+    char *idxkey = NULL;
+    virObjectEventCallbackIndexBucketPtr bucket = NULL;
     /* Cache this now, since we may be dropping the lock,
        and have more callbacks added. We're guaranteed not
        to have any removed */
     size_t cbCount = callbacks->count;
 
+    /* Per-object callbacks are reached through the key index, so that
+     * an event storm does not rescan every keyed registration for
+     * every event; global callbacks and callbacks with an extra
+     * filter function still need the linear walk below.  If building
+     * the key fails we simply fall back to scanning everything. */
+    if (callbacks->keyIndex && event->meta.key &&
+        virAsprintfQuiet(&idxkey, "%d-%s", event->eventID,
+                         event->meta.key) < 0)
+        idxkey = NULL;
+
+    if (idxkey)
+        bucket = virHashLookup(callbacks->keyIndex, idxkey);
+
+    if (bucket) {
+        /* As with cbCount above; appends during dispatch may
+         * reallocate the array, so re-read it on every iteration */
+        size_t bucketCount = bucket->count;
+
+        for (i = 0; i < bucketCount; i++) {
+            virObjectEventCallbackPtr cb = bucket->callbacks[i];
+
+            if (!virObjectEventDispatchMatchCallback(event, cb))
+                continue;
+
+            virObjectUnlock(state);
+            event->dispatch(cb->conn, event, cb->cb, cb->opaque);
+            virObjectLock(state);
+        }
+    }
+
     for (i = 0; i < cbCount; i++) {
         virObjectEventCallbackPtr cb = callbacks->callbacks[i];
 
+        /* Any keyed callback that could match was already handled
+         * through the index */
+        if (idxkey && cb->key_filter && !cb->filter)
+            continue;
+
         if (!virObjectEventDispatchMatchCallback(event, cb))
             continue;
 
@@ -710,6 +863,8 @@ virObjectEventStateDispatchCallbacks(virObjectEventStatePtr state,
         event->dispatch(cb->conn, event, cb->cb, cb->opaque);
         virObjectLock(state);
     }
+
+    VIR_FREE(idxkey);
 }
 
 
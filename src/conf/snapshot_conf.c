@@ -841,6 +841,11 @@ struct virDomainSnapshotNameData {
     unsigned int flags;
     int count;
     bool error;
+    /* when dom is set, whole snapshot objects are collected into
+     * snaps instead of copying names */
+    virDomainPtr dom;
+    virDomainSnapshotPtr *snaps;
+    size_t nsnaps;
 };
 
 static int virDomainSnapshotObjListCopyNames(void *payload,
@@ -879,8 +884,17 @@ static int virDomainSnapshotObjListCopyNames(void *payload,
         !virDomainSnapshotIsExternal(obj))
         return 0;
 
-    if (data->names && data->count < data->maxnames &&
-        VIR_STRDUP(data->names[data->count], obj->def->name) < 0) {
+    if (data->dom) {
+        virDomainSnapshotPtr snap;
+
+        if (!(snap = virGetDomainSnapshot(data->dom, obj->def->name)) ||
+            VIR_APPEND_ELEMENT(data->snaps, data->nsnaps, snap) < 0) {
+            virObjectUnref(snap);
+            data->error = true;
+            return 0;
+        }
+    } else if (data->names && data->count < data->maxnames &&
+               VIR_STRDUP(data->names[data->count], obj->def->name) < 0) {
         data->error = true;
         return 0;
     }
@@ -888,16 +902,15 @@ static int virDomainSnapshotObjListCopyNames(void *payload,
     return 0;
 }
 
-int
-virDomainSnapshotObjListGetNames(virDomainSnapshotObjListPtr snapshots,
+/* Shared traversal for name listing and object serialization;
+ * normalizes the filter flags and walks the tree (or the whole
+ * hash) exactly once, invoking the copy visitor per match */
+static void
+virDomainSnapshotObjListTraverse(virDomainSnapshotObjListPtr snapshots,
                                  virDomainSnapshotObjPtr from,
-                                 char **const names, int maxnames,
-                                 unsigned int flags)
+                                 unsigned int flags,
+                                 struct virDomainSnapshotNameData *data)
 {
-    struct virDomainSnapshotNameData data = { names, maxnames, flags, 0,
-                                              false };
-    size_t i;
-
     if (!from) {
         /* LIST_ROOTS and LIST_DESCENDANTS have the same bit value,
          * but opposite semantics.  Toggle here to get the correct
@@ -908,46 +921,59 @@ virDomainSnapshotObjListGetNames(virDomainSnapshotObjListPtr snapshots,
 
     /* We handle LIST_ROOT/LIST_DESCENDANTS directly, mask that bit
      * out to determine when we must use the filter callback.  */
-    data.flags &= ~VIR_DOMAIN_SNAPSHOT_LIST_DESCENDANTS;
+    data->flags &= ~VIR_DOMAIN_SNAPSHOT_LIST_DESCENDANTS;
 
     /* If this common code is being used, we assume that all snapshots
      * have metadata, and thus can handle METADATA up front as an
      * all-or-none filter.  XXX This might not always be true, if we
      * add the ability to track qcow2 internal snapshots without the
      * use of metadata.  */
-    if ((data.flags & VIR_DOMAIN_SNAPSHOT_FILTERS_METADATA) ==
+    if ((data->flags & VIR_DOMAIN_SNAPSHOT_FILTERS_METADATA) ==
         VIR_DOMAIN_SNAPSHOT_LIST_NO_METADATA)
-        return 0;
-    data.flags &= ~VIR_DOMAIN_SNAPSHOT_FILTERS_METADATA;
+        return;
+    data->flags &= ~VIR_DOMAIN_SNAPSHOT_FILTERS_METADATA;
 
     /* For ease of coding the visitor, it is easier to zero each group
      * where all of the bits are set.  */
-    if ((data.flags & VIR_DOMAIN_SNAPSHOT_FILTERS_LEAVES) ==
+    if ((data->flags & VIR_DOMAIN_SNAPSHOT_FILTERS_LEAVES) ==
         VIR_DOMAIN_SNAPSHOT_FILTERS_LEAVES)
-        data.flags &= ~VIR_DOMAIN_SNAPSHOT_FILTERS_LEAVES;
-    if ((data.flags & VIR_DOMAIN_SNAPSHOT_FILTERS_STATUS) ==
+        data->flags &= ~VIR_DOMAIN_SNAPSHOT_FILTERS_LEAVES;
+    if ((data->flags & VIR_DOMAIN_SNAPSHOT_FILTERS_STATUS) ==
         VIR_DOMAIN_SNAPSHOT_FILTERS_STATUS)
-        data.flags &= ~VIR_DOMAIN_SNAPSHOT_FILTERS_STATUS;
-    if ((data.flags & VIR_DOMAIN_SNAPSHOT_FILTERS_LOCATION) ==
+        data->flags &= ~VIR_DOMAIN_SNAPSHOT_FILTERS_STATUS;
+    if ((data->flags & VIR_DOMAIN_SNAPSHOT_FILTERS_LOCATION) ==
         VIR_DOMAIN_SNAPSHOT_FILTERS_LOCATION)
-        data.flags &= ~VIR_DOMAIN_SNAPSHOT_FILTERS_LOCATION;
+        data->flags &= ~VIR_DOMAIN_SNAPSHOT_FILTERS_LOCATION;
 
     if (flags & VIR_DOMAIN_SNAPSHOT_LIST_DESCENDANTS) {
         if (from->def)
             virDomainSnapshotForEachDescendant(from,
                                                virDomainSnapshotObjListCopyNames,
-                                               &data);
-        else if (names || data.flags)
+                                               data);
+        else if (data->names || data->dom || data->flags)
             virHashForEach(snapshots->objs, virDomainSnapshotObjListCopyNames,
-                           &data);
+                           data);
         else
-            data.count = virHashSize(snapshots->objs);
-    } else if (names || data.flags) {
+            data->count = virHashSize(snapshots->objs);
+    } else if (data->names || data->dom || data->flags) {
         virDomainSnapshotForEachChild(from,
-                                      virDomainSnapshotObjListCopyNames, &data);
+                                      virDomainSnapshotObjListCopyNames, data);
     } else {
-        data.count = from->nchildren;
+        data->count = from->nchildren;
     }
+}
+
+int
+virDomainSnapshotObjListGetNames(virDomainSnapshotObjListPtr snapshots,
+                                 virDomainSnapshotObjPtr from,
+                                 char **const names, int maxnames,
+                                 unsigned int flags)
+{
+    struct virDomainSnapshotNameData data = { names, maxnames, flags, 0,
+                                              false, NULL, NULL, 0 };
+    size_t i;
+
+    virDomainSnapshotObjListTraverse(snapshots, from, flags, &data);
 
     if (data.error) {
         for (i = 0; i < data.count; i++)
@@ -1136,38 +1162,29 @@ virDomainListSnapshots(virDomainSnapshotObjListPtr snapshots,
                        virDomainSnapshotPtr **snaps,
                        unsigned int flags)
 {
-    int count = virDomainSnapshotObjListNum(snapshots, from, flags);
-    virDomainSnapshotPtr *list = NULL;
-    char **names;
-    int ret = -1;
+    struct virDomainSnapshotNameData data = { NULL, 0, flags, 0,
+                                              false, dom, NULL, 0 };
     size_t i;
 
-    if (!snaps || count < 0)
-        return count;
-    if (VIR_ALLOC_N(names, count) < 0 ||
-        VIR_ALLOC_N(list, count + 1) < 0)
-        goto cleanup;
+    if (!snaps)
+        return virDomainSnapshotObjListNum(snapshots, from, flags);
 
-    if (virDomainSnapshotObjListGetNames(snapshots, from, names, count,
-                                         flags) < 0)
-        goto cleanup;
-    for (i = 0; i < count; i++)
-        if ((list[i] = virGetDomainSnapshot(dom, names[i])) == NULL)
-            goto cleanup;
+    /* Serialize the matching snapshot objects in a single walk of
+     * the tree, rather than counting, listing names and looking
+     * each name up again */
+    virDomainSnapshotObjListTraverse(snapshots, from, flags, &data);
 
-    ret = count;
-    *snaps = list;
-
- cleanup:
-    for (i = 0; i < count; i++)
-        VIR_FREE(names[i]);
-    VIR_FREE(names);
-    if (ret < 0 && list) {
-        for (i = 0; i < count; i++)
-            virObjectUnref(list[i]);
-        VIR_FREE(list);
+    /* NULL terminate the returned array */
+    if (data.error ||
+        VIR_EXPAND_N(data.snaps, data.nsnaps, 1) < 0) {
+        for (i = 0; i < data.nsnaps; i++)
+            virObjectUnref(data.snaps[i]);
+        VIR_FREE(data.snaps);
+        return -1;
     }
-    return ret;
+
+    *snaps = data.snaps;
+    return data.count;
 }
 
 
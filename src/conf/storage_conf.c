@@ -1826,6 +1826,7 @@ virStoragePoolObjAssignDef(virStoragePoolObjListPtr pools,
     }
     virStoragePoolObjLock(pool);
     pool->active = 0;
+    pool->dirWatch = -1;
 
     if (VIR_APPEND_ELEMENT_COPY(pools->objs, pools->count, pool) < 0) {
         virStoragePoolObjUnlock(pool);
@@ -1845,6 +1846,27 @@ virStoragePoolObjLoad(virStoragePoolObjListPtr pools,
 {
     virStoragePoolDefPtr def;
     virStoragePoolObjPtr pool;
+    struct stat sb;
+    size_t i;
+
+    if (stat(path, &sb) < 0) {
+        virReportSystemError(errno, _("cannot stat '%s'"), path);
+        return NULL;
+    }
+
+    /* Reloads walk every config in the directory; reuse the existing
+     * object when the file has not changed since it was last parsed */
+    for (i = 0; i < pools->count; i++) {
+        virStoragePoolObjLock(pools->objs[i]);
+        if (STREQ_NULLABLE(pools->objs[i]->configFile, path) &&
+            pools->objs[i]->configMtime == sb.st_mtime) {
+            pool = pools->objs[i];
+            pool->autostart = virFileLinkPointsTo(autostartLink,
+                                                  pool->configFile);
+            return pool;
+        }
+        virStoragePoolObjUnlock(pools->objs[i]);
+    }
 
     if (!(def = virStoragePoolDefParseFile(path)))
         return NULL;
@@ -1874,6 +1896,7 @@ virStoragePoolObjLoad(virStoragePoolObjListPtr pools,
         return NULL;
     }
 
+    pool->configMtime = sb.st_mtime;
     pool->autostart = virFileLinkPointsTo(pool->autostartLink,
                                           pool->configFile);
 
@@ -268,10 +268,16 @@ struct _virStoragePoolObj {
 
     char *configFile;
     char *autostartLink;
+    time_t configMtime; /* mtime of configFile when it was last parsed */
     bool active;
     int autostart;
     unsigned int asyncjobs;
 
+    /* Directory change watch state, managed by the filesystem
+     * backend to avoid re-scanning unchanged pools on refresh */
+    int dirWatch;               /* inotify watch descriptor or -1 */
+    unsigned long long dirWatchGen; /* overflow generation at arm time */
+
     virStoragePoolDefPtr def;
     virStoragePoolDefPtr newDef;
 
@@ -367,12 +367,24 @@ int virChrdevOpen(virChrdevsPtr devs,
         return -1;
     }
 
+    /* prepare the callback data up front, so the critical section
+     * below only covers the hash and lock file wiring */
+    if (VIR_ALLOC(cbdata) < 0)
+        return -1;
+
+    cbdata->devs = devs;
+    if (VIR_STRDUP(cbdata->path, path) < 0) {
+        VIR_FREE(cbdata);
+        return -1;
+    }
+
     virMutexLock(&devs->lock);
 
     if ((savedStream = virHashLookup(devs->hash, path))) {
         if (!force) {
              /* entry found, device is busy */
             virMutexUnlock(&devs->lock);
+            virChrdevFDStreamCloseCbFree(cbdata);
             return 1;
        } else {
            /* terminate existing connection */
@@ -392,26 +404,21 @@ int virChrdevOpen(virChrdevsPtr devs,
     /* create the lock file */
     if ((ret = virChrdevLockFileCreate(path)) < 0) {
         virMutexUnlock(&devs->lock);
+        virChrdevFDStreamCloseCbFree(cbdata);
         return ret;
     }
 
     /* obtain a reference to the stream */
     if (virStreamRef(st) < 0) {
         virMutexUnlock(&devs->lock);
+        virChrdevFDStreamCloseCbFree(cbdata);
         return -1;
     }
 
-    if (VIR_ALLOC(cbdata) < 0)
-        goto error;
-
     if (virHashAddEntry(devs->hash, path, st) < 0)
         goto error;
     added = true;
 
-    cbdata->devs = devs;
-    if (VIR_STRDUP(cbdata->path, path) < 0)
-        goto error;
-
     /* open the character device */
     switch (source->type) {
     case VIR_DOMAIN_CHR_TYPE_PTY:
@@ -444,9 +451,7 @@ int virChrdevOpen(virChrdevsPtr devs,
     else
         virObjectUnref(st);
 
-    if (cbdata)
-        VIR_FREE(cbdata->path);
-    VIR_FREE(cbdata);
+    virChrdevFDStreamCloseCbFree(cbdata);
     virMutexUnlock(&devs->lock);
     return -1;
 }
@@ -42,7 +42,7 @@ static void virDomainObjListDispose(void *obj);
 
 
 struct _virDomainObjList {
-    virObjectLockable parent;
+    virObjectRWLockable parent;
 
     /* uuid string -> virDomainObj  mapping
      * for O(1), lockless lookup-by-uuid */
@@ -51,12 +51,20 @@ struct _virDomainObjList {
     /* name -> virDomainObj mapping for O(1),
      * lockless lookup-by-name */
     virHashTable *objsName;
+
+    /* immutable array of object references served to
+     * virDomainObjListCollect, rebuilt lazily whenever @generation
+     * shows the list membership changed since the last rebuild */
+    virDomainObjPtr *snap;
+    size_t nsnap;
+    unsigned long long generation;
+    unsigned long long snapGeneration;
 };
 
 
 static int virDomainObjListOnceInit(void)
 {
-    if (!(virDomainObjListClass = virClassNew(virClassForObjectLockable(),
+    if (!(virDomainObjListClass = virClassNew(virClassForObjectRWLockable(),
                                               "virDomainObjList",
                                               sizeof(virDomainObjList),
                                               virDomainObjListDispose)))
@@ -74,7 +82,7 @@ virDomainObjListPtr virDomainObjListNew(void)
     if (virDomainObjListInitialize() < 0)
         return NULL;
 
-    if (!(doms = virObjectLockableNew(virDomainObjListClass)))
+    if (!(doms = virObjectRWLockableNew(virDomainObjListClass)))
         return NULL;
 
     if (!(doms->objs = virHashCreate(50, virObjectFreeHashData)) ||
@@ -91,11 +99,21 @@ static void virDomainObjListDispose(void *obj)
 {
     virDomainObjListPtr doms = obj;
 
+    virObjectListFreeCount(doms->snap, doms->nsnap);
     virHashFree(doms->objs);
     virHashFree(doms->objsName);
 }
 
 
+/* Record a list membership change so that the next collection rebuilds
+ * the snapshot.  The caller must hold a write lock on @doms. */
+static void
+virDomainObjListChanged(virDomainObjListPtr doms)
+{
+    doms->generation++;
+}
+
+
 static int virDomainObjListSearchID(const void *payload,
                                     const void *name ATTRIBUTE_UNUSED,
                                     const void *data)
@@ -118,11 +136,11 @@ virDomainObjListFindByIDInternal(virDomainObjListPtr doms,
                                  bool ref)
 {
     virDomainObjPtr obj;
-    virObjectLock(doms);
+    virObjectRWLockRead(doms);
     obj = virHashSearch(doms->objs, virDomainObjListSearchID, &id);
     if (ref) {
         virObjectRef(obj);
-        virObjectUnlock(doms);
+        virObjectRWUnlock(doms);
     }
     if (obj) {
         virObjectLock(obj);
@@ -134,7 +152,7 @@ virDomainObjListFindByIDInternal(virDomainObjListPtr doms,
         }
     }
     if (!ref)
-        virObjectUnlock(doms);
+        virObjectRWUnlock(doms);
     return obj;
 }
 
@@ -160,13 +178,13 @@ virDomainObjListFindByUUIDInternal(virDomainObjListPtr doms,
     char uuidstr[VIR_UUID_STRING_BUFLEN];
     virDomainObjPtr obj;
 
-    virObjectLock(doms);
+    virObjectRWLockRead(doms);
     virUUIDFormat(uuid, uuidstr);
 
     obj = virHashLookup(doms->objs, uuidstr);
     if (ref) {
         virObjectRef(obj);
-        virObjectUnlock(doms);
+        virObjectRWUnlock(doms);
     }
     if (obj) {
         virObjectLock(obj);
@@ -178,7 +196,7 @@ virDomainObjListFindByUUIDInternal(virDomainObjListPtr doms,
         }
     }
     if (!ref)
-        virObjectUnlock(doms);
+        virObjectRWUnlock(doms);
     return obj;
 }
 
@@ -204,10 +222,10 @@ virDomainObjPtr virDomainObjListFindByName(virDomainObjListPtr doms,
 {
     virDomainObjPtr obj;
 
-    virObjectLock(doms);
+    virObjectRWLockRead(doms);
     obj = virHashLookup(doms->objsName, name);
     virObjectRef(obj);
-    virObjectUnlock(doms);
+    virObjectRWUnlock(doms);
     if (obj) {
         virObjectLock(obj);
         if (obj->removing) {
@@ -308,6 +326,8 @@ virDomainObjListAddLocked(virDomainObjListPtr doms,
         /* Since domain is in two hash tables, increment the
          * reference counter */
         virObjectRef(vm);
+
+        virDomainObjListChanged(doms);
     }
  cleanup:
     return vm;
@@ -327,9 +347,9 @@ virDomainObjPtr virDomainObjListAdd(virDomainObjListPtr doms,
 {
     virDomainObjPtr ret;
 
-    virObjectLock(doms);
+    virObjectRWLockWrite(doms);
     ret = virDomainObjListAddLocked(doms, def, xmlopt, flags, oldDef);
-    virObjectUnlock(doms);
+    virObjectRWUnlock(doms);
     return ret;
 }
 
@@ -349,13 +369,14 @@ void virDomainObjListRemove(virDomainObjListPtr doms,
     virObjectRef(dom);
     virObjectUnlock(dom);
 
-    virObjectLock(doms);
+    virObjectRWLockWrite(doms);
     virObjectLock(dom);
     virHashRemoveEntry(doms->objs, uuidstr);
     virHashRemoveEntry(doms->objsName, dom->def->name);
+    virDomainObjListChanged(doms);
     virObjectUnlock(dom);
     virObjectUnref(dom);
-    virObjectUnlock(doms);
+    virObjectRWUnlock(doms);
 }
 
 
@@ -394,7 +415,7 @@ virDomainObjListRename(virDomainObjListPtr doms,
      * hold a lock on dom but not refcount it. */
     virObjectRef(dom);
     virObjectUnlock(dom);
-    virObjectLock(doms);
+    virObjectRWLockWrite(doms);
     virObjectLock(dom);
     virObjectUnref(dom);
 
@@ -420,7 +441,7 @@ virDomainObjListRename(virDomainObjListPtr doms,
 
     ret = 0;
  cleanup:
-    virObjectUnlock(doms);
+    virObjectRWUnlock(doms);
     VIR_FREE(old_name);
     return ret;
 }
@@ -440,6 +461,7 @@ void virDomainObjListRemoveLocked(virDomainObjListPtr doms,
 
     virHashRemoveEntry(doms->objs, uuidstr);
     virHashRemoveEntry(doms->objsName, dom->def->name);
+    virDomainObjListChanged(doms);
     virObjectUnlock(dom);
 }
 
@@ -474,14 +496,22 @@ virDomainObjListLoadConfig(virDomainObjListPtr doms,
     if ((autostart = virFileLinkPointsTo(autostartLink, configFile)) < 0)
         goto error;
 
-    if (!(dom = virDomainObjListAddLocked(doms, def, xmlopt, 0, &oldDef)))
+    /* Parsing the def above is by far the most expensive part of
+     * loading a config, so the list is only write locked for the
+     * actual insertion */
+    virObjectRWLockWrite(doms);
+    if (!(dom = virDomainObjListAddLocked(doms, def, xmlopt, 0, &oldDef))) {
+        virObjectRWUnlock(doms);
         goto error;
+    }
 
     dom->autostart = autostart;
 
     if (notify)
         (*notify)(dom, oldDef == NULL, opaque);
 
+    virObjectRWUnlock(doms);
+
     virDomainDefFree(oldDef);
     VIR_FREE(configFile);
     VIR_FREE(autostartLink);
@@ -521,31 +551,39 @@ virDomainObjListLoadStatus(virDomainObjListPtr doms,
 
     virUUIDFormat(obj->def->uuid, uuidstr);
 
+    virObjectRWLockWrite(doms);
+
     if (virHashLookup(doms->objs, uuidstr) != NULL) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("unexpected domain %s already exists"),
                        obj->def->name);
-        goto error;
+        goto error_locked;
     }
 
     if (virHashAddEntry(doms->objs, uuidstr, obj) < 0)
-        goto error;
+        goto error_locked;
 
     if (virHashAddEntry(doms->objsName, obj->def->name, obj) < 0) {
         virHashRemoveEntry(doms->objs, uuidstr);
-        goto error;
+        goto error_locked;
     }
 
     /* Since domain is in two hash tables, increment the
      * reference counter */
     virObjectRef(obj);
 
+    virDomainObjListChanged(doms);
+
     if (notify)
         (*notify)(obj, 1, opaque);
 
+    virObjectRWUnlock(doms);
+
     VIR_FREE(statusFile);
     return obj;
 
+ error_locked:
+    virObjectRWUnlock(doms);
  error:
     virObjectUnref(obj);
     VIR_FREE(statusFile);
@@ -573,8 +611,9 @@ virDomainObjListLoadAllConfigs(virDomainObjListPtr doms,
     if ((rc = virDirOpenIfExists(&dir, configDir)) <= 0)
         return rc;
 
-    virObjectLock(doms);
-
+    /* The helpers take the list lock themselves around the list
+     * insertion only, so the XML parsing of hundreds of configs
+     * does not lock out concurrent lookups for its full duration */
     while ((ret = virDirRead(dir, &entry, configDir)) > 0) {
         virDomainObjPtr dom;
 
@@ -609,7 +648,6 @@ virDomainObjListLoadAllConfigs(virDomainObjListPtr doms,
     }
 
     VIR_DIR_CLOSE(dir);
-    virObjectUnlock(doms);
     return ret;
 }
 
@@ -653,9 +691,9 @@ virDomainObjListNumOfDomains(virDomainObjListPtr doms,
                              virConnectPtr conn)
 {
     struct virDomainObjListData data = { filter, conn, active, 0 };
-    virObjectLock(doms);
+    virObjectRWLockRead(doms);
     virHashForEach(doms->objs, virDomainObjListCount, &data);
-    virObjectUnlock(doms);
+    virObjectRWUnlock(doms);
     return data.count;
 }
 
@@ -697,9 +735,9 @@ virDomainObjListGetActiveIDs(virDomainObjListPtr doms,
 {
     struct virDomainIDData data = { filter, conn,
                                     0, maxids, ids };
-    virObjectLock(doms);
+    virObjectRWLockRead(doms);
     virHashForEach(doms->objs, virDomainObjListCopyActiveIDs, &data);
-    virObjectUnlock(doms);
+    virObjectRWUnlock(doms);
     return data.numids;
 }
 
@@ -751,9 +789,9 @@ virDomainObjListGetInactiveNames(virDomainObjListPtr doms,
     struct virDomainNameData data = { filter, conn,
                                       0, 0, maxnames, names };
     size_t i;
-    virObjectLock(doms);
+    virObjectRWLockRead(doms);
     virHashForEach(doms->objs, virDomainObjListCopyInactiveNames, &data);
-    virObjectUnlock(doms);
+    virObjectRWUnlock(doms);
     if (data.oom) {
         for (i = 0; i < data.numnames; i++)
             VIR_FREE(data.names[i]);
@@ -792,9 +830,9 @@ virDomainObjListForEach(virDomainObjListPtr doms,
     struct virDomainListIterData data = {
         callback, opaque, 0,
     };
-    virObjectLock(doms);
+    virObjectRWLockWrite(doms);
     virHashForEach(doms->objs, virDomainObjListHelper, &data);
-    virObjectUnlock(doms);
+    virObjectRWUnlock(doms);
     return data.ret;
 }
 
@@ -915,6 +953,34 @@ virDomainObjListFilter(virDomainObjPtr **list,
 }
 
 
+/* Rebuild the snapshot array after a membership change.  The caller
+ * must hold a write lock on @domlist. */
+static int
+virDomainObjListSnapUpdate(virDomainObjListPtr domlist)
+{
+    struct virDomainListData data = { NULL, 0 };
+
+    if (domlist->snapGeneration == domlist->generation)
+        return 0;
+
+    virObjectListFreeCount(domlist->snap, domlist->nsnap);
+    domlist->snap = NULL;
+    domlist->nsnap = 0;
+
+    sa_assert(domlist->objs);
+    if (VIR_ALLOC_N(data.vms, virHashSize(domlist->objs)) < 0)
+        return -1;
+
+    virHashForEach(domlist->objs, virDomainObjListCollectIterator, &data);
+
+    domlist->snap = data.vms;
+    domlist->nsnap = data.nvms;
+    domlist->snapGeneration = domlist->generation;
+
+    return 0;
+}
+
+
 int
 virDomainObjListCollect(virDomainObjListPtr domlist,
                         virConnectPtr conn,
@@ -923,22 +989,41 @@ virDomainObjListCollect(virDomainObjListPtr domlist,
                         virDomainObjListACLFilter filter,
                         unsigned int flags)
 {
-    struct virDomainListData data = { NULL, 0 };
+    virDomainObjPtr *list = NULL;
+    size_t nlist;
+    size_t i;
 
-    virObjectLock(domlist);
-    sa_assert(domlist->objs);
-    if (VIR_ALLOC_N(data.vms, virHashSize(domlist->objs)) < 0) {
-        virObjectUnlock(domlist);
+    virObjectRWLockRead(domlist);
+    if (domlist->snapGeneration != domlist->generation) {
+        /* The snapshot is stale, upgrade to a write lock and rebuild.
+         * The membership may change again in between, so the rebuild
+         * rechecks the generation under the write lock. */
+        virObjectRWUnlock(domlist);
+        virObjectRWLockWrite(domlist);
+
+        if (virDomainObjListSnapUpdate(domlist) < 0) {
+            virObjectRWUnlock(domlist);
+            return -1;
+        }
+    }
+
+    /* Grabbing references from the prebuilt snapshot doesn't touch any
+     * per-domain lock, so listing can't stall behind a busy domain here */
+    nlist = domlist->nsnap;
+    if (VIR_ALLOC_N(list, nlist) < 0) {
+        virObjectRWUnlock(domlist);
         return -1;
     }
 
-    virHashForEach(domlist->objs, virDomainObjListCollectIterator, &data);
-    virObjectUnlock(domlist);
+    for (i = 0; i < nlist; i++)
+        list[i] = virObjectRef(domlist->snap[i]);
+
+    virObjectRWUnlock(domlist);
 
-    virDomainObjListFilter(&data.vms, &data.nvms, conn, filter, flags);
+    virDomainObjListFilter(&list, &nlist, conn, filter, flags);
 
-    *nvms = data.nvms;
-    *vms = data.vms;
+    *nvms = nlist;
+    *vms = list;
 
     return 0;
 }
@@ -962,7 +1047,7 @@ virDomainObjListConvert(virDomainObjListPtr domlist,
     *nvms = 0;
     *vms = NULL;
 
-    virObjectLock(domlist);
+    virObjectRWLockRead(domlist);
     for (i = 0; i < ndoms; i++) {
         virDomainPtr dom = doms[i];
 
@@ -972,7 +1057,7 @@ virDomainObjListConvert(virDomainObjListPtr domlist,
             if (skip_missing)
                 continue;
 
-            virObjectUnlock(domlist);
+            virObjectRWUnlock(domlist);
             virReportError(VIR_ERR_NO_DOMAIN,
                            _("no domain with matching uuid '%s' (%s)"),
                            uuidstr, dom->name);
@@ -982,12 +1067,12 @@ virDomainObjListConvert(virDomainObjListPtr domlist,
         virObjectRef(vm);
 
         if (VIR_APPEND_ELEMENT(*vms, *nvms, vm) < 0) {
-            virObjectUnlock(domlist);
+            virObjectRWUnlock(domlist);
             virObjectUnref(vm);
             goto error;
         }
     }
-    virObjectUnlock(domlist);
+    virObjectRWUnlock(domlist);
 
     sa_assert(*vms);
     virDomainObjListFilter(vms, nvms, conn, filter, flags);
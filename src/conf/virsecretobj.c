@@ -22,6 +22,9 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#ifdef HAVE_MLOCK
+# include <sys/mman.h>
+#endif
 
 #include "datatypes.h"
 #include "virsecretobj.h"
@@ -133,6 +136,37 @@ virSecretObjListNew(void)
 }
 
 
+#ifdef HAVE_MLOCK
+/* Secret values live in the daemon for its whole lifetime; keep the
+ * pages holding them out of swap. Failure (e.g. RLIMIT_MEMLOCK) is
+ * not fatal, the value merely loses that extra protection */
+static void
+virSecretValueLock(unsigned char *value, size_t value_size)
+{
+    if (mlock(value, value_size) < 0)
+        VIR_DEBUG("unable to lock secret value in memory: %d", errno);
+}
+
+static void
+virSecretValueUnlock(unsigned char *value, size_t value_size)
+{
+    ignore_value(munlock(value, value_size));
+}
+#else /* !HAVE_MLOCK */
+static void
+virSecretValueLock(unsigned char *value ATTRIBUTE_UNUSED,
+                   size_t value_size ATTRIBUTE_UNUSED)
+{
+}
+
+static void
+virSecretValueUnlock(unsigned char *value ATTRIBUTE_UNUSED,
+                     size_t value_size ATTRIBUTE_UNUSED)
+{
+}
+#endif /* !HAVE_MLOCK */
+
+
 static void
 virSecretObjDispose(void *obj)
 {
@@ -141,6 +175,7 @@ virSecretObjDispose(void *obj)
     virSecretDefFree(secret->def);
     if (secret->value) {
         /* Wipe before free to ensure we don't leave a secret on the heap */
+        virSecretValueUnlock(secret->value, secret->value_size);
         memset(secret->value, 0, secret->value_size);
         VIR_FREE(secret->value);
     }
@@ -787,6 +822,7 @@ virSecretObjSetValue(virSecretObjPtr secret,
     old_value_size = secret->value_size;
 
     memcpy(new_value, value, value_size);
+    virSecretValueLock(new_value, value_size);
     secret->value = new_value;
     secret->value_size = value_size;
 
@@ -795,6 +831,7 @@ virSecretObjSetValue(virSecretObjPtr secret,
 
     /* Saved successfully - drop old value */
     if (old_value) {
+        virSecretValueUnlock(old_value, old_value_size);
         memset(old_value, 0, old_value_size);
         VIR_FREE(old_value);
     }
@@ -805,6 +842,7 @@ virSecretObjSetValue(virSecretObjPtr secret,
     /* Error - restore previous state and free new value */
     secret->value = old_value;
     secret->value_size = old_value_size;
+    virSecretValueUnlock(new_value, value_size);
     memset(new_value, 0, value_size);
     VIR_FREE(new_value);
     return -1;
@@ -899,6 +937,7 @@ virSecretLoadValue(virSecretObjPtr secret)
     secret->value = (unsigned char *)value;
     value = NULL;
     secret->value_size = value_size;
+    virSecretValueLock(secret->value, secret->value_size);
 
     ret = 0;
 
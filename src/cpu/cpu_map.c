@@ -25,6 +25,8 @@
 
 #include "viralloc.h"
 #include "virfile.h"
+#include "virthread.h"
+#include "virxml.h"
 #include "cpu.h"
 #include "cpu_map.h"
 #include "configmake.h"
@@ -35,6 +37,30 @@
 
 VIR_LOG_INIT("cpu.cpu_map");
 
+/* The parsed map document is cached for the whole process lifetime
+ * after the first load, mirroring the per-arch CPU driver maps built
+ * from it; every subsequent cpuMapLoad only pays for the XPath walk
+ * of its architecture's subtree */
+static virOnceControl cpuMapOnce = VIR_ONCE_CONTROL_INITIALIZER;
+static xmlDocPtr cpuMapDoc;
+
+static void
+cpuMapLoadOnce(void)
+{
+    char *mapfile;
+
+    if (!(mapfile = virFileFindResource("cpu_map.xml",
+                                        abs_topsrcdir "/src/cpu",
+                                        PKGDATADIR)))
+        return;
+
+    VIR_DEBUG("Loading CPU map from %s", mapfile);
+
+    cpuMapDoc = virXMLParseFile(mapfile);
+
+    VIR_FREE(mapfile);
+}
+
 VIR_ENUM_IMPL(cpuMapElement, CPU_MAP_ELEMENT_LAST,
     "vendor",
     "feature",
@@ -75,20 +101,11 @@ int cpuMapLoad(const char *arch,
                cpuMapLoadCallback cb,
                void *data)
 {
-    xmlDocPtr xml = NULL;
     xmlXPathContextPtr ctxt = NULL;
     virBuffer buf = VIR_BUFFER_INITIALIZER;
     char *xpath = NULL;
     int ret = -1;
     int element;
-    char *mapfile;
-
-    if (!(mapfile = virFileFindResource("cpu_map.xml",
-                                        abs_topsrcdir "/src/cpu",
-                                        PKGDATADIR)))
-        return -1;
-
-    VIR_DEBUG("Loading CPU map from %s", mapfile);
 
     if (arch == NULL) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
@@ -102,8 +119,18 @@ int cpuMapLoad(const char *arch,
         goto cleanup;
     }
 
-    if (!(xml = virXMLParseFileCtxt(mapfile, &ctxt)))
+    if (virOnce(&cpuMapOnce, cpuMapLoadOnce) < 0 || !cpuMapDoc) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "%s", _("cannot load CPU map"));
+        goto cleanup;
+    }
+
+    /* the cached document is read-only shared state, so each caller
+     * gets its own XPath context */
+    if (!(ctxt = xmlXPathNewContext(cpuMapDoc))) {
+        virReportOOMError();
         goto cleanup;
+    }
 
     virBufferAsprintf(&buf, "./arch[@name='%s']", arch);
     if (virBufferCheckError(&buf) < 0)
@@ -111,7 +138,7 @@ int cpuMapLoad(const char *arch,
 
     xpath = virBufferContentAndReset(&buf);
 
-    ctxt->node = xmlDocGetRootElement(xml);
+    ctxt->node = xmlDocGetRootElement(cpuMapDoc);
 
     if ((ctxt->node = virXPathNode(xpath, ctxt)) == NULL) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
@@ -131,9 +158,7 @@ int cpuMapLoad(const char *arch,
 
  cleanup:
     xmlXPathFreeContext(ctxt);
-    xmlFreeDoc(xml);
     VIR_FREE(xpath);
-    VIR_FREE(mapfile);
 
     return ret;
 }
@@ -282,12 +282,22 @@ static virCPUx86CPUID *
 x86DataCpuid(const virCPUx86Data *data,
              const virCPUx86CPUID *cpuid)
 {
-    size_t i;
+    size_t lo = 0;
+    size_t hi = data->len;
+
+    /* the array is kept sorted by (eax_in, ecx_in),
+     * see virCPUx86DataAddCPUID */
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = virCPUx86CPUIDSorter(data->data + mid, cpuid);
+
+        if (cmp == 0)
+            return data->data + mid;
 
-    for (i = 0; i < data->len; i++) {
-        if (data->data[i].eax_in == cpuid->eax_in &&
-            data->data[i].ecx_in == cpuid->ecx_in)
-            return data->data + i;
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
 
     return NULL;
@@ -1128,35 +1138,51 @@ x86ModelCompare(virCPUx86ModelPtr model1,
                 virCPUx86ModelPtr model2)
 {
     virCPUx86CompareResult result = EQUAL;
-    virCPUx86DataIterator iter1 = virCPUx86DataIteratorInit(&model1->data);
-    virCPUx86DataIterator iter2 = virCPUx86DataIteratorInit(&model2->data);
-    virCPUx86CPUID *cpuid1;
-    virCPUx86CPUID *cpuid2;
-
-    while ((cpuid1 = x86DataCpuidNext(&iter1))) {
-        virCPUx86CompareResult match = SUPERSET;
-
-        if ((cpuid2 = x86DataCpuid(&model2->data, cpuid1))) {
-            if (x86cpuidMatch(cpuid1, cpuid2))
-                continue;
-            else if (!x86cpuidMatchMasked(cpuid1, cpuid2))
-                match = SUBSET;
-        }
+    size_t i = 0;
+    size_t j = 0;
+
+    /* Both data arrays are sorted by (eax_in, ecx_in), so a single
+     * merge walk classifies every leaf with a few mask operations
+     * instead of a nested lookup per leaf */
+    while (i < model1->data.len || j < model2->data.len) {
+        virCPUx86CPUID *cpuid1 = NULL;
+        virCPUx86CPUID *cpuid2 = NULL;
+        virCPUx86CompareResult match;
+        int cmp;
+
+        if (i == model1->data.len)
+            cmp = 1;
+        else if (j == model2->data.len)
+            cmp = -1;
+        else
+            cmp = virCPUx86CPUIDSorter(model1->data.data + i,
+                                       model2->data.data + j);
 
-        if (result == EQUAL)
-            result = match;
-        else if (result != match)
-            return UNRELATED;
-    }
+        if (cmp <= 0)
+            cpuid1 = model1->data.data + i++;
+        if (cmp >= 0)
+            cpuid2 = model2->data.data + j++;
 
-    while ((cpuid2 = x86DataCpuidNext(&iter2))) {
-        virCPUx86CompareResult match = SUBSET;
+        if (!cpuid1 || x86cpuidMatch(cpuid1, &cpuidNull))
+            cpuid1 = NULL;
+        if (!cpuid2 || x86cpuidMatch(cpuid2, &cpuidNull))
+            cpuid2 = NULL;
 
-        if ((cpuid1 = x86DataCpuid(&model1->data, cpuid2))) {
-            if (x86cpuidMatch(cpuid2, cpuid1))
+        if (cpuid1 && cpuid2) {
+            if (x86cpuidMatch(cpuid1, cpuid2))
                 continue;
-            else if (!x86cpuidMatchMasked(cpuid2, cpuid1))
+            else if (x86cpuidMatchMasked(cpuid1, cpuid2))
                 match = SUPERSET;
+            else if (x86cpuidMatchMasked(cpuid2, cpuid1))
+                match = SUBSET;
+            else
+                return UNRELATED;
+        } else if (cpuid1) {
+            match = SUPERSET;
+        } else if (cpuid2) {
+            match = SUBSET;
+        } else {
+            continue;
         }
 
         if (result == EQUAL)
@@ -166,6 +166,34 @@ esxVI_CURL_WriteBuffer(char *data, size_t size, size_t nmemb, void *userdata)
     return 0;
 }
 
+/*
+ * Streams a SOAP response into a libxml2 push parser as the data
+ * arrives, so the document tree is built while the transfer is still
+ * in progress and the raw text never has to be buffered in full.
+ * The parser context is created lazily on the first chunk; returning
+ * less than the received size makes CURL abort the transfer.
+ */
+static size_t
+esxVI_CURL_WriteDocument(char *data, size_t size, size_t nmemb, void *userdata)
+{
+    xmlParserCtxtPtr *parser = userdata;
+
+    if (!*parser) {
+        *parser = xmlCreatePushParserCtxt(NULL, NULL, NULL, 0,
+                                          "(esx execute response)");
+
+        if (!*parser)
+            return 0;
+
+        xmlCtxtUseOptions(*parser, XML_PARSE_NONET | XML_PARSE_NOWARNING);
+    }
+
+    if (xmlParseChunk(*parser, data, (int)(size * nmemb), 0) != 0)
+        return 0;
+
+    return size * nmemb;
+}
+
 #define ESX_VI__CURL__ENABLE_DEBUG_OUTPUT 0
 
 #if ESX_VI__CURL__ENABLE_DEBUG_OUTPUT
@@ -968,6 +996,9 @@ ESX_VI__TEMPLATE__FREE(Context,
     if (item->sessionLock)
         virMutexDestroy(item->sessionLock);
 
+    if (item->vmMirrorLock)
+        virMutexDestroy(item->vmMirrorLock);
+
     esxVI_CURL_Free(&item->curl);
     VIR_FREE(item->url);
     VIR_FREE(item->ipAddress);
@@ -989,6 +1020,10 @@ ESX_VI__TEMPLATE__FREE(Context,
     esxVI_SelectionSpec_Free(&item->selectSet_computeResourceToHost);
     esxVI_SelectionSpec_Free(&item->selectSet_computeResourceToParentToParent);
     esxVI_SelectionSpec_Free(&item->selectSet_datacenterToNetwork);
+    VIR_FREE(item->vmMirrorLock);
+    esxVI_ManagedObjectReference_Free(&item->vmMirrorFilter);
+    VIR_FREE(item->vmMirrorVersion);
+    esxVI_ObjectContent_Free(&item->vmMirror);
 })
 
 int
@@ -1032,6 +1067,15 @@ esxVI_Context_Connect(esxVI_Context *ctx, const char *url,
         goto cleanup;
     }
 
+    if (VIR_ALLOC(ctx->vmMirrorLock) < 0)
+        goto cleanup;
+
+    if (virMutexInit(ctx->vmMirrorLock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Could not initialize virtual machine mirror mutex"));
+        goto cleanup;
+    }
+
     if (esxVI_RetrieveServiceContent(ctx, &ctx->service) < 0)
         goto cleanup;
 
@@ -1415,7 +1459,7 @@ esxVI_Context_Execute(esxVI_Context *ctx, const char *methodName,
                       esxVI_Occurrence occurrence)
 {
     int result = -1;
-    virBuffer buffer = VIR_BUFFER_INITIALIZER;
+    xmlParserCtxtPtr parser = NULL;
     esxVI_Fault *fault = NULL;
     char *xpathExpression = NULL;
     xmlXPathContextPtr xpathContext = NULL;
@@ -1433,30 +1477,43 @@ esxVI_Context_Execute(esxVI_Context *ctx, const char *methodName,
 
     curl_easy_setopt(ctx->curl->handle, CURLOPT_URL, ctx->url);
     curl_easy_setopt(ctx->curl->handle, CURLOPT_RANGE, NULL);
-    curl_easy_setopt(ctx->curl->handle, CURLOPT_WRITEDATA, &buffer);
+    curl_easy_setopt(ctx->curl->handle, CURLOPT_WRITEFUNCTION,
+                     esxVI_CURL_WriteDocument);
+    curl_easy_setopt(ctx->curl->handle, CURLOPT_WRITEDATA, &parser);
     curl_easy_setopt(ctx->curl->handle, CURLOPT_UPLOAD, 0);
     curl_easy_setopt(ctx->curl->handle, CURLOPT_POSTFIELDS, request);
     curl_easy_setopt(ctx->curl->handle, CURLOPT_POSTFIELDSIZE, strlen(request));
 
     (*response)->responseCode = esxVI_CURL_Perform(ctx->curl, ctx->url);
 
+    /* Restore the buffering write function, the handle is shared
+     * with the VMX/VMDK download and upload paths */
+    curl_easy_setopt(ctx->curl->handle, CURLOPT_WRITEFUNCTION,
+                     esxVI_CURL_WriteBuffer);
+    curl_easy_setopt(ctx->curl->handle, CURLOPT_WRITEDATA, NULL);
+
     virMutexUnlock(&ctx->curl->lock);
 
     if ((*response)->responseCode < 0)
         goto cleanup;
 
-    if (virBufferCheckError(&buffer) < 0)
-        goto cleanup;
-
-    (*response)->content = virBufferContentAndReset(&buffer);
-
     if ((*response)->responseCode == 500 || (*response)->responseCode == 200) {
-        (*response)->document = virXMLParseStringCtxt((*response)->content,
-                                                      _("(esx execute response)"),
-                                                      &xpathContext);
+        if (!parser ||
+            xmlParseChunk(parser, NULL, 0, 1) != 0 ||
+            !parser->wellFormed || !parser->myDoc) {
+            virReportError(VIR_ERR_XML_ERROR,
+                           _("Response for call to '%s' could not be parsed"),
+                           methodName);
+            goto cleanup;
+        }
 
-        if (!(*response)->document)
+        (*response)->document = parser->myDoc;
+        parser->myDoc = NULL;
+
+        if (!(xpathContext = xmlXPathNewContext((*response)->document))) {
+            virReportOOMError();
             goto cleanup;
+        }
 
         xmlXPathRegisterNs(xpathContext, BAD_CAST "soapenv",
                            BAD_CAST "http://schemas.xmlsoap.org/soap/envelope/");
@@ -1488,11 +1545,6 @@ esxVI_Context_Execute(esxVI_Context *ctx, const char *methodName,
                              "Fault: %s - %s"), (*response)->responseCode,
                            methodName, fault->faultcode, fault->faultstring);
 
-            /* FIXME: Dump raw response until detail part gets deserialized */
-            VIR_DEBUG("HTTP response code %d for call to '%s' [[[[%s]]]]",
-                      (*response)->responseCode, methodName,
-                      (*response)->content);
-
             goto cleanup;
         } else {
             if (virAsprintf(&xpathExpression,
@@ -1580,11 +1632,15 @@ esxVI_Context_Execute(esxVI_Context *ctx, const char *methodName,
 
  cleanup:
     if (result < 0) {
-        virBufferFreeAndReset(&buffer);
         esxVI_Response_Free(response);
         esxVI_Fault_Free(&fault);
     }
 
+    if (parser) {
+        xmlFreeDoc(parser->myDoc);
+        xmlFreeParserCtxt(parser);
+    }
+
     VIR_FREE(xpathExpression);
     xmlXPathFreeContext(xpathContext);
 
@@ -1603,8 +1659,6 @@ ESX_VI__TEMPLATE__ALLOC(Response)
 /* esxVI_Response_Free */
 ESX_VI__TEMPLATE__FREE(Response,
 {
-    VIR_FREE(item->content);
-
     xmlFreeDoc(item->document);
 })
 
@@ -2889,13 +2943,326 @@ esxVI_LookupHostSystemProperties(esxVI_Context *ctx,
 
 
 
+/*
+ * Union of the VirtualMachine properties requested by the frequently polled
+ * driver entry points (domain listing and esxDomainGetInfo). Lookups asking
+ * for a subset of these can be served from the mirror.
+ */
+#define ESX_VI__VIRTUAL_MACHINE_MIRROR_PROPERTIES                             \
+    "configStatus\0"                                                          \
+    "name\0"                                                                  \
+    "runtime.powerState\0"                                                    \
+    "config.uuid\0"                                                           \
+    "config.hardware.memoryMB\0"                                              \
+    "config.hardware.numCPU\0"                                                \
+    "config.memoryAllocation.limit\0"
+
+
+
+static bool
+esxVI_VirtualMachineMirrorUsable(esxVI_Context *ctx,
+                                 esxVI_String *propertyNameList)
+{
+    esxVI_String *propertyName;
+    const char *mirrored;
+
+    /* WaitForUpdatesEx was introduced with vSphere API 4.1 */
+    if (ctx->apiVersion < 1000000 * 4 + 1000 * 1 /* 4.1 */ ||
+        !propertyNameList) {
+        return false;
+    }
+
+    for (propertyName = propertyNameList; propertyName;
+         propertyName = propertyName->_next) {
+        for (mirrored = ESX_VI__VIRTUAL_MACHINE_MIRROR_PROPERTIES;
+             *mirrored != '\0'; mirrored += strlen(mirrored) + 1) {
+            if (STREQ(mirrored, propertyName->value))
+                break;
+        }
+
+        if (*mirrored == '\0')
+            return false;
+    }
+
+    return true;
+}
+
+
+
+static int
+esxVI_VirtualMachineMirrorCreateFilter(esxVI_Context *ctx)
+{
+    int result = -1;
+    esxVI_ObjectSpec *objectSpec = NULL;
+    bool objectSpec_isAppended = false;
+    esxVI_PropertySpec *propertySpec = NULL;
+    bool propertySpec_isAppended = false;
+    esxVI_PropertyFilterSpec *propertyFilterSpec = NULL;
+
+    if (VIR_STRDUP(ctx->vmMirrorVersion, "") < 0)
+        return -1;
+
+    if (esxVI_ObjectSpec_Alloc(&objectSpec) < 0)
+        goto cleanup;
+
+    objectSpec->obj = ctx->hostSystem->_reference;
+    objectSpec->skip = esxVI_Boolean_False;
+    objectSpec->selectSet = ctx->selectSet_hostSystemToVm;
+
+    if (esxVI_PropertySpec_Alloc(&propertySpec) < 0)
+        goto cleanup;
+
+    propertySpec->type = (char *)"VirtualMachine";
+
+    if (esxVI_String_AppendValueListToList
+          (&propertySpec->pathSet,
+           ESX_VI__VIRTUAL_MACHINE_MIRROR_PROPERTIES) < 0 ||
+        esxVI_PropertyFilterSpec_Alloc(&propertyFilterSpec) < 0 ||
+        esxVI_PropertySpec_AppendToList(&propertyFilterSpec->propSet,
+                                        propertySpec) < 0) {
+        goto cleanup;
+    }
+
+    propertySpec_isAppended = true;
+
+    if (esxVI_ObjectSpec_AppendToList(&propertyFilterSpec->objectSet,
+                                      objectSpec) < 0) {
+        goto cleanup;
+    }
+
+    objectSpec_isAppended = true;
+
+    if (esxVI_CreateFilter(ctx, propertyFilterSpec, esxVI_Boolean_True,
+                           &ctx->vmMirrorFilter) < 0) {
+        goto cleanup;
+    }
+
+    result = 0;
+
+ cleanup:
+    /*
+     * Remove values given by the context from the data structures to prevent
+     * them from being freed by the call to esxVI_PropertyFilterSpec_Free().
+     */
+    if (objectSpec) {
+        objectSpec->obj = NULL;
+        objectSpec->selectSet = NULL;
+    }
+
+    if (propertySpec)
+        propertySpec->type = NULL;
+
+    if (!objectSpec_isAppended)
+        esxVI_ObjectSpec_Free(&objectSpec);
+
+    if (!propertySpec_isAppended)
+        esxVI_PropertySpec_Free(&propertySpec);
+
+    esxVI_PropertyFilterSpec_Free(&propertyFilterSpec);
+
+    if (result < 0)
+        VIR_FREE(ctx->vmMirrorVersion);
+
+    return result;
+}
+
+
+
+static int
+esxVI_VirtualMachineMirrorSync(esxVI_Context *ctx)
+{
+    int result = -1;
+    esxVI_WaitOptions *waitOptions = NULL;
+    esxVI_UpdateSet *updateSet = NULL;
+    esxVI_String *propertyNameList = NULL;
+    bool truncated = false;
+
+    if (!ctx->vmMirrorFilter &&
+        esxVI_VirtualMachineMirrorCreateFilter(ctx) < 0) {
+        return -1;
+    }
+
+    if (esxVI_WaitOptions_Alloc(&waitOptions) < 0 ||
+        esxVI_Int_Alloc(&waitOptions->maxWaitSeconds) < 0) {
+        goto cleanup;
+    }
+
+    /* Collect pending updates only, don't block waiting for new changes */
+    waitOptions->maxWaitSeconds->value = 0;
+
+    do {
+        esxVI_UpdateSet_Free(&updateSet);
+
+        if (esxVI_WaitForUpdatesEx(ctx, ctx->vmMirrorVersion, waitOptions,
+                                   &updateSet) < 0) {
+            goto cleanup;
+        }
+
+        if (!updateSet)
+            break; /* no changes since the last call */
+
+        VIR_FREE(ctx->vmMirrorVersion);
+
+        if (VIR_STRDUP(ctx->vmMirrorVersion, updateSet->version) < 0)
+            goto cleanup;
+
+        /* Something changed, drop the mirror and refetch it below */
+        if (updateSet->filterSet)
+            esxVI_ObjectContent_Free(&ctx->vmMirror);
+
+        truncated = updateSet->truncated == esxVI_Boolean_True;
+    } while (truncated);
+
+    if (!ctx->vmMirror &&
+        (esxVI_String_AppendValueListToList
+           (&propertyNameList,
+            ESX_VI__VIRTUAL_MACHINE_MIRROR_PROPERTIES) < 0 ||
+         esxVI_LookupObjectContentByType(ctx, ctx->hostSystem->_reference,
+                                         "VirtualMachine", propertyNameList,
+                                         &ctx->vmMirror,
+                                         esxVI_Occurrence_OptionalList) < 0)) {
+        goto cleanup;
+    }
+
+    result = 0;
+
+ cleanup:
+    esxVI_WaitOptions_Free(&waitOptions);
+    esxVI_UpdateSet_Free(&updateSet);
+    esxVI_String_Free(&propertyNameList);
+
+    return result;
+}
+
+
+
+static int
+esxVI_VirtualMachineMirrorCopyItem(esxVI_ObjectContent *candidate,
+                                   esxVI_String *propertyNameList,
+                                   esxVI_ObjectContent **virtualMachine)
+{
+    esxVI_DynamicProperty *dynamicProperty;
+    esxVI_DynamicProperty **prev;
+
+    if (esxVI_ObjectContent_DeepCopy(virtualMachine, candidate) < 0)
+        return -1;
+
+    /*
+     * Reduce the copied property set to the requested properties. An item
+     * has to be unlinked before freeing it, because the generated
+     * esxVI_DynamicProperty_Free() frees the complete list.
+     */
+    prev = &(*virtualMachine)->propSet;
+
+    while ((dynamicProperty = *prev)) {
+        if (esxVI_String_ListContainsValue(propertyNameList,
+                                           dynamicProperty->name)) {
+            prev = &dynamicProperty->_next;
+        } else {
+            *prev = dynamicProperty->_next;
+            dynamicProperty->_next = NULL;
+            esxVI_DynamicProperty_Free(&dynamicProperty);
+        }
+    }
+
+    return 0;
+}
+
+
+
+static int
+esxVI_VirtualMachineMirrorServe(esxVI_Context *ctx,
+                                esxVI_String *propertyNameList,
+                                esxVI_ObjectContent **virtualMachineList)
+{
+    int result = -1;
+    esxVI_ObjectContent *candidate;
+    esxVI_ObjectContent *virtualMachine = NULL;
+
+    for (candidate = ctx->vmMirror; candidate; candidate = candidate->_next) {
+        if (esxVI_VirtualMachineMirrorCopyItem(candidate, propertyNameList,
+                                               &virtualMachine) < 0 ||
+            esxVI_ObjectContent_AppendToList(virtualMachineList,
+                                             virtualMachine) < 0) {
+            goto cleanup;
+        }
+
+        virtualMachine = NULL;
+    }
+
+    result = 0;
+
+ cleanup:
+    esxVI_ObjectContent_Free(&virtualMachine);
+
+    if (result < 0)
+        esxVI_ObjectContent_Free(virtualMachineList);
+
+    return result;
+}
+
+
+
+static int
+esxVI_VirtualMachineMirrorFindByUuid(esxVI_Context *ctx,
+                                     const unsigned char *uuid,
+                                     esxVI_String *propertyNameList,
+                                     esxVI_ObjectContent **virtualMachine)
+{
+    esxVI_ObjectContent *candidate;
+    esxVI_DynamicProperty *dynamicProperty;
+    unsigned char candidate_uuid[VIR_UUID_BUFLEN];
+
+    for (candidate = ctx->vmMirror; candidate; candidate = candidate->_next) {
+        for (dynamicProperty = candidate->propSet; dynamicProperty;
+             dynamicProperty = dynamicProperty->_next) {
+            if (STREQ(dynamicProperty->name, "config.uuid"))
+                break;
+        }
+
+        if (!dynamicProperty ||
+            dynamicProperty->val->type != esxVI_Type_String ||
+            virUUIDParse(dynamicProperty->val->string, candidate_uuid) < 0) {
+            continue;
+        }
+
+        if (memcmp(uuid, candidate_uuid, VIR_UUID_BUFLEN) != 0)
+            continue;
+
+        return esxVI_VirtualMachineMirrorCopyItem(candidate, propertyNameList,
+                                                  virtualMachine);
+    }
+
+    return 0; /* not found, *virtualMachine is left untouched */
+}
+
+
+
 int
 esxVI_LookupVirtualMachineList(esxVI_Context *ctx,
                                esxVI_String *propertyNameList,
                                esxVI_ObjectContent **virtualMachineList)
 {
+    int result;
+
     /* FIXME: Switch from ctx->hostSystem to ctx->computeResource->resourcePool
      *        for cluster support */
+
+    if (esxVI_VirtualMachineMirrorUsable(ctx, propertyNameList)) {
+        virMutexLock(ctx->vmMirrorLock);
+
+        result = esxVI_VirtualMachineMirrorSync(ctx);
+
+        if (result >= 0) {
+            result = esxVI_VirtualMachineMirrorServe(ctx, propertyNameList,
+                                                     virtualMachineList);
+        }
+
+        virMutexUnlock(ctx->vmMirrorLock);
+
+        return result;
+    }
+
     return esxVI_LookupObjectContentByType(ctx, ctx->hostSystem->_reference,
                                            "VirtualMachine", propertyNameList,
                                            virtualMachineList,
@@ -2921,6 +3288,28 @@ esxVI_LookupVirtualMachineByUuid(esxVI_Context *ctx, const unsigned char *uuid,
 
     virUUIDFormat(uuid, uuid_string);
 
+    if (esxVI_VirtualMachineMirrorUsable(ctx, propertyNameList)) {
+        virMutexLock(ctx->vmMirrorLock);
+
+        if (esxVI_VirtualMachineMirrorSync(ctx) < 0 ||
+            esxVI_VirtualMachineMirrorFindByUuid(ctx, uuid, propertyNameList,
+                                                 virtualMachine) < 0) {
+            virMutexUnlock(ctx->vmMirrorLock);
+            return -1;
+        }
+
+        virMutexUnlock(ctx->vmMirrorLock);
+
+        if (*virtualMachine)
+            return 0;
+
+        /*
+         * Not found in the mirror. Fall through to the generic lookup,
+         * because on a vCenter the UUID might belong to a virtual machine
+         * on another host that the mirror doesn't track.
+         */
+    }
+
     if (esxVI_FindByUuid(ctx, ctx->datacenter->_reference, uuid_string,
                          esxVI_Boolean_True, esxVI_Boolean_Undefined,
                          &managedObjectReference) < 0) {
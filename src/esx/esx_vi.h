@@ -210,6 +210,13 @@ struct _esxVI_Context {
     esxVI_SelectionSpec *selectSet_datacenterToNetwork;
     bool hasQueryVirtualDiskUuid;
     bool hasSessionIsActive;
+
+    /* Incrementally invalidated VirtualMachine property cache, kept in sync
+     * via a persistent property filter, see esxVI_LookupVirtualMachineList */
+    virMutexPtr vmMirrorLock; /* protects the three members below */
+    esxVI_ManagedObjectReference *vmMirrorFilter;
+    char *vmMirrorVersion;
+    esxVI_ObjectContent *vmMirror;
 };
 
 int esxVI_Context_Alloc(esxVI_Context **ctx);
@@ -233,7 +240,6 @@ int esxVI_Context_Execute(esxVI_Context *ctx, const char *methodName,
 
 struct _esxVI_Response {
     int responseCode;                                 /* required */
-    char *content;                                    /* required */
     xmlDocPtr document;                               /* optional */
     xmlNodePtr node;                                  /* optional, list */
 };
@@ -46,6 +46,8 @@ hypervFreePrivate(hypervPrivate **priv)
     if (priv == NULL || *priv == NULL)
         return;
 
+    hypervWmiCacheFree(*priv);
+
     if ((*priv)->client != NULL) {
         /* FIXME: This leaks memory due to bugs in openwsman <= 2.2.6 */
         wsmc_release((*priv)->client);
@@ -112,6 +114,9 @@ hypervConnectOpen(virConnectPtr conn, virConnectAuthPtr auth,
     if (VIR_ALLOC(priv) < 0)
         goto cleanup;
 
+    if (hypervWmiCacheInit(priv) < 0)
+        goto cleanup;
+
     if (hypervParseUri(&priv->parsedUri, conn->uri) < 0)
         goto cleanup;
 
@@ -25,6 +25,8 @@
 
 # include "internal.h"
 # include "virerror.h"
+# include "virhash.h"
+# include "virthread.h"
 # include "hyperv_util.h"
 # include "openwsman.h"
 
@@ -33,6 +35,8 @@ typedef struct _hypervPrivate hypervPrivate;
 struct _hypervPrivate {
     hypervParsedUri *parsedUri;
     WsManClient *client;
+    virMutex wmiCacheLock; /* protects wmiCache */
+    virHashTablePtr wmiCache;
 };
 
 #endif /* __HYPERV_PRIVATE_H__ */
@@ -28,6 +28,8 @@
 #include "virerror.h"
 #include "datatypes.h"
 #include "viralloc.h"
+#include "virlog.h"
+#include "virtime.h"
 #include "viruuid.h"
 #include "virbuffer.h"
 #include "hyperv_private.h"
@@ -36,6 +38,8 @@
 
 #define WS_SERIALIZER_FREE_MEM_WORKS 0
 
+#define HYPERV_WMI_CACHE_TTL_MS (2 * 1000)
+
 #define ROOT_CIMV2 \
     "http://schemas.microsoft.com/wbem/wsman/1/wmi/root/cimv2/*"
 
@@ -44,6 +48,8 @@
 
 #define VIR_FROM_THIS VIR_FROM_HYPERV
 
+VIR_LOG_INIT("hyperv.hyperv_wmi");
+
 
 
 int
@@ -102,6 +108,182 @@ hyperyVerifyResponse(WsManClient *client, WsXmlDocH response,
 
 
 
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * WMI enumeration cache
+ *
+ * Caches the results of WQL enumerations for a short time, so that workloads
+ * that list all domains and then query them one by one don't repeat the same
+ * WS-Management roundtrips over and over again.
+ *
+ * The cache stores the deserialized data items only. Those are owned by the
+ * openwsman serializer context and stay valid until the connection is closed,
+ * see hypervFreeObject. Therefore, a cache hit can hand out new hypervObject
+ * wrappers around the shared data items without any deep copying. This also
+ * means the caching is only safe as long as ws_serializer_free_mem is not
+ * used, hence the lookup and store functions are disabled if
+ * WS_SERIALIZER_FREE_MEM_WORKS is enabled.
+ */
+
+typedef struct _hypervWmiCacheEntry hypervWmiCacheEntry;
+
+struct _hypervWmiCacheEntry {
+    XmlSerializerInfo *serializerInfo;
+    XML_TYPE_PTR *data;
+    size_t ndata;
+    unsigned long long expires; /* in ms */
+};
+
+static void
+hypervWmiCacheEntryFree(void *payload, const void *name ATTRIBUTE_UNUSED)
+{
+    hypervWmiCacheEntry *entry = payload;
+
+    /* The data items are owned by the openwsman serializer context */
+    VIR_FREE(entry->data);
+    VIR_FREE(entry);
+}
+
+int
+hypervWmiCacheInit(hypervPrivate *priv)
+{
+    if (!(priv->wmiCache = virHashCreate(32, hypervWmiCacheEntryFree)))
+        return -1;
+
+    if (virMutexInit(&priv->wmiCacheLock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Could not initialize WMI cache mutex"));
+        virHashFree(priv->wmiCache);
+        priv->wmiCache = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+void
+hypervWmiCacheFree(hypervPrivate *priv)
+{
+    if (priv->wmiCache == NULL)
+        return;
+
+    virHashFree(priv->wmiCache);
+    priv->wmiCache = NULL;
+    virMutexDestroy(&priv->wmiCacheLock);
+}
+
+void
+hypervWmiCacheFlush(hypervPrivate *priv)
+{
+    if (priv->wmiCache == NULL)
+        return;
+
+    virMutexLock(&priv->wmiCacheLock);
+    virHashRemoveAll(priv->wmiCache);
+    virMutexUnlock(&priv->wmiCacheLock);
+}
+
+static int
+hypervWmiCacheLookup(hypervPrivate *priv, const char *key,
+                     XmlSerializerInfo *serializerInfo, hypervObject **list,
+                     bool *found)
+{
+    hypervWmiCacheEntry *entry;
+    hypervObject *head = NULL;
+    hypervObject *tail = NULL;
+    hypervObject *object;
+    unsigned long long now;
+    size_t i;
+
+    if (WS_SERIALIZER_FREE_MEM_WORKS || priv->wmiCache == NULL ||
+        virTimeMillisNowRaw(&now) < 0) {
+        return 0;
+    }
+
+    virMutexLock(&priv->wmiCacheLock);
+
+    entry = virHashLookup(priv->wmiCache, key);
+
+    if (entry == NULL || entry->serializerInfo != serializerInfo ||
+        entry->expires < now) {
+        virMutexUnlock(&priv->wmiCacheLock);
+        return 0;
+    }
+
+    for (i = 0; i < entry->ndata; ++i) {
+        if (VIR_ALLOC(object) < 0)
+            goto error;
+
+        object->serializerInfo = entry->serializerInfo;
+        object->data = entry->data[i];
+
+        if (head == NULL) {
+            head = object;
+        } else {
+            tail->next = object;
+        }
+
+        tail = object;
+    }
+
+    virMutexUnlock(&priv->wmiCacheLock);
+
+    VIR_DEBUG("Serving WQL query from the WMI cache: %s", key);
+
+    *list = head;
+    *found = true;
+
+    return 0;
+
+ error:
+    virMutexUnlock(&priv->wmiCacheLock);
+    hypervFreeObject(priv, head);
+
+    return -1;
+}
+
+static void
+hypervWmiCacheStore(hypervPrivate *priv, const char *key,
+                    XmlSerializerInfo *serializerInfo, hypervObject *list)
+{
+    hypervWmiCacheEntry *entry;
+    hypervObject *object;
+    unsigned long long now;
+    size_t i = 0;
+
+    if (WS_SERIALIZER_FREE_MEM_WORKS || priv->wmiCache == NULL ||
+        virTimeMillisNowRaw(&now) < 0) {
+        return;
+    }
+
+    if (VIR_ALLOC_QUIET(entry) < 0)
+        return;
+
+    entry->serializerInfo = serializerInfo;
+    entry->expires = now + HYPERV_WMI_CACHE_TTL_MS;
+
+    for (object = list; object != NULL; object = object->next)
+        ++entry->ndata;
+
+    if (entry->ndata > 0 &&
+        VIR_ALLOC_N_QUIET(entry->data, entry->ndata) < 0) {
+        VIR_FREE(entry);
+        return;
+    }
+
+    for (object = list; object != NULL; object = object->next)
+        entry->data[i++] = object->data;
+
+    virMutexLock(&priv->wmiCacheLock);
+
+    /* Treat a failure to store the entry as a cache miss */
+    if (virHashUpdateEntry(priv->wmiCache, key, entry) < 0)
+        hypervWmiCacheEntryFree(entry, NULL);
+
+    virMutexUnlock(&priv->wmiCacheLock);
+}
+
+
+
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  * Object
  */
@@ -116,6 +298,9 @@ hypervEnumAndPull(hypervPrivate *priv, virBufferPtr query, const char *root,
     WsSerializerContextH serializerContext;
     client_opt_t *options = NULL;
     char *query_string = NULL;
+    char *cacheKey = NULL;
+    bool cachable;
+    bool cached = false;
     filter_t *filter = NULL;
     WsXmlDocH response = NULL;
     char *enumContext = NULL;
@@ -137,6 +322,30 @@ hypervEnumAndPull(hypervPrivate *priv, virBufferPtr query, const char *root,
         return -1;
     }
 
+    /* Don't cache Msvm_ConcreteJob results, those are polled in a loop
+     * until the job completes and have to be fetched fresh every time */
+    cachable = STRNEQ(className, MSVM_CONCRETEJOB_CLASSNAME);
+
+    if (cachable) {
+        if (virAsprintf(&cacheKey, "%s|%s", className, query_string) < 0) {
+            VIR_FREE(query_string);
+            return -1;
+        }
+
+        if (hypervWmiCacheLookup(priv, cacheKey, serializerInfo, list,
+                                 &cached) < 0) {
+            VIR_FREE(query_string);
+            VIR_FREE(cacheKey);
+            return -1;
+        }
+
+        if (cached) {
+            VIR_FREE(query_string);
+            VIR_FREE(cacheKey);
+            return 0;
+        }
+    }
+
     serializerContext = wsmc_get_serialization_context(priv->client);
 
     options = wsmc_options_init();
@@ -231,6 +440,9 @@ hypervEnumAndPull(hypervPrivate *priv, virBufferPtr query, const char *root,
         response = NULL;
     }
 
+    if (cachable)
+        hypervWmiCacheStore(priv, cacheKey, serializerInfo, head);
+
     *list = head;
     head = NULL;
 
@@ -255,6 +467,7 @@ hypervEnumAndPull(hypervPrivate *priv, virBufferPtr query, const char *root,
     }
 
     VIR_FREE(query_string);
+    VIR_FREE(cacheKey);
     ws_xml_destroy_doc(response);
     VIR_FREE(enumContext);
     hypervFreeObject(priv, head);
@@ -510,6 +723,9 @@ hypervInvokeMsvmComputerSystemRequestStateChange(virDomainPtr domain,
         goto cleanup;
     }
 
+    /* The domain state has changed, don't serve stale cached results */
+    hypervWmiCacheFlush(priv);
+
     result = 0;
 
  cleanup:
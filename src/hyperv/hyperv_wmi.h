@@ -57,6 +57,18 @@ void hypervFreeObject(hypervPrivate *priv, hypervObject *object);
 
 
 
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * WMI enumeration cache
+ */
+
+int hypervWmiCacheInit(hypervPrivate *priv);
+
+void hypervWmiCacheFree(hypervPrivate *priv);
+
+void hypervWmiCacheFlush(hypervPrivate *priv);
+
+
+
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  * CIM/Msvm_ReturnCode
  */
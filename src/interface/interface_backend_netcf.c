@@ -31,6 +31,7 @@
 #include "interface_conf.h"
 #include "viralloc.h"
 #include "virlog.h"
+#include "virnetdev.h"
 #include "virstring.h"
 #include "viraccessapicheck.h"
 
@@ -175,6 +176,40 @@ netcfGetMinimalDefForDevice(struct netcf_if *iface)
 }
 
 
+/*
+ * As netcfGetMinimalDefForDevice, but queries the kernel directly
+ * instead of going through a struct netcf_if.  Looking an interface
+ * up in netcf makes it re-read the host network config files, which
+ * is far too expensive to do once per interface when listing many.
+ */
+static virInterfaceDef *
+netcfGetMinimalDefForName(const char *name)
+{
+    virInterfaceDef *def;
+    virMacAddr mac;
+    char macstr[VIR_MAC_STRING_BUFLEN];
+
+    if (VIR_ALLOC(def) < 0)
+        return NULL;
+
+    if (VIR_STRDUP(def->name, name) < 0)
+        goto cleanup;
+
+    if (virNetDevGetMAC(name, &mac) < 0)
+        goto cleanup;
+
+    virMacAddrFormat(&mac, macstr);
+    if (VIR_STRDUP(def->mac, macstr) < 0)
+        goto cleanup;
+
+    return def;
+
+ cleanup:
+    virInterfaceDefFree(def);
+    return NULL;
+}
+
+
 static int netcf_to_vir_err(int netcf_errcode)
 {
     switch (netcf_errcode) {
@@ -590,46 +625,55 @@ netcfConnectListAllInterfaces(virConnectPtr conn,
     for (i = 0; i < count; i++) {
         virInterfaceDefPtr def;
 
-        iface = ncf_lookup_by_name(driver->netcf, names[i]);
-        if (!iface) {
-            const char *errmsg, *details;
-            int errcode = ncf_error(driver->netcf, &errmsg, &details);
-            if (errcode != NETCF_NOERROR) {
-                virReportError(netcf_to_vir_err(errcode),
-                               _("couldn't find interface named '%s': %s%s%s"),
-                               names[i], errmsg,
-                               details ? " - " : "", details ? details : "");
-                goto cleanup;
-            } else {
-                /* Ignore the NETCF_NOERROR, as the interface is very likely
-                 * deleted by other management apps (e.g. virt-manager).
-                 */
-                VIR_WARN("couldn't find interface named '%s', might be "
-                         "deleted by other process", names[i]);
-                continue;
+        /* Build the minimal def straight from the kernel where
+         * possible; falling back to a netcf lookup only for devices
+         * the kernel no longer knows about (e.g. inactive ones that
+         * exist purely as config files) */
+        if (!(def = netcfGetMinimalDefForName(names[i]))) {
+            virResetLastError();
+
+            iface = ncf_lookup_by_name(driver->netcf, names[i]);
+            if (!iface) {
+                const char *errmsg, *details;
+                int errcode = ncf_error(driver->netcf, &errmsg, &details);
+                if (errcode != NETCF_NOERROR) {
+                    virReportError(netcf_to_vir_err(errcode),
+                                   _("couldn't find interface named '%s': %s%s%s"),
+                                   names[i], errmsg,
+                                   details ? " - " : "", details ? details : "");
+                    goto cleanup;
+                } else {
+                    /* Ignore the NETCF_NOERROR, as the interface is very likely
+                     * deleted by other management apps (e.g. virt-manager).
+                     */
+                    VIR_WARN("couldn't find interface named '%s', might be "
+                             "deleted by other process", names[i]);
+                    continue;
+                }
             }
-        }
 
-        if (!(def = netcfGetMinimalDefForDevice(iface)))
-            goto cleanup;
-
-        if (!virConnectListAllInterfacesCheckACL(conn, def)) {
+            def = netcfGetMinimalDefForDevice(iface);
             ncf_if_free(iface);
             iface = NULL;
+            if (!def)
+                goto cleanup;
+        }
+
+        if (!virConnectListAllInterfacesCheckACL(conn, def)) {
             virInterfaceDefFree(def);
             continue;
         }
 
         if (ifaces) {
-            if (!(iface_obj = virGetInterface(conn, def->name, def->mac)))
+            if (!(iface_obj = virGetInterface(conn, def->name, def->mac))) {
+                virInterfaceDefFree(def);
                 goto cleanup;
+            }
             tmp_iface_objs[niface_objs] = iface_obj;
         }
         niface_objs++;
 
         virInterfaceDefFree(def);
-        ncf_if_free(iface);
-        iface = NULL;
     }
 
     if (tmp_iface_objs) {
@@ -809,6 +809,55 @@ virAdmServerGetThreadPoolParameters(virAdmServerPtr srv,
     return -1;
 }
 
+/**
+ * virAdmServerGetProcStats:
+ * @srv: a valid server object reference
+ * @params: pointer to a list of typed parameters which will be allocated
+ *          to store all returned counters
+ * @nparams: pointer which will hold the number of params returned in @params
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Retrieves cumulative per-procedure dispatch statistics from @srv. Only
+ * procedures which have been called at least once since the daemon started
+ * are reported. Each procedure contributes parameters named
+ * "proc.<program>.<procedure>.<counter>" where <counter> is one of:
+ *      "calls"         number of dispatched calls
+ *      "errors"        number of calls which returned an error
+ *      "time.total"    cumulative dispatch time in milliseconds
+ *      "time.max"      longest single dispatch in milliseconds
+ *      "queue.total"   cumulative worker queue wait in milliseconds
+ *      "queue.max"     longest single queue wait in milliseconds
+ *      "bytes.in"      bytes received for these calls
+ *      "bytes.out"     bytes sent in replies
+ *
+ * Returns 0 on success, -1 in case of an error.
+ */
+int
+virAdmServerGetProcStats(virAdmServerPtr srv,
+                         virTypedParameterPtr *params,
+                         int *nparams,
+                         unsigned int flags)
+{
+    int ret = -1;
+
+    VIR_DEBUG("srv=%p, params=%p, nparams=%p, flags=%x",
+              srv, params, nparams, flags);
+
+    virResetLastError();
+
+    virCheckAdmServerReturn(srv, -1);
+    virCheckNonNullArgGoto(params, error);
+
+    if ((ret = remoteAdminServerGetProcStats(srv, params, nparams,
+                                             flags)) < 0)
+        goto error;
+
+    return ret;
+ error:
+    virDispatchError(NULL);
+    return -1;
+}
+
 /**
  * virAdmServerSetThreadPoolParameters:
  * @srv: a valid server object reference
@@ -5450,7 +5450,11 @@ virDomainBlockStats(virDomainPtr dom, const char *disk,
  * summary stats for the entire domain.
  *
  * Domains may have more than one block device.  To get stats for
- * each you should make multiple calls to this function.
+ * each you should make multiple calls to this function.  Note that
+ * each call requires a separate round trip to the hypervisor, so
+ * when polling the stats of every disk it is cheaper to make one
+ * call to virDomainListGetStats() with VIR_DOMAIN_STATS_BLOCK, which
+ * returns the same counters for all disks at once.
  *
  * On input, @nparams gives the size of the @params array; on output,
  * @nparams gives how many slots were filled with parameter
@@ -11251,6 +11255,15 @@ virConnectGetDomainCapabilities(virConnectPtr conn,
  *                             as unsigned long long. It is produced by the
  *                             ref_cpu_cycles perf event.
  *
+ * VIR_DOMAIN_STATS_IOTHREAD:
+ *     Return IOThread statistics.
+ *     The typed parameter keys are in this format:
+ *
+ *     "iothread.count" - number of IOThreads configured for the domain
+ *                        as unsigned int.
+ *     "iothread.<id>.time" - total CPU time (ns) consumed by the IOThread
+ *                            with the given id as unsigned long long.
+ *
  * Note that entire stats groups or individual stat fields may be missing from
  * the output in case they are not supported by the given hypervisor, are not
  * applicable for the current state of the guest domain, or their retrieval
@@ -11283,6 +11296,12 @@ virConnectGetDomainCapabilities(virConnectPtr conn,
  * VIR_CONNECT_GET_ALL_DOMAINS_STATS_SHUTOFF and/or
  * VIR_CONNECT_GET_ALL_DOMAINS_STATS_OTHER for all other states.
  *
+ * Passing VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT in @flags means when
+ * libvirt is unable to fetch stats for any of the domains (for whatever
+ * reason) only a subset of statistics is returned for the domain.  That
+ * subset being statistics that don't involve querying the underlying
+ * hypervisor.
+ *
  * Returns the count of returned statistics structures on success, -1 on error.
  * The requested data are returned in the @retStats parameter. The returned
  * array should be freed by the caller. See virDomainStatsRecordListFree.
@@ -11351,6 +11370,12 @@ virConnectGetAllDomainStats(virConnectPtr conn,
  * fields for offline domains if the statistics are meaningful only for a
  * running domain.
  *
+ * Passing VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT in @flags means when
+ * libvirt is unable to fetch stats for any of the domains (for whatever
+ * reason) only a subset of statistics is returned for the domain.  That
+ * subset being statistics that don't involve querying the underlying
+ * hypervisor.
+ *
  * Note that any of the domain list filtering flags in @flags may be rejected
  * by this function.
  *
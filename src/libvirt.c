@@ -739,6 +739,24 @@ virRegisterStateDriver(virStateDriverPtr driver)
 }
 
 
+static virThread virStateAutoStartThread;
+static bool virStateAutoStartActive;
+
+static void
+virStateAutoStartWorker(void *opaque ATTRIBUTE_UNUSED)
+{
+    size_t i;
+
+    for (i = 0; i < virStateDriverTabCount; i++) {
+        if (virStateDriverTab[i]->stateAutoStart) {
+            VIR_DEBUG("Running global auto start for %s state driver",
+                      virStateDriverTab[i]->name);
+            virStateDriverTab[i]->stateAutoStart();
+        }
+    }
+}
+
+
 /**
  * virStateInitialize:
  * @privileged: set to true if running with root privilege, false otherwise
@@ -778,13 +796,18 @@ virStateInitialize(bool privileged,
         }
     }
 
-    for (i = 0; i < virStateDriverTabCount; i++) {
-        if (virStateDriverTab[i]->stateAutoStart) {
-            VIR_DEBUG("Running global auto start for %s state driver",
-                      virStateDriverTab[i]->name);
-            virStateDriverTab[i]->stateAutoStart();
-        }
-    }
+    /* Autostarting objects can take a long time (e.g. a storage pool
+     * check stuck on an unresponsive NFS server), and no driver API
+     * depends on it having finished, so push that phase into the
+     * background; RPC processing can begin as soon as we return.
+     * The thread is joinable so virStateCleanup() can wait for it
+     * before tearing down the driver state it iterates */
+    if (virThreadCreate(&virStateAutoStartThread, true,
+                        virStateAutoStartWorker, NULL) < 0)
+        virStateAutoStartWorker(NULL);
+    else
+        virStateAutoStartActive = true;
+
     return 0;
 }
 
@@ -802,6 +825,13 @@ virStateCleanup(void)
     int r;
     int ret = 0;
 
+    /* Wait for the background autostart phase, which walks the same
+     * driver state the cleanup callbacks below are about to free */
+    if (virStateAutoStartActive) {
+        virThreadJoin(&virStateAutoStartThread);
+        virStateAutoStartActive = false;
+    }
+
     for (r = virStateDriverTabCount - 1; r >= 0; r--) {
         if (virStateDriverTab[r]->stateCleanup &&
             virStateDriverTab[r]->stateCleanup() < 0)
@@ -1504,6 +1504,9 @@ int libxlDriverConfigLoadFile(libxlDriverConfigPtr cfg,
     cfg->keepAliveInterval = 5;
     cfg->keepAliveCount = 5;
 
+    /* autostart domains sequentially by default */
+    cfg->maxAutostartWorkers = 1;
+
     /* Check the file is readable before opening it, otherwise
      * libvirt emits an error.
      */
@@ -1528,6 +1531,12 @@ int libxlDriverConfigLoadFile(libxlDriverConfigPtr cfg,
     if (virConfGetValueUInt(conf, "keepalive_count", &cfg->keepAliveCount) < 0)
         goto cleanup;
 
+    if (virConfGetValueUInt(conf, "max_autostart_workers",
+                            &cfg->maxAutostartWorkers) < 0)
+        goto cleanup;
+    if (cfg->maxAutostartWorkers == 0)
+        cfg->maxAutostartWorkers = 1;
+
     ret = 0;
 
  cleanup:
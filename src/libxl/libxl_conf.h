@@ -88,6 +88,8 @@ struct _libxlDriverConfig {
     int keepAliveInterval;
     unsigned int keepAliveCount;
 
+    unsigned int maxAutostartWorkers;
+
     /* Once created, caps are immutable */
     virCapsPtr caps;
 
@@ -56,6 +56,7 @@
 #include "viruri.h"
 #include "virstring.h"
 #include "virsysinfo.h"
+#include "virthreadpool.h"
 #include "viraccessapicheck.h"
 #include "viratomic.h"
 #include "virhostdev.h"
@@ -358,6 +359,91 @@ libxlAutostartDomain(virDomainObjPtr vm,
     return ret;
 }
 
+struct libxlAutostartState {
+    libxlDriverPrivatePtr driver;
+    virMutex lock;
+    virCond cond;
+    size_t pending;
+};
+
+static void
+libxlAutostartDomainWorker(void *jobdata, void *opaque)
+{
+    virDomainObjPtr vm = jobdata;
+    struct libxlAutostartState *state = opaque;
+
+    ignore_value(libxlAutostartDomain(vm, state->driver));
+    virObjectUnref(vm);
+
+    virMutexLock(&state->lock);
+    state->pending--;
+    virCondSignal(&state->cond);
+    virMutexUnlock(&state->lock);
+}
+
+static int
+libxlAutostartDomainsParallel(libxlDriverPrivatePtr driver,
+                              size_t nworkers)
+{
+    struct libxlAutostartState state;
+    virThreadPoolPtr pool = NULL;
+    virDomainObjPtr *vms = NULL;
+    size_t nvms = 0;
+    size_t i;
+    int ret = -1;
+
+    memset(&state, 0, sizeof(state));
+    state.driver = driver;
+
+    if (virMutexInit(&state.lock) < 0)
+        return -1;
+    if (virCondInit(&state.cond) < 0) {
+        virMutexDestroy(&state.lock);
+        return -1;
+    }
+
+    if (virDomainObjListCollect(driver->domains, NULL, &vms, &nvms, NULL,
+                                VIR_CONNECT_LIST_DOMAINS_INACTIVE |
+                                VIR_CONNECT_LIST_DOMAINS_AUTOSTART) < 0)
+        goto cleanup;
+
+    if (nvms && nworkers > nvms)
+        nworkers = nvms;
+
+    if (nvms &&
+        !(pool = virThreadPoolNew(nworkers, nworkers, 0,
+                                  libxlAutostartDomainWorker, &state)))
+        goto cleanup;
+
+    for (i = 0; i < nvms; i++) {
+        virMutexLock(&state.lock);
+        state.pending++;
+        virMutexUnlock(&state.lock);
+
+        /* on dispatch failure run the domain in this thread rather
+         * than skipping it */
+        if (virThreadPoolSendJob(pool, 0, vms[i]) < 0)
+            libxlAutostartDomainWorker(vms[i], &state);
+        vms[i] = NULL;
+    }
+
+    virMutexLock(&state.lock);
+    while (state.pending > 0)
+        ignore_value(virCondWait(&state.cond, &state.lock));
+    virMutexUnlock(&state.lock);
+
+    ret = 0;
+
+ cleanup:
+    virThreadPoolFree(pool);
+    for (i = 0; i < nvms; i++)
+        virObjectUnref(vms[i]);
+    VIR_FREE(vms);
+    virCondDestroy(&state.cond);
+    virMutexDestroy(&state.lock);
+    return ret;
+}
+
 /*
  * Reconnect to running domains that were previously started/created
  * with libxenlight driver.
@@ -790,11 +876,18 @@ libxlStateInitialize(bool privileged,
 static void
 libxlStateAutoStart(void)
 {
+    libxlDriverConfigPtr cfg;
+
     if (!libxl_driver)
         return;
 
-    virDomainObjListForEach(libxl_driver->domains, libxlAutostartDomain,
-                            libxl_driver);
+    cfg = libxlDriverConfigGet(libxl_driver);
+    if (cfg->maxAutostartWorkers <= 1 ||
+        libxlAutostartDomainsParallel(libxl_driver,
+                                      cfg->maxAutostartWorkers) < 0)
+        virDomainObjListForEach(libxl_driver->domains, libxlAutostartDomain,
+                                libxl_driver);
+    virObjectUnref(cfg);
 }
 
 static int
@@ -815,8 +908,11 @@ libxlStateReload(void)
                                    libxl_driver->xmlopt,
                                    NULL, libxl_driver);
 
-    virDomainObjListForEach(libxl_driver->domains, libxlAutostartDomain,
-                            libxl_driver);
+    if (cfg->maxAutostartWorkers <= 1 ||
+        libxlAutostartDomainsParallel(libxl_driver,
+                                      cfg->maxAutostartWorkers) < 0)
+        virDomainObjListForEach(libxl_driver->domains, libxlAutostartDomain,
+                                libxl_driver);
 
     virObjectUnref(cfg);
     return 0;
@@ -4043,7 +4139,7 @@ libxlDomainAttachDeviceFlags(virDomainPtr dom, const char *xml,
 
         /* Make a copy for updated domain. */
         if (!(vmdef = virDomainObjCopyPersistentDef(vm, cfg->caps,
-                                                    driver->xmlopt)))
+                                                    driver->xmlopt, NULL)))
             goto endjob;
 
         if (libxlDomainAttachDeviceConfig(vmdef, dev) < 0)
@@ -4133,7 +4229,7 @@ libxlDomainDetachDeviceFlags(virDomainPtr dom, const char *xml,
 
         /* Make a copy for updated domain. */
         if (!(vmdef = virDomainObjCopyPersistentDef(vm, cfg->caps,
-                                                    driver->xmlopt)))
+                                                    driver->xmlopt, NULL)))
             goto endjob;
 
         if (libxlDomainDetachDeviceConfig(vmdef, dev) < 0)
@@ -4220,7 +4316,7 @@ libxlDomainUpdateDeviceFlags(virDomainPtr dom, const char *xml,
 
         /* Make a copy for updated domain. */
         if (!(vmdef = virDomainObjCopyPersistentDef(vm, cfg->caps,
-                                                    driver->xmlopt)))
+                                                    driver->xmlopt, NULL)))
             goto cleanup;
 
         if ((ret = libxlDomainUpdateDeviceConfig(vmdef, dev)) < 0)
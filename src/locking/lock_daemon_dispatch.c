@@ -97,6 +97,107 @@ virLockSpaceProtocolDispatchAcquireResource(virNetServerPtr server ATTRIBUTE_UNU
 }
 
 
+static int
+virLockSpaceProtocolDispatchAcquireResources(virNetServerPtr server ATTRIBUTE_UNUSED,
+                                             virNetServerClientPtr client,
+                                             virNetMessagePtr msg ATTRIBUTE_UNUSED,
+                                             virNetMessageErrorPtr rerr,
+                                             virLockSpaceProtocolAcquireResourcesArgs *args)
+{
+    int rv = -1;
+    unsigned int flags = args->flags;
+    virLockDaemonClientPtr priv =
+        virNetServerClientGetPrivateData(client);
+    virLockSpacePtr lockspace;
+    size_t nacquired = 0;
+    size_t i;
+
+    virMutexLock(&priv->lock);
+
+    virCheckFlagsGoto(0, cleanup);
+
+    if (priv->restricted) {
+        virReportError(VIR_ERR_OPERATION_DENIED, "%s",
+                       _("lock manager connection has been restricted"));
+        goto cleanup;
+    }
+
+    if (!priv->ownerId) {
+        virReportError(VIR_ERR_OPERATION_INVALID, "%s",
+                       _("lock owner details have not been registered"));
+        goto cleanup;
+    }
+
+    for (i = 0; i < args->resources.resources_len; i++) {
+        virLockSpaceProtocolAcquireResourceArgs *res =
+            &args->resources.resources_val[i];
+        unsigned int newFlags;
+
+        if (res->flags &
+            ~(VIR_LOCK_SPACE_PROTOCOL_ACQUIRE_RESOURCE_SHARED |
+              VIR_LOCK_SPACE_PROTOCOL_ACQUIRE_RESOURCE_AUTOCREATE)) {
+            virReportError(VIR_ERR_INVALID_ARG,
+                           _("unsupported flags (0x%x) for resource '%s'"),
+                           res->flags, res->name);
+            goto cleanup;
+        }
+
+        if (!(lockspace = virLockDaemonFindLockSpace(lockDaemon, res->path))) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Lockspace for path %s does not exist"),
+                           res->path);
+            goto cleanup;
+        }
+
+        newFlags = 0;
+        if (res->flags & VIR_LOCK_SPACE_PROTOCOL_ACQUIRE_RESOURCE_SHARED)
+            newFlags |= VIR_LOCK_SPACE_ACQUIRE_SHARED;
+        if (res->flags & VIR_LOCK_SPACE_PROTOCOL_ACQUIRE_RESOURCE_AUTOCREATE)
+            newFlags |= VIR_LOCK_SPACE_ACQUIRE_AUTOCREATE;
+
+        if (virLockSpaceAcquireResource(lockspace,
+                                        res->name,
+                                        priv->ownerPid,
+                                        newFlags) < 0)
+            goto cleanup;
+
+        nacquired++;
+    }
+
+    rv = 0;
+
+ cleanup:
+    if (rv < 0) {
+        /* The batch is all-or-nothing; drop anything acquired before
+         * the failure so the client can safely retry resource by
+         * resource without ending up as a duplicate owner
+         */
+        if (nacquired) {
+            virErrorPtr err = virSaveLastError();
+
+            while (nacquired--) {
+                virLockSpaceProtocolAcquireResourceArgs *res =
+                    &args->resources.resources_val[nacquired];
+
+                if ((lockspace = virLockDaemonFindLockSpace(lockDaemon,
+                                                            res->path)) &&
+                    virLockSpaceReleaseResource(lockspace,
+                                                res->name,
+                                                priv->ownerPid) < 0)
+                    VIR_WARN("Unable to release resource %s after failed batch",
+                             res->name);
+            }
+
+            virSetError(err);
+            virFreeError(err);
+        }
+        virNetMessageSaveError(rerr);
+    }
+    virMutexUnlock(&priv->lock);
+    return rv;
+}
+
+
 static int
 virLockSpaceProtocolDispatchCreateResource(virNetServerPtr server ATTRIBUTE_UNUSED,
                                            virNetServerClientPtr client,
@@ -612,6 +612,72 @@ static int virLockManagerLockDaemonAddResource(virLockManagerPtr lock,
 }
 
 
+/* Try to acquire all resources registered against @priv in a single
+ * RPC exchange. Returns 0 on success, 1 if the daemon does not
+ * support batched acquisition (nothing has been acquired and the
+ * caller should fall back to acquiring one resource at a time),
+ * -1 on error.
+ */
+static int
+virLockManagerLockDaemonAcquireBatch(virLockManagerLockDaemonPrivatePtr priv,
+                                     virNetClientPtr client,
+                                     virNetClientProgramPtr program,
+                                     int *counter)
+{
+    virLockSpaceProtocolAcquireResourcesArgs args;
+    virLockSpaceProtocolAcquireResourceArgs *res = NULL;
+    int ret = -1;
+    size_t i;
+
+    if (priv->nresources > VIR_LOCK_SPACE_PROTOCOL_RESOURCE_LIST_MAX)
+        return 1;
+
+    memset(&args, 0, sizeof(args));
+
+    if (VIR_ALLOC_N(res, priv->nresources) < 0)
+        return -1;
+
+    for (i = 0; i < priv->nresources; i++) {
+        if (priv->resources[i].lockspace)
+            res[i].path = priv->resources[i].lockspace;
+        res[i].name = priv->resources[i].name;
+        res[i].flags = priv->resources[i].flags;
+    }
+
+    args.resources.resources_len = priv->nresources;
+    args.resources.resources_val = res;
+
+    if (virNetClientProgramCall(program,
+                                client,
+                                (*counter)++,
+                                VIR_LOCK_SPACE_PROTOCOL_PROC_ACQUIRE_RESOURCES,
+                                0, NULL, NULL, NULL,
+                                (xdrproc_t)xdr_virLockSpaceProtocolAcquireResourcesArgs, &args,
+                                (xdrproc_t)xdr_void, NULL) < 0) {
+        virErrorPtr err = virGetLastError();
+
+        /* An older virtlockd rejects the procedure itself with
+         * VIR_ERR_RPC; the batch is all-or-nothing on the server
+         * side, so it is safe to retry resource by resource
+         */
+        if (err &&
+            err->code == VIR_ERR_RPC &&
+            err->domain == VIR_FROM_RPC) {
+            VIR_DEBUG("Lock daemon does not support batched acquisition");
+            virResetLastError();
+            ret = 1;
+        }
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    VIR_FREE(res);
+    return ret;
+}
+
+
 static int virLockManagerLockDaemonAcquire(virLockManagerPtr lock,
                                            const char *state ATTRIBUTE_UNUSED,
                                            unsigned int flags,
@@ -644,24 +710,37 @@ static int virLockManagerLockDaemonAcquire(virLockManagerPtr lock,
 
     if (!(flags & VIR_LOCK_MANAGER_ACQUIRE_REGISTER_ONLY)) {
         size_t i;
-        for (i = 0; i < priv->nresources; i++) {
-            virLockSpaceProtocolAcquireResourceArgs args;
-
-            memset(&args, 0, sizeof(args));
-
-            if (priv->resources[i].lockspace)
-                args.path = priv->resources[i].lockspace;
-            args.name = priv->resources[i].name;
-            args.flags = priv->resources[i].flags;
-
-            if (virNetClientProgramCall(program,
-                                        client,
-                                        counter++,
-                                        VIR_LOCK_SPACE_PROTOCOL_PROC_ACQUIRE_RESOURCE,
-                                        0, NULL, NULL, NULL,
-                                        (xdrproc_t)xdr_virLockSpaceProtocolAcquireResourceArgs, &args,
-                                        (xdrproc_t)xdr_void, NULL) < 0)
-                goto cleanup;
+        int rc = 1;
+
+        /* Acquire all leases in one exchange when there is more than
+         * one; a domain with many disks otherwise pays a round trip
+         * to virtlockd per lease
+         */
+        if (priv->nresources > 1 &&
+            (rc = virLockManagerLockDaemonAcquireBatch(priv, client,
+                                                       program, &counter)) < 0)
+            goto cleanup;
+
+        if (rc > 0) {
+            for (i = 0; i < priv->nresources; i++) {
+                virLockSpaceProtocolAcquireResourceArgs args;
+
+                memset(&args, 0, sizeof(args));
+
+                if (priv->resources[i].lockspace)
+                    args.path = priv->resources[i].lockspace;
+                args.name = priv->resources[i].name;
+                args.flags = priv->resources[i].flags;
+
+                if (virNetClientProgramCall(program,
+                                            client,
+                                            counter++,
+                                            VIR_LOCK_SPACE_PROTOCOL_PROC_ACQUIRE_RESOURCE,
+                                            0, NULL, NULL, NULL,
+                                            (xdrproc_t)xdr_virLockSpaceProtocolAcquireResourceArgs, &args,
+                                            (xdrproc_t)xdr_void, NULL) < 0)
+                    goto cleanup;
+            }
         }
     }
 
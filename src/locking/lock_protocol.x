@@ -18,6 +18,12 @@ typedef string virLockSpaceProtocolNonNullString<VIR_LOCK_SPACE_PROTOCOL_STRING_
 /* A long string, which may be NULL. */
 typedef virLockSpaceProtocolNonNullString *virLockSpaceProtocolString;
 
+/* Upper limit on lists of resources in a single batched acquire.
+ * This is an arbitrary limit designed to stop the decoder from trying
+ * to allocate unbounded amounts of memory when fed with a bad message.
+ */
+const VIR_LOCK_SPACE_PROTOCOL_RESOURCE_LIST_MAX = 1024;
+
 struct virLockSpaceProtocolOwner {
     virLockSpaceProtocolUUID uuid;
     virLockSpaceProtocolNonNullString name;
@@ -57,6 +63,11 @@ struct virLockSpaceProtocolAcquireResourceArgs {
     unsigned int flags;
 };
 
+struct virLockSpaceProtocolAcquireResourcesArgs {
+    virLockSpaceProtocolAcquireResourceArgs resources<VIR_LOCK_SPACE_PROTOCOL_RESOURCE_LIST_MAX>;
+    unsigned int flags;
+};
+
 struct virLockSpaceProtocolReleaseResourceArgs {
     virLockSpaceProtocolNonNullString path;
     virLockSpaceProtocolNonNullString name;
@@ -145,5 +156,11 @@ enum virLockSpaceProtocolProcedure {
      * @generate: none
      * @acl: none
      */
-    VIR_LOCK_SPACE_PROTOCOL_PROC_CREATE_LOCKSPACE = 8
+    VIR_LOCK_SPACE_PROTOCOL_PROC_CREATE_LOCKSPACE = 8,
+
+    /**
+     * @generate: none
+     * @acl: none
+     */
+    VIR_LOCK_SPACE_PROTOCOL_PROC_ACQUIRE_RESOURCES = 9
 };
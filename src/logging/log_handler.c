@@ -30,10 +30,12 @@
 #include "virstring.h"
 #include "virlog.h"
 #include "virrotatingfile.h"
+#include "virutil.h"
 #include "viruuid.h"
 
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/stat.h>
 
 #include "configmake.h"
 
@@ -43,6 +45,15 @@ VIR_LOG_INIT("logging.log_handler");
 
 #define DEFAULT_MODE 0600
 
+/* Size of the per-file buffer used to coalesce pipe data into log
+ * writes; twice the default kernel pipe capacity, so one buffer fill
+ * normally drains the pipe completely */
+#define VIR_LOG_HANDLER_DRAIN_BUF_LEN (128 * 1024)
+
+/* Upper bound on bytes drained per event callback, so one guest
+ * spewing console output cannot starve the other watches */
+#define VIR_LOG_HANDLER_MAX_DRAIN (1024 * 1024)
+
 typedef struct _virLogHandlerLogFile virLogHandlerLogFile;
 typedef virLogHandlerLogFile *virLogHandlerLogFilePtr;
 
@@ -51,6 +62,10 @@ struct _virLogHandlerLogFile {
     int watch;
     int pipefd; /* Read from QEMU via this */
 
+    char *drainbuf; /* lazily allocated coalescing buffer */
+    unsigned long long drainOverflow; /* times the per-event drain
+                                         limit was hit */
+
     char *driver;
     unsigned char domuuid[VIR_UUID_BUFLEN];
     char *domname;
@@ -100,6 +115,7 @@ virLogHandlerLogFileFree(virLogHandlerLogFilePtr file)
     if (file->watch != -1)
         virEventRemoveHandle(file->watch);
 
+    VIR_FREE(file->drainbuf);
     VIR_FREE(file->driver);
     VIR_FREE(file->domname);
     VIR_FREE(file);
@@ -126,11 +142,21 @@ static virLogHandlerLogFilePtr
 virLogHandlerGetLogFileFromWatch(virLogHandlerPtr handler,
                                  int watch)
 {
-    size_t i;
-
-    for (i = 0; i < handler->nfiles; i++) {
-        if (handler->files[i]->watch == watch)
-            return handler->files[i];
+    size_t lo = 0;
+    size_t hi = handler->nfiles;
+
+    /* Watch IDs are handed out monotonically and files are appended
+     * in registration order, so the array is sorted by watch and a
+     * binary search keeps this O(log n) with hundreds of pipes */
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (handler->files[mid]->watch == watch)
+            return handler->files[mid];
+        if (handler->files[mid]->watch < watch)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
 
     return NULL;
@@ -145,8 +171,10 @@ virLogHandlerDomainLogFileEvent(int watch,
 {
     virLogHandlerPtr handler = opaque;
     virLogHandlerLogFilePtr logfile;
-    char buf[1024];
     ssize_t len;
+    size_t buffered;
+    size_t drained = 0;
+    bool eof = false;
 
     virObjectLock(handler);
     logfile = virLogHandlerGetLogFileFromWatch(handler, watch);
@@ -156,21 +184,61 @@ virLogHandlerDomainLogFileEvent(int watch,
         return;
     }
 
- reread:
-    len = read(fd, buf, sizeof(buf));
-    if (len < 0) {
-        if (errno == EINTR)
-            goto reread;
-
-        virReportSystemError(errno, "%s",
-                             _("Unable to read from log pipe"));
+    if (!logfile->drainbuf &&
+        VIR_ALLOC_N(logfile->drainbuf, VIR_LOG_HANDLER_DRAIN_BUF_LEN) < 0)
         goto error;
-    }
 
-    if (virRotatingFileWriterAppend(logfile->file, buf, len) != len)
-        goto error;
+    /* Coalesce as much pipe data as possible into each log write, so
+     * a guest spewing console output costs one write per buffer fill
+     * rather than one per small chunk */
+    for (;;) {
+        buffered = 0;
+
+        while (buffered < VIR_LOG_HANDLER_DRAIN_BUF_LEN) {
+            len = read(fd, logfile->drainbuf + buffered,
+                       VIR_LOG_HANDLER_DRAIN_BUF_LEN - buffered);
+            if (len < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    break;
+
+                virReportSystemError(errno, "%s",
+                                     _("Unable to read from log pipe"));
+                goto error;
+            }
+            if (len == 0) {
+                eof = true;
+                break;
+            }
+            buffered += len;
+        }
+
+        if (buffered &&
+            virRotatingFileWriterAppend(logfile->file, logfile->drainbuf,
+                                        buffered) != (ssize_t) buffered)
+            goto error;
+
+        drained += buffered;
+
+        if (eof || buffered < VIR_LOG_HANDLER_DRAIN_BUF_LEN)
+            break;
 
-    if (events & VIR_EVENT_HANDLE_HANGUP)
+        /* On hangup keep going until the pipe is empty, since this is
+         * the last chance to get the data; otherwise leave the rest
+         * for the next (level triggered) event callback */
+        if (drained >= VIR_LOG_HANDLER_MAX_DRAIN &&
+            !(events & VIR_EVENT_HANDLE_HANGUP)) {
+            logfile->drainOverflow++;
+            VIR_DEBUG("Drain limit hit on '%s' after %zu bytes "
+                      "(%llu times so far)",
+                      virRotatingFileWriterGetPath(logfile->file),
+                      drained, logfile->drainOverflow);
+            break;
+        }
+    }
+
+    if (eof || (events & VIR_EVENT_HANDLE_HANGUP))
         goto error;
 
     virObjectUnlock(handler);
@@ -275,6 +343,11 @@ virLogHandlerLogFilePostExecRestart(virLogHandlerPtr handler,
                              _("Cannot enable close-on-exec flag"));
         goto error;
     }
+    if (virSetNonBlock(file->pipefd) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Cannot enable non-blocking flag"));
+        goto error;
+    }
 
     return file;
 
@@ -393,6 +466,11 @@ virLogHandlerDomainOpenLogFile(virLogHandlerPtr handler,
                              _("Cannot open fifo pipe"));
         goto error;
     }
+    if (virSetNonBlock(pipefd[0]) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Cannot enable non-blocking flag"));
+        goto error;
+    }
     if (VIR_ALLOC(file) < 0)
         goto error;
 
@@ -463,9 +541,23 @@ virLogHandlerDomainGetLogFilePosition(virLogHandlerPtr handler,
     }
 
     if (!file) {
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("No open log file %s"),
-                       path);
+        struct stat sb;
+
+        /* Not an open log (e.g. the domain is shut off); answer from
+         * the file itself so callers can still compute tail offsets
+         * for virLogHandlerDomainReadLogFile instead of having to
+         * scan the whole log from offset 0 */
+        if (stat(path, &sb) < 0) {
+            virReportSystemError(errno,
+                                 _("Unable to access %s"),
+                                 path);
+            goto cleanup;
+        }
+
+        *inode = sb.st_ino;
+        *offset = sb.st_size;
+
+        ret = 0;
         goto cleanup;
     }
 
@@ -95,13 +95,26 @@ struct _virLXCControllerConsole {
     int epollFd; /* epoll FD for dealing with EOF */
 
     size_t fromHostLen;
-    char fromHostBuf[1024];
+    size_t fromHostSize;
+    char *fromHostBuf;
     size_t fromContLen;
-    char fromContBuf[1024];
+    size_t fromContSize;
+    char *fromContBuf;
+
+    /* Cumulative bytes relayed in each direction, reported when
+     * the console is torn down */
+    unsigned long long fromHostTotal;
+    unsigned long long fromContTotal;
 
     virNetDaemonPtr daemon;
 };
 
+/* Initial size of a console relay buffer; doubled up to the max
+ * whenever a single read fills it, so consoles streaming bulk data
+ * move more per event loop wakeup */
+#define VIR_LXC_CONTROLLER_CONSOLE_BUF_MIN 1024
+#define VIR_LXC_CONTROLLER_CONSOLE_BUF_MAX (64 * 1024)
+
 typedef struct _virLXCController virLXCController;
 typedef virLXCController *virLXCControllerPtr;
 struct _virLXCController {
@@ -237,6 +250,9 @@ static void virLXCControllerStopInit(virLXCControllerPtr ctrl)
 
 static void virLXCControllerConsoleClose(virLXCControllerConsolePtr console)
 {
+    VIR_DEBUG("Relayed %llu bytes from host, %llu bytes from container",
+              console->fromHostTotal, console->fromContTotal);
+
     if (console->hostWatch != -1)
         virEventRemoveHandle(console->hostWatch);
     VIR_FORCE_CLOSE(console->hostFd);
@@ -248,6 +264,9 @@ static void virLXCControllerConsoleClose(virLXCControllerConsolePtr console)
     if (console->epollWatch != -1)
         virEventRemoveHandle(console->epollWatch);
     VIR_FORCE_CLOSE(console->epollFd);
+
+    VIR_FREE(console->fromHostBuf);
+    VIR_FREE(console->fromContBuf);
 }
 
 
@@ -318,6 +337,16 @@ static int virLXCControllerAddConsole(virLXCControllerPtr ctrl,
 
     ctrl->consoles[ctrl->nconsoles-1].epollFd = -1;
     ctrl->consoles[ctrl->nconsoles-1].epollWatch = -1;
+
+    if (VIR_ALLOC_N(ctrl->consoles[ctrl->nconsoles-1].fromHostBuf,
+                    VIR_LXC_CONTROLLER_CONSOLE_BUF_MIN) < 0 ||
+        VIR_ALLOC_N(ctrl->consoles[ctrl->nconsoles-1].fromContBuf,
+                    VIR_LXC_CONTROLLER_CONSOLE_BUF_MIN) < 0)
+        return -1;
+    ctrl->consoles[ctrl->nconsoles-1].fromHostSize =
+        VIR_LXC_CONTROLLER_CONSOLE_BUF_MIN;
+    ctrl->consoles[ctrl->nconsoles-1].fromContSize =
+        VIR_LXC_CONTROLLER_CONSOLE_BUF_MIN;
     return 0;
 }
 
@@ -1043,7 +1072,7 @@ static void virLXCControllerConsoleUpdateWatch(virLXCControllerConsolePtr consol
 
     /* If host console is open, then we can look to read/write */
     if (!console->hostClosed) {
-        if (console->fromHostLen < sizeof(console->fromHostBuf))
+        if (console->fromHostLen < console->fromHostSize)
             hostEvents |= VIR_EVENT_HANDLE_READABLE;
         if (console->fromContLen)
             hostEvents |= VIR_EVENT_HANDLE_WRITABLE;
@@ -1051,7 +1080,7 @@ static void virLXCControllerConsoleUpdateWatch(virLXCControllerConsolePtr consol
 
     /* If cont console is open, then we can look to read/write */
     if (!console->contClosed) {
-        if (console->fromContLen < sizeof(console->fromContBuf))
+        if (console->fromContLen < console->fromContSize)
             contEvents |= VIR_EVENT_HANDLE_READABLE;
         if (console->fromHostLen)
             contEvents |= VIR_EVENT_HANDLE_WRITABLE;
@@ -1200,21 +1229,26 @@ static void virLXCControllerConsoleIO(int watch, int fd, int events, void *opaqu
               console->fromHostLen,
               console->fromContLen);
     if (events & VIR_EVENT_HANDLE_READABLE) {
-        char *buf;
+        char **buf;
         size_t *len;
+        size_t *size;
+        unsigned long long *total;
         size_t avail;
         ssize_t done;
         if (watch == console->hostWatch) {
-            buf = console->fromHostBuf;
+            buf = &console->fromHostBuf;
             len = &console->fromHostLen;
-            avail = sizeof(console->fromHostBuf) - *len;
+            size = &console->fromHostSize;
+            total = &console->fromHostTotal;
         } else {
-            buf = console->fromContBuf;
+            buf = &console->fromContBuf;
             len = &console->fromContLen;
-            avail = sizeof(console->fromContBuf) - *len;
+            size = &console->fromContSize;
+            total = &console->fromContTotal;
         }
      reread:
-        done = read(fd, buf + *len, avail);
+        avail = *size - *len;
+        done = read(fd, *buf + *len, avail);
         if (done == -1 && errno == EINTR)
             goto reread;
         if (done == -1 && errno != EAGAIN) {
@@ -1224,6 +1258,17 @@ static void virLXCControllerConsoleIO(int watch, int fd, int events, void *opaqu
         }
         if (done > 0) {
             *len += done;
+            *total += done;
+            /* A read filling the whole buffer suggests more data is
+             * pending; grow the buffer and drain the rest in this
+             * wakeup instead of one bufferful per loop iteration */
+            if ((size_t)done == avail &&
+                *size < VIR_LXC_CONTROLLER_CONSOLE_BUF_MAX) {
+                if (VIR_REALLOC_N(*buf, *size * 2) < 0)
+                    goto error;
+                *size *= 2;
+                goto reread;
+            }
         } else {
             VIR_DEBUG("Read fd %d done %d errno %d", fd, (int)done, errno);
         }
@@ -1170,6 +1170,51 @@ virLXCProcessEnsureRootFS(virDomainObjPtr vm)
     return -1;
 }
 
+/* Probing the controller mounts means parsing /proc/self/cgroup and
+ * /proc/mounts, which is needless to repeat for every container in a
+ * startup burst; remember a successful probe, since controller mounts
+ * do not come and go while the driver is running */
+static int virLXCProcessCgroupsValid;
+
+static int
+virLXCProcessValidateCgroups(void)
+{
+    virCgroupPtr selfcgroup;
+
+    if (virAtomicIntGet(&virLXCProcessCgroupsValid))
+        return 0;
+
+    if (virCgroupNewSelf(&selfcgroup) < 0)
+        return -1;
+
+    if (!virCgroupHasController(selfcgroup,
+                                VIR_CGROUP_CONTROLLER_CPUACCT)) {
+        virCgroupFree(&selfcgroup);
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to find 'cpuacct' cgroups controller mount"));
+        return -1;
+    }
+    if (!virCgroupHasController(selfcgroup,
+                                VIR_CGROUP_CONTROLLER_DEVICES)) {
+        virCgroupFree(&selfcgroup);
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to find 'devices' cgroups controller mount"));
+        return -1;
+    }
+    if (!virCgroupHasController(selfcgroup,
+                                VIR_CGROUP_CONTROLLER_MEMORY)) {
+        virCgroupFree(&selfcgroup);
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to find 'memory' cgroups controller mount"));
+        return -1;
+    }
+    virCgroupFree(&selfcgroup);
+
+    virAtomicIntSet(&virLXCProcessCgroupsValid, 1);
+    return 0;
+}
+
+
 /**
  * virLXCProcessStart:
  * @conn: pointer to connection
@@ -1207,37 +1252,13 @@ int virLXCProcessStart(virConnectPtr conn,
     virCapsPtr caps = NULL;
     virErrorPtr err = NULL;
     virLXCDriverConfigPtr cfg = virLXCDriverGetConfig(driver);
-    virCgroupPtr selfcgroup;
     int status;
     char *pidfile = NULL;
     bool clearSeclabel = false;
     bool need_stop = false;
 
-    if (virCgroupNewSelf(&selfcgroup) < 0)
-        return -1;
-
-    if (!virCgroupHasController(selfcgroup,
-                                VIR_CGROUP_CONTROLLER_CPUACCT)) {
-        virCgroupFree(&selfcgroup);
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Unable to find 'cpuacct' cgroups controller mount"));
+    if (virLXCProcessValidateCgroups() < 0)
         return -1;
-    }
-    if (!virCgroupHasController(selfcgroup,
-                                VIR_CGROUP_CONTROLLER_DEVICES)) {
-        virCgroupFree(&selfcgroup);
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Unable to find 'devices' cgroups controller mount"));
-        return -1;
-    }
-    if (!virCgroupHasController(selfcgroup,
-                                VIR_CGROUP_CONTROLLER_MEMORY)) {
-        virCgroupFree(&selfcgroup);
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Unable to find 'memory' cgroups controller mount"));
-        return -1;
-    }
-    virCgroupFree(&selfcgroup);
 
     if (vm->def->nconsoles == 0) {
         virReportError(VIR_ERR_CONFIG_UNSUPPORTED, "%s",
@@ -1365,7 +1386,8 @@ int virLXCProcessStart(virConnectPtr conn,
         VIR_FREE(vm->def->consoles[i]->source->data.file.path);
         vm->def->consoles[i]->source->data.file.path = ttyPath;
 
-        VIR_FREE(vm->def->consoles[i]->info.alias);
+        virStringInternFree(vm->def->consoles[i]->info.alias);
+        vm->def->consoles[i]->info.alias = NULL;
         if (virAsprintf(&vm->def->consoles[i]->info.alias, "console%zu", i) < 0)
             goto cleanup;
     }
@@ -257,6 +257,29 @@ networkDnsmasqLeaseFileNameCustom(virNetworkDriverStatePtr driver,
     return leasefile;
 }
 
+/* Parsed contents of a custom lease file, kept in
+ * driver->dhcpLeasesCache and keyed by the bridge name. The lease
+ * helper rewrites the file atomically via rename, so the inode,
+ * mtime and size together identify the parsed revision. */
+typedef struct _networkDnsmasqLeases networkDnsmasqLeases;
+typedef networkDnsmasqLeases *networkDnsmasqLeasesPtr;
+struct _networkDnsmasqLeases {
+    ino_t inode;
+    time_t mtime;
+    off_t size;
+    virJSONValuePtr leases;
+};
+
+static void
+networkDnsmasqLeasesFree(void *payload,
+                         const void *name ATTRIBUTE_UNUSED)
+{
+    networkDnsmasqLeasesPtr cache = payload;
+
+    virJSONValueFree(cache->leases);
+    VIR_FREE(cache);
+}
+
 static char *
 networkDnsmasqConfigFileName(virNetworkDriverStatePtr driver,
                              const char *netname)
@@ -350,6 +373,11 @@ networkRemoveInactive(virNetworkDriverStatePtr driver,
     unlink(customleasefile);
     unlink(configfile);
 
+    /* drop the cached parse of the custom lease file */
+    networkDriverLock(driver);
+    ignore_value(virHashRemoveEntry(driver->dhcpLeasesCache, def->bridge));
+    networkDriverUnlock(driver);
+
     /* MAC map manager */
     unlink(macMapFile);
 
@@ -754,6 +782,10 @@ networkStateInitialize(bool privileged,
     if (!(network_driver->networks = virNetworkObjListNew()))
         goto error;
 
+    if (!(network_driver->dhcpLeasesCache = virHashCreate(10,
+                                                          networkDnsmasqLeasesFree)))
+        goto error;
+
     if (virNetworkLoadAllState(network_driver->networks,
                                network_driver->stateDir) < 0)
         goto error;
@@ -872,6 +904,8 @@ networkStateCleanup(void)
     /* free inactive networks */
     virObjectUnref(network_driver->networks);
 
+    virHashFree(network_driver->dhcpLeasesCache);
+
     VIR_FREE(network_driver->networkConfigDir);
     VIR_FREE(network_driver->networkAutostartDir);
     VIR_FREE(network_driver->stateDir);
@@ -3882,6 +3916,118 @@ static int networkSetAutostart(virNetworkPtr net,
     return ret;
 }
 
+/**
+ * networkGetDnsmasqLeases:
+ *
+ * Return the parsed array of leases from @bridge's custom lease file.
+ * The file is read and parsed only when it changed since the previous
+ * call; otherwise a copy of the cached parse is handed out, which
+ * keeps frequent lease polling cheap even for networks with many
+ * thousands of leases.
+ *
+ * Returns 0 on success with *leases set to a caller-owned array, or
+ * to NULL if the lease file is missing or empty; -1 on failure.
+ */
+static int
+networkGetDnsmasqLeases(virNetworkDriverStatePtr driver,
+                        const char *bridge,
+                        virJSONValuePtr *leases)
+{
+    char *lease_file = NULL;
+    char *lease_entries = NULL;
+    size_t lease_len = 0;
+    bool mapped = false;
+    virJSONValuePtr leases_array = NULL;
+    networkDnsmasqLeasesPtr cache;
+    struct stat sb;
+    int len;
+    int ret = -1;
+
+    *leases = NULL;
+
+    if (!(lease_file = networkDnsmasqLeaseFileNameCustom(driver, bridge)))
+        return -1;
+
+    /* Even though src/network/leaseshelper.c guarantees the existence of
+     * the lease file, treat a missing one as an empty set of leases
+     * instead of reporting an error */
+    if (stat(lease_file, &sb) < 0 || sb.st_size == 0) {
+        ret = 0;
+        goto cleanup;
+    }
+
+    networkDriverLock(driver);
+    cache = virHashLookup(driver->dhcpLeasesCache, bridge);
+    if (cache &&
+        cache->inode == sb.st_ino &&
+        cache->mtime == sb.st_mtime &&
+        cache->size == sb.st_size) {
+        *leases = virJSONValueCopy(cache->leases);
+        networkDriverUnlock(driver);
+        if (!*leases)
+            goto cleanup;
+        ret = 0;
+        goto cleanup;
+    }
+    networkDriverUnlock(driver);
+
+    /* Map large lease files so the kernel reads them ahead while the
+     * beginning is already being parsed; fall back to a plain read */
+    if (sb.st_size <= VIR_NETWORK_DHCP_LEASE_FILE_SIZE_MAX &&
+        virFileMapRead(lease_file, &lease_entries, &lease_len) == 0) {
+        mapped = true;
+    } else if ((len = virFileReadAll(lease_file,
+                                     VIR_NETWORK_DHCP_LEASE_FILE_SIZE_MAX,
+                                     &lease_entries)) < 0) {
+        ret = 0;
+        goto cleanup;
+    } else {
+        lease_len = len;
+    }
+
+    if (lease_len == 0) {
+        ret = 0;
+        goto cleanup;
+    }
+
+    if (!(leases_array = virJSONValueFromString(lease_entries))) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("invalid json in file: %s"), lease_file);
+        goto cleanup;
+    }
+
+    /* Remember the parse for the next query. The lease helper may have
+     * rewritten the file between the stat and the read above; the
+     * recorded identity is then stale, which merely costs one extra
+     * parse on the next query. Failure to cache is not fatal either. */
+    if (VIR_ALLOC_QUIET(cache) == 0) {
+        cache->inode = sb.st_ino;
+        cache->mtime = sb.st_mtime;
+        cache->size = sb.st_size;
+        if (!(cache->leases = virJSONValueCopy(leases_array))) {
+            VIR_FREE(cache);
+        } else {
+            networkDriverLock(driver);
+            if (virHashUpdateEntry(driver->dhcpLeasesCache, bridge, cache) < 0)
+                networkDnsmasqLeasesFree(cache, NULL);
+            networkDriverUnlock(driver);
+        }
+    }
+
+    *leases = leases_array;
+    leases_array = NULL;
+    ret = 0;
+
+ cleanup:
+    VIR_FREE(lease_file);
+    if (mapped)
+        virFileMapReadFree(lease_entries, lease_len);
+    else
+        VIR_FREE(lease_entries);
+    virJSONValueFree(leases_array);
+    return ret;
+}
+
 static int
 networkGetDHCPLeases(virNetworkPtr network,
                      const char *mac,
@@ -3893,13 +4039,10 @@ networkGetDHCPLeases(virNetworkPtr network,
     size_t nleases = 0;
     int rv = -1;
     ssize_t size = 0;
-    int custom_lease_file_len = 0;
     bool need_results = !!leases;
     long long currtime = 0;
     long long expirytime_tmp = -1;
     bool ipv6 = false;
-    char *lease_entries = NULL;
-    char *custom_lease_file = NULL;
     const char *ip_tmp = NULL;
     const char *mac_tmp = NULL;
     virJSONValuePtr lease_tmp = NULL;
@@ -3924,32 +4067,14 @@ networkGetDHCPLeases(virNetworkPtr network,
     if (virNetworkGetDHCPLeasesEnsureACL(network->conn, obj->def) < 0)
         goto cleanup;
 
-    /* Retrieve custom leases file location */
-    custom_lease_file = networkDnsmasqLeaseFileNameCustom(driver, obj->def->bridge);
-
-    /* Read entire contents */
-    if ((custom_lease_file_len = virFileReadAll(custom_lease_file,
-                                                VIR_NETWORK_DHCP_LEASE_FILE_SIZE_MAX,
-                                                &lease_entries)) < 0) {
-        /* Even though src/network/leaseshelper.c guarantees the existence of
-         * leases file (even if no leases are present), and the control reaches
-         * here, instead of reporting error, return 0 leases */
-        rv = 0;
+    if (networkGetDnsmasqLeases(driver, obj->def->bridge, &leases_array) < 0)
         goto error;
-    }
 
-    if (custom_lease_file_len) {
-        if (!(leases_array = virJSONValueFromString(lease_entries))) {
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("invalid json in file: %s"), custom_lease_file);
-            goto error;
-        }
-
-        if ((size = virJSONValueArraySize(leases_array)) < 0) {
-            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                           _("couldn't fetch array of leases"));
-            goto error;
-        }
+    if (leases_array &&
+        (size = virJSONValueArraySize(leases_array)) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("couldn't fetch array of leases"));
+        goto error;
     }
 
     currtime = (long long) time(NULL);
@@ -4053,8 +4178,6 @@ networkGetDHCPLeases(virNetworkPtr network,
 
  cleanup:
     VIR_FREE(lease);
-    VIR_FREE(lease_entries);
-    VIR_FREE(custom_lease_file);
     virJSONValueFree(leases_array);
 
     virNetworkObjEndAPI(&obj);
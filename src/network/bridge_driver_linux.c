@@ -643,7 +643,10 @@ int networkAddFirewallRules(virNetworkDefPtr def)
 
     fw = virFirewallNew();
 
-    virFirewallStartTransaction(fw, 0);
+    /* a routed/NATed network adds a dozen or more iptables rules;
+     * let consecutive ones be applied in one iptables-restore
+     * process instead of one fork/exec per rule */
+    virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_AUTO_BATCH);
 
     networkAddGeneralFirewallRules(fw, def);
 
@@ -26,6 +26,7 @@
 
 # include "internal.h"
 # include "virthread.h"
+# include "virhash.h"
 # include "virdnsmasq.h"
 # include "network_conf.h"
 # include "object_event.h"
@@ -52,6 +53,10 @@ struct _virNetworkDriverState {
 
     /* Immutable pointer, self-locking APIs */
     virObjectEventStatePtr networkEventState;
+
+    /* Requires the driver lock for access; maps a bridge device name
+     * to the parsed contents of its dnsmasq custom lease file */
+    virHashTablePtr dhcpLeasesCache;
 };
 
 typedef struct _virNetworkDriverState virNetworkDriverState;
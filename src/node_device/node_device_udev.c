@@ -43,6 +43,7 @@
 #include "virpci.h"
 #include "virstring.h"
 #include "virnetdev.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_NODEDEV
 
@@ -56,6 +57,8 @@ struct _udevPrivate {
     struct udev_monitor *udev_monitor;
     int watch;
     bool privileged;
+    virThread initThread;       /* runs the initial device enumeration */
+    bool initThreadStarted;
 };
 
 
@@ -1234,10 +1237,14 @@ static int udevEnumerateDevices(struct udev *udev)
         goto cleanup;
     }
 
+    /* Take the driver lock per device rather than around the whole
+     * walk so that API calls and udev events interleave with the
+     * potentially long initial enumeration */
     udev_list_entry_foreach(list_entry,
                             udev_enumerate_get_list_entry(udev_enumerate)) {
-
+        nodeDeviceLock();
         udevProcessDeviceListEntry(udev, list_entry);
+        nodeDeviceUnlock();
     }
 
  cleanup:
@@ -1267,12 +1274,17 @@ static int nodeStateCleanup(void)
     if (!driver)
         return -1;
 
+    priv = driver->privateData;
+
+    /* Make sure the enumeration thread is gone before the driver
+     * lock and device list are torn down under its feet */
+    if (priv && priv->initThreadStarted)
+        virThreadJoin(&priv->initThread);
+
     nodeDeviceLock();
 
     virObjectUnref(driver->nodeDeviceEventState);
 
-    priv = driver->privateData;
-
     if (priv) {
         if (priv->watch != -1)
             virEventRemoveHandle(priv->watch);
@@ -1457,6 +1469,17 @@ static int udevPCITranslateInit(bool privileged ATTRIBUTE_UNUSED)
     return 0;
 }
 
+static void nodeStateInitializeEnumerate(void *opaque)
+{
+    struct udev *udev = opaque;
+
+    if (udevEnumerateDevices(udev) != 0)
+        VIR_WARN("udev device enumeration failed");
+
+    udev_unref(udev);
+}
+
+
 static int nodeStateInitialize(bool privileged,
                                virStateInhibitCallback callback ATTRIBUTE_UNUSED,
                                void *opaque ATTRIBUTE_UNUSED)
@@ -1530,10 +1553,21 @@ static int nodeStateInitialize(bool privileged,
     if (udevSetupSystemDev() != 0)
         goto cleanup;
 
-    /* Populate with known devices */
-
-    if (udevEnumerateDevices(udev) != 0)
+    /* Populate with known devices. The enumeration can take tens of
+     * seconds on hosts with many SCSI LUNs, so it runs in a separate
+     * thread and overlaps with the startup of the remaining drivers.
+     * Devices appearing in the meantime are caught by the already
+     * registered monitor callback. The thread holds its own reference
+     * on the udev context. */
+    udev_ref(udev);
+    if (virThreadCreate(&priv->initThread, true,
+                        nodeStateInitializeEnumerate, udev) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("failed to create udev enumerate thread"));
+        udev_unref(udev);
         goto cleanup;
+    }
+    priv->initThreadStarted = true;
 
     ret = 0;
 
@@ -92,6 +92,9 @@ struct virNWFilterSnoopState {
     virMutex             snoopLock;  /* protects SnoopReqs and IfNameToKey */
     virHashTablePtr      active;
     virMutex             activeLock; /* protects Active */
+    /* decode pool shared by all interfaces */
+    virThreadPoolPtr     decodePool;
+    int                  nDecodeJobs; /* number of scheduled decode batches */
 };
 
 # define virNWFilterSnoopLock() \
@@ -119,6 +122,9 @@ typedef virNWFilterSnoopReq *virNWFilterSnoopReqPtr;
 typedef struct _virNWFilterSnoopIPLease virNWFilterSnoopIPLease;
 typedef virNWFilterSnoopIPLease *virNWFilterSnoopIPLeasePtr;
 
+typedef struct _virNWFilterDHCPDecodeJob virNWFilterDHCPDecodeJob;
+typedef virNWFilterDHCPDecodeJob *virNWFilterDHCPDecodeJobPtr;
+
 typedef enum {
     THREAD_STATUS_NONE,
     THREAD_STATUS_OK,
@@ -151,7 +157,15 @@ struct _virNWFilterSnoopReq {
     virCond                              threadStatusCond;
 
     int                                  jobCompletionStatus;
-    /* the number of submitted jobs in the worker's queue */
+
+    /* queue of captured packets waiting to be decoded; the shared
+     * decode pool processes one batch per interface at a time so
+     * that a VM's DHCP messages keep their order */
+    virNWFilterDHCPDecodeJobPtr          jobHead;
+    virNWFilterDHCPDecodeJobPtr          jobTail;
+    bool                                 jobScheduled;
+    int                                  nQueuedJobs;
+
     /*
      * protect those members that can change while the
      * req is on the public SnoopReq hash and
@@ -162,6 +176,7 @@ struct _virNWFilterSnoopReq {
      * - end
      * - a lease while it is on the list
      * - threadStatus
+     * - jobHead, jobTail and jobScheduled
      * (for refctr, see above)
      */
     virMutex                             lock;
@@ -237,20 +252,25 @@ struct _virNWFilterSnoopDHCPHdr {
 # define PCAP_READ_MAXERRS          25 /* retries on failing device */
 # define PCAP_FLOOD_TIMEOUT_MS      10 /* ms */
 
-typedef struct _virNWFilterDHCPDecodeJob virNWFilterDHCPDecodeJob;
-typedef virNWFilterDHCPDecodeJob *virNWFilterDHCPDecodeJobPtr;
-
 struct _virNWFilterDHCPDecodeJob {
     unsigned char packet[PCAP_PBUFSIZE];
     int caplen;
     bool fromVM;
-    int *qCtr;
+    virNWFilterDHCPDecodeJobPtr next;
 };
 
 # define DHCP_PKT_RATE          10 /* pkts/sec */
 # define DHCP_PKT_BURST         50 /* pkts/sec */
 # define DHCP_BURST_INTERVAL_S  10 /* sec */
 
+/*
+ * upper bound of decode pool workers; DHCP traffic is rate-limited
+ * per interface so a few workers keep up with hundreds of snooped
+ * interfaces, where previously every interface ran its own worker
+ * thread
+ */
+# define DHCP_DECODE_WORKERS_MAX 4
+
 /*
  * libpcap 1.5 requires a 128kb buffer
  * 128 kb is bigger than (DHCP_PKT_BURST * PCAP_PBUFSIZE / 2)
@@ -280,7 +300,6 @@ struct _virNWFilterSnoopPcapConf {
     const pcap_direction_t dir;
     const char *filter;
     virNWFilterSnoopRateLimitConf rateLimit; /* indep. rate limiters */
-    int qCtr; /* number of jobs in the worker's queue */
     const unsigned int maxQSize;
     unsigned long long penaltyTimeoutAbs;
 };
@@ -620,6 +639,7 @@ static void
 virNWFilterSnoopReqFree(virNWFilterSnoopReqPtr req)
 {
     virNWFilterSnoopIPLeasePtr ipl;
+    virNWFilterDHCPDecodeJobPtr job;
 
     if (!req)
         return;
@@ -631,6 +651,13 @@ virNWFilterSnoopReqFree(virNWFilterSnoopReqPtr req)
     for (ipl = req->start; ipl; ipl = req->start)
         virNWFilterSnoopReqLeaseDel(req, &ipl->ipAddress, false, false);
 
+    /* free all queued decode jobs; no decode batch can still be
+     * scheduled since a scheduled batch holds a reference to the req */
+    while ((job = req->jobHead)) {
+        req->jobHead = job->next;
+        VIR_FREE(job);
+    }
+
     /* free all req data */
     VIR_FREE(req->ifname);
     VIR_FREE(req->linkdev);
@@ -1156,38 +1183,66 @@ virNWFilterSnoopDHCPOpen(const char *ifname, virMacAddr *mac,
 }
 
 /*
- * Worker function to decode the DHCP message and with that
- * also do the time-consuming work of instantiating the filters
+ * Worker function to decode the DHCP messages of one interface and
+ * with that also do the time-consuming work of instantiating the
+ * filters. Runs on the decode pool shared by all interfaces; only one
+ * batch per interface is scheduled at a time so that a VM's DHCP
+ * messages keep their order, while different interfaces are decoded
+ * concurrently.
  */
-static void virNWFilterDHCPDecodeWorker(void *jobdata, void *opaque)
+static void virNWFilterDHCPDecodeWorker(void *jobdata,
+                                        void *opaque ATTRIBUTE_UNUSED)
 {
-    virNWFilterSnoopReqPtr req = opaque;
-    virNWFilterDHCPDecodeJobPtr job = jobdata;
-    virNWFilterSnoopEthHdrPtr packet = (virNWFilterSnoopEthHdrPtr)job->packet;
+    virNWFilterSnoopReqPtr req = jobdata;
+    virNWFilterDHCPDecodeJobPtr job, jobs;
 
-    if (virNWFilterSnoopDHCPDecode(req, packet,
-                                   job->caplen, job->fromVM) == -1) {
-        req->jobCompletionStatus = -1;
+    for (;;) {
+        /* protect req->jobHead, req->jobTail & req->jobScheduled */
+        virNWFilterSnoopReqLock(req);
 
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("Instantiation of rules failed on "
-                         "interface '%s'"), req->ifname);
+        jobs = req->jobHead;
+        req->jobHead = req->jobTail = NULL;
+
+        if (!jobs) {
+            req->jobScheduled = false;
+            virNWFilterSnoopReqUnlock(req);
+            break;
+        }
+
+        virNWFilterSnoopReqUnlock(req);
+
+        while ((job = jobs)) {
+            jobs = job->next;
+
+            if (virNWFilterSnoopDHCPDecode(req,
+                              (virNWFilterSnoopEthHdrPtr)job->packet,
+                              job->caplen, job->fromVM) == -1) {
+                req->jobCompletionStatus = -1;
+
+                virReportError(VIR_ERR_INTERNAL_ERROR,
+                               _("Instantiation of rules failed on "
+                                 "interface '%s'"), req->ifname);
+            }
+            virAtomicIntDecAndTest(&req->nQueuedJobs);
+            VIR_FREE(job);
+        }
     }
-    virAtomicIntDecAndTest(job->qCtr);
-    VIR_FREE(job);
+
+    virAtomicIntDecAndTest(&virNWFilterSnoopState.nDecodeJobs);
+    virNWFilterSnoopReqPut(req);
 }
 
 /*
- * Submit a job to the worker thread doing the time-consuming work...
+ * Queue a captured packet on the request and, unless a batch for this
+ * interface is already scheduled, submit one to the shared decode pool
+ * doing the time-consuming work...
  */
 static int
-virNWFilterSnoopDHCPDecodeJobSubmit(virThreadPoolPtr pool,
+virNWFilterSnoopDHCPDecodeJobSubmit(virNWFilterSnoopReqPtr req,
                                     virNWFilterSnoopEthHdrPtr pep,
-                                    int len, pcap_direction_t dir,
-                                    int *qCtr)
+                                    int len, pcap_direction_t dir)
 {
     virNWFilterDHCPDecodeJobPtr job;
-    int ret;
 
     if (len <= MIN_VALID_DHCP_PKT_SIZE || len > sizeof(job->packet))
         return 0;
@@ -1198,16 +1253,45 @@ virNWFilterSnoopDHCPDecodeJobSubmit(virThreadPoolPtr pool,
     memcpy(job->packet, pep, len);
     job->caplen = len;
     job->fromVM = (dir == PCAP_D_IN);
-    job->qCtr = qCtr;
 
-    ret = virThreadPoolSendJob(pool, 0, job);
+    /* protect req->jobHead, req->jobTail & req->jobScheduled */
+    virNWFilterSnoopReqLock(req);
 
-    if (ret == 0)
-        virAtomicIntInc(qCtr);
+    if (req->jobTail)
+        req->jobTail->next = job;
     else
-        VIR_FREE(job);
+        req->jobHead = job;
+    req->jobTail = job;
+    virAtomicIntInc(&req->nQueuedJobs);
 
-    return ret;
+    if (!req->jobScheduled) {
+        req->jobScheduled = true;
+        /* the scheduled batch keeps the req alive */
+        virNWFilterSnoopReqGet(req);
+        virAtomicIntInc(&virNWFilterSnoopState.nDecodeJobs);
+
+        if (virThreadPoolSendJob(virNWFilterSnoopState.decodePool,
+                                 0, req) < 0) {
+            req->jobScheduled = false;
+            virAtomicIntDecAndTest(&virNWFilterSnoopState.nDecodeJobs);
+
+            /* no batch will run; drop everything that is queued */
+            while ((job = req->jobHead)) {
+                req->jobHead = job->next;
+                virAtomicIntDecAndTest(&req->nQueuedJobs);
+                VIR_FREE(job);
+            }
+            req->jobTail = NULL;
+
+            virNWFilterSnoopReqUnlock(req);
+            virNWFilterSnoopReqPut(req);
+            return -1;
+        }
+    }
+
+    virNWFilterSnoopReqUnlock(req);
+
+    return 0;
 }
 
 /*
@@ -1329,8 +1413,8 @@ virNWFilterSnoopAdjustPoll(virNWFilterSnoopPcapConfPtr pc,
 
 /*
  * The DHCP snooping thread. It spends most of its time in the pcap
- * library and if it gets suitable packets, it submits them to the worker
- * thread for processing.
+ * library and if it gets suitable packets, it queues them for the
+ * shared decode pool for processing.
  */
 static void
 virNWFilterDHCPSnoopThread(void *req0)
@@ -1343,7 +1427,6 @@ virNWFilterDHCPSnoopThread(void *req0)
     int tmp = -1, rv, n, pollTo;
     size_t i;
     char *threadkey = NULL;
-    virThreadPoolPtr worker = NULL;
     time_t last_displayed = 0, last_displayed_queue = 0;
     virNWFilterSnoopPcapConf pcapConf[] = {
         {
@@ -1397,13 +1480,10 @@ virNWFilterDHCPSnoopThread(void *req0)
         }
         tmp = virNetDevGetIndex(req->ifname, &ifindex);
         ignore_value(VIR_STRDUP(threadkey, req->threadkey));
-        worker = virThreadPoolNew(1, 1, 0,
-                                  virNWFilterDHCPDecodeWorker,
-                                  req);
     }
 
     /* let creator know how well we initialized */
-    if (error || !threadkey || tmp < 0 || !worker ||
+    if (error || !threadkey || tmp < 0 ||
         ifindex != req->ifindex)
         req->threadStatus = THREAD_STATUS_FAIL;
     else
@@ -1503,13 +1583,13 @@ virNWFilterDHCPSnoopThread(void *req0)
             if (rv) {
                 unsigned int diff;
 
-                /* submit packet to worker thread */
-                if (virAtomicIntGet(&pcapConf[i].qCtr) >
+                /* submit packet to the shared decode pool */
+                if (virAtomicIntGet(&req->nQueuedJobs) >
                     pcapConf[i].maxQSize) {
                     if (last_displayed_queue - time(0) > 10) {
                         last_displayed_queue = time(0);
-                        VIR_WARN("Worker thread for interface '%s' has a "
-                                 "job queue that is too long",
+                        VIR_WARN("Decode queue for interface '%s' "
+                                 "is too long",
                                  req->ifname);
                     }
                     continue;
@@ -1528,10 +1608,9 @@ virNWFilterDHCPSnoopThread(void *req0)
                     continue;
                 }
 
-                if (virNWFilterSnoopDHCPDecodeJobSubmit(worker, packet,
-                                                      hdr->caplen,
-                                                      pcapConf[i].dir,
-                                                      &pcapConf[i].qCtr) < 0) {
+                if (virNWFilterSnoopDHCPDecodeJobSubmit(req, packet,
+                                                        hdr->caplen,
+                                                        pcapConf[i].dir) < 0) {
                     virReportError(VIR_ERR_INTERNAL_ERROR,
                                    _("Job submission failed on "
                                      "interface '%s'"), req->ifname);
@@ -1559,8 +1638,6 @@ virNWFilterDHCPSnoopThread(void *req0)
     virNWFilterSnoopUnlock();
 
  exit:
-    virThreadPoolFree(worker);
-
     virNWFilterSnoopReqPut(req);
 
     VIR_FREE(threadkey);
@@ -2022,6 +2099,14 @@ virNWFilterSnoopJoinThreads(void)
                  virAtomicIntGet(&virNWFilterSnoopState.nThreads));
         usleep(1000 * 1000);
     }
+
+    /* let the shared decode pool drain the batches the snooping
+     * threads had scheduled before they terminated */
+    while (virAtomicIntGet(&virNWFilterSnoopState.nDecodeJobs) != 0) {
+        VIR_WARN("Waiting for DHCP decode batches to drain: %u",
+                 virAtomicIntGet(&virNWFilterSnoopState.nDecodeJobs));
+        usleep(1000 * 1000);
+    }
 }
 
 /*
@@ -2091,10 +2176,14 @@ virNWFilterDHCPSnoopInit(void)
     virNWFilterSnoopState.active = virHashCreate(0, NULL);
     virNWFilterSnoopState.snoopReqs =
         virHashCreate(0, virNWFilterSnoopReqRelease);
+    virNWFilterSnoopState.decodePool =
+        virThreadPoolNew(1, DHCP_DECODE_WORKERS_MAX, 0,
+                         virNWFilterDHCPDecodeWorker, NULL);
 
     if (!virNWFilterSnoopState.ifnameToKey ||
         !virNWFilterSnoopState.snoopReqs ||
-        !virNWFilterSnoopState.active)
+        !virNWFilterSnoopState.active ||
+        !virNWFilterSnoopState.decodePool)
         goto err_exit;
 
     virNWFilterSnoopLeaseFileLoad();
@@ -2112,6 +2201,9 @@ virNWFilterDHCPSnoopInit(void)
     virHashFree(virNWFilterSnoopState.active);
     virNWFilterSnoopState.active = NULL;
 
+    virThreadPoolFree(virNWFilterSnoopState.decodePool);
+    virNWFilterSnoopState.decodePool = NULL;
+
     return -1;
 }
 
@@ -2187,6 +2279,9 @@ virNWFilterDHCPSnoopShutdown(void)
     virNWFilterSnoopEndThreads();
     virNWFilterSnoopJoinThreads();
 
+    virThreadPoolFree(virNWFilterSnoopState.decodePool);
+    virNWFilterSnoopState.decodePool = NULL;
+
     virNWFilterSnoopLock();
 
     virNWFilterSnoopLeaseFileClose();
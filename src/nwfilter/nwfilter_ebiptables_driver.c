@@ -3421,7 +3421,10 @@ ebiptablesApplyNewRules(const char *ifname,
     ebtablesRemoveTmpRootChainFW(fw, true, ifname);
     ebtablesRemoveTmpRootChainFW(fw, false, ifname);
 
-    virFirewallStartTransaction(fw, 0);
+    /* instantiating a filter can add dozens of chain rules per
+     * interface; let the firewall engine apply consecutive
+     * iptables/ip6tables rules in one iptables-restore process */
+    virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_AUTO_BATCH);
 
     /* walk the list of rules and increase the priority
      * of rules in case the chain priority is of higher value;
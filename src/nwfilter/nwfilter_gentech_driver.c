@@ -56,28 +56,27 @@ static virNWFilterTechDriverPtr filter_tech_drivers[] = {
     NULL
 };
 
-/* Serializes instantiation of filters. This is necessary
- * to avoid lock ordering deadlocks. eg __virNWFilterInstantiateFilter
- * will hold a lock on a virNWFilterObjPtr. This in turn invokes
- * virNWFilterInstantiate which invokes virNWFilterDetermineMissingVarsRec
- * which invokes virNWFilterObjFindByName. This iterates over every single
- * virNWFilterObjPtr in the list. So if 2 threads try to instantiate a
- * filter in parallel, they'll both hold 1 lock at the top level in
- * __virNWFilterInstantiateFilter which will cause the other thread
- * to deadlock in virNWFilterObjFindByName.
+/* Locking during filter instantiation:
  *
- * XXX better long term solution is to make virNWFilterObjList use a
- * hash table as is done for virDomainObjList. You can then get
- * lockless lookup of objects by name.
+ * Every path that instantiates or updates filters holds the filter
+ * updates rwlock -- the read lock for VM startup and late (re-)
+ * instantiation, the write lock for filter define/undefine. This keeps
+ * all filter definitions stable for the duration of the instantiation,
+ * so a virNWFilterObjPtr lock only needs to be held while inspecting
+ * that one object and never across the lookup of another one. Holding
+ * several object locks at once would risk lock ordering deadlocks
+ * between two threads instantiating filters in parallel, since
+ * virNWFilterObjFindByName momentarily locks every object in the list.
+ *
+ * Rule application is serialized against teardown of the same
+ * interface via virNWFilterLockIface; filters for distinct interfaces
+ * instantiate concurrently.
  */
-static virMutex updateMutex;
 
 int virNWFilterTechDriversInit(bool privileged)
 {
     size_t i = 0;
     VIR_DEBUG("Initializing NWFilter technology drivers");
-    if (virMutexInitRecursive(&updateMutex) < 0)
-        return -1;
 
     while (filter_tech_drivers[i]) {
         if (!(filter_tech_drivers[i]->flags & TECHDRV_FLAG_INITIALIZED))
@@ -96,7 +95,6 @@ void virNWFilterTechDriversShutdown(void)
             filter_tech_drivers[i]->shutdown();
         i++;
     }
-    virMutexDestroy(&updateMutex);
 }
 
 
@@ -122,7 +120,7 @@ virNWFilterRuleInstFree(virNWFilterRuleInstPtr inst)
     if (!inst)
         return;
 
-    virNWFilterHashTableFree(inst->vars);
+    /* inst->vars is owned by the virNWFilterInst */
     VIR_FREE(inst);
 }
 
@@ -302,10 +300,12 @@ virNWFilterCreateVarsFrom(virNWFilterHashTablePtr vars1,
 typedef struct _virNWFilterInst virNWFilterInst;
 typedef virNWFilterInst *virNWFilterInstPtr;
 struct _virNWFilterInst {
-    virNWFilterObjPtr *filters;
-    size_t nfilters;
     virNWFilterRuleInstPtr *rules;
     size_t nrules;
+    /* variable maps referenced by the rule instances; one per include
+     * level instead of one deep copy per rule */
+    virNWFilterHashTablePtr *vartables;
+    size_t nvartables;
 };
 
 
@@ -314,14 +314,14 @@ virNWFilterInstReset(virNWFilterInstPtr inst)
 {
     size_t i;
 
-    for (i = 0; i < inst->nfilters; i++)
-        virNWFilterObjUnlock(inst->filters[i]);
-    VIR_FREE(inst->filters);
-    inst->nfilters = 0;
-
     for (i = 0; i < inst->nrules; i++)
         virNWFilterRuleInstFree(inst->rules[i]);
     VIR_FREE(inst->rules);
+    inst->nrules = 0;
+    for (i = 0; i < inst->nvartables; i++)
+        virNWFilterHashTableFree(inst->vartables[i]);
+    VIR_FREE(inst->vartables);
+    inst->nvartables = 0;
 }
 
 
@@ -350,10 +350,11 @@ virNWFilterRuleDefToRuleInst(virNWFilterDefPtr def,
     ruleinst->chainPriority = def->chainPriority;
     ruleinst->def = rule;
     ruleinst->priority = rule->priority;
-    if (!(ruleinst->vars = virNWFilterHashTableCreate(0)))
-        goto cleanup;
-    if (virNWFilterHashTablePutAll(vars, ruleinst->vars) < 0)
-        goto cleanup;
+    /* All rules at one include level share the same variable map, so
+     * reference it instead of deep-copying it for every rule; the map
+     * stays alive in the virNWFilterInst (or the caller, for the top
+     * level) until the rules have been applied */
+    ruleinst->vars = vars;
 
     if (VIR_APPEND_ELEMENT(inst->rules,
                            inst->nrules,
@@ -378,6 +379,7 @@ virNWFilterIncludeDefToRuleInst(virNWFilterDriverStatePtr driver,
 {
     virNWFilterObjPtr obj;
     virNWFilterHashTablePtr tmpvars = NULL;
+    virNWFilterHashTablePtr childvars;
     virNWFilterDefPtr childdef;
     int ret = -1;
 
@@ -415,15 +417,21 @@ virNWFilterIncludeDefToRuleInst(virNWFilterDriverStatePtr driver,
         break;
     }
 
-    if (VIR_APPEND_ELEMENT(inst->filters,
-                           inst->nfilters,
-                           obj) < 0)
-        goto cleanup;
+    /* the filter updates rwlock held by our caller keeps childdef
+     * stable; drop the object lock so the recursion below never holds
+     * it across the lookup of another filter object */
+    virNWFilterObjUnlock(obj);
     obj = NULL;
 
+    /* hand the map over to the inst so the rule instances created
+     * below can reference it for as long as they live */
+    childvars = tmpvars;
+    if (VIR_APPEND_ELEMENT(inst->vartables, inst->nvartables, tmpvars) < 0)
+        goto cleanup;
+
     if (virNWFilterDefToInst(driver,
                              childdef,
-                             tmpvars,
+                             childvars,
                              useNewFilter,
                              foundNewFilter,
                              inst) < 0)
@@ -575,6 +583,11 @@ virNWFilterDetermineMissingVarsRec(virNWFilterDefPtr filter,
                     break;
                 }
 
+                /* unlock before recursing so that this thread never
+                 * holds an object lock while looking up another one;
+                 * the filter updates rwlock keeps next_filter stable */
+                virNWFilterObjUnlock(obj);
+
                 rc = virNWFilterDetermineMissingVarsRec(next_filter,
                                                         tmpvars,
                                                         missing_vars,
@@ -583,7 +596,6 @@ virNWFilterDetermineMissingVarsRec(virNWFilterDefPtr filter,
 
                 virNWFilterHashTableFree(tmpvars);
 
-                virNWFilterObjUnlock(obj);
                 if (rc < 0)
                     break;
             } else {
@@ -861,6 +873,13 @@ __virNWFilterInstantiateFilter(virNWFilterDriverStatePtr driver,
         break;
     }
 
+    /* the filter updates rwlock held by all instantiation paths keeps
+     * 'filter' stable from here on; drop the object lock so that the
+     * instantiation can look up referenced filters without this thread
+     * holding another object's lock */
+    virNWFilterObjUnlock(obj);
+    obj = NULL;
+
     rc = virNWFilterInstantiate(vmuuid,
                                 techdriver,
                                 filter,
@@ -880,7 +899,8 @@ __virNWFilterInstantiateFilter(virNWFilterDriverStatePtr driver,
     virNWFilterHashTableFree(vars1);
 
  err_exit:
-    virNWFilterObjUnlock(obj);
+    if (obj)
+        virNWFilterObjUnlock(obj);
 
     VIR_FREE(str_ipaddr);
     VIR_FREE(str_macaddr);
@@ -903,9 +923,10 @@ _virNWFilterInstantiateFilter(virNWFilterDriverStatePtr driver,
     int ifindex;
     int rc;
 
-    virMutexLock(&updateMutex);
+    if (virNWFilterLockIface(net->ifname) < 0)
+        return -1;
 
-    /* after grabbing the filter update lock check for the interface; if
+    /* after grabbing the interface lock check for the interface; if
        it's not there anymore its filters will be or are being removed
        (while holding the lock) and we don't want to build new ones */
     if (virNetDevExists(net->ifname) != 1 ||
@@ -931,7 +952,7 @@ _virNWFilterInstantiateFilter(virNWFilterDriverStatePtr driver,
                                         foundNewFilter);
 
  cleanup:
-    virMutexUnlock(&updateMutex);
+    virNWFilterUnlockIface(net->ifname);
 
     return rc;
 }
@@ -951,7 +972,11 @@ virNWFilterInstantiateFilterLate(virNWFilterDriverStatePtr driver,
     bool foundNewFilter = false;
 
     virNWFilterReadLockFilterUpdates();
-    virMutexLock(&updateMutex);
+
+    if (virNWFilterLockIface(ifname) < 0) {
+        virNWFilterUnlockFilterUpdates();
+        return -1;
+    }
 
     rc = __virNWFilterInstantiateFilter(driver,
                                         vmuuid,
@@ -975,8 +1000,8 @@ virNWFilterInstantiateFilterLate(virNWFilterDriverStatePtr driver,
         }
     }
 
+    virNWFilterUnlockIface(ifname);
     virNWFilterUnlockFilterUpdates();
-    virMutexUnlock(&updateMutex);
 
     return rc;
 }
@@ -1101,9 +1126,13 @@ int
 virNWFilterTeardownFilter(const virDomainNetDef *net)
 {
     int ret;
-    virMutexLock(&updateMutex);
+
+    /* the interface lock serializes the teardown against a concurrent
+     * instantiation of filters for the same interface */
+    if (virNWFilterLockIface(net->ifname) < 0)
+        return -1;
     ret = _virNWFilterTeardownFilter(net->ifname);
-    virMutexUnlock(&updateMutex);
+    virNWFilterUnlockIface(net->ifname);
     return ret;
 }
 
@@ -30,6 +30,7 @@
 #endif
 
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 
 #include <arpa/inet.h>
@@ -251,7 +252,8 @@ virNWFilterTerminateLearnReq(const char *ifname)
     virNWFilterIPAddrLearnReqPtr req;
 
     /* It's possible that it's already been removed as a result of
-     * virNWFilterDeregisterLearnReq during learnIPAddressThread() exit
+     * virNWFilterDeregisterLearnReq when the monitor thread finished
+     * the interface
      */
     if (virNetDevExists(ifname) != 1) {
         virResetLastError();
@@ -361,45 +363,211 @@ procDHCPOpts(struct dhcp *dhcp, int dhcp_opts_len,
 }
 
 
+/* state of one interface on which an IP address is being learned;
+ * only ever touched by the monitor thread */
+typedef struct _virNWFilterLearnEntry virNWFilterLearnEntry;
+typedef virNWFilterLearnEntry *virNWFilterLearnEntryPtr;
+struct _virNWFilterLearnEntry {
+    virNWFilterIPAddrLearnReqPtr req;
+    pcap_t *handle;
+    int fd;
+    bool ifaceLocked;
+    uint32_t vmaddr;
+    uint32_t bcastaddr;
+    enum howDetect howDetected;
+    bool finished;
+    bool showError;
+};
+
+/* entries the monitor thread is polling; owned by the monitor thread */
+static virNWFilterLearnEntryPtr *learnEntries;
+static size_t nLearnEntries;
+
+/* requests waiting to be picked up by the monitor thread */
+static virMutex learnNewReqsLock = VIR_MUTEX_INITIALIZER;
+static virNWFilterIPAddrLearnReqPtr *learnNewReqs;
+static size_t nLearnNewReqs;
+static bool learnMonitorRunning;
+
+
 /**
- * learnIPAddressThread
- * arg: pointer to virNWFilterIPAddrLearnReq structure
+ * learnIPAddressProcessPacket
+ * @entry: the learning state of the interface the packet was
+ *     captured on
+ * @header: the pcap header of the captured packet
+ * @packet: the captured packet
  *
- * Learn the IP address being used on an interface. Use ARP Request and
- * Reply messages, DHCP offers and the first IP packet being sent from
- * the VM to detect the IP address it is using. Detects only one IP address
- * per interface (IP aliasing not supported). The method on how the
- * IP address is detected can be chosen through flags. DETECT_DHCP will
- * require that the IP address is detected from a DHCP OFFER, DETECT_STATIC
- * will require that the IP address was taken from an ARP packet or an IPv4
- * packet. Both flags can be set at the same time.
+ * Inspect one captured packet and try to extract the VM's IP address
+ * from an ARP request or reply, a DHCP offer or the first IPv4 packet
+ * being sent from the VM.
+ *
+ * Returns true if an address acceptable to the request's detection
+ * method was found and recorded in the entry, false otherwise.
  */
-static void
-learnIPAddressThread(void *arg)
+static bool
+learnIPAddressProcessPacket(virNWFilterLearnEntryPtr entry,
+                            struct pcap_pkthdr *header,
+                            const u_char *packet)
 {
-    char errbuf[PCAP_ERRBUF_SIZE] = {0};
-    pcap_t *handle = NULL;
-    struct bpf_program fp;
-    struct pcap_pkthdr header;
-    const u_char *packet;
+    virNWFilterIPAddrLearnReqPtr req = entry->req;
     struct ether_header *ether_hdr;
     struct ether_vlan_header *vlan_hdr;
-    virNWFilterIPAddrLearnReqPtr req = arg;
-    uint32_t vmaddr = 0, bcastaddr = 0;
+    uint32_t vmaddr = 0;
     unsigned int ethHdrSize;
+    int dhcp_opts_len;
+    uint16_t etherType;
+    enum howDetect howDetected = 0;
+
+    if (header->len < sizeof(struct ether_header))
+        return false;
+
+    ether_hdr = (struct ether_header*)packet;
+
+    switch (ntohs(ether_hdr->ether_type)) {
+
+    case ETHERTYPE_IP:
+        ethHdrSize = sizeof(struct ether_header);
+        etherType = ntohs(ether_hdr->ether_type);
+        break;
+
+    case ETHERTYPE_VLAN:
+        ethHdrSize = sizeof(struct ether_vlan_header);
+        vlan_hdr = (struct ether_vlan_header *)packet;
+        if (ntohs(vlan_hdr->ether_type) != ETHERTYPE_IP ||
+            header->len < ethHdrSize)
+            return false;
+        etherType = ntohs(vlan_hdr->ether_type);
+        break;
+
+    default:
+        return false;
+    }
+
+    if (virMacAddrCmpRaw(&req->macaddr, ether_hdr->ether_shost) == 0) {
+        /* packets from the VM */
+
+        if (etherType == ETHERTYPE_IP &&
+            (header->len >= ethHdrSize +
+                            sizeof(struct iphdr))) {
+            VIR_WARNINGS_NO_CAST_ALIGN
+            struct iphdr *iphdr = (struct iphdr*)(packet +
+                                                  ethHdrSize);
+            VIR_WARNINGS_RESET
+            vmaddr = iphdr->saddr;
+            /* skip mcast addresses (224.0.0.0 - 239.255.255.255),
+             * class E (240.0.0.0 - 255.255.255.255, includes eth.
+             * bcast) and zero address in DHCP Requests */
+            if ((ntohl(vmaddr) & 0xe0000000) == 0xe0000000 ||
+                vmaddr == 0)
+                return false;
+
+            howDetected = DETECT_STATIC;
+        } else if (etherType == ETHERTYPE_ARP &&
+                   (header->len >= ethHdrSize +
+                                   sizeof(struct f_arphdr))) {
+            VIR_WARNINGS_NO_CAST_ALIGN
+            struct f_arphdr *arphdr = (struct f_arphdr*)(packet +
+                                                 ethHdrSize);
+            VIR_WARNINGS_RESET
+            switch (ntohs(arphdr->arphdr.ar_op)) {
+            case ARPOP_REPLY:
+                vmaddr = arphdr->ar_sip;
+                howDetected = DETECT_STATIC;
+            break;
+            case ARPOP_REQUEST:
+                vmaddr = arphdr->ar_tip;
+                howDetected = DETECT_STATIC;
+            break;
+            }
+        }
+    } else if (virMacAddrCmpRaw(&req->macaddr,
+                                ether_hdr->ether_dhost) == 0 ||
+               /* allow Broadcast replies from DHCP server */
+               virMacAddrIsBroadcastRaw(ether_hdr->ether_dhost)) {
+        /* packets to the VM */
+        if (etherType == ETHERTYPE_IP &&
+            (header->len >= ethHdrSize +
+                            sizeof(struct iphdr))) {
+            VIR_WARNINGS_NO_CAST_ALIGN
+            struct iphdr *iphdr = (struct iphdr*)(packet +
+                                                  ethHdrSize);
+            VIR_WARNINGS_RESET
+            if ((iphdr->protocol == IPPROTO_UDP) &&
+                (header->len >= ethHdrSize +
+                                iphdr->ihl * 4 +
+                                sizeof(struct udphdr))) {
+                VIR_WARNINGS_NO_CAST_ALIGN
+                struct udphdr *udphdr = (struct udphdr *)
+                                  ((char *)iphdr + iphdr->ihl * 4);
+                VIR_WARNINGS_RESET
+                if (ntohs(udphdr->source) == 67 &&
+                    ntohs(udphdr->dest)   == 68 &&
+                    header->len >= ethHdrSize +
+                                   iphdr->ihl * 4 +
+                                   sizeof(struct udphdr) +
+                                   sizeof(struct dhcp)) {
+                    struct dhcp *dhcp = (struct dhcp *)
+                                ((char *)udphdr + sizeof(udphdr));
+                    if (dhcp->op == 2 /* BOOTREPLY */ &&
+                        virMacAddrCmpRaw(
+                                &req->macaddr,
+                                &dhcp->chaddr[0]) == 0) {
+                        dhcp_opts_len = header->len -
+                            (ethHdrSize + iphdr->ihl * 4 +
+                             sizeof(struct udphdr) +
+                             sizeof(struct dhcp));
+                        procDHCPOpts(dhcp, dhcp_opts_len,
+                                     &vmaddr,
+                                     &entry->bcastaddr,
+                                     &howDetected);
+                    }
+                }
+            }
+        }
+    }
+
+    if (vmaddr == 0 || (req->howDetect & howDetected) == 0)
+        return false;
+
+    entry->vmaddr = vmaddr;
+    entry->howDetected = howDetected;
+
+    return true;
+}
+
+
+/**
+ * virNWFilterLearnEntrySetup
+ * @entry: the learning state of the interface, with the request
+ *     already assigned
+ *
+ * Prepare an interface for IP address learning: lock the interface,
+ * apply the basic or DHCP-only rules and open a pcap handle in
+ * non-blocking mode so the monitor thread can poll it along with all
+ * other learning interfaces.
+ *
+ * Returns 0 if polling can start, -1 if learning on this interface is
+ * over; in the latter case the request's status is set unless the
+ * interface could not even be locked.
+ */
+static int
+virNWFilterLearnEntrySetup(virNWFilterLearnEntryPtr entry)
+{
+    char errbuf[PCAP_ERRBUF_SIZE] = {0};
+    virNWFilterIPAddrLearnReqPtr req = entry->req;
+    virNWFilterTechDriverPtr techdriver = req->techdriver;
     char *listen_if = (strlen(req->linkdev) != 0) ? req->linkdev
                                                   : req->ifname;
-    int dhcp_opts_len;
     char macaddr[VIR_MAC_STRING_BUFLEN];
     virBuffer buf = VIR_BUFFER_INITIALIZER;
     char *filter = NULL;
-    uint16_t etherType;
-    bool showError = true;
-    enum howDetect howDetected = 0;
-    virNWFilterTechDriverPtr techdriver = req->techdriver;
+    struct bpf_program fp;
+    int ret = -1;
 
     if (virNWFilterLockIface(req->ifname) < 0)
-       goto err_no_lock;
+        goto cleanup;
+
+    entry->ifaceLocked = true;
 
     req->status = 0;
 
@@ -407,17 +575,27 @@ learnIPAddressThread(void *arg)
     if (virNetDevValidateConfig(req->ifname, NULL, req->ifindex) <= 0) {
         virResetLastError();
         req->status = ENODEV;
-        goto done;
+        goto cleanup;
     }
 
-    handle = pcap_open_live(listen_if, BUFSIZ, 0, PKT_TIMEOUT_MS, errbuf);
+    entry->handle = pcap_open_live(listen_if, BUFSIZ, 0,
+                                   PKT_TIMEOUT_MS, errbuf);
 
-    if (handle == NULL) {
+    if (entry->handle == NULL) {
         VIR_DEBUG("Couldn't open device %s: %s", listen_if, errbuf);
         req->status = ENODEV;
-        goto done;
+        goto cleanup;
+    }
+
+    if (pcap_setnonblock(entry->handle, 1, errbuf) < 0) {
+        VIR_DEBUG("Couldn't set device %s non-blocking: %s",
+                  listen_if, errbuf);
+        req->status = ENODEV;
+        goto cleanup;
     }
 
+    entry->fd = pcap_fileno(entry->handle);
+
     virMacAddrFormat(&req->macaddr, macaddr);
 
     switch (req->howDetect) {
@@ -426,7 +604,7 @@ learnIPAddressThread(void *arg)
                                            &req->macaddr,
                                            NULL, false) < 0) {
             req->status = EINVAL;
-            goto done;
+            goto cleanup;
         }
         virBufferAddLit(&buf, "src port 67 and dst port 68");
         break;
@@ -434,7 +612,7 @@ learnIPAddressThread(void *arg)
         if (techdriver->applyBasicRules(req->ifname,
                                         &req->macaddr) < 0) {
             req->status = EINVAL;
-            goto done;
+            goto cleanup;
         }
         virBufferAsprintf(&buf, "ether host %s or ether dst ff:ff:ff:ff:ff:ff",
                           macaddr);
@@ -442,183 +620,69 @@ learnIPAddressThread(void *arg)
 
     if (virBufferError(&buf)) {
         req->status = ENOMEM;
-        goto done;
+        goto cleanup;
     }
 
     filter = virBufferContentAndReset(&buf);
 
-    if (pcap_compile(handle, &fp, filter, 1, 0) != 0) {
+    if (pcap_compile(entry->handle, &fp, filter, 1, 0) != 0) {
         VIR_DEBUG("Couldn't compile filter '%s'", filter);
         req->status = EINVAL;
-        goto done;
+        goto cleanup;
     }
 
-    if (pcap_setfilter(handle, &fp) != 0) {
+    if (pcap_setfilter(entry->handle, &fp) != 0) {
         VIR_DEBUG("Couldn't set filter '%s'", filter);
         req->status = EINVAL;
         pcap_freecode(&fp);
-        goto done;
+        goto cleanup;
     }
 
     pcap_freecode(&fp);
 
-    while (req->status == 0 && vmaddr == 0) {
-        packet = pcap_next(handle, &header);
-
-        if (!packet) {
-
-            if (threadsTerminate || req->terminate) {
-                req->status = ECANCELED;
-                showError = false;
-                break;
-            }
+    ret = 0;
 
-            /* check whether VM's dev is still there */
-            if (virNetDevValidateConfig(req->ifname, NULL, req->ifindex) <= 0) {
-                virResetLastError();
-                req->status = ENODEV;
-                showError = false;
-                break;
-            }
-            continue;
-        }
-
-        if (header.len >= sizeof(struct ether_header)) {
-            ether_hdr = (struct ether_header*)packet;
-
-            switch (ntohs(ether_hdr->ether_type)) {
-
-            case ETHERTYPE_IP:
-                ethHdrSize = sizeof(struct ether_header);
-                etherType = ntohs(ether_hdr->ether_type);
-                break;
-
-            case ETHERTYPE_VLAN:
-                ethHdrSize = sizeof(struct ether_vlan_header);
-                vlan_hdr = (struct ether_vlan_header *)packet;
-                if (ntohs(vlan_hdr->ether_type) != ETHERTYPE_IP ||
-                    header.len < ethHdrSize)
-                    continue;
-                etherType = ntohs(vlan_hdr->ether_type);
-                break;
+ cleanup:
+    VIR_FREE(filter);
 
-            default:
-                continue;
-            }
+    return ret;
+}
 
-            if (virMacAddrCmpRaw(&req->macaddr, ether_hdr->ether_shost) == 0) {
-                /* packets from the VM */
-
-                if (etherType == ETHERTYPE_IP &&
-                    (header.len >= ethHdrSize +
-                                   sizeof(struct iphdr))) {
-                    VIR_WARNINGS_NO_CAST_ALIGN
-                    struct iphdr *iphdr = (struct iphdr*)(packet +
-                                                          ethHdrSize);
-                    VIR_WARNINGS_RESET
-                    vmaddr = iphdr->saddr;
-                    /* skip mcast addresses (224.0.0.0 - 239.255.255.255),
-                     * class E (240.0.0.0 - 255.255.255.255, includes eth.
-                     * bcast) and zero address in DHCP Requests */
-                    if ((ntohl(vmaddr) & 0xe0000000) == 0xe0000000 ||
-                        vmaddr == 0) {
-                        vmaddr = 0;
-                        continue;
-                    }
 
-                    howDetected = DETECT_STATIC;
-                } else if (etherType == ETHERTYPE_ARP &&
-                           (header.len >= ethHdrSize +
-                                          sizeof(struct f_arphdr))) {
-                    VIR_WARNINGS_NO_CAST_ALIGN
-                    struct f_arphdr *arphdr = (struct f_arphdr*)(packet +
-                                                         ethHdrSize);
-                    VIR_WARNINGS_RESET
-                    switch (ntohs(arphdr->arphdr.ar_op)) {
-                    case ARPOP_REPLY:
-                        vmaddr = arphdr->ar_sip;
-                        howDetected = DETECT_STATIC;
-                    break;
-                    case ARPOP_REQUEST:
-                        vmaddr = arphdr->ar_tip;
-                        howDetected = DETECT_STATIC;
-                    break;
-                    }
-                }
-            } else if (virMacAddrCmpRaw(&req->macaddr,
-                                        ether_hdr->ether_dhost) == 0 ||
-                       /* allow Broadcast replies from DHCP server */
-                       virMacAddrIsBroadcastRaw(ether_hdr->ether_dhost)) {
-                /* packets to the VM */
-                if (etherType == ETHERTYPE_IP &&
-                    (header.len >= ethHdrSize +
-                                   sizeof(struct iphdr))) {
-                    VIR_WARNINGS_NO_CAST_ALIGN
-                    struct iphdr *iphdr = (struct iphdr*)(packet +
-                                                          ethHdrSize);
-                    VIR_WARNINGS_RESET
-                    if ((iphdr->protocol == IPPROTO_UDP) &&
-                        (header.len >= ethHdrSize +
-                                       iphdr->ihl * 4 +
-                                       sizeof(struct udphdr))) {
-                        VIR_WARNINGS_NO_CAST_ALIGN
-                        struct udphdr *udphdr = (struct udphdr *)
-                                          ((char *)iphdr + iphdr->ihl * 4);
-                        VIR_WARNINGS_RESET
-                        if (ntohs(udphdr->source) == 67 &&
-                            ntohs(udphdr->dest)   == 68 &&
-                            header.len >= ethHdrSize +
-                                          iphdr->ihl * 4 +
-                                          sizeof(struct udphdr) +
-                                          sizeof(struct dhcp)) {
-                            struct dhcp *dhcp = (struct dhcp *)
-                                        ((char *)udphdr + sizeof(udphdr));
-                            if (dhcp->op == 2 /* BOOTREPLY */ &&
-                                virMacAddrCmpRaw(
-                                        &req->macaddr,
-                                        &dhcp->chaddr[0]) == 0) {
-                                dhcp_opts_len = header.len -
-                                    (ethHdrSize + iphdr->ihl * 4 +
-                                     sizeof(struct udphdr) +
-                                     sizeof(struct dhcp));
-                                procDHCPOpts(dhcp, dhcp_opts_len,
-                                             &vmaddr,
-                                             &bcastaddr,
-                                             &howDetected);
-                            }
-                        }
-                    }
-                }
-            }
-        }
-        if (vmaddr && (req->howDetect & howDetected) == 0) {
-            vmaddr = 0;
-            howDetected = 0;
-        }
-    } /* while */
+/**
+ * virNWFilterLearnEntryComplete
+ * @entry: the learning state of the interface
+ *
+ * Finish learning on one interface: on success apply the firewall
+ * rules with the detected IP address, otherwise put the interface
+ * into a secure state. Consumes the entry along with its request.
+ */
+static void
+virNWFilterLearnEntryComplete(virNWFilterLearnEntryPtr entry)
+{
+    virNWFilterIPAddrLearnReqPtr req = entry->req;
+    virNWFilterTechDriverPtr techdriver = req->techdriver;
 
- done:
-    VIR_FREE(filter);
+    if (entry->handle)
+        pcap_close(entry->handle);
 
-    if (handle)
-        pcap_close(handle);
+    if (!entry->ifaceLocked)
+        goto deregister;
 
-    if (req->status == 0) {
+    if (req->status == 0 && entry->vmaddr != 0) {
         int ret;
         virSocketAddr sa;
+        char *inetaddr;
+
         sa.len = sizeof(sa.data.inet4);
         sa.data.inet4.sin_family = AF_INET;
-        sa.data.inet4.sin_addr.s_addr = vmaddr;
-        char *inetaddr;
+        sa.data.inet4.sin_addr.s_addr = entry->vmaddr;
 
-        /* It is necessary to unlock interface here to avoid updateMutex and
-         * interface ordering deadlocks. Otherwise we are going to
-         * instantiate the filter, which will try to lock updateMutex, and
-         * some other thread instantiating a filter in parallel is holding
-         * updateMutex and is trying to lock interface, both will deadlock.
-         * Also it is safe to unlock interface here because we stopped
-         * capturing and applied necessary rules on the interface, while
-         * instantiating a new filter doesn't require a locked interface.*/
+        /* It is safe to unlock the interface here because we stopped
+         * capturing and applied the necessary rules on the interface;
+         * instantiating a new filter doesn't require the interface to
+         * be locked by the caller since the instantiation code takes
+         * the interface lock itself. */
         virNWFilterUnlockIface(req->ifname);
 
         if ((inetaddr = virSocketAddrFormat(&sa)) != NULL) {
@@ -639,7 +703,7 @@ learnIPAddressThread(void *arg)
                       "%s with IP addr %s : %d", req->ifname, inetaddr, ret);
         }
     } else {
-        if (showError)
+        if (entry->showError)
             virReportSystemError(req->status,
                                  _("encountered an error on interface %s "
                                    "index %d"),
@@ -649,13 +713,156 @@ learnIPAddressThread(void *arg)
         virNWFilterUnlockIface(req->ifname);
     }
 
-    VIR_DEBUG("pcap thread terminating for interface %s", req->ifname);
+    VIR_DEBUG("learning terminated for interface %s", req->ifname);
 
-
- err_no_lock:
+ deregister:
     virNWFilterDeregisterLearnReq(req->ifindex);
 
     virNWFilterIPAddrLearnReqFree(req);
+
+    VIR_FREE(entry);
+}
+
+
+/**
+ * learnIPAddressesThread
+ *
+ * Learn the IP addresses being used on all interfaces with a pending
+ * learn request. Use ARP Request and Reply messages, DHCP offers and
+ * the first IP packet being sent from the VM to detect the IP address
+ * a VM is using. Detects only one IP address per interface (IP
+ * aliasing not supported). The method on how the IP address is
+ * detected can be chosen through flags. DETECT_DHCP will require that
+ * the IP address is detected from a DHCP OFFER, DETECT_STATIC will
+ * require that the IP address was taken from an ARP packet or an IPv4
+ * packet. Both flags can be set at the same time.
+ *
+ * A single thread monitors the pcap handles of all learning
+ * interfaces rather than each interface running its own capture
+ * thread; it picks up newly registered requests, polls all handles
+ * and finishes each interface as its address is detected or learning
+ * is aborted. The thread exits once no interface is left to learn on.
+ */
+static void
+learnIPAddressesThread(void *arg ATTRIBUTE_UNUSED)
+{
+    struct pollfd *fds = NULL;
+    size_t nfds = 0;
+    virNWFilterIPAddrLearnReqPtr *newReqs;
+    size_t nNewReqs;
+    virNWFilterLearnEntryPtr entry;
+    size_t i;
+    int n;
+
+    for (;;) {
+        /* pick up the requests registered since the last round */
+        virMutexLock(&learnNewReqsLock);
+
+        newReqs = learnNewReqs;
+        nNewReqs = nLearnNewReqs;
+        learnNewReqs = NULL;
+        nLearnNewReqs = 0;
+
+        if (nLearnEntries == 0 && nNewReqs == 0) {
+            learnMonitorRunning = false;
+            virMutexUnlock(&learnNewReqsLock);
+            break;
+        }
+
+        virMutexUnlock(&learnNewReqsLock);
+
+        for (i = 0; i < nNewReqs; i++) {
+            if (VIR_ALLOC(entry) < 0) {
+                virNWFilterDeregisterLearnReq(newReqs[i]->ifindex);
+                virNWFilterIPAddrLearnReqFree(newReqs[i]);
+                continue;
+            }
+
+            entry->req = newReqs[i];
+            entry->showError = true;
+
+            if (threadsTerminate) {
+                entry->req->status = ECANCELED;
+                entry->showError = false;
+                virNWFilterLearnEntryComplete(entry);
+                continue;
+            }
+
+            if (virNWFilterLearnEntrySetup(entry) < 0 ||
+                VIR_APPEND_ELEMENT(learnEntries, nLearnEntries, entry) < 0)
+                virNWFilterLearnEntryComplete(entry);
+        }
+        VIR_FREE(newReqs);
+
+        if (nLearnEntries == 0)
+            continue;
+
+        if (nfds != nLearnEntries) {
+            VIR_FREE(fds);
+            nfds = 0;
+            if (VIR_ALLOC_N(fds, nLearnEntries) < 0) {
+                usleep(PKT_TIMEOUT_MS * 1000);
+                continue;
+            }
+            nfds = nLearnEntries;
+        }
+
+        for (i = 0; i < nLearnEntries; i++) {
+            fds[i].fd = learnEntries[i]->fd;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+
+        n = poll(fds, nLearnEntries, PKT_TIMEOUT_MS);
+
+        if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            usleep(PKT_TIMEOUT_MS * 1000);
+            continue;
+        }
+
+        for (i = 0; i < nLearnEntries; i++) {
+            struct pcap_pkthdr header;
+            const u_char *packet;
+
+            entry = learnEntries[i];
+
+            if (fds[i].revents) {
+                while (!entry->finished &&
+                       (packet = pcap_next(entry->handle, &header)))
+                    entry->finished = learnIPAddressProcessPacket(entry,
+                                                                  &header,
+                                                                  packet);
+            }
+
+            if (entry->finished)
+                continue;
+
+            if (threadsTerminate || entry->req->terminate) {
+                entry->req->status = ECANCELED;
+                entry->showError = false;
+                entry->finished = true;
+            } else if (virNetDevValidateConfig(entry->req->ifname, NULL,
+                                               entry->req->ifindex) <= 0) {
+                /* the VM's interface disappeared */
+                virResetLastError();
+                entry->req->status = ENODEV;
+                entry->showError = false;
+                entry->finished = true;
+            }
+        }
+
+        /* iterate backwards so removals don't disturb the fd mapping
+         * of the entries not visited yet */
+        for (i = nLearnEntries; i > 0; i--) {
+            entry = learnEntries[i - 1];
+            if (entry->finished) {
+                virNWFilterLearnEntryComplete(entry);
+                VIR_DELETE_ELEMENT(learnEntries, i - 1, nLearnEntries);
+            }
+        }
+    }
+
+    VIR_FREE(fds);
 }
 
 
@@ -674,10 +881,10 @@ learnIPAddressThread(void *arg)
  *              IP address; must choose any of the available flags
  *
  * Instruct to learn the IP address being used on a given interface (ifname).
- * Unless there already is a thread attempting to learn the IP address
- * being used on the interface, a thread is started that will listen on
- * the traffic being sent on the interface (or link device) with the
- * MAC address that is provided. Will then launch the application of the
+ * The request is handed to the monitor thread, which listens on the
+ * traffic being sent on the interface (or link device) with the
+ * MAC address that is provided, and which is started if it is not
+ * running yet. Will then launch the application of the
  * firewall rules on the interface.
  */
 int
@@ -749,11 +956,26 @@ virNWFilterLearnIPAddress(virNWFilterTechDriverPtr techdriver,
     if (rc < 0)
         goto err_free_req;
 
-    if (virThreadCreate(&thread,
-                        false,
-                        learnIPAddressThread,
-                        req) != 0)
+    virMutexLock(&learnNewReqsLock);
+
+    if (VIR_APPEND_ELEMENT_COPY(learnNewReqs, nLearnNewReqs, req) < 0) {
+        virMutexUnlock(&learnNewReqsLock);
         goto err_dereg_req;
+    }
+
+    if (!learnMonitorRunning) {
+        if (virThreadCreate(&thread,
+                            false,
+                            learnIPAddressesThread,
+                            NULL) != 0) {
+            nLearnNewReqs--;
+            virMutexUnlock(&learnNewReqsLock);
+            goto err_dereg_req;
+        }
+        learnMonitorRunning = true;
+    }
+
+    virMutexUnlock(&learnNewReqsLock);
 
     return 0;
 
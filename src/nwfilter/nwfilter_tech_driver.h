@@ -39,7 +39,8 @@ struct _virNWFilterRuleInst {
     virNWFilterChainPriority chainPriority;
     virNWFilterRuleDefPtr def;
     virNWFilterRulePriority priority;
-    virNWFilterHashTablePtr vars;
+    virNWFilterHashTablePtr vars; /* borrowed from the virNWFilterInst
+                                   * owning this rule instance */
 };
 
 
@@ -1388,6 +1388,56 @@ phypGetLparMem(virConnectPtr conn, const char *managed_system, int lpar_id,
     return memory;
 }
 
+/*
+ * Fetch both the maximum and the current memory of an LPAR in a
+ * single HMC round trip; the -F flag takes a comma separated field
+ * list and prints the values comma separated on one line.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+static int
+phypGetLparMemBoth(virConnectPtr conn, const char *managed_system,
+                   int lpar_id, unsigned long *maxmem, unsigned long *curmem)
+{
+    phyp_driverPtr phyp_driver = conn->privateData;
+    LIBSSH2_SESSION *session = phyp_driver->session;
+    int system_type = phyp_driver->system_type;
+    virBuffer buf = VIR_BUFFER_INITIALIZER;
+    char *str = NULL;
+    char *sep;
+    char *char_ptr;
+    int exit_status = 0;
+    int max = 0;
+    int cur = 0;
+    int ret = -1;
+
+    virBufferAddLit(&buf, "lshwres");
+    if (system_type == HMC)
+        virBufferAsprintf(&buf, " -m %s", managed_system);
+    virBufferAsprintf(&buf,
+                      " -r mem --level lpar -F curr_max_mem,curr_mem"
+                      " --filter lpar_ids=%d", lpar_id);
+    str = phypExecBuffer(session, &buf, &exit_status, conn, true);
+    if (!str || exit_status)
+        goto cleanup;
+
+    if (!(sep = strchr(str, ',')))
+        goto cleanup;
+    *sep++ = '\0';
+
+    if (virStrToLong_i(str, &char_ptr, 10, &max) < 0 ||
+        virStrToLong_i(sep, &char_ptr, 10, &cur) < 0)
+        goto cleanup;
+
+    *maxmem = max;
+    *curmem = cur;
+    ret = 0;
+
+ cleanup:
+    VIR_FREE(str);
+    return ret;
+}
+
 static unsigned long
 phypGetLparCPUGeneric(virConnectPtr conn, const char *managed_system,
                       int lpar_id, int type)
@@ -3258,6 +3308,8 @@ phypDomainGetXMLDesc(virDomainPtr dom, unsigned int flags)
     virDomainDef def;
     char *managed_system = phyp_driver->managed_system;
     unsigned long long memory;
+    unsigned long maxmem = 0;
+    unsigned long curmem = 0;
     unsigned int vcpus;
 
     /* Flags checked by virDomainDefFormat */
@@ -3280,15 +3332,25 @@ phypDomainGetXMLDesc(virDomainPtr dom, unsigned int flags)
         goto err;
     }
 
-    if ((memory = phypGetLparMem(dom->conn, managed_system, dom->id, 0)) == 0) {
+    /* one round trip for both memory values */
+    if (phypGetLparMemBoth(dom->conn, managed_system, dom->id,
+                           &maxmem, &curmem) == 0) {
+        memory = maxmem;
+        def.mem.cur_balloon = curmem;
+    } else {
+        memory = phypGetLparMem(dom->conn, managed_system, dom->id, 0);
+        def.mem.cur_balloon =
+            phypGetLparMem(dom->conn, managed_system, dom->id, 1);
+    }
+
+    if (memory == 0) {
         VIR_ERROR(_("Unable to determine domain's max memory."));
         goto err;
     }
 
     virDomainDefSetMemoryTotal(&def, memory);
 
-    if ((def.mem.cur_balloon =
-         phypGetLparMem(dom->conn, managed_system, dom->id, 1)) == 0) {
+    if (def.mem.cur_balloon == 0) {
         VIR_ERROR(_("Unable to determine domain's memory."));
         goto err;
     }
@@ -3413,13 +3475,17 @@ phypDomainGetInfo(virDomainPtr dom, virDomainInfoPtr info)
 
     info->state = phypGetLparState(dom->conn, dom->id);
 
-    if ((info->maxMem =
-         phypGetLparMem(dom->conn, managed_system, dom->id, 0)) == 0)
-        VIR_WARN("Unable to determine domain's max memory.");
+    /* one round trip for both memory values */
+    if (phypGetLparMemBoth(dom->conn, managed_system, dom->id,
+                           &info->maxMem, &info->memory) < 0) {
+        if ((info->maxMem =
+             phypGetLparMem(dom->conn, managed_system, dom->id, 0)) == 0)
+            VIR_WARN("Unable to determine domain's max memory.");
 
-    if ((info->memory =
-         phypGetLparMem(dom->conn, managed_system, dom->id, 1)) == 0)
-        VIR_WARN("Unable to determine domain's memory.");
+        if ((info->memory =
+             phypGetLparMem(dom->conn, managed_system, dom->id, 1)) == 0)
+            VIR_WARN("Unable to determine domain's memory.");
+    }
 
     if ((info->nrVirtCpu =
          phypGetLparCPU(dom->conn, managed_system, dom->id)) == 0)
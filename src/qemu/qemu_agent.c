@@ -104,9 +104,17 @@ struct _qemuAgent {
 
     qemuAgentCallbacksPtr cb;
 
-    /* If there's a command being processed this will be
-     * non-NULL */
-    qemuAgentMessagePtr msg;
+    /* Queue of messages awaiting transmission and/or a reply.
+     * The guest agent executes commands serially and its replies
+     * carry no identifiers (only guest-sync echoes one), so replies
+     * are matched to the oldest fully transmitted message */
+    qemuAgentMessagePtr *msgs;
+    size_t nmsgs;
+
+    /* Number of stale replies to drop before matching replies
+     * against the queue again; raised whenever a caller abandons
+     * a message that was already on the wire */
+    size_t ndiscard;
 
     /* Buffer incoming data ready for Agent monitor
      * code to process & find message boundaries */
@@ -169,6 +177,7 @@ static void qemuAgentDispose(void *obj)
     if (mon->cb && mon->cb->destroy)
         (mon->cb->destroy)(mon, mon->vm);
     virCondDestroy(&mon->notify);
+    VIR_FREE(mon->msgs);
     VIR_FREE(mon->buffer);
     virResetError(&mon->lastError);
 }
@@ -357,6 +366,16 @@ qemuAgentIOProcessLine(qemuAgentPtr mon,
                     ret = 0;
                     goto cleanup;
                 }
+
+                /* The agent replies in order, so once the matching
+                 * sync reply arrives every reply to an abandoned
+                 * command preceding it has been seen and dropped */
+                mon->ndiscard = 0;
+            } else if (mon->ndiscard) {
+                VIR_DEBUG("Dropping reply to an abandoned command");
+                mon->ndiscard--;
+                ret = 0;
+                goto cleanup;
             }
             msg->rxObject = obj;
             msg->finished = 1;
@@ -420,20 +439,28 @@ static int
 qemuAgentIOProcess(qemuAgentPtr mon)
 {
     int len;
+    size_t i;
     qemuAgentMessagePtr msg = NULL;
 
-    /* See if there's a message ready for reply; that is,
-     * one that has completed writing all its data.
+    /* See if there's a message ready for reply; that is, the
+     * oldest one that has completed writing all its data.
+     * Transmission happens in queue order, so nothing younger
+     * can have finished writing before it.
      */
-    if (mon->msg && mon->msg->txOffset == mon->msg->txLength)
-        msg = mon->msg;
+    for (i = 0; i < mon->nmsgs; i++) {
+        if (mon->msgs[i]->finished)
+            continue;
+        if (mon->msgs[i]->txOffset == mon->msgs[i]->txLength)
+            msg = mon->msgs[i];
+        break;
+    }
 
 #if DEBUG_IO
 # if DEBUG_RAW_IO
     char *str1 = qemuAgentEscapeNonPrintable(msg ? msg->txBuffer : "");
     char *str2 = qemuAgentEscapeNonPrintable(mon->buffer);
-    VIR_ERROR(_("Process %zu %p %p [[[%s]]][[[%s]]]"),
-              mon->bufferOffset, mon->msg, msg, str1, str2);
+    VIR_ERROR(_("Process %zu %zu %p [[[%s]]][[[%s]]]"),
+              mon->bufferOffset, mon->nmsgs, msg, str1, str2);
     VIR_FREE(str1);
     VIR_FREE(str2);
 # else
@@ -500,15 +527,24 @@ qemuAgentIOConnect(qemuAgentPtr mon)
 static int
 qemuAgentIOWrite(qemuAgentPtr mon)
 {
+    qemuAgentMessagePtr msg = NULL;
+    size_t i;
     int done;
 
-    /* If no active message, or fully transmitted, then no-op */
-    if (!mon->msg || mon->msg->txOffset == mon->msg->txLength)
+    /* Transmit in queue order; find the oldest message with
+     * data still to write.  If there is none, then no-op */
+    for (i = 0; i < mon->nmsgs; i++) {
+        if (mon->msgs[i]->txOffset < mon->msgs[i]->txLength) {
+            msg = mon->msgs[i];
+            break;
+        }
+    }
+    if (!msg)
         return 0;
 
     done = safewrite(mon->fd,
-                     mon->msg->txBuffer + mon->msg->txOffset,
-                     mon->msg->txLength - mon->msg->txOffset);
+                     msg->txBuffer + msg->txOffset,
+                     msg->txLength - msg->txOffset);
 
     if (done < 0) {
         if (errno == EAGAIN)
@@ -518,7 +554,7 @@ qemuAgentIOWrite(qemuAgentPtr mon)
                              _("Unable to write to monitor"));
         return -1;
     }
-    mon->msg->txOffset += done;
+    msg->txOffset += done;
     return done;
 }
 
@@ -576,6 +612,7 @@ qemuAgentIORead(qemuAgentPtr mon)
 
 static void qemuAgentUpdateWatch(qemuAgentPtr mon)
 {
+    size_t i;
     int events =
         VIR_EVENT_HANDLE_HANGUP |
         VIR_EVENT_HANDLE_ERROR;
@@ -583,8 +620,12 @@ static void qemuAgentUpdateWatch(qemuAgentPtr mon)
     if (mon->lastError.code == VIR_ERR_OK) {
         events |= VIR_EVENT_HANDLE_READABLE;
 
-        if (mon->msg && mon->msg->txOffset < mon->msg->txLength)
-            events |= VIR_EVENT_HANDLE_WRITABLE;
+        for (i = 0; i < mon->nmsgs; i++) {
+            if (mon->msgs[i]->txOffset < mon->msgs[i]->txLength) {
+                events |= VIR_EVENT_HANDLE_WRITABLE;
+                break;
+            }
+        }
     }
 
     virEventUpdateHandle(mon->watch, events);
@@ -683,11 +724,13 @@ qemuAgentIO(int watch, int fd, int events, void *opaque)
         }
 
         VIR_DEBUG("Error on monitor %s", NULLSTR(mon->lastError.message));
-        /* If IO process resulted in an error & we have a message,
-         * then wakeup that waiter */
-        if (mon->msg && !mon->msg->finished) {
-            mon->msg->finished = 1;
-            virCondSignal(&mon->notify);
+        /* If IO process resulted in an error & we have messages
+         * queued, then wakeup all their waiters */
+        if (mon->nmsgs) {
+            size_t i;
+            for (i = 0; i < mon->nmsgs; i++)
+                mon->msgs[i]->finished = 1;
+            virCondBroadcast(&mon->notify);
         }
     }
 
@@ -702,7 +745,7 @@ qemuAgentIO(int watch, int fd, int events, void *opaque)
         virDomainObjPtr vm = mon->vm;
 
         /* Make sure anyone waiting wakes up now */
-        virCondSignal(&mon->notify);
+        virCondBroadcast(&mon->notify);
         virObjectUnlock(mon);
         virObjectUnref(mon);
         VIR_DEBUG("Triggering EOF callback");
@@ -713,7 +756,7 @@ qemuAgentIO(int watch, int fd, int events, void *opaque)
         virDomainObjPtr vm = mon->vm;
 
         /* Make sure anyone waiting wakes up now */
-        virCondSignal(&mon->notify);
+        virCondBroadcast(&mon->notify);
         virObjectUnlock(mon);
         virObjectUnref(mon);
         VIR_DEBUG("Triggering error callback");
@@ -815,10 +858,12 @@ qemuAgentNotifyCloseLocked(qemuAgentPtr mon)
         mon->running = false;
 
         /* If there is somebody waiting for a message
-         * wake him up. No message will arrive anyway. */
-        if (mon->msg && !mon->msg->finished) {
-            mon->msg->finished = 1;
-            virCondSignal(&mon->notify);
+         * wake them up. No message will arrive anyway. */
+        if (mon->nmsgs) {
+            size_t i;
+            for (i = 0; i < mon->nmsgs; i++)
+                mon->msgs[i]->finished = 1;
+            virCondBroadcast(&mon->notify);
         }
     }
 }
@@ -876,6 +921,11 @@ void qemuAgentClose(qemuAgentPtr mon)
  * immediately without waiting. Any positive value means the number of seconds
  * to wait for the result.
  *
+ * The message is appended to the monitor's queue, so several callers
+ * may have commands in flight at once; each waits for its own message
+ * with its own deadline and a timed out caller no longer blocks the
+ * channel for everybody else.
+ *
  * Returns: 0 on success,
  *          -2 on timeout,
  *          -1 otherwise
@@ -885,6 +935,7 @@ static int qemuAgentSend(qemuAgentPtr mon,
                          int seconds)
 {
     int ret = -1;
+    size_t i;
     unsigned long long then = 0;
 
     /* Check whether qemu quit unexpectedly */
@@ -904,10 +955,11 @@ static int qemuAgentSend(qemuAgentPtr mon,
         then = now + seconds * 1000ull;
     }
 
-    mon->msg = msg;
+    if (VIR_APPEND_ELEMENT_COPY(mon->msgs, mon->nmsgs, msg) < 0)
+        return -1;
     qemuAgentUpdateWatch(mon);
 
-    while (!mon->msg->finished) {
+    while (!msg->finished) {
         if ((then && virCondWaitUntil(&mon->notify, &mon->parent.lock, then) < 0) ||
             (!then && virCondWait(&mon->notify, &mon->parent.lock) < 0)) {
             if (errno == ETIMEDOUT) {
@@ -933,7 +985,17 @@ static int qemuAgentSend(qemuAgentPtr mon,
     ret = 0;
 
  cleanup:
-    mon->msg = NULL;
+    for (i = 0; i < mon->nmsgs; i++) {
+        if (mon->msgs[i] != msg)
+            continue;
+        /* A message that was already on the wire when its caller
+         * gave up may still get a reply; arrange for that reply to
+         * be dropped rather than matched to a younger message */
+        if (!msg->finished && msg->txOffset == msg->txLength)
+            mon->ndiscard++;
+        VIR_DELETE_ELEMENT(mon->msgs, i, mon->nmsgs);
+        break;
+    }
     qemuAgentUpdateWatch(mon);
 
     return ret;
@@ -1139,7 +1201,12 @@ qemuAgentCommand(qemuAgentPtr mon,
         return -1;
     }
 
-    if (qemuAgentGuestSync(mon) < 0)
+    /* Sync only while the channel is idle: a guest-sync interleaved
+     * with an outstanding command would swallow that command's reply,
+     * and a non-empty queue means a sync already ran since the last
+     * channel error anyway */
+    if (mon->nmsgs == 0 &&
+        qemuAgentGuestSync(mon) < 0)
         return -1;
 
     memset(&msg, 0, sizeof(msg));
@@ -1248,15 +1315,24 @@ qemuAgentMakeStringsArray(const char **strings, unsigned int len)
 void qemuAgentNotifyEvent(qemuAgentPtr mon,
                           qemuAgentEvent event)
 {
+    size_t i;
+
     virObjectLock(mon);
 
     VIR_DEBUG("mon=%p event=%d await_event=%d", mon, event, mon->await_event);
     if (mon->await_event == event) {
         mon->await_event = QEMU_AGENT_EVENT_NONE;
-        /* somebody waiting for this event, wake him up. */
-        if (mon->msg && !mon->msg->finished) {
-            mon->msg->finished = 1;
-            virCondSignal(&mon->notify);
+        /* somebody waiting for this event, wake them up; the
+         * command that armed the event is the oldest transmitted
+         * message still waiting for a reply */
+        for (i = 0; i < mon->nmsgs; i++) {
+            if (mon->msgs[i]->finished)
+                continue;
+            if (mon->msgs[i]->txOffset == mon->msgs[i]->txLength) {
+                mon->msgs[i]->finished = 1;
+                virCondBroadcast(&mon->notify);
+            }
+            break;
         }
     }
 
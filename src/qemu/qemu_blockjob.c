@@ -28,6 +28,7 @@
 
 #include "conf/domain_conf.h"
 #include "conf/domain_event.h"
+#include "storage/storage_driver.h"
 
 #include "virlog.h"
 #include "virstoragefile.h"
@@ -160,6 +161,9 @@ qemuBlockJobEventProcess(virQEMUDriverPtr driver,
         save = disk->mirrorState != VIR_DOMAIN_DISK_MIRROR_STATE_NONE;
         disk->mirrorState = VIR_DOMAIN_DISK_MIRROR_STATE_NONE;
         disk->mirrorJob = VIR_DOMAIN_BLOCK_JOB_TYPE_UNKNOWN;
+        /* pull and commit rewrite image headers in place, possibly
+         * without changing the file's size or mtime */
+        virStorageFileInvalidateMetadataCache(disk->src);
         ignore_value(qemuDomainDetermineDiskChain(driver, vm, disk,
                                                   true, true));
         diskPriv->blockjob = false;
@@ -184,6 +188,10 @@ qemuBlockJobEventProcess(virQEMUDriverPtr driver,
         break;
     }
 
+    /* Pulls, commits and completed copies all rewrite the backing
+     * chain; let per-chain caches revalidate */
+    diskPriv->chainGen++;
+
     if (save) {
         if (virDomainSaveStatus(driver->xmlopt, cfg->stateDir, vm, driver->caps) < 0)
             VIR_WARN("Unable to save status on vm %s after block job",
@@ -198,10 +206,91 @@ qemuBlockJobEventProcess(virQEMUDriverPtr driver,
     qemuDomainEventQueue(driver, event);
     qemuDomainEventQueue(driver, event2);
 
+    /* The job state just changed, so don't let pollers see the
+     * pre-event snapshot for the rest of its lifetime */
+    qemuBlockJobInfoCacheInvalidate(vm);
+
     virObjectUnref(cfg);
 }
 
 
+/**
+ * qemuBlockJobInfoCacheInvalidate:
+ * @vm: domain
+ *
+ * Drop the cached query-block-jobs snapshot, forcing the next
+ * qemuBlockJobInfoGet to ask the monitor again.
+ */
+void
+qemuBlockJobInfoCacheInvalidate(virDomainObjPtr vm)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+
+    virHashFree(priv->blockJobInfoCache);
+    priv->blockJobInfoCache = NULL;
+    priv->blockJobInfoCacheWhen = 0;
+}
+
+
+#define QEMU_BLOCKJOB_INFO_CACHE_TTL_MS 1000
+
+
+/**
+ * qemuBlockJobInfoGet:
+ * @driver: qemu driver
+ * @vm: domain
+ * @disk: domain disk
+ * @rawInfo: filled with the current state of @disk's block job
+ *
+ * Look up the progress of @disk's block job.  Orchestrators tend to
+ * poll every disk of a domain once a second, so rather than paying a
+ * monitor round trip per disk the answers are served from a cached
+ * query-block-jobs snapshot refreshed at most once per second.  The
+ * snapshot is dropped whenever a block job event arrives, so state
+ * transitions are never reported stale.
+ *
+ * The caller must hold a job on @vm.
+ *
+ * Returns 1 if info is available, 0 if @disk has no block job and
+ * -1 on error.
+ */
+int
+qemuBlockJobInfoGet(virQEMUDriverPtr driver,
+                    virDomainObjPtr vm,
+                    virDomainDiskDefPtr disk,
+                    qemuMonitorBlockJobInfoPtr rawInfo)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    qemuMonitorBlockJobInfoPtr data;
+    unsigned long long now;
+
+    if (virTimeMillisNow(&now) < 0)
+        return -1;
+
+    if (!priv->blockJobInfoCache ||
+        now - priv->blockJobInfoCacheWhen >= QEMU_BLOCKJOB_INFO_CACHE_TTL_MS) {
+        virHashTablePtr all;
+
+        qemuDomainObjEnterMonitor(driver, vm);
+        all = qemuMonitorGetAllBlockJobInfo(priv->mon);
+        if (qemuDomainObjExitMonitor(driver, vm) < 0 || !all) {
+            virHashFree(all);
+            return -1;
+        }
+
+        virHashFree(priv->blockJobInfoCache);
+        priv->blockJobInfoCache = all;
+        priv->blockJobInfoCacheWhen = now;
+    }
+
+    if (!(data = virHashLookup(priv->blockJobInfoCache, disk->info.alias)))
+        return 0;
+
+    *rawInfo = *data;
+    return 1;
+}
+
+
 /**
  * qemuBlockJobSyncBegin:
  * @disk: domain disk
@@ -24,6 +24,7 @@
 
 # include "internal.h"
 # include "qemu_conf.h"
+# include "qemu_monitor.h"
 
 int qemuBlockJobUpdate(virQEMUDriverPtr driver,
                        virDomainObjPtr vm,
@@ -34,6 +35,12 @@ void qemuBlockJobEventProcess(virQEMUDriverPtr driver,
                               int type,
                               int status);
 
+int qemuBlockJobInfoGet(virQEMUDriverPtr driver,
+                        virDomainObjPtr vm,
+                        virDomainDiskDefPtr disk,
+                        qemuMonitorBlockJobInfoPtr rawInfo);
+void qemuBlockJobInfoCacheInvalidate(virDomainObjPtr vm);
+
 void qemuBlockJobSyncBegin(virDomainDiskDefPtr disk);
 void qemuBlockJobSyncEnd(virQEMUDriverPtr driver,
                          virDomainObjPtr vm,
@@ -379,6 +379,7 @@ struct _virQEMUCaps {
 
     char *binary;
     time_t ctime;
+    ino_t inode;
 
     virBitmapPtr flags;
 
@@ -2133,6 +2134,7 @@ virQEMUCapsPtr virQEMUCapsNewCopy(virQEMUCapsPtr qemuCaps)
         goto error;
 
     ret->ctime = qemuCaps->ctime;
+    ret->inode = qemuCaps->inode;
 
     virBitmapCopy(ret->flags, qemuCaps->flags);
 
@@ -3124,6 +3126,7 @@ virQEMUCapsLoadCPUModels(virQEMUCapsPtr qemuCaps,
  *
  * <qemuCaps>
  *   <qemuctime>234235253</qemuctime>
+ *   <qemuinode>5233523</qemuinode>
  *   <selfctime>234235253</selfctime>
  *   <selfvers>1002016</selfvers>
  *   <usedQMP/>
@@ -3178,6 +3181,12 @@ virQEMUCapsLoadCache(virCapsPtr caps,
     }
     qemuCaps->ctime = (time_t)l;
 
+    /* Older caches did not record the inode; 0 flags it as unknown
+     * so that validation skips the inode comparison */
+    qemuCaps->inode = 0;
+    if (virXPathLongLong("string(./qemuinode)", ctxt, &l) == 0)
+        qemuCaps->inode = (ino_t)l;
+
     if (virXPathLongLong("string(./selfctime)", ctxt, &l) < 0) {
         virReportError(VIR_ERR_XML_ERROR, "%s",
                        _("missing selfctime in QEMU capabilities XML"));
@@ -3412,6 +3421,9 @@ virQEMUCapsFormatCache(virQEMUCapsPtr qemuCaps,
 
     virBufferAsprintf(&buf, "<qemuctime>%llu</qemuctime>\n",
                       (long long) qemuCaps->ctime);
+    if (qemuCaps->inode)
+        virBufferAsprintf(&buf, "<qemuinode>%llu</qemuinode>\n",
+                          (unsigned long long) qemuCaps->inode);
     virBufferAsprintf(&buf, "<selfctime>%llu</selfctime>\n",
                       (long long) selfCTime);
     virBufferAsprintf(&buf, "<selfvers>%lu</selfvers>\n",
@@ -3591,6 +3603,7 @@ virQEMUCapsInitCached(virCapsPtr caps,
     char *binaryhash = NULL;
     struct stat sb;
     time_t qemuctime = qemuCaps->ctime;
+    ino_t qemuinode = qemuCaps->inode;
     time_t selfctime;
     unsigned long selfvers;
 
@@ -3633,7 +3646,7 @@ virQEMUCapsInitCached(virCapsPtr caps,
         goto discard;
     }
 
-    if (!virQEMUCapsIsValid(qemuCaps, qemuctime, runUid, runGid))
+    if (!virQEMUCapsIsValid(qemuCaps, qemuctime, qemuinode, runUid, runGid))
         goto discard;
 
     /* Discard cache if QEMU binary or libvirtd changed */
@@ -3654,6 +3667,7 @@ virQEMUCapsInitCached(virCapsPtr caps,
     ret = 1;
  cleanup:
     qemuCaps->ctime = qemuctime;
+    qemuCaps->inode = qemuinode;
     VIR_FREE(binaryhash);
     VIR_FREE(capsfile);
     VIR_FREE(capsdir);
@@ -4475,6 +4489,7 @@ virQEMUCapsNewForBinaryInternal(virCapsPtr caps,
         goto error;
     }
     qemuCaps->ctime = sb.st_ctime;
+    qemuCaps->inode = sb.st_ino;
 
     /* Make sure the binary we are about to try exec'ing exists.
      * Technically we could catch the exec() failure, but that's
@@ -4545,6 +4560,7 @@ virQEMUCapsNewForBinary(virCapsPtr caps,
 bool
 virQEMUCapsIsValid(virQEMUCapsPtr qemuCaps,
                    time_t qemuctime,
+                   ino_t qemuinode,
                    uid_t runUid,
                    gid_t runGid)
 {
@@ -4553,7 +4569,7 @@ virQEMUCapsIsValid(virQEMUCapsPtr qemuCaps,
     if (!qemuCaps->binary)
         return true;
 
-    if (!qemuctime) {
+    if (!qemuctime || !qemuinode) {
         struct stat sb;
 
         if (stat(qemuCaps->binary, &sb) < 0) {
@@ -4564,6 +4580,7 @@ virQEMUCapsIsValid(virQEMUCapsPtr qemuCaps,
             return false;
         }
         qemuctime = sb.st_ctime;
+        qemuinode = sb.st_ino;
     }
 
     if (qemuctime != qemuCaps->ctime) {
@@ -4574,6 +4591,18 @@ virQEMUCapsIsValid(virQEMUCapsPtr qemuCaps,
         return false;
     }
 
+    /* A 0 inode means the cache pre-dates inode tracking, so only
+     * the ctime comparison above is possible */
+    if (qemuCaps->inode &&
+        qemuinode != qemuCaps->inode) {
+        VIR_DEBUG("Outdated capabilities for '%s': QEMU binary replaced "
+                  "(inode %llu vs %llu)",
+                  qemuCaps->binary,
+                  (unsigned long long) qemuinode,
+                  (unsigned long long) qemuCaps->inode);
+        return false;
+    }
+
     kvmUsable = virFileAccessibleAs("/dev/kvm", R_OK | W_OK,
                                     runUid, runGid) == 0;
 
@@ -4647,9 +4676,9 @@ virQEMUCapsCacheNew(const char *libDir,
     if (VIR_ALLOC(cache) < 0)
         return NULL;
 
-    if (virMutexInit(&cache->lock) < 0) {
+    if (virRWLockInit(&cache->lock) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Unable to initialize mutex"));
+                       _("Unable to initialize RW lock"));
         VIR_FREE(cache);
         return NULL;
     }
@@ -4679,7 +4708,7 @@ virQEMUCapsCacheValidate(virQEMUCapsCachePtr cache,
                          virQEMUCapsPtr *qemuCaps)
 {
     if (*qemuCaps &&
-        !virQEMUCapsIsValid(*qemuCaps, 0, cache->runUid, cache->runGid)) {
+        !virQEMUCapsIsValid(*qemuCaps, 0, 0, cache->runUid, cache->runGid)) {
         VIR_DEBUG("Cached capabilities %p no longer valid for %s",
                   *qemuCaps, binary);
         virHashRemoveEntry(cache->binaries, binary);
@@ -4715,13 +4744,27 @@ virQEMUCapsCacheLookup(virCapsPtr caps,
     if (qemuTestCapsName)
         binary = qemuTestCapsName;
 
-    virMutexLock(&cache->lock);
+    /* Hot path; as long as the cached capabilities are still valid
+     * the read lock is enough, so concurrent lookups from the RPC
+     * workers don't serialize on the cache */
+    virRWLockRead(&cache->lock);
+    ret = virHashLookup(cache->binaries, binary);
+    if (ret && virQEMUCapsIsValid(ret, 0, 0, cache->runUid, cache->runGid)) {
+        virObjectRef(ret);
+        virRWLockUnlock(&cache->lock);
+        VIR_DEBUG("Returning caps %p for %s", ret, binary);
+        return ret;
+    }
+    virRWLockUnlock(&cache->lock);
 
+    /* Missing or outdated capabilities need to be (re)created under
+     * the write lock; the lookup has to be redone as the cache may
+     * have changed while it was unlocked */
+    virRWLockWrite(&cache->lock);
     ret = virHashLookup(cache->binaries, binary);
     virQEMUCapsCacheValidate(cache, binary, caps, &ret);
     virObjectRef(ret);
-
-    virMutexUnlock(&cache->lock);
+    virRWLockUnlock(&cache->lock);
 
     VIR_DEBUG("Returning caps %p for %s", ret, binary);
     return ret;
@@ -4768,7 +4811,7 @@ virQEMUCapsCacheLookupByArch(virCapsPtr caps,
     virArch target;
     struct virQEMUCapsSearchData data = { .arch = arch };
 
-    virMutexLock(&cache->lock);
+    virRWLockWrite(&cache->lock);
     ret = virHashSearch(cache->binaries, virQEMUCapsCompareArch, &data);
     if (!ret) {
         /* If the first attempt at finding capabilities has failed, try
@@ -4796,7 +4839,7 @@ virQEMUCapsCacheLookupByArch(virCapsPtr caps,
     }
 
     virObjectRef(ret);
-    virMutexUnlock(&cache->lock);
+    virRWLockUnlock(&cache->lock);
 
     VIR_DEBUG("Returning caps %p for arch %s", ret, virArchToString(arch));
 
@@ -4813,7 +4856,7 @@ virQEMUCapsCacheFree(virQEMUCapsCachePtr cache)
     VIR_FREE(cache->libDir);
     VIR_FREE(cache->cacheDir);
     virHashFree(cache->binaries);
-    virMutexDestroy(&cache->lock);
+    virRWLockDestroy(&cache->lock);
     VIR_FREE(cache);
 }
 
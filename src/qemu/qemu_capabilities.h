@@ -454,6 +454,7 @@ int virQEMUCapsGetMachineTypesCaps(virQEMUCapsPtr qemuCaps,
 
 bool virQEMUCapsIsValid(virQEMUCapsPtr qemuCaps,
                         time_t ctime,
+                        ino_t inode,
                         uid_t runUid,
                         gid_t runGid);
 
@@ -1169,6 +1169,21 @@ qemuSetupCgroupCpusetCpus(virCgroupPtr cgroup,
 {
     int ret = -1;
     char *new_cpus = NULL;
+    char *cur_cpus = NULL;
+    virBitmapPtr cur_map = NULL;
+
+    /* The kernel rebalances the whole cpuset hierarchy on every write
+     * to cpuset.cpus, even one that doesn't change the mask.  When a
+     * pinning policy is reapplied across all vCPUs of a large guest
+     * most of the masks are typically unchanged, so leave those
+     * cgroups untouched. */
+    if (virCgroupGetCpusetCpus(cgroup, &cur_cpus) == 0 &&
+        virBitmapParse(cur_cpus, &cur_map, VIR_DOMAIN_CPUMASK_LEN) == 0 &&
+        virBitmapEqual(cur_map, cpumask)) {
+        ret = 0;
+        goto cleanup;
+    }
+    virResetLastError();
 
     if (!(new_cpus = virBitmapFormat(cpumask)))
         goto cleanup;
@@ -1178,6 +1193,8 @@ qemuSetupCgroupCpusetCpus(virCgroupPtr cgroup,
 
     ret = 0;
  cleanup:
+    virBitmapFree(cur_map);
+    VIR_FREE(cur_cpus);
     VIR_FREE(new_cpus);
     return ret;
 }
@@ -8254,10 +8254,14 @@ qemuBuildInterfaceCommandLine(virQEMUDriverPtr driver,
             goto cleanup;
     }
 
+    /* All the queue fds of one interface reference the same character
+     * device inode, so labelling the first fd covers the whole set */
+    if (tapfdSize > 0 &&
+        virSecurityManagerSetTapFDLabel(driver->securityManager,
+                                        def, tapfd[0]) < 0)
+        goto cleanup;
+
     for (i = 0; i < tapfdSize; i++) {
-        if (virSecurityManagerSetTapFDLabel(driver->securityManager,
-                                            def, tapfd[i]) < 0)
-            goto cleanup;
         virCommandPassFD(cmd, tapfd[i],
                          VIR_COMMAND_PASS_FD_CLOSE_PARENT);
         if (virAsprintf(&tapfdName[i], "%d", tapfd[i]) < 0)
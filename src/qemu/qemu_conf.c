@@ -51,6 +51,7 @@
 #include "virfile.h"
 #include "virstring.h"
 #include "viratomic.h"
+#include "virtime.h"
 #include "storage_conf.h"
 #include "configmake.h"
 
@@ -310,6 +311,8 @@ virQEMUDriverConfigPtr virQEMUDriverConfigNew(bool privileged)
     cfg->keepAliveCount = 5;
     cfg->seccompSandbox = -1;
 
+    cfg->maxAutostartWorkers = 1;
+
     cfg->logTimestamp = true;
     cfg->glusterDebugLevel = 4;
     cfg->stdioLogD = true;
@@ -750,6 +753,12 @@ int virQEMUDriverConfigLoadFile(virQEMUDriverConfigPtr cfg,
     if (virConfGetValueUInt(conf, "max_queued", &cfg->maxQueuedJobs) < 0)
         goto cleanup;
 
+    if (virConfGetValueUInt(conf, "max_autostart_workers",
+                            &cfg->maxAutostartWorkers) < 0)
+        goto cleanup;
+    if (cfg->maxAutostartWorkers == 0)
+        cfg->maxAutostartWorkers = 1;
+
     if (virConfGetValueInt(conf, "keepalive_interval", &cfg->keepAliveInterval) < 0)
         goto cleanup;
     if (virConfGetValueUInt(conf, "keepalive_count", &cfg->keepAliveCount) < 0)
@@ -846,11 +855,24 @@ int virQEMUDriverConfigLoadFile(virQEMUDriverConfigPtr cfg,
 
 virQEMUDriverConfigPtr virQEMUDriverGetConfig(virQEMUDriverPtr driver)
 {
-    virQEMUDriverConfigPtr conf;
-    qemuDriverLock(driver);
-    conf = virObjectRef(driver->config);
-    qemuDriverUnlock(driver);
-    return conf;
+    /* The config object is created once in qemuStateInitialize and the
+     * pointer never changes afterwards, so taking a reference needs no
+     * driver lock; this function runs for nearly every RPC and the
+     * mutex was bouncing between all worker threads */
+    return virObjectRef(driver->config);
+}
+
+/* Return a borrowed reference to the driver config.  The config object
+ * is created once in qemuStateInitialize and the pointer is never
+ * replaced, so the returned pointer stays valid for as long as @driver
+ * does.  Callers must not unref it or stash it beyond the lifetime of
+ * their caller-held driver reference; use virQEMUDriverGetConfig when a
+ * real reference is needed.  This exists for hot paths (e.g. the bulk
+ * stats sweep) where even the ref/unref atomic pair showed up in
+ * profiles. */
+virQEMUDriverConfigPtr virQEMUDriverPeekConfig(virQEMUDriverPtr driver)
+{
+    return driver->config;
 }
 
 bool
@@ -934,12 +956,21 @@ virCapsPtr virQEMUDriverCreateCapabilities(virQEMUDriverPtr driver)
 }
 
 
+/* How long rebuilt host capabilities stay fresh before a caller asking
+ * for the cached object triggers a rebuild; long enough to absorb
+ * polling monitoring stacks, short enough to notice CPU/memory hotplug
+ * reasonably soon */
+#define QEMU_DRIVER_CAPS_VALID_MS (10 * 1000)
+
 /**
  * virQEMUDriverGetCapabilities:
  *
  * Get a reference to the virCapsPtr instance for the
  * driver. If @refresh is true, the capabilities will be
- * rebuilt first
+ * rebuilt first. Cached capabilities older than a short
+ * freshness window are rebuilt as well, so host hotplug
+ * events are picked up without every caller paying for a
+ * rebuild.
  *
  * The caller must release the reference with virObjetUnref
  *
@@ -949,6 +980,18 @@ virCapsPtr virQEMUDriverGetCapabilities(virQEMUDriverPtr driver,
                                         bool refresh)
 {
     virCapsPtr ret = NULL;
+    unsigned long long now = 0;
+
+    ignore_value(virTimeMillisNow(&now));
+
+    if (!refresh) {
+        qemuDriverLock(driver);
+        if (!driver->capsRefreshedAt ||
+            now >= driver->capsRefreshedAt + QEMU_DRIVER_CAPS_VALID_MS)
+            refresh = true;
+        qemuDriverUnlock(driver);
+    }
+
     if (refresh) {
         virCapsPtr caps = NULL;
         if ((caps = virQEMUDriverCreateCapabilities(driver)) == NULL)
@@ -957,6 +1000,8 @@ virCapsPtr virQEMUDriverGetCapabilities(virQEMUDriverPtr driver,
         qemuDriverLock(driver);
         virObjectUnref(driver->caps);
         driver->caps = caps;
+        driver->capsRefreshedAt = now;
+        VIR_FREE(driver->capsXML);
     } else {
         qemuDriverLock(driver);
     }
@@ -973,6 +1018,42 @@ virCapsPtr virQEMUDriverGetCapabilities(virQEMUDriverPtr driver,
     return ret;
 }
 
+
+/**
+ * virQEMUDriverGetCapabilitiesXML:
+ *
+ * Return the formatted host capabilities document. The formatted text
+ * is cached next to the capabilities object it was produced from and
+ * handed out as a copy until the capabilities are rebuilt, so frequent
+ * pollers do not re-format the same document over and over.
+ *
+ * The caller owns the returned string.
+ */
+char *
+virQEMUDriverGetCapabilitiesXML(virQEMUDriverPtr driver)
+{
+    virCapsPtr caps;
+    char *xml = NULL;
+
+    if (!(caps = virQEMUDriverGetCapabilities(driver, false)))
+        return NULL;
+
+    qemuDriverLock(driver);
+    if (driver->caps == caps) {
+        if (!driver->capsXML)
+            driver->capsXML = virCapabilitiesFormatXML(caps);
+        if (driver->capsXML)
+            ignore_value(VIR_STRDUP(xml, driver->capsXML));
+    } else {
+        /* A refresh raced with us; format the object we hold */
+        xml = virCapabilitiesFormatXML(caps);
+    }
+    qemuDriverUnlock(driver);
+
+    virObjectUnref(caps);
+    return xml;
+}
+
 struct _qemuSharedDeviceEntry {
     size_t ref;
     char **domains; /* array of domain names */
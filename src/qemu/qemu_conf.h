@@ -164,6 +164,8 @@ struct _virQEMUDriverConfig {
 
     unsigned int maxQueuedJobs;
 
+    unsigned int maxAutostartWorkers;
+
     char **securityDriverNames;
     bool securityDefaultConfined;
     bool securityRequireConfined;
@@ -201,8 +203,8 @@ struct _virQEMUDriverConfig {
 struct _virQEMUDriver {
     virMutex lock;
 
-    /* Require lock to get reference on 'config',
-     * then lockless thereafter */
+    /* Assigned once during qemuStateInitialize and immutable
+     * thereafter; lockless access, reference counted object */
     virQEMUDriverConfigPtr config;
 
     /* Immutable pointer, self-locking APIs */
@@ -235,6 +237,11 @@ struct _virQEMUDriver {
      */
     virCapsPtr caps;
 
+    /* Require lock; when the capabilities were last rebuilt (in ms) and
+     * the cached formatted document for them, dropped on every rebuild */
+    unsigned long long capsRefreshedAt;
+    char *capsXML;
+
     /* Immutable pointer, Immutable object */
     virDomainXMLOptionPtr xmlopt;
 
@@ -295,11 +302,13 @@ int virQEMUDriverConfigLoadFile(virQEMUDriverConfigPtr cfg,
                                 const char *filename);
 
 virQEMUDriverConfigPtr virQEMUDriverGetConfig(virQEMUDriverPtr driver);
+virQEMUDriverConfigPtr virQEMUDriverPeekConfig(virQEMUDriverPtr driver);
 bool virQEMUDriverIsPrivileged(virQEMUDriverPtr driver);
 
 virCapsPtr virQEMUDriverCreateCapabilities(virQEMUDriverPtr driver);
 virCapsPtr virQEMUDriverGetCapabilities(virQEMUDriverPtr driver,
                                         bool refresh);
+char *virQEMUDriverGetCapabilitiesXML(virQEMUDriverPtr driver);
 
 typedef struct _qemuSharedDeviceEntry qemuSharedDeviceEntry;
 typedef qemuSharedDeviceEntry *qemuSharedDeviceEntryPtr;
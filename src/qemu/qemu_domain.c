@@ -42,6 +42,7 @@
 #include "domain_event.h"
 #include "virtime.h"
 #include "virstoragefile.h"
+#include "virprobe.h"
 #include "virstring.h"
 #include "virthreadjob.h"
 #include "viratomic.h"
@@ -66,6 +67,10 @@
 
 #include <libxml/xpathInternals.h>
 
+#ifdef WITH_DTRACE_PROBES
+# include "libvirt_qemu_probes.h"
+#endif
+
 #define VIR_FROM_THIS VIR_FROM_QEMU
 
 VIR_LOG_INIT("qemu.qemu_domain");
@@ -507,7 +512,10 @@ qemuDomainJobInfoToParams(qemuDomainJobInfoPtr jobInfo,
                                 stats->ram_dirty_rate) < 0 ||
         virTypedParamsAddULLong(&par, &npar, &maxpar,
                                 VIR_DOMAIN_JOB_MEMORY_ITERATION,
-                                stats->ram_iteration) < 0)
+                                stats->ram_iteration) < 0 ||
+        virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                VIR_DOMAIN_JOB_MEMORY_POSTCOPY_REQS,
+                                stats->ram_postcopy_reqs) < 0)
         goto error;
 
     if (virTypedParamsAddULLong(&par, &npar, &maxpar,
@@ -1639,6 +1647,8 @@ qemuDomainObjPrivateFree(void *data)
 
     virStringListFree(priv->qemuDevices);
     virChrdevFree(priv->devs);
+    virHashFree(priv->blockJobInfoCache);
+    virHashFree(priv->diskAliasIndex);
 
     /* This should never be non-NULL if we get here, but just in case... */
     if (priv->mon) {
@@ -3369,11 +3379,13 @@ static int ATTRIBUTE_NONNULL(1)
 qemuDomainObjBeginJobInternal(virQEMUDriverPtr driver,
                               virDomainObjPtr obj,
                               qemuDomainJob job,
-                              qemuDomainAsyncJob asyncJob)
+                              qemuDomainAsyncJob asyncJob,
+                              bool nowait)
 {
     qemuDomainObjPrivatePtr priv = obj->privateData;
     unsigned long long now;
     unsigned long long then;
+    unsigned long long waitStarted;
     bool nested = job == QEMU_JOB_ASYNC_NESTED;
     bool async = job == QEMU_JOB_ASYNC;
     virQEMUDriverConfigPtr cfg = virQEMUDriverGetConfig(driver);
@@ -3399,6 +3411,7 @@ qemuDomainObjBeginJobInternal(virQEMUDriverPtr driver,
     }
 
     priv->jobs_queued++;
+    waitStarted = now;
     then = now + QEMU_JOB_WAIT_TIME;
 
  retry:
@@ -3408,12 +3421,18 @@ qemuDomainObjBeginJobInternal(virQEMUDriverPtr driver,
     }
 
     while (!nested && !qemuDomainNestedJobAllowed(priv, job)) {
+        if (nowait)
+            goto cleanup;
+
         VIR_DEBUG("Waiting for async job (vm=%p name=%s)", obj, obj->def->name);
         if (virCondWaitUntil(&priv->job.asyncCond, &obj->parent.lock, then) < 0)
             goto error;
     }
 
     while (priv->job.active) {
+        if (nowait)
+            goto cleanup;
+
         VIR_DEBUG("Waiting for job (vm=%p name=%s)", obj, obj->def->name);
         if (virCondWaitUntil(&priv->job.cond, &obj->parent.lock, then) < 0)
             goto error;
@@ -3428,6 +3447,10 @@ qemuDomainObjBeginJobInternal(virQEMUDriverPtr driver,
 
     ignore_value(virTimeMillisNow(&now));
 
+    PROBE(QEMU_DOMAIN_BEGIN_JOB,
+          "vm=%p name=%s job=%d asyncJob=%d wait_ms=%llu",
+          obj, obj->def->name, job, asyncJob, now - waitStarted);
+
     if (job != QEMU_JOB_ASYNC) {
         VIR_DEBUG("Started job: %s (async=%s vm=%p name=%s)",
                    qemuDomainJobTypeToString(job),
@@ -3459,6 +3482,11 @@ qemuDomainObjBeginJobInternal(virQEMUDriverPtr driver,
 
  error:
     ignore_value(virTimeMillisNow(&now));
+
+    PROBE(QEMU_DOMAIN_BEGIN_JOB_FAIL,
+          "vm=%p name=%s job=%d asyncJob=%d wait_ms=%llu",
+          obj, obj->def->name, job, asyncJob, now - waitStarted);
+
     if (priv->job.active && priv->job.started)
         duration = now - priv->job.started;
     if (priv->job.asyncJob && priv->job.asyncStarted)
@@ -3528,18 +3556,33 @@ int qemuDomainObjBeginJob(virQEMUDriverPtr driver,
                           qemuDomainJob job)
 {
     if (qemuDomainObjBeginJobInternal(driver, obj, job,
-                                      QEMU_ASYNC_JOB_NONE) < 0)
+                                      QEMU_ASYNC_JOB_NONE, false) < 0)
         return -1;
     else
         return 0;
 }
 
+/*
+ * obj must be locked before calling
+ *
+ * This acquires the lock and starts a job if no job is active on
+ * @obj, but unlike qemuDomainObjBeginJob it does not wait for an
+ * already active job to finish, failing straight away instead.
+ */
+int qemuDomainObjBeginJobNowait(virQEMUDriverPtr driver,
+                                virDomainObjPtr obj,
+                                qemuDomainJob job)
+{
+    return qemuDomainObjBeginJobInternal(driver, obj, job,
+                                         QEMU_ASYNC_JOB_NONE, true);
+}
+
 int qemuDomainObjBeginAsyncJob(virQEMUDriverPtr driver,
                                virDomainObjPtr obj,
                                qemuDomainAsyncJob asyncJob)
 {
     if (qemuDomainObjBeginJobInternal(driver, obj, QEMU_JOB_ASYNC,
-                                      asyncJob) < 0)
+                                      asyncJob, false) < 0)
         return -1;
     else
         return 0;
@@ -3565,7 +3608,8 @@ qemuDomainObjBeginNestedJob(virQEMUDriverPtr driver,
 
     return qemuDomainObjBeginJobInternal(driver, obj,
                                          QEMU_JOB_ASYNC_NESTED,
-                                         QEMU_ASYNC_JOB_NONE);
+                                         QEMU_ASYNC_JOB_NONE,
+                                         false);
 }
 
 
@@ -3580,14 +3624,25 @@ qemuDomainObjEndJob(virQEMUDriverPtr driver, virDomainObjPtr obj)
 {
     qemuDomainObjPrivatePtr priv = obj->privateData;
     qemuDomainJob job = priv->job.active;
+    unsigned long long now = 0;
 
     priv->jobs_queued--;
 
+    ignore_value(virTimeMillisNow(&now));
+    PROBE(QEMU_DOMAIN_END_JOB,
+          "vm=%p name=%s job=%d held_ms=%llu",
+          obj, obj->def->name, job,
+          priv->job.started ? now - priv->job.started : 0);
+
     VIR_DEBUG("Stopping job: %s (async=%s vm=%p name=%s)",
               qemuDomainJobTypeToString(job),
               qemuDomainAsyncJobTypeToString(priv->job.asyncJob),
               obj, obj->def->name);
 
+    /* we have no idea whether the job changed the definition, so
+     * conservatively invalidate any cached XML */
+    virDomainObjDefGenerationBump(obj);
+
     qemuDomainObjResetJob(priv);
     if (qemuDomainTrackJob(job))
         qemuDomainObjSaveJob(driver, obj);
@@ -3605,6 +3660,8 @@ qemuDomainObjEndAsyncJob(virQEMUDriverPtr driver, virDomainObjPtr obj)
               qemuDomainAsyncJobTypeToString(priv->job.asyncJob),
               obj, obj->def->name);
 
+    virDomainObjDefGenerationBump(obj);
+
     qemuDomainObjResetAsyncJob(priv);
     qemuDomainObjSaveJob(driver, obj);
     virCondBroadcast(&priv->job.asyncCond);
@@ -3987,6 +4044,7 @@ char *qemuDomainFormatXML(virQEMUDriverPtr driver,
                           unsigned int flags)
 {
     virDomainDefPtr def;
+    char *xml;
 
     if ((flags & VIR_DOMAIN_XML_INACTIVE) && vm->newDef) {
         def = vm->newDef;
@@ -3996,7 +4054,17 @@ char *qemuDomainFormatXML(virQEMUDriverPtr driver,
             flags &= ~VIR_DOMAIN_XML_UPDATE_CPU;
     }
 
-    return qemuDomainDefFormatXML(driver, def, flags);
+    /* Formatting a big definition is not cheap and management apps
+     * tend to poll the XML of every domain; reuse the last document
+     * as long as the definition has not changed since */
+    if ((xml = virDomainObjGetXMLCache(vm, def, flags)))
+        return xml;
+
+    if (!(xml = qemuDomainDefFormatXML(driver, def, flags)))
+        return NULL;
+
+    virDomainObjSetXMLCache(vm, def, flags, xml);
+    return xml;
 }
 
 char *
@@ -5063,6 +5131,9 @@ qemuDomainDetermineDiskChain(virQEMUDriverPtr driver,
                                   report_broken) < 0)
         ret = -1;
 
+    /* The chain was (re-)probed; invalidate per-chain caches */
+    QEMU_DOMAIN_DISK_PRIVATE(disk)->chainGen++;
+
  cleanup:
     virObjectUnref(cfg);
     return ret;
@@ -6016,6 +6087,7 @@ qemuDomainUpdateCurrentMemorySize(virQEMUDriverPtr driver,
      * full memory size */
     if (!virDomainDefHasMemballoon(vm->def)) {
         vm->def->mem.cur_balloon = virDomainDefGetMemoryTotal(vm->def);
+        virDomainObjDefGenerationBump(vm);
         return 0;
     }
 
@@ -6049,6 +6121,7 @@ qemuDomainUpdateCurrentMemorySize(virQEMUDriverPtr driver,
             return -1;
 
         vm->def->mem.cur_balloon = balloon;
+        virDomainObjDefGenerationBump(vm);
     }
 
     return 0;
@@ -246,6 +246,18 @@ struct _qemuDomainObjPrivate {
 
     /* note whether memory device alias does not correspond to slot number */
     bool memAliasOrderMismatch;
+
+    /* snapshot of query-block-jobs answers (alias -> info), shared by
+     * the per-disk block job info pollers; see qemuBlockJobInfoGet */
+    virHashTablePtr blockJobInfoCache;
+    unsigned long long blockJobInfoCacheWhen; /* ms timestamp of snapshot */
+
+    /* lazily built index of disk aliases for event handling, discarded
+     * whenever the definition generation moves; see
+     * qemuProcessFindDomainDiskByAlias */
+    virHashTablePtr diskAliasIndex;
+    virDomainDefPtr diskAliasIndexDef; /* compared by pointer only */
+    unsigned long long diskAliasIndexGeneration;
 };
 
 # define QEMU_DOMAIN_PRIVATE(vm)	\
@@ -320,6 +332,14 @@ struct _qemuDomainDiskPrivate {
     /* information about the device */
     bool tray; /* device has tray */
     bool removable; /* device media can be removed/changed */
+
+    /* generation number of the backing chain, bumped whenever the
+     * chain composition changes so per-chain caches can be
+     * revalidated without re-walking the chain */
+    unsigned long long chainGen;
+    /* chainGen + 1 as of the last storage limits refresh of the whole
+     * chain; zero means the limits were never refreshed */
+    unsigned long long chainLimitsGen;
 };
 
 # define QEMU_DOMAIN_HOSTDEV_PRIVATE(hostdev)	\
@@ -421,6 +441,10 @@ int qemuDomainObjBeginJob(virQEMUDriverPtr driver,
                           virDomainObjPtr obj,
                           qemuDomainJob job)
     ATTRIBUTE_RETURN_CHECK;
+int qemuDomainObjBeginJobNowait(virQEMUDriverPtr driver,
+                                virDomainObjPtr obj,
+                                qemuDomainJob job)
+    ATTRIBUTE_RETURN_CHECK;
 int qemuDomainObjBeginAsyncJob(virQEMUDriverPtr driver,
                                virDomainObjPtr obj,
                                qemuDomainAsyncJob asyncJob)
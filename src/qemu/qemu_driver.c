@@ -308,6 +308,95 @@ qemuAutostartDomain(virDomainObjPtr vm,
 }
 
 
+struct qemuAutostartState {
+    struct qemuAutostartData data;
+    virMutex lock;
+    virCond cond;
+    size_t pending;
+};
+
+static void
+qemuAutostartDomainWorker(void *jobdata, void *opaque)
+{
+    virDomainObjPtr vm = jobdata;
+    struct qemuAutostartState *state = opaque;
+
+    ignore_value(qemuAutostartDomain(vm, &state->data));
+    virObjectUnref(vm);
+
+    virMutexLock(&state->lock);
+    state->pending--;
+    virCondSignal(&state->cond);
+    virMutexUnlock(&state->lock);
+}
+
+
+static int
+qemuAutostartDomainsParallel(virQEMUDriverPtr driver,
+                             virConnectPtr conn,
+                             size_t nworkers)
+{
+    struct qemuAutostartState state;
+    virThreadPoolPtr pool = NULL;
+    virDomainObjPtr *vms = NULL;
+    size_t nvms = 0;
+    size_t i;
+    int ret = -1;
+
+    memset(&state, 0, sizeof(state));
+    state.data.driver = driver;
+    state.data.conn = conn;
+
+    if (virMutexInit(&state.lock) < 0)
+        return -1;
+    if (virCondInit(&state.cond) < 0) {
+        virMutexDestroy(&state.lock);
+        return -1;
+    }
+
+    if (virDomainObjListCollect(driver->domains, conn, &vms, &nvms, NULL,
+                                VIR_CONNECT_LIST_DOMAINS_INACTIVE |
+                                VIR_CONNECT_LIST_DOMAINS_AUTOSTART) < 0)
+        goto cleanup;
+
+    if (nvms && nworkers > nvms)
+        nworkers = nvms;
+
+    if (nvms &&
+        !(pool = virThreadPoolNew(nworkers, nworkers, 0,
+                                  qemuAutostartDomainWorker, &state)))
+        goto cleanup;
+
+    for (i = 0; i < nvms; i++) {
+        virMutexLock(&state.lock);
+        state.pending++;
+        virMutexUnlock(&state.lock);
+
+        /* on dispatch failure run the domain in this thread rather
+         * than skipping it */
+        if (virThreadPoolSendJob(pool, 0, vms[i]) < 0)
+            qemuAutostartDomainWorker(vms[i], &state);
+        vms[i] = NULL;
+    }
+
+    virMutexLock(&state.lock);
+    while (state.pending > 0)
+        ignore_value(virCondWait(&state.cond, &state.lock));
+    virMutexUnlock(&state.lock);
+
+    ret = 0;
+
+ cleanup:
+    virThreadPoolFree(pool);
+    for (i = 0; i < nvms; i++)
+        virObjectUnref(vms[i]);
+    VIR_FREE(vms);
+    virCondDestroy(&state.cond);
+    virMutexDestroy(&state.lock);
+    return ret;
+}
+
+
 static void
 qemuAutostartDomains(virQEMUDriverPtr driver)
 {
@@ -321,7 +410,10 @@ qemuAutostartDomains(virQEMUDriverPtr driver)
     /* Ignoring NULL conn which is mostly harmless here */
     struct qemuAutostartData data = { driver, conn };
 
-    virDomainObjListForEach(driver->domains, qemuAutostartDomain, &data);
+    if (cfg->maxAutostartWorkers <= 1 ||
+        qemuAutostartDomainsParallel(driver, conn,
+                                     cfg->maxAutostartWorkers) < 0)
+        virDomainObjListForEach(driver->domains, qemuAutostartDomain, &data);
 
     virObjectUnref(conn);
     virObjectUnref(cfg);
@@ -1073,6 +1165,7 @@ qemuStateCleanup(void)
     virObjectUnref(qemu_driver->hostdevMgr);
     virHashFree(qemu_driver->sharedDevices);
     virObjectUnref(qemu_driver->caps);
+    VIR_FREE(qemu_driver->capsXML);
     virQEMUCapsCacheFree(qemu_driver->qemuCapsCache);
 
     virObjectUnref(qemu_driver->domains);
@@ -1292,158 +1385,119 @@ qemuConnectGetMaxVcpus(virConnectPtr conn ATTRIBUTE_UNUSED, const char *type)
 
 static char *qemuConnectGetCapabilities(virConnectPtr conn) {
     virQEMUDriverPtr driver = conn->privateData;
-    virCapsPtr caps = NULL;
-    char *xml = NULL;
 
     if (virConnectGetCapabilitiesEnsureACL(conn) < 0)
         return NULL;
 
-    if (!(caps = virQEMUDriverGetCapabilities(driver, true)))
-        goto cleanup;
-
-    xml = virCapabilitiesFormatXML(caps);
-    virObjectUnref(caps);
-
- cleanup:
-
-    return xml;
+    return virQEMUDriverGetCapabilitiesXML(driver);
 }
 
 
 static int
-qemuGetSchedInfo(unsigned long long *cpuWait,
-                 pid_t pid, pid_t tid)
-{
-    char *proc = NULL;
-    char *data = NULL;
-    char **lines = NULL;
-    size_t i;
+qemuGetVcpuTaskInfo(int taskfd,
+                    pid_t tid,
+                    unsigned long long *cpuTime,
+                    int *lastCpu)
+{
+    char path[64];
+    char line[1024];
+    char *tmp;
+    int fd = -1;
+    ssize_t len;
+    unsigned long long usertime = 0, systime = 0;
+    int cpu = 0;
     int ret = -1;
-    double val;
-
-    *cpuWait = 0;
 
-    /* In general, we cannot assume pid_t fits in int; but /proc parsing
-     * is specific to Linux where int works fine.  */
-    if (tid)
-        ret = virAsprintf(&proc, "/proc/%d/task/%d/sched", (int)pid, (int)tid);
-    else
-        ret = virAsprintf(&proc, "/proc/%d/sched", (int)pid);
-    if (ret < 0)
-        goto cleanup;
-    ret = -1;
+    snprintf(path, sizeof(path), "%d/stat", (int)tid);
 
-    /* The file is not guaranteed to exist (needs CONFIG_SCHED_DEBUG) */
-    if (access(proc, R_OK) < 0) {
-        ret = 0;
+    if ((fd = openat(taskfd, path, O_RDONLY)) < 0 ||
+        (len = saferead(fd, line, sizeof(line) - 1)) < 0) {
+        virReportSystemError(errno,
+                             _("cannot read vCPU task info of task %d"),
+                             (int)tid);
         goto cleanup;
     }
+    line[len] = '\0';
 
-    if (virFileReadAll(proc, (1<<16), &data) < 0)
-        goto cleanup;
-
-    lines = virStringSplit(data, "\n", 0);
-    if (!lines)
-        goto cleanup;
-
-    for (i = 0; lines[i] != NULL; i++) {
-        const char *line = lines[i];
-
-        /* Needs CONFIG_SCHEDSTATS. The second check
-         * is the old name the kernel used in past */
-        if (STRPREFIX(line, "se.statistics.wait_sum") ||
-            STRPREFIX(line, "se.wait_sum")) {
-            line = strchr(line, ':');
-            if (!line) {
-                virReportError(VIR_ERR_INTERNAL_ERROR,
-                               _("Missing separator in sched info '%s'"),
-                               lines[i]);
-                goto cleanup;
-            }
-            line++;
-            while (*line == ' ')
-                line++;
-
-            if (virStrToDouble(line, NULL, &val) < 0) {
-                virReportError(VIR_ERR_INTERNAL_ERROR,
-                               _("Unable to parse sched info value '%s'"),
-                               line);
-                goto cleanup;
-            }
-
-            *cpuWait = (unsigned long long)(val * 1000000);
-            break;
-        }
+    /* See 'man proc'; the comm field may contain spaces, so parsing
+     * starts after its closing parenthesis */
+    if (!(tmp = strrchr(line, ')')) ||
+        sscanf(tmp + 1,
+               /* state -> stime */
+               " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu"
+               /* cutime -> endcode */
+               "%*d %*d %*d %*d %*d %*d %*u %*u %*d %*u %*u %*u"
+               /* startstack -> processor */
+               "%*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %*d %d",
+               &usertime, &systime, &cpu) != 3) {
+        VIR_WARN("cannot parse process status data for task %d", (int)tid);
     }
 
+    /* We got jiffies, we want nanoseconds, _SC_CLK_TCK is jiffies
+     * per second */
+    if (cpuTime)
+        *cpuTime = 1000ull * 1000ull * 1000ull * (usertime + systime)
+            / (unsigned long long)sysconf(_SC_CLK_TCK);
+    if (lastCpu)
+        *lastCpu = cpu;
+
     ret = 0;
 
  cleanup:
-    VIR_FREE(data);
-    VIR_FREE(proc);
-    virStringListFree(lines);
+    VIR_FORCE_CLOSE(fd);
     return ret;
 }
 
 
 static int
-qemuGetProcessInfo(unsigned long long *cpuTime, int *lastCpu, long *vm_rss,
-                   pid_t pid, int tid)
+qemuGetVcpuSchedWait(int taskfd,
+                     pid_t tid,
+                     unsigned long long *cpuWait)
 {
-    char *proc;
-    FILE *pidinfo;
-    unsigned long long usertime = 0, systime = 0;
-    long rss = 0;
-    int cpu = 0;
-    int ret;
+    char path[64];
+    char line[128];
+    char *tmp;
+    int fd = -1;
+    ssize_t len;
+    int ret = -1;
 
-    /* In general, we cannot assume pid_t fits in int; but /proc parsing
-     * is specific to Linux where int works fine.  */
-    if (tid)
-        ret = virAsprintf(&proc, "/proc/%d/task/%d/stat", (int) pid, tid);
-    else
-        ret = virAsprintf(&proc, "/proc/%d/stat", (int) pid);
-    if (ret < 0)
-        return -1;
+    *cpuWait = 0;
 
-    pidinfo = fopen(proc, "r");
-    VIR_FREE(proc);
+    snprintf(path, sizeof(path), "%d/schedstat", (int)tid);
 
-    /* See 'man proc' for information about what all these fields are. We're
-     * only interested in a very few of them */
-    if (!pidinfo ||
-        fscanf(pidinfo,
-               /* pid -> stime */
-               "%*d (%*[^)]) %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu"
-               /* cutime -> endcode */
-               "%*d %*d %*d %*d %*d %*d %*u %*u %ld %*u %*u %*u"
-               /* startstack -> processor */
-               "%*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %*d %d",
-               &usertime, &systime, &rss, &cpu) != 4) {
-        VIR_WARN("cannot parse process status data");
+    /* The file is not guaranteed to exist (needs CONFIG_SCHEDSTATS) */
+    if ((fd = openat(taskfd, path, O_RDONLY)) < 0) {
+        if (errno == ENOENT)
+            return 0;
+        virReportSystemError(errno,
+                             _("cannot read scheduler stats of task %d"),
+                             (int)tid);
+        return -1;
     }
 
-    /* We got jiffies
-     * We want nanoseconds
-     * _SC_CLK_TCK is jiffies per second
-     * So calculate thus....
-     */
-    if (cpuTime)
-        *cpuTime = 1000ull * 1000ull * 1000ull * (usertime + systime)
-            / (unsigned long long)sysconf(_SC_CLK_TCK);
-    if (lastCpu)
-        *lastCpu = cpu;
-
-    if (vm_rss)
-        *vm_rss = rss * virGetSystemPageSizeKB();
-
+    if ((len = saferead(fd, line, sizeof(line) - 1)) < 0) {
+        virReportSystemError(errno,
+                             _("cannot read scheduler stats of task %d"),
+                             (int)tid);
+        goto cleanup;
+    }
+    line[len] = '\0';
 
-    VIR_DEBUG("Got status for %d/%d user=%llu sys=%llu cpu=%d rss=%ld",
-              (int) pid, tid, usertime, systime, cpu, rss);
+    /* Fields are run time, run queue wait time (both ns) and number
+     * of timeslices; we only want the wait time */
+    if (!(tmp = strchr(line, ' ')) ||
+        virStrToLong_ullp(tmp + 1, &tmp, 10, cpuWait) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Unable to parse scheduler stats '%s'"),
+                       line);
+        goto cleanup;
+    }
 
-    VIR_FORCE_FCLOSE(pidinfo);
+    ret = 0;
 
-    return 0;
+ cleanup:
+    VIR_FORCE_CLOSE(fd);
+    return ret;
 }
 
 
@@ -1458,6 +1512,8 @@ qemuDomainHelperGetVcpus(virDomainObjPtr vm,
 {
     size_t ncpuinfo = 0;
     size_t i;
+    int taskfd = -1;
+    int ret = -1;
 
     if (maxinfo == 0)
         return 0;
@@ -1477,6 +1533,20 @@ qemuDomainHelperGetVcpus(virDomainObjPtr vm,
     if (cpuhalted)
         memset(cpuhalted, 0, sizeof(*cpuhalted) * maxinfo);
 
+    /* Open the task directory once for the whole harvest; each vCPU's
+     * stat files are then a single component resolution away instead
+     * of walking a full /proc path per vCPU per file */
+    if (info || cpuwait) {
+        char path[64];
+
+        snprintf(path, sizeof(path), "/proc/%d/task", (int)vm->pid);
+        if ((taskfd = open(path, O_RDONLY | O_DIRECTORY)) < 0) {
+            virReportSystemError(errno,
+                                 _("cannot open %s"), path);
+            return -1;
+        }
+    }
+
     for (i = 0; i < virDomainDefGetVcpusMax(vm->def) && ncpuinfo < maxinfo; i++) {
         virDomainVcpuDefPtr vcpu = virDomainDefGetVcpu(vm->def, i);
         pid_t vcpupid = qemuDomainGetVcpuPid(vm, i);
@@ -1489,13 +1559,10 @@ qemuDomainHelperGetVcpus(virDomainObjPtr vm,
             vcpuinfo->number = i;
             vcpuinfo->state = VIR_VCPU_RUNNING;
 
-            if (qemuGetProcessInfo(&vcpuinfo->cpuTime,
-                                   &vcpuinfo->cpu, NULL,
-                                   vm->pid, vcpupid) < 0) {
-                virReportSystemError(errno, "%s",
-                                     _("cannot get vCPU placement & pCPU time"));
-                return -1;
-            }
+            if (qemuGetVcpuTaskInfo(taskfd, vcpupid,
+                                    &vcpuinfo->cpuTime,
+                                    &vcpuinfo->cpu) < 0)
+                goto cleanup;
         }
 
         if (cpumaps) {
@@ -1503,15 +1570,16 @@ qemuDomainHelperGetVcpus(virDomainObjPtr vm,
             virBitmapPtr map = NULL;
 
             if (!(map = virProcessGetAffinity(vcpupid)))
-                return -1;
+                goto cleanup;
 
             virBitmapToDataBuf(map, cpumap, maplen);
             virBitmapFree(map);
         }
 
         if (cpuwait) {
-            if (qemuGetSchedInfo(&(cpuwait[ncpuinfo]), vm->pid, vcpupid) < 0)
-                return -1;
+            if (qemuGetVcpuSchedWait(taskfd, vcpupid,
+                                     &(cpuwait[ncpuinfo])) < 0)
+                goto cleanup;
         }
 
         if (cpuhalted)
@@ -1520,7 +1588,11 @@ qemuDomainHelperGetVcpus(virDomainObjPtr vm,
         ncpuinfo++;
     }
 
-    return ncpuinfo;
+    ret = ncpuinfo;
+
+ cleanup:
+    VIR_FORCE_CLOSE(taskfd);
+    return ret;
 }
 
 
@@ -2653,7 +2725,7 @@ qemuDomainGetInfo(virDomainPtr dom,
     }
 
     if (virDomainObjIsActive(vm)) {
-        if (qemuGetProcessInfo(&(info->cpuTime), NULL, NULL, vm->pid, 0) < 0) {
+        if (virProcessGetStatInfo(&(info->cpuTime), NULL, NULL, vm->pid, 0) < 0) {
             virReportError(VIR_ERR_OPERATION_FAILED, "%s",
                            _("cannot read cputime for domain"));
             goto cleanup;
@@ -2860,7 +2932,19 @@ qemuCompressGetCommand(virQEMUSaveFormat compression)
         return NULL;
     }
 
-    ret = virCommandNew(prog);
+    if (compression == QEMU_SAVE_FORMAT_GZIP) {
+        char *pigz;
+
+        /* pigz reads the same format with extra helper threads for
+         * reading and CRC checking, so prefer it when installed */
+        if ((pigz = virFindFileInPath("pigz"))) {
+            ret = virCommandNew(pigz);
+            VIR_FREE(pigz);
+        }
+    }
+
+    if (!ret)
+        ret = virCommandNew(prog);
     virCommandAddArg(ret, "-dc");
 
     switch (compression) {
@@ -2874,6 +2958,35 @@ qemuCompressGetCommand(virQEMUSaveFormat compression)
     return ret;
 }
 
+
+/* qemuCompressGetSaveCommand:
+ * @compression: virQEMUSaveFormat of the image being written
+ * @compresspath: resolved compression binary from
+ *                qemuGetCompressionProgram
+ *
+ * Counterpart of qemuCompressGetCommand, building the command that
+ * compresses a save or dump stream on its way to disk.
+ */
+static virCommandPtr
+qemuCompressGetSaveCommand(int compression, const char *compresspath)
+{
+    virCommandPtr ret = virCommandNew(compresspath);
+
+    virCommandAddArg(ret, "-c");
+
+    switch (compression) {
+    case QEMU_SAVE_FORMAT_XZ:
+        /* Compress independent blocks on all cores; the resulting
+         * multi-block stream is still readable by any xz -dc */
+        virCommandAddArg(ret, "-T0");
+        break;
+    default:
+        break;
+    }
+
+    return ret;
+}
+
 /* Internal function to properly create or open existing files, with
  * ownership affected by qemu driver setup and domain DAC label.  */
 static int
@@ -3055,6 +3168,7 @@ qemuDomainSaveMemory(virQEMUDriverPtr driver,
     int ret = -1;
     int fd = -1;
     int directFlag = 0;
+    virCommandPtr compressor = NULL;
     virFileWrapperFdPtr wrapperFd = NULL;
     unsigned int wrapperFlags = VIR_FILE_WRAPPER_NON_BLOCKING;
 
@@ -3091,8 +3205,11 @@ qemuDomainSaveMemory(virQEMUDriverPtr driver,
     if (qemuDomainSaveHeader(fd, path, domXML, &header) < 0)
         goto cleanup;
 
+    if (compressedpath)
+        compressor = qemuCompressGetSaveCommand(compressed, compressedpath);
+
     /* Perform the migration */
-    if (qemuMigrationToFile(driver, vm, fd, compressedpath, asyncJob) < 0)
+    if (qemuMigrationToFile(driver, vm, fd, compressor, asyncJob) < 0)
         goto cleanup;
 
     /* Touch up file header to mark image complete. */
@@ -3128,6 +3245,7 @@ qemuDomainSaveMemory(virQEMUDriverPtr driver,
 
  cleanup:
     VIR_FORCE_CLOSE(fd);
+    virCommandFree(compressor);
     virFileWrapperFdFree(wrapperFd);
 
     if (ret < 0 && needUnlink)
@@ -3296,7 +3414,14 @@ qemuGetCompressionProgram(const char *imageFormat,
     if (ret == QEMU_SAVE_FORMAT_RAW)
         return QEMU_SAVE_FORMAT_RAW;
 
-    if (!(*compresspath = virFindFileInPath(imageFormat)))
+    /* pigz compresses gzip-format blocks on all cores, so prefer it
+     * over gzip when installed; the image stays decompressible with
+     * plain gzip */
+    if (ret == QEMU_SAVE_FORMAT_GZIP)
+        *compresspath = virFindFileInPath("pigz");
+
+    if (!*compresspath &&
+        !(*compresspath = virFindFileInPath(imageFormat)))
         goto error;
 
     return ret;
@@ -3591,15 +3716,17 @@ doCoreDump(virQEMUDriverPtr driver,
     unsigned int flags = VIR_FILE_WRAPPER_NON_BLOCKING;
     const char *memory_dump_format = NULL;
     virQEMUDriverConfigPtr cfg = virQEMUDriverGetConfig(driver);
+    int compressed;
     char *compressedpath = NULL;
+    virCommandPtr compressor = NULL;
 
     /* We reuse "save" flag for "dump" here. Then, we can support the same
      * format in "save" and "dump". This path doesn't need the compression
-     * program to exist and can ignore the return value - it only cares to
+     * program to exist and falls back to raw - it only cares to
      * get the compressedpath */
-    ignore_value(qemuGetCompressionProgram(cfg->dumpImageFormat,
+    compressed = qemuGetCompressionProgram(cfg->dumpImageFormat,
                                            &compressedpath,
-                                           "dump", true));
+                                           "dump", true);
 
     /* Create an empty file with appropriate ownership.  */
     if (dump_flags & VIR_DUMP_BYPASS_CACHE) {
@@ -3646,7 +3773,11 @@ doCoreDump(virQEMUDriverPtr driver,
         if (!qemuMigrationIsAllowed(driver, vm, false, 0))
             goto cleanup;
 
-        ret = qemuMigrationToFile(driver, vm, fd, compressedpath,
+        if (compressedpath)
+            compressor = qemuCompressGetSaveCommand(compressed,
+                                                    compressedpath);
+
+        ret = qemuMigrationToFile(driver, vm, fd, compressor,
                                   QEMU_ASYNC_JOB_DUMP);
     }
 
@@ -3669,6 +3800,7 @@ doCoreDump(virQEMUDriverPtr driver,
     if (ret != 0)
         unlink(path);
     virFileWrapperFdFree(wrapperFd);
+    virCommandFree(compressor);
     VIR_FREE(compressedpath);
     virObjectUnref(cfg);
     return ret;
@@ -8292,6 +8424,7 @@ qemuDomainAttachDeviceLiveAndConfig(virConnectPtr conn,
                                     const char *xml,
                                     unsigned int flags)
 {
+    qemuDomainObjPrivatePtr priv = vm->privateData;
     virDomainDefPtr vmdef = NULL;
     virQEMUDriverConfigPtr cfg = NULL;
     virDomainDeviceDefPtr dev = NULL, dev_copy = NULL;
@@ -8327,7 +8460,8 @@ qemuDomainAttachDeviceLiveAndConfig(virConnectPtr conn,
 
     if (flags & VIR_DOMAIN_AFFECT_CONFIG) {
         /* Make a copy for updated domain. */
-        vmdef = virDomainObjCopyPersistentDef(vm, caps, driver->xmlopt);
+        vmdef = virDomainObjCopyPersistentDef(vm, caps, driver->xmlopt,
+                                              priv->qemuCaps);
         if (!vmdef)
             goto cleanup;
 
@@ -8488,7 +8622,8 @@ static int qemuDomainUpdateDeviceFlags(virDomainPtr dom,
 
     if (flags & VIR_DOMAIN_AFFECT_CONFIG) {
         /* Make a copy for updated domain. */
-        vmdef = virDomainObjCopyPersistentDef(vm, caps, driver->xmlopt);
+        vmdef = virDomainObjCopyPersistentDef(vm, caps, driver->xmlopt,
+                                              qemuCaps);
         if (!vmdef)
             goto endjob;
 
@@ -8551,6 +8686,7 @@ qemuDomainDetachDeviceLiveAndConfig(virQEMUDriverPtr driver,
                                     const char *xml,
                                     unsigned int flags)
 {
+    qemuDomainObjPrivatePtr priv = vm->privateData;
     virCapsPtr caps = NULL;
     virQEMUDriverConfigPtr cfg = NULL;
     virDomainDeviceDefPtr dev = NULL, dev_copy = NULL;
@@ -8589,7 +8725,8 @@ qemuDomainDetachDeviceLiveAndConfig(virQEMUDriverPtr driver,
 
     if (flags & VIR_DOMAIN_AFFECT_CONFIG) {
         /* Make a copy for updated domain. */
-        vmdef = virDomainObjCopyPersistentDef(vm, caps, driver->xmlopt);
+        vmdef = virDomainObjCopyPersistentDef(vm, caps, driver->xmlopt,
+                                              priv->qemuCaps);
         if (!vmdef)
             goto cleanup;
 
@@ -10166,7 +10303,8 @@ qemuDomainSetSchedulerParametersFlags(virDomainPtr dom,
     if (persistentDef) {
         /* Make a copy for updated domain. */
         if (!(persistentDefCopy = virDomainObjCopyPersistentDef(vm, caps,
-                                                                driver->xmlopt)))
+                                                                driver->xmlopt,
+                                                                priv->qemuCaps)))
             goto endjob;
     }
 
@@ -11365,7 +11503,7 @@ qemuDomainMemoryStatsInternal(virQEMUDriverPtr driver,
         ret = 0;
     }
 
-    if (qemuGetProcessInfo(NULL, NULL, &rss, vm->pid, 0) < 0) {
+    if (virProcessGetStatInfo(NULL, NULL, &rss, vm->pid, 0) < 0) {
         virReportError(VIR_ERR_OPERATION_FAILED, "%s",
                        _("cannot get RSS for domain"));
     } else {
@@ -12018,6 +12156,7 @@ qemuDomainMigratePrepare2(virConnectPtr dconn,
     virDomainDefPtr def = NULL;
     char *origname = NULL;
     qemuMigrationCompressionPtr compression = NULL;
+    qemuMonitorMigrationParamsPtr migParams = NULL;
     int ret = -1;
 
     virCheckFlags(QEMU_MIGRATION_FLAGS, -1);
@@ -12035,6 +12174,9 @@ qemuDomainMigratePrepare2(virConnectPtr dconn,
     if (!(compression = qemuMigrationCompressionParse(NULL, 0, flags)))
         goto cleanup;
 
+    if (!(migParams = qemuMigrationParams(NULL, 0, flags)))
+        goto cleanup;
+
     if (virLockManagerPluginUsesState(driver->lockManager)) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("Cannot use migrate v2 protocol with lock manager %s"),
@@ -12056,9 +12198,10 @@ qemuDomainMigratePrepare2(virConnectPtr dconn,
                                      NULL, 0, NULL, NULL, /* No cookies */
                                      uri_in, uri_out,
                                      &def, origname, NULL, 0, NULL, 0,
-                                     compression, flags);
+                                     compression, migParams, flags);
 
  cleanup:
+    VIR_FREE(migParams);
     VIR_FREE(compression);
     VIR_FREE(origname);
     virDomainDefFree(def);
@@ -12266,6 +12409,7 @@ qemuDomainMigratePrepare3(virConnectPtr dconn,
     virDomainDefPtr def = NULL;
     char *origname = NULL;
     qemuMigrationCompressionPtr compression = NULL;
+    qemuMonitorMigrationParamsPtr migParams = NULL;
     int ret = -1;
 
     virCheckFlags(QEMU_MIGRATION_FLAGS, -1);
@@ -12283,6 +12427,9 @@ qemuDomainMigratePrepare3(virConnectPtr dconn,
     if (!(compression = qemuMigrationCompressionParse(NULL, 0, flags)))
         goto cleanup;
 
+    if (!(migParams = qemuMigrationParams(NULL, 0, flags)))
+        goto cleanup;
+
     if (!(def = qemuMigrationPrepareDef(driver, dom_xml, dname, &origname)))
         goto cleanup;
 
@@ -12294,9 +12441,10 @@ qemuDomainMigratePrepare3(virConnectPtr dconn,
                                      cookieout, cookieoutlen,
                                      uri_in, uri_out,
                                      &def, origname, NULL, 0, NULL, 0,
-                                     compression, flags);
+                                     compression, migParams, flags);
 
  cleanup:
+    VIR_FREE(migParams);
     VIR_FREE(compression);
     VIR_FREE(origname);
     virDomainDefFree(def);
@@ -12326,6 +12474,7 @@ qemuDomainMigratePrepare3Params(virConnectPtr dconn,
     const char **migrate_disks = NULL;
     char *origname = NULL;
     qemuMigrationCompressionPtr compression = NULL;
+    qemuMonitorMigrationParamsPtr migParams = NULL;
     int ret = -1;
 
     virCheckFlagsGoto(QEMU_MIGRATION_FLAGS, cleanup);
@@ -12359,6 +12508,9 @@ qemuDomainMigratePrepare3Params(virConnectPtr dconn,
     if (!(compression = qemuMigrationCompressionParse(params, nparams, flags)))
         goto cleanup;
 
+    if (!(migParams = qemuMigrationParams(params, nparams, flags)))
+        goto cleanup;
+
     if (flags & VIR_MIGRATE_TUNNELLED) {
         /* this is a logical error; we never should have gotten here with
          * VIR_MIGRATE_TUNNELLED set
@@ -12381,9 +12533,10 @@ qemuDomainMigratePrepare3Params(virConnectPtr dconn,
                                      uri_in, uri_out,
                                      &def, origname, listenAddress,
                                      nmigrate_disks, migrate_disks, nbdPort,
-                                     compression, flags);
+                                     compression, migParams, flags);
 
  cleanup:
+    VIR_FREE(migParams);
     VIR_FREE(compression);
     VIR_FREE(migrate_disks);
     VIR_FREE(origname);
@@ -13586,6 +13739,8 @@ qemuDomainSnapshotCreateInactiveExternal(virQEMUDriverPtr driver,
     virDomainSnapshotDiskDefPtr snapdisk;
     virDomainDiskDefPtr defdisk;
     virCommandPtr cmd = NULL;
+    virCommandPtr *cmds = NULL;
+    size_t ncmds = 0;
     const char *qemuImgPath;
     virBitmapPtr created = NULL;
     virQEMUDriverConfigPtr cfg = virQEMUDriverGetConfig(driver);
@@ -13597,6 +13752,10 @@ qemuDomainSnapshotCreateInactiveExternal(virQEMUDriverPtr driver,
     if (!(created = virBitmapNew(snap->def->ndisks)))
         goto cleanup;
 
+    if (!reuse &&
+        VIR_ALLOC_N(cmds, snap->def->ndisks) < 0)
+        goto cleanup;
+
     /* If reuse is true, then qemuDomainSnapshotPrepare already
      * ensured that the new files exist, and it was up to the user to
      * create them correctly.  */
@@ -13643,13 +13802,18 @@ qemuDomainSnapshotCreateInactiveExternal(virQEMUDriverPtr driver,
         if (!virFileExists(snapdisk->src->path))
             ignore_value(virBitmapSetBit(created, i));
 
-        if (virCommandRun(cmd, NULL) < 0)
-            goto cleanup;
-
-        virCommandFree(cmd);
+        cmds[ncmds++] = cmd;
         cmd = NULL;
     }
 
+    /* Create all the images with a bounded number of qemu-img
+     * processes running in parallel, instead of one after the
+     * other; guests with many disks spend most of the snapshot
+     * time right here */
+    if (ncmds &&
+        virCommandRunBatch(cmds, ncmds, 0) < 0)
+        goto cleanup;
+
     /* update disk definitions */
     for (i = 0; i < snap->def->ndisks; i++) {
         snapdisk = &(snap->def->disks[i]);
@@ -13672,6 +13836,9 @@ qemuDomainSnapshotCreateInactiveExternal(virQEMUDriverPtr driver,
 
  cleanup:
     virCommandFree(cmd);
+    for (i = 0; i < ncmds; i++)
+        virCommandFree(cmds[i]);
+    VIR_FREE(cmds);
 
     /* unlink images if creation has failed */
     if (ret < 0 && created) {
@@ -16544,11 +16711,7 @@ qemuDomainGetBlockJobInfo(virDomainPtr dom,
         goto endjob;
     }
 
-    qemuDomainObjEnterMonitor(driver, vm);
-    ret = qemuMonitorGetBlockJobInfo(qemuDomainGetMonitor(vm),
-                                     disk->info.alias, &rawInfo);
-    if (qemuDomainObjExitMonitor(driver, vm) < 0)
-        ret = -1;
+    ret = qemuBlockJobInfoGet(driver, vm, disk, &rawInfo);
     if (ret <= 0)
         goto endjob;
 
@@ -19350,14 +19513,19 @@ qemuDomainGetStatsOneBlockFallback(virQEMUDriverPtr driver,
                                    virDomainStatsRecordPtr record,
                                    int *maxparams,
                                    virStorageSourcePtr src,
-                                   size_t block_idx)
+                                   size_t block_idx,
+                                   bool refresh)
 {
     int ret = -1;
 
     if (virStorageSourceIsEmpty(src))
         return 0;
 
-    if (qemuStorageLimitsRefresh(driver, cfg, dom, src) < 0) {
+    /* When the chain generation is unchanged since the last poll the
+     * limits stored in the chain are still current and the on-disk
+     * metadata doesn't need to be resolved again */
+    if (refresh &&
+        qemuStorageLimitsRefresh(driver, cfg, dom, src) < 0) {
         virResetLastError();
         return 0;
     }
@@ -19387,7 +19555,8 @@ qemuDomainGetStatsOneBlock(virQEMUDriverPtr driver,
                            virStorageSourcePtr src,
                            size_t block_idx,
                            unsigned int backing_idx,
-                           virHashTablePtr stats)
+                           virHashTablePtr stats,
+                           bool refreshLimits)
 {
     qemuBlockStats *entry;
     int ret = -1;
@@ -19409,7 +19578,8 @@ qemuDomainGetStatsOneBlock(virQEMUDriverPtr driver,
      * ourselves */
     if (!virDomainObjIsActive(dom)) {
         ret = qemuDomainGetStatsOneBlockFallback(driver, cfg, dom, record,
-                                                 maxparams, src, block_idx);
+                                                 maxparams, src, block_idx,
+                                                 refreshLimits);
         goto cleanup;
     }
 
@@ -19475,7 +19645,7 @@ qemuDomainGetStatsBlock(virQEMUDriverPtr driver,
     int rc;
     virHashTablePtr stats = NULL;
     qemuDomainObjPrivatePtr priv = dom->privateData;
-    virQEMUDriverConfigPtr cfg = virQEMUDriverGetConfig(driver);
+    virQEMUDriverConfigPtr cfg = virQEMUDriverPeekConfig(driver);
     int count_index = -1;
     size_t visited = 0;
     bool visitBacking = !!(privflags & QEMU_DOMAIN_STATS_BACKING);
@@ -19503,18 +19673,27 @@ qemuDomainGetStatsBlock(virQEMUDriverPtr driver,
 
     for (i = 0; i < dom->def->ndisks; i++) {
         virDomainDiskDefPtr disk = dom->def->disks[i];
+        qemuDomainDiskPrivatePtr diskPriv = QEMU_DOMAIN_DISK_PRIVATE(disk);
         virStorageSourcePtr src = disk->src;
         unsigned int backing_idx = 0;
+        /* Opening every image of the chain to refresh its limits is
+         * only worthwhile when the chain composition changed since the
+         * last sweep; otherwise the limits cached in the sources are
+         * still valid */
+        bool refreshLimits = diskPriv->chainLimitsGen != diskPriv->chainGen + 1;
 
         while (src && (backing_idx == 0 || visitBacking)) {
             if (qemuDomainGetStatsOneBlock(driver, cfg, dom, record, maxparams,
                                            disk, src, visited, backing_idx,
-                                           stats) < 0)
+                                           stats, refreshLimits) < 0)
                 goto cleanup;
             visited++;
             backing_idx++;
             src = src->backingStore;
         }
+
+        if (!virDomainObjIsActive(dom) && visitBacking)
+            diskPriv->chainLimitsGen = diskPriv->chainGen + 1;
     }
 
     record->params[count_index].value.ui = visited;
@@ -19522,7 +19701,6 @@ qemuDomainGetStatsBlock(virQEMUDriverPtr driver,
 
  cleanup:
     virHashFree(stats);
-    virObjectUnref(cfg);
     return ret;
 }
 
@@ -19534,31 +19712,6 @@ qemuDomainGetStatsBlock(virQEMUDriverPtr driver,
 
 #undef QEMU_ADD_COUNT_PARAM
 
-static int
-qemuDomainGetStatsPerfOneEvent(virPerfPtr perf,
-                               virPerfEventType type,
-                               virDomainStatsRecordPtr record,
-                               int *maxparams)
-{
-    char param_name[VIR_TYPED_PARAM_FIELD_LENGTH];
-    uint64_t value = 0;
-
-    if (virPerfReadEvent(perf, type, &value) < 0)
-        return -1;
-
-    snprintf(param_name, VIR_TYPED_PARAM_FIELD_LENGTH, "perf.%s",
-             virPerfEventTypeToString(type));
-
-    if (virTypedParamsAddULLong(&record->params,
-                                &record->nparams,
-                                maxparams,
-                                param_name,
-                                value) < 0)
-        return -1;
-
-    return 0;
-}
-
 static int
 qemuDomainGetStatsPerf(virQEMUDriverPtr driver ATTRIBUTE_UNUSED,
                        virDomainObjPtr dom,
@@ -19566,16 +19719,31 @@ qemuDomainGetStatsPerf(virQEMUDriverPtr driver ATTRIBUTE_UNUSED,
                        int *maxparams,
                        unsigned int privflags ATTRIBUTE_UNUSED)
 {
+    char param_name[VIR_TYPED_PARAM_FIELD_LENGTH];
+    uint64_t values[VIR_PERF_EVENT_LAST];
     size_t i;
     qemuDomainObjPrivatePtr priv = dom->privateData;
     int ret = -1;
 
+    if (!priv->perf)
+        return 0;
+
+    /* harvest all enabled counters in one pass */
+    if (virPerfReadEvents(priv->perf, values) < 0)
+        goto cleanup;
+
     for (i = 0; i < VIR_PERF_EVENT_LAST; i++) {
         if (!virPerfEventIsEnabled(priv->perf, i))
              continue;
 
-        if (qemuDomainGetStatsPerfOneEvent(priv->perf, i,
-                                           record, maxparams) < 0)
+        snprintf(param_name, VIR_TYPED_PARAM_FIELD_LENGTH, "perf.%s",
+                 virPerfEventTypeToString(i));
+
+        if (virTypedParamsAddULLong(&record->params,
+                                    &record->nparams,
+                                    maxparams,
+                                    param_name,
+                                    values[i]) < 0)
             goto cleanup;
     }
 
@@ -19585,6 +19753,52 @@ qemuDomainGetStatsPerf(virQEMUDriverPtr driver ATTRIBUTE_UNUSED,
     return ret;
 }
 
+static int
+qemuDomainGetStatsIOThread(virQEMUDriverPtr driver ATTRIBUTE_UNUSED,
+                           virDomainObjPtr dom,
+                           virDomainStatsRecordPtr record,
+                           int *maxparams,
+                           unsigned int privflags ATTRIBUTE_UNUSED)
+{
+    char param_name[VIR_TYPED_PARAM_FIELD_LENGTH];
+    size_t i;
+
+    if (virTypedParamsAddUInt(&record->params,
+                              &record->nparams,
+                              maxparams,
+                              "iothread.count",
+                              dom->def->niothreadids) < 0)
+        return -1;
+
+    if (!virDomainObjIsActive(dom))
+        return 0;
+
+    for (i = 0; i < dom->def->niothreadids; i++) {
+        virDomainIOThreadIDDefPtr iothread = dom->def->iothreadids[i];
+        unsigned long long cpuTime = 0;
+
+        if (iothread->thread_id <= 0)
+            continue;
+
+        /* The host thread id was detected at startup, so the CPU time
+         * can be read straight from /proc without a monitor call */
+        if (virProcessGetStatInfo(&cpuTime, NULL, NULL,
+                                  dom->pid, iothread->thread_id) < 0)
+            continue;
+
+        snprintf(param_name, VIR_TYPED_PARAM_FIELD_LENGTH,
+                 "iothread.%u.time", iothread->iothread_id);
+        if (virTypedParamsAddULLong(&record->params,
+                                    &record->nparams,
+                                    maxparams,
+                                    param_name,
+                                    cpuTime) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
 typedef int
 (*qemuDomainGetStatsFunc)(virQEMUDriverPtr driver,
                           virDomainObjPtr dom,
@@ -19606,6 +19820,7 @@ static struct qemuDomainGetStatsWorker qemuDomainGetStatsWorkers[] = {
     { qemuDomainGetStatsInterface, VIR_DOMAIN_STATS_INTERFACE, false },
     { qemuDomainGetStatsBlock, VIR_DOMAIN_STATS_BLOCK, true },
     { qemuDomainGetStatsPerf, VIR_DOMAIN_STATS_PERF, false },
+    { qemuDomainGetStatsIOThread, VIR_DOMAIN_STATS_IOTHREAD, false },
     { NULL, 0, false }
 };
 
@@ -19667,6 +19882,16 @@ qemuDomainGetStats(virConnectPtr conn,
     if (VIR_ALLOC(tmp) < 0)
         goto cleanup;
 
+    /* Preallocate a rough upper bound of the parameters the individual
+     * stats groups may produce so that they don't each grow the array in
+     * several small steps */
+    if (virTypedParamsReserve(&tmp->params, &tmp->nparams, &maxparams,
+                              32 +
+                              3 * virDomainDefGetVcpusMax(dom->def) +
+                              20 * dom->def->ndisks +
+                              8 * dom->def->nnets) < 0)
+        goto cleanup;
+
     for (i = 0; qemuDomainGetStatsWorkers[i].func; i++) {
         if (stats & qemuDomainGetStatsWorkers[i].stats) {
             if (qemuDomainGetStatsWorkers[i].func(conn->privateData, dom, tmp,
@@ -19692,6 +19917,201 @@ qemuDomainGetStats(virConnectPtr conn,
 }
 
 
+static int
+qemuConnectGetAllDomainStatsOne(virQEMUDriverPtr driver,
+                                virConnectPtr conn,
+                                virDomainObjPtr vm,
+                                unsigned int stats,
+                                unsigned int flags,
+                                unsigned int privflags,
+                                virDomainStatsRecordPtr *record)
+{
+    unsigned int domflags = 0;
+    int ret = -1;
+
+    virObjectLock(vm);
+
+    if (HAVE_JOB(privflags)) {
+        int rv;
+
+        if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT)
+            rv = qemuDomainObjBeginJobNowait(driver, vm, QEMU_JOB_QUERY);
+        else
+            rv = qemuDomainObjBeginJob(driver, vm, QEMU_JOB_QUERY);
+
+        if (rv == 0)
+            domflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
+    }
+    /* else: without a job it's still possible to gather some data */
+
+    if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING)
+        domflags |= QEMU_DOMAIN_STATS_BACKING;
+
+    if (qemuDomainGetStats(conn, vm, stats, record, domflags) < 0)
+        goto endjob;
+
+    ret = 0;
+
+ endjob:
+    if (HAVE_JOB(domflags))
+        qemuDomainObjEndJob(driver, vm);
+
+    virObjectUnlock(vm);
+    return ret;
+}
+
+
+/* Harvesting stats is dominated by waiting on per-domain jobs and
+ * monitor round trips; more workers only cost idle threads */
+#define QEMU_ALL_DOMAIN_STATS_WORKERS 16
+
+struct qemuConnectGetAllDomainStatsData {
+    virQEMUDriverPtr driver;
+    virConnectPtr conn;
+    unsigned int stats;
+    unsigned int flags;
+    unsigned int privflags;
+    virDomainObjPtr *vms;
+    virDomainStatsRecordPtr *records;   /* one slot per domain in @vms */
+    virMutex lock;
+    virCond cond;
+    size_t nDone;
+    virErrorPtr err;
+};
+
+struct qemuConnectGetAllDomainStatsJob {
+    struct qemuConnectGetAllDomainStatsData *data;
+    size_t idx;
+};
+
+
+static void
+qemuConnectGetAllDomainStatsWorkerFunc(void *jobdata,
+                                       void *opaque ATTRIBUTE_UNUSED)
+{
+    struct qemuConnectGetAllDomainStatsJob *job = jobdata;
+    struct qemuConnectGetAllDomainStatsData *data = job->data;
+    int rv;
+
+    rv = qemuConnectGetAllDomainStatsOne(data->driver, data->conn,
+                                         data->vms[job->idx],
+                                         data->stats, data->flags,
+                                         data->privflags,
+                                         &data->records[job->idx]);
+
+    virMutexLock(&data->lock);
+    if (rv < 0 && !data->err)
+        data->err = virSaveLastError();
+    data->nDone++;
+    virCondSignal(&data->cond);
+    virMutexUnlock(&data->lock);
+}
+
+
+static int
+qemuConnectGetAllDomainStatsParallel(virQEMUDriverPtr driver,
+                                     virConnectPtr conn,
+                                     virDomainObjPtr *vms,
+                                     size_t nvms,
+                                     unsigned int stats,
+                                     unsigned int flags,
+                                     unsigned int privflags,
+                                     virDomainStatsRecordPtr *records)
+{
+    struct qemuConnectGetAllDomainStatsData data;
+    struct qemuConnectGetAllDomainStatsJob *jobs = NULL;
+    void **jobList = NULL;
+    virThreadPoolPtr pool = NULL;
+    size_t nWorkers = QEMU_ALL_DOMAIN_STATS_WORKERS;
+    size_t nSent = 0;
+    size_t i;
+    int ret = -1;
+
+    memset(&data, 0, sizeof(data));
+    data.driver = driver;
+    data.conn = conn;
+    data.stats = stats;
+    data.flags = flags;
+    data.privflags = privflags;
+    data.vms = vms;
+    data.records = records;
+
+    if (nWorkers > nvms)
+        nWorkers = nvms;
+
+    if (virMutexInit(&data.lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to initialize mutex"));
+        return -1;
+    }
+
+    if (virCondInit(&data.cond) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to initialize condition variable"));
+        virMutexDestroy(&data.lock);
+        return -1;
+    }
+
+    if (VIR_ALLOC_N(jobs, nvms) < 0 ||
+        VIR_ALLOC_N(jobList, nvms) < 0)
+        goto cleanup;
+
+    if (!(pool = virThreadPoolNew(0, nWorkers, 0,
+                                  qemuConnectGetAllDomainStatsWorkerFunc,
+                                  &data)))
+        goto cleanup;
+
+    for (i = 0; i < nvms; i++) {
+        jobs[i].data = &data;
+        jobs[i].idx = i;
+        jobList[i] = &jobs[i];
+    }
+
+    nSent = virThreadPoolSendJobBatch(pool, 0, jobList, nvms);
+
+    /* freeing the pool discards jobs no worker has picked up yet, so
+     * wait until every queued job has actually finished */
+    virMutexLock(&data.lock);
+    while (data.nDone < nSent)
+        ignore_value(virCondWait(&data.cond, &data.lock));
+    virMutexUnlock(&data.lock);
+
+    if (nSent < nvms) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to queue domain stats job"));
+        goto cleanup;
+    }
+
+    if (data.err) {
+        virSetError(data.err);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virThreadPoolFree(pool);
+    if (ret < 0) {
+        /* keep @records free of NULL holes so that the caller can
+         * dispose of it as a NULL terminated list */
+        size_t n = 0;
+
+        for (i = 0; i < nvms; i++) {
+            if (records[i])
+                records[n++] = records[i];
+        }
+        for (i = n; i < nvms; i++)
+            records[i] = NULL;
+    }
+    virFreeError(data.err);
+    VIR_FREE(jobList);
+    VIR_FREE(jobs);
+    virCondDestroy(&data.cond);
+    virMutexDestroy(&data.lock);
+    return ret;
+}
+
+
 static int
 qemuConnectGetAllDomainStats(virConnectPtr conn,
                              virDomainPtr *doms,
@@ -19702,7 +20122,6 @@ qemuConnectGetAllDomainStats(virConnectPtr conn,
 {
     virQEMUDriverPtr driver = conn->privateData;
     virDomainObjPtr *vms = NULL;
-    virDomainObjPtr vm;
     size_t nvms;
     virDomainStatsRecordPtr *tmpstats = NULL;
     bool enforce = !!(flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS);
@@ -19710,7 +20129,6 @@ qemuConnectGetAllDomainStats(virConnectPtr conn,
     size_t i;
     int ret = -1;
     unsigned int privflags = 0;
-    unsigned int domflags = 0;
     unsigned int lflags = flags & (VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
                                    VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
                                    VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE);
@@ -19718,6 +20136,7 @@ qemuConnectGetAllDomainStats(virConnectPtr conn,
     virCheckFlags(VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
                   VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
                   VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT |
                   VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING |
                   VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS, -1);
 
@@ -19745,36 +20164,28 @@ qemuConnectGetAllDomainStats(virConnectPtr conn,
     if (qemuDomainGetStatsNeedMonitor(stats))
         privflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
 
-    for (i = 0; i < nvms; i++) {
-        virDomainStatsRecordPtr tmp = NULL;
-        domflags = 0;
-        vm = vms[i];
-
-        virObjectLock(vm);
-
-        if (HAVE_JOB(privflags) &&
-            qemuDomainObjBeginJob(driver, vm, QEMU_JOB_QUERY) == 0)
-            domflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
-        /* else: without a job it's still possible to gather some data */
-
-        if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING)
-            domflags |= QEMU_DOMAIN_STATS_BACKING;
-        if (qemuDomainGetStats(conn, vm, stats, &tmp, domflags) < 0) {
-            if (HAVE_JOB(domflags) && vm)
-                qemuDomainObjEndJob(driver, vm);
-
-            virObjectUnlock(vm);
+    if (nvms > 1) {
+        /* fan out across a worker pool so that one unresponsive QEMU
+         * only stalls its own worker instead of the whole enumeration */
+        if (qemuConnectGetAllDomainStatsParallel(driver, conn, vms, nvms,
+                                                 stats, flags, privflags,
+                                                 tmpstats) < 0)
             goto cleanup;
+    } else {
+        for (i = 0; i < nvms; i++) {
+            if (qemuConnectGetAllDomainStatsOne(driver, conn, vms[i], stats,
+                                                flags, privflags,
+                                                &tmpstats[i]) < 0)
+                goto cleanup;
         }
+    }
 
-        if (tmp)
-            tmpstats[nstats++] = tmp;
-
-        if (HAVE_JOB(domflags))
-            qemuDomainObjEndJob(driver, vm);
-
-        virObjectUnlock(vm);
+    for (i = 0; i < nvms; i++) {
+        if (tmpstats[i])
+            tmpstats[nstats++] = tmpstats[i];
     }
+    for (i = nstats; i < nvms; i++)
+        tmpstats[i] = NULL;
 
     *retStats = tmpstats;
     tmpstats = NULL;
@@ -19845,7 +20256,8 @@ qemuDomainGetFSInfo(virDomainPtr dom,
     if (!(caps = virQEMUDriverGetCapabilities(driver, false)))
         goto endjob;
 
-    if (!(def = virDomainDefCopy(vm->def, caps, driver->xmlopt, NULL, false)))
+    if (!(def = virDomainDefCopy(vm->def, caps, driver->xmlopt,
+                                 QEMU_DOMAIN_PRIVATE(vm)->qemuCaps, false)))
         goto endjob;
 
     agent = qemuDomainObjEnterAgent(vm);
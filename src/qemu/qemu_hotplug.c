@@ -934,6 +934,8 @@ qemuDomainAttachDeviceDiskLive(virConnectPtr conn,
  cleanup:
     if (ret != 0)
         ignore_value(qemuRemoveSharedDevice(driver, dev, vm->def->name));
+    else
+        virDomainObjDefGenerationBump(vm);
     return ret;
 }
 
@@ -1132,11 +1134,12 @@ qemuDomainAttachNetDevice(virQEMUDriverPtr driver,
         }
     }
 
-    for (i = 0; i < tapfdSize; i++) {
-        if (virSecurityManagerSetTapFDLabel(driver->securityManager,
-                                            vm->def, tapfd[i]) < 0)
-            goto cleanup;
-    }
+    /* all queue fds reference the same character device inode, so
+     * labelling the first one covers the whole set */
+    if (tapfdSize > 0 &&
+        virSecurityManagerSetTapFDLabel(driver->securityManager,
+                                        vm->def, tapfd[0]) < 0)
+        goto cleanup;
 
     if (qemuDomainMachineIsS390CCW(vm->def) &&
         virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_VIRTIO_CCW)) {
@@ -3624,6 +3627,10 @@ qemuDomainRemoveDiskDevice(virQEMUDriverPtr driver,
         }
     }
 
+    /* the disk is about to be freed, so any index into the definition
+     * built before this point must be discarded */
+    virDomainObjDefGenerationBump(vm);
+
     qemuDomainReleaseDeviceAddress(vm, &disk->info, src);
 
     if (qemuSecurityRestoreDiskLabel(driver, vm, disk) < 0)
@@ -2765,6 +2765,103 @@ qemuMigrationCompleted(virQEMUDriverPtr driver,
 }
 
 
+/* How often the xbzrle cache may be resized and the ceiling we will
+ * never grow it beyond no matter what QEMU reports.
+ */
+#define QEMU_MIGRATION_XBZRLE_TUNE_INTERVAL 5000 /* ms */
+#define QEMU_MIGRATION_XBZRLE_CACHE_MAX (1ULL << 30)
+
+typedef struct _qemuMigrationCacheState qemuMigrationCacheState;
+struct _qemuMigrationCacheState {
+    bool disabled;
+    unsigned long long nextTune; /* ms */
+    unsigned long long prevMiss;
+    unsigned long long prevPages;
+};
+
+/**
+ * qemuMigrationTuneXBZRLECache:
+ *
+ * Grow the xbzrle cache while migration is running if QEMU reports that
+ * the guest's working set does not fit in it.  A page missing the cache
+ * is sent in full and evicts another page, so a sustained miss rate
+ * above 50 % means the cache is too small to ever pay off and doubling
+ * it is the only knob QEMU offers at runtime.  Overflows (a delta
+ * larger than the page itself) indicate incompressible memory which a
+ * bigger cache cannot help with and are deliberately ignored.  Any
+ * failure to sample or resize the cache is not fatal to the migration.
+ */
+static void
+qemuMigrationTuneXBZRLECache(virQEMUDriverPtr driver,
+                             virDomainObjPtr vm,
+                             qemuDomainAsyncJob asyncJob,
+                             qemuMigrationCacheState *state)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    bool events = virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_MIGRATION_EVENT);
+    qemuDomainJobInfo info = { 0 };
+    qemuMonitorMigrationStats *stats;
+    unsigned long long now;
+    unsigned long long miss;
+    unsigned long long pages;
+    unsigned long long newSize;
+    int rc;
+
+    if (state->disabled || asyncJob != QEMU_ASYNC_JOB_MIGRATION_OUT)
+        return;
+
+    if (virTimeMillisNow(&now) < 0 || now < state->nextTune)
+        return;
+    state->nextTune = now + QEMU_MIGRATION_XBZRLE_TUNE_INTERVAL;
+
+    if (events) {
+        /* With migration events the main loop no longer polls
+         * query-migrate, so fetch a fresh sample ourselves */
+        if (qemuMigrationFetchJobStatus(driver, vm, asyncJob, &info) < 0) {
+            virResetLastError();
+            return;
+        }
+        stats = &info.stats;
+    } else {
+        stats = &priv->job.current->stats;
+    }
+
+    if (!stats->xbzrle_set) {
+        /* xbzrle is not in use for this migration */
+        state->disabled = true;
+        return;
+    }
+
+    miss = stats->xbzrle_cache_miss - state->prevMiss;
+    pages = stats->xbzrle_pages - state->prevPages;
+    state->prevMiss = stats->xbzrle_cache_miss;
+    state->prevPages = stats->xbzrle_pages;
+
+    /* Ignore quiet intervals; they carry no signal */
+    if (miss + pages < 1024 || miss <= pages)
+        return;
+
+    newSize = stats->xbzrle_cache_size * 2;
+    if (newSize > QEMU_MIGRATION_XBZRLE_CACHE_MAX ||
+        (stats->ram_total && newSize > stats->ram_total)) {
+        VIR_DEBUG("xbzrle cache reached its limit at %llu bytes",
+                  stats->xbzrle_cache_size);
+        state->disabled = true;
+        return;
+    }
+
+    VIR_DEBUG("xbzrle cache miss rate too high (%llu misses vs %llu "
+              "compressed pages), growing cache to %llu bytes",
+              miss, pages, newSize);
+
+    if (qemuDomainObjEnterMonitorAsync(driver, vm, asyncJob) < 0)
+        return;
+    rc = qemuMonitorSetMigrationCacheSize(priv->mon, newSize);
+    if (qemuDomainObjExitMonitor(driver, vm) < 0 || rc < 0)
+        virResetLastError();
+}
+
+
 /* Returns 0 on success, -2 when migration needs to be cancelled, or -1 when
  * QEMU reports failed migration.
  */
@@ -2778,6 +2875,7 @@ qemuMigrationWaitForCompletion(virQEMUDriverPtr driver,
     qemuDomainObjPrivatePtr priv = vm->privateData;
     qemuDomainJobInfoPtr jobInfo = priv->job.current;
     bool events = virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_MIGRATION_EVENT);
+    qemuMigrationCacheState cacheState = { 0 };
     int rv;
 
     flags |= QEMU_MIGRATION_COMPLETED_UPDATE_STATS;
@@ -2788,6 +2886,8 @@ qemuMigrationWaitForCompletion(virQEMUDriverPtr driver,
         if (rv < 0)
             return rv;
 
+        qemuMigrationTuneXBZRLECache(driver, vm, asyncJob, &cacheState);
+
         if (events) {
             if (virDomainObjWait(vm) < 0) {
                 jobInfo->type = VIR_DOMAIN_JOB_FAILED;
@@ -3534,6 +3634,7 @@ qemuMigrationParams(virTypedParameterPtr params,
 
     GET(AUTO_CONVERGE_INITIAL, cpuThrottleInitial);
     GET(AUTO_CONVERGE_INCREMENT, cpuThrottleIncrement);
+    GET(PARALLEL_CONNECTIONS, multifdChannels);
 
 #undef GET
 
@@ -3545,6 +3646,13 @@ qemuMigrationParams(virTypedParameterPtr params,
         goto error;
     }
 
+    if (migParams->multifdChannels_set &&
+        !(flags & VIR_MIGRATE_PARALLEL)) {
+        virReportError(VIR_ERR_INVALID_ARG, "%s",
+                       _("Turn parallel migration on to tune it"));
+        goto error;
+    }
+
     return migParams;
 
  error:
@@ -3596,6 +3704,7 @@ qemuMigrationPrepareAny(virQEMUDriverPtr driver,
                         const char **migrate_disks,
                         int nbdPort,
                         qemuMigrationCompressionPtr compression,
+                        qemuMonitorMigrationParamsPtr migParams,
                         unsigned long flags)
 {
     virDomainObjPtr vm = NULL;
@@ -3613,7 +3722,6 @@ qemuMigrationPrepareAny(virQEMUDriverPtr driver,
     bool stopProcess = false;
     bool relabel = false;
     int rv;
-    qemuMonitorMigrationParams migParams = { 0 };
 
     virNWFilterReadLockFilterUpdates();
 
@@ -3657,6 +3765,13 @@ qemuMigrationPrepareAny(virQEMUDriverPtr driver,
         goto cleanup;
     }
 
+    if (flags & VIR_MIGRATE_PARALLEL && flags & VIR_MIGRATE_TUNNELLED) {
+        virReportError(VIR_ERR_ARGUMENT_UNSUPPORTED, "%s",
+                       _("parallel migration is not supported with tunnelled "
+                         "migration"));
+        goto cleanup;
+    }
+
     if (!(caps = virQEMUDriverGetCapabilities(driver, false)))
         goto cleanup;
 
@@ -3803,7 +3918,7 @@ qemuMigrationPrepareAny(virQEMUDriverPtr driver,
     }
 
     if (qemuMigrationSetCompression(driver, vm, QEMU_ASYNC_JOB_MIGRATION_IN,
-                                    compression, &migParams) < 0)
+                                    compression, migParams) < 0)
         goto stopjob;
 
     if (STREQ_NULLABLE(protocol, "rdma") &&
@@ -3822,8 +3937,14 @@ qemuMigrationPrepareAny(virQEMUDriverPtr driver,
                                  QEMU_ASYNC_JOB_MIGRATION_IN) < 0)
         goto stopjob;
 
+    if (qemuMigrationSetOption(driver, vm,
+                               QEMU_MONITOR_MIGRATION_CAPS_MULTIFD,
+                               flags & VIR_MIGRATE_PARALLEL,
+                               QEMU_ASYNC_JOB_MIGRATION_IN) < 0)
+        goto stopjob;
+
     if (qemuMigrationSetParams(driver, vm, QEMU_ASYNC_JOB_MIGRATION_IN,
-                               &migParams) < 0)
+                               migParams) < 0)
         goto stopjob;
 
     if (mig->nbd &&
@@ -3947,6 +4068,7 @@ qemuMigrationPrepareTunnel(virQEMUDriverPtr driver,
                            unsigned long flags)
 {
     qemuMigrationCompressionPtr compression = NULL;
+    qemuMonitorMigrationParams migParams = { 0 };
     int ret;
 
     VIR_DEBUG("driver=%p, dconn=%p, cookiein=%s, cookieinlen=%d, "
@@ -3967,7 +4089,7 @@ qemuMigrationPrepareTunnel(virQEMUDriverPtr driver,
     ret = qemuMigrationPrepareAny(driver, dconn, cookiein, cookieinlen,
                                   cookieout, cookieoutlen, def, origname,
                                   st, NULL, 0, false, NULL, 0, NULL, 0,
-                                  compression, flags);
+                                  compression, &migParams, flags);
     VIR_FREE(compression);
     return ret;
 }
@@ -4012,6 +4134,7 @@ qemuMigrationPrepareDirect(virQEMUDriverPtr driver,
                            const char **migrate_disks,
                            int nbdPort,
                            qemuMigrationCompressionPtr compression,
+                           qemuMonitorMigrationParamsPtr migParams,
                            unsigned long flags)
 {
     unsigned short port = 0;
@@ -4135,7 +4258,7 @@ qemuMigrationPrepareDirect(virQEMUDriverPtr driver,
                                   NULL, uri ? uri->scheme : "tcp",
                                   port, autoPort, listenAddress,
                                   nmigrate_disks, migrate_disks, nbdPort,
-                                  compression, flags);
+                                  compression, migParams, flags);
  cleanup:
     virURIFree(uri);
     VIR_FREE(hostname);
@@ -4759,6 +4882,12 @@ qemuMigrationRun(virQEMUDriverPtr driver,
                                  QEMU_ASYNC_JOB_MIGRATION_OUT) < 0)
         goto cleanup;
 
+    if (qemuMigrationSetOption(driver, vm,
+                               QEMU_MONITOR_MIGRATION_CAPS_MULTIFD,
+                               flags & VIR_MIGRATE_PARALLEL,
+                               QEMU_ASYNC_JOB_MIGRATION_OUT) < 0)
+        goto cleanup;
+
     if (qemuMigrationSetParams(driver, vm, QEMU_ASYNC_JOB_MIGRATION_OUT,
                                migParams) < 0)
         goto cleanup;
@@ -6424,7 +6553,7 @@ qemuMigrationFinish(virQEMUDriverPtr driver,
 int
 qemuMigrationToFile(virQEMUDriverPtr driver, virDomainObjPtr vm,
                     int fd,
-                    const char *compressor,
+                    virCommandPtr compressor,
                     qemuDomainAsyncJob asyncJob)
 {
     qemuDomainObjPrivatePtr priv = vm->privateData;
@@ -6475,14 +6604,7 @@ qemuMigrationToFile(virQEMUDriverPtr driver, virDomainObjPtr vm,
                                     QEMU_MONITOR_MIGRATE_BACKGROUND,
                                     fd);
     } else {
-        const char *prog = compressor;
-        const char *args[] = {
-            prog,
-            "-c",
-            NULL
-        };
-
-        cmd = virCommandNewArgs(args);
+        cmd = compressor;
         virCommandSetInputFD(cmd, pipeFD[0]);
         virCommandSetOutputFD(cmd, &fd);
         virCommandSetErrorBuffer(cmd, &errbuf);
@@ -6545,9 +6667,9 @@ qemuMigrationToFile(virQEMUDriverPtr driver, virDomainObjPtr vm,
     VIR_FORCE_CLOSE(pipeFD[0]);
     VIR_FORCE_CLOSE(pipeFD[1]);
     if (cmd) {
+        /* The caller owns the compressor command */
         VIR_DEBUG("Compression binary stderr: %s", NULLSTR(errbuf));
         VIR_FREE(errbuf);
-        virCommandFree(cmd);
     }
 
     if (orig_err) {
@@ -43,6 +43,7 @@
 #include "virprobe.h"
 #include "virstring.h"
 #include "virtime.h"
+#include "virhashcode.h"
 
 #ifdef WITH_DTRACE_PROBES
 # include "libvirt_qemu_probes.h"
@@ -148,6 +149,162 @@ struct _qemuMonitor {
 static virClassPtr qemuMonitorClass;
 static void qemuMonitorDispose(void *obj);
 
+
+/* Monitor events are demultiplexed off the event loop thread onto a
+ * small set of dispatch threads, so that a handler stuck on a busy
+ * domain lock only delays domains sharing its queue instead of all FD
+ * handling. Entries for one monitor always hash onto the same queue,
+ * which keeps per-domain ordering intact. The threads live for the
+ * whole daemon lifetime and are never joined. */
+#define QEMU_MONITOR_DISPATCH_WORKERS 4
+
+typedef enum {
+    QEMU_MONITOR_DISPATCH_EVENT,
+    QEMU_MONITOR_DISPATCH_EOF,
+    QEMU_MONITOR_DISPATCH_ERROR,
+} qemuMonitorDispatchEntryType;
+
+typedef struct _qemuMonitorDispatchEntry qemuMonitorDispatchEntry;
+struct _qemuMonitorDispatchEntry {
+    qemuMonitorDispatchEntryType type;
+    qemuMonitorPtr mon;         /* owns a reference */
+    virJSONValuePtr obj;        /* parsed QMP event, EVENT entries only */
+    qemuMonitorDispatchEntry *next;
+};
+
+typedef struct _qemuMonitorDispatchQueue qemuMonitorDispatchQueue;
+struct _qemuMonitorDispatchQueue {
+    virMutex lock;
+    virCond cond;
+    qemuMonitorDispatchEntry *head;
+    qemuMonitorDispatchEntry *tail;
+    virThread thread;
+};
+
+static qemuMonitorDispatchQueue qemuMonitorDispatchQueues[QEMU_MONITOR_DISPATCH_WORKERS];
+static bool qemuMonitorDispatchReady;
+
+
+static void
+qemuMonitorDispatchWorker(void *opaque)
+{
+    qemuMonitorDispatchQueue *queue = opaque;
+
+    for (;;) {
+        qemuMonitorDispatchEntry *entry;
+        qemuMonitorPtr mon;
+
+        virMutexLock(&queue->lock);
+        while (!queue->head)
+            ignore_value(virCondWait(&queue->cond, &queue->lock));
+        entry = queue->head;
+        if (!(queue->head = entry->next))
+            queue->tail = NULL;
+        virMutexUnlock(&queue->lock);
+
+        mon = entry->mon;
+        switch (entry->type) {
+        case QEMU_MONITOR_DISPATCH_EVENT:
+            virObjectLock(mon);
+            if (qemuMonitorJSONIOProcessEvent(mon, entry->obj) < 0)
+                VIR_WARN("failed to process event from monitor %p", mon);
+            virObjectUnlock(mon);
+            break;
+
+        case QEMU_MONITOR_DISPATCH_EOF:
+            VIR_DEBUG("Triggering EOF callback");
+            (mon->cb->eofNotify)(mon, mon->vm, mon->callbackOpaque);
+            break;
+
+        case QEMU_MONITOR_DISPATCH_ERROR:
+            VIR_DEBUG("Triggering error callback");
+            (mon->cb->errorNotify)(mon, mon->vm, mon->callbackOpaque);
+            break;
+        }
+
+        virJSONValueFree(entry->obj);
+        virObjectUnref(mon);
+        VIR_FREE(entry);
+    }
+}
+
+
+static void
+qemuMonitorDispatchInit(void)
+{
+    size_t i;
+
+    for (i = 0; i < QEMU_MONITOR_DISPATCH_WORKERS; i++) {
+        qemuMonitorDispatchQueue *queue = &qemuMonitorDispatchQueues[i];
+
+        if (virMutexInit(&queue->lock) < 0 ||
+            virCondInit(&queue->cond) < 0 ||
+            virThreadCreate(&queue->thread, false,
+                            qemuMonitorDispatchWorker, queue) < 0) {
+            /* not fatal, events are then processed on the event loop
+             * thread as before */
+            VIR_WARN("unable to start monitor event dispatch threads");
+            return;
+        }
+    }
+
+    qemuMonitorDispatchReady = true;
+}
+
+
+static int
+qemuMonitorDispatchQueuePush(qemuMonitorPtr mon,
+                             qemuMonitorDispatchEntryType type,
+                             virJSONValuePtr obj)
+{
+    qemuMonitorDispatchEntry *entry;
+    qemuMonitorDispatchQueue *queue;
+    uint32_t hash;
+
+    if (!qemuMonitorDispatchReady)
+        return -1;
+
+    if (VIR_ALLOC_QUIET(entry) < 0)
+        return -1;
+
+    hash = virHashCodeGen(&mon, sizeof(mon), 0);
+    queue = &qemuMonitorDispatchQueues[hash % QEMU_MONITOR_DISPATCH_WORKERS];
+
+    entry->type = type;
+    entry->mon = virObjectRef(mon);
+    entry->obj = obj;
+
+    virMutexLock(&queue->lock);
+    if (queue->tail)
+        queue->tail->next = entry;
+    else
+        queue->head = entry;
+    queue->tail = entry;
+    virCondSignal(&queue->cond);
+    virMutexUnlock(&queue->lock);
+    return 0;
+}
+
+
+/**
+ * qemuMonitorQueueEvent:
+ * @mon: monitor object
+ * @obj: parsed QMP event
+ *
+ * Hand @obj over to the monitor event dispatch threads for
+ * processing. On success ownership of @obj is transferred.
+ *
+ * Returns 0 on success, -1 if the event could not be queued; the
+ * caller should then process it in place.
+ */
+int
+qemuMonitorQueueEvent(qemuMonitorPtr mon,
+                      virJSONValuePtr obj)
+{
+    return qemuMonitorDispatchQueuePush(mon, QEMU_MONITOR_DISPATCH_EVENT, obj);
+}
+
+
 static int qemuMonitorOnceInit(void)
 {
     if (!(qemuMonitorClass = virClassNew(virClassForObjectLockable(),
@@ -156,6 +313,8 @@ static int qemuMonitorOnceInit(void)
                                          qemuMonitorDispose)))
         return -1;
 
+    qemuMonitorDispatchInit();
+
     return 0;
 }
 
@@ -172,7 +331,7 @@ VIR_ENUM_IMPL(qemuMonitorMigrationStatus,
 VIR_ENUM_IMPL(qemuMonitorMigrationCaps,
               QEMU_MONITOR_MIGRATION_CAPS_LAST,
               "xbzrle", "auto-converge", "rdma-pin-all", "events",
-              "postcopy-ram", "compress")
+              "postcopy-ram", "compress", "x-multifd")
 
 VIR_ENUM_IMPL(qemuMonitorVMStatus,
               QEMU_MONITOR_VM_STATUS_LAST,
@@ -409,8 +568,12 @@ qemuMonitorIOProcess(qemuMonitorPtr mon)
     qemuMonitorMessagePtr msg = NULL;
 
     /* See if there's a message & whether its ready for its reply
-     * ie whether its completed writing all its data */
-    if (mon->msg && mon->msg->txOffset == mon->msg->txLength)
+     * ie whether its completed writing all its data. For a pipelined
+     * command batch qemu may reply to the leading commands while the
+     * tail of the batch is still queued for write, so the message
+     * must be visible as soon as sending starts */
+    if (mon->msg && (mon->msg->txOffset == mon->msg->txLength ||
+                     mon->msg->nrxExpected))
         msg = mon->msg;
 
 #if DEBUG_IO
@@ -761,8 +924,14 @@ qemuMonitorIO(int watch, int fd, int events, void *opaque)
         /* Make sure anyone waiting wakes up now */
         virCondSignal(&mon->notify);
         virObjectUnlock(mon);
-        VIR_DEBUG("Triggering EOF callback");
-        (eofNotify)(mon, vm, mon->callbackOpaque);
+        /* Queue behind any pending events of this monitor so that the
+         * EOF is seen last; fall back to direct invocation if the
+         * dispatch threads are not available */
+        if (qemuMonitorDispatchQueuePush(mon, QEMU_MONITOR_DISPATCH_EOF,
+                                         NULL) < 0) {
+            VIR_DEBUG("Triggering EOF callback");
+            (eofNotify)(mon, vm, mon->callbackOpaque);
+        }
         virObjectUnref(mon);
     } else if (error) {
         qemuMonitorErrorNotifyCallback errorNotify = mon->cb->errorNotify;
@@ -771,8 +940,11 @@ qemuMonitorIO(int watch, int fd, int events, void *opaque)
         /* Make sure anyone waiting wakes up now */
         virCondSignal(&mon->notify);
         virObjectUnlock(mon);
-        VIR_DEBUG("Triggering error callback");
-        (errorNotify)(mon, vm, mon->callbackOpaque);
+        if (qemuMonitorDispatchQueuePush(mon, QEMU_MONITOR_DISPATCH_ERROR,
+                                         NULL) < 0) {
+            VIR_DEBUG("Triggering error callback");
+            (errorNotify)(mon, vm, mon->callbackOpaque);
+        }
         virObjectUnref(mon);
     } else {
         virObjectUnlock(mon);
@@ -1029,6 +1201,10 @@ qemuMonitorSend(qemuMonitorPtr mon,
     mon->msg = NULL;
     qemuMonitorUpdateWatch(mon);
 
+    PROBE(QEMU_MONITOR_SEND_DONE,
+          "mon=%p msg=%s ret=%d",
+          mon, msg->txBuffer, ret);
+
     return ret;
 }
 
@@ -1916,14 +2092,15 @@ qemuMonitorGetCPUInfo(qemuMonitorPtr mon,
     /* initialize a few non-zero defaults */
     qemuMonitorCPUInfoClear(info, maxvcpus);
 
-    if (hotplug &&
-        (qemuMonitorJSONGetHotpluggableCPUs(mon, &hotplugcpus, &nhotplugcpus)) < 0)
-        goto cleanup;
-
-    if (mon->json)
+    if (hotplug) {
+        /* pipeline both queries in a single monitor roundtrip */
+        rc = qemuMonitorJSONQueryCPUsBatch(mon, &hotplugcpus, &nhotplugcpus,
+                                           &cpuentries, &ncpuentries);
+    } else if (mon->json) {
         rc = qemuMonitorJSONQueryCPUs(mon, &cpuentries, &ncpuentries);
-    else
+    } else {
         rc = qemuMonitorTextQueryCPUs(mon, &cpuentries, &ncpuentries);
+    }
 
     if (rc < 0) {
         if (rc == -2) {
@@ -2504,12 +2681,13 @@ qemuMonitorSetMigrationParams(qemuMonitorPtr mon,
 {
     VIR_DEBUG("compressLevel=%d:%d compressThreads=%d:%d "
               "decompressThreads=%d:%d cpuThrottleInitial=%d:%d "
-              "cpuThrottleIncrement=%d:%d",
+              "cpuThrottleIncrement=%d:%d multifdChannels=%d:%d",
               params->compressLevel_set, params->compressLevel,
               params->compressThreads_set, params->compressThreads,
               params->decompressThreads_set, params->decompressThreads,
               params->cpuThrottleInitial_set, params->cpuThrottleInitial,
-              params->cpuThrottleIncrement_set, params->cpuThrottleIncrement);
+              params->cpuThrottleIncrement_set, params->cpuThrottleIncrement,
+              params->multifdChannels_set, params->multifdChannels);
 
     QEMU_CHECK_MONITOR_JSON(mon);
 
@@ -2517,7 +2695,8 @@ qemuMonitorSetMigrationParams(qemuMonitorPtr mon,
         !params->compressThreads_set &&
         !params->decompressThreads_set &&
         !params->cpuThrottleInitial_set &&
-        !params->cpuThrottleIncrement_set)
+        !params->cpuThrottleIncrement_set &&
+        !params->multifdChannels_set)
         return 0;
 
     return qemuMonitorJSONSetMigrationParams(mon, params);
@@ -61,6 +61,14 @@ struct _qemuMonitorMessage {
     /* Used by the JSON monitor to hold reply / error */
     void *rxObject;
 
+    /* Used by the JSON monitor when several commands are pipelined
+     * into txBuffer in one batch; replies are correlated to the
+     * expected command IDs via the 'id' field qemu echoes back */
+    char **rxIDs;
+    void **rxObjects;
+    size_t nrxExpected;
+    size_t nrxReceived;
+
     /* True if rxBuffer / rxObject are ready, or a
      * fatal error occurred on the monitor channel
      */
@@ -299,6 +307,8 @@ int qemuMonitorGetDiskSecret(qemuMonitorPtr mon,
                              char **secret,
                              size_t *secretLen);
 
+int qemuMonitorQueueEvent(qemuMonitorPtr mon, virJSONValuePtr obj);
+
 int qemuMonitorEmitEvent(qemuMonitorPtr mon, const char *event,
                          long long seconds, unsigned int micros,
                          const char *details);
@@ -570,6 +580,9 @@ struct _qemuMonitorMigrationParams {
 
     bool cpuThrottleIncrement_set;
     int cpuThrottleIncrement;
+
+    bool multifdChannels_set;
+    int multifdChannels;
 };
 
 int qemuMonitorGetMigrationParams(qemuMonitorPtr mon,
@@ -618,6 +631,7 @@ struct _qemuMonitorMigrationStats {
     unsigned long long ram_normal_bytes;
     unsigned long long ram_dirty_rate;
     unsigned long long ram_iteration;
+    unsigned long long ram_postcopy_reqs;
 
     unsigned long long disk_transferred;
     unsigned long long disk_remaining;
@@ -644,6 +658,7 @@ typedef enum {
     QEMU_MONITOR_MIGRATION_CAPS_EVENTS,
     QEMU_MONITOR_MIGRATION_CAPS_POSTCOPY,
     QEMU_MONITOR_MIGRATION_CAPS_COMPRESS,
+    QEMU_MONITOR_MIGRATION_CAPS_MULTIFD,
 
     QEMU_MONITOR_MIGRATION_CAPS_LAST
 } qemuMonitorMigrationCaps;
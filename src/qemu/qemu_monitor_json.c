@@ -37,6 +37,7 @@
 #include "qemu_parse_command.h"
 #include "qemu_capabilities.h"
 #include "viralloc.h"
+#include "virbuffer.h"
 #include "virlog.h"
 #include "driver.h"
 #include "datatypes.h"
@@ -137,7 +138,7 @@ qemuMonitorEventCompare(const void *key, const void *elt)
     return strcmp(type, handler->type);
 }
 
-static int
+int
 qemuMonitorJSONIOProcessEvent(qemuMonitorPtr mon,
                               virJSONValuePtr obj)
 {
@@ -180,6 +181,36 @@ qemuMonitorJSONIOProcessEvent(qemuMonitorPtr mon,
     return 0;
 }
 
+/* Correlate a reply belonging to a pipelined command batch with the
+ * command that caused it, using the 'id' string qemu echoes back.
+ * The message is finished once every queued command got its reply.
+ *
+ * Returns 0 if the reply was consumed (@obj is owned by @msg then),
+ * -1 if it doesn't belong to any outstanding batched command.
+ */
+static int
+qemuMonitorJSONIOProcessBatchReply(qemuMonitorMessagePtr msg,
+                                   virJSONValuePtr obj,
+                                   const char *line)
+{
+    const char *id = virJSONValueObjectGetString(obj, "id");
+    size_t i;
+
+    for (i = 0; id && i < msg->nrxExpected; i++) {
+        if (!msg->rxObjects[i] && STREQ(msg->rxIDs[i], id)) {
+            msg->rxObjects[i] = obj;
+            if (++msg->nrxReceived == msg->nrxExpected)
+                msg->finished = 1;
+            return 0;
+        }
+    }
+
+    virReportError(VIR_ERR_INTERNAL_ERROR,
+                   _("Unexpected JSON reply '%s' to command batch"), line);
+    return -1;
+}
+
+
 int
 qemuMonitorJSONIOProcessLine(qemuMonitorPtr mon,
                              const char *line,
@@ -204,12 +235,24 @@ qemuMonitorJSONIOProcessLine(qemuMonitorPtr mon,
     } else if (virJSONValueObjectHasKey(obj, "event") == 1) {
         PROBE(QEMU_MONITOR_RECV_EVENT,
               "mon=%p event=%s", mon, line);
-        ret = qemuMonitorJSONIOProcessEvent(mon, obj);
+        /* prefer handling the event on a dispatch thread to keep the
+         * event loop responsive */
+        if (qemuMonitorQueueEvent(mon, obj) == 0) {
+            obj = NULL;
+            ret = 0;
+        } else {
+            ret = qemuMonitorJSONIOProcessEvent(mon, obj);
+        }
     } else if (virJSONValueObjectHasKey(obj, "error") == 1 ||
                virJSONValueObjectHasKey(obj, "return") == 1) {
         PROBE(QEMU_MONITOR_RECV_REPLY,
               "mon=%p reply=%s", mon, line);
-        if (msg) {
+        if (msg && msg->nrxExpected) {
+            if (qemuMonitorJSONIOProcessBatchReply(msg, obj, line) == 0) {
+                obj = NULL;
+                ret = 0;
+            }
+        } else if (msg) {
             msg->rxObject = obj;
             msg->finished = 1;
             obj = NULL;
@@ -328,6 +371,98 @@ qemuMonitorJSONCommand(qemuMonitorPtr mon,
     return qemuMonitorJSONCommandWithFd(mon, cmd, -1, reply);
 }
 
+
+/**
+ * qemuMonitorJSONCommandBatch:
+ * @mon: monitor object
+ * @cmds: array of @ncmds commands to execute
+ * @replies: filled with the reply for each command on success
+ * @ncmds: number of commands in @cmds
+ *
+ * Pipelines several commands into a single monitor write and waits for
+ * all replies at once, rather than paying a separate roundtrip per
+ * command. qemu processes the commands serially; replies are matched
+ * to commands via the 'id' attribute so ordering does not matter.
+ *
+ * Individual commands may still have failed; callers need to run
+ * qemuMonitorJSONCheckError on each reply.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+static int
+qemuMonitorJSONCommandBatch(qemuMonitorPtr mon,
+                            virJSONValuePtr *cmds,
+                            virJSONValuePtr *replies,
+                            size_t ncmds)
+{
+    int ret = -1;
+    qemuMonitorMessage msg;
+    virBuffer buf = VIR_BUFFER_INITIALIZER;
+    char *cmdstr = NULL;
+    size_t i;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.txFD = -1;
+
+    if (VIR_ALLOC_N(msg.rxIDs, ncmds) < 0 ||
+        VIR_ALLOC_N(msg.rxObjects, ncmds) < 0)
+        goto cleanup;
+    msg.nrxExpected = ncmds;
+
+    for (i = 0; i < ncmds; i++) {
+        if (!(msg.rxIDs[i] = qemuMonitorNextCommandID(mon)))
+            goto cleanup;
+        if (virJSONValueObjectAppendString(cmds[i], "id", msg.rxIDs[i]) < 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Unable to append command 'id' string"));
+            goto cleanup;
+        }
+
+        if (!(cmdstr = virJSONValueToString(cmds[i], false)))
+            goto cleanup;
+        virBufferAsprintf(&buf, "%s\r\n", cmdstr);
+        VIR_FREE(cmdstr);
+    }
+
+    if (virBufferCheckError(&buf) < 0)
+        goto cleanup;
+
+    msg.txLength = virBufferUse(&buf);
+    msg.txBuffer = virBufferContentAndReset(&buf);
+
+    VIR_DEBUG("Send batch of %zu commands '%s'", ncmds, msg.txBuffer);
+
+    if (qemuMonitorSend(mon, &msg) < 0)
+        goto cleanup;
+
+    for (i = 0; i < ncmds; i++) {
+        if (!msg.rxObjects[i]) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Missing monitor reply object"));
+            goto cleanup;
+        }
+    }
+
+    for (i = 0; i < ncmds; i++)
+        VIR_STEAL_PTR(replies[i], msg.rxObjects[i]);
+
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < ncmds; i++) {
+        if (msg.rxIDs)
+            VIR_FREE(msg.rxIDs[i]);
+        if (msg.rxObjects)
+            virJSONValueFree(msg.rxObjects[i]);
+    }
+    VIR_FREE(msg.rxIDs);
+    VIR_FREE(msg.rxObjects);
+    VIR_FREE(cmdstr);
+    VIR_FREE(msg.txBuffer);
+    virBufferFreeAndReset(&buf);
+    return ret;
+}
+
 /* Ignoring OOM in this method, since we're already reporting
  * a more important error
  *
@@ -2588,6 +2723,7 @@ qemuMonitorJSONGetMigrationParams(qemuMonitorPtr mon,
     PARSE(decompressThreads, "decompress-threads");
     PARSE(cpuThrottleInitial, "cpu-throttle-initial");
     PARSE(cpuThrottleIncrement, "cpu-throttle-increment");
+    PARSE(multifdChannels, "x-multifd-channels");
 
 #undef PARSE
 
@@ -2630,6 +2766,7 @@ qemuMonitorJSONSetMigrationParams(qemuMonitorPtr mon,
     APPEND(decompressThreads, "decompress-threads");
     APPEND(cpuThrottleInitial, "cpu-throttle-initial");
     APPEND(cpuThrottleIncrement, "cpu-throttle-increment");
+    APPEND(multifdChannels, "x-multifd-channels");
 
 #undef APPEND
 
@@ -2756,6 +2893,8 @@ qemuMonitorJSONGetMigrationStatsReply(virJSONValuePtr reply,
                                                       &stats->ram_dirty_rate));
         ignore_value(virJSONValueObjectGetNumberUlong(ram, "dirty-sync-count",
                                                       &stats->ram_iteration));
+        ignore_value(virJSONValueObjectGetNumberUlong(ram, "postcopy-requests",
+                                                      &stats->ram_postcopy_reqs));
 
         disk = virJSONValueObjectGetObject(ret, "disk");
         if (disk) {
@@ -7168,29 +7307,18 @@ qemuMonitorQueryHotpluggableCpusEntrySort(const void *p1,
 }
 
 
-int
-qemuMonitorJSONGetHotpluggableCPUs(qemuMonitorPtr mon,
-                                   struct qemuMonitorQueryHotpluggableCpusEntry **entries,
-                                   size_t *nentries)
+static int
+qemuMonitorJSONExtractHotpluggableCPUs(virJSONValuePtr reply,
+                                       struct qemuMonitorQueryHotpluggableCpusEntry **entries,
+                                       size_t *nentries)
 {
     struct qemuMonitorQueryHotpluggableCpusEntry *info = NULL;
     ssize_t ninfo = 0;
     int ret = -1;
     size_t i;
     virJSONValuePtr data;
-    virJSONValuePtr cmd;
-    virJSONValuePtr reply = NULL;
     virJSONValuePtr vcpu;
 
-    if (!(cmd = qemuMonitorJSONMakeCommand("query-hotpluggable-cpus", NULL)))
-        return -1;
-
-    if (qemuMonitorJSONCommand(mon, cmd, &reply) < 0)
-        goto cleanup;
-
-    if (qemuMonitorJSONCheckError(cmd, reply) < 0)
-        goto cleanup;
-
     data = virJSONValueObjectGet(reply, "return");
 
     if ((ninfo = virJSONValueArraySize(data)) < 0) {
@@ -7217,12 +7345,94 @@ qemuMonitorJSONGetHotpluggableCPUs(qemuMonitorPtr mon,
 
  cleanup:
     qemuMonitorQueryHotpluggableCpusFree(info, ninfo);
+    return ret;
+}
+
+
+int
+qemuMonitorJSONGetHotpluggableCPUs(qemuMonitorPtr mon,
+                                   struct qemuMonitorQueryHotpluggableCpusEntry **entries,
+                                   size_t *nentries)
+{
+    int ret = -1;
+    virJSONValuePtr cmd;
+    virJSONValuePtr reply = NULL;
+
+    if (!(cmd = qemuMonitorJSONMakeCommand("query-hotpluggable-cpus", NULL)))
+        return -1;
+
+    if (qemuMonitorJSONCommand(mon, cmd, &reply) < 0)
+        goto cleanup;
+
+    if (qemuMonitorJSONCheckError(cmd, reply) < 0)
+        goto cleanup;
+
+    ret = qemuMonitorJSONExtractHotpluggableCPUs(reply, entries, nentries);
+
+ cleanup:
     virJSONValueFree(cmd);
     virJSONValueFree(reply);
     return ret;
 }
 
 
+/**
+ * qemuMonitorJSONQueryCPUsBatch:
+ * @mon: monitor object
+ * @hotplugentries: filled with query-hotpluggable-cpus data on success
+ * @nhotplugentries: number of hotpluggable cpu entries returned
+ * @entries: filled with query-cpus data on success
+ * @nentries: number of cpu entries returned
+ *
+ * Runs 'query-hotpluggable-cpus' and 'query-cpus' pipelined in a
+ * single monitor roundtrip.
+ *
+ * Returns 0 on success, -1 on a fatal error and -2 if the cpu query
+ * failed gracefully (as with qemuMonitorJSONQueryCPUs the hotplug
+ * data is discarded by the caller in that case).
+ */
+int
+qemuMonitorJSONQueryCPUsBatch(qemuMonitorPtr mon,
+                              struct qemuMonitorQueryHotpluggableCpusEntry **hotplugentries,
+                              size_t *nhotplugentries,
+                              struct qemuMonitorQueryCpusEntry **entries,
+                              size_t *nentries)
+{
+    virJSONValuePtr cmds[2] = { NULL, NULL };
+    virJSONValuePtr replies[2] = { NULL, NULL };
+    virJSONValuePtr data;
+    int ret = -1;
+
+    if (!(cmds[0] = qemuMonitorJSONMakeCommand("query-hotpluggable-cpus", NULL)) ||
+        !(cmds[1] = qemuMonitorJSONMakeCommand("query-cpus", NULL)))
+        goto cleanup;
+
+    if (qemuMonitorJSONCommandBatch(mon, cmds, replies, 2) < 0)
+        goto cleanup;
+
+    if (qemuMonitorJSONCheckError(cmds[0], replies[0]) < 0)
+        goto cleanup;
+
+    if (qemuMonitorJSONExtractHotpluggableCPUs(replies[0], hotplugentries,
+                                               nhotplugentries) < 0)
+        goto cleanup;
+
+    if (!(data = virJSONValueObjectGetArray(replies[1], "return"))) {
+        ret = -2;
+        goto cleanup;
+    }
+
+    ret = qemuMonitorJSONExtractCPUInfo(data, entries, nentries);
+
+ cleanup:
+    virJSONValueFree(cmds[0]);
+    virJSONValueFree(cmds[1]);
+    virJSONValueFree(replies[0]);
+    virJSONValueFree(replies[1]);
+    return ret;
+}
+
+
 static int
 qemuMonitorJSONFillQMPSchema(size_t pos ATTRIBUTE_UNUSED,
                              virJSONValuePtr item,
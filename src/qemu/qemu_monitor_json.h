@@ -36,6 +36,9 @@ int qemuMonitorJSONIOProcessLine(qemuMonitorPtr mon,
                                  const char *line,
                                  qemuMonitorMessagePtr msg);
 
+int qemuMonitorJSONIOProcessEvent(qemuMonitorPtr mon,
+                                  virJSONValuePtr obj);
+
 int qemuMonitorJSONIOProcess(qemuMonitorPtr mon,
                              const char *data,
                              size_t len,
@@ -61,6 +64,11 @@ int qemuMonitorJSONSystemReset(qemuMonitorPtr mon);
 int qemuMonitorJSONQueryCPUs(qemuMonitorPtr mon,
                              struct qemuMonitorQueryCpusEntry **entries,
                              size_t *nentries);
+int qemuMonitorJSONQueryCPUsBatch(qemuMonitorPtr mon,
+                                  struct qemuMonitorQueryHotpluggableCpusEntry **hotplugentries,
+                                  size_t *nhotplugentries,
+                                  struct qemuMonitorQueryCpusEntry **entries,
+                                  size_t *nentries);
 int qemuMonitorJSONGetVirtType(qemuMonitorPtr mon,
                                virDomainVirtType *virtType);
 int qemuMonitorJSONUpdateVideoMemorySize(qemuMonitorPtr mon,
@@ -46,6 +46,7 @@
 #include "qemu_migration.h"
 #include "qemu_interface.h"
 #include "qemu_security.h"
+#include "qemu_blockjob.h"
 
 #include "cpu/cpu.h"
 #include "datatypes.h"
@@ -69,6 +70,7 @@
 #include "virbitmap.h"
 #include "viratomic.h"
 #include "virnuma.h"
+#include "virhostmem.h"
 #include "virstring.h"
 #include "virhostdev.h"
 #include "secret_util.h"
@@ -351,16 +353,52 @@ virDomainDiskDefPtr
 qemuProcessFindDomainDiskByAlias(virDomainObjPtr vm,
                                  const char *alias)
 {
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    virDomainDiskDefPtr disk;
     size_t i;
 
     alias = qemuAliasDiskDriveSkipPrefix(alias);
 
-    for (i = 0; i < vm->def->ndisks; i++) {
-        virDomainDiskDefPtr disk;
+    /* Events are looked up by alias one at a time, so keep a hash of
+     * the aliases around instead of rescanning the disk array for
+     * every event. The index holds bare pointers into the definition,
+     * so it must be thrown away whenever the definition may have
+     * changed; the generation counter tracks exactly that */
+    if (priv->diskAliasIndex &&
+        (priv->diskAliasIndexDef != vm->def ||
+         priv->diskAliasIndexGeneration != vm->defGeneration)) {
+        virHashFree(priv->diskAliasIndex);
+        priv->diskAliasIndex = NULL;
+    }
+
+    if (!priv->diskAliasIndex &&
+        (priv->diskAliasIndex = virHashCreate(vm->def->ndisks + 1, NULL))) {
+        for (i = 0; i < vm->def->ndisks; i++) {
+            disk = vm->def->disks[i];
+            if (disk->info.alias &&
+                virHashUpdateEntry(priv->diskAliasIndex,
+                                   disk->info.alias, disk) < 0) {
+                virHashFree(priv->diskAliasIndex);
+                priv->diskAliasIndex = NULL;
+                break;
+            }
+        }
+        if (priv->diskAliasIndex) {
+            priv->diskAliasIndexDef = vm->def;
+            priv->diskAliasIndexGeneration = vm->defGeneration;
+        }
+    }
 
-        disk = vm->def->disks[i];
-        if (disk->info.alias != NULL && STREQ(disk->info.alias, alias))
+    if (priv->diskAliasIndex) {
+        if ((disk = virHashLookup(priv->diskAliasIndex, alias)))
             return disk;
+    } else {
+        /* Building the index failed; fall back to scanning */
+        for (i = 0; i < vm->def->ndisks; i++) {
+            disk = vm->def->disks[i];
+            if (disk->info.alias != NULL && STREQ(disk->info.alias, alias))
+                return disk;
+        }
     }
 
     virReportError(VIR_ERR_INTERNAL_ERROR,
@@ -1125,6 +1163,7 @@ qemuProcessHandleTrayChange(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
             disk->tray_status = VIR_DOMAIN_DISK_TRAY_OPEN;
         else if (reason == VIR_DOMAIN_EVENT_TRAY_CHANGE_CLOSE)
             disk->tray_status = VIR_DOMAIN_DISK_TRAY_CLOSED;
+        virDomainObjDefGenerationBump(vm);
 
         if (virDomainSaveStatus(driver->xmlopt, cfg->stateDir, vm, driver->caps) < 0) {
             VIR_WARN("Unable to save status on vm %s after tray moved event",
@@ -1229,7 +1268,6 @@ qemuProcessHandleBalloonChange(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
 {
     virQEMUDriverPtr driver = opaque;
     virObjectEventPtr event = NULL;
-    virQEMUDriverConfigPtr cfg = virQEMUDriverGetConfig(driver);
 
     virObjectLock(vm);
     event = virDomainEventBalloonChangeNewFromObj(vm, actual);
@@ -1237,14 +1275,16 @@ qemuProcessHandleBalloonChange(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
     VIR_DEBUG("Updating balloon from %lld to %lld kb",
               vm->def->mem.cur_balloon, actual);
     vm->def->mem.cur_balloon = actual;
+    virDomainObjDefGenerationBump(vm);
 
-    if (virDomainSaveStatus(driver->xmlopt, cfg->stateDir, vm, driver->caps) < 0)
-        VIR_WARN("unable to save domain status with balloon change");
+    /* No need to rewrite the status XML here: the balloon size is
+     * re-read from QEMU via qemuProcessRefreshBalloonState() on
+     * reconnect, so persisting it per event would only turn rapid
+     * ballooning into a disk write per BALLOON_CHANGE */
 
     virObjectUnlock(vm);
 
     qemuDomainEventQueue(driver, event);
-    virObjectUnref(cfg);
     return 0;
 }
 
@@ -3284,10 +3324,172 @@ qemuProcessBuildDestroyHugepagesPath(virQEMUDriverPtr driver,
 }
 
 
+/**
+ * qemuProcessHugePagesCompute:
+ * @def: domain definition
+ * @sizes: filled with the distinct huge page sizes the domain uses (in KiB)
+ * @npages: filled with the page count needed from each pool in @sizes
+ * @nsizes: number of entries in @sizes and @npages
+ *
+ * Compute how many pages the domain will take from each huge page
+ * pool, mirroring the per-guest-node page size selection done when
+ * building the memory backends.
+ *
+ * Returns 0 on success, -1 on error (with the error reported).
+ */
+static int
+qemuProcessHugePagesCompute(virDomainDefPtr def,
+                            unsigned long long **sizes,
+                            unsigned long long **npages,
+                            size_t *nsizes)
+{
+    size_t ngnodes = virDomainNumaGetNodeCount(def->numa);
+    size_t gnode;
+    size_t i;
+
+    *sizes = NULL;
+    *npages = NULL;
+    *nsizes = 0;
+
+    if (!def->mem.nhugepages)
+        return 0;
+
+    if (VIR_ALLOC_N(*sizes, def->mem.nhugepages) < 0 ||
+        VIR_ALLOC_N(*npages, def->mem.nhugepages) < 0)
+        goto error;
+
+    if (ngnodes == 0) {
+        (*sizes)[0] = def->mem.hugepages[0].size;
+        (*npages)[0] = VIR_DIV_UP(virDomainDefGetMemoryTotal(def),
+                                  (*sizes)[0]);
+        *nsizes = 1;
+        return 0;
+    }
+
+    for (gnode = 0; gnode < ngnodes; gnode++) {
+        virDomainHugePagePtr hugepage = NULL;
+        virDomainHugePagePtr master_hugepage = NULL;
+        unsigned long long nodemem;
+        bool thisHugepage = false;
+
+        for (i = 0; i < def->mem.nhugepages; i++) {
+            if (!def->mem.hugepages[i].nodemask) {
+                master_hugepage = &def->mem.hugepages[i];
+                continue;
+            }
+
+            if (virBitmapGetBit(def->mem.hugepages[i].nodemask,
+                                gnode, &thisHugepage) < 0)
+                continue;
+
+            if (thisHugepage) {
+                hugepage = &def->mem.hugepages[i];
+                break;
+            }
+        }
+
+        if (!hugepage)
+            hugepage = master_hugepage;
+
+        /* the node is backed by regular memory */
+        if (!hugepage)
+            continue;
+
+        nodemem = virDomainNumaGetNodeMemorySize(def->numa, gnode);
+
+        for (i = 0; i < *nsizes; i++) {
+            if ((*sizes)[i] == hugepage->size)
+                break;
+        }
+        if (i == *nsizes) {
+            (*sizes)[i] = hugepage->size;
+            (*nsizes)++;
+        }
+        (*npages)[i] += VIR_DIV_UP(nodemem, hugepage->size);
+    }
+
+    return 0;
+
+ error:
+    VIR_FREE(*sizes);
+    VIR_FREE(*npages);
+    return -1;
+}
+
+
+/**
+ * qemuProcessHugePagesClaim:
+ * @def: domain definition
+ *
+ * Claim the huge pages the domain is going to allocate, so that
+ * domains starting concurrently don't base their placement on free
+ * counters that don't reflect this domain yet. The claim only covers
+ * the startup window: it must be dropped with
+ * qemuProcessHugePagesRelease once qemu has allocated its memory (or
+ * failed to start), at which point the kernel's counters take over.
+ *
+ * Returns 0 on success, -1 on error (with the error reported).
+ */
+static int
+qemuProcessHugePagesClaim(virDomainDefPtr def)
+{
+    unsigned long long *sizes = NULL;
+    unsigned long long *npages = NULL;
+    size_t nsizes;
+    size_t i;
+    int ret = -1;
+
+    if (qemuProcessHugePagesCompute(def, &sizes, &npages, &nsizes) < 0)
+        return -1;
+
+    for (i = 0; i < nsizes; i++) {
+        if (virHostMemHugePageClaim(sizes[i], npages[i]) < 0) {
+            while (i--)
+                virHostMemHugePageRelease(sizes[i], npages[i]);
+            goto cleanup;
+        }
+    }
+
+    ret = 0;
+ cleanup:
+    VIR_FREE(sizes);
+    VIR_FREE(npages);
+    return ret;
+}
+
+
+/**
+ * qemuProcessHugePagesRelease:
+ * @def: domain definition
+ *
+ * Drop the claim taken with qemuProcessHugePagesClaim.
+ */
+static void
+qemuProcessHugePagesRelease(virDomainDefPtr def)
+{
+    unsigned long long *sizes = NULL;
+    unsigned long long *npages = NULL;
+    size_t nsizes;
+    size_t i;
+
+    if (qemuProcessHugePagesCompute(def, &sizes, &npages, &nsizes) < 0) {
+        virResetLastError();
+        return;
+    }
+
+    for (i = 0; i < nsizes; i++)
+        virHostMemHugePageRelease(sizes[i], npages[i]);
+
+    VIR_FREE(sizes);
+    VIR_FREE(npages);
+}
+
+
 struct qemuProcessReconnectData {
     virConnectPtr conn;
     virQEMUDriverPtr driver;
     virDomainObjPtr obj;
+    virCapsPtr caps;
 };
 /*
  * Open an existing VM's monitor, re-detect VCPU threads
@@ -3326,7 +3528,7 @@ qemuProcessReconnect(void *opaque)
     size_t i;
     unsigned int stopFlags = 0;
     bool jobStarted = false;
-    virCapsPtr caps = NULL;
+    virCapsPtr caps = data->caps;
 
     VIR_FREE(data);
 
@@ -3337,7 +3539,8 @@ qemuProcessReconnect(void *opaque)
     cfg = virQEMUDriverGetConfig(driver);
     priv = obj->privateData;
 
-    if (!(caps = virQEMUDriverGetCapabilities(driver, false)))
+    if (!caps &&
+        !(caps = virQEMUDriverGetCapabilities(driver, false)))
         goto error;
 
     if (qemuDomainObjBeginJob(driver, obj, QEMU_JOB_MODIFY) < 0)
@@ -3566,6 +3769,7 @@ qemuProcessReconnectHelper(virDomainObjPtr obj,
      * simply increase the reference counter here.
      */
     virObjectRef(data->conn);
+    virObjectRef(data->caps);
 
     if (virThreadCreate(&thread, false, qemuProcessReconnect, data) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
@@ -3582,6 +3786,7 @@ qemuProcessReconnectHelper(virDomainObjPtr obj,
 
         virDomainObjEndAPI(&obj);
         virObjectUnref(data->conn);
+        virObjectUnref(data->caps);
         VIR_FREE(data);
         return -1;
     }
@@ -3599,7 +3804,18 @@ void
 qemuProcessReconnectAll(virConnectPtr conn, virQEMUDriverPtr driver)
 {
     struct qemuProcessReconnectData data = {.conn = conn, .driver = driver};
+
+    /* Resolve the driver capabilities once up front. Leaving this to
+     * the reconnect threads serializes them all on the driver lock
+     * and, if the caps need refreshing, regenerates them once per
+     * domain instead of once per daemon start. If it fails here the
+     * threads will retry individually and report the error. */
+    if (!(data.caps = virQEMUDriverGetCapabilities(driver, false)))
+        virResetLastError();
+
     virDomainObjListForEach(driver->domains, qemuProcessReconnectHelper, &data);
+
+    virObjectUnref(data.caps);
 }
 
 static int
@@ -5428,6 +5644,7 @@ qemuProcessLaunch(virConnectPtr conn,
     virCapsPtr caps = NULL;
     size_t nnicindexes = 0;
     int *nicindexes = NULL;
+    bool hugepagesClaimed = false;
     size_t i;
 
     VIR_DEBUG("vm=%p name=%s id=%d asyncJob=%d "
@@ -5526,6 +5743,13 @@ qemuProcessLaunch(virConnectPtr conn,
     virCommandDaemonize(cmd);
     virCommandRequireHandshake(cmd);
 
+    if (vm->def->mem.nhugepages) {
+        VIR_DEBUG("Claiming huge pages for the domain");
+        if (qemuProcessHugePagesClaim(vm->def) < 0)
+            goto cleanup;
+        hugepagesClaimed = true;
+    }
+
     if (virSecurityManagerPreFork(driver->securityManager) < 0)
         goto cleanup;
     rv = virCommandRun(cmd, NULL);
@@ -5719,6 +5943,10 @@ qemuProcessLaunch(virConnectPtr conn,
     ret = 0;
 
  cleanup:
+    /* qemu now owns whatever pages it could allocate and the kernel's
+     * counters reflect them, so the startup claim can go */
+    if (hugepagesClaimed)
+        qemuProcessHugePagesRelease(vm->def);
     qemuDomainSecretDestroy(vm);
     virCommandFree(cmd);
     qemuDomainLogContextFree(logCtxt);
@@ -6133,6 +6361,10 @@ void qemuProcessStop(virQEMUDriverPtr driver,
         dev.type = VIR_DOMAIN_DEVICE_DISK;
         dev.data.disk = disk;
         ignore_value(qemuRemoveSharedDevice(driver, &dev, vm->def->name));
+
+        /* qemu may have grown the images, don't let offline stats
+         * polls reuse limits refreshed while it was running */
+        QEMU_DOMAIN_DISK_PRIVATE(disk)->chainGen++;
     }
 
     /* Clear out dynamically assigned labels */
@@ -6145,6 +6377,8 @@ void qemuProcessStop(virQEMUDriverPtr driver,
     virStringListFree(priv->qemuDevices);
     priv->qemuDevices = NULL;
 
+    qemuBlockJobInfoCacheInvalidate(vm);
+
     qemuHostdevReAttachDomainDevices(driver, vm->def);
 
     def = vm->def;
@@ -94,10 +94,20 @@ qemuSecuritySetAllLabel(virQEMUDriverPtr driver,
         virSecurityManagerPostFork(driver->securityManager);
 
     } else {
+        /* Queue the individual relabel operations into a transaction
+         * and commit them in one go. The commit spreads the chown()
+         * and setfilecon() calls over a worker pool, which matters
+         * for guests with many disks on network filesystems. */
+        if (virSecurityManagerTransactionStart(driver->securityManager) < 0)
+            return -1;
+
         if (virSecurityManagerSetAllLabel(driver->securityManager,
                                           vm->def,
-                                          stdin_path) < 0)
+                                          stdin_path) < 0 ||
+            virSecurityManagerTransactionCommit(driver->securityManager) < 0) {
+            virSecurityManagerTransactionAbort(driver->securityManager);
             return -1;
+        }
     }
     return 0;
 }
@@ -94,12 +94,23 @@ struct private_data {
     char *type;                 /* Cached return from remoteType. */
     int localUses;              /* Ref count for private data */
     char *hostname;             /* Original hostname */
-    bool serverKeepAlive;       /* Does server support keepalive protocol? */
-    bool serverEventFilter;     /* Does server support modern event filtering */
-    bool serverCloseCallback;   /* Does server support driver close callback */
+    int serverKeepAlive;        /* -1 if not yet probed, else whether the
+                                 * server supports the keepalive protocol */
+    int serverEventFilter;      /* -1 if not yet probed, else whether the
+                                 * server supports modern event filtering */
+    int serverCloseCallback;    /* -1 if not yet probed, else whether the
+                                 * server supports driver close callback */
 
     virObjectEventStatePtr eventState;
     virConnectCloseCallbackDataPtr closeCallback;
+
+    /* Optional caching of host capabilities and node info, enabled
+     * with the host_info_cache_ttl URI parameter; 0 disables it */
+    int hostInfoCacheTTL;       /* seconds */
+    char *capsCache;            /* cached capabilities XML */
+    time_t capsCacheWhen;
+    virNodeInfo nodeInfoCache;
+    time_t nodeInfoCacheWhen;   /* 0 when nothing is cached */
 };
 
 enum {
@@ -632,6 +643,27 @@ remoteConnectSupportsFeatureUnlocked(virConnectPtr conn,
     return rc != -1 && ret.supported;
 }
 
+/*
+ * Ask the server about an optional feature the first time the answer
+ * is actually needed and remember it, rather than paying one round
+ * trip per feature while opening the connection.  @cache points into
+ * @priv and must start out as -1.  The caller must hold the driver
+ * lock.
+ */
+static bool
+remoteConnectFeatureCached(virConnectPtr conn,
+                           struct private_data *priv,
+                           int feature,
+                           int *cache)
+{
+    if (*cache == -1) {
+        *cache = remoteConnectSupportsFeatureUnlocked(conn, priv, feature);
+        if (!*cache)
+            VIR_DEBUG("Server lacks support for feature %d", feature);
+    }
+    return *cache == 1;
+}
+
 /* helper macro to ease extraction of arguments from the URI */
 #define EXTRACT_URI_ARG_STR(ARG_NAME, ARG_VAR)          \
     if (STRCASEEQ(var->name, ARG_NAME)) {               \
@@ -776,6 +808,7 @@ doRemoteOpen(virConnectPtr conn,
     char *pkipath = NULL, *keyfile = NULL, *sshauth = NULL;
 
     char *knownHostsVerify = NULL,  *knownHosts = NULL;
+    char *hostInfoCacheTTL = NULL;
 
     /* Return code from this function, and the private data. */
     int retcode = VIR_DRV_OPEN_ERROR;
@@ -821,6 +854,7 @@ doRemoteOpen(virConnectPtr conn,
             EXTRACT_URI_ARG_STR("known_hosts", knownHosts);
             EXTRACT_URI_ARG_STR("known_hosts_verify", knownHostsVerify);
             EXTRACT_URI_ARG_STR("tls_priority", tls_priority);
+            EXTRACT_URI_ARG_STR("host_info_cache_ttl", hostInfoCacheTTL);
 
             EXTRACT_URI_ARG_BOOL("no_sanity", sanity);
             EXTRACT_URI_ARG_BOOL("no_verify", verify);
@@ -878,6 +912,16 @@ doRemoteOpen(virConnectPtr conn,
 
     VIR_DEBUG("proceeding with name = %s", name);
 
+    if (hostInfoCacheTTL &&
+        (virStrToLong_i(hostInfoCacheTTL, NULL, 10,
+                        &priv->hostInfoCacheTTL) < 0 ||
+         priv->hostInfoCacheTTL < 0)) {
+        virReportError(VIR_ERR_INVALID_ARG,
+                       _("Failed to parse value of URI component %s"),
+                       "host_info_cache_ttl");
+        goto failed;
+    }
+
     /* For ext transport, command is required. */
     if (transport == trans_ext && !command) {
         virReportError(VIR_ERR_INVALID_ARG, "%s",
@@ -1143,15 +1187,6 @@ doRemoteOpen(virConnectPtr conn,
     if (remoteAuthenticate(conn, priv, auth, authtype) == -1)
         goto failed;
 
-    if (virNetClientKeepAliveIsSupported(priv->client)) {
-        priv->serverKeepAlive = remoteConnectSupportsFeatureUnlocked(conn,
-                                    priv, VIR_DRV_FEATURE_PROGRAM_KEEPALIVE);
-        if (!priv->serverKeepAlive) {
-            VIR_INFO("Disabling keepalive protocol since it is not supported"
-                     " by the server");
-        }
-    }
-
     /* Finally we can call the remote side's open function. */
     {
         remote_connect_open_args args = { &name, flags };
@@ -1186,19 +1221,9 @@ doRemoteOpen(virConnectPtr conn,
     if (!(priv->eventState = virObjectEventStateNew()))
         goto failed;
 
-    priv->serverEventFilter = remoteConnectSupportsFeatureUnlocked(conn,
-                                priv, VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK);
-    if (!priv->serverEventFilter) {
-        VIR_INFO("Avoiding server event filtering since it is not "
-                 "supported by the server");
-    }
-
-    priv->serverCloseCallback = remoteConnectSupportsFeatureUnlocked(conn,
-                                    priv, VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK);
-    if (!priv->serverCloseCallback) {
-        VIR_INFO("Close callback registering isn't supported "
-                 "by the remote side.");
-    }
+    /* Whether the server supports keepalive, modern event filtering
+     * and close callbacks is probed lazily on first use, keeping the
+     * open path down to the exchanges that are strictly required */
 
     /* Successful. */
     retcode = VIR_DRV_OPEN_SUCCESS;
@@ -1218,6 +1243,7 @@ doRemoteOpen(virConnectPtr conn,
     VIR_FREE(tls_priority);
     VIR_FREE(knownHostsVerify);
     VIR_FREE(knownHosts);
+    VIR_FREE(hostInfoCacheTTL);
 #ifndef WIN32
     VIR_FREE(daemonPath);
 #endif
@@ -1257,6 +1283,9 @@ remoteAllocPrivateData(void)
         VIR_FREE(priv);
         return NULL;
     }
+    priv->serverKeepAlive = -1;
+    priv->serverEventFilter = -1;
+    priv->serverCloseCallback = -1;
     remoteDriverLock(priv);
     priv->localUses = 1;
 
@@ -1384,6 +1413,8 @@ doRemoteClose(virConnectPtr conn, struct private_data *priv)
     /* See comment for remoteType. */
     VIR_FREE(priv->type);
 
+    VIR_FREE(priv->capsCache);
+
     virObjectUnref(priv->eventState);
     priv->eventState = NULL;
 
@@ -1449,6 +1480,95 @@ remoteConnectGetType(virConnectPtr conn)
     return rv;
 }
 
+/* The host capabilities and node hardware description change rarely,
+ * yet management applications poll them in every reconcile loop. For
+ * connections opened with the host_info_cache_ttl URI parameter these
+ * two calls serve a cached answer until the TTL expires instead of
+ * hitting the wire every time. */
+static int
+remoteNodeGetInfo(virConnectPtr conn,
+                  virNodeInfoPtr result)
+{
+    int rv = -1;
+    struct private_data *priv = conn->privateData;
+    remote_node_get_info_ret ret;
+    time_t now = time(NULL);
+
+    remoteDriverLock(priv);
+
+    if (priv->hostInfoCacheTTL > 0 &&
+        priv->nodeInfoCacheWhen != 0 &&
+        now - priv->nodeInfoCacheWhen < priv->hostInfoCacheTTL) {
+        memcpy(result, &priv->nodeInfoCache, sizeof(*result));
+        rv = 0;
+        goto done;
+    }
+
+    memset(&ret, 0, sizeof(ret));
+    if (call(conn, priv, 0, REMOTE_PROC_NODE_GET_INFO,
+             (xdrproc_t) xdr_void, (char *) NULL,
+             (xdrproc_t) xdr_remote_node_get_info_ret, (char *) &ret) == -1)
+        goto done;
+
+    memcpy(result->model, ret.model, sizeof(result->model));
+    result->memory = ret.memory;
+    result->cpus = ret.cpus;
+    result->mhz = ret.mhz;
+    result->nodes = ret.nodes;
+    result->sockets = ret.sockets;
+    result->cores = ret.cores;
+    result->threads = ret.threads;
+
+    if (priv->hostInfoCacheTTL > 0) {
+        memcpy(&priv->nodeInfoCache, result, sizeof(priv->nodeInfoCache));
+        priv->nodeInfoCacheWhen = now;
+    }
+
+    rv = 0;
+
+ done:
+    remoteDriverUnlock(priv);
+    return rv;
+}
+
+static char *
+remoteConnectGetCapabilities(virConnectPtr conn)
+{
+    char *rv = NULL;
+    struct private_data *priv = conn->privateData;
+    remote_connect_get_capabilities_ret ret;
+    time_t now = time(NULL);
+
+    remoteDriverLock(priv);
+
+    if (priv->hostInfoCacheTTL > 0 &&
+        priv->capsCache &&
+        now - priv->capsCacheWhen < priv->hostInfoCacheTTL) {
+        ignore_value(VIR_STRDUP(rv, priv->capsCache));
+        goto done;
+    }
+
+    memset(&ret, 0, sizeof(ret));
+    if (call(conn, priv, 0, REMOTE_PROC_CONNECT_GET_CAPABILITIES,
+             (xdrproc_t) xdr_void, (char *) NULL,
+             (xdrproc_t) xdr_remote_connect_get_capabilities_ret,
+             (char *) &ret) == -1)
+        goto done;
+
+    rv = ret.capabilities;
+
+    if (priv->hostInfoCacheTTL > 0) {
+        VIR_FREE(priv->capsCache);
+        /* merely a cache, so a failed copy just means a fresh call */
+        ignore_value(VIR_STRDUP_QUIET(priv->capsCache, rv));
+        priv->capsCacheWhen = now;
+    }
+
+ done:
+    remoteDriverUnlock(priv);
+    return rv;
+}
+
 static int remoteConnectIsSecure(virConnectPtr conn)
 {
     int rv = -1;
@@ -4277,21 +4397,26 @@ remoteConnectDomainEventRegister(virConnectPtr conn,
     int rv = -1;
     struct private_data *priv = conn->privateData;
     int count;
+    bool serverEventFilter;
 
     remoteDriverLock(priv);
 
+    serverEventFilter = remoteConnectFeatureCached(conn, priv,
+                            VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK,
+                            &priv->serverEventFilter);
+
     if ((count = virDomainEventStateRegisterClient(conn, priv->eventState,
                                                    NULL,
                                                    VIR_DOMAIN_EVENT_ID_LIFECYCLE,
                                                    VIR_DOMAIN_EVENT_CALLBACK(callback),
                                                    opaque, freecb, true,
                                                    &callbackID,
-                                                   priv->serverEventFilter)) < 0)
+                                                   serverEventFilter)) < 0)
          goto done;
 
     if (count == 1) {
         /* Tell the server when we are the first callback registering */
-        if (priv->serverEventFilter) {
+        if (serverEventFilter) {
             remote_connect_domain_event_callback_register_any_args args;
             remote_connect_domain_event_callback_register_any_ret ret;
 
@@ -4352,7 +4477,9 @@ remoteConnectDomainEventDeregister(virConnectPtr conn,
 
     if (count == 0) {
         /* Tell the server when we are the last callback deregistering */
-        if (priv->serverEventFilter) {
+        if (remoteConnectFeatureCached(conn, priv,
+                                       VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK,
+                                       &priv->serverEventFilter)) {
             args.callbackID = remoteID;
 
             if (call(conn, priv, 0,
@@ -5671,20 +5798,25 @@ remoteConnectDomainEventRegisterAny(virConnectPtr conn,
     int callbackID;
     int count;
     remote_nonnull_domain domain;
+    bool serverEventFilter;
 
     remoteDriverLock(priv);
 
+    serverEventFilter = remoteConnectFeatureCached(conn, priv,
+                            VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK,
+                            &priv->serverEventFilter);
+
     if ((count = virDomainEventStateRegisterClient(conn, priv->eventState,
                                                    dom, eventID, callback,
                                                    opaque, freecb, false,
                                                    &callbackID,
-                                                   priv->serverEventFilter)) < 0)
+                                                   serverEventFilter)) < 0)
         goto done;
 
     /* If this is the first callback for this eventID, we need to enable
      * events on the server */
     if (count == 1) {
-        if (priv->serverEventFilter) {
+        if (serverEventFilter) {
             remote_connect_domain_event_callback_register_any_args args;
             remote_connect_domain_event_callback_register_any_ret ret;
 
@@ -5752,7 +5884,9 @@ remoteConnectDomainEventDeregisterAny(virConnectPtr conn,
     /* If that was the last callback for this eventID, we need to disable
      * events on the server */
     if (count == 0) {
-        if (priv->serverEventFilter) {
+        if (remoteConnectFeatureCached(conn, priv,
+                                       VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK,
+                                       &priv->serverEventFilter)) {
             remote_connect_domain_event_callback_deregister_any_args args;
 
             args.callbackID = remoteID;
@@ -6327,7 +6461,9 @@ remoteConnectSetKeepAlive(virConnectPtr conn, int interval, unsigned int count)
         goto cleanup;
     }
 
-    if (!priv->serverKeepAlive) {
+    if (!remoteConnectFeatureCached(conn, priv,
+                                    VIR_DRV_FEATURE_PROGRAM_KEEPALIVE,
+                                    &priv->serverKeepAlive)) {
         ret = 1;
         goto cleanup;
     }
@@ -7755,7 +7891,9 @@ remoteConnectRegisterCloseCallback(virConnectPtr conn,
         goto cleanup;
     }
 
-    if (priv->serverCloseCallback &&
+    if (remoteConnectFeatureCached(conn, priv,
+                                   VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK,
+                                   &priv->serverCloseCallback) &&
         call(conn, priv, 0, REMOTE_PROC_CONNECT_REGISTER_CLOSE_CALLBACK,
              (xdrproc_t) xdr_void, (char *) NULL,
              (xdrproc_t) xdr_void, (char *) NULL) == -1)
@@ -7786,7 +7924,9 @@ remoteConnectUnregisterCloseCallback(virConnectPtr conn,
         goto cleanup;
     }
 
-    if (priv->serverCloseCallback &&
+    if (remoteConnectFeatureCached(conn, priv,
+                                   VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK,
+                                   &priv->serverCloseCallback) &&
         call(conn, priv, 0, REMOTE_PROC_CONNECT_UNREGISTER_CLOSE_CALLBACK,
              (xdrproc_t) xdr_void, (char *) NULL,
              (xdrproc_t) xdr_void, (char *) NULL) == -1)
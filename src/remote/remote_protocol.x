@@ -2556,6 +2556,15 @@ struct remote_domain_snapshot_create_xml_ret {
     remote_nonnull_domain_snapshot snap;
 };
 
+/* Note: a bulk "names plus XML for all snapshots of a domain" call
+ * has been proposed repeatedly to cut round trips for inventory
+ * tools.  It cannot be added safely: REMOTE_DOMAIN_SNAPSHOT_LIST_MAX
+ * domains' worth of unbounded XML documents in one reply can exceed
+ * VIR_NET_MESSAGE_MAX, and a procedure whose reply size the server
+ * cannot bound up front would have to fail exactly on the large
+ * inventories it is meant to help.  Clients needing bulk export
+ * should pipeline the per-snapshot calls instead; the protocol allows
+ * multiple calls in flight on one connection. */
 struct remote_domain_snapshot_get_xml_desc_args {
     remote_nonnull_domain_snapshot snap;
     unsigned int flags;
@@ -3441,14 +3450,14 @@ enum remote_procedure {
     REMOTE_PROC_CONNECT_GET_MAX_VCPUS = 5,
 
     /**
-     * @generate: both
+     * @generate: server
      * @priority: high
      * @acl: connect:read
      */
     REMOTE_PROC_NODE_GET_INFO = 6,
 
     /**
-     * @generate: both
+     * @generate: server
      * @acl: connect:read
      */
     REMOTE_PROC_CONNECT_GET_CAPABILITIES = 7,
@@ -409,8 +409,12 @@ virKeepAliveCheckMessage(virKeepAlivePtr ka,
         }
     }
 
-    if (ka->timer >= 0)
-        virEventUpdateTimeout(ka->timer, ka->interval * 1000);
+    /* There is no need to re-arm ka->timer here. The timer callback
+     * notices the refreshed intervalStart, re-arms itself for the
+     * remaining time and does not send anything. Updating the timeout
+     * from here would wake up the event loop for every single message
+     * received on every connection, which serializes all RPC threads
+     * on the event loop lock once enough clients are connected. */
 
     virObjectUnlock(ka);
 
@@ -30,6 +30,7 @@
 #include "virnetclient.h"
 #include "virnetsocket.h"
 #include "virkeepalive.h"
+#include "virhash.h"
 #include "viralloc.h"
 #include "virthread.h"
 #include "virfile.h"
@@ -98,6 +99,14 @@ struct _virNetClient {
      * which might be a partially sent non-blocking call.
      */
     virNetClientCallPtr waitDispatch;
+    /* Tail of waitDispatch, so queuing a call is O(1) however many
+     * calls are in flight */
+    virNetClientCallPtr waitDispatchTail;
+    /* Index of queued calls keyed by prog.vers.serial, so matching a
+     * reply against thousands of in-flight calls doesn't degrade to
+     * walking the whole queue per packet. Best effort: lookups fall
+     * back to the queue walk for anything not (or no longer) indexed */
+    virHashTablePtr waitDispatchHash;
     /* True if a thread holds the buck */
     bool haveTheBuck;
 
@@ -156,47 +165,79 @@ static void virNetClientIncomingEvent(virNetSocketPtr sock,
                                       int events,
                                       void *opaque);
 
+/* Format the index key identifying the call expecting the packet
+ * described by @header */
+static void virNetClientCallKey(virNetMessageHeaderPtr header,
+                                char *key,
+                                size_t keylen)
+{
+    snprintf(key, keylen, "%u.%u.%u",
+             header->prog, header->vers, header->serial);
+}
+
+#define VIR_NET_CLIENT_CALL_KEY_LEN 40
+
+/* Drop @call from the dispatch index, if it is the indexed entry */
+static void virNetClientCallUnindex(virNetClientPtr client,
+                                    virNetClientCallPtr call)
+{
+    char key[VIR_NET_CLIENT_CALL_KEY_LEN];
+
+    if (!client->waitDispatchHash || !call->msg)
+        return;
+
+    virNetClientCallKey(&call->msg->header, key, sizeof(key));
+    if (virHashLookup(client->waitDispatchHash, key) == call)
+        ignore_value(virHashRemoveEntry(client->waitDispatchHash, key));
+}
+
 /* Append a call to the end of the list */
-static void virNetClientCallQueue(virNetClientCallPtr *head,
+static void virNetClientCallQueue(virNetClientPtr client,
                                   virNetClientCallPtr call)
 {
-    virNetClientCallPtr tmp = *head;
-    while (tmp && tmp->next)
-        tmp = tmp->next;
-    if (tmp)
-        tmp->next = call;
+    if (client->waitDispatchTail)
+        client->waitDispatchTail->next = call;
     else
-        *head = call;
+        client->waitDispatch = call;
+    client->waitDispatchTail = call;
     call->next = NULL;
-}
 
-#if 0
-/* Obtain a call from the head of the list */
-static virNetClientCallPtr virNetClientCallServe(virNetClientCallPtr *head)
-{
-    virNetClientCallPtr tmp = *head;
-    if (tmp)
-        *head = tmp->next;
-    else
-        *head = NULL;
-    tmp->next = NULL;
-    return tmp;
+    if (client->waitDispatchHash && call->msg) {
+        char key[VIR_NET_CLIENT_CALL_KEY_LEN];
+
+        virNetClientCallKey(&call->msg->header, key, sizeof(key));
+        if (!virHashLookup(client->waitDispatchHash, key)) {
+            /* The index is only an accelerator, so a failure to add
+             * must not leave an error behind for the RPC code to
+             * misinterpret as a failed call */
+            virErrorPtr orig = virSaveLastError();
+            if (virHashAddEntry(client->waitDispatchHash, key, call) < 0) {
+                if (orig)
+                    virSetError(orig);
+                else
+                    virResetLastError();
+            }
+            virFreeError(orig);
+        }
+    }
 }
-#endif
 
 /* Remove a call from anywhere in the list */
-static void virNetClientCallRemove(virNetClientCallPtr *head,
+static void virNetClientCallRemove(virNetClientPtr client,
                                    virNetClientCallPtr call)
 {
-    virNetClientCallPtr tmp = *head;
+    virNetClientCallPtr tmp = client->waitDispatch;
     virNetClientCallPtr prev = NULL;
     while (tmp) {
         if (tmp == call) {
             if (prev)
                 prev->next = tmp->next;
             else
-                *head = tmp->next;
+                client->waitDispatch = tmp->next;
+            if (client->waitDispatchTail == tmp)
+                client->waitDispatchTail = prev;
             tmp->next = NULL;
+            virNetClientCallUnindex(client, call);
             return;
         }
         prev = tmp;
@@ -208,20 +249,34 @@ static void virNetClientCallRemove(virNetClientCallPtr *head,
 typedef bool (*virNetClientCallPredicate)(virNetClientCallPtr call, void *opaque);
 
 /* Remove a list of calls from the list based on a predicate */
-static void virNetClientCallRemovePredicate(virNetClientCallPtr *head,
+static void virNetClientCallRemovePredicate(virNetClientPtr client,
                                             virNetClientCallPredicate pred,
                                             void *opaque)
 {
-    virNetClientCallPtr tmp = *head;
+    virNetClientCallPtr tmp = client->waitDispatch;
     virNetClientCallPtr prev = NULL;
     while (tmp) {
         virNetClientCallPtr next = tmp->next;
+        char key[VIR_NET_CLIENT_CALL_KEY_LEN];
+        bool indexed = false;
+
+        /* The predicate may free the call, so decide up front whether
+         * its index entry needs dropping and do so by key afterwards */
+        if (client->waitDispatchHash && tmp->msg) {
+            virNetClientCallKey(&tmp->msg->header, key, sizeof(key));
+            indexed = virHashLookup(client->waitDispatchHash, key) == tmp;
+        }
+
         tmp->next = NULL; /* Temp unlink */
         if (pred(tmp, opaque)) {
             if (prev)
                 prev->next = next;
             else
-                *head = next;
+                client->waitDispatch = next;
+            if (client->waitDispatchTail == tmp)
+                client->waitDispatchTail = prev;
+            if (indexed)
+                ignore_value(virHashRemoveEntry(client->waitDispatchHash, key));
         } else {
             tmp->next = next; /* Reverse temp unlink */
             prev = tmp;
@@ -323,6 +378,11 @@ static virNetClientPtr virNetClientNew(virNetSocketPtr sock,
     if (VIR_STRDUP(client->hostname, hostname) < 0)
         goto error;
 
+    /* Purely an accelerator for matching replies to in-flight calls;
+     * everything still works off the plain queue without it */
+    if (!(client->waitDispatchHash = virHashCreate(53, NULL)))
+        virResetLastError();
+
     PROBE(RPC_CLIENT_NEW,
           "client=%p sock=%p",
           client, client->sock);
@@ -753,6 +813,7 @@ void virNetClientDispose(void *obj)
     VIR_FORCE_CLOSE(client->wakeupSendFD);
     VIR_FORCE_CLOSE(client->wakeupReadFD);
 
+    virHashFree(client->waitDispatchHash);
     VIR_FREE(client->hostname);
 
     if (client->sock)
@@ -765,7 +826,7 @@ void virNetClientDispose(void *obj)
     virObjectUnref(client->sasl);
 #endif
 
-    virNetMessageClear(&client->msg);
+    virNetMessageClearPayload(&client->msg);
 }
 
 
@@ -1103,13 +1164,22 @@ int virNetClientGetTLSKeySize(virNetClientPtr client)
 }
 #endif
 
-static int
-virNetClientCallDispatchReply(virNetClientPtr client)
+/* Find the waiting call, if any, which the packet currently decoded
+ * into client->msg belongs to */
+static virNetClientCallPtr
+virNetClientCallFind(virNetClientPtr client)
 {
     virNetClientCallPtr thecall;
 
-    /* Ok, definitely got an RPC reply now find
-       out which waiting call is associated with it */
+    if (client->waitDispatchHash) {
+        char key[VIR_NET_CLIENT_CALL_KEY_LEN];
+
+        virNetClientCallKey(&client->msg.header, key, sizeof(key));
+        if ((thecall = virHashLookup(client->waitDispatchHash, key)))
+            return thecall;
+        /* fall through; the call may have missed the index */
+    }
+
     thecall = client->waitDispatch;
     while (thecall &&
            !(thecall->msg->header.prog == client->msg.header.prog &&
@@ -1117,6 +1187,18 @@ virNetClientCallDispatchReply(virNetClientPtr client)
              thecall->msg->header.serial == client->msg.header.serial))
         thecall = thecall->next;
 
+    return thecall;
+}
+
+static int
+virNetClientCallDispatchReply(virNetClientPtr client)
+{
+    virNetClientCallPtr thecall;
+
+    /* Ok, definitely got an RPC reply now find
+       out which waiting call is associated with it */
+    thecall = virNetClientCallFind(client);
+
     if (!thecall) {
         virReportError(VIR_ERR_RPC,
                        _("no call waiting for reply with prog %d vers %d serial %d"),
@@ -1124,7 +1206,7 @@ virNetClientCallDispatchReply(virNetClientPtr client)
         return -1;
     }
 
-    if (VIR_REALLOC_N(thecall->msg->buffer, client->msg.bufferLength) < 0)
+    if (virNetMessageEnsureCapacity(thecall->msg, client->msg.bufferLength) < 0)
         return -1;
 
     memcpy(thecall->msg->buffer, client->msg.buffer, client->msg.bufferLength);
@@ -1190,12 +1272,7 @@ static int virNetClientCallDispatchStream(virNetClientPtr client)
 
     /* Finish/Abort are synchronous, so also see if there's an
      * (optional) call waiting for this stream packet */
-    thecall = client->waitDispatch;
-    while (thecall &&
-           !(thecall->msg->header.prog == client->msg.header.prog &&
-             thecall->msg->header.vers == client->msg.header.vers &&
-             thecall->msg->header.serial == client->msg.header.serial))
-        thecall = thecall->next;
+    thecall = virNetClientCallFind(client);
 
     VIR_DEBUG("Found call %p", thecall);
 
@@ -1371,7 +1448,7 @@ virNetClientIOReadMessage(virNetClientPtr client)
     /* Start by reading length word */
     if (client->msg.bufferLength == 0) {
         client->msg.bufferLength = 4;
-        if (VIR_ALLOC_N(client->msg.buffer, client->msg.bufferLength) < 0)
+        if (virNetMessageEnsureCapacity(&client->msg, client->msg.bufferLength) < 0)
             return -ENOMEM;
     }
 
@@ -1575,7 +1652,7 @@ virNetClientIOEventLoopPassTheBuck(virNetClientPtr client,
     VIR_DEBUG("No thread to pass the buck to");
     if (client->wantClose) {
         virNetClientCloseLocked(client);
-        virNetClientCallRemovePredicate(&client->waitDispatch,
+        virNetClientCallRemovePredicate(client,
                                         virNetClientIOEventLoopRemoveAll,
                                         thiscall);
     }
@@ -1722,13 +1799,13 @@ static int virNetClientIOEventLoop(virNetClientPtr client,
         /* Iterate through waiting calls and if any are
          * complete, remove them from the dispatch list.
          */
-        virNetClientCallRemovePredicate(&client->waitDispatch,
+        virNetClientCallRemovePredicate(client,
                                         virNetClientIOEventLoopRemoveDone,
                                         thiscall);
 
         /* Now see if *we* are done */
         if (thiscall->mode == VIR_NET_CLIENT_MODE_COMPLETE) {
-            virNetClientCallRemove(&client->waitDispatch, thiscall);
+            virNetClientCallRemove(client, thiscall);
             virNetClientIOEventLoopPassTheBuck(client, thiscall);
             return 0;
         }
@@ -1756,7 +1833,7 @@ static int virNetClientIOEventLoop(virNetClientPtr client,
         VIR_DEBUG("error on socket: %s", client->error->message);
         virSetError(client->error);
     }
-    virNetClientCallRemove(&client->waitDispatch, thiscall);
+    virNetClientCallRemove(client, thiscall);
     virNetClientIOEventLoopPassTheBuck(client, thiscall);
     return -1;
 }
@@ -1866,7 +1943,7 @@ static int virNetClientIO(virNetClientPtr client,
               client->waitDispatch);
 
     /* Stick ourselves on the end of the wait queue */
-    virNetClientCallQueue(&client->waitDispatch, thiscall);
+    virNetClientCallQueue(client, thiscall);
 
     /* Check to see if another thread is dispatching */
     if (client->haveTheBuck) {
@@ -1874,7 +1951,7 @@ static int virNetClientIO(virNetClientPtr client,
 
         /* Force other thread to wakeup from poll */
         if (safewrite(client->wakeupSendFD, &ignore, sizeof(ignore)) != sizeof(ignore)) {
-            virNetClientCallRemove(&client->waitDispatch, thiscall);
+            virNetClientCallRemove(client, thiscall);
             virReportSystemError(errno, "%s",
                                  _("failed to wake up polling thread"));
             return -1;
@@ -1892,7 +1969,7 @@ static int virNetClientIO(virNetClientPtr client,
                   client->waitDispatch, thiscall);
         /* Go to sleep while other thread is working... */
         if (virCondWait(&thiscall->cond, &client->parent.lock) < 0) {
-            virNetClientCallRemove(&client->waitDispatch, thiscall);
+            virNetClientCallRemove(client, thiscall);
             virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                            _("failed to wait on condition"));
             return -1;
@@ -1996,7 +2073,7 @@ void virNetClientIncomingEvent(virNetSocketPtr sock,
     }
 
     /* Remove completed calls or signal their threads. */
-    virNetClientCallRemovePredicate(&client->waitDispatch,
+    virNetClientCallRemovePredicate(client,
                                     virNetClientIOEventLoopRemoveDone,
                                     NULL);
     virNetClientIOUpdateCallback(client, true);
@@ -2004,7 +2081,7 @@ void virNetClientIncomingEvent(virNetSocketPtr sock,
  done:
     if (client->wantClose && !client->haveTheBuck) {
         virNetClientCloseLocked(client);
-        virNetClientCallRemovePredicate(&client->waitDispatch,
+        virNetClientCallRemovePredicate(client,
                                         virNetClientIOEventLoopRemoveAll,
                                         NULL);
     }
@@ -2080,7 +2157,7 @@ virNetClientQueueNonBlocking(virNetClientPtr client,
     if (!(call = virNetClientCallNew(msg, false, true)))
         return -1;
 
-    virNetClientCallQueue(&client->waitDispatch, call);
+    virNetClientCallQueue(client, call);
     return 0;
 }
 
@@ -281,9 +281,11 @@ int virNetClientStreamQueuePacket(virNetClientStreamPtr st,
 
     /* Steal message buffer */
     tmp_msg->buffer = msg->buffer;
+    tmp_msg->bufferCapacity = msg->bufferCapacity;
     tmp_msg->bufferLength = msg->bufferLength;
     tmp_msg->bufferOffset = msg->bufferOffset;
     msg->buffer = NULL;
+    msg->bufferCapacity = 0;
     msg->bufferLength = msg->bufferOffset = 0;
 
     virObjectLock(st);
@@ -63,6 +63,7 @@ virNetMessageClearPayload(virNetMessagePtr msg)
 
     msg->bufferOffset = 0;
     msg->bufferLength = 0;
+    msg->bufferCapacity = 0;
     VIR_FREE(msg->buffer);
 }
 
@@ -70,12 +71,42 @@ virNetMessageClearPayload(virNetMessagePtr msg)
 void virNetMessageClear(virNetMessagePtr msg)
 {
     bool tracked = msg->tracked;
+    char *buffer = msg->buffer;
+    size_t bufferCapacity = msg->bufferCapacity;
+    size_t i;
 
     VIR_DEBUG("msg=%p nfds=%zu", msg, msg->nfds);
 
-    virNetMessageClearPayload(msg);
+    /* Retain the decode/encode buffer across clears so a message
+     * can be reused without going back to the allocator, but don't
+     * let an unusually large payload pin memory forever */
+    if (bufferCapacity > VIR_NET_MESSAGE_INITIAL + VIR_NET_MESSAGE_LEN_MAX) {
+        VIR_FREE(buffer);
+        bufferCapacity = 0;
+    }
+
+    for (i = 0; i < msg->nfds; i++)
+        VIR_FORCE_CLOSE(msg->fds[i]);
+    VIR_FREE(msg->fds);
+
     memset(msg, 0, sizeof(*msg));
     msg->tracked = tracked;
+    msg->buffer = buffer;
+    msg->bufferCapacity = bufferCapacity;
+}
+
+
+int virNetMessageEnsureCapacity(virNetMessagePtr msg,
+                                size_t len)
+{
+    if (msg->bufferCapacity >= len)
+        return 0;
+
+    if (VIR_REALLOC_N(msg->buffer, len) < 0)
+        return -1;
+
+    msg->bufferCapacity = len;
+    return 0;
 }
 
 
@@ -154,7 +185,7 @@ int virNetMessageDecodeLength(virNetMessagePtr msg)
     /* Extend our declared buffer length and carry
        on reading the header + payload */
     msg->bufferLength += len;
-    if (VIR_REALLOC_N(msg->buffer, msg->bufferLength) < 0)
+    if (virNetMessageEnsureCapacity(msg, msg->bufferLength) < 0)
         goto cleanup;
 
     VIR_DEBUG("Got length, now need %zu total (%u more)",
@@ -231,7 +262,7 @@ int virNetMessageEncodeHeader(virNetMessagePtr msg)
     unsigned int len = 0;
 
     msg->bufferLength = VIR_NET_MESSAGE_INITIAL + VIR_NET_MESSAGE_LEN_MAX;
-    if (VIR_REALLOC_N(msg->buffer, msg->bufferLength) < 0)
+    if (virNetMessageEnsureCapacity(msg, msg->bufferLength) < 0)
         return ret;
     msg->bufferOffset = 0;
 
@@ -349,10 +380,31 @@ int virNetMessageEncodePayload(virNetMessagePtr msg,
 {
     XDR xdr;
     unsigned int msglen;
+    unsigned long payloadlen;
 
     /* Serialise payload of the message. This assumes that
      * virNetMessageEncodeHeader has already been run, so
      * just appends to that data */
+
+    /* Size the buffer from the encoded length up front, so large
+     * payloads (domain XML and friends) are copied into the buffer
+     * exactly once instead of being partially re-encoded at every
+     * step of the trial-and-error growth below. */
+    if ((payloadlen = xdr_sizeof(filter, data)) > 0) {
+        if (payloadlen > VIR_NET_MESSAGE_MAX) {
+            virReportError(VIR_ERR_RPC, "%s",
+                           _("Unable to encode message payload"));
+            return -1;
+        }
+
+        if (msg->bufferOffset + payloadlen > msg->bufferLength) {
+            msg->bufferLength = msg->bufferOffset + payloadlen;
+
+            if (virNetMessageEnsureCapacity(msg, msg->bufferLength) < 0)
+                return -1;
+        }
+    }
+
     xdrmem_create(&xdr, msg->buffer + msg->bufferOffset,
                   msg->bufferLength - msg->bufferOffset, XDR_ENCODE);
 
@@ -369,7 +421,7 @@ int virNetMessageEncodePayload(virNetMessagePtr msg,
 
         msg->bufferLength = newlen + VIR_NET_MESSAGE_LEN_MAX;
 
-        if (VIR_REALLOC_N(msg->buffer, msg->bufferLength) < 0)
+        if (virNetMessageEnsureCapacity(msg, msg->bufferLength) < 0)
             goto error;
 
         xdrmem_create(&xdr, msg->buffer + msg->bufferOffset,
@@ -430,13 +482,15 @@ int virNetMessageDecodePayload(virNetMessagePtr msg,
 }
 
 
-int virNetMessageEncodePayloadRaw(virNetMessagePtr msg,
-                                  const char *data,
-                                  size_t len)
+/* Make room for a raw payload of up to @len bytes directly after the
+ * already encoded header and return a pointer to it, so callers can
+ * generate the payload in place (e.g. read stream data straight into
+ * the transmit buffer) instead of staging it in a separate buffer.
+ * The payload only becomes part of the message once the actual number
+ * of bytes produced is passed to virNetMessageCommitPayloadRaw. */
+char *virNetMessageReservePayloadRaw(virNetMessagePtr msg,
+                                     size_t len)
 {
-    XDR xdr;
-    unsigned int msglen;
-
     /* If the message buffer is too small for the payload increase it accordingly. */
     if ((msg->bufferLength - msg->bufferOffset) < len) {
         if ((msg->bufferOffset + len) >
@@ -448,18 +502,30 @@ int virNetMessageEncodePayloadRaw(virNetMessagePtr msg,
                            VIR_NET_MESSAGE_MAX +
                            VIR_NET_MESSAGE_LEN_MAX -
                            msg->bufferOffset);
-            return -1;
+            return NULL;
         }
 
         msg->bufferLength = msg->bufferOffset + len;
 
-        if (VIR_REALLOC_N(msg->buffer, msg->bufferLength) < 0)
-            return -1;
+        if (virNetMessageEnsureCapacity(msg, msg->bufferLength) < 0)
+            return NULL;
 
         VIR_DEBUG("Increased message buffer length = %zu", msg->bufferLength);
     }
 
-    memcpy(msg->buffer + msg->bufferOffset, data, len);
+    return msg->buffer + msg->bufferOffset;
+}
+
+
+/* Complete a message whose payload was written in place after
+ * virNetMessageReservePayloadRaw; @len is the number of payload bytes
+ * actually produced and must not exceed the reserved size. */
+int virNetMessageCommitPayloadRaw(virNetMessagePtr msg,
+                                  size_t len)
+{
+    XDR xdr;
+    unsigned int msglen;
+
     msg->bufferOffset += len;
 
     /* Re-encode the length word. */
@@ -482,6 +548,21 @@ int virNetMessageEncodePayloadRaw(virNetMessagePtr msg,
 }
 
 
+int virNetMessageEncodePayloadRaw(virNetMessagePtr msg,
+                                  const char *data,
+                                  size_t len)
+{
+    char *payload;
+
+    if (!(payload = virNetMessageReservePayloadRaw(msg, len)))
+        return -1;
+
+    memcpy(payload, data, len);
+
+    return virNetMessageCommitPayloadRaw(msg, len);
+}
+
+
 int virNetMessageEncodePayloadEmpty(virNetMessagePtr msg)
 {
     XDR xdr;
@@ -36,11 +36,16 @@ struct _virNetMessage {
 
     char *buffer; /* Initially VIR_NET_MESSAGE_INITIAL + VIR_NET_MESSAGE_LEN_MAX */
                   /* Maximum   VIR_NET_MESSAGE_MAX     + VIR_NET_MESSAGE_LEN_MAX */
+    size_t bufferCapacity; /* Allocated size of buffer, >= bufferLength */
     size_t bufferLength;
     size_t bufferOffset;
 
     virNetMessageHeader header;
 
+    /* Time (ms) the server queued the message for dispatch,
+     * 0 when it never passed through the worker pool queue */
+    unsigned long long enqueueTime;
+
     virNetMessageFreeCallback cb;
     void *opaque;
 
@@ -66,6 +71,10 @@ void virNetMessageQueuePush(virNetMessagePtr *queue,
                             virNetMessagePtr msg)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
 
+int virNetMessageEnsureCapacity(virNetMessagePtr msg,
+                                size_t len)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_RETURN_CHECK;
+
 int virNetMessageEncodeHeader(virNetMessagePtr msg)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_RETURN_CHECK;
 int virNetMessageDecodeLength(virNetMessagePtr msg)
@@ -85,6 +94,12 @@ int virNetMessageDecodePayload(virNetMessagePtr msg,
 int virNetMessageEncodeNumFDs(virNetMessagePtr msg);
 int virNetMessageDecodeNumFDs(virNetMessagePtr msg);
 
+char *virNetMessageReservePayloadRaw(virNetMessagePtr msg,
+                                     size_t len)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_RETURN_CHECK;
+int virNetMessageCommitPayloadRaw(virNetMessagePtr msg,
+                                  size_t len)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_RETURN_CHECK;
 int virNetMessageEncodePayloadRaw(virNetMessagePtr msg,
                                   const char *buf,
                                   size_t len)
@@ -21,6 +21,7 @@
 #include <config.h>
 
 #include <fnmatch.h>
+#include <string.h>
 
 #include "virnetsaslcontext.h"
 #include "virnetmessage.h"
@@ -47,6 +48,12 @@ struct _virNetSASLSession {
     sasl_conn_t *conn;
     size_t maxbufsize;
     sasl_callback_t *callbacks;
+
+    /* Scratch buffer for gathering vectored plaintext ahead of
+     * sasl_encode, sized to maxbufsize on first use and reused
+     * for the lifetime of the session */
+    char *encodeBuf;
+    size_t encodeBufSize;
 };
 
 
@@ -634,6 +641,77 @@ ssize_t virNetSASLSessionEncode(virNetSASLSessionPtr sasl,
     return ret;
 }
 
+#ifndef WIN32
+/*
+ * Gather as much of the supplied plaintext vector as fits into a
+ * single SASL packet and encode it with one sasl_encode call, so a
+ * queue of small messages does not pay the crypto + framing overhead
+ * once per message.
+ *
+ * Returns the number of plaintext bytes consumed (which may stop
+ * short of the full vector), with *output/*outputlen pointing at the
+ * encoded packet, or -1 on error.
+ */
+ssize_t virNetSASLSessionEncodeV(virNetSASLSessionPtr sasl,
+                                 const struct iovec *iov,
+                                 size_t niov,
+                                 const char **output,
+                                 size_t *outputlen)
+{
+    unsigned outlen = 0;
+    const char *input;
+    size_t inputLen = 0;
+    size_t i;
+    int err;
+    ssize_t ret = -1;
+
+    virObjectLock(sasl);
+
+    if (niov == 1) {
+        /* No gathering needed, encode the caller's buffer in place */
+        input = iov[0].iov_base;
+        inputLen = iov[0].iov_len;
+        if (inputLen > sasl->maxbufsize)
+            inputLen = sasl->maxbufsize;
+    } else {
+        if (sasl->encodeBufSize < sasl->maxbufsize) {
+            if (VIR_REALLOC_N(sasl->encodeBuf, sasl->maxbufsize) < 0)
+                goto cleanup;
+            sasl->encodeBufSize = sasl->maxbufsize;
+        }
+
+        for (i = 0; i < niov && inputLen < sasl->maxbufsize; i++) {
+            size_t chunk = iov[i].iov_len;
+
+            if (chunk > sasl->maxbufsize - inputLen)
+                chunk = sasl->maxbufsize - inputLen;
+            memcpy(sasl->encodeBuf + inputLen, iov[i].iov_base, chunk);
+            inputLen += chunk;
+        }
+        input = sasl->encodeBuf;
+    }
+
+    err = sasl_encode(sasl->conn,
+                      input,
+                      inputLen,
+                      output,
+                      &outlen);
+    *outputlen = outlen;
+
+    if (err != SASL_OK) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("failed to encode SASL data: %d (%s)"),
+                       err, sasl_errstring(err, NULL, NULL));
+        goto cleanup;
+    }
+    ret = inputLen;
+
+ cleanup:
+    virObjectUnlock(sasl);
+    return ret;
+}
+#endif /* !WIN32 */
+
 ssize_t virNetSASLSessionDecode(virNetSASLSessionPtr sasl,
                                 const char *input,
                                 size_t inputLen,
@@ -678,5 +756,6 @@ void virNetSASLSessionDispose(void *obj)
 
     if (sasl->conn)
         sasl_dispose(&sasl->conn);
+    VIR_FREE(sasl->encodeBuf);
     VIR_FREE(sasl->callbacks);
 }
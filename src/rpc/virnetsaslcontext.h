@@ -23,6 +23,9 @@
 
 # include "internal.h"
 # include <sasl/sasl.h>
+# ifndef WIN32
+#  include <sys/uio.h>
+# endif
 
 # include "virobject.h"
 
@@ -104,6 +107,14 @@ ssize_t virNetSASLSessionEncode(virNetSASLSessionPtr sasl,
                                 const char **output,
                                 size_t *outputlen);
 
+# ifndef WIN32
+ssize_t virNetSASLSessionEncodeV(virNetSASLSessionPtr sasl,
+                                 const struct iovec *iov,
+                                 size_t niov,
+                                 const char **output,
+                                 size_t *outputlen);
+# endif
+
 ssize_t virNetSASLSessionDecode(virNetSASLSessionPtr sasl,
                                 const char *input,
                                 size_t inputLen,
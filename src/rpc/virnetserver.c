@@ -31,6 +31,7 @@
 #include "virthreadpool.h"
 #include "virnetservermdns.h"
 #include "virstring.h"
+#include "virtime.h"
 
 #define VIR_FROM_THIS VIR_FROM_RPC
 
@@ -52,6 +53,8 @@ struct _virNetServer {
     char *name;
 
     virThreadPoolPtr workers;
+    bool workersCongested;              /* Warned that the job queue has
+                                         * outgrown the worker pool */
 
     char *mdnsGroupName;
     virNetServerMDNSPtr mdns;
@@ -211,6 +214,7 @@ static int virNetServerDispatchNewMessage(virNetServerClientPtr client,
 
         job->client = client;
         job->msg = msg;
+        ignore_value(virTimeMillisNowRaw(&msg->enqueueTime));
 
         if (prog) {
             virObjectRef(prog);
@@ -223,6 +227,25 @@ static int virNetServerDispatchNewMessage(virNetServerClientPtr client,
         if (ret < 0) {
             VIR_FREE(job);
             virObjectUnref(prog);
+        } else {
+            /* Flag congestion in the logs when the queue outgrows the
+             * pool, with hysteresis so a busy server does not flood
+             * them.  Orchestrators needing a live signal should poll
+             * jobQueueDepth and the per-procedure queue wait stats
+             * via the admin interface instead. */
+            size_t depth = virThreadPoolGetJobQueueDepth(srv->workers);
+            size_t maxWorkers = virThreadPoolGetMaxWorkers(srv->workers);
+
+            if (!srv->workersCongested && depth > maxWorkers * 2) {
+                VIR_WARN("RPC worker pool congested: %zu jobs queued "
+                         "behind %zu workers, clients will see increased "
+                         "latency", depth, maxWorkers);
+                srv->workersCongested = true;
+            } else if (srv->workersCongested && depth <= maxWorkers) {
+                VIR_INFO("RPC worker pool recovered: %zu jobs queued",
+                         depth);
+                srv->workersCongested = false;
+            }
         }
     } else {
         ret = virNetServerProcessMsg(srv, client, prog, msg);
@@ -857,9 +880,7 @@ virNetServerProcessClients(virNetServerPtr srv)
         /* Coverity 5.3.0 couldn't see that srv->clients is non-NULL
          * if srv->nclients is non-zero.  */
         sa_assert(srv->clients);
-        if (virNetServerClientWantClose(srv->clients[i]))
-            virNetServerClientClose(srv->clients[i]);
-        if (virNetServerClientIsClosed(srv->clients[i])) {
+        if (virNetServerClientCheckClose(srv->clients[i])) {
             virNetServerClientPtr client = srv->clients[i];
 
             VIR_DELETE_ELEMENT(srv->clients, i, srv->nclients);
@@ -1013,6 +1034,35 @@ virNetServerGetClients(virNetServerPtr srv,
     return ret;
 }
 
+int
+virNetServerGetPrograms(virNetServerPtr srv,
+                        virNetServerProgramPtr **progs)
+{
+    int ret = -1;
+    size_t i;
+    size_t nprograms = 0;
+    virNetServerProgramPtr *list = NULL;
+
+    virObjectLock(srv);
+
+    for (i = 0; i < srv->nprograms; i++) {
+        virNetServerProgramPtr prog = virObjectRef(srv->programs[i]);
+        if (VIR_APPEND_ELEMENT(list, nprograms, prog) < 0) {
+            virObjectUnref(prog);
+            goto cleanup;
+        }
+    }
+
+    *progs = list;
+    list = NULL;
+    ret = nprograms;
+
+ cleanup:
+    virObjectListFreeCount(list, nprograms);
+    virObjectUnlock(srv);
+    return ret;
+}
+
 virNetServerClientPtr
 virNetServerGetClient(virNetServerPtr srv,
                       unsigned long long id)
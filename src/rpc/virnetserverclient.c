@@ -24,6 +24,9 @@
 #include <config.h>
 
 #include "internal.h"
+#ifndef WIN32
+# include <sys/uio.h>
+#endif
 #if WITH_SASL
 # include <sasl/sasl.h>
 #endif
@@ -36,6 +39,7 @@
 #include "viralloc.h"
 #include "virthread.h"
 #include "virkeepalive.h"
+#include "virkeepaliveprotocol.h"
 #include "virprobe.h"
 #include "virstring.h"
 #include "virutil.h"
@@ -44,6 +48,16 @@
 
 VIR_LOG_INIT("rpc.netserverclient");
 
+/* Upper bound on the number of finished messages cached
+ * per client for later reuse */
+#define VIR_NET_SERVER_CLIENT_MAX_MSG_POOL 8
+
+/* Upper bound on the number of async events queued for
+ * transmission to one client; a client which stops reading
+ * gets further events dropped instead of growing the daemon's
+ * memory without limit during event storms */
+#define VIR_NET_SERVER_CLIENT_TX_EVENTS_MAX 1000
+
 /* Allow for filtering of incoming messages to a custom
  * dispatch processing queue, instead of the workers.
  * This allows for certain types of messages to be handled
@@ -105,6 +119,14 @@ struct _virNetServerClient
     /* Zero or many messages waiting for transmit
      * back to client, including async events */
     virNetMessagePtr tx;
+    /* Count of async events on the 'tx' queue, and the number
+     * dropped because the queue was at its bound */
+    size_t ntxevents;
+    unsigned long long ntxevents_dropped;
+    /* Queue of finished messages cached for reuse, so the
+     * steady-state RPC traffic avoids malloc/free churn */
+    virNetMessagePtr pool;
+    size_t npooled;
 
     /* Filters to capture messages that would otherwise
      * end up on the 'dx' queue */
@@ -326,7 +348,7 @@ virNetServerClientCheckAccess(virNetServerClientPtr client)
      * (NB. The '\1' byte is sent in an encrypted record).
      */
     confirm->bufferLength = 1;
-    if (VIR_ALLOC_N(confirm->buffer, confirm->bufferLength) < 0) {
+    if (virNetMessageEnsureCapacity(confirm, confirm->bufferLength) < 0) {
         virNetMessageFree(confirm);
         return -1;
     }
@@ -354,6 +376,56 @@ static void virNetServerClientSockTimerFunc(int timer,
 }
 
 
+/*
+ * Get a message primed for receiving the next packet,
+ * reusing a pooled message if one is available
+ */
+static virNetMessagePtr
+virNetServerClientMessageNewRX(virNetServerClientPtr client)
+{
+    virNetMessagePtr msg;
+
+    if ((msg = virNetMessageQueueServe(&client->pool))) {
+        client->npooled--;
+        msg->tracked = true;
+    } else if (!(msg = virNetMessageNew(true))) {
+        return NULL;
+    }
+
+    /* Prepare for receipt of the length word */
+    msg->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
+    if (virNetMessageEnsureCapacity(msg, msg->bufferLength) < 0) {
+        virNetMessageFree(msg);
+        return NULL;
+    }
+
+    return msg;
+}
+
+
+/*
+ * Give back a message we have finished with, caching it
+ * for reuse unless the pool is already full
+ */
+static void
+virNetServerClientMessageRelease(virNetServerClientPtr client,
+                                 virNetMessagePtr msg)
+{
+    if (!msg)
+        return;
+
+    if (msg->cb ||
+        client->npooled >= VIR_NET_SERVER_CLIENT_MAX_MSG_POOL) {
+        virNetMessageFree(msg);
+        return;
+    }
+
+    virNetMessageClear(msg);
+    virNetMessageQueuePush(&client->pool, msg);
+    client->npooled++;
+}
+
+
 static virNetServerClientPtr
 virNetServerClientNewInternal(unsigned long long id,
                               virNetSocketPtr sock,
@@ -389,10 +461,7 @@ virNetServerClientNewInternal(unsigned long long id,
         goto error;
 
     /* Prepare one for packet receive */
-    if (!(client->rx = virNetMessageNew(true)))
-        goto error;
-    client->rx->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
-    if (VIR_ALLOC_N(client->rx->buffer, client->rx->bufferLength) < 0)
+    if (!(client->rx = virNetServerClientMessageNewRX(client)))
         goto error;
     client->nrequests = 1;
 
@@ -928,10 +997,14 @@ const char *virNetServerClientRemoteAddrStringURI(virNetServerClientPtr client)
 void virNetServerClientDispose(void *obj)
 {
     virNetServerClientPtr client = obj;
+    virNetMessagePtr msg;
 
     PROBE(RPC_SERVER_CLIENT_DISPOSE,
           "client=%p", client);
 
+    while ((msg = virNetMessageQueueServe(&client->pool)))
+        virNetMessageFree(msg);
+
     if (client->privateData &&
         client->privateDataFreeFunc)
         client->privateDataFreeFunc(client->privateData);
@@ -959,17 +1032,14 @@ void virNetServerClientDispose(void *obj)
  * Full free of the client is done later in a safe point
  * where it can be guaranteed it is no longer in use
  */
-void virNetServerClientClose(virNetServerClientPtr client)
+static void virNetServerClientCloseLocked(virNetServerClientPtr client)
 {
     virNetServerClientCloseFunc cf;
     virKeepAlivePtr ka;
 
-    virObjectLock(client);
     VIR_DEBUG("client=%p", client);
-    if (!client->sock) {
-        virObjectUnlock(client);
+    if (!client->sock)
         return;
-    }
 
     if (client->keepalive) {
         virKeepAliveStop(client->keepalive);
@@ -1015,16 +1085,47 @@ void virNetServerClientClose(virNetServerClientPtr client)
             = virNetMessageQueueServe(&client->tx);
         virNetMessageFree(msg);
     }
+    client->ntxevents = 0;
+    if (client->ntxevents_dropped) {
+        VIR_WARN("Dropped %llu events for slow client=%p",
+                 client->ntxevents_dropped, client);
+        client->ntxevents_dropped = 0;
+    }
 
     if (client->sock) {
         virObjectUnref(client->sock);
         client->sock = NULL;
     }
+}
+
 
+void virNetServerClientClose(virNetServerClientPtr client)
+{
+    virObjectLock(client);
+    virNetServerClientCloseLocked(client);
     virObjectUnlock(client);
 }
 
 
+/*
+ * Close the client if it was asked to close and report whether it is
+ * now fully closed.  Collapses the WantClose/Close/IsClosed sequence
+ * into a single lock acquisition so that the per-iteration sweep over
+ * all clients doesn't bounce each client's lock several times.
+ */
+bool virNetServerClientCheckClose(virNetServerClientPtr client)
+{
+    bool closed;
+
+    virObjectLock(client);
+    if (client->wantClose)
+        virNetServerClientCloseLocked(client);
+    closed = client->sock == NULL;
+    virObjectUnlock(client);
+    return closed;
+}
+
+
 bool virNetServerClientIsClosed(virNetServerClientPtr client)
 {
     bool closed;
@@ -1231,7 +1332,7 @@ static void virNetServerClientDispatchRead(virNetServerClientPtr client)
               msg->header.type, msg->header.status, msg->header.serial);
 
         if (virKeepAliveCheckMessage(client->keepalive, msg, &response)) {
-            virNetMessageFree(msg);
+            virNetServerClientMessageRelease(client, msg);
             client->nrequests--;
             msg = NULL;
 
@@ -1275,18 +1376,19 @@ static void virNetServerClientDispatchRead(virNetServerClientPtr client)
 
         /* Possibly need to create another receive buffer */
         if (client->nrequests < client->nrequests_max) {
-            if (!(client->rx = virNetMessageNew(true))) {
+            if (!(client->rx = virNetServerClientMessageNewRX(client)))
                 client->wantClose = true;
-            } else {
-                client->rx->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
-                if (VIR_ALLOC_N(client->rx->buffer,
-                                client->rx->bufferLength) < 0) {
-                    client->wantClose = true;
-                } else {
-                    client->nrequests++;
-                }
-            }
+            else
+                client->nrequests++;
         }
+
+        /* A single wire read may have buffered several pipelined
+         * messages; frame the next one straight away instead of
+         * bouncing through the event loop once per message */
+        if (client->rx && !client->wantClose &&
+            virNetSocketHasCachedData(client->sock))
+            goto readmore;
+
         virNetServerClientUpdateEvent(client);
     }
 }
@@ -1303,6 +1405,12 @@ static void virNetServerClientDispatchRead(virNetServerClientPtr client)
 static ssize_t virNetServerClientWrite(virNetServerClientPtr client)
 {
     ssize_t ret;
+#ifndef WIN32
+    virNetMessagePtr msg;
+    struct iovec iov[16];
+    size_t niov = 0;
+    size_t left;
+#endif
 
     if (client->tx->bufferLength < client->tx->bufferOffset) {
         virReportError(VIR_ERR_RPC,
@@ -1315,6 +1423,41 @@ static ssize_t virNetServerClientWrite(virNetServerClientPtr client)
     if (client->tx->bufferLength == client->tx->bufferOffset)
         return 1;
 
+#ifndef WIN32
+    /* Coalesce the whole pending tx queue into one vectored send, so
+     * a burst of replies or stream packets costs a single syscall
+     * rather than one per message. Passed fds and the pending SASL
+     * handshake must stay ordered with the byte stream, so don't
+     * reach past a message carrying either of those. */
+    for (msg = client->tx;
+         msg && niov < ARRAY_CARDINALITY(iov);
+         msg = msg->next) {
+        iov[niov].iov_base = msg->buffer + msg->bufferOffset;
+        iov[niov].iov_len = msg->bufferLength - msg->bufferOffset;
+        niov++;
+        if (msg->nfds)
+            break;
+# if WITH_SASL
+        if (client->sasl)
+            break;
+# endif
+    }
+
+    ret = virNetSocketWriteV(client->sock, iov, niov);
+    if (ret <= 0)
+        return ret; /* -1 error, 0 = egain */
+
+    /* Spread the sent byte count over the messages it covered */
+    left = ret;
+    for (msg = client->tx; left; msg = msg->next) {
+        size_t chunk = msg->bufferLength - msg->bufferOffset;
+
+        if (chunk > left)
+            chunk = left;
+        msg->bufferOffset += chunk;
+        left -= chunk;
+    }
+#else /* WIN32 */
     ret = virNetSocketWrite(client->sock,
                             client->tx->buffer + client->tx->bufferOffset,
                             client->tx->bufferLength - client->tx->bufferOffset);
@@ -1322,6 +1465,7 @@ static ssize_t virNetServerClientWrite(virNetServerClientPtr client)
         return ret; /* -1 error, 0 = egain */
 
     client->tx->bufferOffset += ret;
+#endif /* WIN32 */
     return ret;
 }
 
@@ -1374,6 +1518,11 @@ virNetServerClientDispatchWrite(virNetServerClientPtr client)
             /* Get finished msg from head of tx queue */
             msg = virNetMessageQueueServe(&client->tx);
 
+            if (msg->header.type == VIR_NET_MESSAGE &&
+                msg->header.prog != KEEPALIVE_PROGRAM &&
+                client->ntxevents > 0)
+                client->ntxevents--;
+
             if (msg->tracked) {
                 client->nrequests--;
                 /* See if the recv queue is currently throttled */
@@ -1382,7 +1531,7 @@ virNetServerClientDispatchWrite(virNetServerClientPtr client)
                     /* Ready to recv more messages */
                     virNetMessageClear(msg);
                     msg->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
-                    if (VIR_ALLOC_N(msg->buffer, msg->bufferLength) < 0) {
+                    if (virNetMessageEnsureCapacity(msg, msg->bufferLength) < 0) {
                         virNetMessageFree(msg);
                         return;
                     }
@@ -1392,7 +1541,7 @@ virNetServerClientDispatchWrite(virNetServerClientPtr client)
                 }
             }
 
-            virNetMessageFree(msg);
+            virNetServerClientMessageRelease(client, msg);
 
             virNetServerClientUpdateEvent(client);
 
@@ -1481,6 +1630,20 @@ virNetServerClientSendMessageLocked(virNetServerClientPtr client,
 
     msg->donefds = 0;
     if (client->sock && !client->wantClose) {
+        /* Async events are fire & forget; a client which has stopped
+         * reading must not make the daemon buffer them without bound.
+         * Keepalive packets share the message type but are never
+         * dropped, since losing one tears the connection down. */
+        if (msg->header.type == VIR_NET_MESSAGE &&
+            msg->header.prog != KEEPALIVE_PROGRAM) {
+            if (client->ntxevents >= VIR_NET_SERVER_CLIENT_TX_EVENTS_MAX) {
+                if (client->ntxevents_dropped++ == 0)
+                    VIR_WARN("Event queue for client=%p is full, "
+                             "dropping events", client);
+                return -1;
+            }
+            client->ntxevents++;
+        }
         PROBE(RPC_SERVER_CLIENT_MSG_TX_QUEUE,
               "client=%p len=%zu prog=%u vers=%u proc=%u type=%u status=%u serial=%u",
               client, msg->bufferLength,
@@ -31,6 +31,7 @@
 #include "virlog.h"
 #include "virfile.h"
 #include "virthread.h"
+#include "virtime.h"
 
 #define VIR_FROM_THIS VIR_FROM_RPC
 
@@ -43,6 +44,9 @@ struct _virNetServerProgram {
     unsigned version;
     virNetServerProgramProcPtr procs;
     size_t nprocs;
+
+    virMutex statsLock;
+    virNetServerProgramProcStatsPtr stats;
 };
 
 
@@ -81,6 +85,18 @@ virNetServerProgramPtr virNetServerProgramNew(unsigned program,
     prog->procs = procs;
     prog->nprocs = nprocs;
 
+    if (virMutexInit(&prog->statsLock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot initialize mutex"));
+        virObjectUnref(prog);
+        return NULL;
+    }
+
+    if (VIR_ALLOC_N(prog->stats, nprocs) < 0) {
+        virObjectUnref(prog);
+        return NULL;
+    }
+
     VIR_DEBUG("prog=%p", prog);
 
     return prog;
@@ -99,6 +115,66 @@ int virNetServerProgramGetVersion(virNetServerProgramPtr prog)
 }
 
 
+size_t virNetServerProgramGetNProcs(virNetServerProgramPtr prog)
+{
+    return prog->nprocs;
+}
+
+
+int virNetServerProgramGetProcStats(virNetServerProgramPtr prog,
+                                    size_t procedure,
+                                    virNetServerProgramProcStatsPtr stats)
+{
+    if (procedure >= prog->nprocs) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("procedure %zu out of range"), procedure);
+        return -1;
+    }
+
+    virMutexLock(&prog->statsLock);
+    *stats = prog->stats[procedure];
+    virMutexUnlock(&prog->statsLock);
+    return 0;
+}
+
+
+static void
+virNetServerProgramRecordCall(virNetServerProgramPtr prog,
+                              int procedure,
+                              unsigned long long timeStart,
+                              unsigned long long queueWait,
+                              size_t bytesIn,
+                              size_t bytesOut,
+                              bool failed)
+{
+    virNetServerProgramProcStatsPtr stats;
+    unsigned long long now = 0;
+    unsigned long long elapsed = 0;
+
+    if (procedure < 0 || procedure >= prog->nprocs)
+        return;
+
+    ignore_value(virTimeMillisNowRaw(&now));
+    if (timeStart && now > timeStart)
+        elapsed = now - timeStart;
+
+    virMutexLock(&prog->statsLock);
+    stats = &prog->stats[procedure];
+    stats->calls++;
+    if (failed)
+        stats->errors++;
+    stats->timeTotal += elapsed;
+    if (elapsed > stats->timeMax)
+        stats->timeMax = elapsed;
+    stats->queueTotal += queueWait;
+    if (queueWait > stats->queueMax)
+        stats->queueMax = queueWait;
+    stats->bytesIn += bytesIn;
+    stats->bytesOut += bytesOut;
+    virMutexUnlock(&prog->statsLock);
+}
+
+
 int virNetServerProgramMatches(virNetServerProgramPtr prog,
                                virNetMessagePtr msg)
 {
@@ -374,10 +450,13 @@ virNetServerProgramDispatchCall(virNetServerProgramPtr prog,
     char *arg = NULL;
     char *ret = NULL;
     int rv = -1;
-    virNetServerProgramProcPtr dispatcher;
+    virNetServerProgramProcPtr dispatcher = NULL;
     virNetMessageError rerr;
     size_t i;
     virIdentityPtr identity = NULL;
+    unsigned long long timeStart = 0;
+    unsigned long long queueWait = 0;
+    size_t bytesIn = 0;
 
     memset(&rerr, 0, sizeof(rerr));
 
@@ -397,6 +476,11 @@ virNetServerProgramDispatchCall(virNetServerProgramPtr prog,
         goto error;
     }
 
+    bytesIn = msg->bufferLength;
+    ignore_value(virTimeMillisNowRaw(&timeStart));
+    if (msg->enqueueTime && timeStart > msg->enqueueTime)
+        queueWait = timeStart - msg->enqueueTime;
+
     /* If client is marked as needing auth, don't allow any RPC ops
      * which are except for authentication ones
      */
@@ -410,10 +494,11 @@ virNetServerProgramDispatchCall(virNetServerProgramPtr prog,
         goto error;
     }
 
-    if (VIR_ALLOC_N(arg, dispatcher->arg_len) < 0)
-        goto error;
-    if (VIR_ALLOC_N(ret, dispatcher->ret_len) < 0)
+    /* The argument and return structures are opaque blobs to us, so
+     * carve both out of a single allocation per call */
+    if (VIR_ALLOC_N(arg, dispatcher->arg_len + dispatcher->ret_len) < 0)
         goto error;
+    ret = arg + dispatcher->arg_len;
 
     if (virNetMessageDecodePayload(msg, dispatcher->arg_filter, arg) < 0)
         goto error;
@@ -487,9 +572,13 @@ virNetServerProgramDispatchCall(virNetServerProgramPtr prog,
 
     xdr_free(dispatcher->ret_filter, ret);
     VIR_FREE(arg);
-    VIR_FREE(ret);
 
     virObjectUnref(identity);
+
+    virNetServerProgramRecordCall(prog, msg->header.proc, timeStart,
+                                  queueWait, bytesIn, msg->bufferLength,
+                                  false);
+
     /* Put reply on end of tx queue to send out  */
     return virNetServerClientSendMessage(client, msg);
 
@@ -498,8 +587,12 @@ virNetServerProgramDispatchCall(virNetServerProgramPtr prog,
      * RPC error message we can send back to the client */
     rv = virNetServerProgramSendReplyError(prog, client, msg, &rerr, &msg->header);
 
+    if (dispatcher)
+        virNetServerProgramRecordCall(prog, msg->header.proc, timeStart,
+                                      queueWait, bytesIn, msg->bufferLength,
+                                      true);
+
     VIR_FREE(arg);
-    VIR_FREE(ret);
     virObjectUnref(identity);
 
     return rv;
@@ -548,6 +641,56 @@ int virNetServerProgramSendStreamData(virNetServerProgramPtr prog,
 }
 
 
-void virNetServerProgramDispose(void *obj ATTRIBUTE_UNUSED)
+/* Encode the header of a VIR_NET_CONTINUE stream data packet into
+ * @msg and reserve room for up to @len payload bytes, returning a
+ * pointer to the payload area. This lets callers produce the payload
+ * directly in the transmit buffer (e.g. read from a stream straight
+ * into it) and avoid staging it in an intermediate buffer; the
+ * message must be completed with
+ * virNetServerProgramSendPreparedStreamData afterwards. */
+char *virNetServerProgramPrepareStreamData(virNetServerProgramPtr prog,
+                                           virNetMessagePtr msg,
+                                           int procedure,
+                                           unsigned int serial,
+                                           size_t len)
+{
+    VIR_DEBUG("msg=%p len=%zu", msg, len);
+
+    msg->header.prog = prog->program;
+    msg->header.vers = prog->version;
+    msg->header.proc = procedure;
+    msg->header.type = VIR_NET_STREAM;
+    msg->header.serial = serial;
+    msg->header.status = VIR_NET_CONTINUE;
+
+    if (virNetMessageEncodeHeader(msg) < 0)
+        return NULL;
+
+    return virNetMessageReservePayloadRaw(msg, len);
+}
+
+
+/* Queue a stream data packet prepared via
+ * virNetServerProgramPrepareStreamData for transmission; @len is the
+ * number of payload bytes actually produced, with 0 signalling a read
+ * EOF to the client just as for virNetServerProgramSendStreamData. */
+int virNetServerProgramSendPreparedStreamData(virNetServerClientPtr client,
+                                              virNetMessagePtr msg,
+                                              size_t len)
+{
+    if (virNetMessageCommitPayloadRaw(msg, len) < 0)
+        return -1;
+
+    VIR_DEBUG("Total %zu", msg->bufferLength);
+
+    return virNetServerClientSendMessage(client, msg);
+}
+
+
+void virNetServerProgramDispose(void *obj)
 {
+    virNetServerProgramPtr prog = obj;
+
+    VIR_FREE(prog->stats);
+    virMutexDestroy(&prog->statsLock);
 }
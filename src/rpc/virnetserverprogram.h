@@ -60,12 +60,33 @@ struct _virNetServerProgramProc {
     unsigned int priority;
 };
 
+typedef struct _virNetServerProgramProcStats virNetServerProgramProcStats;
+typedef virNetServerProgramProcStats *virNetServerProgramProcStatsPtr;
+
+/* Per procedure dispatch counters; times are in milliseconds */
+struct _virNetServerProgramProcStats {
+    unsigned long long calls;
+    unsigned long long errors;
+    unsigned long long timeTotal;
+    unsigned long long timeMax;
+    unsigned long long queueTotal;
+    unsigned long long queueMax;
+    unsigned long long bytesIn;
+    unsigned long long bytesOut;
+};
+
 virNetServerProgramPtr virNetServerProgramNew(unsigned program,
                                               unsigned version,
                                               virNetServerProgramProcPtr procs,
                                               size_t nprocs);
 
 int virNetServerProgramGetID(virNetServerProgramPtr prog);
+
+size_t virNetServerProgramGetNProcs(virNetServerProgramPtr prog);
+
+int virNetServerProgramGetProcStats(virNetServerProgramPtr prog,
+                                    size_t procedure,
+                                    virNetServerProgramProcStatsPtr stats);
 int virNetServerProgramGetVersion(virNetServerProgramPtr prog);
 
 unsigned int virNetServerProgramGetPriority(virNetServerProgramPtr prog,
@@ -104,4 +125,14 @@ int virNetServerProgramSendStreamData(virNetServerProgramPtr prog,
                                       const char *data,
                                       size_t len);
 
+char *virNetServerProgramPrepareStreamData(virNetServerProgramPtr prog,
+                                           virNetMessagePtr msg,
+                                           int procedure,
+                                           unsigned int serial,
+                                           size_t len);
+
+int virNetServerProgramSendPreparedStreamData(virNetServerClientPtr client,
+                                              virNetMessagePtr msg,
+                                              size_t len);
+
 #endif /* __VIR_NET_SERVER_PROGRAM_H__ */
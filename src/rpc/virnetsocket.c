@@ -25,6 +25,9 @@
 
 #include <sys/stat.h>
 #include <sys/socket.h>
+#ifndef WIN32
+# include <sys/uio.h>
+#endif
 #include <unistd.h>
 #include <sys/wait.h>
 #include <signal.h>
@@ -94,6 +97,14 @@ struct _virNetSocket {
     char *remoteAddrStrSASL;
     char *remoteAddrStrURI;
 
+    /* Readahead for the plain socket path: one read() pulls in
+     * whatever the kernel has buffered, so an RPC framing header and
+     * the message body behind it cost a single syscall instead of
+     * one each */
+    char *readahead;
+    size_t readaheadLength;
+    size_t readaheadOffset;
+
 #if WITH_GNUTLS
     virNetTLSSessionPtr tlsSession;
 #endif
@@ -107,6 +118,12 @@ struct _virNetSocket {
     const char *saslEncoded;
     size_t saslEncodedLength;
     size_t saslEncodedOffset;
+    size_t saslEncodedRawLength;
+
+    /* Reused wire read buffer, sized to the SASL max buffer
+     * size on first use */
+    char *saslReadBuf;
+    size_t saslReadBufSize;
 #endif
 #if WITH_SSH2
     virNetSSHSessionPtr sshSession;
@@ -1342,6 +1359,7 @@ void virNetSocketDispose(void *obj)
 #endif
 #if WITH_SASL
     virObjectUnref(sock->saslSession);
+    VIR_FREE(sock->saslReadBuf);
 #endif
 
 #if WITH_SSH2
@@ -1358,6 +1376,7 @@ void virNetSocketDispose(void *obj)
 
     virProcessAbort(sock->pid);
 
+    VIR_FREE(sock->readahead);
     VIR_FREE(sock->localAddrStrSASL);
     VIR_FREE(sock->remoteAddrStrSASL);
     VIR_FREE(sock->remoteAddrStrURI);
@@ -1691,6 +1710,8 @@ bool virNetSocketHasCachedData(virNetSocketPtr sock ATTRIBUTE_UNUSED)
     if (sock->saslDecoded)
         hasCached = true;
 #endif
+    if (sock->readaheadLength > sock->readaheadOffset)
+        hasCached = true;
     virObjectUnlock(sock);
     return hasCached;
 }
@@ -1740,10 +1761,15 @@ bool virNetSocketHasPendingData(virNetSocketPtr sock ATTRIBUTE_UNUSED)
 }
 
 
+#define VIR_NET_SOCKET_READAHEAD_BYTES 16384
+
 static ssize_t virNetSocketReadWire(virNetSocketPtr sock, char *buf, size_t len)
 {
     char *errout = NULL;
     ssize_t ret;
+    char *dst = buf;
+    size_t want = len;
+    bool readahead = false;
 
 #if WITH_SSH2
     if (sock->sshSession)
@@ -1755,6 +1781,39 @@ static ssize_t virNetSocketReadWire(virNetSocketPtr sock, char *buf, size_t len)
         return virNetSocketLibsshRead(sock, buf, len);
 #endif
 
+    /* Data left over from a previous wire read; short returns are
+     * fine since all callers cope with partial reads */
+    if (sock->readaheadLength) {
+        size_t avail = sock->readaheadLength - sock->readaheadOffset;
+
+        if (avail > len)
+            avail = len;
+        memcpy(buf, sock->readahead + sock->readaheadOffset, avail);
+        sock->readaheadOffset += avail;
+        if (sock->readaheadOffset == sock->readaheadLength)
+            sock->readaheadOffset = sock->readaheadLength = 0;
+        return avail;
+    }
+
+    /* Small reads (typically the 4 byte framing header) go via the
+     * readahead buffer; bulk payload reads keep going straight into
+     * the caller's buffer to avoid an extra copy.  TLS does its own
+     * record buffering, so leave that path alone */
+#if WITH_GNUTLS
+    if (!sock->tlsSession && len < VIR_NET_SOCKET_READAHEAD_BYTES)
+        readahead = true;
+#else
+    if (len < VIR_NET_SOCKET_READAHEAD_BYTES)
+        readahead = true;
+#endif
+    if (readahead) {
+        if (!sock->readahead &&
+            VIR_ALLOC_N(sock->readahead, VIR_NET_SOCKET_READAHEAD_BYTES) < 0)
+            return -1;
+        dst = sock->readahead;
+        want = VIR_NET_SOCKET_READAHEAD_BYTES;
+    }
+
  reread:
 #if WITH_GNUTLS
     if (sock->tlsSession &&
@@ -1763,7 +1822,7 @@ static ssize_t virNetSocketReadWire(virNetSocketPtr sock, char *buf, size_t len)
         ret = virNetTLSSessionRead(sock->tlsSession, buf, len);
     } else {
 #endif
-        ret = read(sock->fd, buf, len);
+        ret = read(sock->fd, dst, want);
 #if WITH_GNUTLS
     }
 #endif
@@ -1773,6 +1832,17 @@ static ssize_t virNetSocketReadWire(virNetSocketPtr sock, char *buf, size_t len)
     if ((ret < 0) && (errno == EAGAIN))
         return 0;
 
+    if (readahead && ret > 0) {
+        if ((size_t)ret > len) {
+            memcpy(buf, sock->readahead, len);
+            sock->readaheadLength = ret;
+            sock->readaheadOffset = len;
+            ret = len;
+        } else {
+            memcpy(buf, sock->readahead, ret);
+        }
+    }
+
     if (ret <= 0 &&
         sock->errfd != -1 &&
         virFileReadLimFD(sock->errfd, 1024, &errout) >= 0 &&
@@ -1860,23 +1930,24 @@ static ssize_t virNetSocketReadSASL(virNetSocketPtr sock, char *buf, size_t len)
     /* Need to read some more data off the wire */
     if (sock->saslDecoded == NULL) {
         ssize_t encodedLen = virNetSASLSessionGetMaxBufSize(sock->saslSession);
-        char *encoded;
-        if (VIR_ALLOC_N(encoded, encodedLen) < 0)
-            return -1;
-        encodedLen = virNetSocketReadWire(sock, encoded, encodedLen);
 
-        if (encodedLen <= 0) {
-            VIR_FREE(encoded);
-            return encodedLen;
+        /* The max buffer size can grow when the security layer is
+         * negotiated, so check the scratch buffer is still big enough */
+        if (sock->saslReadBufSize < (size_t)encodedLen) {
+            if (VIR_REALLOC_N(sock->saslReadBuf, encodedLen) < 0)
+                return -1;
+            sock->saslReadBufSize = encodedLen;
         }
 
+        encodedLen = virNetSocketReadWire(sock, sock->saslReadBuf, encodedLen);
+
+        if (encodedLen <= 0)
+            return encodedLen;
+
         if (virNetSASLSessionDecode(sock->saslSession,
-                                    encoded, encodedLen,
-                                    &sock->saslDecoded, &sock->saslDecodedLength) < 0) {
-            VIR_FREE(encoded);
+                                    sock->saslReadBuf, encodedLen,
+                                    &sock->saslDecoded, &sock->saslDecodedLength) < 0)
             return -1;
-        }
-        VIR_FREE(encoded);
 
         sock->saslDecodedOffset = 0;
     }
@@ -1917,6 +1988,7 @@ static ssize_t virNetSocketWriteSASL(virNetSocketPtr sock, const char *buf, size
                                     &sock->saslEncodedLength) < 0)
             return -1;
 
+        sock->saslEncodedRawLength = tosend;
         sock->saslEncodedOffset = 0;
     }
 
@@ -1933,11 +2005,13 @@ static ssize_t virNetSocketWriteSASL(virNetSocketPtr sock, const char *buf, size
 
     /* Sent all encoded, so update raw buffer to indicate completion */
     if (sock->saslEncodedOffset == sock->saslEncodedLength) {
+        ssize_t done = sock->saslEncodedRawLength;
         sock->saslEncoded = NULL;
         sock->saslEncodedOffset = sock->saslEncodedLength = 0;
+        sock->saslEncodedRawLength = 0;
 
         /* Mark as complete, so caller detects completion */
-        return tosend;
+        return done;
     } else {
         /* Still have stuff pending in saslEncoded buffer.
          * Pretend to caller that we didn't send any yet.
@@ -1947,6 +2021,64 @@ static ssize_t virNetSocketWriteSASL(virNetSocketPtr sock, const char *buf, size
         return 0;
     }
 }
+
+
+# ifndef WIN32
+/*
+ * Like virNetSocketWriteSASL, but gathers a whole vector of
+ * plaintext buffers into one SASL packet, so a queue of small
+ * messages shares a single crypto + framing round instead of
+ * paying it per message.
+ */
+static ssize_t virNetSocketWriteVSASL(virNetSocketPtr sock,
+                                      const struct iovec *iov,
+                                      size_t niov)
+{
+    ssize_t ret;
+
+    /* Not got any pending encoded data, so we need to encode raw stuff */
+    if (sock->saslEncoded == NULL) {
+        ssize_t consumed;
+
+        if ((consumed = virNetSASLSessionEncodeV(sock->saslSession,
+                                                 iov, niov,
+                                                 &sock->saslEncoded,
+                                                 &sock->saslEncodedLength)) < 0)
+            return -1;
+
+        sock->saslEncodedRawLength = consumed;
+        sock->saslEncodedOffset = 0;
+    }
+
+    /* Send some of the encoded stuff out on the wire */
+    ret = virNetSocketWriteWire(sock,
+                                sock->saslEncoded + sock->saslEncodedOffset,
+                                sock->saslEncodedLength - sock->saslEncodedOffset);
+
+    if (ret <= 0)
+        return ret; /* -1 error, 0 == egain */
+
+    /* Note how much we sent */
+    sock->saslEncodedOffset += ret;
+
+    /* Sent all encoded, so report how much plaintext was covered */
+    if (sock->saslEncodedOffset == sock->saslEncodedLength) {
+        ssize_t done = sock->saslEncodedRawLength;
+        sock->saslEncoded = NULL;
+        sock->saslEncodedOffset = sock->saslEncodedLength = 0;
+        sock->saslEncodedRawLength = 0;
+
+        return done;
+    } else {
+        /* Still have stuff pending in saslEncoded buffer.
+         * Pretend to caller that we didn't send any yet.
+         * The caller will then retry with the same vector
+         * shortly, which lets us finish saslEncoded.
+         */
+        return 0;
+    }
+}
+# endif /* !WIN32 */
 #endif
 
 ssize_t virNetSocketRead(virNetSocketPtr sock, char *buf, size_t len)
@@ -1979,6 +2111,80 @@ ssize_t virNetSocketWrite(virNetSocketPtr sock, const char *buf, size_t len)
 }
 
 
+#ifndef WIN32
+/*
+ * Send several buffers in a single vectored write, so a burst of
+ * queued messages does not turn into one write() syscall per message.
+ * Plain sockets get a real writev() and SASL gathers the vector into
+ * one encoded packet; the remaining encoding layers (TLS, SSH)
+ * consume one buffer at a time, so with those active only the first
+ * buffer is sent and the caller simply makes less progress per call.
+ * Returns bytes sent, 0 on EAGAIN, -1 on error; a short count may
+ * span several of the supplied buffers.
+ */
+ssize_t virNetSocketWriteV(virNetSocketPtr sock,
+                           const struct iovec *iov,
+                           size_t niov)
+{
+    bool vectored = true;
+    ssize_t ret;
+
+    if (niov == 0)
+        return 0;
+
+    virObjectLock(sock);
+
+# if WITH_SSH2
+    if (sock->sshSession)
+        vectored = false;
+# endif
+# if WITH_LIBSSH
+    if (sock->libsshSession)
+        vectored = false;
+# endif
+# if WITH_GNUTLS
+    if (sock->tlsSession)
+        vectored = false;
+# endif
+# if WITH_SASL
+    if (sock->saslSession)
+        vectored = false;
+# endif
+
+    if (niov > 1 && vectored) {
+     rewrite:
+        ret = writev(sock->fd, iov, niov);
+        if (ret < 0) {
+            if (errno == EINTR)
+                goto rewrite;
+            if (errno == EAGAIN) {
+                ret = 0;
+            } else {
+                virReportSystemError(errno, "%s",
+                                     _("Cannot write data"));
+                ret = -1;
+            }
+        } else if (ret == 0) {
+            virReportSystemError(EIO, "%s",
+                                 _("End of file while writing data"));
+            ret = -1;
+        }
+    } else {
+# if WITH_SASL
+        if (sock->saslSession)
+            ret = virNetSocketWriteVSASL(sock, iov, niov);
+        else
+# endif
+            ret = virNetSocketWriteWire(sock, iov[0].iov_base,
+                                        iov[0].iov_len);
+    }
+
+    virObjectUnlock(sock);
+    return ret;
+}
+#endif /* !WIN32 */
+
+
 /*
  * Returns 1 if an FD was sent, 0 if it would block, -1 on error
  */
@@ -24,6 +24,10 @@
 #ifndef __VIR_NET_SOCKET_H__
 # define __VIR_NET_SOCKET_H__
 
+# ifndef WIN32
+#  include <sys/uio.h>
+# endif
+
 # include "virsocketaddr.h"
 # include "vircommand.h"
 # ifdef WITH_GNUTLS
@@ -145,6 +149,11 @@ int virNetSocketSetBlocking(virNetSocketPtr sock,
 
 ssize_t virNetSocketRead(virNetSocketPtr sock, char *buf, size_t len);
 ssize_t virNetSocketWrite(virNetSocketPtr sock, const char *buf, size_t len);
+# ifndef WIN32
+ssize_t virNetSocketWriteV(virNetSocketPtr sock,
+                           const struct iovec *iov,
+                           size_t niov);
+# endif
 
 int virNetSocketSendFD(virNetSocketPtr sock, int fd);
 int virNetSocketRecvFD(virNetSocketPtr sock, int *fd);
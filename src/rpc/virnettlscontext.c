@@ -61,6 +61,11 @@ struct _virNetTLSContext {
 
     gnutls_certificate_credentials_t x509cred;
     gnutls_dh_params_t dhParams;
+    /* Key used to encrypt session tickets handed out to clients,
+     * allowing them to resume without a full handshake. Only set
+     * for server contexts; rotated naturally with context lifetime */
+    gnutls_datum_t ticketKey;
+    bool haveTicketKey;
 
     bool isServer;
     bool requireValidCert;
@@ -752,6 +757,22 @@ static virNetTLSContextPtr virNetTLSContextNew(const char *cacert,
 
         gnutls_certificate_set_dh_params(ctxt->x509cred,
                                          ctxt->dhParams);
+
+        /* Session ticket support lets frequently reconnecting
+         * clients resume instead of paying the full handshake each
+         * time. A resumed handshake does not re-send the client
+         * certificate, so tickets are only handed out when client
+         * certificates are not being verified; cert authenticated
+         * deployments keep doing full handshakes. Failure here just
+         * means every handshake is a full one */
+#if HAVE_GNUTLS_SESSION_TICKET_KEY_GENERATE
+        if (!requireValidCert) {
+            if (gnutls_session_ticket_key_generate(&ctxt->ticketKey) == 0)
+                ctxt->haveTicketKey = true;
+            else
+                VIR_WARN("Unable to generate TLS session ticket key");
+        }
+#endif
     }
 
     ctxt->requireValidCert = requireValidCert;
@@ -1149,6 +1170,10 @@ void virNetTLSContextDispose(void *obj)
           "ctxt=%p", ctxt);
 
     VIR_FREE(ctxt->priority);
+    if (ctxt->haveTicketKey) {
+        memset(ctxt->ticketKey.data, 0, ctxt->ticketKey.size);
+        gnutls_free(ctxt->ticketKey.data);
+    }
     gnutls_dh_params_deinit(ctxt->dhParams);
     gnutls_certificate_free_credentials(ctxt->x509cred);
 }
@@ -1182,6 +1207,102 @@ virNetTLSSessionPull(void *opaque, void *buf, size_t len)
 }
 
 
+/* Cache of session resumption data from completed client handshakes,
+ * keyed by server hostname. The remote driver creates a fresh TLS
+ * context per connection, so this deliberately lives at process
+ * scope: a management client polling a fleet of hosts resumes each
+ * reconnect instead of paying a full handshake every time. Slots are
+ * recycled round-robin once the cache is full. */
+#define VIR_NET_TLS_SESSION_CACHE_SIZE 64
+
+typedef struct _virNetTLSSessionCacheEntry virNetTLSSessionCacheEntry;
+struct _virNetTLSSessionCacheEntry {
+    char *hostname;
+    gnutls_datum_t data;
+};
+
+static virMutex virNetTLSSessionCacheLock = VIR_MUTEX_INITIALIZER;
+static virNetTLSSessionCacheEntry virNetTLSSessionCache[VIR_NET_TLS_SESSION_CACHE_SIZE];
+static size_t virNetTLSSessionCacheNext;
+
+
+/* Caller must hold virNetTLSSessionCacheLock */
+static virNetTLSSessionCacheEntry *
+virNetTLSSessionCacheFind(const char *hostname)
+{
+    size_t i;
+
+    for (i = 0; i < VIR_NET_TLS_SESSION_CACHE_SIZE; i++) {
+        if (virNetTLSSessionCache[i].hostname &&
+            STREQ(virNetTLSSessionCache[i].hostname, hostname))
+            return &virNetTLSSessionCache[i];
+    }
+
+    return NULL;
+}
+
+
+/* Try to resume an earlier session against @hostname; harmless if
+ * nothing is cached or the server refuses, the handshake simply
+ * falls back to a full one */
+static void
+virNetTLSSessionTryResume(virNetTLSSessionPtr sess)
+{
+    virNetTLSSessionCacheEntry *entry;
+
+    if (!sess->hostname)
+        return;
+
+    virMutexLock(&virNetTLSSessionCacheLock);
+    if ((entry = virNetTLSSessionCacheFind(sess->hostname))) {
+        if (gnutls_session_set_data(sess->session,
+                                    entry->data.data,
+                                    entry->data.size) < 0)
+            VIR_DEBUG("Failed to set cached session data for %s",
+                      sess->hostname);
+    }
+    virMutexUnlock(&virNetTLSSessionCacheLock);
+}
+
+
+/* Stash the resumption data of a freshly completed client handshake,
+ * replacing any previous entry for the same host */
+static void
+virNetTLSSessionSaveResumeData(virNetTLSSessionPtr sess)
+{
+    virNetTLSSessionCacheEntry *entry;
+    gnutls_datum_t data;
+    char *hostname = NULL;
+
+    if (!sess->hostname)
+        return;
+
+    if (gnutls_session_get_data2(sess->session, &data) != 0)
+        return;
+
+    virMutexLock(&virNetTLSSessionCacheLock);
+
+    if (!(entry = virNetTLSSessionCacheFind(sess->hostname))) {
+        if (VIR_STRDUP_QUIET(hostname, sess->hostname) < 0) {
+            gnutls_free(data.data);
+            goto cleanup;
+        }
+        entry = &virNetTLSSessionCache[virNetTLSSessionCacheNext];
+        virNetTLSSessionCacheNext =
+            (virNetTLSSessionCacheNext + 1) % VIR_NET_TLS_SESSION_CACHE_SIZE;
+        VIR_FREE(entry->hostname);
+        entry->hostname = hostname;
+    }
+
+    if (entry->data.data)
+        gnutls_free(entry->data.data);
+    entry->data = data;
+
+ cleanup:
+    virMutexUnlock(&virNetTLSSessionCacheLock);
+}
+
+
 virNetTLSSessionPtr virNetTLSSessionNew(virNetTLSContextPtr ctxt,
                                         const char *hostname)
 {
@@ -1232,6 +1353,22 @@ virNetTLSSessionPtr virNetTLSSessionNew(virNetTLSContextPtr ctxt,
         gnutls_certificate_server_set_request(sess->session, GNUTLS_CERT_REQUEST);
 
         gnutls_dh_set_prime_bits(sess->session, DH_BITS);
+
+#if HAVE_GNUTLS_SESSION_TICKET_KEY_GENERATE
+        if (ctxt->haveTicketKey &&
+            (err = gnutls_session_ticket_enable_server(sess->session,
+                                                       &ctxt->ticketKey)) != 0)
+            VIR_WARN("Unable to enable TLS session tickets: %s",
+                     gnutls_strerror(err));
+#endif
+    } else {
+#if HAVE_GNUTLS_SESSION_TICKET_KEY_GENERATE
+        if ((err = gnutls_session_ticket_enable_client(sess->session)) != 0)
+            VIR_WARN("Unable to enable TLS session tickets: %s",
+                     gnutls_strerror(err));
+#endif
+
+        virNetTLSSessionTryResume(sess);
     }
 
     gnutls_transport_set_ptr(sess->session, sess);
@@ -1339,7 +1476,10 @@ int virNetTLSSessionHandshake(virNetTLSSessionPtr sess)
     VIR_DEBUG("Ret=%d", ret);
     if (ret == 0) {
         sess->handshakeComplete = true;
-        VIR_DEBUG("Handshake is complete");
+        VIR_DEBUG("Handshake is complete, resumed=%d",
+                  gnutls_session_is_resumed(sess->session));
+        if (!sess->isServer)
+            virNetTLSSessionSaveResumeData(sess);
         goto cleanup;
     }
     if (ret == GNUTLS_E_INTERRUPTED || ret == GNUTLS_E_AGAIN) {
@@ -39,6 +39,8 @@
 #include "virscsivhost.h"
 #include "virstoragefile.h"
 #include "virstring.h"
+#include "virthread.h"
+#include "virthreadpool.h"
 #include "virutil.h"
 
 #define VIR_FROM_THIS VIR_FROM_SECURITY
@@ -349,6 +351,328 @@ virSecurityDACSetOwnershipInternal(virSecurityDACDataPtr priv,
 }
 
 
+/* Upper bound on threads chown()ing queued paths on transaction
+ * commit; committing is dominated by filesystem round trips, so a
+ * small pool is enough to overlap them.
+ */
+#define SECURITY_DAC_CHOWN_WORKERS 8
+
+typedef struct _virSecurityDACChownItem virSecurityDACChownItem;
+typedef virSecurityDACChownItem *virSecurityDACChownItemPtr;
+struct _virSecurityDACChownItem {
+    char *path;
+    virStorageSourcePtr src;
+    uid_t uid;
+    gid_t gid;
+};
+
+typedef struct _virSecurityDACChownList virSecurityDACChownList;
+typedef virSecurityDACChownList *virSecurityDACChownListPtr;
+struct _virSecurityDACChownList {
+    virSecurityDACDataPtr priv;
+    virSecurityDACChownItemPtr *items;
+    size_t nItems;
+};
+
+typedef struct _virSecurityDACChownState virSecurityDACChownState;
+typedef virSecurityDACChownState *virSecurityDACChownStatePtr;
+struct _virSecurityDACChownState {
+    virSecurityDACChownListPtr list;
+    virMutex lock;
+    virCond cond;
+    size_t nDone;
+    virErrorPtr err;            /* first error hit by a worker */
+};
+
+static virThreadLocal chownList;
+
+static void
+virSecurityDACChownListFree(void *opaque)
+{
+    virSecurityDACChownListPtr list = opaque;
+    size_t i;
+
+    if (!list)
+        return;
+
+    for (i = 0; i < list->nItems; i++) {
+        VIR_FREE(list->items[i]->path);
+        VIR_FREE(list->items[i]);
+    }
+    VIR_FREE(list->items);
+    VIR_FREE(list);
+}
+
+static int
+virSecurityDACOnceInit(void)
+{
+    return virThreadLocalInit(&chownList,
+                              virSecurityDACChownListFree);
+}
+
+VIR_ONCE_GLOBAL_INIT(virSecurityDAC);
+
+/**
+ * virSecurityDACTransactionAppend:
+ * @path: path to chown
+ * @src: disk source to chown
+ * @uid: user ID
+ * @gid: group ID
+ *
+ * Appends an entry onto the transaction list of the current thread,
+ * if there is any transaction in progress.
+ *
+ * Returns: 1 in case of successful append,
+ *          0 if there is no transaction,
+ *         -1 otherwise.
+ */
+static int
+virSecurityDACTransactionAppend(const char *path,
+                                virStorageSourcePtr src,
+                                uid_t uid,
+                                gid_t gid)
+{
+    virSecurityDACChownItemPtr item = NULL;
+    virSecurityDACChownListPtr list = virThreadLocalGet(&chownList);
+
+    if (!list)
+        return 0;
+
+    if (VIR_ALLOC(item) < 0)
+        return -1;
+
+    if (VIR_STRDUP(item->path, path) < 0)
+        goto error;
+
+    item->src = src;
+    item->uid = uid;
+    item->gid = gid;
+
+    if (VIR_APPEND_ELEMENT(list->items, list->nItems, item) < 0)
+        goto error;
+
+    return 1;
+
+ error:
+    if (item)
+        VIR_FREE(item->path);
+    VIR_FREE(item);
+    return -1;
+}
+
+
+static void
+virSecurityDACChownWorker(void *jobdata, void *opaque)
+{
+    virSecurityDACChownItemPtr item = jobdata;
+    virSecurityDACChownStatePtr state = opaque;
+    int rc;
+
+    rc = virSecurityDACSetOwnershipInternal(state->list->priv,
+                                            item->src,
+                                            item->path,
+                                            item->uid,
+                                            item->gid);
+
+    virMutexLock(&state->lock);
+    if (rc < 0 && !state->err)
+        state->err = virSaveLastError();
+    state->nDone++;
+    virCondSignal(&state->cond);
+    virMutexUnlock(&state->lock);
+}
+
+
+/**
+ * virSecurityDACTransactionRun:
+ * @list: list of chown items
+ *
+ * Chowns the queued paths. Since most of the time is spent waiting
+ * for the filesystem rather than on CPU, the items are spread over
+ * a small thread pool so that guests with many disks on network
+ * filesystems don't pay one round trip per path.
+ *
+ * Returns: 0 on success
+ *         -1 otherwise (with the first encountered error reported).
+ */
+static int
+virSecurityDACTransactionRun(virSecurityDACChownListPtr list)
+{
+    virThreadPoolPtr pool = NULL;
+    virSecurityDACChownState state;
+    size_t nWorkers = SECURITY_DAC_CHOWN_WORKERS;
+    size_t nSent = 0;
+    size_t i;
+    int ret = -1;
+
+    if (list->nItems == 0)
+        return 0;
+
+    if (nWorkers > list->nItems)
+        nWorkers = list->nItems;
+
+    if (nWorkers < 2) {
+        virSecurityDACChownItemPtr item = list->items[0];
+
+        return virSecurityDACSetOwnershipInternal(list->priv,
+                                                  item->src,
+                                                  item->path,
+                                                  item->uid,
+                                                  item->gid);
+    }
+
+    memset(&state, 0, sizeof(state));
+    state.list = list;
+
+    if (virMutexInit(&state.lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to initialize transaction mutex"));
+        return -1;
+    }
+
+    if (virCondInit(&state.cond) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to initialize transaction condition"));
+        virMutexDestroy(&state.lock);
+        return -1;
+    }
+
+    if (!(pool = virThreadPoolNew(0, nWorkers, 0,
+                                  virSecurityDACChownWorker,
+                                  &state)))
+        goto cleanup;
+
+    for (i = 0; i < list->nItems; i++) {
+        if (virThreadPoolSendJob(pool, 0, list->items[i]) < 0)
+            break;
+        nSent++;
+    }
+
+    /* The pool does not wait for pending jobs on free, so wait for
+     * the workers ourselves before tearing anything down */
+    virMutexLock(&state.lock);
+    while (state.nDone < nSent)
+        ignore_value(virCondWait(&state.cond, &state.lock));
+    virMutexUnlock(&state.lock);
+
+    if (nSent < list->nItems) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to queue ownership change job"));
+        goto cleanup;
+    }
+
+    if (state.err) {
+        virSetError(state.err);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virThreadPoolFree(pool);
+    virFreeError(state.err);
+    virCondDestroy(&state.cond);
+    virMutexDestroy(&state.lock);
+    return ret;
+}
+
+
+/**
+ * virSecurityDACTransactionStart:
+ * @mgr: security manager
+ *
+ * Starts a new transaction. In transaction nothing is chown()-ed until
+ * virSecurityDACTransactionCommit is called.
+ *
+ * Returns 0 on success,
+ *        -1 otherwise.
+ */
+static int
+virSecurityDACTransactionStart(virSecurityManagerPtr mgr)
+{
+    virSecurityDACDataPtr priv = virSecurityManagerGetPrivateData(mgr);
+    virSecurityDACChownListPtr list;
+
+    if (virSecurityDACInitialize() < 0)
+        return -1;
+
+    if (virThreadLocalGet(&chownList)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Another relabel transaction is already started"));
+        return -1;
+    }
+
+    if (VIR_ALLOC(list) < 0)
+        return -1;
+
+    list->priv = priv;
+
+    if (virThreadLocalSet(&chownList, list) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to set thread local variable"));
+        VIR_FREE(list);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * virSecurityDACTransactionCommit:
+ * @mgr: security manager
+ *
+ * Performs all the chown()-s on the list of paths that the current
+ * transaction consists of. The transaction is finished regardless of
+ * the return value; on failure some paths may already be chown()-ed
+ * and it's up to the caller to restore the labels.
+ *
+ * Returns: 0 on success,
+ *         -1 otherwise.
+ */
+static int
+virSecurityDACTransactionCommit(virSecurityManagerPtr mgr ATTRIBUTE_UNUSED)
+{
+    virSecurityDACChownListPtr list;
+    int ret;
+
+    if (!(list = virThreadLocalGet(&chownList))) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("No transaction is set"));
+        return -1;
+    }
+
+    if (virThreadLocalSet(&chownList, NULL) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to clear thread local variable"));
+        virSecurityDACChownListFree(list);
+        return -1;
+    }
+
+    ret = virSecurityDACTransactionRun(list);
+    virSecurityDACChownListFree(list);
+    return ret;
+}
+
+/**
+ * virSecurityDACTransactionAbort:
+ * @mgr: security manager
+ *
+ * Cancels and frees any out standing transaction.
+ */
+static void
+virSecurityDACTransactionAbort(virSecurityManagerPtr mgr ATTRIBUTE_UNUSED)
+{
+    virSecurityDACChownListPtr list;
+
+    if (!(list = virThreadLocalGet(&chownList)))
+        return;
+
+    if (virThreadLocalSet(&chownList, NULL) < 0)
+        VIR_DEBUG("Unable to clear thread local variable");
+    virSecurityDACChownListFree(list);
+}
+
+
 static int
 virSecurityDACSetOwnership(virSecurityDACDataPtr priv,
                            virStorageSourcePtr src,
@@ -357,6 +681,14 @@ virSecurityDACSetOwnership(virSecurityDACDataPtr priv,
                            gid_t gid)
 {
     struct stat sb;
+    int rc;
+
+    /* If there is a transaction in progress, just append the path to
+     * it and defer the actual chown() until commit */
+    if ((rc = virSecurityDACTransactionAppend(path, src, uid, gid)) < 0)
+        return -1;
+    else if (rc > 0)
+        return 0;
 
     if (!path && src && src->path &&
         virStorageSourceIsLocalStorage(src))
@@ -400,6 +732,11 @@ virSecurityDACRestoreFileLabelInternal(virSecurityDACDataPtr priv,
             return 0;
     }
 
+    if ((rv = virSecurityDACTransactionAppend(path, src, uid, gid)) < 0)
+        return -1;
+    else if (rv > 0)
+        return 0;
+
     return virSecurityDACSetOwnershipInternal(priv, src, path, uid, gid);
 }
 
@@ -1626,6 +1963,10 @@ virSecurityDriver virSecurityDriverDAC = {
 
     .preFork                            = virSecurityDACPreFork,
 
+    .transactionStart                   = virSecurityDACTransactionStart,
+    .transactionCommit                  = virSecurityDACTransactionCommit,
+    .transactionAbort                   = virSecurityDACTransactionAbort,
+
     .domainSecurityVerify               = virSecurityDACVerify,
 
     .domainSetSecurityDiskLabel         = virSecurityDACSetDiskLabel,
@@ -47,6 +47,8 @@
 #include "virconf.h"
 #include "virtpm.h"
 #include "virstring.h"
+#include "virthread.h"
+#include "virthreadpool.h"
 
 #define VIR_FROM_THIS VIR_FROM_SECURITY
 
@@ -86,6 +88,42 @@ virSecuritySELinuxRestoreTPMFileLabelInt(virSecurityManagerPtr mgr,
                                          virDomainDefPtr def,
                                          virDomainTPMDefPtr tpm);
 
+/* The daemon's own process context cannot change while it runs, and
+ * generating the labels for a domain start asks for it several times,
+ * so only pay for the getcon_raw() round trip once */
+static char *virSecuritySELinuxProcessContext;
+static virMutex virSecuritySELinuxProcessContextLock = VIR_MUTEX_INITIALIZER;
+
+/* Base contexts with our own user (and role, for process labels)
+ * stamped in, keyed by the base context, so each combination is only
+ * computed once. Entries live for the lifetime of the daemon */
+static virHashTablePtr virSecuritySELinuxContextTemplates;
+static virMutex virSecuritySELinuxContextTemplatesLock = VIR_MUTEX_INITIALIZER;
+
+static char *
+virSecuritySELinuxGetProcessContext(void)
+{
+    char *ret = NULL;
+
+    virMutexLock(&virSecuritySELinuxProcessContextLock);
+    if (!virSecuritySELinuxProcessContext) {
+        security_context_t con = NULL;
+
+        if (getcon_raw(&con) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("Unable to get current process SELinux context"));
+        } else {
+            ignore_value(VIR_STRDUP(virSecuritySELinuxProcessContext, con));
+            freecon(con);
+        }
+    }
+    if (virSecuritySELinuxProcessContext)
+        ignore_value(VIR_STRDUP(ret, virSecuritySELinuxProcessContext));
+    virMutexUnlock(&virSecuritySELinuxProcessContextLock);
+
+    return ret;
+}
+
 
 /*
  * Returns 0 on success, 1 if already reserved, or -1 on fatal error
@@ -187,18 +225,15 @@ virSecuritySELinuxMCSGetProcessRange(char **sens,
                                      int *catMin,
                                      int *catMax)
 {
-    security_context_t ourSecContext = NULL;
+    char *ourSecContext = NULL;
     context_t ourContext = NULL;
     char *cat = NULL;
     char *tmp;
     const char *contextRange;
     int ret = -1;
 
-    if (getcon_raw(&ourSecContext) < 0) {
-        virReportSystemError(errno, "%s",
-                             _("Unable to get current process SELinux context"));
+    if (!(ourSecContext = virSecuritySELinuxGetProcessContext()))
         goto cleanup;
-    }
     if (!(ourContext = context_new(ourSecContext))) {
         virReportSystemError(errno,
                              _("Unable to parse current SELinux context '%s'"),
@@ -281,7 +316,7 @@ virSecuritySELinuxMCSGetProcessRange(char **sens,
  cleanup:
     if (ret < 0)
         VIR_FREE(*sens);
-    freecon(ourSecContext);
+    VIR_FREE(ourSecContext);
     context_free(ourContext);
     return ret;
 }
@@ -332,49 +367,95 @@ virSecuritySELinuxGenNewContext(const char *basecontext,
     context_t context = NULL;
     char *ret = NULL;
     char *str;
-    security_context_t ourSecContext = NULL;
+    char *ourSecContext = NULL;
     context_t ourContext = NULL;
+    char *key = NULL;
+    char *built = NULL;
+    const char *template = NULL;
 
     VIR_DEBUG("basecontext=%s mcs=%s isObjectContext=%d",
               basecontext, mcs, isObjectContext);
 
-    if (getcon_raw(&ourSecContext) < 0) {
-        virReportSystemError(errno, "%s",
-                             _("Unable to get current process SELinux context"));
+    if (virAsprintf(&key, "%c:%s",
+                    isObjectContext ? 'o' : 'p', basecontext) < 0)
         goto cleanup;
-    }
-    if (!(ourContext = context_new(ourSecContext))) {
-        virReportSystemError(errno,
-                             _("Unable to parse current SELinux context '%s'"),
-                             ourSecContext);
-        goto cleanup;
-    }
-    VIR_DEBUG("process=%s", ourSecContext);
 
-    if (!(context = context_new(basecontext))) {
-        virReportSystemError(errno,
-                             _("Unable to parse base SELinux context '%s'"),
-                             basecontext);
-        goto cleanup;
-    }
+    virMutexLock(&virSecuritySELinuxContextTemplatesLock);
+    if (virSecuritySELinuxContextTemplates)
+        template = virHashLookup(virSecuritySELinuxContextTemplates, key);
+    virMutexUnlock(&virSecuritySELinuxContextTemplatesLock);
 
-    if (context_user_set(context,
-                         context_user_get(ourContext)) != 0) {
-        virReportSystemError(errno,
-                             _("Unable to set SELinux context user '%s'"),
-                             context_user_get(ourContext));
-        goto cleanup;
+    if (!template) {
+        if (!(ourSecContext = virSecuritySELinuxGetProcessContext()))
+            goto cleanup;
+        if (!(ourContext = context_new(ourSecContext))) {
+            virReportSystemError(errno,
+                                 _("Unable to parse current SELinux context '%s'"),
+                                 ourSecContext);
+            goto cleanup;
+        }
+        VIR_DEBUG("process=%s", ourSecContext);
+
+        if (!(context = context_new(basecontext))) {
+            virReportSystemError(errno,
+                                 _("Unable to parse base SELinux context '%s'"),
+                                 basecontext);
+            goto cleanup;
+        }
+
+        if (context_user_set(context,
+                             context_user_get(ourContext)) != 0) {
+            virReportSystemError(errno,
+                                 _("Unable to set SELinux context user '%s'"),
+                                 context_user_get(ourContext));
+            goto cleanup;
+        }
+
+        if (!isObjectContext &&
+            context_role_set(context,
+                             context_role_get(ourContext)) != 0) {
+            virReportSystemError(errno,
+                                 _("Unable to set SELinux context role '%s'"),
+                                 context_role_get(ourContext));
+            goto cleanup;
+        }
+
+        if (!(str = context_str(context))) {
+            virReportSystemError(errno, "%s",
+                                 _("Unable to format SELinux context"));
+            goto cleanup;
+        }
+        if (VIR_STRDUP(built, str) < 0)
+            goto cleanup;
+        context_free(context);
+        context = NULL;
+
+        virMutexLock(&virSecuritySELinuxContextTemplatesLock);
+        if (!virSecuritySELinuxContextTemplates)
+            virSecuritySELinuxContextTemplates =
+                virHashCreate(4, virHashValueFree);
+        if (virSecuritySELinuxContextTemplates &&
+            (template = virHashLookup(virSecuritySELinuxContextTemplates,
+                                      key))) {
+            /* somebody else built the same template in the meantime */
+        } else if (virSecuritySELinuxContextTemplates &&
+                   virHashAddEntry(virSecuritySELinuxContextTemplates,
+                                   key, built) == 0) {
+            template = built;
+            built = NULL; /* now owned by the cache */
+        } else {
+            /* caching failed; use this call's copy regardless */
+            template = built;
+        }
+        virMutexUnlock(&virSecuritySELinuxContextTemplatesLock);
     }
 
-    if (!isObjectContext &&
-        context_role_set(context,
-                         context_role_get(ourContext)) != 0) {
+    if (!(context = context_new(template))) {
         virReportSystemError(errno,
-                             _("Unable to set SELinux context role '%s'"),
-                             context_role_get(ourContext));
+                             _("Unable to parse base SELinux context '%s'"),
+                             template);
         goto cleanup;
     }
-
     if (context_range_set(context, mcs) != 0) {
         virReportSystemError(errno,
                              _("Unable to set SELinux context MCS '%s'"),
@@ -390,7 +471,9 @@ virSecuritySELinuxGenNewContext(const char *basecontext,
         goto cleanup;
     VIR_DEBUG("Generated context '%s'",  ret);
  cleanup:
-    freecon(ourSecContext);
+    VIR_FREE(key);
+    VIR_FREE(built);
+    VIR_FREE(ourSecContext);
     context_free(ourContext);
     context_free(context);
     return ret;
@@ -943,11 +1026,340 @@ virSecuritySELinuxSetFileconHelper(const char *path, char *tcon,
     return 0;
 }
 
+/* Upper bound on threads relabelling queued paths on transaction
+ * commit; committing is dominated by filesystem round trips, so a
+ * small pool is enough to overlap them.
+ */
+#define SECURITY_SELINUX_CONTEXT_WORKERS 8
+
+typedef struct _virSecuritySELinuxContextItem virSecuritySELinuxContextItem;
+typedef virSecuritySELinuxContextItem *virSecuritySELinuxContextItemPtr;
+struct _virSecuritySELinuxContextItem {
+    char *path;
+    char *tcon;
+    bool optional;
+};
+
+typedef struct _virSecuritySELinuxContextList virSecuritySELinuxContextList;
+typedef virSecuritySELinuxContextList *virSecuritySELinuxContextListPtr;
+struct _virSecuritySELinuxContextList {
+    bool privileged;
+    virSecuritySELinuxContextItemPtr *items;
+    size_t nItems;
+};
+
+typedef struct _virSecuritySELinuxContextState virSecuritySELinuxContextState;
+typedef virSecuritySELinuxContextState *virSecuritySELinuxContextStatePtr;
+struct _virSecuritySELinuxContextState {
+    virSecuritySELinuxContextListPtr list;
+    virMutex lock;
+    virCond cond;
+    size_t nDone;
+    virErrorPtr err;            /* first error hit by a worker */
+};
+
+static virThreadLocal contextList;
+
+static void
+virSecuritySELinuxContextListFree(void *opaque)
+{
+    virSecuritySELinuxContextListPtr list = opaque;
+    size_t i;
+
+    if (!list)
+        return;
+
+    for (i = 0; i < list->nItems; i++) {
+        VIR_FREE(list->items[i]->path);
+        VIR_FREE(list->items[i]->tcon);
+        VIR_FREE(list->items[i]);
+    }
+    VIR_FREE(list->items);
+    VIR_FREE(list);
+}
+
+static int
+virSecuritySELinuxContextListOnceInit(void)
+{
+    return virThreadLocalInit(&contextList,
+                              virSecuritySELinuxContextListFree);
+}
+
+VIR_ONCE_GLOBAL_INIT(virSecuritySELinuxContextList);
+
+/**
+ * virSecuritySELinuxTransactionAppend:
+ * @path: path to relabel
+ * @tcon: target context
+ * @optional: whether to treat errors as fatal
+ *
+ * Appends an entry onto the transaction list of the current thread,
+ * if there is any transaction in progress.
+ *
+ * Returns: 1 in case of successful append,
+ *          0 if there is no transaction,
+ *         -1 otherwise.
+ */
+static int
+virSecuritySELinuxTransactionAppend(const char *path,
+                                    char *tcon,
+                                    bool optional)
+{
+    virSecuritySELinuxContextItemPtr item = NULL;
+    virSecuritySELinuxContextListPtr list = virThreadLocalGet(&contextList);
+
+    if (!list)
+        return 0;
+
+    if (VIR_ALLOC(item) < 0)
+        return -1;
+
+    if (VIR_STRDUP(item->path, path) < 0 ||
+        VIR_STRDUP(item->tcon, tcon) < 0)
+        goto error;
+
+    item->optional = optional;
+
+    if (VIR_APPEND_ELEMENT(list->items, list->nItems, item) < 0)
+        goto error;
+
+    return 1;
+
+ error:
+    if (item) {
+        VIR_FREE(item->path);
+        VIR_FREE(item->tcon);
+    }
+    VIR_FREE(item);
+    return -1;
+}
+
+
+static void
+virSecuritySELinuxContextWorker(void *jobdata, void *opaque)
+{
+    virSecuritySELinuxContextItemPtr item = jobdata;
+    virSecuritySELinuxContextStatePtr state = opaque;
+    int rc;
+
+    rc = virSecuritySELinuxSetFileconHelper(item->path,
+                                            item->tcon,
+                                            item->optional,
+                                            state->list->privileged);
+
+    virMutexLock(&state->lock);
+    if (rc < 0 && !state->err)
+        state->err = virSaveLastError();
+    state->nDone++;
+    virCondSignal(&state->cond);
+    virMutexUnlock(&state->lock);
+}
+
+
+/**
+ * virSecuritySELinuxTransactionRun:
+ * @list: list of context items
+ *
+ * Relabels the queued paths. Since most of the time is spent waiting
+ * for the filesystem rather than on CPU, the items are spread over
+ * a small thread pool so that guests with many disks on network
+ * filesystems don't pay one round trip per path.
+ *
+ * Returns: 0 on success
+ *         -1 otherwise (with the first encountered error reported).
+ */
+static int
+virSecuritySELinuxTransactionRun(virSecuritySELinuxContextListPtr list)
+{
+    virThreadPoolPtr pool = NULL;
+    virSecuritySELinuxContextState state;
+    size_t nWorkers = SECURITY_SELINUX_CONTEXT_WORKERS;
+    size_t nSent = 0;
+    size_t i;
+    int ret = -1;
+
+    if (list->nItems == 0)
+        return 0;
+
+    if (nWorkers > list->nItems)
+        nWorkers = list->nItems;
+
+    if (nWorkers < 2) {
+        virSecuritySELinuxContextItemPtr item = list->items[0];
+
+        if (virSecuritySELinuxSetFileconHelper(item->path,
+                                               item->tcon,
+                                               item->optional,
+                                               list->privileged) < 0)
+            return -1;
+        return 0;
+    }
+
+    memset(&state, 0, sizeof(state));
+    state.list = list;
+
+    if (virMutexInit(&state.lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to initialize transaction mutex"));
+        return -1;
+    }
+
+    if (virCondInit(&state.cond) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to initialize transaction condition"));
+        virMutexDestroy(&state.lock);
+        return -1;
+    }
+
+    if (!(pool = virThreadPoolNew(0, nWorkers, 0,
+                                  virSecuritySELinuxContextWorker,
+                                  &state)))
+        goto cleanup;
+
+    for (i = 0; i < list->nItems; i++) {
+        if (virThreadPoolSendJob(pool, 0, list->items[i]) < 0)
+            break;
+        nSent++;
+    }
+
+    /* The pool does not wait for pending jobs on free, so wait for
+     * the workers ourselves before tearing anything down */
+    virMutexLock(&state.lock);
+    while (state.nDone < nSent)
+        ignore_value(virCondWait(&state.cond, &state.lock));
+    virMutexUnlock(&state.lock);
+
+    if (nSent < list->nItems) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to queue relabel job"));
+        goto cleanup;
+    }
+
+    if (state.err) {
+        virSetError(state.err);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virThreadPoolFree(pool);
+    virFreeError(state.err);
+    virCondDestroy(&state.cond);
+    virMutexDestroy(&state.lock);
+    return ret;
+}
+
+
+/**
+ * virSecuritySELinuxTransactionStart:
+ * @mgr: security manager
+ *
+ * Starts a new transaction. In transaction nothing is relabelled until
+ * virSecuritySELinuxTransactionCommit is called.
+ *
+ * Returns 0 on success,
+ *        -1 otherwise.
+ */
+static int
+virSecuritySELinuxTransactionStart(virSecurityManagerPtr mgr)
+{
+    virSecuritySELinuxContextListPtr list;
+
+    if (virSecuritySELinuxContextListInitialize() < 0)
+        return -1;
+
+    if (virThreadLocalGet(&contextList)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Another relabel transaction is already started"));
+        return -1;
+    }
+
+    if (VIR_ALLOC(list) < 0)
+        return -1;
+
+    list->privileged = virSecurityManagerGetPrivileged(mgr);
+
+    if (virThreadLocalSet(&contextList, list) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to set thread local variable"));
+        VIR_FREE(list);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * virSecuritySELinuxTransactionCommit:
+ * @mgr: security manager
+ *
+ * Relabels all the paths that the current transaction consists of. The
+ * transaction is finished regardless of the return value; on failure
+ * some paths may already be relabelled and it's up to the caller to
+ * restore the labels.
+ *
+ * Returns: 0 on success,
+ *         -1 otherwise.
+ */
+static int
+virSecuritySELinuxTransactionCommit(virSecurityManagerPtr mgr ATTRIBUTE_UNUSED)
+{
+    virSecuritySELinuxContextListPtr list;
+    int ret;
+
+    if (!(list = virThreadLocalGet(&contextList))) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("No transaction is set"));
+        return -1;
+    }
+
+    if (virThreadLocalSet(&contextList, NULL) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to clear thread local variable"));
+        virSecuritySELinuxContextListFree(list);
+        return -1;
+    }
+
+    ret = virSecuritySELinuxTransactionRun(list);
+    virSecuritySELinuxContextListFree(list);
+    return ret;
+}
+
+/**
+ * virSecuritySELinuxTransactionAbort:
+ * @mgr: security manager
+ *
+ * Cancels and frees any out standing transaction.
+ */
+static void
+virSecuritySELinuxTransactionAbort(virSecurityManagerPtr mgr ATTRIBUTE_UNUSED)
+{
+    virSecuritySELinuxContextListPtr list;
+
+    if (!(list = virThreadLocalGet(&contextList)))
+        return;
+
+    if (virThreadLocalSet(&contextList, NULL) < 0)
+        VIR_DEBUG("Unable to clear thread local variable");
+    virSecuritySELinuxContextListFree(list);
+}
+
+
 static int
 virSecuritySELinuxSetFileconOptional(virSecurityManagerPtr mgr,
                                      const char *path, char *tcon)
 {
     bool privileged = virSecurityManagerGetPrivileged(mgr);
+    int rc;
+
+    /* If there is a transaction in progress, just append the path to
+     * it and defer the actual relabel until commit */
+    if ((rc = virSecuritySELinuxTransactionAppend(path, tcon, true)) < 0)
+        return -1;
+    else if (rc > 0)
+        return 0;
+
     return virSecuritySELinuxSetFileconHelper(path, tcon, true, privileged);
 }
 
@@ -956,6 +1368,13 @@ virSecuritySELinuxSetFilecon(virSecurityManagerPtr mgr,
                              const char *path, char *tcon)
 {
     bool privileged = virSecurityManagerGetPrivileged(mgr);
+    int rc;
+
+    if ((rc = virSecuritySELinuxTransactionAppend(path, tcon, false)) < 0)
+        return -1;
+    else if (rc > 0)
+        return 0;
+
     return virSecuritySELinuxSetFileconHelper(path, tcon, false, privileged);
 }
 
@@ -2667,6 +3086,10 @@ virSecurityDriver virSecurityDriverSELinux = {
     .getModel                           = virSecuritySELinuxSecurityGetModel,
     .getDOI                             = virSecuritySELinuxSecurityGetDOI,
 
+    .transactionStart                   = virSecuritySELinuxTransactionStart,
+    .transactionCommit                  = virSecuritySELinuxTransactionCommit,
+    .transactionAbort                   = virSecuritySELinuxTransactionAbort,
+
     .domainSecurityVerify               = virSecuritySELinuxSecurityVerify,
 
     .domainSetSecurityDiskLabel         = virSecuritySELinuxSetDiskLabel,
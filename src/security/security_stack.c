@@ -137,6 +137,56 @@ virSecurityStackPreFork(virSecurityManagerPtr mgr)
     return rc;
 }
 
+static int
+virSecurityStackTransactionStart(virSecurityManagerPtr mgr)
+{
+    virSecurityStackDataPtr priv = virSecurityManagerGetPrivateData(mgr);
+    virSecurityStackItemPtr item = priv->itemsHead;
+
+    for (; item; item = item->next) {
+        if (virSecurityManagerTransactionStart(item->securityManager) < 0)
+            goto rollback;
+    }
+
+    return 0;
+
+ rollback:
+    {
+        virSecurityStackItemPtr tmp = priv->itemsHead;
+
+        for (; tmp && tmp != item; tmp = tmp->next)
+            virSecurityManagerTransactionAbort(tmp->securityManager);
+    }
+    return -1;
+}
+
+static int
+virSecurityStackTransactionCommit(virSecurityManagerPtr mgr)
+{
+    virSecurityStackDataPtr priv = virSecurityManagerGetPrivateData(mgr);
+    virSecurityStackItemPtr item = priv->itemsHead;
+    int rc = 0;
+
+    /* Commit all nested transactions even if one of them fails; the
+     * caller is going to restore all labels on failure anyway */
+    for (; item; item = item->next) {
+        if (virSecurityManagerTransactionCommit(item->securityManager) < 0)
+            rc = -1;
+    }
+
+    return rc;
+}
+
+static void
+virSecurityStackTransactionAbort(virSecurityManagerPtr mgr)
+{
+    virSecurityStackDataPtr priv = virSecurityManagerGetPrivateData(mgr);
+    virSecurityStackItemPtr item = priv->itemsHead;
+
+    for (; item; item = item->next)
+        virSecurityManagerTransactionAbort(item->securityManager);
+}
+
 static int
 virSecurityStackVerify(virSecurityManagerPtr mgr,
                        virDomainDefPtr def)
@@ -612,6 +662,10 @@ virSecurityDriver virSecurityDriverStack = {
 
     .preFork                            = virSecurityStackPreFork,
 
+    .transactionStart                   = virSecurityStackTransactionStart,
+    .transactionCommit                  = virSecurityStackTransactionCommit,
+    .transactionAbort                   = virSecurityStackTransactionAbort,
+
     .domainSecurityVerify               = virSecurityStackVerify,
 
     .domainSetSecurityDiskLabel         = virSecurityStackSetDiskLabel,
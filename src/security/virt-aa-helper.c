@@ -203,11 +203,13 @@ parserCommand(const char *profile_name, const char cmd)
 }
 
 /*
- * Update the dynamic files
+ * Update the dynamic files. @changed is set to false when the file on
+ * disk already had exactly the requested content, so the caller can
+ * skip reloading a profile that cannot have changed.
  */
 static int
 update_include_file(const char *include_file, const char *included_files,
-                    bool append)
+                    bool append, bool *changed)
 {
     int rc = -1;
     int plen, flen = 0;
@@ -217,6 +219,8 @@ update_include_file(const char *include_file, const char *included_files,
     const char *warning =
          "# DO NOT EDIT THIS FILE DIRECTLY. IT IS MANAGED BY LIBVIRT.\n";
 
+    *changed = false;
+
     if (virFileExists(include_file)) {
         flen = virFileReadAll(include_file, MAX_FILE_LEN, &existing);
         if (flen < 0)
@@ -263,6 +267,7 @@ update_include_file(const char *include_file, const char *included_files,
         vah_error(NULL, 0, _("failed to close or write to profile"));
         goto cleanup;
     }
+    *changed = true;
     rc = 0;
 
  cleanup:
@@ -1320,6 +1325,7 @@ main(int argc, char **argv)
         }
     } else if (ctl->cmd == 'c' || ctl->cmd == 'r') {
         char *included_files = NULL;
+        bool included_files_changed = true;
 
         if (ctl->cmd == 'c' && virFileExists(profile))
             vah_error(ctl, 1, _("profile exists"));
@@ -1368,7 +1374,8 @@ main(int argc, char **argv)
             rc = 0;
         } else if ((rc = update_include_file(include_file,
                                              included_files,
-                                             ctl->append)) != 0) {
+                                             ctl->append,
+                                             &included_files_changed)) != 0) {
             goto cleanup;
         }
 
@@ -1396,9 +1403,13 @@ main(int argc, char **argv)
         }
 
         if (rc == 0 && !ctl->dryrun) {
+            /* when replacing, the profile body is static and only the
+             * include file carries dynamic content, so an unchanged
+             * include file means the loaded profile is already up to
+             * date and the costly apparmor_parser run can be skipped */
             if (ctl->cmd == 'c')
                 rc = parserLoad(ctl->uuid);
-            else
+            else if (included_files_changed)
                 rc = parserReplace(ctl->uuid);
 
             /* cleanup */
@@ -43,6 +43,11 @@ typedef int (*virStorageBackendBuildPool)(virConnectPtr conn,
                                           unsigned int flags);
 typedef int (*virStorageBackendRefreshPool)(virConnectPtr conn,
                                             virStoragePoolObjPtr pool);
+/* Returns 1 if the existing volume list is still current and only the
+ * pool level statistics were refreshed, 0 if the caller must clear the
+ * volumes and do a full refreshPool, -1 on error */
+typedef int (*virStorageBackendRefreshPoolCached)(virConnectPtr conn,
+                                                  virStoragePoolObjPtr pool);
 typedef int (*virStorageBackendStopPool)(virConnectPtr conn,
                                          virStoragePoolObjPtr pool);
 typedef int (*virStorageBackendDeletePool)(virConnectPtr conn,
@@ -171,6 +176,7 @@ struct _virStorageBackend {
     virStorageBackendStartPool startPool;
     virStorageBackendBuildPool buildPool;
     virStorageBackendRefreshPool refreshPool; /* Must be non-NULL */
+    virStorageBackendRefreshPoolCached refreshPoolCached;
     virStorageBackendStopPool stopPool;
     virStorageBackendDeletePool deletePool;
 
@@ -33,6 +33,10 @@
 #include <unistd.h>
 #include <string.h>
 
+#if HAVE_SYS_INOTIFY_H
+# include <sys/inotify.h>
+#endif
+
 #include <libxml/parser.h>
 #include <libxml/tree.h>
 #include <libxml/xpath.h>
@@ -51,6 +55,8 @@
 #include "virfile.h"
 #include "virlog.h"
 #include "virstring.h"
+#include "virthread.h"
+#include "virutil.h"
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
 
@@ -882,9 +888,325 @@ virStorageBackendFileSystemBuild(virConnectPtr conn ATTRIBUTE_UNUSED,
 }
 
 
+#if HAVE_SYS_INOTIFY_H
+
+/* Directory change tracking: each active directory pool can carry an
+ * inotify watch on its target path. As long as no event arrived the
+ * volume list from the last refresh is still current and a pool
+ * refresh only needs to update the pool level statistics. Watches
+ * are only used for local directory pools; changes made on the far
+ * side of a network filesystem never raise inotify events, so FS and
+ * NETFS pools always do a full re-scan. */
+static virMutex fsPoolWatchLock = VIR_MUTEX_INITIALIZER;
+static int fsPoolWatchFD = -1;      /* inotify descriptor */
+static int fsPoolWatchHandle = -1;  /* event loop handle */
+static int *fsPoolStaleWatches;     /* watches with pending changes */
+static size_t fsPoolNStaleWatches;
+static size_t fsPoolStaleWatchesAlloc;
+/* bumped whenever events may have been lost; invalidates all watches
+ * armed under an older generation */
+static unsigned long long fsPoolWatchOverflowGen;
+
+
+/* Caller must hold fsPoolWatchLock */
+static void
+virStorageBackendFileSystemMarkStale(int wd)
+{
+    size_t i;
+
+    for (i = 0; i < fsPoolNStaleWatches; i++) {
+        if (fsPoolStaleWatches[i] == wd)
+            return;
+    }
+
+    if (VIR_RESIZE_N_QUIET(fsPoolStaleWatches, fsPoolStaleWatchesAlloc,
+                           fsPoolNStaleWatches, 1) < 0) {
+        /* Cannot track the change; force everyone to re-scan */
+        fsPoolWatchOverflowGen++;
+        return;
+    }
+
+    fsPoolStaleWatches[fsPoolNStaleWatches++] = wd;
+}
+
+
+/* Caller must hold fsPoolWatchLock */
+static void
+virStorageBackendFileSystemClearStale(int wd)
+{
+    size_t i;
+
+    for (i = 0; i < fsPoolNStaleWatches; i++) {
+        if (fsPoolStaleWatches[i] == wd) {
+            fsPoolStaleWatches[i] =
+                fsPoolStaleWatches[--fsPoolNStaleWatches];
+            return;
+        }
+    }
+}
+
+
+static void
+virStorageBackendFileSystemWatchCallback(int watch ATTRIBUTE_UNUSED,
+                                         int fd,
+                                         int events ATTRIBUTE_UNUSED,
+                                         void *opaque ATTRIBUTE_UNUSED)
+{
+    char buf[1024];
+    struct inotify_event e;
+    int got;
+    char *tmp;
+
+ reread:
+    got = read(fd, buf, sizeof(buf));
+    if (got == -1) {
+        if (errno == EINTR)
+            goto reread;
+        return;
+    }
+
+    virMutexLock(&fsPoolWatchLock);
+    tmp = buf;
+    while (got) {
+        if (got < (int)sizeof(e))
+            break; /* bad */
+
+        memcpy(&e, tmp, sizeof(e));
+        tmp += sizeof(e);
+        got -= sizeof(e);
+
+        if (got < (int)e.len)
+            break;
+        tmp += e.len;
+        got -= e.len;
+
+        if (e.mask & IN_Q_OVERFLOW)
+            fsPoolWatchOverflowGen++;
+        else
+            virStorageBackendFileSystemMarkStale(e.wd);
+    }
+    virMutexUnlock(&fsPoolWatchLock);
+}
+
+
+/* Caller must hold fsPoolWatchLock */
+static int
+virStorageBackendFileSystemWatchInit(void)
+{
+    if (fsPoolWatchFD != -1)
+        return 0;
+
+    if ((fsPoolWatchFD = inotify_init()) < 0)
+        return -1;
+
+    if (virSetNonBlock(fsPoolWatchFD) < 0 ||
+        virSetCloseExec(fsPoolWatchFD) < 0)
+        goto error;
+
+    if ((fsPoolWatchHandle =
+         virEventAddHandle(fsPoolWatchFD,
+                           VIR_EVENT_HANDLE_READABLE,
+                           virStorageBackendFileSystemWatchCallback,
+                           NULL, NULL)) < 0)
+        goto error;
+
+    return 0;
+
+ error:
+    VIR_FORCE_CLOSE(fsPoolWatchFD);
+    fsPoolWatchFD = -1;
+    return -1;
+}
+
+
+/* (Re-)arm the directory watch for @pool; silently degrades to full
+ * re-scans on every refresh if inotify or the event loop are not
+ * usable. Adding a watch for an already watched path just refreshes
+ * the existing descriptor, which also revives watches the kernel
+ * dropped when the directory was removed and re-created. */
+static void
+virStorageBackendFileSystemWatchArm(virStoragePoolObjPtr pool)
+{
+    int wd;
+
+    if (pool->def->type != VIR_STORAGE_POOL_DIR)
+        return;
+
+    virMutexLock(&fsPoolWatchLock);
+
+    if (virStorageBackendFileSystemWatchInit() < 0)
+        goto cleanup;
+
+    wd = inotify_add_watch(fsPoolWatchFD, pool->def->target.path,
+                           IN_CREATE | IN_DELETE | IN_CLOSE_WRITE |
+                           IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB |
+                           IN_ONLYDIR);
+    if (wd < 0) {
+        if (pool->dirWatch >= 0)
+            virStorageBackendFileSystemClearStale(pool->dirWatch);
+        pool->dirWatch = -1;
+        goto cleanup;
+    }
+
+    if (pool->dirWatch >= 0 && pool->dirWatch != wd)
+        virStorageBackendFileSystemClearStale(pool->dirWatch);
+
+    pool->dirWatch = wd;
+    pool->dirWatchGen = fsPoolWatchOverflowGen;
+    virStorageBackendFileSystemClearStale(wd);
+
+ cleanup:
+    virMutexUnlock(&fsPoolWatchLock);
+}
+
+
+static void
+virStorageBackendFileSystemWatchDisarm(virStoragePoolObjPtr pool)
+{
+    virMutexLock(&fsPoolWatchLock);
+    if (pool->dirWatch >= 0) {
+        if (fsPoolWatchFD != -1)
+            ignore_value(inotify_rm_watch(fsPoolWatchFD, pool->dirWatch));
+        virStorageBackendFileSystemClearStale(pool->dirWatch);
+        pool->dirWatch = -1;
+    }
+    virMutexUnlock(&fsPoolWatchLock);
+}
+
+
+static int
+virStorageBackendFileSystemRefreshCached(virConnectPtr conn ATTRIBUTE_UNUSED,
+                                         virStoragePoolObjPtr pool)
+{
+    struct statvfs sb;
+    bool fresh = false;
+    size_t i;
+
+    virMutexLock(&fsPoolWatchLock);
+    if (pool->dirWatch >= 0 &&
+        pool->dirWatchGen == fsPoolWatchOverflowGen) {
+        fresh = true;
+        for (i = 0; i < fsPoolNStaleWatches; i++) {
+            if (fsPoolStaleWatches[i] == pool->dirWatch) {
+                fresh = false;
+                break;
+            }
+        }
+    }
+    virMutexUnlock(&fsPoolWatchLock);
+
+    if (!fresh)
+        return 0;
+
+    /* Volume list is unchanged, only the pool statistics can have
+     * moved; fall back to the full refresh for error reporting if
+     * even that fails */
+    if (statvfs(pool->def->target.path, &sb) < 0)
+        return 0;
+
+    pool->def->capacity = ((unsigned long long)sb.f_frsize *
+                           (unsigned long long)sb.f_blocks);
+    pool->def->available = ((unsigned long long)sb.f_bfree *
+                            (unsigned long long)sb.f_frsize);
+    pool->def->allocation = pool->def->capacity - pool->def->available;
+
+    VIR_DEBUG("Volume list of pool '%s' is unchanged, skipping re-scan",
+              pool->def->name);
+    return 1;
+}
+
+
+static int
+virStorageBackendDirectoryStop(virConnectPtr conn ATTRIBUTE_UNUSED,
+                               virStoragePoolObjPtr pool)
+{
+    virStorageBackendFileSystemWatchDisarm(pool);
+    return 0;
+}
+
+#else /* ! HAVE_SYS_INOTIFY_H */
+
+static void
+virStorageBackendFileSystemWatchArm(virStoragePoolObjPtr pool ATTRIBUTE_UNUSED)
+{
+}
+
+
+static void
+virStorageBackendFileSystemWatchDisarm(virStoragePoolObjPtr pool ATTRIBUTE_UNUSED)
+{
+}
+
+#endif /* ! HAVE_SYS_INOTIFY_H */
+
+
+/* Largest number of threads probing the volumes of a single pool
+ * concurrently. Big enough to hide per-file open+header-read latency
+ * on network filesystems, small enough not to monopolize the host */
+#define VIR_STORAGE_FS_REFRESH_MAX_THREADS 8
+
+typedef struct _virStorageBackendFSVolProbe virStorageBackendFSVolProbe;
+typedef virStorageBackendFSVolProbe *virStorageBackendFSVolProbePtr;
+struct _virStorageBackendFSVolProbe {
+    virStorageVolDefPtr vol;
+    int err;            /* virStorageBackendProbeTarget return value */
+    virErrorPtr error;  /* saved thread-local error when err == -1 */
+};
+
+typedef struct _virStorageBackendFSRefreshState virStorageBackendFSRefreshState;
+typedef virStorageBackendFSRefreshState *virStorageBackendFSRefreshStatePtr;
+struct _virStorageBackendFSRefreshState {
+    virMutex lock;
+    virStorageBackendFSVolProbePtr probes;
+    size_t nprobes;
+    size_t next;        /* next unclaimed entry in @probes */
+};
+
+
+/* Pull volumes off the shared list and probe them until none are
+ * left; runs in every worker thread and in the refreshing thread */
+static void
+virStorageBackendFileSystemRefreshWorker(void *opaque)
+{
+    virStorageBackendFSRefreshStatePtr state = opaque;
+    virStorageBackendFSVolProbePtr probe;
+    virStorageVolDefPtr vol;
+
+    for (;;) {
+        virMutexLock(&state->lock);
+        if (state->next == state->nprobes) {
+            virMutexUnlock(&state->lock);
+            break;
+        }
+        probe = &state->probes[state->next++];
+        virMutexUnlock(&state->lock);
+
+        vol = probe->vol;
+        probe->err = virStorageBackendProbeTarget(&vol->target,
+                                                  &vol->target.encryption);
+        if (probe->err == -1) {
+            probe->error = virSaveLastError();
+            continue;
+        }
+
+        if (probe->err != -2 && vol->target.backingStore) {
+            ignore_value(virStorageBackendUpdateVolTargetInfo(vol->target.backingStore,
+                                                              false,
+                                                              VIR_STORAGE_VOL_OPEN_DEFAULT, 0));
+            /* If this failed, the backing file is currently unavailable,
+             * the capacity, allocation, owner, group and mode are unknown.
+             * An error message was raised, but we just continue. */
+        }
+    }
+}
+
+
 /**
  * Iterate over the pool's directory and enumerate all disk images
- * within it. This is non-recursive.
+ * within it. This is non-recursive. The directory is read in one
+ * batch up front and the per-file format probing, which dominates
+ * refresh time on network filesystems, is spread over a bounded
+ * set of worker threads.
  */
 static int
 virStorageBackendFileSystemRefresh(virConnectPtr conn ATTRIBUTE_UNUSED,
@@ -896,15 +1218,31 @@ virStorageBackendFileSystemRefresh(virConnectPtr conn ATTRIBUTE_UNUSED,
     struct stat statbuf;
     virStorageVolDefPtr vol = NULL;
     virStorageSourcePtr target = NULL;
+    virStorageBackendFSRefreshState state;
+    size_t probesAlloc = 0;
+    virThreadPtr workers = NULL;
+    size_t nworkers = 0;
     int direrr;
     int fd = -1, ret = -1;
+    size_t i;
+
+    memset(&state, 0, sizeof(state));
+    if (virMutexInit(&state.lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to initialize mutex"));
+        return -1;
+    }
+
+    /* Arm the change watch before reading the directory, so anything
+     * modified while we scan marks the result stale straight away */
+    virStorageBackendFileSystemWatchArm(pool);
 
     if (virDirOpen(&dir, pool->def->target.path) < 0)
         goto cleanup;
 
+    /* First pass: enumerate the whole directory, deferring the
+     * expensive per-file probing to the workers below */
     while ((direrr = virDirRead(dir, &ent, pool->def->target.path)) > 0) {
-        int err;
-
         if (virStringHasControlChars(ent->d_name)) {
             VIR_WARN("Ignoring file with control characters under '%s'",
                      pool->def->target.path);
@@ -927,48 +1265,76 @@ virStorageBackendFileSystemRefresh(virConnectPtr conn ATTRIBUTE_UNUSED,
         if (VIR_STRDUP(vol->key, vol->target.path) < 0)
             goto cleanup;
 
-        if ((err = virStorageBackendProbeTarget(&vol->target,
-                                                &vol->target.encryption)) < 0) {
-            if (err == -2) {
-                /* Silently ignore non-regular files,
-                 * eg 'lost+found', dangling symbolic link */
-                virStorageVolDefFree(vol);
-                vol = NULL;
-                continue;
-            } else if (err == -3) {
-                /* The backing file is currently unavailable, its format is not
-                 * explicitly specified, the probe to auto detect the format
-                 * failed: continue with faked RAW format, since AUTO will
-                 * break virStorageVolTargetDefFormat() generating the line
-                 * <format type='...'/>. */
-            } else {
-                goto cleanup;
-            }
+        if (VIR_RESIZE_N(state.probes, probesAlloc, state.nprobes, 1) < 0)
+            goto cleanup;
+        state.probes[state.nprobes++].vol = vol;
+        vol = NULL;
+    }
+    if (direrr < 0)
+        goto cleanup;
+    VIR_DIR_CLOSE(dir);
+
+    /* Second pass: probe the volume targets in parallel. The
+     * refreshing thread takes part too, so the pool still gets
+     * refreshed even if no worker thread could be spawned */
+    if (state.nprobes > 1) {
+        size_t want = MIN(state.nprobes,
+                          VIR_STORAGE_FS_REFRESH_MAX_THREADS) - 1;
+
+        if (want && VIR_ALLOC_N(workers, want) < 0)
+            goto cleanup;
+
+        for (i = 0; i < want; i++) {
+            if (virThreadCreate(&workers[i], true,
+                                virStorageBackendFileSystemRefreshWorker,
+                                &state) < 0)
+                break;
+            nworkers++;
         }
+    }
 
-        /* directory based volume */
-        if (vol->target.format == VIR_STORAGE_FILE_DIR)
-            vol->type = VIR_STORAGE_VOL_DIR;
+    virStorageBackendFileSystemRefreshWorker(&state);
 
-        if (vol->target.format == VIR_STORAGE_FILE_PLOOP)
-            vol->type = VIR_STORAGE_VOL_PLOOP;
+    for (i = 0; i < nworkers; i++)
+        virThreadJoin(&workers[i]);
 
-        if (vol->target.backingStore) {
-            ignore_value(virStorageBackendUpdateVolTargetInfo(vol->target.backingStore,
-                                                              false,
-                                                              VIR_STORAGE_VOL_OPEN_DEFAULT, 0));
-            /* If this failed, the backing file is currently unavailable,
-             * the capacity, allocation, owner, group and mode are unknown.
-             * An error message was raised, but we just continue. */
+    /* Third pass: collect the probe results in directory order */
+    for (i = 0; i < state.nprobes; i++) {
+        virStorageBackendFSVolProbePtr probe = &state.probes[i];
+
+        if (probe->err == -2) {
+            /* Silently ignore non-regular files,
+             * eg 'lost+found', dangling symbolic link */
+            virStorageVolDefFree(probe->vol);
+            probe->vol = NULL;
+            continue;
+        } else if (probe->err == -1) {
+            if (probe->error)
+                virSetError(probe->error);
+            else
+                virReportError(VIR_ERR_INTERNAL_ERROR,
+                               _("cannot probe storage volume '%s'"),
+                               probe->vol->target.path);
+            goto cleanup;
         }
+        /* probe->err == -3 means the backing file is currently
+         * unavailable, its format is not explicitly specified, and
+         * the probe to auto detect the format failed: continue with
+         * faked RAW format, since AUTO will break
+         * virStorageVolTargetDefFormat() generating the line
+         * <format type='...'/>. */
+
+        /* directory based volume */
+        if (probe->vol->target.format == VIR_STORAGE_FILE_DIR)
+            probe->vol->type = VIR_STORAGE_VOL_DIR;
 
-        if (VIR_APPEND_ELEMENT(pool->volumes.objs, pool->volumes.count, vol) < 0)
+        if (probe->vol->target.format == VIR_STORAGE_FILE_PLOOP)
+            probe->vol->type = VIR_STORAGE_VOL_PLOOP;
+
+        if (VIR_APPEND_ELEMENT(pool->volumes.objs, pool->volumes.count,
+                               probe->vol) < 0)
             goto cleanup;
     }
-    if (direrr < 0)
-        goto cleanup;
-    VIR_DIR_CLOSE(dir);
-    vol = NULL;
 
     if (VIR_ALLOC(target))
         goto cleanup;
@@ -1017,8 +1383,17 @@ virStorageBackendFileSystemRefresh(virConnectPtr conn ATTRIBUTE_UNUSED,
     VIR_FORCE_CLOSE(fd);
     virStorageVolDefFree(vol);
     virStorageSourceFree(target);
-    if (ret < 0)
+    for (i = 0; i < state.nprobes; i++) {
+        virStorageVolDefFree(state.probes[i].vol);
+        virFreeError(state.probes[i].error);
+    }
+    VIR_FREE(state.probes);
+    VIR_FREE(workers);
+    virMutexDestroy(&state.lock);
+    if (ret < 0) {
         virStoragePoolObjClearVols(pool);
+        virStorageBackendFileSystemWatchDisarm(pool);
+    }
     return ret;
 }
 
@@ -1415,6 +1790,10 @@ virStorageBackend virStorageBackendDirectory = {
     .buildPool = virStorageBackendFileSystemBuild,
     .checkPool = virStorageBackendFileSystemCheck,
     .refreshPool = virStorageBackendFileSystemRefresh,
+#if HAVE_SYS_INOTIFY_H
+    .refreshPoolCached = virStorageBackendFileSystemRefreshCached,
+    .stopPool = virStorageBackendDirectoryStop,
+#endif
     .deletePool = virStorageBackendFileSystemDelete,
     .buildVol = virStorageBackendFileSystemVolBuild,
     .buildVolFrom = virStorageBackendFileSystemVolBuildFrom,
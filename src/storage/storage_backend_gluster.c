@@ -30,12 +30,19 @@
 #include "virlog.h"
 #include "virstoragefile.h"
 #include "virstring.h"
+#include "virthread.h"
 #include "viruri.h"
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
 
 VIR_LOG_INIT("storage.storage_backend_gluster");
 
+/* Number of concurrent workers probing volume metadata during a pool
+ * refresh. Each probe is an open/read/close of the image header, every
+ * one of them a network round trip, so a purely serial walk over a
+ * large pool stacks thousands of round trips back to back. */
+#define VIR_STORAGE_GLUSTER_REFRESH_THREADS 8
+
 struct _virStorageBackendGlusterState {
     glfs_t *vol;
 
@@ -188,7 +195,8 @@ virStorageBackendGlusterSetMetadata(virStorageBackendGlusterStatePtr state,
 {
     int ret = -1;
     char *path = NULL;
-    char *tmp;
+    char *uripath = NULL;
+    virURI uri;
 
     VIR_FREE(vol->key);
     VIR_FREE(vol->target.path);
@@ -206,18 +214,15 @@ virStorageBackendGlusterSetMetadata(virStorageBackendGlusterStatePtr state,
                     vol->name) < 0)
         goto cleanup;
 
-    tmp = state->uri->path;
-    if (virAsprintf(&state->uri->path, "/%s", path) < 0) {
-        state->uri->path = tmp;
+    /* Format the URI from a shallow copy with just the path swapped
+     * out, so the shared state, which the refresh workers use
+     * concurrently, is never modified */
+    uri = *state->uri;
+    if (virAsprintf(&uripath, "/%s", path) < 0)
         goto cleanup;
-    }
-    if (!(vol->target.path = virURIFormat(state->uri))) {
-        VIR_FREE(state->uri->path);
-        state->uri->path = tmp;
+    uri.path = uripath;
+    if (!(vol->target.path = virURIFormat(&uri)))
         goto cleanup;
-    }
-    VIR_FREE(state->uri->path);
-    state->uri->path = tmp;
 
     /* the path is unique enough to serve as a volume key */
     if (VIR_STRDUP(vol->key, vol->target.path) < 0)
@@ -227,6 +232,7 @@ virStorageBackendGlusterSetMetadata(virStorageBackendGlusterStatePtr state,
 
  cleanup:
     VIR_FREE(path);
+    VIR_FREE(uripath);
     return ret;
 }
 
@@ -336,6 +342,49 @@ virStorageBackendGlusterRefreshVol(virStorageBackendGlusterStatePtr state,
     return ret;
 }
 
+struct virStorageBackendGlusterEntry {
+    char *name;
+    struct stat st;
+};
+
+struct virStorageBackendGlusterRefreshData {
+    virStorageBackendGlusterStatePtr state;
+    struct virStorageBackendGlusterEntry *ents;
+    size_t nents;
+    virStorageVolDefPtr *vols;  /* one slot per entry, NULL when skipped */
+    size_t next;                /* next entry to probe */
+    virMutex lock;
+    virErrorPtr err;            /* first worker failure */
+};
+
+static void
+virStorageBackendGlusterRefreshWorker(void *opaque)
+{
+    struct virStorageBackendGlusterRefreshData *data = opaque;
+
+    for (;;) {
+        size_t i;
+
+        virMutexLock(&data->lock);
+        if (data->err || data->next == data->nents) {
+            virMutexUnlock(&data->lock);
+            break;
+        }
+        i = data->next++;
+        virMutexUnlock(&data->lock);
+
+        if (virStorageBackendGlusterRefreshVol(data->state,
+                                               data->ents[i].name,
+                                               &data->ents[i].st,
+                                               &data->vols[i]) < 0) {
+            virMutexLock(&data->lock);
+            if (!data->err)
+                data->err = virSaveLastError();
+            virMutexUnlock(&data->lock);
+        }
+    }
+}
+
 static int
 virStorageBackendGlusterRefreshPool(virConnectPtr conn ATTRIBUTE_UNUSED,
                                     virStoragePoolObjPtr pool)
@@ -352,6 +401,13 @@ virStorageBackendGlusterRefreshPool(virConnectPtr conn ATTRIBUTE_UNUSED,
     glfs_fd_t *dir = NULL;
     struct stat st;
     struct statvfs sb;
+    struct virStorageBackendGlusterRefreshData data;
+    virThreadPtr workers = NULL;
+    size_t nworkers = 0;
+    bool lock_initialized = false;
+    size_t i;
+
+    memset(&data, 0, sizeof(data));
 
     if (!(state = virStorageBackendGlusterOpen(pool)))
         goto cleanup;
@@ -377,16 +433,19 @@ virStorageBackendGlusterRefreshPool(virConnectPtr conn ATTRIBUTE_UNUSED,
         goto cleanup;
     }
     while (!(errno = glfs_readdirplus_r(dir, &st, &de.ent, &ent)) && ent) {
-        virStorageVolDefPtr vol;
-        int okay = virStorageBackendGlusterRefreshVol(state,
-                                                      ent->d_name, &st,
-                                                      &vol);
+        struct virStorageBackendGlusterEntry entry;
+
+        /* Skip '.' and '..' before queueing work for the probers */
+        if (STREQ(ent->d_name, ".") || STREQ(ent->d_name, ".."))
+            continue;
 
-        if (okay < 0)
+        entry.st = st;
+        if (VIR_STRDUP(entry.name, ent->d_name) < 0)
             goto cleanup;
-        if (vol && VIR_APPEND_ELEMENT(pool->volumes.objs, pool->volumes.count,
-                                      vol) < 0)
+        if (VIR_APPEND_ELEMENT(data.ents, data.nents, entry) < 0) {
+            VIR_FREE(entry.name);
             goto cleanup;
+        }
     }
     if (errno) {
         virReportSystemError(errno, _("failed to read directory '%s' in '%s'"),
@@ -394,6 +453,58 @@ virStorageBackendGlusterRefreshPool(virConnectPtr conn ATTRIBUTE_UNUSED,
         goto cleanup;
     }
 
+    if (data.nents) {
+        if (VIR_ALLOC_N(data.vols, data.nents) < 0)
+            goto cleanup;
+
+        data.state = state;
+        if (virMutexInit(&data.lock) < 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("unable to initialize mutex"));
+            goto cleanup;
+        }
+        lock_initialized = true;
+
+        /* Probe the volume metadata (an open/read/close of each image
+         * header) with several workers pulling entries off a shared
+         * index, rather than one network round trip after another */
+        if (data.nents > 1) {
+            size_t want = MIN(data.nents - 1,
+                              VIR_STORAGE_GLUSTER_REFRESH_THREADS - 1);
+
+            if (VIR_ALLOC_N(workers, want) < 0)
+                goto cleanup;
+            while (nworkers < want) {
+                if (virThreadCreate(&workers[nworkers], true,
+                                    virStorageBackendGlusterRefreshWorker,
+                                    &data) < 0)
+                    break;
+                nworkers++;
+            }
+        }
+
+        /* This thread probes too, which also covers the case where no
+         * worker thread could be spawned at all */
+        virStorageBackendGlusterRefreshWorker(&data);
+
+        for (i = 0; i < nworkers; i++)
+            virThreadJoin(&workers[i]);
+
+        if (data.err) {
+            virSetError(data.err);
+            goto cleanup;
+        }
+
+        /* Results are collected per entry, so the pool keeps the
+         * directory ordering no matter how the probes interleaved */
+        for (i = 0; i < data.nents; i++) {
+            if (data.vols[i] &&
+                VIR_APPEND_ELEMENT(pool->volumes.objs, pool->volumes.count,
+                                   data.vols[i]) < 0)
+                goto cleanup;
+        }
+    }
+
     if (glfs_statvfs(state->vol, state->dir, &sb) < 0) {
         virReportSystemError(errno, _("cannot statvfs path '%s' in '%s'"),
                              state->dir, state->volname);
@@ -408,6 +519,18 @@ virStorageBackendGlusterRefreshPool(virConnectPtr conn ATTRIBUTE_UNUSED,
 
     ret = 0;
  cleanup:
+    if (data.vols) {
+        for (i = 0; i < data.nents; i++)
+            virStorageVolDefFree(data.vols[i]);
+        VIR_FREE(data.vols);
+    }
+    for (i = 0; i < data.nents; i++)
+        VIR_FREE(data.ents[i].name);
+    VIR_FREE(data.ents);
+    if (lock_initialized)
+        virMutexDestroy(&data.lock);
+    virFreeError(data.err);
+    VIR_FREE(workers);
     if (dir)
         glfs_closedir(dir);
     virStorageBackendGlusterClose(state);
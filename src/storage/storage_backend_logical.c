@@ -28,6 +28,7 @@
 #include <stdio.h>
 #include <regex.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <fcntl.h>
 
@@ -39,6 +40,7 @@
 #include "virlog.h"
 #include "virfile.h"
 #include "virstring.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
 
@@ -215,6 +217,23 @@ virStorageBackendLogicalMakeVol(char **const groups,
     int ret = -1;
     const char *attrs = groups[9];
 
+    /* Every row repeats the VG-wide totals, so the first row seen can
+     * fill in the pool metadata no matter which LV it describes. The
+     * caller zeroes the capacity before starting a full refresh. */
+    if (pool->def->capacity == 0) {
+        if (virStrToLong_ull(groups[10], NULL, 10, &pool->def->capacity) < 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           "%s", _("malformed volume group size value"));
+            return -1;
+        }
+        if (virStrToLong_ull(groups[11], NULL, 10, &pool->def->available) < 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           "%s", _("malformed volume group free value"));
+            return -1;
+        }
+        pool->def->allocation = pool->def->capacity - pool->def->available;
+    }
+
     /* Skip inactive volume */
     if (attrs[4] != 'a')
         return 0;
@@ -323,9 +342,11 @@ virStorageBackendLogicalMakeVol(char **const groups,
 #define VIR_STORAGE_VOL_LOGICAL_VG_EXTENT_SIZE_REGEX "([0-9]+)#"
 #define VIR_STORAGE_VOL_LOGICAL_SIZE_REGEX "([0-9]+)#"
 #define VIR_STORAGE_VOL_LOGICAL_LV_ATTR_REGEX "(\\S+)#"
+#define VIR_STORAGE_VOL_LOGICAL_VG_SIZE_REGEX "([0-9]+)#"
+#define VIR_STORAGE_VOL_LOGICAL_VG_FREE_REGEX "([0-9]+)#"
 #define VIR_STORAGE_VOL_LOGICAL_SUFFIX_REGEX "?\\s*$"
 
-#define VIR_STORAGE_VOL_LOGICAL_REGEX_COUNT 10
+#define VIR_STORAGE_VOL_LOGICAL_REGEX_COUNT 12
 #define VIR_STORAGE_VOL_LOGICAL_REGEX \
            VIR_STORAGE_VOL_LOGICAL_PREFIX_REGEX \
            VIR_STORAGE_VOL_LOGICAL_LV_NAME_REGEX \
@@ -338,6 +359,8 @@ virStorageBackendLogicalMakeVol(char **const groups,
            VIR_STORAGE_VOL_LOGICAL_VG_EXTENT_SIZE_REGEX \
            VIR_STORAGE_VOL_LOGICAL_SIZE_REGEX \
            VIR_STORAGE_VOL_LOGICAL_LV_ATTR_REGEX \
+           VIR_STORAGE_VOL_LOGICAL_VG_SIZE_REGEX \
+           VIR_STORAGE_VOL_LOGICAL_VG_FREE_REGEX \
            VIR_STORAGE_VOL_LOGICAL_SUFFIX_REGEX
 
 static int
@@ -346,7 +369,7 @@ virStorageBackendLogicalFindLVs(virStoragePoolObjPtr pool,
 {
     /*
      * # lvs --separator # --noheadings --units b --unbuffered --nosuffix --options \
-     * "lv_name,origin,uuid,devices,segtype,stripes,seg_size,vg_extent_size,size,lv_attr" VGNAME
+     * "lv_name,origin,uuid,devices,segtype,stripes,seg_size,vg_extent_size,size,lv_attr,vg_size,vg_free" VGNAME
      *
      * RootLV##06UgP5-2rhb-w3Bo-3mdR-WeoL-pytO-SAa2ky#/dev/hda2(0)#linear#1#5234491392#33554432#5234491392#-wi-ao
      * SwapLV##oHviCK-8Ik0-paqS-V20c-nkhY-Bm1e-zgzU0M#/dev/hda2(156)#linear#1#1040187392#33554432#1040187392#-wi-ao
@@ -368,6 +391,10 @@ virStorageBackendLogicalFindLVs(virStoragePoolObjPtr pool,
      *
      * NB "devices" field has multiple device paths and "," if the volume is
      *    striped, so "," is not a suitable separator either (rhbz 727474).
+     *
+     * NB The trailing vg_size and vg_free fields are identical on every
+     *    row; they let one lvs run provide both the volume list and the
+     *    VG totals that previously needed a separate vgs invocation.
      */
     const char *regexes[] = {
         VIR_STORAGE_VOL_LOGICAL_REGEX
@@ -389,7 +416,7 @@ virStorageBackendLogicalFindLVs(virStoragePoolObjPtr pool,
                                "--unbuffered",
                                "--nosuffix",
                                "--options",
-                               "lv_name,origin,uuid,devices,segtype,stripes,seg_size,vg_extent_size,size,lv_attr",
+                               "lv_name,origin,uuid,devices,segtype,stripes,seg_size,vg_extent_size,size,lv_attr,vg_size,vg_free",
                                pool->def->source.name,
                                NULL);
     if (virCommandRunRegex(cmd,
@@ -483,7 +510,7 @@ virStorageBackendLogicalFindPoolSourcesFunc(char **const groups,
  * Returns 0 if successful, -1 and sets error on failure
  */
 static int
-virStorageBackendLogicalGetPoolSources(virStoragePoolSourceListPtr sourceList)
+virStorageBackendLogicalRefreshPoolSources(virStoragePoolSourceListPtr sourceList)
 {
     /*
      * # pvs --noheadings -o pv_name,vg_name
@@ -525,6 +552,107 @@ virStorageBackendLogicalGetPoolSources(virStoragePoolSourceListPtr sourceList)
 }
 
 
+/* Cached vgscan + pvs harvest shared by every logical pool. Checking
+ * and starting pools both need the PV/VG listing and the daemon walks
+ * all pools back to back at startup, so one run can answer them all.
+ * The cache is dropped whenever we create or delete a volume group
+ * ourselves and expires after a few seconds so changes made outside
+ * libvirt are noticed promptly. */
+#define VIR_STORAGE_LOGICAL_SOURCE_CACHE_TTL 5
+
+static virMutex virStorageBackendLogicalSourceCacheLock = VIR_MUTEX_INITIALIZER;
+static virStoragePoolSourceList virStorageBackendLogicalSourceCache = {
+    .type = VIR_STORAGE_POOL_LOGICAL,
+};
+static time_t virStorageBackendLogicalSourceCacheWhen; /* 0 if invalid */
+
+
+static void
+virStorageBackendLogicalSourceCacheClearLocked(void)
+{
+    size_t i;
+
+    for (i = 0; i < virStorageBackendLogicalSourceCache.nsources; i++)
+        virStoragePoolSourceClear(&virStorageBackendLogicalSourceCache.sources[i]);
+    VIR_FREE(virStorageBackendLogicalSourceCache.sources);
+    virStorageBackendLogicalSourceCache.nsources = 0;
+    virStorageBackendLogicalSourceCacheWhen = 0;
+}
+
+
+static void
+virStorageBackendLogicalSourceCacheInvalidate(void)
+{
+    virMutexLock(&virStorageBackendLogicalSourceCacheLock);
+    virStorageBackendLogicalSourceCacheClearLocked();
+    virMutexUnlock(&virStorageBackendLogicalSourceCacheLock);
+}
+
+
+static int
+virStorageBackendLogicalCopyPoolSource(virStoragePoolSourceListPtr sourceList,
+                                       virStoragePoolSourcePtr source)
+{
+    virStoragePoolSourcePtr thisSource;
+    size_t i;
+
+    if (!(thisSource = virStoragePoolSourceListNewSource(sourceList)))
+        return -1;
+
+    if (VIR_STRDUP(thisSource->name, source->name) < 0)
+        return -1;
+
+    if (VIR_ALLOC_N(thisSource->devices, source->ndevice) < 0)
+        return -1;
+    thisSource->ndevice = source->ndevice;
+    thisSource->format = source->format;
+
+    for (i = 0; i < source->ndevice; i++) {
+        if (VIR_STRDUP(thisSource->devices[i].path,
+                       source->devices[i].path) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+virStorageBackendLogicalGetPoolSources(virStoragePoolSourceListPtr sourceList)
+{
+    time_t now = time(NULL);
+    size_t i;
+    int ret = -1;
+
+    virMutexLock(&virStorageBackendLogicalSourceCacheLock);
+
+    if (virStorageBackendLogicalSourceCacheWhen == 0 ||
+        now < virStorageBackendLogicalSourceCacheWhen ||
+        now - virStorageBackendLogicalSourceCacheWhen >
+        VIR_STORAGE_LOGICAL_SOURCE_CACHE_TTL) {
+        virStorageBackendLogicalSourceCacheClearLocked();
+        if (virStorageBackendLogicalRefreshPoolSources(&virStorageBackendLogicalSourceCache) < 0) {
+            virStorageBackendLogicalSourceCacheClearLocked();
+            goto cleanup;
+        }
+        virStorageBackendLogicalSourceCacheWhen = time(NULL);
+    }
+
+    /* Callers own and modify the returned list, so hand out a copy */
+    for (i = 0; i < virStorageBackendLogicalSourceCache.nsources; i++) {
+        if (virStorageBackendLogicalCopyPoolSource(sourceList,
+                                                   &virStorageBackendLogicalSourceCache.sources[i]) < 0)
+            goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virMutexUnlock(&virStorageBackendLogicalSourceCacheLock);
+    return ret;
+}
+
+
 static char *
 virStorageBackendLogicalFindPoolSources(virConnectPtr conn ATTRIBUTE_UNUSED,
                                         const char *srcSpec ATTRIBUTE_UNUSED,
@@ -748,6 +876,9 @@ virStorageBackendLogicalBuildPool(virConnectPtr conn ATTRIBUTE_UNUSED,
     if (virCommandRun(vgcmd, NULL) < 0)
         goto cleanup;
 
+    /* The new VG must show up in the next PV/VG listing */
+    virStorageBackendLogicalSourceCacheInvalidate();
+
     ret = 0;
 
  cleanup:
@@ -779,10 +910,22 @@ virStorageBackendLogicalRefreshPool(virConnectPtr conn ATTRIBUTE_UNUSED,
 
     virFileWaitForDevices();
 
-    /* Get list of all logical volumes */
+    /* Zero the totals so the vg fields reported alongside the volume
+     * list below are picked up again */
+    pool->def->allocation = pool->def->capacity = pool->def->available = 0;
+
+    /* Get the list of all logical volumes, which also carries the
+     * VG-wide totals on each row */
     if (virStorageBackendLogicalFindLVs(pool, NULL) < 0)
         goto cleanup;
 
+    /* An empty VG reports no rows at all, so the totals must then be
+     * fetched with a separate vgs run */
+    if (pool->def->capacity != 0) {
+        ret = 0;
+        goto cleanup;
+    }
+
     cmd = virCommandNewArgList(VGS,
                                "--separator", ":",
                                "--noheadings",
@@ -848,6 +991,9 @@ virStorageBackendLogicalDeletePool(virConnectPtr conn ATTRIBUTE_UNUSED,
     virCommandFree(cmd);
     cmd = NULL;
 
+    /* The removed VG must vanish from the next PV/VG listing */
+    virStorageBackendLogicalSourceCacheInvalidate();
+
     /* now remove the pv devices and clear them out */
     ret = 0;
     for (i = 0; i < pool->def->source.ndevice; i++) {
@@ -27,20 +27,98 @@
 #include <stdio.h>
 #include <fcntl.h>
 
+#ifdef MAJOR_IN_MKDEV
+# include <sys/mkdev.h>
+#elif MAJOR_IN_SYSMACROS
+# include <sys/sysmacros.h>
+#endif
+
 #include <libdevmapper.h>
 
 #include "virerror.h"
 #include "storage_conf.h"
 #include "storage_backend.h"
 #include "viralloc.h"
+#include "virhash.h"
 #include "virlog.h"
 #include "virfile.h"
 #include "virstring.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
 
 VIR_LOG_INIT("storage.storage_backend_mpath");
 
+/* Cached multipath verdicts for device mapper maps. Deciding whether a
+ * map has a multipath target costs a DM_DEVICE_TABLE ioctl per map and
+ * SAN hosts can easily carry hundreds of maps, so each refresh only
+ * probes maps it has not seen before. Entries are keyed by device
+ * number plus name, which changes whenever a map is recreated, and
+ * maps that have disappeared are pruned after every walk. */
+typedef struct _virStorageBackendMpathMapData virStorageBackendMpathMapData;
+typedef virStorageBackendMpathMapData *virStorageBackendMpathMapDataPtr;
+struct _virStorageBackendMpathMapData {
+    bool is_mpath;
+    bool seen;      /* set during a walk; entries left unseen are pruned */
+};
+
+static virMutex virStorageBackendMpathCacheLock = VIR_MUTEX_INITIALIZER;
+static virHashTablePtr virStorageBackendMpathCache;
+
+
+static void
+virStorageBackendMpathCacheDataFree(void *payload,
+                                    const void *name ATTRIBUTE_UNUSED)
+{
+    VIR_FREE(payload);
+}
+
+
+static int
+virStorageBackendMpathCacheUnmark(void *payload,
+                                  const void *name ATTRIBUTE_UNUSED,
+                                  void *data ATTRIBUTE_UNUSED)
+{
+    virStorageBackendMpathMapDataPtr entry = payload;
+
+    entry->seen = false;
+    return 0;
+}
+
+
+static int
+virStorageBackendMpathCacheUnseen(const void *payload,
+                                  const void *name ATTRIBUTE_UNUSED,
+                                  const void *data ATTRIBUTE_UNUSED)
+{
+    const virStorageBackendMpathMapData *entry = payload;
+
+    return entry->seen ? 0 : 1;
+}
+
+
+static void
+virStorageBackendMpathCacheBeginWalk(void)
+{
+    virMutexLock(&virStorageBackendMpathCacheLock);
+    if (virStorageBackendMpathCache)
+        virHashForEach(virStorageBackendMpathCache,
+                       virStorageBackendMpathCacheUnmark, NULL);
+    virMutexUnlock(&virStorageBackendMpathCacheLock);
+}
+
+
+static void
+virStorageBackendMpathCacheEndWalk(void)
+{
+    virMutexLock(&virStorageBackendMpathCacheLock);
+    if (virStorageBackendMpathCache)
+        ignore_value(virHashRemoveSet(virStorageBackendMpathCache,
+                                      virStorageBackendMpathCacheUnseen,
+                                      NULL));
+    virMutexUnlock(&virStorageBackendMpathCacheLock);
+}
+
 static int
 virStorageBackendMpathNewVol(virStoragePoolObjPtr pool,
                              const int devnum,
@@ -125,31 +203,52 @@ virStorageBackendIsMultipath(const char *dev_name)
 
 
 static int
-virStorageBackendGetMinorNumber(const char *dev_name, uint32_t *minor)
+virStorageBackendIsMultipathCached(const char *dev_name,
+                                   uint64_t dev,
+                                   bool *is_mpath)
 {
+    virStorageBackendMpathMapDataPtr entry;
+    char *key = NULL;
+    int probe;
     int ret = -1;
-    struct dm_task *dmt;
-    struct dm_info info;
 
-    if (!(dmt = dm_task_create(DM_DEVICE_INFO)))
-        goto out;
+    if (virAsprintf(&key, "%llu-%s", (unsigned long long)dev, dev_name) < 0)
+        return -1;
 
-    if (!dm_task_set_name(dmt, dev_name))
-        goto out;
+    virMutexLock(&virStorageBackendMpathCacheLock);
 
-    if (!dm_task_run(dmt))
-        goto out;
+    if (!virStorageBackendMpathCache &&
+        !(virStorageBackendMpathCache =
+          virHashCreate(10, virStorageBackendMpathCacheDataFree)))
+        goto cleanup;
 
-    if (!dm_task_get_info(dmt, &info))
-        goto out;
+    if ((entry = virHashLookup(virStorageBackendMpathCache, key))) {
+        entry->seen = true;
+        *is_mpath = entry->is_mpath;
+        ret = 0;
+        goto cleanup;
+    }
 
-    *minor = info.minor;
-    ret = 0;
+    if ((probe = virStorageBackendIsMultipath(dev_name)) < 0)
+        goto cleanup;
 
- out:
-    if (dmt != NULL)
-        dm_task_destroy(dmt);
+    if (VIR_ALLOC(entry) < 0)
+        goto cleanup;
 
+    entry->is_mpath = probe == 1;
+    entry->seen = true;
+
+    if (virHashAddEntry(virStorageBackendMpathCache, key, entry) < 0) {
+        VIR_FREE(entry);
+        goto cleanup;
+    }
+
+    *is_mpath = entry->is_mpath;
+    ret = 0;
+
+ cleanup:
+    virMutexUnlock(&virStorageBackendMpathCacheLock);
+    VIR_FREE(key);
     return ret;
 }
 
@@ -158,30 +257,28 @@ static int
 virStorageBackendCreateVols(virStoragePoolObjPtr pool,
                             struct dm_names *names)
 {
-    int retval = -1, is_mpath = 0;
+    int retval = -1;
+    bool is_mpath = false;
     char *map_device = NULL;
-    uint32_t minor = -1;
     uint32_t next;
 
-    do {
-        is_mpath = virStorageBackendIsMultipath(names->name);
+    virStorageBackendMpathCacheBeginWalk();
 
-        if (is_mpath < 0)
+    do {
+        if (virStorageBackendIsMultipathCached(names->name, names->dev,
+                                               &is_mpath) < 0)
             goto out;
 
-        if (is_mpath == 1) {
+        if (is_mpath) {
 
             if (virAsprintf(&map_device, "mapper/%s", names->name) < 0)
                 goto out;
 
-            if (virStorageBackendGetMinorNumber(names->name, &minor) < 0) {
-                virReportError(VIR_ERR_INTERNAL_ERROR,
-                               _("Failed to get %s minor number"),
-                               names->name);
-                goto out;
-            }
-
-            if (virStorageBackendMpathNewVol(pool, minor, map_device) < 0)
+            /* DM_DEVICE_LIST already reports each map's device number,
+             * so the minor can be taken straight from it rather than
+             * issuing a DM_DEVICE_INFO ioctl per map */
+            if (virStorageBackendMpathNewVol(pool, minor(names->dev),
+                                             map_device) < 0)
                 goto out;
 
             VIR_FREE(map_device);
@@ -198,6 +295,7 @@ virStorageBackendCreateVols(virStoragePoolObjPtr pool,
 
     retval = 0;
  out:
+    virStorageBackendMpathCacheEndWalk();
     return retval;
 }
 
@@ -34,6 +34,8 @@
 #include "viruuid.h"
 #include "virstring.h"
 #include "virrandom.h"
+#include "virhash.h"
+#include "virthread.h"
 #include "rados/librados.h"
 #include "rbd/librbd.h"
 #include "secret_util.h"
@@ -272,6 +274,102 @@ virStorageBackendRBDNewState(virConnectPtr conn,
 }
 
 
+/*
+ * Cache of idle RADOS connections, keyed by pool UUID.  Establishing a
+ * cluster connection takes several monitor round trips and easily
+ * dominates short operations, so the connection used by a successful
+ * operation is kept and handed to the next operation on the same pool.
+ * Only one idle connection is kept per pool and a state is never
+ * shared while in use, so no librados handle is ever used from two
+ * threads at once.  Stopping the pool or failing an operation drops
+ * the connection; the former also covers a pool being redefined to
+ * point at a different cluster while inactive.
+ */
+static virMutex virStorageBackendRBDCacheLock = VIR_MUTEX_INITIALIZER;
+static virHashTablePtr virStorageBackendRBDCache;
+
+static void
+virStorageBackendRBDCacheDataFree(void *payload,
+                                  const void *name ATTRIBUTE_UNUSED)
+{
+    virStorageBackendRBDStatePtr ptr = payload;
+
+    virStorageBackendRBDFreeState(&ptr);
+}
+
+
+static virStorageBackendRBDStatePtr
+virStorageBackendRBDAcquireState(virConnectPtr conn,
+                                 virStoragePoolObjPtr pool)
+{
+    virStorageBackendRBDStatePtr ptr = NULL;
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    virUUIDFormat(pool->def->uuid, uuidstr);
+
+    virMutexLock(&virStorageBackendRBDCacheLock);
+    if (virStorageBackendRBDCache)
+        ptr = virHashSteal(virStorageBackendRBDCache, uuidstr);
+    virMutexUnlock(&virStorageBackendRBDCacheLock);
+
+    if (ptr) {
+        VIR_DEBUG("Reusing cached RADOS connection for pool %s", uuidstr);
+        return ptr;
+    }
+
+    return virStorageBackendRBDNewState(conn, pool);
+}
+
+
+/*
+ * Hand a state back for reuse after a successful operation.  Failed
+ * operations must free their state with virStorageBackendRBDFreeState
+ * instead, since a broken connection may well be what failed them.
+ * Consumes the state; *ptr is NULL afterwards either way.
+ */
+static void
+virStorageBackendRBDReleaseState(virStoragePoolObjPtr pool,
+                                 virStorageBackendRBDStatePtr *ptr)
+{
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    if (!*ptr)
+        return;
+
+    virUUIDFormat(pool->def->uuid, uuidstr);
+
+    virMutexLock(&virStorageBackendRBDCacheLock);
+    if (!virStorageBackendRBDCache)
+        virStorageBackendRBDCache =
+            virHashCreate(10, virStorageBackendRBDCacheDataFree);
+
+    if (virStorageBackendRBDCache &&
+        !virHashLookup(virStorageBackendRBDCache, uuidstr) &&
+        virHashAddEntry(virStorageBackendRBDCache, uuidstr, *ptr) == 0)
+        *ptr = NULL;
+    virMutexUnlock(&virStorageBackendRBDCacheLock);
+
+    virStorageBackendRBDFreeState(ptr);
+}
+
+
+static int
+virStorageBackendRBDStopPool(virConnectPtr conn ATTRIBUTE_UNUSED,
+                             virStoragePoolObjPtr pool)
+{
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    virUUIDFormat(pool->def->uuid, uuidstr);
+
+    virMutexLock(&virStorageBackendRBDCacheLock);
+    if (virStorageBackendRBDCache)
+        ignore_value(virHashRemoveEntry(virStorageBackendRBDCache, uuidstr));
+    virMutexUnlock(&virStorageBackendRBDCacheLock);
+
+    return 0;
+}
+
+
 static int
 volStorageBackendRBDGetFeatures(rbd_image_t image,
                                 const char *volname,
@@ -433,7 +531,7 @@ virStorageBackendRBDRefreshPool(virConnectPtr conn,
     struct rados_cluster_stat_t clusterstat;
     struct rados_pool_stat_t poolstat;
 
-    if (!(ptr = virStorageBackendRBDNewState(conn, pool)))
+    if (!(ptr = virStorageBackendRBDAcquireState(conn, pool)))
         goto cleanup;
 
     if ((r = rados_cluster_stat(ptr->cluster, &clusterstat)) < 0) {
@@ -519,6 +617,8 @@ virStorageBackendRBDRefreshPool(virConnectPtr conn,
 
  cleanup:
     VIR_FREE(names);
+    if (ret == 0)
+        virStorageBackendRBDReleaseState(pool, &ptr);
     virStorageBackendRBDFreeState(&ptr);
     return ret;
 }
@@ -619,7 +719,7 @@ virStorageBackendRBDDeleteVol(virConnectPtr conn,
     if (flags & VIR_STORAGE_VOL_DELETE_ZEROED)
         VIR_WARN("%s", "This storage backend does not support zeroed removal of volumes");
 
-    if (!(ptr = virStorageBackendRBDNewState(conn, pool)))
+    if (!(ptr = virStorageBackendRBDAcquireState(conn, pool)))
         goto cleanup;
 
     if (flags & VIR_STORAGE_VOL_DELETE_WITH_SNAPSHOTS) {
@@ -640,6 +740,8 @@ virStorageBackendRBDDeleteVol(virConnectPtr conn,
     ret = 0;
 
  cleanup:
+    if (ret == 0)
+        virStorageBackendRBDReleaseState(pool, &ptr);
     virStorageBackendRBDFreeState(&ptr);
     return ret;
 }
@@ -714,7 +816,7 @@ virStorageBackendRBDBuildVol(virConnectPtr conn,
         goto cleanup;
     }
 
-    if (!(ptr = virStorageBackendRBDNewState(conn, pool)))
+    if (!(ptr = virStorageBackendRBDAcquireState(conn, pool)))
         goto cleanup;
 
     if ((r = virStorageBackendRBDCreateImage(ptr->ioctx, vol->name,
@@ -728,6 +830,8 @@ virStorageBackendRBDBuildVol(virConnectPtr conn,
     ret = 0;
 
  cleanup:
+    if (ret == 0)
+        virStorageBackendRBDReleaseState(pool, &ptr);
     virStorageBackendRBDFreeState(&ptr);
     return ret;
 }
@@ -1052,7 +1156,7 @@ virStorageBackendRBDBuildVolFrom(virConnectPtr conn,
 
     virCheckFlags(0, -1);
 
-    if (!(ptr = virStorageBackendRBDNewState(conn, pool)))
+    if (!(ptr = virStorageBackendRBDAcquireState(conn, pool)))
         goto cleanup;
 
     if ((virStorageBackendRBDCloneImage(ptr->ioctx, origvol->name,
@@ -1062,6 +1166,8 @@ virStorageBackendRBDBuildVolFrom(virConnectPtr conn,
     ret = 0;
 
  cleanup:
+    if (ret == 0)
+        virStorageBackendRBDReleaseState(pool, &ptr);
     virStorageBackendRBDFreeState(&ptr);
     return ret;
 }
@@ -1074,7 +1180,7 @@ virStorageBackendRBDRefreshVol(virConnectPtr conn,
     virStorageBackendRBDStatePtr ptr = NULL;
     int ret = -1;
 
-    if (!(ptr = virStorageBackendRBDNewState(conn, pool)))
+    if (!(ptr = virStorageBackendRBDAcquireState(conn, pool)))
         goto cleanup;
 
     if (volStorageBackendRBDRefreshVolInfo(vol, pool, ptr) < 0)
@@ -1083,6 +1189,8 @@ virStorageBackendRBDRefreshVol(virConnectPtr conn,
     ret = 0;
 
  cleanup:
+    if (ret == 0)
+        virStorageBackendRBDReleaseState(pool, &ptr);
     virStorageBackendRBDFreeState(&ptr);
     return ret;
 }
@@ -1101,7 +1209,7 @@ virStorageBackendRBDResizeVol(virConnectPtr conn ATTRIBUTE_UNUSED,
 
     virCheckFlags(0, -1);
 
-    if (!(ptr = virStorageBackendRBDNewState(conn, pool)))
+    if (!(ptr = virStorageBackendRBDAcquireState(conn, pool)))
         goto cleanup;
 
     if ((r = rbd_open(ptr->ioctx, vol->name, &image, NULL)) < 0) {
@@ -1121,6 +1229,8 @@ virStorageBackendRBDResizeVol(virConnectPtr conn ATTRIBUTE_UNUSED,
  cleanup:
     if (image != NULL)
        rbd_close(image);
+    if (ret == 0)
+        virStorageBackendRBDReleaseState(pool, &ptr);
     virStorageBackendRBDFreeState(&ptr);
     return ret;
 }
@@ -1217,7 +1327,7 @@ virStorageBackendRBDVolWipe(virConnectPtr conn,
 
     VIR_DEBUG("Wiping RBD image %s/%s", pool->def->source.name, vol->name);
 
-    if (!(ptr = virStorageBackendRBDNewState(conn, pool)))
+    if (!(ptr = virStorageBackendRBDAcquireState(conn, pool)))
         goto cleanup;
 
     if ((r = rbd_open(ptr->ioctx, vol->name, &image, NULL)) < 0) {
@@ -1276,6 +1386,8 @@ virStorageBackendRBDVolWipe(virConnectPtr conn,
     if (image)
         rbd_close(image);
 
+    if (ret == 0)
+        virStorageBackendRBDReleaseState(pool, &ptr);
     virStorageBackendRBDFreeState(&ptr);
 
     return ret;
@@ -1285,6 +1397,7 @@ virStorageBackend virStorageBackendRBD = {
     .type = VIR_STORAGE_POOL_RBD,
 
     .refreshPool = virStorageBackendRBDRefreshPool,
+    .stopPool = virStorageBackendRBDStopPool,
     .createVol = virStorageBackendRBDCreateVol,
     .buildVol = virStorageBackendRBDBuildVol,
     .buildVolFrom = virStorageBackendRBDBuildVolFrom,
@@ -43,7 +43,8 @@ VIR_LOG_INIT("storage.storage_backend_scsi");
 typedef struct _virStoragePoolFCRefreshInfo virStoragePoolFCRefreshInfo;
 typedef virStoragePoolFCRefreshInfo *virStoragePoolFCRefreshInfoPtr;
 struct _virStoragePoolFCRefreshInfo {
-    char *fchost_name;
+    char *wwnn;
+    char *wwpn;
     unsigned char pool_uuid[VIR_UUID_BUFLEN];
 };
 
@@ -549,7 +550,8 @@ virStoragePoolFCRefreshDataFree(void *opaque)
 {
     virStoragePoolFCRefreshInfoPtr cbdata = opaque;
 
-    VIR_FREE(cbdata->fchost_name);
+    VIR_FREE(cbdata->wwnn);
+    VIR_FREE(cbdata->wwpn);
     VIR_FREE(cbdata);
 }
 
@@ -577,9 +579,9 @@ static void
 virStoragePoolFCRefreshThread(void *opaque)
 {
     virStoragePoolFCRefreshInfoPtr cbdata = opaque;
-    const char *fchost_name = cbdata->fchost_name;
     const unsigned char *pool_uuid = cbdata->pool_uuid;
     virStoragePoolObjPtr pool = NULL;
+    char *fchost_name = NULL;
     unsigned int host;
     int found = 0;
     int tries = 2;
@@ -587,6 +589,14 @@ virStoragePoolFCRefreshThread(void *opaque)
     do {
         sleep(5); /* Give it time */
 
+        /* The vport was created just before this thread started;
+         * resolve the scsi_host name here, so the pool start does
+         * not have to wait on udev for it */
+        if (!fchost_name &&
+            !(fchost_name = virGetFCHostNameByWWN(NULL, cbdata->wwnn,
+                                                  cbdata->wwpn)))
+            continue;
+
         /* Let's see if the pool still exists -  */
         if (!(pool = virStoragePoolObjFindPoolByUUID(pool_uuid)))
             break;
@@ -611,6 +621,7 @@ virStoragePoolFCRefreshThread(void *opaque)
     if (pool && !found)
         VIR_DEBUG("FC Refresh Thread failed to find LU's");
 
+    VIR_FREE(fchost_name);
     virStoragePoolFCRefreshDataFree(cbdata);
 }
 
@@ -779,28 +790,24 @@ createVport(virConnectPtr conn,
                        adapter->data.fchost.wwnn, VPORT_CREATE) < 0)
         return -1;
 
-    virFileWaitForDevices();
-
     /* Creating our own VPORT didn't leave enough time to find any LUN's,
      * so, let's create a thread whose job it is to call the FindLU's with
      * retry logic set to true. If the thread isn't created, then no big
-     * deal since it's still possible to refresh the pool later.
+     * deal since it's still possible to refresh the pool later. The
+     * thread resolves the scsi_host name from the WWNs itself, so we
+     * don't need to wait for udev to settle here and starting several
+     * vHBA pools overlaps their fabric logins.
      */
-    if ((name = virGetFCHostNameByWWN(NULL, adapter->data.fchost.wwnn,
-                                      adapter->data.fchost.wwpn))) {
-        if (VIR_ALLOC(cbdata) == 0) {
-            memcpy(cbdata->pool_uuid, pool->def->uuid, VIR_UUID_BUFLEN);
-            cbdata->fchost_name = name;
-            name = NULL;
-
-            if (virThreadCreate(&thread, false, virStoragePoolFCRefreshThread,
-                                cbdata) < 0) {
-                /* Oh well - at least someone can still refresh afterwards */
-                VIR_DEBUG("Failed to create FC Pool Refresh Thread");
-                virStoragePoolFCRefreshDataFree(cbdata);
-            }
+    if (VIR_ALLOC(cbdata) == 0) {
+        memcpy(cbdata->pool_uuid, pool->def->uuid, VIR_UUID_BUFLEN);
+        if (VIR_STRDUP(cbdata->wwnn, adapter->data.fchost.wwnn) < 0 ||
+            VIR_STRDUP(cbdata->wwpn, adapter->data.fchost.wwpn) < 0 ||
+            virThreadCreate(&thread, false, virStoragePoolFCRefreshThread,
+                            cbdata) < 0) {
+            /* Oh well - at least someone can still refresh afterwards */
+            VIR_DEBUG("Failed to create FC Pool Refresh Thread");
+            virStoragePoolFCRefreshDataFree(cbdata);
         }
-        VIR_FREE(name);
     }
 
     return 0;
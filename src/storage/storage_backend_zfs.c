@@ -27,6 +27,7 @@
 #include "storage_backend_zfs.h"
 #include "virlog.h"
 #include "virstring.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
 
@@ -39,16 +40,8 @@ VIR_LOG_INIT("storage.storage_backend_zfs");
  *       for size, show just a number instead of 2G etc
  */
 
-/**
- * virStorageBackendZFSVolModeNeeded:
- *
- * Checks if it's necessary to specify 'volmode' (i.e. that
- * we're working with BSD ZFS implementation).
- *
- * Returns 1 if 'volmode' is need, 0 if not needed, -1 on error
- */
 static int
-virStorageBackendZFSVolModeNeeded(void)
+virStorageBackendZFSVolModeProbe(void)
 {
     virCommandPtr cmd = NULL;
     int ret = -1, exit_code = -1;
@@ -81,6 +74,38 @@ virStorageBackendZFSVolModeNeeded(void)
     return ret;
 }
 
+
+static virMutex virStorageBackendZFSVolModeLock = VIR_MUTEX_INITIALIZER;
+static int virStorageBackendZFSVolModeCached = -1; /* -1 == not probed yet */
+
+/**
+ * virStorageBackendZFSVolModeNeeded:
+ *
+ * Checks if it's necessary to specify 'volmode' (i.e. that
+ * we're working with BSD ZFS implementation).
+ *
+ * Whether the installed ZFS supports 'volmode' is a static property
+ * of the host, so the probe (a 'zfs get' exec) only runs once per
+ * process instead of before every volume creation; only a successful
+ * probe is cached so a transient failure is retried.
+ *
+ * Returns 1 if 'volmode' is need, 0 if not needed, -1 on error
+ */
+static int
+virStorageBackendZFSVolModeNeeded(void)
+{
+    int ret;
+
+    virMutexLock(&virStorageBackendZFSVolModeLock);
+    if ((ret = virStorageBackendZFSVolModeCached) < 0) {
+        if ((ret = virStorageBackendZFSVolModeProbe()) >= 0)
+            virStorageBackendZFSVolModeCached = ret;
+    }
+    virMutexUnlock(&virStorageBackendZFSVolModeLock);
+
+    return ret;
+}
+
 static int
 virStorageBackendZFSCheckPool(virStoragePoolObjPtr pool ATTRIBUTE_UNUSED,
                               bool *isActive)
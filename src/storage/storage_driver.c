@@ -51,6 +51,8 @@
 #include "virstring.h"
 #include "viraccessapicheck.h"
 #include "dirname.h"
+#include "virhash.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
 
@@ -1188,6 +1190,17 @@ storagePoolRefresh(virStoragePoolPtr obj,
         goto cleanup;
     }
 
+    /* If the backend can prove the volume list is still current
+     * (e.g. via a directory change watch), skip the full re-scan
+     * and only refresh the pool level statistics */
+    if (backend->refreshPoolCached &&
+        backend->refreshPoolCached(obj->conn, pool) == 1) {
+        event = virStoragePoolEventRefreshNew(pool->def->name,
+                                              pool->def->uuid);
+        ret = 0;
+        goto cleanup;
+    }
+
     virStoragePoolObjClearVols(pool);
     if (backend->refreshPool(obj->conn, pool) < 0) {
         if (backend->stopPool)
@@ -3196,6 +3209,146 @@ virStorageFileChown(virStorageSourcePtr src,
 }
 
 
+/* Cache of raw image headers, keyed by the unique identifier of the
+ * storage file and validated against its size and mtime. Backing
+ * chains are re-traversed on every domain start and block job
+ * completion, and on network filesystems each chain element costs an
+ * open plus header read round trip; for unchanged images we can skip
+ * both. In-place header rewrites which beat the mtime granularity are
+ * handled by explicit invalidation from the block job code. */
+typedef struct _virStorageFileMetadataCacheEntry virStorageFileMetadataCacheEntry;
+typedef virStorageFileMetadataCacheEntry *virStorageFileMetadataCacheEntryPtr;
+struct _virStorageFileMetadataCacheEntry {
+    char *buf;                  /* raw image header */
+    ssize_t len;
+    unsigned long long size;
+    time_t mtime;
+};
+
+static virMutex virStorageFileMetadataCacheLock = VIR_MUTEX_INITIALIZER;
+static virHashTablePtr virStorageFileMetadataCache;
+
+
+static void
+virStorageFileMetadataCacheEntryFree(void *payload,
+                                     const void *name ATTRIBUTE_UNUSED)
+{
+    virStorageFileMetadataCacheEntryPtr entry = payload;
+
+    VIR_FREE(entry->buf);
+    VIR_FREE(entry);
+}
+
+
+/* Returns the length of the cached header copied into @buf, or -1 if
+ * there is no cache entry for @uniqueName matching @st */
+static ssize_t
+virStorageFileMetadataCacheLookup(const char *uniqueName,
+                                  const struct stat *st,
+                                  char **buf)
+{
+    virStorageFileMetadataCacheEntryPtr entry;
+    ssize_t ret = -1;
+
+    virMutexLock(&virStorageFileMetadataCacheLock);
+
+    if (!virStorageFileMetadataCache)
+        goto cleanup;
+
+    if (!(entry = virHashLookup(virStorageFileMetadataCache, uniqueName)))
+        goto cleanup;
+
+    if (entry->size != (unsigned long long)st->st_size ||
+        entry->mtime != st->st_mtime)
+        goto cleanup;
+
+    if (VIR_ALLOC_N(*buf, entry->len) < 0)
+        goto cleanup;
+
+    memcpy(*buf, entry->buf, entry->len);
+    ret = entry->len;
+
+ cleanup:
+    virMutexUnlock(&virStorageFileMetadataCacheLock);
+    return ret;
+}
+
+
+static void
+virStorageFileMetadataCacheStore(const char *uniqueName,
+                                 const struct stat *st,
+                                 const char *buf,
+                                 ssize_t len)
+{
+    virStorageFileMetadataCacheEntryPtr entry = NULL;
+
+    virMutexLock(&virStorageFileMetadataCacheLock);
+
+    if (!virStorageFileMetadataCache &&
+        !(virStorageFileMetadataCache =
+          virHashCreate(53, virStorageFileMetadataCacheEntryFree)))
+        goto cleanup;
+
+    if (VIR_ALLOC(entry) < 0)
+        goto cleanup;
+
+    if (VIR_ALLOC_N(entry->buf, len) < 0)
+        goto cleanup;
+
+    memcpy(entry->buf, buf, len);
+    entry->len = len;
+    entry->size = st->st_size;
+    entry->mtime = st->st_mtime;
+
+    if (virHashUpdateEntry(virStorageFileMetadataCache,
+                           uniqueName, entry) < 0)
+        goto cleanup;
+
+    entry = NULL;
+
+ cleanup:
+    if (entry) {
+        VIR_FREE(entry->buf);
+        VIR_FREE(entry);
+    }
+    virMutexUnlock(&virStorageFileMetadataCacheLock);
+}
+
+
+/**
+ * virStorageFileInvalidateMetadataCache:
+ * @src: top of the backing chain to drop cached headers for
+ *
+ * Drops the cached image headers for every local file in the chain
+ * starting at @src. Must be called after operations which rewrite an
+ * image header in place (block pull, commit, rebase), since such
+ * rewrites may not change the file's size or mtime.
+ */
+void
+virStorageFileInvalidateMetadataCache(virStorageSourcePtr src)
+{
+    char *canonpath;
+
+    virMutexLock(&virStorageFileMetadataCacheLock);
+
+    for (; src; src = src->backingStore) {
+        if (!virStorageSourceIsLocalStorage(src) || !src->path)
+            continue;
+
+        /* the cache is keyed by the canonical path for local files */
+        if (!(canonpath = canonicalize_file_name(src->path)))
+            continue;
+
+        if (virStorageFileMetadataCache)
+            ignore_value(virHashRemoveEntry(virStorageFileMetadataCache,
+                                            canonpath));
+        VIR_FREE(canonpath);
+    }
+
+    virMutexUnlock(&virStorageFileMetadataCacheLock);
+}
+
+
 /* Recursive workhorse for virStorageFileGetMetadata.  */
 static int
 virStorageFileGetMetadataRecurse(virStorageSourcePtr src,
@@ -3209,6 +3362,8 @@ virStorageFileGetMetadataRecurse(virStorageSourcePtr src,
     const char *uniqueName;
     char *buf = NULL;
     ssize_t headerLen;
+    struct stat st;
+    bool haveStat;
     virStorageSourcePtr backingStore = NULL;
     int backingFormat;
 
@@ -3254,9 +3409,19 @@ virStorageFileGetMetadataRecurse(virStorageSourcePtr src,
     if (virHashAddEntry(cycle, uniqueName, (void *)1) < 0)
         goto cleanup;
 
-    if ((headerLen = virStorageFileReadHeader(src, VIR_STORAGE_MAX_HEADER,
-                                              &buf)) < 0)
-        goto cleanup;
+    haveStat = virStorageFileStat(src, &st) == 0;
+
+    if (!haveStat ||
+        (headerLen = virStorageFileMetadataCacheLookup(uniqueName,
+                                                       &st, &buf)) < 0) {
+        if ((headerLen = virStorageFileReadHeader(src, VIR_STORAGE_MAX_HEADER,
+                                                  &buf)) < 0)
+            goto cleanup;
+
+        if (haveStat)
+            virStorageFileMetadataCacheStore(uniqueName, &st,
+                                             buf, headerLen);
+    }
 
     if (virStorageFileGetMetadataInternal(src, buf, headerLen,
                                           &backingFormat) < 0)
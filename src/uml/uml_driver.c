@@ -305,11 +305,15 @@ umlInotifyEvent(int watch,
     if (watch != driver->inotifyWatch)
         goto cleanup;
 
+    /* Drain every event queued on the FD, not just one buffer full,
+     * so that a burst of UML instances starting or stopping at once
+     * is handled in a single wakeup */
  reread:
     got = read(fd, buf, sizeof(buf));
     if (got == -1) {
         if (errno == EINTR)
             goto reread;
+        /* Queue fully drained */
         goto cleanup;
     }
 
@@ -398,6 +402,7 @@ umlInotifyEvent(int watch,
             event = NULL;
         }
     }
+    goto reread;
 
  cleanup:
     umlDriverUnlock(driver);
@@ -542,6 +547,12 @@ umlStateInitialize(bool privileged,
         goto error;
     }
 
+    if (virSetNonBlock(uml_driver->inotifyFD) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Failed to make inotify FD non-blocking"));
+        goto error;
+    }
+
     if (virFileMakePath(uml_driver->monitorDir) < 0) {
         virReportSystemError(errno, _("Failed to create monitor directory %s"),
                              uml_driver->monitorDir);
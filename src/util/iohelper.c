@@ -72,11 +72,109 @@ prepare(const char *path, int oflags, int mode,
     return fd;
 }
 
+typedef struct _runIOXfer runIOXfer;
+struct _runIOXfer {
+    virMutex lock;
+    virCond cond;
+
+    int fd;                 /* output file descriptor */
+
+    char *buf;              /* buffer queued for writing, NULL when idle */
+    size_t len;             /* number of bytes to write from @buf */
+    off_t end;              /* if non-zero, truncate the output here */
+    bool eof;               /* no more buffers will be queued */
+    int werrno;             /* errno of a failed write, 0 otherwise */
+    bool wtrunc;            /* the failure was in ftruncate, not write */
+};
+
+/* Drain queued buffers to the output; runs in a separate thread so
+ * that writing one block overlaps reading the next one */
+static void
+runIOWriter(void *opaque)
+{
+    runIOXfer *xfer = opaque;
+
+    virMutexLock(&xfer->lock);
+    for (;;) {
+        char *buf;
+        size_t len;
+        off_t end;
+        int werrno = 0;
+        bool wtrunc = false;
+
+        while (!xfer->buf && !xfer->eof)
+            virCondWait(&xfer->cond, &xfer->lock);
+
+        if (!xfer->buf)
+            break;
+
+        buf = xfer->buf;
+        len = xfer->len;
+        end = xfer->end;
+        virMutexUnlock(&xfer->lock);
+
+        if (safewrite(xfer->fd, buf, len) < 0) {
+            werrno = errno;
+        } else if (end && ftruncate(xfer->fd, end) < 0) {
+            werrno = errno;
+            wtrunc = true;
+        }
+
+        virMutexLock(&xfer->lock);
+        xfer->buf = NULL;
+        xfer->werrno = werrno;
+        xfer->wtrunc = wtrunc;
+        virCondSignal(&xfer->cond);
+        if (werrno)
+            break;
+    }
+    virMutexUnlock(&xfer->lock);
+}
+
+/* Queue @len bytes from @buf for the writer thread, waiting for the
+ * previous buffer to drain first.  Returns -1 (with the writer's
+ * error reported) once the writer has failed. */
+static int
+runIOQueueWrite(runIOXfer *xfer, const char *fdoutname,
+                char *buf, size_t len, off_t end)
+{
+    int ret = -1;
+
+    virMutexLock(&xfer->lock);
+    while (xfer->buf && !xfer->werrno)
+        virCondWait(&xfer->cond, &xfer->lock);
+
+    if (xfer->werrno) {
+        virReportSystemError(xfer->werrno,
+                             xfer->wtrunc ?
+                             _("Unable to truncate %s") :
+                             _("Unable to write %s"),
+                             fdoutname);
+        goto cleanup;
+    }
+
+    if (buf) {
+        xfer->buf = buf;
+        xfer->len = len;
+        xfer->end = end;
+    } else {
+        xfer->eof = true;
+    }
+    virCondSignal(&xfer->cond);
+    ret = 0;
+
+ cleanup:
+    virMutexUnlock(&xfer->lock);
+    return ret;
+}
+
 static int
 runIO(const char *path, int fd, int oflags, unsigned long long length)
 {
-    void *base = NULL; /* Location to be freed */
-    char *buf = NULL; /* Aligned location within base */
+    void *base[2] = { NULL, NULL }; /* Locations to be freed */
+    char *buffers[2] = { NULL, NULL }; /* Aligned locations within base */
+    char *buf;
+    size_t which = 0;
     size_t buflen = 1024*1024;
     intptr_t alignMask = 64*1024 - 1;
     int ret = -1;
@@ -85,20 +183,46 @@ runIO(const char *path, int fd, int oflags, unsigned long long length)
     unsigned long long total = 0;
     bool direct = O_DIRECT && ((oflags & O_DIRECT) != 0);
     bool shortRead = false; /* true if we hit a short read */
+    bool haveWriter = false;
     off_t end = 0;
+    const char *buflenStr;
+    runIOXfer xfer;
+    virThread writer;
+    size_t i;
+
+    memset(&xfer, 0, sizeof(xfer));
+
+    /* Block size can be tuned to match the storage; keep it a
+     * multiple of the alignment so O_DIRECT stays happy */
+    if ((buflenStr = virGetEnvBlockSUID("LIBVIRT_IOHELPER_BUFFER_BYTES"))) {
+        unsigned long tmplen;
+
+        if (virStrToLong_ul(buflenStr, NULL, 10, &tmplen) < 0 ||
+            tmplen == 0 || (tmplen & alignMask)) {
+            virReportSystemError(EINVAL,
+                                 _("Malformed iohelper buffer size %s"),
+                                 buflenStr);
+            goto cleanup;
+        }
+        buflen = tmplen;
+    }
 
+    /* Two buffers, so the writer thread can drain one block while
+     * the next one is being read */
+    for (i = 0; i < 2; i++) {
 #if HAVE_POSIX_MEMALIGN
-    if (posix_memalign(&base, alignMask + 1, buflen)) {
-        virReportOOMError();
-        goto cleanup;
-    }
-    buf = base;
+        if (posix_memalign(&base[i], alignMask + 1, buflen)) {
+            virReportOOMError();
+            goto cleanup;
+        }
+        buffers[i] = base[i];
 #else
-    if (VIR_ALLOC_N(buf, buflen + alignMask) < 0)
-        goto cleanup;
-    base = buf;
-    buf = (char *) (((intptr_t) base + alignMask) & ~alignMask);
+        if (VIR_ALLOC_N(buffers[i], buflen + alignMask) < 0)
+            goto cleanup;
+        base[i] = buffers[i];
+        buffers[i] = (char *) (((intptr_t) base[i] + alignMask) & ~alignMask);
 #endif
+    }
 
     switch (oflags & O_ACCMODE) {
     case O_RDONLY:
@@ -136,6 +260,21 @@ runIO(const char *path, int fd, int oflags, unsigned long long length)
         goto cleanup;
     }
 
+    if (virMutexInit(&xfer.lock) < 0 ||
+        virCondInit(&xfer.cond) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to initialize I/O thread state"));
+        goto cleanup;
+    }
+    xfer.fd = fdout;
+
+    if (virThreadCreate(&writer, true, runIOWriter, &xfer) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to create I/O writer thread"));
+        goto cleanup;
+    }
+    haveWriter = true;
+
     while (1) {
         ssize_t got;
 
@@ -146,6 +285,7 @@ runIO(const char *path, int fd, int oflags, unsigned long long length)
         if (buflen == 0)
             break; /* End of requested data from client */
 
+        buf = buffers[which];
         if ((got = saferead(fdin, buf, buflen)) < 0) {
             virReportSystemError(errno, _("Unable to read %s"), fdinname);
             goto cleanup;
@@ -167,14 +307,26 @@ runIO(const char *path, int fd, int oflags, unsigned long long length)
             memset(buf + got, 0, buflen - got);
             got = (got + alignMask) & ~alignMask;
         }
-        if (safewrite(fdout, buf, got) < 0) {
-            virReportSystemError(errno, _("Unable to write %s"), fdoutname);
-            goto cleanup;
-        }
-        if (end && ftruncate(fd, end) < 0) {
-            virReportSystemError(errno, _("Unable to truncate %s"), fdoutname);
+        /* Hand the block to the writer thread and flip to the other
+         * buffer, so the next read overlaps this write */
+        if (runIOQueueWrite(&xfer, fdoutname, buf, got, end) < 0)
             goto cleanup;
-        }
+        which = !which;
+        end = 0;
+    }
+
+    /* Wait for the last block to drain */
+    if (runIOQueueWrite(&xfer, fdoutname, NULL, 0, 0) < 0)
+        goto cleanup;
+    virThreadJoin(&writer);
+    haveWriter = false;
+    if (xfer.werrno) {
+        virReportSystemError(xfer.werrno,
+                             xfer.wtrunc ?
+                             _("Unable to truncate %s") :
+                             _("Unable to write %s"),
+                             fdoutname);
+        goto cleanup;
     }
 
     /* Ensure all data is written */
@@ -189,13 +341,22 @@ runIO(const char *path, int fd, int oflags, unsigned long long length)
     ret = 0;
 
  cleanup:
+    if (haveWriter) {
+        virMutexLock(&xfer.lock);
+        xfer.eof = true;
+        virCondSignal(&xfer.cond);
+        virMutexUnlock(&xfer.lock);
+        virThreadJoin(&writer);
+    }
+
     if (VIR_CLOSE(fd) < 0 &&
         ret == 0) {
         virReportSystemError(errno, _("Unable to close %s"), path);
         ret = -1;
     }
 
-    VIR_FREE(base);
+    VIR_FREE(base[0]);
+    VIR_FREE(base[1]);
     return ret;
 }
 
@@ -33,6 +33,8 @@
 #include "virfile.h"
 #include "viralloc.h"
 #include "virstring.h"
+#include "virthread.h"
+#include "virthreadpool.h"
 
 VIR_LOG_INIT("util.audit");
 
@@ -52,6 +54,100 @@ VIR_LOG_INIT("util.audit");
 
 #if WITH_AUDIT
 static int auditfd = -1;
+
+/* Submitting a record over the audit netlink socket blocks on the
+ * kernel's acknowledgement, which adds up when a guest with many
+ * devices emits a record per resource on start/stop.  A single
+ * worker preserves submission order while keeping the emitting
+ * thread off the netlink round trip; virAuditClose drains the
+ * queue so records are never discarded on orderly shutdown. */
+# define VIR_AUDIT_ASYNC_QUEUE_MAX 1000
+
+typedef struct _virAuditAsyncJob virAuditAsyncJob;
+typedef virAuditAsyncJob *virAuditAsyncJobPtr;
+struct _virAuditAsyncJob {
+    char *str;
+    char *clienttty;
+    char *clientaddr;
+    int record_type;
+    bool success;
+};
+
+static virThreadPoolPtr virAuditAsyncPool;
+static virMutex virAuditAsyncLock = VIR_MUTEX_INITIALIZER;
+static virCond virAuditAsyncCond;
+static size_t virAuditAsyncPending;
+
+static void
+virAuditAsyncJobFree(virAuditAsyncJobPtr job)
+{
+    if (!job)
+        return;
+    VIR_FREE(job->str);
+    VIR_FREE(job->clienttty);
+    VIR_FREE(job->clientaddr);
+    VIR_FREE(job);
+}
+
+static void
+virAuditAsyncWorker(void *jobdata, void *opaque ATTRIBUTE_UNUSED)
+{
+    virAuditAsyncJobPtr job = jobdata;
+
+    if (audit_log_user_message(auditfd, job->record_type, job->str, NULL,
+                               job->clientaddr, job->clienttty,
+                               job->success) < 0) {
+        char ebuf[1024];
+        VIR_WARN("Failed to send audit message %s: %s",
+                 NULLSTR(job->str), virStrerror(errno, ebuf, sizeof(ebuf)));
+    }
+
+    virAuditAsyncJobFree(job);
+
+    virMutexLock(&virAuditAsyncLock);
+    virAuditAsyncPending--;
+    virCondSignal(&virAuditAsyncCond);
+    virMutexUnlock(&virAuditAsyncLock);
+}
+
+static int
+virAuditSendAsync(int record_type,
+                  const char *str,
+                  const char *clienttty,
+                  const char *clientaddr,
+                  bool success)
+{
+    virAuditAsyncJobPtr job;
+
+    if (!virAuditAsyncPool)
+        return -1;
+
+    if (VIR_ALLOC_QUIET(job) < 0)
+        return -1;
+
+    job->record_type = record_type;
+    job->success = success;
+    if (VIR_STRDUP_QUIET(job->str, str) < 0 ||
+        VIR_STRDUP_QUIET(job->clienttty, clienttty) < 0 ||
+        VIR_STRDUP_QUIET(job->clientaddr, clientaddr) < 0)
+        goto error;
+
+    virMutexLock(&virAuditAsyncLock);
+    if (virThreadPoolGetJobQueueDepth(virAuditAsyncPool) >=
+        VIR_AUDIT_ASYNC_QUEUE_MAX ||
+        virThreadPoolSendJob(virAuditAsyncPool, 0, job) < 0) {
+        virMutexUnlock(&virAuditAsyncLock);
+        goto error;
+    }
+    virAuditAsyncPending++;
+    virMutexUnlock(&virAuditAsyncLock);
+
+    return 0;
+
+ error:
+    virAuditAsyncJobFree(job);
+    return -1;
+}
 #endif
 static bool auditlog;
 
@@ -63,6 +159,13 @@ int virAuditOpen(void)
         return -1;
     }
 
+    /* Failure to set up the async submission path is not fatal;
+     * records are then sent synchronously as before */
+    if (virCondInit(&virAuditAsyncCond) < 0 ||
+        !(virAuditAsyncPool = virThreadPoolNew(1, 1, 0,
+                                               virAuditAsyncWorker, NULL)))
+        VIR_WARN("Failed to create audit worker; auditing synchronously");
+
     return 0;
 #else
     return -1;
@@ -124,7 +227,10 @@ void virAuditSend(virLogSourcePtr source,
 
         if (type >= ARRAY_CARDINALITY(record_types) || record_types[type] == 0)
             VIR_WARN("Unknown audit record type %d", type);
-        else if (audit_log_user_message(auditfd, record_types[type], str, NULL,
+        else if (virAuditSendAsync(record_types[type], str,
+                                   clienttty, clientaddr, success) == 0) {
+            /* queued for the worker; nothing more to do */
+        } else if (audit_log_user_message(auditfd, record_types[type], str, NULL,
                                         clientaddr, clienttty, success) < 0) {
             char ebuf[1024];
             VIR_WARN("Failed to send audit message %s: %s",
@@ -138,6 +244,18 @@ void virAuditSend(virLogSourcePtr source,
 void virAuditClose(void)
 {
 #if WITH_AUDIT
+    if (virAuditAsyncPool) {
+        /* drain pending records before tearing the pool down; freeing
+         * it with jobs still queued would discard them */
+        virMutexLock(&virAuditAsyncLock);
+        while (virAuditAsyncPending > 0)
+            ignore_value(virCondWait(&virAuditAsyncCond, &virAuditAsyncLock));
+        virMutexUnlock(&virAuditAsyncLock);
+        virThreadPoolFree(virAuditAsyncPool);
+        virAuditAsyncPool = NULL;
+        virCondDestroy(&virAuditAsyncCond);
+    }
+
     VIR_FORCE_CLOSE(auditfd);
 #endif
 }
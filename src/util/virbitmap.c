@@ -40,18 +40,8 @@
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
-struct _virBitmap {
-    size_t max_bit;
-    size_t map_len;
-    size_t map_alloc;
-    unsigned long *map;
-};
-
-
-#define VIR_BITMAP_BITS_PER_UNIT  ((int) sizeof(unsigned long) * CHAR_BIT)
-#define VIR_BITMAP_UNIT_OFFSET(b) ((b) / VIR_BITMAP_BITS_PER_UNIT)
-#define VIR_BITMAP_BIT_OFFSET(b)  ((b) % VIR_BITMAP_BITS_PER_UNIT)
-#define VIR_BITMAP_BIT(b)         (1UL << VIR_BITMAP_BIT_OFFSET(b))
+/* the bitmap structure, the unit macros and the bit test helpers live
+ * in virbitmap.h so the tests can be inlined into hot paths */
 
 
 /**
@@ -187,7 +177,7 @@ int virBitmapSetBit(virBitmapPtr bitmap, size_t b)
  */
 static int virBitmapExpand(virBitmapPtr map, size_t b)
 {
-    size_t new_len = VIR_DIV_UP(b, VIR_BITMAP_BITS_PER_UNIT);
+    size_t new_len = VIR_DIV_UP(b + 1, VIR_BITMAP_BITS_PER_UNIT);
 
     /* resize the memory if necessary */
     if (map->map_len < new_len) {
@@ -265,30 +255,6 @@ int virBitmapClearBitExpand(virBitmapPtr bitmap, size_t b)
 }
 
 
-/* Helper function. caller must ensure b < bitmap->max_bit */
-static bool virBitmapIsSet(virBitmapPtr bitmap, size_t b)
-{
-    return !!(bitmap->map[VIR_BITMAP_UNIT_OFFSET(b)] & VIR_BITMAP_BIT(b));
-}
-
-/**
- * virBitmapIsBitSet:
- * @bitmap: Pointer to bitmap
- * @b: bit position to get
- *
- * Get setting of bit position @b in @bitmap.
- *
- * If @b is in the range of @bitmap, returns the value of the bit.
- * Otherwise false is returned.
- */
-bool virBitmapIsBitSet(virBitmapPtr bitmap, size_t b)
-{
-    if (bitmap->max_bit <= b)
-        return false;
-
-    return virBitmapIsSet(bitmap, b);
-}
-
 /**
  * virBitmapGetBit:
  * @bitmap: Pointer to bitmap
@@ -358,7 +324,7 @@ char *virBitmapFormat(virBitmapPtr bitmap)
 {
     virBuffer buf = VIR_BUFFER_INITIALIZER;
     bool first = true;
-    int start, cur, prev;
+    ssize_t start, cur, last;
 
     if (!bitmap || (cur = virBitmapNextSetBit(bitmap, -1)) < 0) {
         char *ret;
@@ -366,28 +332,26 @@ char *virBitmapFormat(virBitmapPtr bitmap)
         return ret;
     }
 
-    start = prev = cur;
-    while (prev >= 0) {
-        cur = virBitmapNextSetBit(bitmap, prev);
-
-        if (cur == prev + 1) {
-            prev = cur;
-            continue;
-        }
+    while (cur >= 0) {
+        start = cur;
 
-        /* cur < 0 or cur > prev + 1 */
+        /* Find the end of the run of set bits word-at-a-time via
+         * virBitmapNextClearBit rather than stepping bit by bit */
+        if ((last = virBitmapNextClearBit(bitmap, cur)) < 0)
+            last = bitmap->max_bit;
+        last--;
 
         if (!first)
             virBufferAddLit(&buf, ",");
         else
             first = false;
 
-        if (prev == start)
-            virBufferAsprintf(&buf, "%d", start);
+        if (last == start)
+            virBufferAsprintf(&buf, "%zd", start);
         else
-            virBufferAsprintf(&buf, "%d-%d", start, prev);
+            virBufferAsprintf(&buf, "%zd-%zd", start, last);
 
-        start = prev = cur;
+        cur = virBitmapNextSetBit(bitmap, last + 1);
     }
 
     if (virBufferError(&buf)) {
@@ -1112,3 +1076,54 @@ virBitmapSubtract(virBitmapPtr a,
     for (i = 0; i < max; i++)
         a->map[i] &= ~b->map[i];
 }
+
+/**
+ * virBitmapIntersect:
+ * @a: bitmap, modified to contain result
+ * @b: other bitmap
+ *
+ * Performs intersection of two bitmaps: a = intersect(a, b)
+ */
+void
+virBitmapIntersect(virBitmapPtr a,
+                   virBitmapPtr b)
+{
+    size_t i;
+    size_t max = a->map_len;
+
+    if (max > b->map_len)
+        max = b->map_len;
+
+    for (i = 0; i < max; i++)
+        a->map[i] &= b->map[i];
+
+    /* Bits representable only in @a cannot be in the intersection */
+    for (; i < a->map_len; i++)
+        a->map[i] = 0;
+}
+
+/**
+ * virBitmapUnion:
+ * @a: bitmap, modified to contain result
+ * @b: other bitmap
+ *
+ * Performs union of two bitmaps: a = union(a, b). @a is expanded as
+ * necessary if @b is the larger of the two.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virBitmapUnion(virBitmapPtr a,
+               virBitmapPtr b)
+{
+    size_t i;
+
+    if (a->max_bit < b->max_bit &&
+        virBitmapExpand(a, b->max_bit - 1) < 0)
+        return -1;
+
+    for (i = 0; i < b->map_len; i++)
+        a->map[i] |= b->map[i];
+
+    return 0;
+}
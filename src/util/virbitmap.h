@@ -26,12 +26,47 @@
 
 # include "internal.h"
 
+# include <limits.h>
 # include <sys/types.h>
 
 
 typedef struct _virBitmap virBitmap;
 typedef virBitmap *virBitmapPtr;
 
+/* The layout is exposed here only so that the bit test below can be
+ * inlined into hot paths such as capability checks; treat the members
+ * as private to virbitmap.c and use the accessors */
+struct _virBitmap {
+    size_t max_bit;
+    size_t map_len;
+    size_t map_alloc;
+    unsigned long *map;
+};
+
+# define VIR_BITMAP_BITS_PER_UNIT  ((int) sizeof(unsigned long) * CHAR_BIT)
+# define VIR_BITMAP_UNIT_OFFSET(b) ((b) / VIR_BITMAP_BITS_PER_UNIT)
+# define VIR_BITMAP_BIT_OFFSET(b)  ((b) % VIR_BITMAP_BITS_PER_UNIT)
+# define VIR_BITMAP_BIT(b)         (1UL << VIR_BITMAP_BIT_OFFSET(b))
+
+/* Helper function. caller must ensure b < bitmap->max_bit */
+static inline bool
+virBitmapIsSet(virBitmapPtr bitmap, size_t b)
+{
+    return !!(bitmap->map[VIR_BITMAP_UNIT_OFFSET(b)] & VIR_BITMAP_BIT(b));
+}
+
+/*
+ * Get bit @b in @bitmap. Returns false if b is out of range.
+ */
+static inline bool
+virBitmapIsBitSet(virBitmapPtr bitmap, size_t b)
+{
+    if (bitmap->max_bit <= b)
+        return false;
+
+    return virBitmapIsSet(bitmap, b);
+}
+
 /*
  * Allocate a bitmap capable of containing @size bits.
  */
@@ -69,11 +104,6 @@ int virBitmapClearBit(virBitmapPtr bitmap, size_t b)
 int virBitmapClearBitExpand(virBitmapPtr bitmap, size_t b)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_RETURN_CHECK;
 
-/*
- * Get bit @b in @bitmap. Returns false if b is out of range.
- */
-bool virBitmapIsBitSet(virBitmapPtr bitmap, size_t b)
-    ATTRIBUTE_NONNULL(1) ATTRIBUTE_RETURN_CHECK;
 /*
  * Get setting of bit position @b in @bitmap and store in @result
  */
@@ -148,4 +178,10 @@ bool virBitmapOverlaps(virBitmapPtr b1,
 void virBitmapSubtract(virBitmapPtr a, virBitmapPtr b)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
 
+void virBitmapIntersect(virBitmapPtr a, virBitmapPtr b)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
+
+int virBitmapUnion(virBitmapPtr a, virBitmapPtr b)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2) ATTRIBUTE_RETURN_CHECK;
+
 #endif
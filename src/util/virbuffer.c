@@ -117,7 +117,7 @@ virBufferGetIndent(const virBuffer *buf, bool dynamic)
 static int
 virBufferGrow(virBufferPtr buf, unsigned int len)
 {
-    int size;
+    unsigned int size;
 
     if (buf->error)
         return -1;
@@ -127,6 +127,13 @@ virBufferGrow(virBufferPtr buf, unsigned int len)
 
     size = buf->use + len + 1000;
 
+    /* Grow geometrically, so that the number of reallocations (and
+     * full content copies) stays logarithmic when a large document
+     * is built up from many small appends */
+    if (buf->size < UINT_MAX / 2 &&
+        size < buf->size * 2)
+        size = buf->size * 2;
+
     if (VIR_REALLOC_N_QUIET(buf->content, size) < 0) {
         virBufferSetError(buf, errno);
         return -1;
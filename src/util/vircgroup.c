@@ -472,10 +472,61 @@ virCgroupDetectMountsFromFile(virCgroupPtr group,
     return -1;
 }
 
+static virMutex virCgroupMountCacheLock = VIR_MUTEX_INITIALIZER;
+static virCgroup virCgroupMountCache;
+static bool virCgroupMountCacheValid;
+
+/**
+ * virCgroupClearMountCache:
+ *
+ * Forget the cached controller mount table, forcing the next
+ * detection to parse /proc/mounts again. Only needed by the test
+ * suite, which simulates several different mount layouts within a
+ * single process.
+ */
+void
+virCgroupClearMountCache(void)
+{
+    size_t i;
+
+    virMutexLock(&virCgroupMountCacheLock);
+    for (i = 0; i < VIR_CGROUP_CONTROLLER_LAST; i++) {
+        VIR_FREE(virCgroupMountCache.controllers[i].mountPoint);
+        VIR_FREE(virCgroupMountCache.controllers[i].linkPoint);
+    }
+    virCgroupMountCacheValid = false;
+    virMutexUnlock(&virCgroupMountCacheLock);
+}
+
 static int
 virCgroupDetectMounts(virCgroupPtr group)
 {
-    return virCgroupDetectMountsFromFile(group, "/proc/mounts", true);
+    int ret = -1;
+    size_t i;
+
+    /* The controller mounts are established by the init system early
+     * during boot and don't change while the daemon is running, so
+     * /proc/mounts is parsed only once and every subsequently created
+     * group copies the cached layout */
+    virMutexLock(&virCgroupMountCacheLock);
+
+    if (!virCgroupMountCacheValid) {
+        if (virCgroupDetectMountsFromFile(&virCgroupMountCache,
+                                          "/proc/mounts", true) < 0) {
+            for (i = 0; i < VIR_CGROUP_CONTROLLER_LAST; i++) {
+                VIR_FREE(virCgroupMountCache.controllers[i].mountPoint);
+                VIR_FREE(virCgroupMountCache.controllers[i].linkPoint);
+            }
+            goto cleanup;
+        }
+        virCgroupMountCacheValid = true;
+    }
+
+    ret = virCgroupCopyMounts(group, &virCgroupMountCache);
+
+ cleanup:
+    virMutexUnlock(&virCgroupMountCacheLock);
+    return ret;
 }
 
 
@@ -779,6 +830,83 @@ virCgroupGetBlockDevString(const char *path)
 }
 
 
+/*
+ * virCgroupDirOpen:
+ *
+ * (Re)open the cached directory FD for @ctrl.  Returns the FD on
+ * success, -1 on failure without reporting an error.
+ */
+static int
+virCgroupDirOpen(struct virCgroupController *ctrl)
+{
+    char *dirpath = NULL;
+
+    if (virAsprintfQuiet(&dirpath, "%s%s", ctrl->mountPoint,
+                         ctrl->placement) < 0)
+        return -1;
+
+    ctrl->dirfd = open(dirpath, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    VIR_FREE(dirpath);
+    return ctrl->dirfd;
+}
+
+
+/*
+ * virCgroupFileOpenAt:
+ *
+ * Open @key relative to the controller directory of @group via a
+ * cached directory FD, so that repeated parameter reads and writes
+ * (e.g. bulk stats polling across many domains) do not walk the full
+ * cgroup mount path on every access.  The directory FD is opened on
+ * demand and refreshed once if the kernel directory was removed and
+ * recreated behind our back.
+ *
+ * Returns the open FD on success, -1 on failure with no error
+ * reported; callers fall back to plain full-path access.
+ */
+static int
+virCgroupFileOpenAt(virCgroupPtr group,
+                    int controller,
+                    const char *key,
+                    int oflags)
+{
+    struct virCgroupController *ctrl;
+    int fd;
+    size_t i;
+
+    if (controller == -1) {
+        /* Same resolution rule as virCgroupPathOfController */
+        for (i = 0; i < VIR_CGROUP_CONTROLLER_LAST; i++) {
+            if (group->controllers[i].mountPoint &&
+                group->controllers[i].placement &&
+                STRNEQ(group->controllers[i].placement, "/")) {
+                controller = i;
+                break;
+            }
+        }
+        if (controller == -1)
+            return -1;
+    }
+
+    ctrl = &group->controllers[controller];
+    if (!ctrl->mountPoint || !ctrl->placement)
+        return -1;
+
+    if (ctrl->dirfd == -1 &&
+        virCgroupDirOpen(ctrl) < 0)
+        return -1;
+
+    if ((fd = openat(ctrl->dirfd, key, oflags | O_CLOEXEC)) < 0) {
+        VIR_FORCE_CLOSE(ctrl->dirfd);
+        if (virCgroupDirOpen(ctrl) < 0)
+            return -1;
+        fd = openat(ctrl->dirfd, key, oflags | O_CLOEXEC);
+    }
+
+    return fd;
+}
+
+
 static int
 virCgroupSetValueStr(virCgroupPtr group,
                      int controller,
@@ -788,12 +916,23 @@ virCgroupSetValueStr(virCgroupPtr group,
     int ret = -1;
     char *keypath = NULL;
     char *tmp = NULL;
+    int fd = -1;
+    int rc;
 
     if (virCgroupPathOfController(group, controller, key, &keypath) < 0)
         return -1;
 
     VIR_DEBUG("Set value '%s' to '%s'", keypath, value);
-    if (virFileWriteStr(keypath, value, 0) < 0) {
+    if ((fd = virCgroupFileOpenAt(group, controller, key, O_WRONLY)) >= 0) {
+        if (safewrite(fd, value, strlen(value)) == (ssize_t) strlen(value))
+            rc = 0;
+        else
+            rc = -1;
+        VIR_FORCE_CLOSE(fd);
+    } else {
+        rc = virFileWriteStr(keypath, value, 0);
+    }
+    if (rc < 0) {
         if (errno == EINVAL &&
             (tmp = strrchr(keypath, '/'))) {
             virReportSystemError(errno,
@@ -822,6 +961,7 @@ virCgroupGetValueStr(virCgroupPtr group,
 {
     char *keypath = NULL;
     int ret = -1, rc;
+    int fd = -1;
 
     *value = NULL;
 
@@ -830,7 +970,13 @@ virCgroupGetValueStr(virCgroupPtr group,
 
     VIR_DEBUG("Get value %s", keypath);
 
-    if ((rc = virFileReadAll(keypath, 1024*1024, value)) < 0) {
+    if ((fd = virCgroupFileOpenAt(group, controller, key, O_RDONLY)) >= 0) {
+        rc = virFileReadLimFD(fd, 1024*1024, value);
+        VIR_FORCE_CLOSE(fd);
+    } else {
+        rc = virFileReadAll(keypath, 1024*1024, value);
+    }
+    if (rc < 0) {
         virReportSystemError(errno,
                              _("Unable to read from '%s'"), keypath);
         goto cleanup;
@@ -1153,6 +1299,8 @@ virCgroupNew(pid_t pid,
              int controllers,
              virCgroupPtr *group)
 {
+    size_t i;
+
     VIR_DEBUG("pid=%lld path=%s parent=%p controllers=%d group=%p",
               (long long) pid, path, parent, controllers, group);
     *group = NULL;
@@ -1160,6 +1308,9 @@ virCgroupNew(pid_t pid,
     if (VIR_ALLOC((*group)) < 0)
         goto error;
 
+    for (i = 0; i < VIR_CGROUP_CONTROLLER_LAST; i++)
+        (*group)->controllers[i].dirfd = -1;
+
     if (path[0] == '/' || !parent) {
         if (VIR_STRDUP((*group)->path, path) < 0)
             goto error;
@@ -1769,6 +1920,7 @@ virCgroupFree(virCgroupPtr *group)
         VIR_FREE((*group)->controllers[i].mountPoint);
         VIR_FREE((*group)->controllers[i].linkPoint);
         VIR_FREE((*group)->controllers[i].placement);
+        VIR_FORCE_CLOSE((*group)->controllers[i].dirfd);
     }
 
     VIR_FREE((*group)->path);
@@ -4114,6 +4266,12 @@ virCgroupDetectMountsFromFile(virCgroupPtr group ATTRIBUTE_UNUSED,
 }
 
 
+void
+virCgroupClearMountCache(void)
+{
+}
+
+
 int
 virCgroupNewPartition(const char *path ATTRIBUTE_UNUSED,
                       bool create ATTRIBUTE_UNUSED,
@@ -40,6 +40,12 @@ struct virCgroupController {
      */
     char *linkPoint;
     char *placement;
+    /* Cached FD of the mountPoint + placement directory, lazily
+     * opened so parameter files can be reached via openat() without
+     * walking the full cgroup mount path on every access; -1 when
+     * not (yet) open
+     */
+    int dirfd;
 };
 
 struct virCgroup {
@@ -52,4 +58,6 @@ int virCgroupDetectMountsFromFile(virCgroupPtr group,
                                   const char *path,
                                   bool checkLinks);
 
+void virCgroupClearMountCache(void);
+
 #endif /* __VIR_CGROUP_PRIV_H__ */
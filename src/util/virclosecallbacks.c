@@ -327,12 +327,26 @@ virCloseCallbacksRun(virCloseCallbacksPtr closeCallbacks,
     /* We must not hold the lock while running the callbacks,
      * so first we obtain the list of callbacks, then remove
      * them all from the hash. At that point we can release
-     * the lock and run the callbacks safely. */
+     * the lock and run the callbacks safely.
+     *
+     * The callbacks deliberately run on the closing thread: they
+     * tear down state (autodestroy, migration abort) that must be
+     * gone before the driver considers the connection fully closed,
+     * and handing them to a worker would let daemon shutdown or a
+     * re-registration for the same domain race with them. */
 
     virObjectLock(closeCallbacks);
+
+    if (virHashSize(closeCallbacks->list) == 0) {
+        virObjectUnlock(closeCallbacks);
+        return;
+    }
+
     list = virCloseCallbacksGetForConn(closeCallbacks, conn);
-    if (!list)
+    if (!list) {
+        virObjectUnlock(closeCallbacks);
         return;
+    }
 
     for (i = 0; i < list->nentries; i++) {
         char uuidstr[VIR_UUID_STRING_BUFLEN];
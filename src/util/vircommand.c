@@ -31,6 +31,10 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#if HAVE_POSIX_SPAWN
+# include <spawn.h>
+#endif
+
 #if WITH_CAPNG
 # include <cap-ng.h>
 #endif
@@ -78,12 +82,26 @@ struct _virCommandFD {
     unsigned int flags;
 };
 
+typedef struct _virCommandArgChunk virCommandArgChunk;
+typedef virCommandArgChunk *virCommandArgChunkPtr;
+
+/* Storage for the argv strings of a command; the many small strings
+ * are packed into a few larger chunks owned by the command rather
+ * than allocated one by one */
+struct _virCommandArgChunk {
+    virCommandArgChunkPtr next;
+    size_t used;
+    size_t size;
+    char *data;
+};
+
 struct _virCommand {
     int has_error; /* ENOMEM on allocation failure, -1 for anything else.  */
 
     char **args;
     size_t nargs;
     size_t maxargs;
+    virCommandArgChunkPtr argPool; /* owns the strings in 'args' */
 
     char **env;
     size_t nenv;
@@ -464,6 +482,185 @@ virCommandHandshakeChild(virCommandPtr cmd)
     return 0;
 }
 
+# if HAVE_POSIX_SPAWN
+
+extern char **environ;
+
+/*
+ * virExecSpawnEligible:
+ *
+ * Check whether @cmd needs any work done between fork and exec:
+ * hooks, identity or limit changes, security labels, daemonizing,
+ * FD passing or handshakes all force the plain fork path.  Only
+ * commands with plain stdio wiring can take the posix_spawn fast
+ * path.
+ */
+static bool
+virExecSpawnEligible(virCommandPtr cmd)
+{
+    if (cmd->hook ||
+        cmd->pwd ||
+        cmd->npassfd ||
+        cmd->handshake ||
+        cmd->pidfile ||
+        cmd->mask ||
+        cmd->uid != (uid_t)-1 ||
+        cmd->gid != (gid_t)-1 ||
+        cmd->capabilities ||
+        cmd->maxMemLock ||
+        cmd->maxProcesses ||
+        cmd->maxFiles ||
+        cmd->setMaxCore ||
+        (cmd->flags & (VIR_EXEC_DAEMON | VIR_EXEC_CLEAR_CAPS |
+                       VIR_EXEC_LISTEN_FDS)))
+        return false;
+
+#  if defined(WITH_SECDRIVER_SELINUX)
+    if (cmd->seLinuxLabel)
+        return false;
+#  endif
+#  if defined(WITH_SECDRIVER_APPARMOR)
+    if (cmd->appArmorProfile)
+        return false;
+#  endif
+
+    return true;
+}
+
+/*
+ * virExecSpawn:
+ *
+ * Start @binary via posix_spawn, which on Linux shares the parent's
+ * page tables instead of duplicating them the way fork() does - a
+ * significant saving when the daemon has a large address space.  The
+ * child setup of the fork path is mirrored for eligible commands:
+ * stdio is wired up with dup2 actions, every other currently open FD
+ * gets a close action (so we do not depend on perfect O_CLOEXEC
+ * hygiene), signal handlers are reset and the signal mask cleared.
+ *
+ * Returns the child PID on success, or -1 on failure with no error
+ * reported; the caller is expected to fall back to virFork().
+ */
+static pid_t
+virExecSpawn(virCommandPtr cmd,
+             const char *binary,
+             int childin,
+             int childout,
+             int childerr)
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t sigdfl;
+    sigset_t sigmask;
+    DIR *dir = NULL;
+    struct dirent *ent;
+    int *fds = NULL;
+    size_t nfds = 0;
+    size_t i;
+    pid_t pid = -1;
+    int dfd;
+    int rc;
+
+    /* The fork path inherits low FDs in place, which would need the
+     * same-FD dup2 semantics that older libcs do not honour; leave
+     * such rare commands to virFork() */
+    if (childin <= STDERR_FILENO ||
+        childout <= STDERR_FILENO ||
+        childerr <= STDERR_FILENO)
+        return -1;
+
+    /* Collect the list of currently open FDs; the directory FD itself
+     * is closed again before spawning, so it is excluded here */
+    if (virDirOpenQuiet(&dir, "/proc/self/fd") < 0)
+        return -1;
+
+    dfd = dirfd(dir);
+    while ((rc = virDirRead(dir, &ent, NULL)) > 0) {
+        int fd;
+
+        if (virStrToLong_i(ent->d_name, NULL, 10, &fd) < 0)
+            break;
+
+        if (fd <= STDERR_FILENO ||
+            fd == dfd ||
+            fd == childin || fd == childout || fd == childerr)
+            continue;
+
+        if (VIR_APPEND_ELEMENT_QUIET(fds, nfds, fd) < 0)
+            break;
+    }
+    VIR_DIR_CLOSE(dir);
+    if (rc != 0) {
+        VIR_FREE(fds);
+        return -1;
+    }
+
+    if (posix_spawn_file_actions_init(&actions) != 0) {
+        VIR_FREE(fds);
+        return -1;
+    }
+
+    if (posix_spawnattr_init(&attr) != 0) {
+        posix_spawn_file_actions_destroy(&actions);
+        VIR_FREE(fds);
+        return -1;
+    }
+
+    if (posix_spawn_file_actions_adddup2(&actions, childin,
+                                         STDIN_FILENO) != 0 ||
+        posix_spawn_file_actions_adddup2(&actions, childout,
+                                         STDOUT_FILENO) != 0 ||
+        posix_spawn_file_actions_adddup2(&actions, childerr,
+                                         STDERR_FILENO) != 0)
+        goto cleanup;
+
+    /* Register a close action for every other open FD to match the
+     * mass close done by the fork path.  An FD closed by another
+     * thread in the meantime makes posix_spawn fail, which is handled
+     * by falling back to virFork() */
+    for (i = 0; i < nfds; i++) {
+        if (posix_spawn_file_actions_addclose(&actions, fds[i]) != 0)
+            goto cleanup;
+    }
+
+    /* Close the stdio originals once they are duped, as the fork
+     * path does */
+    if (posix_spawn_file_actions_addclose(&actions, childin) != 0 ||
+        (childout != childin &&
+         posix_spawn_file_actions_addclose(&actions, childout) != 0) ||
+        (childerr != childin && childerr != childout &&
+         posix_spawn_file_actions_addclose(&actions, childerr) != 0))
+        goto cleanup;
+
+    /* Default all signal handlers and clear the mask, as virFork()
+     * does before exec */
+    sigfillset(&sigdfl);
+    sigemptyset(&sigmask);
+    if (posix_spawnattr_setsigdefault(&attr, &sigdfl) != 0 ||
+        posix_spawnattr_setsigmask(&attr, &sigmask) != 0 ||
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF |
+                                 POSIX_SPAWN_SETSIGMASK) != 0)
+        goto cleanup;
+
+    if ((rc = posix_spawn(&pid, binary, &actions, &attr, cmd->args,
+                          cmd->env ? cmd->env : environ)) != 0) {
+        VIR_DEBUG("posix_spawn of %s failed: %d, falling back to fork",
+                  binary, rc);
+        pid = -1;
+        goto cleanup;
+    }
+
+    VIR_DEBUG("Spawned %s pid=%lld", binary, (long long)pid);
+
+ cleanup:
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    VIR_FREE(fds);
+    return pid;
+}
+
+# endif /* HAVE_POSIX_SPAWN */
+
 /*
  * virExec:
  * @cmd virCommandPtr containing all information about the program to
@@ -559,7 +756,14 @@ virExec(virCommandPtr cmd)
     if ((ngroups = virGetGroupList(cmd->uid, cmd->gid, &groups)) < 0)
         goto cleanup;
 
-    pid = virFork();
+    pid = -1;
+# if HAVE_POSIX_SPAWN
+    if (virExecSpawnEligible(cmd))
+        pid = virExecSpawn(cmd, binary, childin, childout, childerr);
+# endif
+
+    if (pid < 0)
+        pid = virFork();
 
     if (pid < 0)
         goto cleanup;
@@ -1472,6 +1676,54 @@ virCommandAddEnvPassCommon(virCommandPtr cmd)
     virCommandAddEnvPassBlockSUID(cmd, "TMPDIR", NULL);
 }
 
+#define VIR_COMMAND_ARG_CHUNK_SIZE 4096
+
+/* Copy @val into the command's argument string pool, returning the
+ * pooled copy or NULL on allocation failure. The copies live until
+ * virCommandFree */
+static char *
+virCommandArgPoolStrdup(virCommandPtr cmd, const char *val)
+{
+    virCommandArgChunkPtr chunk = cmd->argPool;
+    size_t len = strlen(val) + 1;
+    char *ret;
+
+    if (!chunk || chunk->size - chunk->used < len) {
+        size_t size = VIR_COMMAND_ARG_CHUNK_SIZE;
+
+        if (size < len)
+            size = len;
+        if (VIR_ALLOC(chunk) < 0)
+            return NULL;
+        if (VIR_ALLOC_N(chunk->data, size) < 0) {
+            VIR_FREE(chunk);
+            return NULL;
+        }
+        chunk->size = size;
+        chunk->next = cmd->argPool;
+        cmd->argPool = chunk;
+    }
+
+    ret = chunk->data + chunk->used;
+    memcpy(ret, val, len);
+    chunk->used += len;
+    return ret;
+}
+
+
+static void
+virCommandArgPoolFree(virCommandPtr cmd)
+{
+    while (cmd->argPool) {
+        virCommandArgChunkPtr next = cmd->argPool->next;
+
+        VIR_FREE(cmd->argPool->data);
+        VIR_FREE(cmd->argPool);
+        cmd->argPool = next;
+    }
+}
+
+
 /**
  * virCommandAddArg:
  * @cmd: the command to modify
@@ -1487,14 +1739,13 @@ virCommandAddArg(virCommandPtr cmd, const char *val)
     if (!cmd || cmd->has_error)
         return;
 
-    if (VIR_STRDUP_QUIET(arg, val) < 0) {
+    if (!(arg = virCommandArgPoolStrdup(cmd, val))) {
         cmd->has_error = ENOMEM;
         return;
     }
 
     /* Arg plus trailing NULL. */
     if (VIR_RESIZE_N(cmd->args, cmd->maxargs, cmd->nargs, 1 + 1) < 0) {
-        VIR_FREE(arg);
         cmd->has_error = ENOMEM;
         return;
     }
@@ -1514,27 +1765,22 @@ virCommandAddArg(virCommandPtr cmd, const char *val)
 void
 virCommandAddArgBuffer(virCommandPtr cmd, virBufferPtr buf)
 {
+    char *content;
+
     if (!cmd || cmd->has_error) {
         virBufferFreeAndReset(buf);
         return;
     }
 
-    /* Arg plus trailing NULL. */
-    if (virBufferError(buf) ||
-        VIR_RESIZE_N(cmd->args, cmd->maxargs, cmd->nargs, 1 + 1) < 0) {
+    if (virBufferError(buf)) {
         cmd->has_error = ENOMEM;
         virBufferFreeAndReset(buf);
         return;
     }
 
-    cmd->args[cmd->nargs] = virBufferContentAndReset(buf);
-    if (!cmd->args[cmd->nargs]) {
-        if (VIR_STRDUP_QUIET(cmd->args[cmd->nargs], "") < 0) {
-            cmd->has_error = ENOMEM;
-            return;
-        }
-    }
-    cmd->nargs++;
+    content = virBufferContentAndReset(buf);
+    virCommandAddArg(cmd, content ? content : "");
+    VIR_FREE(content);
 }
 
 
@@ -1563,14 +1809,8 @@ virCommandAddArgFormat(virCommandPtr cmd, const char *format, ...)
     }
     va_end(list);
 
-    /* Arg plus trailing NULL. */
-    if (VIR_RESIZE_N(cmd->args, cmd->maxargs, cmd->nargs, 1 + 1) < 0) {
-        VIR_FREE(arg);
-        cmd->has_error = ENOMEM;
-        return;
-    }
-
-    cmd->args[cmd->nargs++] = arg;
+    virCommandAddArg(cmd, arg);
+    VIR_FREE(arg);
 }
 
 /**
@@ -1620,7 +1860,7 @@ virCommandAddArgSet(virCommandPtr cmd, const char *const*vals)
     while (vals[narg] != NULL) {
         char *arg;
 
-        if (VIR_STRDUP_QUIET(arg, vals[narg++]) < 0) {
+        if (!(arg = virCommandArgPoolStrdup(cmd, vals[narg++]))) {
             cmd->has_error = ENOMEM;
             return;
         }
@@ -1660,7 +1900,7 @@ virCommandAddArgList(virCommandPtr cmd, ...)
         char *arg = va_arg(list, char *);
         if (!arg)
             break;
-        if (VIR_STRDUP_QUIET(arg, arg) < 0) {
+        if (!(arg = virCommandArgPoolStrdup(cmd, arg))) {
             cmd->has_error = ENOMEM;
             va_end(list);
             return;
@@ -2580,6 +2820,86 @@ virCommandWait(virCommandPtr cmd, int *exitstatus)
 }
 
 
+/* Number of commands a batch keeps in flight when the
+ * caller does not request a specific limit */
+#define VIR_COMMAND_BATCH_PARALLELISM 4
+
+/**
+ * virCommandRunBatch:
+ * @cmds: array of commands to run
+ * @ncmds: number of entries in @cmds
+ * @maxparallel: most commands to keep running at once, 0 for default
+ *
+ * Run all of @cmds, keeping at most @maxparallel of them in flight
+ * at any one time. Every command is waited for even after some have
+ * failed, so on return the caller can unconditionally clean up with
+ * virCommandFree.
+ *
+ * Returns 0 if every command succeeded. Returns -1 with an error
+ * aggregating the number of failures and the first failure's message
+ * if any of them failed.
+ */
+int
+virCommandRunBatch(virCommandPtr *cmds,
+                   size_t ncmds,
+                   size_t maxparallel)
+{
+    virErrorPtr firsterr = NULL;
+    bool *running = NULL;
+    size_t nfailed = 0;
+    size_t started = 0;
+    size_t waited = 0;
+    int ret = -1;
+
+    if (maxparallel == 0)
+        maxparallel = VIR_COMMAND_BATCH_PARALLELISM;
+
+    if (VIR_ALLOC_N(running, ncmds) < 0)
+        return -1;
+
+    while (waited < ncmds) {
+        while (started < ncmds &&
+               started - waited < maxparallel) {
+            if (virCommandRunAsync(cmds[started], NULL) < 0) {
+                nfailed++;
+                if (!firsterr)
+                    firsterr = virSaveLastError();
+            } else {
+                running[started] = true;
+            }
+            started++;
+        }
+
+        /* Waiting for the oldest command first keeps the window
+         * bounded without needing to poll for whichever child
+         * happens to exit next */
+        if (running[waited] &&
+            virCommandWait(cmds[waited], NULL) < 0) {
+            nfailed++;
+            if (!firsterr)
+                firsterr = virSaveLastError();
+        }
+        waited++;
+    }
+
+    if (nfailed) {
+        virReportError(VIR_ERR_OPERATION_FAILED,
+                       _("%zu of %zu commands failed: %s"),
+                       nfailed, ncmds,
+                       firsterr && firsterr->message ?
+                       firsterr->message : _("unknown error"));
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virFreeError(firsterr);
+    VIR_FREE(running);
+    return ret;
+}
+
+
 #ifndef WIN32
 /**
  * virCommandAbort:
@@ -2786,9 +3106,8 @@ virCommandFree(virCommandPtr cmd)
     VIR_FORCE_CLOSE(cmd->outfd);
     VIR_FORCE_CLOSE(cmd->errfd);
 
-    for (i = 0; i < cmd->nargs; i++)
-        VIR_FREE(cmd->args[i]);
     VIR_FREE(cmd->args);
+    virCommandArgPoolFree(cmd);
 
     for (i = 0; i < cmd->nenv; i++)
         VIR_FREE(cmd->env[i]);
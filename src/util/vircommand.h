@@ -177,6 +177,10 @@ int virCommandRun(virCommandPtr cmd,
 int virCommandRunAsync(virCommandPtr cmd,
                        pid_t *pid) ATTRIBUTE_RETURN_CHECK;
 
+int virCommandRunBatch(virCommandPtr *cmds,
+                       size_t ncmds,
+                       size_t maxparallel) ATTRIBUTE_RETURN_CHECK;
+
 int virCommandWait(virCommandPtr cmd,
                    int *exitstatus) ATTRIBUTE_RETURN_CHECK;
 
@@ -37,6 +37,7 @@
 #include "virlog.h"
 #include "viralloc.h"
 #include "virfile.h"
+#include "virhash.h"
 #include "virstring.h"
 #include "configmake.h"
 
@@ -102,6 +103,12 @@ struct _virConf {
     char *filename;
     unsigned int flags;
     virConfEntryPtr entries;
+    /* Index over the entry names for O(1) virConfGetValue() lookups.
+     * Maps to the first entry of a given name, matching the linear
+     * scan semantics.  NULL when the index could not be maintained
+     * (OOM) or for case-insensitive formats; lookups then fall back
+     * to walking the list.  The entries are owned by @entries. */
+    virHashTablePtr index;
 };
 
 /**
@@ -213,6 +220,12 @@ virConfCreate(const char *filename, unsigned int flags)
     }
 
     ret->flags = flags;
+
+    /* The VMX format needs case-insensitive lookups, which the hash
+     * cannot provide; those stay on the linear scan */
+    if (!(flags & VIR_CONF_FLAG_VMX_FORMAT))
+        ret->index = virHashCreate(16, NULL);
+
     return ret;
 }
 
@@ -246,6 +259,16 @@ virConfAddEntry(virConfPtr conf, char *name, virConfValuePtr value, char *comm)
     ret->value = value;
     ret->comment = comm;
 
+    /* Only the first entry of a given name is indexed, to match the
+     * first-match semantics of the linear scan.  If the index cannot
+     * be kept complete, drop it and fall back to scanning */
+    if (name && conf->index &&
+        !virHashLookup(conf->index, name) &&
+        virHashAddEntry(conf->index, name, ret) < 0) {
+        virHashFree(conf->index);
+        conf->index = NULL;
+    }
+
     if (conf->entries == NULL) {
         conf->entries = ret;
     } else {
@@ -851,6 +874,7 @@ virConfFree(virConfPtr conf)
         VIR_FREE(tmp);
         tmp = next;
     }
+    virHashFree(conf->index);
     VIR_FREE(conf->filename);
     VIR_FREE(conf);
     return 0;
@@ -874,6 +898,11 @@ virConfGetValue(virConfPtr conf, const char *setting)
     if (conf == NULL)
         return NULL;
 
+    if (conf->index) {
+        cur = virHashLookup(conf->index, setting);
+        return cur ? cur->value : NULL;
+    }
+
     cur = conf->entries;
     while (cur != NULL) {
         if ((cur->name != NULL) &&
@@ -1426,6 +1455,12 @@ virConfSetValue(virConfPtr conf,
             cur->next = conf->entries;
             conf->entries = cur;
         }
+        if (conf->index &&
+            !virHashLookup(conf->index, setting) &&
+            virHashAddEntry(conf->index, setting, cur) < 0) {
+            virHashFree(conf->index);
+            conf->index = NULL;
+        }
     } else {
         virConfFreeValue(cur->value);
         cur->value = value;
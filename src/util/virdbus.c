@@ -1907,3 +1907,21 @@ bool virDBusErrorIsUnknownMethod(virErrorPtr err)
         STREQ_NULLABLE("org.freedesktop.DBus.Error.UnknownMethod",
                        err->str1);
 }
+
+/* Distinguish "the service could not be reached right now" from a
+ * reply the service itself produced, so callers can fall back to not
+ * using the service at all */
+bool virDBusErrorIsServiceUnavailable(virErrorPtr err)
+{
+    if (err->domain != VIR_FROM_DBUS ||
+        err->code != VIR_ERR_DBUS_SERVICE ||
+        err->level != VIR_ERR_ERROR)
+        return false;
+
+    return STREQ_NULLABLE("org.freedesktop.DBus.Error.NoReply", err->str1) ||
+        STREQ_NULLABLE("org.freedesktop.DBus.Error.Timeout", err->str1) ||
+        STREQ_NULLABLE("org.freedesktop.DBus.Error.TimedOut", err->str1) ||
+        STREQ_NULLABLE("org.freedesktop.DBus.Error.ServiceUnknown", err->str1) ||
+        STREQ_NULLABLE("org.freedesktop.DBus.Error.NameHasNoOwner", err->str1) ||
+        STREQ_NULLABLE("org.freedesktop.DBus.Error.Disconnected", err->str1);
+}
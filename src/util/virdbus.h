@@ -75,4 +75,5 @@ int virDBusIsServiceEnabled(const char *name);
 int virDBusIsServiceRegistered(const char *name);
 
 bool virDBusErrorIsUnknownMethod(virErrorPtr err);
+bool virDBusErrorIsServiceUnavailable(virErrorPtr err);
 #endif /* __VIR_DBUS_H__ */
@@ -142,6 +142,35 @@ VIR_ENUM_IMPL(virErrorDomain, VIR_ERR_DOMAIN_LAST,
     )
 
 
+/*
+ * The thread local error is kept in a wrapper holding a fixed slab of
+ * string storage.  Raising an error formats into the slab without
+ * touching the heap; the strings are only copied into the public
+ * virError - whose fields must be individually heap allocated since
+ * callers may hand it to virResetError() - when something actually
+ * consumes the error.  Probe-heavy code that raises and then swallows
+ * errors therefore doesn't churn the allocator at all.
+ */
+#define VIR_ERROR_SLAB_STRLEN 1024
+
+typedef struct _virErrorSlab virErrorSlab;
+struct _virErrorSlab {
+    virError err;               /* public view, must be first */
+    bool pending;               /* slab holds an error newer than err */
+    int domain;
+    int code;
+    virErrorLevel level;
+    int int1;
+    int int2;
+    bool hasStr1;
+    bool hasStr2;
+    bool hasStr3;
+    char message[VIR_ERROR_SLAB_STRLEN];
+    char str1[VIR_ERROR_SLAB_STRLEN];
+    char str2[VIR_ERROR_SLAB_STRLEN];
+    char str3[VIR_ERROR_SLAB_STRLEN];
+};
+
 /*
  * Internal helper that is called when a thread exits, to
  * release the error object stored in the thread local
@@ -235,18 +264,58 @@ virErrorCopyNew(virErrorPtr err)
 }
 
 
-static virErrorPtr
-virLastErrorObject(void)
+static virErrorSlab *
+virLastErrorSlab(void)
 {
-    virErrorPtr err;
-    err = virThreadLocalGet(&virLastErr);
-    if (!err) {
-        if (VIR_ALLOC_QUIET(err) < 0)
+    virErrorSlab *slab;
+    slab = virThreadLocalGet(&virLastErr);
+    if (!slab) {
+        if (VIR_ALLOC_QUIET(slab) < 0)
             return NULL;
-        if (virThreadLocalSet(&virLastErr, err) < 0)
-            VIR_FREE(err);
+        if (virThreadLocalSet(&virLastErr, slab) < 0)
+            VIR_FREE(slab);
     }
-    return err;
+    return slab;
+}
+
+
+/*
+ * Copy an error still sitting in the slab into the public virError,
+ * whose strings live on the heap so that virResetError() keeps
+ * working on it.  No-op when there's nothing pending.
+ */
+static void
+virLastErrorMaterialize(virErrorSlab *slab)
+{
+    virErrorPtr to = &slab->err;
+
+    if (!slab->pending)
+        return;
+    slab->pending = false;
+
+    to->domain = slab->domain;
+    to->code = slab->code;
+    to->level = slab->level;
+    to->int1 = slab->int1;
+    to->int2 = slab->int2;
+    ignore_value(VIR_STRDUP_QUIET(to->message, slab->message));
+    if (slab->hasStr1)
+        ignore_value(VIR_STRDUP_QUIET(to->str1, slab->str1));
+    if (slab->hasStr2)
+        ignore_value(VIR_STRDUP_QUIET(to->str2, slab->str2));
+    if (slab->hasStr3)
+        ignore_value(VIR_STRDUP_QUIET(to->str3, slab->str3));
+}
+
+
+static virErrorPtr
+virLastErrorObject(void)
+{
+    virErrorSlab *slab = virLastErrorSlab();
+    if (!slab)
+        return NULL;
+    virLastErrorMaterialize(slab);
+    return &slab->err;
 }
 
 
@@ -305,13 +374,16 @@ int
 virSetError(virErrorPtr newerr)
 {
     virErrorPtr err;
+    virErrorSlab *slab;
     int saved_errno = errno;
     int ret = -1;
 
-    err = virLastErrorObject();
-    if (!err)
+    slab = virLastErrorSlab();
+    if (!slab)
         goto cleanup;
 
+    slab->pending = false;
+    err = &slab->err;
     virResetError(err);
     ret = virCopyError(newerr, err);
  cleanup:
@@ -413,9 +485,11 @@ virFreeError(virErrorPtr err)
 void
 virResetLastError(void)
 {
-    virErrorPtr err = virLastErrorObject();
-    if (err)
-        virResetError(err);
+    virErrorSlab *slab = virLastErrorSlab();
+    if (slab) {
+        slab->pending = false;
+        virResetError(&slab->err);
+    }
 }
 
 /**
@@ -709,8 +783,11 @@ virRaiseErrorFull(const char *filename,
                   const char *fmt, ...)
 {
     int save_errno = errno;
+    virErrorSlab *slab;
     virErrorPtr to;
     char *str;
+    bool fits = true;
+    virError logView;
     virLogMetadata meta[] = {
         { .key = "LIBVIRT_DOMAIN", .s = NULL, .iv = domain },
         { .key = "LIBVIRT_CODE", .s = NULL, .iv = code },
@@ -722,12 +799,14 @@ virRaiseErrorFull(const char *filename,
      * For compatibility, public API calls will copy them
      * to the per-connection error object when necessary
      */
-    to = virLastErrorObject();
-    if (!to) {
+    slab = virLastErrorSlab();
+    if (!slab) {
         errno = save_errno;
         return; /* Hit OOM allocating thread error object, sod all we can do now */
     }
 
+    slab->pending = false;
+    to = &slab->err;
     virResetError(to);
 
     if (code == VIR_ERR_OK) {
@@ -735,6 +814,57 @@ virRaiseErrorFull(const char *filename,
         return;
     }
 
+    /*
+     * Format into the slab; the strings only get copied onto the heap
+     * if the error is actually consumed, so a raise that is swallowed
+     * again (speculative probes, optional lookups) stays free of
+     * allocations.  Oversized strings fall back to the heap path.
+     */
+    if (fmt == NULL) {
+        if (!virStrcpyStatic(slab->message, _("No error message provided")))
+            fits = false;
+    } else {
+        va_list ap;
+        int rc;
+        va_start(ap, fmt);
+        rc = vsnprintf(slab->message, sizeof(slab->message), fmt, ap);
+        va_end(ap);
+        if (rc < 0 || rc >= (int)sizeof(slab->message))
+            fits = false;
+    }
+
+    slab->hasStr1 = str1 != NULL;
+    slab->hasStr2 = str2 != NULL;
+    slab->hasStr3 = str3 != NULL;
+    if (fits && str1 && !virStrcpyStatic(slab->str1, str1))
+        fits = false;
+    if (fits && str2 && !virStrcpyStatic(slab->str2, str2))
+        fits = false;
+    if (fits && str3 && !virStrcpyStatic(slab->str3, str3))
+        fits = false;
+
+    if (fits) {
+        slab->domain = domain;
+        slab->code = code;
+        slab->level = level;
+        slab->int1 = int1;
+        slab->int2 = int2;
+        slab->pending = true;
+
+        /* Log from the slab; only code, domain, level and message are
+         * consulted by the log priority filters */
+        memset(&logView, 0, sizeof(logView));
+        logView.domain = domain;
+        logView.code = code;
+        logView.level = level;
+        logView.message = slab->message;
+        virRaiseErrorLog(filename, funcname, linenr,
+                         &logView, meta);
+
+        errno = save_errno;
+        return;
+    }
+
     /*
      * formats the message; drop message on OOM situations
      */
@@ -797,16 +927,19 @@ void virRaiseErrorObject(const char *filename,
 {
     int saved_errno = errno;
     virErrorPtr err;
+    virErrorSlab *slab;
     virLogMetadata meta[] = {
         { .key = "LIBVIRT_DOMAIN", .s = NULL, .iv = newerr->domain },
         { .key = "LIBVIRT_CODE", .s = NULL, .iv = newerr->code },
         { .key = NULL },
     };
 
-    err = virLastErrorObject();
-    if (!err)
+    slab = virLastErrorSlab();
+    if (!slab)
         goto cleanup;
 
+    slab->pending = false;
+    err = &slab->err;
     virResetError(err);
     virCopyError(newerr, err);
     virRaiseErrorLog(filename, funcname, linenr,
@@ -26,6 +26,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <poll.h>
+#if HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif
 #include <sys/time.h>
 #include <errno.h>
 #include <unistd.h>
@@ -87,6 +90,13 @@ struct virEventPollLoop {
     size_t timeoutsCount;
     size_t timeoutsAlloc;
     struct virEventPollTimeout *timeouts;
+    /* Lower bound on the earliest expiry among active timers, used to
+       skip scanning the timeouts array on iterations where nothing
+       can have expired yet; 0 forces a full scan to recompute it */
+    unsigned long long timeoutsDeadline;
+#if HAVE_SYS_EPOLL_H
+    int epollfd;
+#endif
 };
 
 /* Only have one event loop */
@@ -98,6 +108,95 @@ static int nextWatch = 1;
 /* Unique ID for the next timer to be registered */
 static int nextTimer = 1;
 
+#if HAVE_SYS_EPOLL_H
+/* Max number of ready FDs harvested per epoll_wait call. Anything
+   beyond this is simply picked up on the next loop iteration */
+# define EVENT_EPOLL_MAX_EVENTS 64
+
+static int virEventPollToEpollEvents(int events)
+{
+    int ret = 0;
+    if (events & POLLIN)
+        ret |= EPOLLIN;
+    if (events & POLLOUT)
+        ret |= EPOLLOUT;
+    if (events & POLLERR)
+        ret |= EPOLLERR;
+    if (events & POLLHUP)
+        ret |= EPOLLHUP;
+    return ret;
+}
+
+static int virEventPollFromEpollEvents(int events)
+{
+    int ret = 0;
+    if (events & EPOLLIN)
+        ret |= POLLIN;
+    if (events & EPOLLOUT)
+        ret |= POLLOUT;
+    if (events & EPOLLERR)
+        ret |= POLLERR;
+    if (events & EPOLLHUP)
+        ret |= POLLHUP;
+    return ret;
+}
+
+/*
+ * Resync the epoll registration for @fd with the current set of
+ * watches. Multiple watches may share one FD, so the kernel is
+ * given the union of their requested events. Must be called with
+ * the eventLoop lock held.
+ *
+ * If the kernel refuses the FD (eg a plain file, which epoll
+ * cannot monitor but poll accepts), the epoll FD is torn down
+ * and the loop permanently falls back to poll.
+ */
+static void virEventPollEpollUpdateFD(int fd)
+{
+    struct epoll_event ev;
+    int events = 0;
+    int op;
+    size_t i;
+    char ebuf[1024];
+
+    if (eventLoop.epollfd < 0)
+        return;
+
+    for (i = 0; i < eventLoop.handlesCount; i++) {
+        if (eventLoop.handles[i].deleted ||
+            eventLoop.handles[i].fd != fd)
+            continue;
+        events |= eventLoop.handles[i].events;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = virEventPollToEpollEvents(events);
+    ev.data.fd = fd;
+
+    if (events)
+        op = EPOLL_CTL_ADD;
+    else
+        op = EPOLL_CTL_DEL;
+
+    if (epoll_ctl(eventLoop.epollfd, op, fd, &ev) < 0) {
+        if (op == EPOLL_CTL_ADD && errno == EEXIST) {
+            if (epoll_ctl(eventLoop.epollfd, EPOLL_CTL_MOD, fd, &ev) == 0)
+                return;
+        } else if (op == EPOLL_CTL_DEL &&
+                   (errno == ENOENT || errno == EBADF)) {
+            /* Already gone, or the caller closed the FD before
+             * removing the watch; the kernel cleaned up for us */
+            return;
+        }
+        VIR_WARN("Unable to update epoll for fd %d: %s, "
+                 "falling back to poll",
+                 fd, virStrerror(errno, ebuf, sizeof(ebuf)));
+        VIR_FORCE_CLOSE(eventLoop.epollfd);
+        eventLoop.epollfd = -1;
+    }
+}
+#endif /* HAVE_SYS_EPOLL_H */
+
 /*
  * Register a callback for monitoring file handle events.
  * NB, it *must* be safe to call this from within a callback
@@ -133,6 +232,9 @@ int virEventPollAddHandle(int fd, int events,
 
     eventLoop.handlesCount++;
 
+#if HAVE_SYS_EPOLL_H
+    virEventPollEpollUpdateFD(fd);
+#endif
     virEventPollInterruptLocked();
 
     PROBE(EVENT_POLL_ADD_HANDLE,
@@ -161,6 +263,9 @@ void virEventPollUpdateHandle(int watch, int events)
         if (eventLoop.handles[i].watch == watch) {
             eventLoop.handles[i].events =
                     virEventPollToNativeEvents(events);
+#if HAVE_SYS_EPOLL_H
+            virEventPollEpollUpdateFD(eventLoop.handles[i].fd);
+#endif
             virEventPollInterruptLocked();
             found = true;
             break;
@@ -198,6 +303,9 @@ int virEventPollRemoveHandle(int watch)
         if (eventLoop.handles[i].watch == watch) {
             EVENT_DEBUG("mark delete %zu %d", i, eventLoop.handles[i].fd);
             eventLoop.handles[i].deleted = 1;
+#if HAVE_SYS_EPOLL_H
+            virEventPollEpollUpdateFD(eventLoop.handles[i].fd);
+#endif
             virEventPollInterruptLocked();
             virMutexUnlock(&eventLoop.lock);
             return 0;
@@ -244,6 +352,11 @@ int virEventPollAddTimeout(int frequency,
     eventLoop.timeouts[eventLoop.timeoutsCount].expiresAt =
         frequency >= 0 ? frequency + now : 0;
 
+    if (frequency >= 0 &&
+        eventLoop.timeoutsDeadline != 0 &&
+        frequency + now < eventLoop.timeoutsDeadline)
+        eventLoop.timeoutsDeadline = frequency + now;
+
     eventLoop.timeoutsCount++;
     ret = nextTimer-1;
     virEventPollInterruptLocked();
@@ -280,6 +393,12 @@ void virEventPollUpdateTimeout(int timer, int frequency)
                 frequency >= 0 ? frequency + now : 0;
             VIR_DEBUG("Set timer freq=%d expires=%llu", frequency,
                       eventLoop.timeouts[i].expiresAt);
+            /* A timer moved past the cached deadline merely causes
+               one spurious early wakeup which recomputes it */
+            if (frequency >= 0 &&
+                eventLoop.timeoutsDeadline != 0 &&
+                eventLoop.timeouts[i].expiresAt < eventLoop.timeoutsDeadline)
+                eventLoop.timeoutsDeadline = eventLoop.timeouts[i].expiresAt;
             virEventPollInterruptLocked();
             found = true;
             break;
@@ -336,17 +455,22 @@ static int virEventPollCalculateTimeout(int *timeout)
     unsigned long long then = 0;
     size_t i;
     EVENT_DEBUG("Calculate expiry of %zu timers", eventLoop.timeoutsCount);
-    /* Figure out if we need a timeout */
-    for (i = 0; i < eventLoop.timeoutsCount; i++) {
-        if (eventLoop.timeouts[i].deleted)
-            continue;
-        if (eventLoop.timeouts[i].frequency < 0)
-            continue;
-
-        EVENT_DEBUG("Got a timeout scheduled for %llu", eventLoop.timeouts[i].expiresAt);
-        if (then == 0 ||
-            eventLoop.timeouts[i].expiresAt < then)
-            then = eventLoop.timeouts[i].expiresAt;
+    if (eventLoop.timeoutsDeadline != 0) {
+        then = eventLoop.timeoutsDeadline;
+    } else {
+        /* Figure out if we need a timeout */
+        for (i = 0; i < eventLoop.timeoutsCount; i++) {
+            if (eventLoop.timeouts[i].deleted)
+                continue;
+            if (eventLoop.timeouts[i].frequency < 0)
+                continue;
+
+            EVENT_DEBUG("Got a timeout scheduled for %llu", eventLoop.timeouts[i].expiresAt);
+            if (then == 0 ||
+                eventLoop.timeouts[i].expiresAt < then)
+                then = eventLoop.timeouts[i].expiresAt;
+        }
+        eventLoop.timeoutsDeadline = then;
     }
 
     /* Calculate how long we should wait for a timeout if needed */
@@ -434,6 +558,16 @@ static int virEventPollDispatchTimeouts(void)
     if (virTimeMillisNow(&now) < 0)
         return -1;
 
+    /* When the nearest deadline is known and still in the future,
+     * no timer can have expired and the scan can be skipped */
+    if (eventLoop.timeoutsDeadline != 0 &&
+        now + 20 < eventLoop.timeoutsDeadline)
+        return 0;
+
+    /* Invalidate the cached deadline for the duration of the scan;
+     * it is recomputed exactly below once all callbacks have run */
+    eventLoop.timeoutsDeadline = 0;
+
     for (i = 0; i < ntimeouts; i++) {
         if (eventLoop.timeouts[i].deleted || eventLoop.timeouts[i].frequency < 0)
             continue;
@@ -458,6 +592,17 @@ static int virEventPollDispatchTimeouts(void)
             virMutexLock(&eventLoop.lock);
         }
     }
+
+    /* Recompute the exact nearest deadline, including timers the
+     * callbacks may have registered beyond @ntimeouts */
+    for (i = 0; i < eventLoop.timeoutsCount; i++) {
+        if (eventLoop.timeouts[i].deleted || eventLoop.timeouts[i].frequency < 0)
+            continue;
+        if (eventLoop.timeoutsDeadline == 0 ||
+            eventLoop.timeouts[i].expiresAt < eventLoop.timeoutsDeadline)
+            eventLoop.timeoutsDeadline = eventLoop.timeouts[i].expiresAt;
+    }
+
     return 0;
 }
 
@@ -514,6 +659,65 @@ static int virEventPollDispatchHandles(int nfds, struct pollfd *fds)
 }
 
 
+#if HAVE_SYS_EPOLL_H
+/* Variant of virEventPollDispatchHandles for the epoll backend.
+ * The ready set only contains FDs which actually have pending
+ * events and arrives in kernel order, so each entry is matched
+ * against all watches sharing its FD instead of walking the two
+ * arrays in lock-step.
+ *
+ * Returns 0 upon success, -1 if an error occurred
+ */
+static int virEventPollDispatchEpollHandles(int nevents,
+                                            struct epoll_event *events)
+{
+    size_t i;
+    int n;
+    /* Save this now - it may be changed during dispatch */
+    size_t nhandles = eventLoop.handlesCount;
+    VIR_DEBUG("Dispatch %d", nevents);
+
+    for (n = 0; n < nevents; n++) {
+        int fd = events[n].data.fd;
+        int revents = virEventPollFromEpollEvents(events[n].events);
+
+        for (i = 0; i < nhandles; i++) {
+            virEventHandleCallback cb;
+            int watch;
+            void *opaque;
+            int hEvents;
+
+            if (eventLoop.handles[i].fd != fd ||
+                eventLoop.handles[i].events == 0 ||
+                eventLoop.handles[i].deleted)
+                continue;
+
+            cb = eventLoop.handles[i].cb;
+            watch = eventLoop.handles[i].watch;
+            opaque = eventLoop.handles[i].opaque;
+            hEvents = virEventPollFromNativeEvents(revents);
+            /* Watches sharing an FD were registered with epoll as the
+             * union of their requested events, so restrict delivery to
+             * the bits this watch asked for, plus the error conditions
+             * which poll() reports unconditionally */
+            hEvents &= eventLoop.handles[i].events |
+                VIR_EVENT_HANDLE_ERROR | VIR_EVENT_HANDLE_HANGUP;
+            if (!hEvents)
+                continue;
+            PROBE(EVENT_POLL_DISPATCH_HANDLE,
+                  "watch=%d events=%d",
+                  watch, hEvents);
+            virMutexUnlock(&eventLoop.lock);
+            (cb)(watch, fd, hEvents, opaque);
+            virMutexLock(&eventLoop.lock);
+        }
+    }
+
+    return 0;
+}
+#endif /* HAVE_SYS_EPOLL_H */
+
+
 /* Used post dispatch to actually remove any timers that
  * were previously marked as deleted. This asynchronous
  * cleanup is needed to make dispatch re-entrant safe.
@@ -619,7 +823,11 @@ static void virEventPollCleanupHandles(void)
 int virEventPollRunOnce(void)
 {
     struct pollfd *fds = NULL;
-    int ret, timeout, nfds;
+#if HAVE_SYS_EPOLL_H
+    struct epoll_event epevents[EVENT_EPOLL_MAX_EVENTS];
+    bool useepoll;
+#endif
+    int ret, timeout, nfds = 0;
 
     virMutexLock(&eventLoop.lock);
     eventLoop.running = 1;
@@ -628,9 +836,21 @@ int virEventPollRunOnce(void)
     virEventPollCleanupTimeouts();
     virEventPollCleanupHandles();
 
+#if HAVE_SYS_EPOLL_H
+    /* The epoll FD already tracks the registered handles, so the
+     * per-iteration pollfd array rebuild is only needed when we
+     * have fallen back to poll */
+    useepoll = eventLoop.epollfd >= 0;
+    if (!useepoll &&
+        !(fds = virEventPollMakePollFDs(&nfds)))
+        goto error;
+    if (virEventPollCalculateTimeout(&timeout) < 0)
+        goto error;
+#else
     if (!(fds = virEventPollMakePollFDs(&nfds)) ||
         virEventPollCalculateTimeout(&timeout) < 0)
         goto error;
+#endif
 
     virMutexUnlock(&eventLoop.lock);
 
@@ -638,7 +858,15 @@ int virEventPollRunOnce(void)
     PROBE(EVENT_POLL_RUN,
           "nhandles=%d timeout=%d",
           nfds, timeout);
+#if HAVE_SYS_EPOLL_H
+    if (useepoll)
+        ret = epoll_wait(eventLoop.epollfd, epevents,
+                         EVENT_EPOLL_MAX_EVENTS, timeout);
+    else
+        ret = poll(fds, nfds, timeout);
+#else
     ret = poll(fds, nfds, timeout);
+#endif
     if (ret < 0) {
         EVENT_DEBUG("Poll got error event %d", errno);
         if (errno == EINTR || errno == EAGAIN)
@@ -653,9 +881,21 @@ int virEventPollRunOnce(void)
     if (virEventPollDispatchTimeouts() < 0)
         goto error;
 
+#if HAVE_SYS_EPOLL_H
+    if (ret > 0) {
+        if (useepoll) {
+            if (virEventPollDispatchEpollHandles(ret, epevents) < 0)
+                goto error;
+        } else {
+            if (virEventPollDispatchHandles(nfds, fds) < 0)
+                goto error;
+        }
+    }
+#else
     if (ret > 0 &&
         virEventPollDispatchHandles(nfds, fds) < 0)
         goto error;
+#endif
 
     virEventPollCleanupTimeouts();
     virEventPollCleanupHandles();
@@ -698,6 +938,12 @@ int virEventPollInit(void)
         return -1;
     }
 
+#if HAVE_SYS_EPOLL_H
+    /* Not fatal if this fails - we just fall back to poll */
+    if ((eventLoop.epollfd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+        VIR_WARN("Unable to create epoll fd, falling back to poll");
+#endif
+
     if (virEventPollAddHandle(eventLoop.wakeupfd[0],
                               VIR_EVENT_HANDLE_READABLE,
                               virEventPollHandleWakeup, NULL, NULL) < 0) {
@@ -1438,6 +1438,127 @@ virFileReadBufQuiet(const char *file, char *buf, int len)
     return sz;
 }
 
+#ifdef HAVE_MMAP
+
+# ifndef MAP_ANONYMOUS
+#  define MAP_ANONYMOUS MAP_ANON
+# endif
+
+/**
+ * virFileMapRead:
+ * @path: regular file to read
+ * @buf: filled with the NUL terminated file contents on success
+ * @len: filled with the length of the data, not counting the terminator
+ *
+ * Read a whole regular file by mapping it and advising the kernel to
+ * read it ahead sequentially, so that large files (caches, lease
+ * files, XML maps) on slow storage are fetched while the consumer is
+ * already parsing the beginning.  Files which cannot be mapped with
+ * room for the string terminator are read into an anonymous mapping
+ * instead.  The result must be released with virFileMapReadFree.
+ *
+ * No error is reported; callers are expected to fall back to
+ * virFileReadAll on failure.
+ *
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+int
+virFileMapRead(const char *path, char **buf, size_t *len)
+{
+    int fd = -1;
+    struct stat st;
+    static long pagesize;
+    char *map = MAP_FAILED;
+    int ret = -1;
+
+    *buf = NULL;
+    *len = 0;
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return -1;
+
+    if (fstat(fd, &st) < 0)
+        goto cleanup;
+
+    if (!S_ISREG(st.st_mode) || st.st_size < 0 ||
+        (unsigned long long) st.st_size > SIZE_MAX - 1) {
+        errno = EINVAL;
+        goto cleanup;
+    }
+
+    if (pagesize == 0)
+        pagesize = virGetSystemPageSize();
+
+    /* A file backed mapping only has room for the terminator in the
+     * zero filled tail of the last page, which does not exist when the
+     * file size is an exact multiple of the page size; read such files
+     * (and empty ones) through an anonymous mapping instead */
+    if (st.st_size > 0 && st.st_size % pagesize != 0)
+        map = mmap(NULL, st.st_size + 1, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (map != MAP_FAILED) {
+# ifdef MADV_SEQUENTIAL
+        ignore_value(madvise(map, st.st_size, MADV_SEQUENTIAL));
+# endif
+    } else {
+        map = mmap(NULL, st.st_size + 1, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED)
+            goto cleanup;
+
+        if (saferead(fd, map, st.st_size) != st.st_size) {
+            int save_errno = errno;
+            munmap(map, st.st_size + 1);
+            errno = save_errno;
+            goto cleanup;
+        }
+    }
+
+    *buf = map;
+    *len = st.st_size;
+    ret = 0;
+
+ cleanup:
+    VIR_FORCE_CLOSE(fd);
+    return ret;
+}
+
+/**
+ * virFileMapReadFree:
+ * @buf: mapping returned by virFileMapRead
+ * @len: length returned by virFileMapRead
+ *
+ * Releases a mapping obtained with virFileMapRead. A NULL @buf is
+ * silently ignored.
+ */
+void
+virFileMapReadFree(char *buf, size_t len)
+{
+    if (buf)
+        munmap(buf, len + 1);
+}
+
+#else /* !HAVE_MMAP */
+
+int
+virFileMapRead(const char *path ATTRIBUTE_UNUSED,
+               char **buf,
+               size_t *len)
+{
+    *buf = NULL;
+    *len = 0;
+    errno = ENOSYS;
+    return -1;
+}
+
+void
+virFileMapReadFree(char *buf ATTRIBUTE_UNUSED,
+                   size_t len ATTRIBUTE_UNUSED)
+{
+}
+
+#endif /* !HAVE_MMAP */
+
 /* Truncate @path and write @str to it.  If @mode is 0, ensure that
    @path exists; otherwise, use @mode if @path must be created.
    Return 0 for success, nonzero for failure.
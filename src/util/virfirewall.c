@@ -26,8 +26,10 @@
 #define __VIR_FIREWALL_PRIV_H_ALLOW__
 
 #include <stdarg.h>
+#include <string.h>
 
 #include "viralloc.h"
+#include "virbuffer.h"
 #include "virfirewallpriv.h"
 #include "virerror.h"
 #include "virutil.h"
@@ -108,6 +110,8 @@ static bool iptablesUseLock;
 static bool ip6tablesUseLock;
 static bool ebtablesUseLock;
 static bool lockOverride; /* true to avoid lock probes */
+static bool iptablesRestoreAvail;
+static bool ip6tablesRestoreAvail;
 
 void
 virFirewallSetLockOverride(bool avoid)
@@ -195,6 +199,11 @@ virFirewallValidateBackend(virFirewallBackend backend)
             }
         }
         VIR_DEBUG("found iptables/ip6tables/ebtables, using direct backend");
+
+        iptablesRestoreAvail = virFileIsExecutable(IPTABLES_RESTORE_PATH);
+        ip6tablesRestoreAvail = virFileIsExecutable(IP6TABLES_RESTORE_PATH);
+        VIR_DEBUG("iptables-restore available: %d ip6tables-restore available: %d",
+                  iptablesRestoreAvail, ip6tablesRestoreAvail);
     }
 
     currentBackend = backend;
@@ -692,6 +701,190 @@ virFirewallRuleToString(virFirewallRulePtr rule)
     return virBufferContentAndReset(&buf);
 }
 
+/* Tables accepted for batched application, in the order their
+ * sections are emitted into the iptables-restore input */
+static const char *batchRestoreTables[] = {
+    "raw", "mangle", "nat", "filter",
+};
+
+/**
+ * virFirewallRuleBatchInfo:
+ * @rule: firewall rule to check
+ * @tableidx: filled with the batchRestoreTables index the rule modifies
+ * @first: filled with the argv index of the chain command
+ *
+ * Decide whether @rule can be rendered as one line of
+ * iptables-restore/ip6tables-restore input, skipping over any locking
+ * and table selection arguments. Only plain chain edits can be
+ * batched; anything else (listing, custom binaries, unknown tables)
+ * must go through the one-process-per-rule path.
+ */
+static bool
+virFirewallRuleBatchInfo(virFirewallRulePtr rule,
+                         size_t *tableidx,
+                         size_t *first)
+{
+    const char *table = "filter";
+    size_t i = 0;
+    size_t t;
+
+    if (rule->layer == VIR_FIREWALL_LAYER_IPV4) {
+        if (!iptablesRestoreAvail)
+            return false;
+    } else if (rule->layer == VIR_FIREWALL_LAYER_IPV6) {
+        if (!ip6tablesRestoreAvail)
+            return false;
+    } else {
+        return false;
+    }
+
+    if (i < rule->argsLen && STREQ(rule->args[i], "-w"))
+        i++;
+
+    if (i + 1 < rule->argsLen &&
+        (STREQ(rule->args[i], "-t") ||
+         STREQ(rule->args[i], "--table"))) {
+        table = rule->args[i + 1];
+        i += 2;
+    }
+
+    if (i >= rule->argsLen)
+        return false;
+
+    if (STRNEQ(rule->args[i], "-A") && STRNEQ(rule->args[i], "--append") &&
+        STRNEQ(rule->args[i], "-I") && STRNEQ(rule->args[i], "--insert") &&
+        STRNEQ(rule->args[i], "-D") && STRNEQ(rule->args[i], "--delete") &&
+        STRNEQ(rule->args[i], "-N") && STRNEQ(rule->args[i], "--new-chain") &&
+        STRNEQ(rule->args[i], "-X") && STRNEQ(rule->args[i], "--delete-chain") &&
+        STRNEQ(rule->args[i], "-F") && STRNEQ(rule->args[i], "--flush"))
+        return false;
+
+    for (t = 0; t < ARRAY_CARDINALITY(batchRestoreTables); t++) {
+        if (STREQ(table, batchRestoreTables[t])) {
+            *tableidx = t;
+            *first = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+static bool
+virFirewallRuleIsBatchable(virFirewallRulePtr rule,
+                           bool ignoreErrors)
+{
+    size_t tableidx;
+    size_t first;
+
+    /* A failing line aborts the whole restore input, and its output
+     * cannot be mapped back to an individual rule, so rules whose
+     * errors must be ignored or whose output feeds a query callback
+     * have to be applied one process at a time */
+    if (rule->queryCB ||
+        rule->ignoreErrors ||
+        ignoreErrors)
+        return false;
+
+    return virFirewallRuleBatchInfo(rule, &tableidx, &first);
+}
+
+
+static void
+virFirewallBatchFormatArg(virBufferPtr buf,
+                          const char *arg)
+{
+    if (*arg == '\0' || strpbrk(arg, " \t\"\\")) {
+        virBufferAddLit(buf, " \"");
+        for (; *arg; arg++) {
+            if (*arg == '"' || *arg == '\\')
+                virBufferAddChar(buf, '\\');
+            virBufferAddChar(buf, *arg);
+        }
+        virBufferAddChar(buf, '"');
+    } else {
+        virBufferAsprintf(buf, " %s", arg);
+    }
+}
+
+
+/* Apply @nrules consecutive rules of the same layer in a single
+ * iptables-restore/ip6tables-restore invocation. Rule order is
+ * preserved within each table; rules modifying different tables are
+ * independent of each other */
+static int
+virFirewallApplyBatchDirect(virFirewallRulePtr *rules,
+                            size_t nrules)
+{
+    virBuffer tables[ARRAY_CARDINALITY(batchRestoreTables)] = {
+        VIR_BUFFER_INITIALIZER,
+    };
+    virBuffer input = VIR_BUFFER_INITIALIZER;
+    const char *bin = rules[0]->layer == VIR_FIREWALL_LAYER_IPV4 ?
+        IPTABLES_RESTORE_PATH : IP6TABLES_RESTORE_PATH;
+    virCommandPtr cmd = NULL;
+    char *error = NULL;
+    int status;
+    int ret = -1;
+    size_t i, j;
+
+    for (i = 0; i < nrules; i++) {
+        virFirewallRulePtr rule = rules[i];
+        size_t tableidx;
+        size_t first;
+
+        if (!virFirewallRuleBatchInfo(rule, &tableidx, &first)) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Firewall rule cannot be batched"));
+            goto cleanup;
+        }
+
+        virBufferAdd(&tables[tableidx], rule->args[first], -1);
+        for (j = first + 1; j < rule->argsLen; j++)
+            virFirewallBatchFormatArg(&tables[tableidx], rule->args[j]);
+        virBufferAddChar(&tables[tableidx], '\n');
+    }
+
+    for (i = 0; i < ARRAY_CARDINALITY(batchRestoreTables); i++) {
+        if (!virBufferUse(&tables[i]))
+            continue;
+        virBufferAsprintf(&input, "*%s\n", batchRestoreTables[i]);
+        virBufferAddBuffer(&input, &tables[i]);
+        virBufferAddLit(&input, "COMMIT\n");
+    }
+
+    if (virBufferCheckError(&input) < 0)
+        goto cleanup;
+
+    VIR_INFO("Applying batch of %zu rules via %s", nrules, bin);
+    VIR_DEBUG("Batch input '%s'", virBufferCurrentContent(&input));
+
+    cmd = virCommandNewArgList(bin, "-n", NULL);
+    virCommandSetInputBuffer(cmd, virBufferCurrentContent(&input));
+    virCommandSetErrorBuffer(cmd, &error);
+
+    if (virCommandRun(cmd, &status) < 0)
+        goto cleanup;
+
+    if (status != 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Failed to apply firewall rules '%s': %s"),
+                       virBufferCurrentContent(&input), NULLSTR(error));
+        goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    for (i = 0; i < ARRAY_CARDINALITY(batchRestoreTables); i++)
+        virBufferFreeAndReset(&tables[i]);
+    virBufferFreeAndReset(&input);
+    VIR_FREE(error);
+    virCommandFree(cmd);
+    return ret;
+}
+
+
 static int
 virFirewallApplyRuleDirect(virFirewallRulePtr rule,
                            bool ignoreErrors,
@@ -896,6 +1089,27 @@ virFirewallApplyGroup(virFirewallPtr firewall,
     firewall->currentGroup = idx;
     group->addingRollback = false;
     for (i = 0; i < group->naction; i++) {
+        /* Coalesce consecutive batchable rules of the same layer
+         * into a single iptables-restore process rather than
+         * spawning one process per rule */
+        if (currentBackend == VIR_FIREWALL_BACKEND_DIRECT &&
+            (group->actionFlags & VIR_FIREWALL_TRANSACTION_AUTO_BATCH)) {
+            size_t nbatch = 0;
+
+            while (i + nbatch < group->naction &&
+                   group->action[i + nbatch]->layer == group->action[i]->layer &&
+                   virFirewallRuleIsBatchable(group->action[i + nbatch],
+                                              ignoreErrors))
+                nbatch++;
+
+            if (nbatch > 1) {
+                if (virFirewallApplyBatchDirect(&group->action[i], nbatch) < 0)
+                    return -1;
+                i += nbatch - 1;
+                continue;
+            }
+        }
+
         if (virFirewallApplyRule(firewall,
                                  group->action[i],
                                  ignoreErrors) < 0)
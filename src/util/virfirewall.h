@@ -90,6 +90,11 @@ typedef enum {
     /* Ignore all errors when applying rules, so no
      * rollback block will be required */
     VIR_FIREWALL_TRANSACTION_IGNORE_ERRORS = (1 << 0),
+    /* Allow consecutive rules which don't need their errors
+     * ignored or their output parsed to be applied in a single
+     * iptables-restore style process instead of one process
+     * per rule */
+    VIR_FIREWALL_TRANSACTION_AUTO_BATCH = (1 << 1),
 } virFirewallTransactionFlags;
 
 void virFirewallStartTransaction(virFirewallPtr firewall,
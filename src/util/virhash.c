@@ -437,6 +437,12 @@ virHashAtomicUpdate(virHashAtomicPtr table,
  *
  * Find the userdata specified by @name
  *
+ * This function doesn't modify the table, so it may be called from
+ * multiple threads concurrently as long as no thread modifies the
+ * table at the same time. Read-mostly consumers can thus guard the
+ * table with a RW lock rather than a mutex to let lookups proceed
+ * in parallel.
+ *
  * Returns a pointer to the userdata
  */
 void *
@@ -36,6 +36,9 @@
 #include "virlog.h"
 #include "viralloc.h"
 #include "virfile.h"
+#include "virstring.h"
+#include "virthread.h"
+#include "virthreadpool.h"
 #include "configmake.h"
 #include "vircommand.h"
 
@@ -108,23 +111,29 @@ VIR_ENUM_IMPL(virHookLibxlOp, VIR_HOOK_LIBXL_OP_LAST,
               "reconnect")
 
 static int virHooksFound = -1;
+static int virHooksAsync;
 
 /**
  * virHookCheck:
  * @driver: the driver name "daemon", "qemu", "lxc"...
+ * @async: set to true when the hook is flagged for asynchronous calls
  *
  * Check is there is an installed hook for the given driver, if this
  * is the case register it. Then subsequent calls to virHookCall
- * will call the hook if found.
+ * will call the hook if found. The admin flags a hook as asynchronous
+ * by creating a "<driver>.async" file next to the script.
  *
  * Returns 1 if found, 0 if not found, and -1 in case of error
  */
 static int
-virHookCheck(int no, const char *driver)
+virHookCheck(int no, const char *driver, bool *async)
 {
     char *path;
+    char *asyncpath = NULL;
     int ret;
 
+    *async = false;
+
     if (driver == NULL) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("Invalid hook name for #%d"), no);
@@ -147,8 +156,14 @@ virHookCheck(int no, const char *driver)
     } else {
         ret = 1;
         VIR_DEBUG("Found hook script %s", path);
+        if (virAsprintfQuiet(&asyncpath, "%s.async", path) >= 0 &&
+            virFileExists(asyncpath)) {
+            *async = true;
+            VIR_DEBUG("Hook script %s flagged as asynchronous", path);
+        }
     }
 
+    VIR_FREE(asyncpath);
     VIR_FREE(path);
     return ret;
 }
@@ -168,13 +183,18 @@ virHookInitialize(void)
     int res, ret = 0;
 
     virHooksFound = 0;
+    virHooksAsync = 0;
     for (i = 0; i < VIR_HOOK_DRIVER_LAST; i++) {
-        res = virHookCheck(i, virHookDriverTypeToString(i));
+        bool async;
+
+        res = virHookCheck(i, virHookDriverTypeToString(i), &async);
         if (res < 0)
             return -1;
 
         if (res == 1) {
             virHooksFound |= (1 << i);
+            if (async)
+                virHooksAsync |= (1 << i);
             ret++;
         }
     }
@@ -204,6 +224,111 @@ virHookPresent(int driver)
     return 1;
 }
 
+typedef struct _virHookAsyncJob virHookAsyncJob;
+typedef virHookAsyncJob *virHookAsyncJobPtr;
+
+struct _virHookAsyncJob {
+    char *path;
+    char *id;
+    char *opstr;
+    char *subopstr;
+    char *extra;
+    char *input;
+};
+
+/* A single worker keeps asynchronous hook invocations in the same
+ * order the synchronous path would have run them in */
+static virThreadPoolPtr virHookAsyncPool;
+static virMutex virHookAsyncLock = VIR_MUTEX_INITIALIZER;
+
+/* dispatching beyond this many outstanding invocations falls back to
+ * the synchronous path rather than queueing without bound */
+#define VIR_HOOK_ASYNC_QUEUE_MAX 100
+
+static void
+virHookAsyncJobFree(virHookAsyncJobPtr job)
+{
+    if (!job)
+        return;
+    VIR_FREE(job->path);
+    VIR_FREE(job->id);
+    VIR_FREE(job->opstr);
+    VIR_FREE(job->subopstr);
+    VIR_FREE(job->extra);
+    VIR_FREE(job->input);
+    VIR_FREE(job);
+}
+
+static void
+virHookAsyncWorker(void *jobdata, void *opaque ATTRIBUTE_UNUSED)
+{
+    virHookAsyncJobPtr job = jobdata;
+    virCommandPtr cmd;
+
+    cmd = virCommandNewArgList(job->path, job->id, job->opstr,
+                               job->subopstr, job->extra, NULL);
+
+    virCommandAddEnvPassCommon(cmd);
+
+    if (job->input)
+        virCommandSetInputBuffer(cmd, job->input);
+
+    if (virCommandRun(cmd, NULL) < 0)
+        VIR_WARN("Asynchronous hook script %s failed: %s",
+                 job->path, virGetLastErrorMessage());
+
+    virCommandFree(cmd);
+    virHookAsyncJobFree(job);
+}
+
+/*
+ * Queue a hook invocation for execution off the caller's critical
+ * path. Returns 0 when the job was queued; -1 tells the caller to run
+ * the script synchronously instead.
+ */
+static int
+virHookCallAsync(const char *path,
+                 const char *id,
+                 const char *opstr,
+                 const char *subopstr,
+                 const char *extra,
+                 const char *input)
+{
+    virHookAsyncJobPtr job = NULL;
+    int ret = -1;
+
+    virMutexLock(&virHookAsyncLock);
+
+    if (!virHookAsyncPool &&
+        !(virHookAsyncPool = virThreadPoolNew(1, 1, 0,
+                                              virHookAsyncWorker, NULL)))
+        goto cleanup;
+
+    if (virThreadPoolGetJobQueueDepth(virHookAsyncPool) >=
+        VIR_HOOK_ASYNC_QUEUE_MAX)
+        goto cleanup;
+
+    if (VIR_ALLOC_QUIET(job) < 0 ||
+        VIR_STRDUP_QUIET(job->path, path) < 0 ||
+        VIR_STRDUP_QUIET(job->id, id) < 0 ||
+        VIR_STRDUP_QUIET(job->opstr, opstr) < 0 ||
+        VIR_STRDUP_QUIET(job->subopstr, subopstr) < 0 ||
+        VIR_STRDUP_QUIET(job->extra, extra) < 0 ||
+        VIR_STRDUP_QUIET(job->input, input) < 0)
+        goto cleanup;
+
+    if (virThreadPoolSendJob(virHookAsyncPool, 0, job) < 0)
+        goto cleanup;
+
+    job = NULL;
+    ret = 0;
+
+ cleanup:
+    virHookAsyncJobFree(job);
+    virMutexUnlock(&virHookAsyncLock);
+    return ret;
+}
+
 /**
  * virHookCall:
  * @driver: the driver number (from virHookDriver enum)
@@ -220,6 +345,12 @@ virHookPresent(int driver)
  * allocated after successful virHookCall, and is best-effort allocated after
  * failed virHookCall; the caller is responsible for freeing *output.
  *
+ * If the admin flagged the hook as asynchronous by creating a
+ * "<driver>.async" file next to the script, calls which do not collect
+ * @output are queued for ordered execution off the caller's critical
+ * path and report success immediately; the script's exit status can
+ * then no longer gate the operation.
+ *
  * Returns: 0 if the execution succeeded, 1 if the script was not found or
  *          invalid parameters, and -1 if script returned an error
  */
@@ -300,6 +431,13 @@ virHookCall(int driver,
     VIR_DEBUG("Calling hook opstr=%s subopstr=%s extra=%s",
               opstr, subopstr, extra);
 
+    if (output == NULL &&
+        (virHooksAsync & (1 << driver)) &&
+        virHookCallAsync(path, id, opstr, subopstr, extra, input) == 0) {
+        VIR_FREE(path);
+        return 0;
+    }
+
     cmd = virCommandNewArgList(path, id, opstr, subopstr, extra, NULL);
 
     virCommandAddEnvPassCommon(cmd);
@@ -206,39 +206,43 @@ void virHostCPUSetSysFSSystemPathLinux(const char *path)
         sysfs_system_path = SYSFS_SYSTEM_PATH;
 }
 
-/* Return the positive decimal contents of the given
- * DIR/cpu%u/FILE, or -1 on error.  If DEFAULT_VALUE is non-negative
+/* Return the positive decimal contents of the given cpu%u/FILE
+ * relative to @dirfd (@dir is only used for error reports), or -1 on
+ * error.  Reading relative to an already open directory skips the walk
+ * from the filesystem root for every one of the many tiny files a
+ * topology scan touches.  If DEFAULT_VALUE is non-negative
  * and the file could not be found, return that instead of an error;
  * this is useful for machines that cannot hot-unplug cpu0, or where
  * hot-unplugging is disabled, or where the kernel is too old
  * to support NUMA cells, etc.  */
 static int
-virHostCPUGetValue(const char *dir, unsigned int cpu, const char *file,
-                   int default_value)
+virHostCPUGetValue(const char *dir, int dirfd, unsigned int cpu,
+                   const char *file, int default_value)
 {
-    char *path;
-    FILE *pathfp;
+    char path[256];
+    int fd = -1;
+    ssize_t len;
     int value = -1;
     char value_str[INT_BUFSIZE_BOUND(value)];
     char *tmp;
 
-    if (virAsprintf(&path, "%s/cpu%u/%s", dir, cpu, file) < 0)
-        return -1;
+    snprintf(path, sizeof(path), "cpu%u/%s", cpu, file);
 
-    pathfp = fopen(path, "r");
-    if (pathfp == NULL) {
+    if ((fd = openat(dirfd, path, O_RDONLY)) < 0) {
         if (default_value >= 0 && errno == ENOENT)
-            value = default_value;
-        else
-            virReportSystemError(errno, _("cannot open %s"), path);
-        goto cleanup;
+            return default_value;
+        virReportSystemError(errno, _("cannot open %s/%s"), dir, path);
+        return -1;
     }
 
-    if (fgets(value_str, sizeof(value_str), pathfp) == NULL) {
-        virReportSystemError(errno, _("cannot read from %s"), path);
+    if ((len = saferead(fd, value_str, sizeof(value_str) - 1)) < 0) {
+        virReportSystemError(errno, _("cannot read from %s/%s"), dir, path);
         goto cleanup;
     }
+    value_str[len] = '\0';
+
     if (virStrToLong_i(value_str, &tmp, 10, &value) < 0) {
+        value = -1;
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("could not convert '%s' to an integer"),
                        value_str);
@@ -246,33 +250,37 @@ virHostCPUGetValue(const char *dir, unsigned int cpu, const char *file,
     }
 
  cleanup:
-    VIR_FORCE_FCLOSE(pathfp);
-    VIR_FREE(path);
+    VIR_FORCE_CLOSE(fd);
 
     return value;
 }
 
 static unsigned long
-virHostCPUCountThreadSiblings(const char *dir, unsigned int cpu)
+virHostCPUCountThreadSiblings(const char *dir, int dirfd, unsigned int cpu)
 {
     unsigned long ret = 0;
-    char *path;
+    char path[256];
+    int fd = -1;
     char *str = NULL;
     size_t i;
 
-    if (virAsprintf(&path, "%s/cpu%u/topology/thread_siblings",
-                    dir, cpu) < 0)
-        return 0;
+    snprintf(path, sizeof(path), "cpu%u/topology/thread_siblings", cpu);
 
-    if (!virFileExists(path)) {
-        /* If file doesn't exist, then pretend our only
-         * sibling is ourself */
-        ret = 1;
+    if ((fd = openat(dirfd, path, O_RDONLY)) < 0) {
+        if (errno == ENOENT) {
+            /* If file doesn't exist, then pretend our only
+             * sibling is ourself */
+            ret = 1;
+        } else {
+            virReportSystemError(errno, _("cannot open %s/%s"), dir, path);
+        }
         goto cleanup;
     }
 
-    if (virFileReadAll(path, SYSFS_THREAD_SIBLINGS_LIST_LENGTH_MAX, &str) < 0)
+    if (virFileReadLimFD(fd, SYSFS_THREAD_SIBLINGS_LIST_LENGTH_MAX, &str) < 0) {
+        virReportSystemError(errno, _("cannot read from %s/%s"), dir, path);
         goto cleanup;
+    }
 
     for (i = 0; str[i] != '\0'; i++) {
         if (c_isxdigit(str[i]))
@@ -281,16 +289,18 @@ virHostCPUCountThreadSiblings(const char *dir, unsigned int cpu)
 
  cleanup:
     VIR_FREE(str);
-    VIR_FREE(path);
+    VIR_FORCE_CLOSE(fd);
     return ret;
 }
 
 static int
 virHostCPUParseSocket(const char *dir,
-                   virArch arch,
-                   unsigned int cpu)
+                      int dirfd,
+                      virArch arch,
+                      unsigned int cpu)
 {
-    int ret = virHostCPUGetValue(dir, cpu, "topology/physical_package_id", 0);
+    int ret = virHostCPUGetValue(dir, dirfd, cpu,
+                                 "topology/physical_package_id", 0);
 
     if (ARCH_IS_ARM(arch) || ARCH_IS_PPC(arch) || ARCH_IS_S390(arch)) {
         /* arm, ppc and s390(x) has -1 */
@@ -324,10 +334,12 @@ virHostCPUParseNode(const char *node,
     int ret = -1;
     int processors = 0;
     DIR *cpudir = NULL;
+    int cpudirfd = -1;
     struct dirent *cpudirent = NULL;
     virBitmapPtr node_cpus_map = NULL;
     virBitmapPtr sockets_map = NULL;
     virBitmapPtr *cores_maps = NULL;
+    int *socks = NULL;
     int npresent_cpus = virBitmapSize(present_cpus_map);
     int sock_max = 0;
     int sock;
@@ -343,6 +355,7 @@ virHostCPUParseNode(const char *node,
 
     if (virDirOpen(&cpudir, node) < 0)
         goto cleanup;
+    cpudirfd = dirfd(cpudir);
 
     /* Keep track of the CPUs that belong to the current node */
     if (!(node_cpus_map = virBitmapNew(npresent_cpus)))
@@ -352,6 +365,11 @@ virHostCPUParseNode(const char *node,
     if (!(sockets_map = virBitmapNew(ID_MAX + 1)))
         goto cleanup;
 
+    /* Remember the socket of each online CPU so the second pass below
+     * doesn't have to read physical_package_id again */
+    if (VIR_ALLOC_N(socks, npresent_cpus) < 0)
+        goto cleanup;
+
     while ((direrr = virDirRead(cpudir, &cpudirent, node)) > 0) {
         if (sscanf(cpudirent->d_name, "cpu%u", &cpu) != 1)
             continue;
@@ -367,8 +385,9 @@ virHostCPUParseNode(const char *node,
             continue;
 
         /* Parse socket */
-        if ((sock = virHostCPUParseSocket(node, arch, cpu)) < 0)
+        if ((sock = virHostCPUParseSocket(node, cpudirfd, arch, cpu)) < 0)
             goto cleanup;
+        socks[cpu] = sock;
         if (sock > ID_MAX) {
             virReportError(VIR_ERR_INTERNAL_ERROR,
                            _("Socket %d can't be handled (max socket is %d)"),
@@ -421,9 +440,8 @@ virHostCPUParseNode(const char *node,
 
         processors++;
 
-        /* Parse socket */
-        if ((sock = virHostCPUParseSocket(node, arch, cpu)) < 0)
-            goto cleanup;
+        /* Use the socket parsed in the enumeration pass above */
+        sock = socks[cpu];
         if (!virBitmapIsBitSet(sockets_map, sock)) {
             virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                            _("CPU socket topology has changed"));
@@ -435,7 +453,7 @@ virHostCPUParseNode(const char *node,
             /* logical cpu is equivalent to a core on s390 */
             core = cpu;
         } else {
-            if ((core = virHostCPUGetValue(node, cpu,
+            if ((core = virHostCPUGetValue(node, cpudirfd, cpu,
                                            "topology/core_id", 0)) < 0)
                 goto cleanup;
         }
@@ -449,7 +467,7 @@ virHostCPUParseNode(const char *node,
         if (virBitmapSetBit(cores_maps[sock], core) < 0)
             goto cleanup;
 
-        if (!(siblings = virHostCPUCountThreadSiblings(node, cpu)))
+        if (!(siblings = virHostCPUCountThreadSiblings(node, cpudirfd, cpu)))
             goto cleanup;
 
         if (siblings > *threads)
@@ -482,6 +500,7 @@ virHostCPUParseNode(const char *node,
         for (i = 0; i < sock_max; i++)
             virBitmapFree(cores_maps[i]);
     VIR_FREE(cores_maps);
+    VIR_FREE(socks);
     virBitmapFree(sockets_map);
     virBitmapFree(node_cpus_map);
 
@@ -1178,6 +1197,7 @@ virHostCPUGetOnlineBitmap(void)
     if (virFileExists(online_path)) {
         cpumap = virHostCPUParseMapLinux(present, online_path);
     } else {
+        DIR *cpusysdir = NULL;
         size_t i;
 
         cpumap = virBitmapNew(present);
@@ -1187,9 +1207,17 @@ virHostCPUGetOnlineBitmap(void)
         if (virAsprintf(&cpudir, "%s/cpu", sysfs_system_path) < 0)
             goto cleanup;
 
+        if (virDirOpen(&cpusysdir, cpudir) < 0) {
+            virBitmapFree(cpumap);
+            cpumap = NULL;
+            goto cleanup;
+        }
+
         for (i = 0; i < present; i++) {
-            int online = virHostCPUGetValue(cpudir, i, "online", 1);
+            int online = virHostCPUGetValue(cpudir, dirfd(cpusysdir), i,
+                                            "online", 1);
             if (online < 0) {
+                VIR_DIR_CLOSE(cpusysdir);
                 virBitmapFree(cpumap);
                 cpumap = NULL;
                 goto cleanup;
@@ -1197,6 +1225,7 @@ virHostCPUGetOnlineBitmap(void)
             if (online)
                 ignore_value(virBitmapSetBit(cpumap, i));
         }
+        VIR_DIR_CLOSE(cpusysdir);
     }
 
  cleanup:
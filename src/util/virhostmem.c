@@ -50,6 +50,7 @@
 #include "virtypedparam.h"
 #include "virstring.h"
 #include "virnuma.h"
+#include "virthread.h"
 #include "virlog.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
@@ -835,3 +836,117 @@ virHostMemAllocPages(unsigned int npages,
  cleanup:
     return ret;
 }
+
+
+/* Ledger of huge pages claimed for domains that are currently
+ * starting up. The sysfs counters only reflect pages a running qemu
+ * has already taken, so when several domains start concurrently they
+ * would all base their placement on the same stale free counts and
+ * overcommit the pool. A claim is taken before the domain is spawned
+ * and dropped once it has allocated its memory (or failed to start),
+ * narrowing free-page reads by other threads in between. */
+typedef struct _virHostMemHugePageClaim virHostMemHugePageClaim;
+struct _virHostMemHugePageClaim {
+    unsigned int page_size; /* in KiB */
+    unsigned long long npages;
+};
+
+static virMutex virHostMemHugePageClaimLock = VIR_MUTEX_INITIALIZER;
+static virHostMemHugePageClaim *virHostMemHugePageClaims;
+static size_t virHostMemHugePageClaimCount;
+
+static virHostMemHugePageClaim *
+virHostMemHugePageClaimGetLocked(unsigned int page_size)
+{
+    size_t i;
+
+    for (i = 0; i < virHostMemHugePageClaimCount; i++) {
+        if (virHostMemHugePageClaims[i].page_size == page_size)
+            return &virHostMemHugePageClaims[i];
+    }
+
+    return NULL;
+}
+
+/**
+ * virHostMemHugePageClaim:
+ * @page_size: which huge page pool to claim from (in KiB)
+ * @npages: how many pages to claim
+ *
+ * Claim @npages pages from the pool of @page_size sized huge pages.
+ * The claim fails if the pool's free pages minus the outstanding
+ * claims of other domains cannot cover it. Every successful claim
+ * must be returned with virHostMemHugePageRelease.
+ *
+ * Returns 0 on success, -1 on error (with the error reported).
+ */
+int
+virHostMemHugePageClaim(unsigned int page_size,
+                        unsigned long long npages)
+{
+    virHostMemHugePageClaim *claim;
+    unsigned int page_free;
+    unsigned long long avail;
+    int ret = -1;
+
+    if (virNumaGetPageInfo(-1, page_size, 0, NULL, &page_free) < 0)
+        return -1;
+
+    virMutexLock(&virHostMemHugePageClaimLock);
+
+    if (!(claim = virHostMemHugePageClaimGetLocked(page_size))) {
+        virHostMemHugePageClaim newclaim = { page_size, 0 };
+
+        if (VIR_APPEND_ELEMENT(virHostMemHugePageClaims,
+                               virHostMemHugePageClaimCount,
+                               newclaim) < 0)
+            goto cleanup;
+
+        claim = &virHostMemHugePageClaims[virHostMemHugePageClaimCount - 1];
+    }
+
+    avail = claim->npages < page_free ? page_free - claim->npages : 0;
+
+    if (npages > avail) {
+        virReportError(VIR_ERR_OPERATION_FAILED,
+                       _("not enough free huge pages of size %u KiB: "
+                         "%llu pages needed, %llu available"),
+                       page_size, npages, avail);
+        goto cleanup;
+    }
+
+    claim->npages += npages;
+    ret = 0;
+
+ cleanup:
+    virMutexUnlock(&virHostMemHugePageClaimLock);
+    return ret;
+}
+
+/**
+ * virHostMemHugePageRelease:
+ * @page_size: which huge page pool the claim was taken from (in KiB)
+ * @npages: how many pages to release
+ *
+ * Return a claim taken with virHostMemHugePageClaim.
+ */
+void
+virHostMemHugePageRelease(unsigned int page_size,
+                          unsigned long long npages)
+{
+    virHostMemHugePageClaim *claim;
+
+    virMutexLock(&virHostMemHugePageClaimLock);
+
+    if (!(claim = virHostMemHugePageClaimGetLocked(page_size)) ||
+        claim->npages < npages) {
+        VIR_WARN("Releasing more huge pages of size %u KiB than were "
+                 "claimed", page_size);
+        if (claim)
+            claim->npages = 0;
+    } else {
+        claim->npages -= npages;
+    }
+
+    virMutexUnlock(&virHostMemHugePageClaimLock);
+}
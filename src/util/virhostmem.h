@@ -57,4 +57,11 @@ int virHostMemAllocPages(unsigned int npages,
                          unsigned int cellCount,
                          bool add);
 
+int virHostMemHugePageClaim(unsigned int page_size,
+                            unsigned long long npages)
+    ATTRIBUTE_RETURN_CHECK;
+
+void virHostMemHugePageRelease(unsigned int page_size,
+                               unsigned long long npages);
+
 #endif /* __VIR_HOSTMEM_H__*/
@@ -24,6 +24,7 @@
 
 #include <regex.h>
 #include <stdio.h>
+#include <time.h>
 
 #include "viriscsi.h"
 
@@ -34,33 +35,90 @@
 #include "virlog.h"
 #include "virrandom.h"
 #include "virstring.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
 VIR_LOG_INIT("util.iscsi");
 
 
-struct virISCSISessionData {
+typedef struct _virISCSISessionCacheEntry virISCSISessionCacheEntry;
+struct _virISCSISessionCacheEntry {
     char *session;
-    const char *devpath;
+    char *devpath;
 };
 
+struct virISCSISessionList {
+    virISCSISessionCacheEntry *entries;
+    size_t nentries;
+};
+
+/* Cached output of 'iscsiadm --mode session'. One listing describes
+ * every active session, so when many iSCSI pools are checked or
+ * refreshed back to back (typically at daemon startup) a single
+ * iscsiadm run can answer all of their session lookups. The cache is
+ * invalidated whenever we log into or out of a target ourselves and
+ * expires after a few seconds so that sessions torn down behind our
+ * back are noticed promptly. */
+#define VIR_ISCSI_SESSION_CACHE_TTL 5
+
+static virMutex virISCSISessionCacheLock = VIR_MUTEX_INITIALIZER;
+static virISCSISessionCacheEntry *virISCSISessionCacheEntries;
+static size_t virISCSISessionCacheCount;
+static time_t virISCSISessionCacheWhen; /* 0 if the cache is invalid */
+static char *virISCSISessionCacheError; /* stderr of the cached listing */
+
 
 static int
 virISCSIExtractSession(char **const groups,
                        void *opaque)
 {
-    struct virISCSISessionData *data = opaque;
+    struct virISCSISessionList *list = opaque;
+    virISCSISessionCacheEntry entry = { NULL, NULL };
+
+    if (VIR_STRDUP(entry.session, groups[0]) < 0 ||
+        VIR_STRDUP(entry.devpath, groups[1]) < 0)
+        goto error;
+
+    if (VIR_APPEND_ELEMENT(list->entries, list->nentries, entry) < 0)
+        goto error;
 
-    if (STREQ(groups[1], data->devpath))
-        return VIR_STRDUP(data->session, groups[0]);
     return 0;
+
+ error:
+    VIR_FREE(entry.session);
+    VIR_FREE(entry.devpath);
+    return -1;
 }
 
 
-char *
-virISCSIGetSession(const char *devpath,
-                   bool probe)
+static void
+virISCSISessionCacheClearLocked(void)
+{
+    size_t i;
+
+    for (i = 0; i < virISCSISessionCacheCount; i++) {
+        VIR_FREE(virISCSISessionCacheEntries[i].session);
+        VIR_FREE(virISCSISessionCacheEntries[i].devpath);
+    }
+    VIR_FREE(virISCSISessionCacheEntries);
+    virISCSISessionCacheCount = 0;
+    VIR_FREE(virISCSISessionCacheError);
+    virISCSISessionCacheWhen = 0;
+}
+
+
+void
+virISCSISessionCacheInvalidate(void)
+{
+    virMutexLock(&virISCSISessionCacheLock);
+    virISCSISessionCacheClearLocked();
+    virMutexUnlock(&virISCSISessionCacheLock);
+}
+
+
+static int
+virISCSISessionCacheRefreshLocked(void)
 {
     /*
      * # iscsiadm --mode session
@@ -75,12 +133,11 @@ virISCSIGetSession(const char *devpath,
     int vars[] = {
         2,
     };
-    struct virISCSISessionData cbdata = {
-        .session = NULL,
-        .devpath = devpath,
-    };
+    struct virISCSISessionList list = { NULL, 0 };
     char *error = NULL;
     int exitstatus = 0;
+    size_t i;
+    int ret = -1;
 
     virCommandPtr cmd = virCommandNewArgList(ISCSIADM, "--mode",
                                              "session", NULL);
@@ -91,18 +148,65 @@ virISCSIGetSession(const char *devpath,
                            regexes,
                            vars,
                            virISCSIExtractSession,
-                           &cbdata, NULL, &exitstatus) < 0)
+                           &list, NULL, &exitstatus) < 0)
         goto cleanup;
 
-    if (cbdata.session == NULL && !probe)
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("cannot find iscsiadm session: %s"),
-                       NULLSTR(error));
+    virISCSISessionCacheClearLocked();
+    virISCSISessionCacheEntries = list.entries;
+    virISCSISessionCacheCount = list.nentries;
+    virISCSISessionCacheError = error;
+    virISCSISessionCacheWhen = time(NULL);
+    list.entries = NULL;
+    list.nentries = 0;
+    error = NULL;
+
+    ret = 0;
 
  cleanup:
+    for (i = 0; i < list.nentries; i++) {
+        VIR_FREE(list.entries[i].session);
+        VIR_FREE(list.entries[i].devpath);
+    }
+    VIR_FREE(list.entries);
     VIR_FREE(error);
     virCommandFree(cmd);
-    return cbdata.session;
+    return ret;
+}
+
+
+char *
+virISCSIGetSession(const char *devpath,
+                   bool probe)
+{
+    char *session = NULL;
+    time_t now = time(NULL);
+    size_t i;
+
+    virMutexLock(&virISCSISessionCacheLock);
+
+    if (virISCSISessionCacheWhen == 0 ||
+        now < virISCSISessionCacheWhen ||
+        now - virISCSISessionCacheWhen > VIR_ISCSI_SESSION_CACHE_TTL) {
+        if (virISCSISessionCacheRefreshLocked() < 0)
+            goto cleanup;
+    }
+
+    for (i = 0; i < virISCSISessionCacheCount; i++) {
+        if (STREQ(virISCSISessionCacheEntries[i].devpath, devpath)) {
+            if (VIR_STRDUP(session, virISCSISessionCacheEntries[i].session) < 0)
+                goto cleanup;
+            break;
+        }
+    }
+
+    if (session == NULL && !probe)
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cannot find iscsiadm session: %s"),
+                       NULLSTR(virISCSISessionCacheError));
+
+ cleanup:
+    virMutexUnlock(&virISCSISessionCacheLock);
+    return session;
 }
 
 
@@ -321,6 +425,10 @@ virISCSIConnection(const char *portal,
     if (virCommandRun(cmd, NULL) < 0)
         goto cleanup;
 
+    /* Logging into or out of a target changes the set of active
+     * sessions, so any cached listing is now out of date */
+    virISCSISessionCacheInvalidate();
+
     ret = 0;
 
  cleanup:
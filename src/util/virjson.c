@@ -575,8 +575,9 @@ virJSONValueObjectAppend(virJSONValuePtr object,
     if (VIR_STRDUP(newkey, key) < 0)
         return -1;
 
-    if (VIR_REALLOC_N(object->data.object.pairs,
-                      object->data.object.npairs + 1) < 0) {
+    if (VIR_RESIZE_N(object->data.object.pairs,
+                     object->data.object.maxpairs,
+                     object->data.object.npairs, 1) < 0) {
         VIR_FREE(newkey);
         return -1;
     }
@@ -723,8 +724,9 @@ virJSONValueArrayAppend(virJSONValuePtr array,
     if (array->type != VIR_JSON_TYPE_ARRAY)
         return -1;
 
-    if (VIR_REALLOC_N(array->data.array.values,
-                      array->data.array.nvalues + 1) < 0)
+    if (VIR_RESIZE_N(array->data.array.values,
+                     array->data.array.maxvalues,
+                     array->data.array.nvalues, 1) < 0)
         return -1;
 
     array->data.array.values[array->data.array.nvalues] = value;
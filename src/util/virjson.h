@@ -59,11 +59,13 @@ struct _virJSONObjectPair {
 
 struct _virJSONObject {
     size_t npairs;
+    size_t maxpairs; /* tracked allocation, grown geometrically on append */
     virJSONObjectPairPtr pairs;
 };
 
 struct _virJSONArray {
     size_t nvalues;
+    size_t maxvalues; /* tracked allocation, grown geometrically on append */
     virJSONValuePtr *values;
 };
 
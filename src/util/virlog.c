@@ -149,6 +149,43 @@ virLogUnlock(void)
 }
 
 
+/*
+ * Optional asynchronous mode. Instead of writing to the outputs
+ * synchronously, formatted messages are put on a bounded queue which
+ * is drained by a dedicated flusher thread, so the logging thread
+ * only pays for the formatting and a copy. When the queue overflows
+ * messages are dropped rather than blocking the caller and the
+ * number of drops is reported by the flusher once it catches up.
+ */
+#define VIR_LOG_ASYNC_QUEUE_LEN 1024
+
+typedef struct _virLogAsyncRecord virLogAsyncRecord;
+typedef virLogAsyncRecord *virLogAsyncRecordPtr;
+struct _virLogAsyncRecord {
+    virLogSourcePtr source;
+    virLogPriority priority;
+    const char *filename;
+    int linenr;
+    const char *funcname;
+    char timestamp[VIR_TIME_STRING_BUFLEN];
+    unsigned int filterflags;
+    char *str;
+    char *msg;
+};
+
+static bool virLogAsyncEnabled;
+static bool virLogAsyncQuit;
+static virMutex virLogAsyncLock;
+static virCond virLogAsyncCond;
+static virThread virLogAsyncThread;
+static virLogAsyncRecord virLogAsyncQueue[VIR_LOG_ASYNC_QUEUE_LEN];
+/* Next record to be flushed */
+static size_t virLogAsyncHead;
+/* Number of records currently queued */
+static size_t virLogAsyncCount;
+static unsigned long long virLogAsyncDropped;
+
+
 static int
 virLogSetDefaultOutputToStderr(void)
 {
@@ -262,6 +299,10 @@ virLogOnceInit(void)
     if (virMutexInit(&virLogMutex) < 0)
         return -1;
 
+    if (virMutexInit(&virLogAsyncLock) < 0 ||
+        virCondInit(&virLogAsyncCond) < 0)
+        return -1;
+
     virLogLock();
     virLogDefaultPriority = VIR_LOG_DEFAULT;
 
@@ -542,71 +583,26 @@ virLogMessage(virLogSourcePtr source,
 }
 
 
-/**
- * virLogVMessage:
- * @source: where is that message coming from
- * @priority: the priority level
- * @filename: file where the message was emitted
- * @linenr: line where the message was emitted
- * @funcname: the function emitting the (debug) message
- * @metadata: NULL or metadata array, terminated by an item with NULL key
- * @fmt: the string format
- * @vargs: format args
- *
- * Call the libvirt logger with some information. Based on the configuration
- * the message may be stored, sent to output or just discarded
+/*
+ * Deliver a formatted message to all configured outputs. This is
+ * the part of the logging that does the actual (possibly slow) I/O,
+ * invoked either directly from virLogVMessage or from the flusher
+ * thread when the asynchronous mode is enabled.
  */
-void
-virLogVMessage(virLogSourcePtr source,
-               virLogPriority priority,
-               const char *filename,
-               int linenr,
-               const char *funcname,
-               virLogMetadataPtr metadata,
-               const char *fmt,
-               va_list vargs)
+static void
+virLogVMessageDispatch(virLogSourcePtr source,
+                       virLogPriority priority,
+                       const char *filename,
+                       int linenr,
+                       const char *funcname,
+                       virLogMetadataPtr metadata,
+                       unsigned int filterflags,
+                       const char *timestamp,
+                       const char *str,
+                       const char *msg)
 {
     static bool logInitMessageStderr = true;
-    char *str = NULL;
-    char *msg = NULL;
-    char timestamp[VIR_TIME_STRING_BUFLEN];
-    int ret;
     size_t i;
-    int saved_errno = errno;
-    unsigned int filterflags = 0;
-
-    if (virLogInitialize() < 0)
-        return;
-
-    if (fmt == NULL)
-        return;
-
-    /*
-     * 3 intentionally non-thread safe variable reads.
-     * Since writes to the variable are serialized on
-     * virLogLock, worst case result is a log message
-     * is accidentally dropped or emitted, if another
-     * thread is updating log filter list concurrently
-     * with a log message emission.
-     */
-    if (source->serial < virLogFiltersSerial)
-        virLogSourceUpdate(source);
-    if (priority < source->priority)
-        goto cleanup;
-    filterflags = source->flags;
-
-    /*
-     * serialize the error message, add level and timestamp
-     */
-    if (virVasprintfQuiet(&str, fmt, vargs) < 0)
-        goto cleanup;
-
-    ret = virLogFormatString(&msg, linenr, funcname, priority, str);
-    if (ret < 0)
-        goto cleanup;
-
-    if (virTimeStringNowRaw(timestamp) < 0)
-        timestamp[0] = '\0';
 
     virLogLock();
 
@@ -667,6 +663,259 @@ virLogVMessage(virLogSourcePtr source,
                          str, msg, (void *) STDERR_FILENO);
     }
     virLogUnlock();
+}
+
+
+/*
+ * Queue a formatted message for the flusher thread. On success the
+ * ownership of @str and @msg is transferred to the queue. If the
+ * queue is full the message is dropped and accounted for instead of
+ * blocking the caller.
+ */
+static void
+virLogAsyncQueueRecord(virLogSourcePtr source,
+                       virLogPriority priority,
+                       const char *filename,
+                       int linenr,
+                       const char *funcname,
+                       unsigned int filterflags,
+                       const char *timestamp,
+                       char **str,
+                       char **msg)
+{
+    virLogAsyncRecordPtr rec;
+
+    virMutexLock(&virLogAsyncLock);
+
+    if (!virLogAsyncEnabled) {
+        /* Raced with the async mode being turned off, fall back
+         * to the synchronous path */
+        virMutexUnlock(&virLogAsyncLock);
+        virLogVMessageDispatch(source, priority, filename, linenr, funcname,
+                               NULL, filterflags, timestamp, *str, *msg);
+        return;
+    }
+
+    if (virLogAsyncCount == VIR_LOG_ASYNC_QUEUE_LEN) {
+        virLogAsyncDropped++;
+        virMutexUnlock(&virLogAsyncLock);
+        return;
+    }
+
+    rec = &virLogAsyncQueue[(virLogAsyncHead + virLogAsyncCount) %
+                            VIR_LOG_ASYNC_QUEUE_LEN];
+    rec->source = source;
+    rec->priority = priority;
+    rec->filename = filename;
+    rec->linenr = linenr;
+    rec->funcname = funcname;
+    ignore_value(virStrcpyStatic(rec->timestamp, timestamp));
+    rec->filterflags = filterflags;
+    rec->str = *str;
+    rec->msg = *msg;
+    *str = NULL;
+    *msg = NULL;
+
+    virLogAsyncCount++;
+    virCondSignal(&virLogAsyncCond);
+    virMutexUnlock(&virLogAsyncLock);
+}
+
+
+static void
+virLogAsyncReportDropped(unsigned long long dropped)
+{
+    char timestamp[VIR_TIME_STRING_BUFLEN];
+    char *str = NULL;
+    char *msg = NULL;
+
+    if (virAsprintfQuiet(&str,
+                         "dropped %llu log messages due to overflow "
+                         "of the async log queue", dropped) < 0)
+        return;
+
+    if (virLogFormatString(&msg, __LINE__, __func__,
+                           VIR_LOG_WARN, str) < 0)
+        goto cleanup;
+
+    if (virTimeStringNowRaw(timestamp) < 0)
+        timestamp[0] = '\0';
+
+    virLogVMessageDispatch(&virLogSelf, VIR_LOG_WARN,
+                           __FILE__, __LINE__, __func__,
+                           NULL, 0, timestamp, str, msg);
+
+ cleanup:
+    VIR_FREE(str);
+    VIR_FREE(msg);
+}
+
+
+static void
+virLogAsyncFlusher(void *opaque ATTRIBUTE_UNUSED)
+{
+    virMutexLock(&virLogAsyncLock);
+    for (;;) {
+        virLogAsyncRecord rec;
+        unsigned long long dropped;
+
+        while (virLogAsyncCount == 0 && !virLogAsyncQuit) {
+            if (virCondWait(&virLogAsyncCond, &virLogAsyncLock) < 0)
+                goto cleanup;
+        }
+
+        /* Quit only once the queue has been fully drained */
+        if (virLogAsyncCount == 0)
+            break;
+
+        rec = virLogAsyncQueue[virLogAsyncHead];
+        virLogAsyncHead = (virLogAsyncHead + 1) % VIR_LOG_ASYNC_QUEUE_LEN;
+        virLogAsyncCount--;
+        dropped = virLogAsyncDropped;
+        virLogAsyncDropped = 0;
+        virMutexUnlock(&virLogAsyncLock);
+
+        virLogVMessageDispatch(rec.source, rec.priority,
+                               rec.filename, rec.linenr, rec.funcname,
+                               NULL, rec.filterflags, rec.timestamp,
+                               rec.str, rec.msg);
+        VIR_FREE(rec.str);
+        VIR_FREE(rec.msg);
+
+        if (dropped)
+            virLogAsyncReportDropped(dropped);
+
+        virMutexLock(&virLogAsyncLock);
+    }
+ cleanup:
+    virMutexUnlock(&virLogAsyncLock);
+}
+
+
+/**
+ * virLogSetAsync:
+ * @enabled: whether messages should be written out asynchronously
+ *
+ * Enable or disable the asynchronous logging mode. When enabled, a
+ * message is queued for a dedicated flusher thread instead of being
+ * written to the outputs by the logging thread itself, so threads on
+ * hot paths are not serialized on the output I/O. The queue is
+ * bounded; under sustained overload messages are dropped and the
+ * number of dropped messages is logged once the flusher catches up.
+ * Messages logged asynchronously are emitted without metadata.
+ *
+ * Disabling flushes any queued messages before returning.
+ *
+ * Returns 0 if successful, -1 in case of error.
+ */
+int
+virLogSetAsync(bool enabled)
+{
+    if (virLogInitialize() < 0)
+        return -1;
+
+    virMutexLock(&virLogAsyncLock);
+
+    if (enabled == virLogAsyncEnabled) {
+        virMutexUnlock(&virLogAsyncLock);
+        return 0;
+    }
+
+    if (enabled) {
+        virLogAsyncQuit = false;
+        if (virThreadCreate(&virLogAsyncThread, true,
+                            virLogAsyncFlusher, NULL) < 0) {
+            virMutexUnlock(&virLogAsyncLock);
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Unable to start log flusher thread"));
+            return -1;
+        }
+        virLogAsyncEnabled = true;
+        virMutexUnlock(&virLogAsyncLock);
+    } else {
+        virLogAsyncEnabled = false;
+        virLogAsyncQuit = true;
+        virCondSignal(&virLogAsyncCond);
+        virMutexUnlock(&virLogAsyncLock);
+        virThreadJoin(&virLogAsyncThread);
+    }
+
+    return 0;
+}
+
+
+/**
+ * virLogVMessage:
+ * @source: where is that message coming from
+ * @priority: the priority level
+ * @filename: file where the message was emitted
+ * @linenr: line where the message was emitted
+ * @funcname: the function emitting the (debug) message
+ * @metadata: NULL or metadata array, terminated by an item with NULL key
+ * @fmt: the string format
+ * @vargs: format args
+ *
+ * Call the libvirt logger with some information. Based on the configuration
+ * the message may be stored, sent to output or just discarded
+ */
+void
+virLogVMessage(virLogSourcePtr source,
+               virLogPriority priority,
+               const char *filename,
+               int linenr,
+               const char *funcname,
+               virLogMetadataPtr metadata,
+               const char *fmt,
+               va_list vargs)
+{
+    char *str = NULL;
+    char *msg = NULL;
+    char timestamp[VIR_TIME_STRING_BUFLEN];
+    int ret;
+    int saved_errno = errno;
+    unsigned int filterflags = 0;
+
+    if (virLogInitialize() < 0)
+        return;
+
+    if (fmt == NULL)
+        return;
+
+    /*
+     * 3 intentionally non-thread safe variable reads.
+     * Since writes to the variable are serialized on
+     * virLogLock, worst case result is a log message
+     * is accidentally dropped or emitted, if another
+     * thread is updating log filter list concurrently
+     * with a log message emission.
+     */
+    if (source->serial < virLogFiltersSerial)
+        virLogSourceUpdate(source);
+    if (priority < source->priority)
+        goto cleanup;
+    filterflags = source->flags;
+
+    /*
+     * serialize the error message, add level and timestamp
+     */
+    if (virVasprintfQuiet(&str, fmt, vargs) < 0)
+        goto cleanup;
+
+    ret = virLogFormatString(&msg, linenr, funcname, priority, str);
+    if (ret < 0)
+        goto cleanup;
+
+    if (virTimeStringNowRaw(timestamp) < 0)
+        timestamp[0] = '\0';
+
+    /* Unlocked read mirroring the ones above; the queue function
+     * rechecks under its own lock */
+    if (virLogAsyncEnabled)
+        virLogAsyncQueueRecord(source, priority, filename, linenr, funcname,
+                               filterflags, timestamp, &str, &msg);
+    else
+        virLogVMessageDispatch(source, priority, filename, linenr, funcname,
+                               metadata, filterflags, timestamp, str, msg);
 
  cleanup:
     VIR_FREE(str);
@@ -191,6 +191,7 @@ int virLogSetOutputs(const char *outputs);
 int virLogSetFilters(const char *filters);
 char *virLogGetDefaultOutput(void);
 int virLogSetDefaultOutput(const char *fname, bool godaemon, bool privileged);
+int virLogSetAsync(bool enabled);
 
 /*
  * Internal logging API
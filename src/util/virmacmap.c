@@ -47,6 +47,10 @@ struct virMacMap {
     virObjectLockable parent;
 
     virHashTablePtr macs;
+
+    /* Map changed since it was last loaded or written; lets
+     * virMacMapWriteFile skip rewriting an up-to-date file. */
+    bool dirty;
 };
 
 
@@ -101,6 +105,7 @@ virMacMapAddLocked(virMacMapPtr mgr,
         virHashUpdateEntry(mgr->macs, domain, newMacsList) < 0)
         goto cleanup;
     newMacsList = NULL;
+    mgr->dirty = true;
 
     ret = 0;
  cleanup:
@@ -117,7 +122,8 @@ virMacMapRemoveLocked(virMacMapPtr mgr,
     char **macsList = NULL;
     char **newMacsList = NULL;
 
-    if (!(macsList = virHashLookup(mgr->macs, domain)))
+    if (!(macsList = virHashLookup(mgr->macs, domain)) ||
+        !virStringListHasString((const char **) macsList, mac))
         return 0;
 
     newMacsList = macsList;
@@ -129,6 +135,7 @@ virMacMapRemoveLocked(virMacMapPtr mgr,
             virHashUpdateEntry(mgr->macs, domain, newMacsList) < 0)
             return -1;
     }
+    mgr->dirty = true;
 
     return 0;
 }
@@ -276,12 +283,16 @@ virMacMapWriteFileLocked(virMacMapPtr mgr,
     char *str;
     int ret = -1;
 
+    if (!mgr->dirty)
+        return 0;
+
     if (virMacMapDumpStrLocked(mgr, &str) < 0)
         goto cleanup;
 
     if (virFileRewriteStr(file, 0644, str) < 0)
         goto cleanup;
 
+    mgr->dirty = false;
     ret = 0;
  cleanup:
     VIR_FREE(str);
@@ -311,6 +322,9 @@ virMacMapNew(const char *file)
         virMacMapLoadFile(mgr, file) < 0)
         goto error;
 
+    /* The map now matches the file contents */
+    mgr->dirty = false;
+
     virObjectUnlock(mgr);
     return mgr;
 
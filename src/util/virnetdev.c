@@ -542,6 +542,51 @@ int virNetDevSetMTU(const char *ifname, int mtu ATTRIBUTE_UNUSED)
  *
  * Returns 0 in case of success, or -1 on failure
  */
+#if defined(SIOCGIFMTU) && defined(SIOCSIFMTU) && defined(HAVE_STRUCT_IFREQ)
+int virNetDevSetMTUFromDevice(const char *ifname,
+                              const char *otherifname)
+{
+    int fd = -1;
+    int ret = -1;
+    int mtu;
+    struct ifreq ifr;
+
+    /* this runs for every tap device enslaved into a bridge, so use
+     * one control socket for both the query and the update */
+    if ((fd = virNetDevSetupControl(otherifname, &ifr)) < 0)
+        return -1;
+
+    if (ioctl(fd, SIOCGIFMTU, &ifr) < 0) {
+        virReportSystemError(errno,
+                             _("Cannot get interface MTU on '%s'"),
+                             otherifname);
+        goto cleanup;
+    }
+
+    mtu = ifr.ifr_mtu;
+    memset(&ifr, 0, sizeof(ifr));
+    if (virStrcpyStatic(ifr.ifr_name, ifname) == NULL) {
+        virReportSystemError(ERANGE,
+                             _("Network interface name '%s' is too long"),
+                             ifname);
+        goto cleanup;
+    }
+    ifr.ifr_mtu = mtu;
+
+    if (ioctl(fd, SIOCSIFMTU, &ifr) < 0) {
+        virReportSystemError(errno,
+                             _("Cannot set interface MTU on '%s'"),
+                             ifname);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    VIR_FORCE_CLOSE(fd);
+    return ret;
+}
+#else
 int virNetDevSetMTUFromDevice(const char *ifname,
                               const char *otherifname)
 {
@@ -552,6 +597,7 @@ int virNetDevSetMTUFromDevice(const char *ifname,
 
     return virNetDevSetMTU(ifname, mtu);
 }
+#endif
 
 
 /**
@@ -273,6 +273,25 @@ int virNetDevOpenvswitchSetMigrateData(char *migrate, const char *ifname)
     return ret;
 }
 
+/* Look up @name in the "statistics" map printed by ovs-vsctl, e.g.
+ * {collisions=0, rx_bytes=4369, ...}. Absent entries count as 0, just
+ * as the per-entry queries used to treat missing error counters */
+static long long
+virNetDevOpenvswitchStatsEntry(const char *output, const char *name)
+{
+    const char *match;
+    char *end;
+    long long value;
+
+    if (!(match = strstr(output, name)))
+        return 0;
+    match += strlen(name);
+    if (*match != '=' ||
+        virStrToLong_ll(match + 1, &end, 10, &value) < 0)
+        return 0;
+    return value;
+}
+
 /**
  * virNetDevOpenvswitchInterfaceStats:
  * @ifname: the name of the interface
@@ -287,89 +306,34 @@ virNetDevOpenvswitchInterfaceStats(const char *ifname,
                                    virDomainInterfaceStatsPtr stats)
 {
     virCommandPtr cmd = NULL;
-    char *output;
-    long long rx_bytes;
-    long long rx_packets;
-    long long tx_bytes;
-    long long tx_packets;
-    long long rx_errs;
-    long long rx_drop;
-    long long tx_errs;
-    long long tx_drop;
+    char *output = NULL;
     int ret = -1;
 
-    /* Just ensure the interface exists in ovs */
-    cmd = virCommandNewArgList(OVSVSCTL, "--timeout=5",
+    /* fetch the whole statistics map in one go rather than execing
+     * ovs-vsctl once per group of counters */
+    cmd = virCommandNewArgList(OVSVSCTL, "--timeout=5", "--if-exists",
                                "get", "Interface", ifname,
-                               "name", NULL);
+                               "statistics", NULL);
     virCommandSetOutputBuffer(cmd, &output);
 
-    if (virCommandRun(cmd, NULL) < 0) {
+    if (virCommandRun(cmd, NULL) < 0 || !output || *output == '\0') {
         /* no ovs-vsctl or interface 'ifname' doesn't exists in ovs */
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("Interface not found"));
         goto cleanup;
     }
 
-    VIR_FREE(output);
-    virCommandFree(cmd);
-
-    cmd = virCommandNewArgList(OVSVSCTL, "--timeout=5",
-                               "get", "Interface", ifname,
-                               "statistics:rx_bytes",
-                               "statistics:rx_packets",
-                               "statistics:tx_bytes",
-                               "statistics:tx_packets", NULL);
-    virCommandSetOutputBuffer(cmd, &output);
-
-    if (virCommandRun(cmd, NULL) < 0) {
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Interface doesn't have statistics"));
-        goto cleanup;
-    }
-
     /* The TX/RX fields appear to be swapped here
      * because this is the host view. */
-    if (sscanf(output, "%lld\n%lld\n%lld\n%lld\n",
-               &tx_bytes, &tx_packets, &rx_bytes, &rx_packets) != 4) {
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Fail to parse ovs-vsctl output"));
-        goto cleanup;
-    }
-
-    stats->rx_bytes = rx_bytes;
-    stats->rx_packets = rx_packets;
-    stats->tx_bytes = tx_bytes;
-    stats->tx_packets = tx_packets;
-
-    VIR_FREE(output);
-    virCommandFree(cmd);
+    stats->rx_bytes = virNetDevOpenvswitchStatsEntry(output, "tx_bytes");
+    stats->rx_packets = virNetDevOpenvswitchStatsEntry(output, "tx_packets");
+    stats->rx_errs = virNetDevOpenvswitchStatsEntry(output, "tx_errors");
+    stats->rx_drop = virNetDevOpenvswitchStatsEntry(output, "tx_dropped");
+    stats->tx_bytes = virNetDevOpenvswitchStatsEntry(output, "rx_bytes");
+    stats->tx_packets = virNetDevOpenvswitchStatsEntry(output, "rx_packets");
+    stats->tx_errs = virNetDevOpenvswitchStatsEntry(output, "rx_errors");
+    stats->tx_drop = virNetDevOpenvswitchStatsEntry(output, "rx_dropped");
 
-    cmd = virCommandNewArgList(OVSVSCTL, "--timeout=5",
-                               "get", "Interface", ifname,
-                               "statistics:rx_errors",
-                               "statistics:rx_dropped",
-                               "statistics:tx_errors",
-                               "statistics:tx_dropped", NULL);
-    virCommandSetOutputBuffer(cmd, &output);
-    if (virCommandRun(cmd, NULL) < 0) {
-        /* This interface don't have errors or dropped, so set them to 0 */
-        stats->rx_errs = 0;
-        stats->rx_drop = 0;
-        stats->tx_errs = 0;
-        stats->tx_drop = 0;
-    } else if (sscanf(output, "%lld\n%lld\n%lld\n%lld\n",
-                      &tx_errs, &tx_drop, &rx_errs, &rx_drop) == 4) {
-        stats->rx_errs = rx_errs;
-        stats->rx_drop = rx_drop;
-        stats->tx_errs = tx_errs;
-        stats->tx_drop = tx_drop;
-        ret = 0;
-    } else {
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Fail to parse ovs-vsctl output"));
-        goto cleanup;
-    }
     ret = 0;
 
  cleanup:
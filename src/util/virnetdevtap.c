@@ -30,14 +30,17 @@
 #include "virnetdevopenvswitch.h"
 #include "virerror.h"
 #include "virfile.h"
+#include "virhash.h"
 #include "viralloc.h"
 #include "virlog.h"
 #include "virstring.h"
+#include "virthread.h"
 #include "datatypes.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <regex.h>
 #include <dirent.h>
@@ -617,22 +620,45 @@ int virNetDevTapCreateInBridgePort(const char *brname,
  * the interface of a domain they own.  We do no such checking.
  */
 #ifdef __linux__
-int
-virNetDevTapInterfaceStats(const char *ifname,
-                           virDomainInterfaceStatsPtr stats)
+
+/* Snapshot of the last /proc/net/dev parse. One parse describes every
+ * interface on the host, so when the stats of many interfaces are
+ * polled in one sweep (virConnectGetAllDomainStats across hundreds of
+ * vNICs) a single parse can answer all of the lookups. The snapshot
+ * expires after a second so individual queries still see counters
+ * moving; a lookup miss forces a fresh parse so an interface created
+ * after the snapshot was taken is never falsely reported as missing. */
+# define VIR_NET_DEV_TAP_STATS_SNAPSHOT_TTL 1
+
+static virMutex virNetDevTapStatsLock = VIR_MUTEX_INITIALIZER;
+static virHashTablePtr virNetDevTapStatsSnapshot;
+static time_t virNetDevTapStatsSnapshotWhen;
+
+/**
+ * virNetDevTapStatsParse:
+ *
+ * Parse /proc/net/dev into a hash table mapping each interface name
+ * to its virDomainInterfaceStats.
+ *
+ * Returns the filled table, or NULL on failure.
+ */
+static virHashTablePtr
+virNetDevTapStatsParse(void)
 {
-    int ifname_len;
+    virHashTablePtr table;
+    virDomainInterfaceStatsPtr entry = NULL;
     FILE *fp;
-    char line[256], *colon;
+    char line[256], *colon, *name;
 
     fp = fopen("/proc/net/dev", "r");
     if (!fp) {
         virReportSystemError(errno, "%s",
                              _("Could not open /proc/net/dev"));
-        return -1;
+        return NULL;
     }
 
-    ifname_len = strlen(ifname);
+    if (!(table = virHashCreate(67, virHashValueFree)))
+        goto error;
 
     while (fgets(line, sizeof(line), fp)) {
         long long dummy;
@@ -652,40 +678,115 @@ virNetDevTapInterfaceStats(const char *ifname,
         colon = strchr(line, ':');
         if (!colon) continue;
         *colon = '\0';
-        if (colon-ifname_len >= line &&
-            STREQ(colon-ifname_len, ifname)) {
-            /* IMPORTANT NOTE!
-             * /proc/net/dev vif<domid>.nn sees the network from the point
-             * of view of dom0 / hypervisor.  So bytes TRANSMITTED by dom0
-             * are bytes RECEIVED by the domain.  That's why the TX/RX fields
-             * appear to be swapped here.
-             */
-            if (sscanf(colon+1,
-                       "%lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld",
-                       &tx_bytes, &tx_packets, &tx_errs, &tx_drop,
-                       &dummy, &dummy, &dummy, &dummy,
-                       &rx_bytes, &rx_packets, &rx_errs, &rx_drop,
-                       &dummy, &dummy, &dummy, &dummy) != 16)
-                continue;
-
-            stats->rx_bytes = rx_bytes;
-            stats->rx_packets = rx_packets;
-            stats->rx_errs = rx_errs;
-            stats->rx_drop = rx_drop;
-            stats->tx_bytes = tx_bytes;
-            stats->tx_packets = tx_packets;
-            stats->tx_errs = tx_errs;
-            stats->tx_drop = tx_drop;
-            VIR_FORCE_FCLOSE(fp);
-
-            return 0;
-        }
+
+        name = line;
+        while (*name == ' ')
+            name++;
+
+        /* IMPORTANT NOTE!
+         * /proc/net/dev vif<domid>.nn sees the network from the point
+         * of view of dom0 / hypervisor.  So bytes TRANSMITTED by dom0
+         * are bytes RECEIVED by the domain.  That's why the TX/RX fields
+         * appear to be swapped here.
+         */
+        if (sscanf(colon+1,
+                   "%lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld",
+                   &tx_bytes, &tx_packets, &tx_errs, &tx_drop,
+                   &dummy, &dummy, &dummy, &dummy,
+                   &rx_bytes, &rx_packets, &rx_errs, &rx_drop,
+                   &dummy, &dummy, &dummy, &dummy) != 16)
+            continue;
+
+        if (VIR_ALLOC(entry) < 0)
+            goto error;
+
+        entry->rx_bytes = rx_bytes;
+        entry->rx_packets = rx_packets;
+        entry->rx_errs = rx_errs;
+        entry->rx_drop = rx_drop;
+        entry->tx_bytes = tx_bytes;
+        entry->tx_packets = tx_packets;
+        entry->tx_errs = tx_errs;
+        entry->tx_drop = tx_drop;
+
+        if (virHashAddEntry(table, name, entry) < 0)
+            goto error;
+        entry = NULL;
     }
     VIR_FORCE_FCLOSE(fp);
 
-    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                   _("/proc/net/dev: Interface not found"));
-    return -1;
+    return table;
+
+ error:
+    VIR_FREE(entry);
+    virHashFree(table);
+    VIR_FORCE_FCLOSE(fp);
+    return NULL;
+}
+
+/**
+ * virNetDevTapStatsRefreshLocked:
+ *
+ * Replace the interface stats snapshot with a fresh parse of
+ * /proc/net/dev. Caller must hold virNetDevTapStatsLock.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+static int
+virNetDevTapStatsRefreshLocked(void)
+{
+    virHashTablePtr table;
+
+    if (!(table = virNetDevTapStatsParse()))
+        return -1;
+
+    virHashFree(virNetDevTapStatsSnapshot);
+    virNetDevTapStatsSnapshot = table;
+    virNetDevTapStatsSnapshotWhen = time(NULL);
+
+    return 0;
+}
+
+int
+virNetDevTapInterfaceStats(const char *ifname,
+                           virDomainInterfaceStatsPtr stats)
+{
+    virDomainInterfaceStatsPtr entry;
+    bool refreshed = false;
+    int ret = -1;
+
+    virMutexLock(&virNetDevTapStatsLock);
+
+    if (!virNetDevTapStatsSnapshot ||
+        time(NULL) - virNetDevTapStatsSnapshotWhen >
+        VIR_NET_DEV_TAP_STATS_SNAPSHOT_TTL) {
+        if (virNetDevTapStatsRefreshLocked() < 0)
+            goto cleanup;
+        refreshed = true;
+    }
+
+    entry = virHashLookup(virNetDevTapStatsSnapshot, ifname);
+
+    if (!entry && !refreshed) {
+        /* the interface may have been created after the snapshot
+         * was taken */
+        if (virNetDevTapStatsRefreshLocked() < 0)
+            goto cleanup;
+        entry = virHashLookup(virNetDevTapStatsSnapshot, ifname);
+    }
+
+    if (!entry) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("/proc/net/dev: Interface not found"));
+        goto cleanup;
+    }
+
+    *stats = *entry;
+    ret = 0;
+
+ cleanup:
+    virMutexUnlock(&virNetDevTapStatsLock);
+    return ret;
 }
 #elif defined(HAVE_GETIFADDRS) && defined(AF_LINK)
 int
@@ -92,6 +92,8 @@ enum virNetlinkDeleteMode {
     VIR_NETLINK_HANDLE_DELETED,
 };
 
+static void virNetlinkSocketPoolShutdown(void);
+
 /* Unique ID for the next netlink watch to be registered */
 static int nextWatch = 1;
 
@@ -147,12 +149,14 @@ virNetlinkStartup(void)
 /**
  * virNetlinkShutdown:
  *
- * Undo any initialization done by virNetlinkStartup. This currently
- * destroys the placeholder nl_handle.
+ * Undo any initialization done by virNetlinkStartup. This destroys
+ * the placeholder nl_handle and closes all pooled netlink sockets.
  */
 void
 virNetlinkShutdown(void)
 {
+    virNetlinkSocketPoolShutdown();
+
     if (placeholder_nlhandle) {
         virNetlinkFree(placeholder_nlhandle);
         placeholder_nlhandle = NULL;
@@ -210,6 +214,101 @@ virNetlinkCreateSocket(int protocol)
 }
 
 
+/* Cache of connected netlink sockets, one free list per protocol.
+ * Creating and binding a netlink socket for every request is
+ * measurable when many VMs start concurrently; reusing connected
+ * sockets avoids most of that setup cost. */
+# define NETLINK_SOCKET_POOL_MAX 8
+
+static virMutex netlinkSocketPoolLock = VIR_MUTEX_INITIALIZER;
+static virNetlinkHandle *netlinkSocketPool[MAX_LINKS][NETLINK_SOCKET_POOL_MAX];
+static size_t netlinkSocketPoolCount[MAX_LINKS];
+
+/**
+ * virNetlinkSocketAcquire:
+ *
+ * @protocol: which protocol to connect to (e.g. NETLINK_ROUTE)
+ *
+ * Take a connected netlink socket from the pool, or create a new one
+ * if the pool is empty. The caller must hand the socket back with
+ * virNetlinkSocketRelease.
+ *
+ * Returns a handle to the netlink socket, or NULL if there was a failure.
+ */
+static virNetlinkHandle *
+virNetlinkSocketAcquire(unsigned int protocol)
+{
+    virNetlinkHandle *nlhandle = NULL;
+
+    virMutexLock(&netlinkSocketPoolLock);
+    if (netlinkSocketPoolCount[protocol] > 0)
+        nlhandle = netlinkSocketPool[protocol][--netlinkSocketPoolCount[protocol]];
+    virMutexUnlock(&netlinkSocketPoolLock);
+
+    if (!nlhandle)
+        nlhandle = virNetlinkCreateSocket(protocol);
+
+    return nlhandle;
+}
+
+/**
+ * virNetlinkSocketRelease:
+ *
+ * @protocol: the protocol the socket is connected to
+ * @nlhandle: the netlink socket
+ * @reusable: whether the exchange on the socket completed cleanly
+ *
+ * Return a netlink socket to the pool. A socket whose last exchange
+ * failed or timed out may still have unread data queued and is closed
+ * instead of being reused; the same happens when the pool is full.
+ */
+static void
+virNetlinkSocketRelease(unsigned int protocol,
+                        virNetlinkHandle *nlhandle,
+                        bool reusable)
+{
+    if (!nlhandle)
+        return;
+
+    if (reusable) {
+        virMutexLock(&netlinkSocketPoolLock);
+        if (netlinkSocketPoolCount[protocol] < NETLINK_SOCKET_POOL_MAX) {
+            netlinkSocketPool[protocol][netlinkSocketPoolCount[protocol]++] =
+                nlhandle;
+            nlhandle = NULL;
+        }
+        virMutexUnlock(&netlinkSocketPoolLock);
+    }
+
+    if (nlhandle) {
+        nl_close(nlhandle);
+        virNetlinkFree(nlhandle);
+    }
+}
+
+/**
+ * virNetlinkSocketPoolShutdown:
+ *
+ * Close all pooled netlink sockets.
+ */
+static void
+virNetlinkSocketPoolShutdown(void)
+{
+    size_t i;
+
+    virMutexLock(&netlinkSocketPoolLock);
+    for (i = 0; i < MAX_LINKS; i++) {
+        while (netlinkSocketPoolCount[i] > 0) {
+            virNetlinkHandle *nlhandle =
+                netlinkSocketPool[i][--netlinkSocketPoolCount[i]];
+            nl_close(nlhandle);
+            virNetlinkFree(nlhandle);
+        }
+    }
+    virMutexUnlock(&netlinkSocketPoolLock);
+}
+
+
 /**
  * virNetlinkCommand:
  * @nlmsg: pointer to netlink message
@@ -250,8 +349,15 @@ int virNetlinkCommand(struct nl_msg *nl_msg,
         goto cleanup;
     }
 
-    if (!(nlhandle = virNetlinkCreateSocket(protocol)))
-        goto cleanup;
+    /* joining a multicast group changes the socket's state, so such
+     * sockets are not taken from (or returned to) the pool */
+    if (groups) {
+        if (!(nlhandle = virNetlinkCreateSocket(protocol)))
+            goto cleanup;
+    } else {
+        if (!(nlhandle = virNetlinkSocketAcquire(protocol)))
+            goto cleanup;
+    }
 
     fd = nl_socket_get_fd(nlhandle);
     if (fd < 0) {
@@ -311,7 +417,14 @@ int virNetlinkCommand(struct nl_msg *nl_msg,
         *respbuflen = 0;
     }
 
-    virNetlinkFree(nlhandle);
+    if (groups) {
+        if (nlhandle) {
+            nl_close(nlhandle);
+            virNetlinkFree(nlhandle);
+        }
+    } else {
+        virNetlinkSocketRelease(protocol, nlhandle, ret == 0);
+    }
     return ret;
 }
 
@@ -436,6 +549,158 @@ virNetlinkDumpLink(const char *ifname, int ifindex,
 }
 
 
+/**
+ * virNetlinkDumpAllLinks:
+ *
+ * @callback: function called once per interface with the parsed
+ *            RTM_NEWLINK message and its attributes
+ * @opaque:   pointer passed through to @callback
+ *
+ * Dump the state of all network interfaces in a single RTM_GETLINK
+ * exchange with the kernel instead of querying them one by one. The
+ * callback may return -1 to abort the dump with an error; the
+ * remaining messages of the dump are still drained from the socket.
+ *
+ * Returns 0 on success, -1 on fatal error.
+ */
+int
+virNetlinkDumpAllLinks(virNetlinkDumpLinkCallback callback,
+                       void *opaque)
+{
+    int rc = -1;
+    bool done = false;
+    struct ifinfomsg ifinfo = { .ifi_family = AF_UNSPEC };
+    struct nl_msg *nl_msg = NULL;
+    virNetlinkHandle *nlhandle = NULL;
+    struct nlmsghdr *resp = NULL;
+    struct pollfd fds[1];
+    int cbrc = 0;
+
+    nl_msg = nlmsg_alloc_simple(RTM_GETLINK, NLM_F_REQUEST | NLM_F_DUMP);
+    if (!nl_msg) {
+        virReportOOMError();
+        return -1;
+    }
+
+    if (nlmsg_append(nl_msg, &ifinfo, sizeof(ifinfo), NLMSG_ALIGNTO) < 0)
+        goto buffer_too_small;
+
+# ifdef RTEXT_FILTER_VF
+    /* if this filter exists in the kernel's netlink implementation,
+     * we need to set it, otherwise the response messages will not
+     * contain the IFLA_VFINFO_LIST that we're looking for.
+     */
+    {
+        uint32_t ifla_ext_mask = RTEXT_FILTER_VF;
+
+        if (nla_put(nl_msg, IFLA_EXT_MASK,
+                    sizeof(ifla_ext_mask), &ifla_ext_mask) < 0) {
+            goto buffer_too_small;
+        }
+    }
+# endif
+
+    if (!(nlhandle = virNetlinkSocketAcquire(NETLINK_ROUTE)))
+        goto cleanup;
+
+    nlmsg_hdr(nl_msg)->nlmsg_pid = getpid();
+
+    if (nl_send_auto_complete(nlhandle, nl_msg) < 0) {
+        virReportSystemError(errno,
+                             "%s", _("cannot send to netlink socket"));
+        goto cleanup;
+    }
+
+    while (!done) {
+        struct nlmsghdr *msg;
+        int len;
+        int n;
+
+        memset(fds, 0, sizeof(fds));
+        fds[0].fd = nl_socket_get_fd(nlhandle);
+        fds[0].events = POLLIN;
+
+        n = poll(fds, ARRAY_CARDINALITY(fds), NETLINK_ACK_TIMEOUT_S);
+        if (n <= 0) {
+            if (n < 0)
+                virReportSystemError(errno, "%s",
+                                     _("error in poll call"));
+            if (n == 0)
+                virReportSystemError(ETIMEDOUT, "%s",
+                                     _("no valid netlink response was received"));
+            goto cleanup;
+        }
+
+        len = nl_recv(nlhandle, NULL, (unsigned char **)&resp, NULL);
+        if (len <= 0) {
+            virReportSystemError(errno, "%s", _("nl_recv failed"));
+            goto cleanup;
+        }
+
+        for (msg = resp; NLMSG_OK(msg, len); msg = NLMSG_NEXT(msg, len)) {
+            struct nlattr *tb[IFLA_MAX + 1];
+            struct nlmsgerr *err;
+
+            switch (msg->nlmsg_type) {
+            case NLMSG_DONE:
+                done = true;
+                break;
+
+            case NLMSG_ERROR:
+                err = (struct nlmsgerr *)NLMSG_DATA(msg);
+                if (msg->nlmsg_len < NLMSG_LENGTH(sizeof(*err)))
+                    goto malformed_resp;
+
+                if (err->error) {
+                    virReportSystemError(-err->error, "%s",
+                                         _("error dumping interfaces"));
+                    goto cleanup;
+                }
+                break;
+
+            case RTM_NEWLINK:
+                /* once the callback failed only drain the remaining
+                 * messages of the dump */
+                if (cbrc < 0)
+                    break;
+
+                if (nlmsg_parse(msg, sizeof(struct ifinfomsg),
+                                tb, IFLA_MAX, NULL) < 0)
+                    goto malformed_resp;
+
+                cbrc = callback(msg, tb, opaque);
+                break;
+
+            default:
+                goto malformed_resp;
+            }
+
+            if (done)
+                break;
+        }
+        VIR_FREE(resp);
+    }
+
+    rc = cbrc;
+ cleanup:
+    VIR_FREE(resp);
+    nlmsg_free(nl_msg);
+    /* the socket only holds unread data if the dump did not complete */
+    virNetlinkSocketRelease(NETLINK_ROUTE, nlhandle, done);
+    return rc;
+
+ malformed_resp:
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("malformed netlink response message"));
+    goto cleanup;
+
+ buffer_too_small:
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("allocated netlink buffer is too small"));
+    goto cleanup;
+}
+
+
 /**
  * virNetlinkDelLink:
  *
@@ -1057,6 +1322,16 @@ virNetlinkDumpLink(const char *ifname ATTRIBUTE_UNUSED,
 }
 
 
+int
+virNetlinkDumpAllLinks(virNetlinkDumpLinkCallback callback ATTRIBUTE_UNUSED,
+                       void *opaque ATTRIBUTE_UNUSED)
+{
+    virReportSystemError(ENOSYS, "%s",
+                         _("Unable to dump link info on this platform"));
+    return -1;
+}
+
+
 int
 virNetlinkDelLink(const char *ifname ATTRIBUTE_UNUSED,
                   virNetlinkDelLinkFallback fallback ATTRIBUTE_UNUSED)
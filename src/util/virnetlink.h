@@ -63,6 +63,14 @@ int virNetlinkDumpLink(const char *ifname, int ifindex,
                        uint32_t src_pid, uint32_t dst_pid)
     ATTRIBUTE_RETURN_CHECK;
 
+typedef int (*virNetlinkDumpLinkCallback)(struct nlmsghdr *msg,
+                                          struct nlattr **tb,
+                                          void *opaque);
+
+int virNetlinkDumpAllLinks(virNetlinkDumpLinkCallback callback,
+                           void *opaque)
+    ATTRIBUTE_RETURN_CHECK;
+
 typedef void (*virNetlinkEventHandleCallback)(struct nlmsghdr *,
                                               unsigned int length,
                                               struct sockaddr_nl *peer,
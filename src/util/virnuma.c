@@ -52,6 +52,98 @@
 VIR_LOG_INIT("util.numa");
 
 
+/**
+ * virNumaGetPlacementAdviceLocal:
+ * @vcpus: number of vCPUs the domain is configured with
+ * @balloon: size of the domain's memory in KiB
+ *
+ * Compute an advisory nodeset for automatic placement from a snapshot
+ * of the current per-node free memory. Nodes are picked in order of
+ * free memory until the picked set can hold the whole domain memory
+ * and offers at least as many CPUs as the domain has vCPUs. If the
+ * host is too loaded to satisfy the domain from a node subset, all
+ * available nodes are advised and the kernel is left to spread the
+ * load.
+ *
+ * Returns the advisory nodeset on success, NULL on error (with the
+ * error reported).
+ */
+static char *
+virNumaGetPlacementAdviceLocal(unsigned short vcpus,
+                               unsigned long long balloon)
+{
+    char *advice = NULL;
+    virBitmapPtr nodeset = NULL;
+    virBitmapPtr cpumap = NULL;
+    unsigned long long *freemem = NULL;
+    int *ncpus = NULL;
+    unsigned long long needmem = balloon * 1024;
+    unsigned long long gotmem = 0;
+    unsigned int gotcpus = 0;
+    int maxnode;
+    size_t i;
+
+    if ((maxnode = virNumaGetMaxNode()) < 0)
+        return NULL;
+
+    if (VIR_ALLOC_N(freemem, maxnode + 1) < 0 ||
+        VIR_ALLOC_N(ncpus, maxnode + 1) < 0 ||
+        !(nodeset = virBitmapNew(maxnode + 1)))
+        goto cleanup;
+
+    for (i = 0; i <= (size_t)maxnode; i++) {
+        ncpus[i] = -1; /* not a candidate */
+
+        if (!virNumaNodeIsAvailable(i))
+            continue;
+
+        if (virNumaGetNodeMemory(i, NULL, &freemem[i]) < 0)
+            continue;
+
+        if (virNumaGetNodeCPUs(i, &cpumap) < 0)
+            continue;
+
+        ncpus[i] = virBitmapCountBits(cpumap);
+        virBitmapFree(cpumap);
+        cpumap = NULL;
+    }
+
+    while (gotmem < needmem || gotcpus < vcpus) {
+        ssize_t best = -1;
+
+        for (i = 0; i <= (size_t)maxnode; i++) {
+            if (ncpus[i] < 0 || virBitmapIsBitSet(nodeset, i))
+                continue;
+            if (best < 0 || freemem[i] > freemem[best])
+                best = i;
+        }
+
+        if (best < 0) {
+            if (virBitmapIsAllClear(nodeset)) {
+                virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                               _("no NUMA node is available for "
+                                 "automatic placement"));
+                goto cleanup;
+            }
+            /* every available node is picked already */
+            break;
+        }
+
+        ignore_value(virBitmapSetBit(nodeset, best));
+        gotmem += freemem[best];
+        gotcpus += ncpus[best];
+    }
+
+    advice = virBitmapFormat(nodeset);
+
+ cleanup:
+    virBitmapFree(cpumap);
+    virBitmapFree(nodeset);
+    VIR_FREE(freemem);
+    VIR_FREE(ncpus);
+    return advice;
+}
+
 #if HAVE_NUMAD
 char *
 virNumaGetAutoPlacementAdvice(unsigned short vcpus,
@@ -66,22 +158,23 @@ virNumaGetAutoPlacementAdvice(unsigned short vcpus,
 
     virCommandSetOutputBuffer(cmd, &output);
 
-    if (virCommandRun(cmd, NULL) < 0)
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Failed to query numad for the "
-                         "advisory nodeset"));
+    if (virCommandRun(cmd, NULL) < 0 || !output || *output == '\0') {
+        VIR_WARN("Failed to query numad for the advisory nodeset, "
+                 "using the internal placement advisor");
+        virResetLastError();
+        VIR_FREE(output);
+        output = virNumaGetPlacementAdviceLocal(vcpus, balloon);
+    }
 
     virCommandFree(cmd);
     return output;
 }
 #else /* !HAVE_NUMAD */
 char *
-virNumaGetAutoPlacementAdvice(unsigned short vcpus ATTRIBUTE_UNUSED,
-                              unsigned long long balloon ATTRIBUTE_UNUSED)
+virNumaGetAutoPlacementAdvice(unsigned short vcpus,
+                              unsigned long long balloon)
 {
-    virReportError(VIR_ERR_CONFIG_UNSUPPORTED, "%s",
-                   _("numad is not available on this host"));
-    return NULL;
+    return virNumaGetPlacementAdviceLocal(vcpus, balloon);
 }
 #endif /* !HAVE_NUMAD */
 
@@ -508,26 +601,38 @@ virNumaGetHugePageInfoPath(char **path,
                           node, page_size, suffix ? suffix : "");
     }
 
-    if (ret >= 0 && !virFileExists(*path)) {
-        ret = -1;
-        if (node != -1) {
-            if (!virNumaNodeIsAvailable(node)) {
-                virReportError(VIR_ERR_OPERATION_FAILED,
-                               _("NUMA node %d is not available"),
-                               node);
-            } else {
-                virReportError(VIR_ERR_OPERATION_FAILED,
-                               _("page size %u is not available on node %d"),
-                               page_size, node);
-            }
+    return ret;
+}
+
+/**
+ * virNumaHugePageReportMissing:
+ * @node: NUMA node id, or -1 for overall system info
+ * @page_size: which huge page are we interested in
+ *
+ * Report why a huge page counter could not be read.  Called only
+ * after an access to the counter file has already failed, so that
+ * the common success path does not pay for an extra existence check
+ * on every read.
+ */
+static void
+virNumaHugePageReportMissing(int node,
+                             unsigned int page_size)
+{
+    if (node != -1) {
+        if (!virNumaNodeIsAvailable(node)) {
+            virReportError(VIR_ERR_OPERATION_FAILED,
+                           _("NUMA node %d is not available"),
+                           node);
         } else {
             virReportError(VIR_ERR_OPERATION_FAILED,
-                           _("page size %u is not available"),
-                           page_size);
+                           _("page size %u is not available on node %d"),
+                           page_size, node);
         }
+    } else {
+        virReportError(VIR_ERR_OPERATION_FAILED,
+                       _("page size %u is not available"),
+                       page_size);
     }
-
-    return ret;
 }
 
 static int
@@ -576,8 +681,11 @@ virNumaGetHugePageInfo(int node,
                                        page_size, "nr_hugepages") < 0)
             goto cleanup;
 
-        if (virFileReadAll(path, 1024, &buf) < 0)
+        if (virFileReadAll(path, 1024, &buf) < 0) {
+            if (!virFileExists(path))
+                virNumaHugePageReportMissing(node, page_size);
             goto cleanup;
+        }
 
         if (virStrToLong_ui(buf, &end, 10, page_avail) < 0 ||
             *end != '\n') {
@@ -595,8 +703,11 @@ virNumaGetHugePageInfo(int node,
                                        page_size, "free_hugepages") < 0)
             goto cleanup;
 
-        if (virFileReadAll(path, 1024, &buf) < 0)
+        if (virFileReadAll(path, 1024, &buf) < 0) {
+            if (!virFileExists(path))
+                virNumaHugePageReportMissing(node, page_size);
             goto cleanup;
+        }
 
         if (virStrToLong_ui(buf, &end, 10, page_free) < 0 ||
             *end != '\n') {
@@ -856,8 +967,11 @@ virNumaSetPagePoolSize(int node,
         goto cleanup;
 
     /* Firstly check, if there's anything for us to do */
-    if (virFileReadAll(nr_path, 1024, &nr_buf) < 0)
+    if (virFileReadAll(nr_path, 1024, &nr_buf) < 0) {
+        if (!virFileExists(nr_path))
+            virNumaHugePageReportMissing(node, page_size);
         goto cleanup;
+    }
 
     if (virStrToLong_ull(nr_buf, &end, 10, &nr_count) < 0 ||
         *end != '\n') {
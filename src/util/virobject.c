@@ -49,8 +49,10 @@ struct _virClass {
 
 static virClassPtr virObjectClass;
 static virClassPtr virObjectLockableClass;
+static virClassPtr virObjectRWLockableClass;
 
 static void virObjectLockableDispose(void *anyobj);
+static void virObjectRWLockableDispose(void *anyobj);
 
 static int virObjectOnceInit(void)
 {
@@ -66,6 +68,12 @@ static int virObjectOnceInit(void)
                                                virObjectLockableDispose)))
         return -1;
 
+    if (!(virObjectRWLockableClass = virClassNew(virObjectClass,
+                                                 "virObjectRWLockable",
+                                                 sizeof(virObjectRWLockable),
+                                                 virObjectRWLockableDispose)))
+        return -1;
+
     return 0;
 }
 
@@ -100,6 +108,20 @@ virClassPtr virClassForObjectLockable(void)
 }
 
 
+/**
+ * virClassForObjectRWLockable:
+ *
+ * Returns the class instance for the virObjectRWLockable type
+ */
+virClassPtr virClassForObjectRWLockable(void)
+{
+    if (virObjectInitialize() < 0)
+        return NULL;
+
+    return virObjectRWLockableClass;
+}
+
+
 /**
  * virClassNew:
  * @parent: the parent class
@@ -237,6 +259,39 @@ static void virObjectLockableDispose(void *anyobj)
     virMutexDestroy(&obj->lock);
 }
 
+
+void *virObjectRWLockableNew(virClassPtr klass)
+{
+    virObjectRWLockablePtr obj;
+
+    if (!virClassIsDerivedFrom(klass, virClassForObjectRWLockable())) {
+        virReportInvalidArg(klass,
+                            _("Class %s must derive from virObjectRWLockable"),
+                            virClassName(klass));
+        return NULL;
+    }
+
+    if (!(obj = virObjectNew(klass)))
+        return NULL;
+
+    if (virRWLockInit(&obj->lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to initialize RW lock"));
+        virObjectUnref(obj);
+        return NULL;
+    }
+
+    return obj;
+}
+
+
+static void virObjectRWLockableDispose(void *anyobj)
+{
+    virObjectRWLockablePtr obj = anyobj;
+
+    virRWLockDestroy(&obj->lock);
+}
+
 /**
  * virObjectUnref:
  * @anyobj: any instance of virObjectPtr
@@ -324,6 +379,59 @@ void virObjectLock(void *anyobj)
 }
 
 
+/**
+ * virObjectRWLockRead:
+ * @anyobj: any instance of virObjectRWLockablePtr
+ *
+ * Acquire a read lock on @anyobj. The lock must be
+ * released by virObjectRWUnlock. Concurrent readers
+ * are allowed to hold the lock at the same time.
+ *
+ * The caller is expected to have acquired a reference
+ * on the object before locking it (eg virObjectRef).
+ * The object must be unlocked before releasing this
+ * reference.
+ */
+void virObjectRWLockRead(void *anyobj)
+{
+    virObjectRWLockablePtr obj = anyobj;
+
+    if (!virObjectIsClass(obj, virObjectRWLockableClass)) {
+        VIR_WARN("Object %p (%s) is not a virObjectRWLockable instance",
+                 obj, obj ? obj->parent.klass->name : "(unknown)");
+        return;
+    }
+
+    virRWLockRead(&obj->lock);
+}
+
+
+/**
+ * virObjectRWLockWrite:
+ * @anyobj: any instance of virObjectRWLockablePtr
+ *
+ * Acquire a write lock on @anyobj. The lock must be
+ * released by virObjectRWUnlock.
+ *
+ * The caller is expected to have acquired a reference
+ * on the object before locking it (eg virObjectRef).
+ * The object must be unlocked before releasing this
+ * reference.
+ */
+void virObjectRWLockWrite(void *anyobj)
+{
+    virObjectRWLockablePtr obj = anyobj;
+
+    if (!virObjectIsClass(obj, virObjectRWLockableClass)) {
+        VIR_WARN("Object %p (%s) is not a virObjectRWLockable instance",
+                 obj, obj ? obj->parent.klass->name : "(unknown)");
+        return;
+    }
+
+    virRWLockWrite(&obj->lock);
+}
+
+
 /**
  * virObjectUnlock:
  * @anyobj: any instance of virObjectLockablePtr
@@ -345,6 +453,27 @@ void virObjectUnlock(void *anyobj)
 }
 
 
+/**
+ * virObjectRWUnlock:
+ * @anyobj: any instance of virObjectRWLockablePtr
+ *
+ * Release a lock on @anyobj. The lock must have been
+ * acquired by virObjectRWLockRead or virObjectRWLockWrite.
+ */
+void virObjectRWUnlock(void *anyobj)
+{
+    virObjectRWLockablePtr obj = anyobj;
+
+    if (!virObjectIsClass(obj, virObjectRWLockableClass)) {
+        VIR_WARN("Object %p (%s) is not a virObjectRWLockable instance",
+                 obj, obj ? obj->parent.klass->name : "(unknown)");
+        return;
+    }
+
+    virRWLockUnlock(&obj->lock);
+}
+
+
 /**
  * virObjectIsClass:
  * @anyobj: any instance of virObjectPtr
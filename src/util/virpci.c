@@ -83,6 +83,10 @@ struct _virPCIDevice {
     unsigned int  pci_pm_cap_pos;
     bool          has_flr;
     bool          has_pm_reset;
+    /* true if the capability data above was already read from config
+     * space; it is static for a given device, so it never needs to be
+     * read more than once per device object (or per tracked copy) */
+    bool          caps_probed;
     bool          managed;
 
     virPCIStubDriver stubDriver;
@@ -913,6 +917,9 @@ virPCIDeviceInit(virPCIDevicePtr dev, int cfgfd)
 {
     int flr;
 
+    if (dev->caps_probed)
+        return 0;
+
     dev->pcie_cap_pos   = virPCIDeviceFindCapabilityOffset(dev, cfgfd, PCI_CAP_ID_EXP);
     dev->pci_pm_cap_pos = virPCIDeviceFindCapabilityOffset(dev, cfgfd, PCI_CAP_ID_PM);
     flr = virPCIDeviceDetectFunctionLevelReset(dev, cfgfd);
@@ -920,6 +927,7 @@ virPCIDeviceInit(virPCIDevicePtr dev, int cfgfd)
         return flr;
     dev->has_flr        = !!flr;
     dev->has_pm_reset   = !!virPCIDeviceDetectPowerManagementReset(dev, cfgfd);
+    dev->caps_probed    = true;
 
     return 0;
 }
@@ -931,6 +939,7 @@ virPCIDeviceReset(virPCIDevicePtr dev,
 {
     char *drvPath = NULL;
     char *drvName = NULL;
+    virPCIDevicePtr tracked = NULL;
     int ret = -1;
     int fd = -1;
 
@@ -940,6 +949,22 @@ virPCIDeviceReset(virPCIDevicePtr dev,
         return -1;
     }
 
+    /* The hostdev managers keep long-lived copies of each assignable
+     * device on their device lists; reuse the capability data probed
+     * on a previous reset of the same device rather than re-reading
+     * config space at every VM start.
+     */
+    if (inactiveDevs)
+        tracked = virPCIDeviceListFind(inactiveDevs, dev);
+    if (!dev->caps_probed && tracked && tracked->caps_probed &&
+        STREQ(tracked->id, dev->id)) {
+        dev->pcie_cap_pos = tracked->pcie_cap_pos;
+        dev->pci_pm_cap_pos = tracked->pci_pm_cap_pos;
+        dev->has_flr = tracked->has_flr;
+        dev->has_pm_reset = tracked->has_pm_reset;
+        dev->caps_probed = true;
+    }
+
     /* If the device is currently bound to vfio-pci, ignore all
      * requests to reset it, since the vfio-pci driver will always
      * reset it whenever appropriate, so doing it ourselves would just
@@ -956,15 +981,33 @@ virPCIDeviceReset(virPCIDevicePtr dev,
     }
     VIR_DEBUG("Resetting device %s", dev->name);
 
+    /* KVM will perform FLR when starting and stopping
+     * a guest, so there is no need for us to do it here.
+     * With cached capability data this also avoids opening
+     * config space altogether.
+     */
+    if (dev->caps_probed && dev->has_flr) {
+        ret = 0;
+        goto cleanup;
+    }
+
     if ((fd = virPCIDeviceConfigOpen(dev, true)) < 0)
         goto cleanup;
 
     if (virPCIDeviceInit(dev, fd) < 0)
         goto cleanup;
 
-    /* KVM will perform FLR when starting and stopping
-     * a guest, so there is no need for us to do it here.
+    /* Remember the probed data on the tracked copy so that the next
+     * reset of this device can skip the probing entirely.
      */
+    if (tracked && !tracked->caps_probed && STREQ(tracked->id, dev->id)) {
+        tracked->pcie_cap_pos = dev->pcie_cap_pos;
+        tracked->pci_pm_cap_pos = dev->pci_pm_cap_pos;
+        tracked->has_flr = dev->has_flr;
+        tracked->has_pm_reset = dev->has_pm_reset;
+        tracked->caps_probed = true;
+    }
+
     if (dev->has_flr) {
         ret = 0;
         goto cleanup;
@@ -307,6 +307,43 @@ virPerfReadEvent(virPerfPtr perf,
     return 0;
 }
 
+/* Harvest every enabled counter in one call. The kernel refuses
+ * PERF_FORMAT_GROUP for counters opened with attr.inherit set, and
+ * inherit is what makes our counters cover the threads qemu spawns
+ * after the event is attached, so each counter still costs one read();
+ * this is the single place to convert to a group read should the
+ * counters ever move to a per-cgroup attachment. */
+int
+virPerfReadEvents(virPerfPtr perf,
+                  uint64_t values[VIR_PERF_EVENT_LAST])
+{
+    size_t i;
+
+    if (!perf)
+        return -1;
+
+    for (i = 0; i < VIR_PERF_EVENT_LAST; i++) {
+        virPerfEventPtr event = perf->events + i;
+
+        values[i] = 0;
+
+        if (!event->enabled)
+            continue;
+
+        if (saferead(event->fd, &values[i], sizeof(uint64_t)) < 0) {
+            virReportSystemError(errno,
+                                 _("unable to read perf event for %s"),
+                                 virPerfEventTypeToString(event->type));
+            return -1;
+        }
+
+        if (i == VIR_PERF_EVENT_CMT)
+            values[i] *= event->efields.cmt.scale;
+    }
+
+    return 0;
+}
+
 #else
 static int
 virPerfRdtAttrInit(void)
@@ -351,6 +388,15 @@ virPerfReadEvent(virPerfPtr perf ATTRIBUTE_UNUSED,
     return -1;
 }
 
+int
+virPerfReadEvents(virPerfPtr perf ATTRIBUTE_UNUSED,
+                  uint64_t values[VIR_PERF_EVENT_LAST] ATTRIBUTE_UNUSED)
+{
+    virReportSystemError(ENXIO, "%s",
+                         _("Perf not supported on this platform"));
+    return -1;
+}
+
 #endif
 
 virPerfPtr
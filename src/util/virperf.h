@@ -74,4 +74,9 @@ int virPerfReadEvent(virPerfPtr perf,
                      virPerfEventType type,
                      uint64_t *value);
 
+/* Read all enabled events in one call; entries of disabled events
+ * are set to 0. */
+int virPerfReadEvents(virPerfPtr perf,
+                      uint64_t values[VIR_PERF_EVENT_LAST]);
+
 #endif /* __VIR_PERF_H__ */
@@ -44,6 +44,10 @@ struct _virPortAllocator {
     unsigned short start;
     unsigned short end;
 
+    /* Offset into the bitmap where the next acquisition starts
+     * scanning, so filling N ports costs N probes rather than N^2 */
+    size_t nextFree;
+
     unsigned int flags;
 };
 
@@ -177,31 +181,38 @@ int virPortAllocatorAcquire(virPortAllocatorPtr pa,
 {
     int ret = -1;
     size_t i;
+    size_t range;
 
     *port = 0;
     virObjectLock(pa);
 
-    for (i = pa->start; i <= pa->end && !*port; i++) {
+    range = (pa->end - pa->start) + 1;
+
+    /* Start scanning where the previous acquisition left off and wrap
+     * around, rather than re-probing the filled bottom of the range */
+    for (i = 0; i < range && !*port; i++) {
+        size_t bit = (pa->nextFree + i) % range;
+        unsigned short cand = pa->start + bit;
         bool used = false, v6used = false;
 
-        if (virBitmapIsBitSet(pa->bitmap, i - pa->start))
+        if (virBitmapIsBitSet(pa->bitmap, bit))
             continue;
 
         if (!(pa->flags & VIR_PORT_ALLOCATOR_SKIP_BIND_CHECK)) {
-            if (virPortAllocatorBindToPort(&v6used, i, AF_INET6) < 0 ||
-                virPortAllocatorBindToPort(&used, i, AF_INET) < 0)
+            if (virPortAllocatorBindToPort(&v6used, cand, AF_INET6) < 0 ||
+                virPortAllocatorBindToPort(&used, cand, AF_INET) < 0)
                 goto cleanup;
         }
 
         if (!used && !v6used) {
             /* Add port to bitmap of reserved ports */
-            if (virBitmapSetBit(pa->bitmap,
-                                i - pa->start) < 0) {
+            if (virBitmapSetBit(pa->bitmap, bit) < 0) {
                 virReportError(VIR_ERR_INTERNAL_ERROR,
-                               _("Failed to reserve port %zu"), i);
+                               _("Failed to reserve port %d"), cand);
                 goto cleanup;
             }
-            *port = i;
+            pa->nextFree = (bit + 1) % range;
+            *port = cand;
             ret = 0;
         }
     }
@@ -241,6 +252,10 @@ int virPortAllocatorRelease(virPortAllocatorPtr pa,
         goto cleanup;
     }
 
+    /* Let the next acquisition reuse freed low ports */
+    if ((size_t)(port - pa->start) < pa->nextFree)
+        pa->nextFree = port - pa->start;
+
     ret = 0;
  cleanup:
     virObjectUnlock(pa);
@@ -276,6 +291,8 @@ int virPortAllocatorSetUsed(virPortAllocatorPtr pa,
                            port);
             goto cleanup;
         }
+        if ((size_t)(port - pa->start) < pa->nextFree)
+            pa->nextFree = port - pa->start;
     }
 
     ret = 0;
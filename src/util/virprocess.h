@@ -96,4 +96,10 @@ int virProcessSetScheduler(pid_t pid,
                            virProcessSchedPolicy policy,
                            int priority);
 
+int virProcessGetStatInfo(unsigned long long *cpuTime,
+                          int *lastCpu,
+                          long *vm_rss,
+                          pid_t pid,
+                          pid_t tid);
+
 #endif /* __VIR_PROCESS_H__ */
@@ -96,9 +96,35 @@ virRotatingFileReaderEntryFree(virRotatingFileReaderEntryPtr entry)
 }
 
 
+/* Avoid issues with older kernel's <linux/fs.h> namespace pollution. */
+#if HAVE_FALLOCATE - 0 && defined(FALLOC_FL_KEEP_SIZE)
+static void
+virRotatingFileWriterEntryPreallocate(virRotatingFileWriterEntryPtr entry,
+                                      off_t maxlen)
+{
+    /* Reserve the extent the file will grow into, so appends don't
+     * pay for incremental block allocation. FALLOC_FL_KEEP_SIZE
+     * leaves st_size untouched, which the O_APPEND writes rely on.
+     * This is only an optimization, so failures are ignored */
+    if (entry->len >= maxlen)
+        return;
+
+    ignore_value(fallocate(entry->fd, FALLOC_FL_KEEP_SIZE,
+                           entry->len, maxlen - entry->len));
+}
+#else /* !HAVE_FALLOCATE || !defined(FALLOC_FL_KEEP_SIZE) */
+static void
+virRotatingFileWriterEntryPreallocate(virRotatingFileWriterEntryPtr entry ATTRIBUTE_UNUSED,
+                                      off_t maxlen ATTRIBUTE_UNUSED)
+{
+}
+#endif /* !HAVE_FALLOCATE || !defined(FALLOC_FL_KEEP_SIZE) */
+
+
 static virRotatingFileWriterEntryPtr
 virRotatingFileWriterEntryNew(const char *path,
-                              mode_t mode)
+                              mode_t mode,
+                              off_t maxlen)
 {
     virRotatingFileWriterEntryPtr entry;
     struct stat sb;
@@ -132,6 +158,8 @@ virRotatingFileWriterEntryNew(const char *path,
     entry->len = sb.st_size;
     entry->inode = sb.st_ino;
 
+    virRotatingFileWriterEntryPreallocate(entry, maxlen);
+
     return entry;
 
  error:
@@ -262,7 +290,7 @@ virRotatingFileWriterNew(const char *path,
         goto error;
 
     if (!(file->entry = virRotatingFileWriterEntryNew(file->basepath,
-                                                      mode)))
+                                                      mode, maxlen)))
         goto error;
 
     return file;
@@ -491,7 +519,8 @@ virRotatingFileWriterAppend(virRotatingFileWriterPtr file,
                 return -1;
 
             if (!(file->entry = virRotatingFileWriterEntryNew(file->basepath,
-                                                              file->mode)))
+                                                              file->mode,
+                                                              file->maxlen)))
                 return -1;
 
             virRotatingFileWriterEntryFree(tmp);
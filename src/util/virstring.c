@@ -31,7 +31,9 @@
 #include "viralloc.h"
 #include "virbuffer.h"
 #include "virerror.h"
+#include "virhash.h"
 #include "virlog.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
@@ -1180,3 +1182,107 @@ virStringEncodeBase64(const uint8_t *buf, size_t buflen)
 
     return ret;
 }
+
+
+typedef struct _virStringInternEntry virStringInternEntry;
+typedef virStringInternEntry *virStringInternEntryPtr;
+struct _virStringInternEntry {
+    char *str;   /* the canonical copy handed out to all callers */
+    size_t refs;
+};
+
+static virMutex virStringInternLock = VIR_MUTEX_INITIALIZER;
+static virHashTablePtr virStringInternTable;
+
+static void
+virStringInternEntryFree(void *payload,
+                         const void *name ATTRIBUTE_UNUSED)
+{
+    virStringInternEntryPtr entry = payload;
+
+    VIR_FREE(entry->str);
+    VIR_FREE(entry);
+}
+
+/**
+ * virStringIntern:
+ * @str: string to intern
+ *
+ * Returns a reference counted copy of @str shared with every other
+ * caller interning an equal string, so that values which repeat many
+ * times across objects (device aliases, model names, ...) are stored
+ * only once.  The result must be released with virStringInternFree.
+ *
+ * Returns the interned copy, or NULL if @str is NULL or on failure.
+ */
+char *
+virStringIntern(const char *str)
+{
+    virStringInternEntryPtr entry;
+    char *ret = NULL;
+
+    if (!str)
+        return NULL;
+
+    virMutexLock(&virStringInternLock);
+
+    if (!virStringInternTable &&
+        !(virStringInternTable = virHashCreate(256, virStringInternEntryFree)))
+        goto cleanup;
+
+    if ((entry = virHashLookup(virStringInternTable, str))) {
+        entry->refs++;
+        ret = entry->str;
+        goto cleanup;
+    }
+
+    if (VIR_ALLOC(entry) < 0)
+        goto cleanup;
+
+    if (VIR_STRDUP(entry->str, str) < 0 ||
+        virHashAddEntry(virStringInternTable, str, entry) < 0) {
+        virStringInternEntryFree(entry, NULL);
+        goto cleanup;
+    }
+
+    entry->refs = 1;
+    ret = entry->str;
+
+ cleanup:
+    virMutexUnlock(&virStringInternLock);
+    return ret;
+}
+
+/**
+ * virStringInternFree:
+ * @str: string to release
+ *
+ * Releases one reference to an interned string, dropping it from the
+ * shared table once the last reference is gone.  Plain malloc'ed
+ * strings are simply freed, so storage which mixes interned and
+ * privately allocated values (e.g. device aliases assigned outside the
+ * XML parser) can be released through a single call.
+ */
+void
+virStringInternFree(char *str)
+{
+    virStringInternEntryPtr entry;
+
+    if (!str)
+        return;
+
+    virMutexLock(&virStringInternLock);
+
+    if (virStringInternTable &&
+        (entry = virHashLookup(virStringInternTable, str)) &&
+        entry->str == str) {
+        if (--entry->refs == 0)
+            ignore_value(virHashRemoveEntry(virStringInternTable, str));
+        virMutexUnlock(&virStringInternLock);
+        return;
+    }
+
+    virMutexUnlock(&virStringInternLock);
+
+    VIR_FREE(str);
+}
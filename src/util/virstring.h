@@ -288,4 +288,7 @@ bool virStringBufferIsPrintable(const uint8_t *buf, size_t buflen);
 
 char *virStringEncodeBase64(const uint8_t *buf, size_t buflen);
 
+char *virStringIntern(const char *str);
+void virStringInternFree(char *str);
+
 #endif /* __VIR_STRING_H__ */
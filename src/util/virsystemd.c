@@ -183,6 +183,72 @@ virSystemdMakeMachineName(const char *drivername,
 }
 
 
+static int virSystemdHasMachinedCachedValue = -1;
+static int virSystemdHasLogindCachedValue = -1;
+
+/* Reset the cache from tests for testing the underlying dbus calls
+ * as well */
+void virSystemdHasMachinedResetCachedValue(void)
+{
+    virSystemdHasMachinedCachedValue = -1;
+}
+
+void virSystemdHasLogindResetCachedValue(void)
+{
+    virSystemdHasLogindCachedValue = -1;
+}
+
+
+/* -2 = machine1 is not supported on this machine
+ * -1 = error
+ *  0 = machine1 is available
+ */
+int
+virSystemdHasMachined(void)
+{
+    int ret;
+    int val;
+
+    val = virAtomicIntGet(&virSystemdHasMachinedCachedValue);
+    if (val != -1)
+        return val;
+
+    if ((ret = virDBusIsServiceEnabled("org.freedesktop.machine1")) < 0) {
+        if (ret == -2)
+            virAtomicIntSet(&virSystemdHasMachinedCachedValue, -2);
+        return ret;
+    }
+
+    if ((ret = virDBusIsServiceRegistered("org.freedesktop.systemd1")) == -1)
+        return ret;
+    virAtomicIntSet(&virSystemdHasMachinedCachedValue, ret);
+    return ret;
+}
+
+int
+virSystemdHasLogind(void)
+{
+    int ret;
+    int val;
+
+    val = virAtomicIntGet(&virSystemdHasLogindCachedValue);
+    if (val != -1)
+        return val;
+
+    if ((ret = virDBusIsServiceEnabled("org.freedesktop.login1")) < 0) {
+        if (ret == -2)
+            virAtomicIntSet(&virSystemdHasLogindCachedValue, -2);
+        return ret;
+    }
+
+    if ((ret = virDBusIsServiceRegistered("org.freedesktop.login1")) == -1)
+        return ret;
+
+    virAtomicIntSet(&virSystemdHasLogindCachedValue, ret);
+    return ret;
+}
+
+
 char *
 virSystemdGetMachineNameByPID(pid_t pid)
 {
@@ -190,10 +256,7 @@ virSystemdGetMachineNameByPID(pid_t pid)
     DBusMessage *reply = NULL;
     char *name = NULL, *object = NULL;
 
-    if (virDBusIsServiceEnabled("org.freedesktop.machine1") < 0)
-        goto cleanup;
-
-    if (virDBusIsServiceRegistered("org.freedesktop.systemd1") < 0)
+    if (virSystemdHasMachined() < 0)
         goto cleanup;
 
     if (!(conn = virDBusGetSystemBus()))
@@ -268,11 +331,7 @@ int virSystemdCreateMachine(const char *name,
     char *slicename = NULL;
     static int hasCreateWithNetwork = 1;
 
-    ret = virDBusIsServiceEnabled("org.freedesktop.machine1");
-    if (ret < 0)
-        return ret;
-
-    if ((ret = virDBusIsServiceRegistered("org.freedesktop.systemd1")) < 0)
+    if ((ret = virSystemdHasMachined()) < 0)
         return ret;
 
     if (!(conn = virDBusGetSystemBus()))
@@ -384,15 +443,28 @@ int virSystemdCreateMachine(const char *name,
                  * another memory barrier */
                 goto fallback;
             }
+            if (virDBusErrorIsServiceUnavailable(&error)) {
+                /* e.g. machined is being restarted; report the service
+                 * as unavailable so the caller can place the machine
+                 * cgroup directly rather than stalling the start */
+                VIR_WARN("machined is unreachable (%s), falling back to "
+                         "manual cgroup placement", NULLSTR(error.message));
+                virResetError(&error);
+                ret = -2;
+                goto cleanup;
+            }
             virReportErrorObject(&error);
             virResetError(&error);
             goto cleanup;
         }
     } else {
+        virError error;
     fallback:
+        memset(&error, 0, sizeof(error));
+
         if (virDBusCallMethod(conn,
                               NULL,
-                              NULL,
+                              &error,
                               "org.freedesktop.machine1",
                               "/org/freedesktop/machine1",
                               "org.freedesktop.machine1.Manager",
@@ -413,6 +485,19 @@ int virSystemdCreateMachine(const char *name,
                               "After", "as", 1, "libvirtd.service",
                               "Before", "as", 1, "virt-guest-shutdown.target") < 0)
             goto cleanup;
+
+        if (error.level == VIR_ERR_ERROR) {
+            if (virDBusErrorIsServiceUnavailable(&error)) {
+                VIR_WARN("machined is unreachable (%s), falling back to "
+                         "manual cgroup placement", NULLSTR(error.message));
+                virResetError(&error);
+                ret = -2;
+                goto cleanup;
+            }
+            virReportErrorObject(&error);
+            virResetError(&error);
+            goto cleanup;
+        }
     }
 
     ret = 0;
@@ -434,11 +519,7 @@ int virSystemdTerminateMachine(const char *name)
 
     memset(&error, 0, sizeof(error));
 
-    ret = virDBusIsServiceEnabled("org.freedesktop.machine1");
-    if (ret < 0)
-        goto cleanup;
-
-    if ((ret = virDBusIsServiceRegistered("org.freedesktop.systemd1")) < 0)
+    if ((ret = virSystemdHasMachined()) < 0)
         goto cleanup;
 
     ret = -1;
@@ -541,11 +622,7 @@ virSystemdPMSupportTarget(const char *methodName, bool *result)
     DBusMessage *message = NULL;
     char *response;
 
-    ret = virDBusIsServiceEnabled("org.freedesktop.login1");
-    if (ret < 0)
-        return ret;
-
-    if ((ret = virDBusIsServiceRegistered("org.freedesktop.login1")) < 0)
+    if ((ret = virSystemdHasLogind()) < 0)
         return ret;
 
     if (!(conn = virDBusGetSystemBus()))
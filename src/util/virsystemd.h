@@ -46,6 +46,14 @@ int virSystemdCreateMachine(const char *name,
 
 int virSystemdTerminateMachine(const char *name);
 
+int virSystemdHasMachined(void);
+
+int virSystemdHasLogind(void);
+
+void virSystemdHasMachinedResetCachedValue(void);
+
+void virSystemdHasLogindResetCachedValue(void);
+
 void virSystemdNotifyStartup(void);
 
 int virSystemdCanSuspend(bool *result);
@@ -30,9 +30,12 @@
 #include "viralloc.h"
 #include "virthread.h"
 #include "virerror.h"
+#include "virprobe.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
+VIR_LOG_INIT("util.threadpool");
+
 typedef struct _virThreadPoolJob virThreadPoolJob;
 typedef virThreadPoolJob *virThreadPoolJobPtr;
 
@@ -75,6 +78,7 @@ struct _virThreadPool {
 
     size_t maxPrioWorkers;
     size_t nPrioWorkers;
+    size_t freePrioWorkers;
     virThreadPtr prioWorkers;
     virCond prioCond;
 };
@@ -119,14 +123,20 @@ static void virThreadPoolWorker(void *opaque)
         while (!pool->quit &&
                ((!priority && !pool->jobList.head) ||
                 (priority && !pool->jobList.firstPrio))) {
-            if (!priority)
+            if (priority)
+                pool->freePrioWorkers++;
+            else
                 pool->freeWorkers++;
             if (virCondWait(cond, &pool->mutex) < 0) {
-                if (!priority)
+                if (priority)
+                    pool->freePrioWorkers--;
+                else
                     pool->freeWorkers--;
                 goto out;
             }
-            if (!priority)
+            if (priority)
+                pool->freePrioWorkers--;
+            else
                 pool->freeWorkers--;
 
             if (virThreadPoolWorkerQuitHelper(*curWorkers, *maxLimit))
@@ -163,6 +173,10 @@ static void virThreadPoolWorker(void *opaque)
 
         pool->jobQueueDepth--;
 
+        PROBE(THREADPOOL_JOB_DEQUEUE,
+              "pool=%p data=%p queue_depth=%u",
+              pool, job->data, (unsigned int)pool->jobQueueDepth);
+
         virMutexUnlock(&pool->mutex);
         (pool->jobFunc)(job->data, pool->jobOpaque);
         VIR_FREE(job);
@@ -373,27 +387,24 @@ size_t virThreadPoolGetJobQueueDepth(virThreadPoolPtr pool)
     return ret;
 }
 
-/*
- * @priority - job priority
- * Return: 0 on success, -1 otherwise
- */
-int virThreadPoolSendJob(virThreadPoolPtr pool,
-                         unsigned int priority,
-                         void *jobData)
+/* Queue a single job. The pool mutex must be held by the caller. */
+static int
+virThreadPoolSendJobLocked(virThreadPoolPtr pool,
+                           unsigned int priority,
+                           void *jobData)
 {
     virThreadPoolJobPtr job;
 
-    virMutexLock(&pool->mutex);
-    if (pool->quit)
-        goto error;
-
-    if (pool->freeWorkers - pool->jobQueueDepth <= 0 &&
+    /* Expand the pool whenever the queued jobs (including this one)
+     * outnumber the free workers. Note the values are unsigned, so
+     * the comparison must not be written as a subtraction */
+    if (pool->freeWorkers <= pool->jobQueueDepth &&
         pool->nWorkers < pool->maxWorkers &&
         virThreadPoolExpand(pool, 1, false) < 0)
-        goto error;
+        return -1;
 
     if (VIR_ALLOC(job) < 0)
-        goto error;
+        return -1;
 
     job->data = jobData;
     job->priority = priority;
@@ -411,8 +422,36 @@ int virThreadPoolSendJob(virThreadPoolPtr pool,
 
     pool->jobQueueDepth++;
 
-    virCondSignal(&pool->cond);
-    if (priority)
+    PROBE(THREADPOOL_JOB_QUEUE,
+          "pool=%p data=%p priority=%u queue_depth=%u",
+          pool, jobData, priority, (unsigned int)pool->jobQueueDepth);
+
+    return 0;
+}
+
+/*
+ * @priority - job priority
+ * Return: 0 on success, -1 otherwise
+ */
+int virThreadPoolSendJob(virThreadPoolPtr pool,
+                         unsigned int priority,
+                         void *jobData)
+{
+    virMutexLock(&pool->mutex);
+    if (pool->quit)
+        goto error;
+
+    if (virThreadPoolSendJobLocked(pool, priority, jobData) < 0)
+        goto error;
+
+    /* Wake up a single worker; waking both a general and a priority
+     * worker for one job just bounces one of them off an empty queue.
+     * Workers re-check the queue under the pool mutex before going to
+     * sleep, so skipping the signal when nobody is waiting cannot lose
+     * a wakeup. */
+    if (pool->freeWorkers > 0)
+        virCondSignal(&pool->cond);
+    else if (priority && pool->freePrioWorkers > 0)
         virCondSignal(&pool->prioCond);
 
     virMutexUnlock(&pool->mutex);
@@ -423,6 +462,61 @@ int virThreadPoolSendJob(virThreadPoolPtr pool,
     return -1;
 }
 
+/**
+ * virThreadPoolSendJobBatch:
+ * @pool: pool to queue the jobs on
+ * @priority: priority flag applied to all jobs in the batch
+ * @jobDataList: array of opaque job data pointers
+ * @njobs: number of entries in @jobDataList
+ *
+ * Queue several jobs while taking the pool mutex and waking workers
+ * up only once, which is noticeably cheaper than calling
+ * virThreadPoolSendJob in a loop when fanning work out from a single
+ * thread.
+ *
+ * Returns the number of jobs queued; this is lower than @njobs only
+ * when the pool is being torn down or a job cannot be allocated, in
+ * which case no entry after the first failed one is queued.
+ */
+size_t virThreadPoolSendJobBatch(virThreadPoolPtr pool,
+                                 unsigned int priority,
+                                 void **jobDataList,
+                                 size_t njobs)
+{
+    size_t nqueued = 0;
+    size_t nwake;
+    size_t i;
+
+    virMutexLock(&pool->mutex);
+    if (pool->quit)
+        goto cleanup;
+
+    while (nqueued < njobs) {
+        if (virThreadPoolSendJobLocked(pool, priority,
+                                       jobDataList[nqueued]) < 0)
+            break;
+        nqueued++;
+    }
+
+    /* Every waiting worker can pick up one job; any surplus is drained
+     * by busy workers as they finish their current job. */
+    nwake = pool->freeWorkers;
+    if (nwake > nqueued)
+        nwake = nqueued;
+    if (nwake > 0 && nwake == pool->freeWorkers) {
+        virCondBroadcast(&pool->cond);
+    } else {
+        for (i = 0; i < nwake; i++)
+            virCondSignal(&pool->cond);
+    }
+    if (priority && nqueued > nwake && pool->freePrioWorkers > 0)
+        virCondBroadcast(&pool->prioCond);
+
+ cleanup:
+    virMutexUnlock(&pool->mutex);
+    return nqueued;
+}
+
 int
 virThreadPoolSetParameters(virThreadPoolPtr pool,
                            long long int minWorkers,
@@ -452,6 +546,21 @@ virThreadPoolSetParameters(virThreadPoolPtr pool,
 
     if (maxWorkers >= 0) {
         pool->maxWorkers = maxWorkers;
+
+        /* Expansion normally happens when a job is queued, so jobs
+         * already backed up would not benefit from a raised limit
+         * until new work arrives; spawn enough of the newly allowed
+         * workers to drain the existing backlog right away */
+        if (pool->jobQueueDepth > pool->freeWorkers &&
+            pool->nWorkers < pool->maxWorkers) {
+            size_t spawn = pool->jobQueueDepth - pool->freeWorkers;
+
+            if (spawn > pool->maxWorkers - pool->nWorkers)
+                spawn = pool->maxWorkers - pool->nWorkers;
+            if (virThreadPoolExpand(pool, spawn, false) < 0)
+                goto error;
+        }
+
         virCondBroadcast(&pool->cond);
     }
 
@@ -52,6 +52,11 @@ size_t virThreadPoolGetJobQueueDepth(virThreadPoolPtr pool);
 
 void virThreadPoolFree(virThreadPoolPtr pool);
 
+size_t virThreadPoolSendJobBatch(virThreadPoolPtr pool,
+                                 unsigned int priority,
+                                 void **jobDataList,
+                                 size_t njobs);
+
 int virThreadPoolSendJob(virThreadPoolPtr pool,
                          unsigned int priority,
                          void *jobdata) ATTRIBUTE_NONNULL(1)
@@ -418,6 +418,40 @@ virTypedParamsReplaceString(virTypedParameterPtr *params,
 }
 
 
+/**
+ * virTypedParamsReserve:
+ * @params: pointer to the array of typed parameters
+ * @nparams: number of parameters in the @params array
+ * @maxparams: maximum number of parameters that can be stored in @params
+ *      array without allocating more memory
+ * @add: number of parameters the array should be able to take on top of
+ *      @nparams without further reallocation
+ *
+ * Grows @params in one step before a batch of virTypedParamsAdd* calls.
+ * Callers building large parameter arrays (e.g. bulk statistics) can use
+ * this to replace the incremental reallocations the individual add
+ * functions would otherwise perform.  Overestimating @add is fine; the
+ * array is sized by @maxparams, not trimmed to @nparams.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virTypedParamsReserve(virTypedParameterPtr *params,
+                      int *nparams,
+                      int *maxparams,
+                      int add)
+{
+    size_t max = *maxparams;
+    size_t n = *nparams;
+
+    if (VIR_RESIZE_N(*params, max, n, add) < 0)
+        return -1;
+
+    *maxparams = max;
+    return 0;
+}
+
+
 int
 virTypedParamsCopy(virTypedParameterPtr *dst,
                    virTypedParameterPtr src,
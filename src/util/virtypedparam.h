@@ -93,6 +93,12 @@ int virTypedParameterAssignFromStr(virTypedParameterPtr param,
                                    const char *val)
     ATTRIBUTE_RETURN_CHECK;
 
+int virTypedParamsReserve(virTypedParameterPtr *params,
+                          int *nparams,
+                          int *maxparams,
+                          int add)
+    ATTRIBUTE_RETURN_CHECK;
+
 int virTypedParamsReplaceString(virTypedParameterPtr *params,
                                 int *nparams,
                                 const char *name,
@@ -666,6 +666,13 @@ char *virIndexToDiskName(int idx, const char *prefix)
  *         we got from getaddrinfo().  Return the value from gethostname()
  *         and hope for the best.
  */
+/* Canonicalizing the host name may go through NSS and cost a DNS
+ * round trip, and some callers (the migration cookie is baked for
+ * every phase of every migration) ask for it over and over, so keep
+ * the first successful answer around */
+static char *virGetHostnameCache;
+static virMutex virGetHostnameCacheLock = VIR_MUTEX_INITIALIZER;
+
 static char *
 virGetHostnameImpl(bool quiet)
 {
@@ -673,6 +680,16 @@ virGetHostnameImpl(bool quiet)
     char hostname[HOST_NAME_MAX+1], *result = NULL;
     struct addrinfo hints, *info;
 
+    virMutexLock(&virGetHostnameCacheLock);
+    if (virGetHostnameCache) {
+        ignore_value(VIR_STRDUP_QUIET(result, virGetHostnameCache));
+        virMutexUnlock(&virGetHostnameCacheLock);
+        if (!result)
+            virReportOOMError();
+        return result;
+    }
+    virMutexUnlock(&virGetHostnameCacheLock);
+
     r = gethostname(hostname, sizeof(hostname));
     if (r == -1) {
         if (!quiet)
@@ -726,8 +743,15 @@ virGetHostnameImpl(bool quiet)
     freeaddrinfo(info);
 
  cleanup:
-    if (!result)
+    if (!result) {
         virReportOOMError();
+        return NULL;
+    }
+
+    virMutexLock(&virGetHostnameCacheLock);
+    if (!virGetHostnameCache)
+        ignore_value(VIR_STRDUP_QUIET(virGetHostnameCache, result));
+    virMutexUnlock(&virGetHostnameCacheLock);
     return result;
 }
 
@@ -1585,10 +1609,16 @@ virSetUIDGIDWithCaps(uid_t uid, gid_t gid, gid_t *groups, int ngroups,
 #if defined(UDEVADM) || defined(UDEVSETTLE)
 void virFileWaitForDevices(void)
 {
+    /* Bound the wait: settle only returns once the whole udev event
+     * queue is empty (120 seconds by default), and e.g. a busy FC
+     * fabric can keep the queue non-empty for far longer than our
+     * devices take to appear. All callers cope with devices showing
+     * up late, by re-scanning or polling for the nodes. */
 # ifdef UDEVADM
-    const char *const settleprog[] = { UDEVADM, "settle", NULL };
+    const char *const settleprog[] = { UDEVADM, "settle",
+                                       "--timeout=30", NULL };
 # else
-    const char *const settleprog[] = { UDEVSETTLE, NULL };
+    const char *const settleprog[] = { UDEVSETTLE, "--timeout=30", NULL };
 # endif
     int exitstatus;
 
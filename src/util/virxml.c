@@ -36,7 +36,9 @@
 #include "virutil.h"
 #include "viralloc.h"
 #include "virfile.h"
+#include "virhash.h"
 #include "virstring.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_XML
 
@@ -506,6 +508,61 @@ virXMLPropString(xmlNodePtr node,
     return (char *)xmlGetProp(node, BAD_CAST name);
 }
 
+/**
+ * virXMLNodeGetSubelement:
+ * @node: node to get subelement of
+ * @name: name of the subelement
+ *
+ * Find the first direct child element of @node named @name without
+ * going through the XPath machinery. This is cheap enough to use in
+ * parser hot paths where compiling an XPath expression per query
+ * shows up in profiles.
+ *
+ * Returns the first matching child element, or NULL if there is none.
+ */
+xmlNodePtr
+virXMLNodeGetSubelement(xmlNodePtr node,
+                        const char *name)
+{
+    xmlNodePtr cur;
+
+    for (cur = node->children; cur; cur = cur->next) {
+        if (cur->type == XML_ELEMENT_NODE &&
+            xmlStrEqual(cur->name, BAD_CAST name))
+            return cur;
+    }
+
+    return NULL;
+}
+
+/**
+ * virXMLChildPropString:
+ * @node: node to inspect
+ * @child: name of the direct child element holding the attribute
+ * @name: name of the property (attribute) to get
+ *
+ * Convenience function returning a copy of attribute @name of the first
+ * child element of @node named @child; equivalent to evaluating
+ * "string(./child/@name)" relative to @node, but without compiling an
+ * XPath expression.
+ *
+ * Returns the property (attribute) value as string, or NULL if either
+ * the child element or the attribute does not exist. The caller is
+ * responsible for freeing the returned buffer.
+ */
+char *
+virXMLChildPropString(xmlNodePtr node,
+                      const char *child,
+                      const char *name)
+{
+    xmlNodePtr subelem = virXMLNodeGetSubelement(node, child);
+
+    if (!subelem)
+        return NULL;
+
+    return virXMLPropString(subelem, name);
+}
+
 /**
  * virXPathBoolean:
  * @xpath: the XPath string to evaluate
@@ -765,14 +822,39 @@ virXMLParseHelper(int domcode,
     pctxt->_private = &private;
     pctxt->sax->error = catchXMLError;
 
+    /* XML_PARSE_COMPACT stores short text node content inline in the
+     * node struct instead of a separately malloc()-ed buffer, which
+     * noticeably cuts the per-document allocation count for configs
+     * full of short element values. The trade-off is that the content
+     * of existing text nodes must not be modified in place; our
+     * consumers only read parsed documents or unlink and free whole
+     * nodes, which libxml2 handles for compact nodes.
+     */
     if (filename) {
-        xml = xmlCtxtReadFile(pctxt, filename, NULL,
-                              XML_PARSE_NONET |
-                              XML_PARSE_NOWARNING);
+        char *mapped = NULL;
+        size_t maplen = 0;
+
+        /* Map the file rather than letting libxml2 read it in small
+         * chunks, so the kernel reads it ahead while early parts are
+         * already being parsed; mainly helps the larger documents
+         * (capabilities caches, cpu_map.xml) on slow storage */
+        if (virFileMapRead(filename, &mapped, &maplen) == 0) {
+            xml = xmlCtxtReadMemory(pctxt, mapped, maplen, filename, NULL,
+                                    XML_PARSE_NONET |
+                                    XML_PARSE_NOWARNING |
+                                    XML_PARSE_COMPACT);
+            virFileMapReadFree(mapped, maplen);
+        } else {
+            xml = xmlCtxtReadFile(pctxt, filename, NULL,
+                                  XML_PARSE_NONET |
+                                  XML_PARSE_NOWARNING |
+                                  XML_PARSE_COMPACT);
+        }
     } else {
         xml = xmlCtxtReadDoc(pctxt, BAD_CAST xmlStr, url, NULL,
                              XML_PARSE_NONET |
-                             XML_PARSE_NOWARNING);
+                             XML_PARSE_NOWARNING |
+                             XML_PARSE_COMPACT);
     }
     if (!xml)
         goto error;
@@ -1183,38 +1265,78 @@ static void ignoreRNGError(void *ctx ATTRIBUTE_UNUSED,
 {}
 
 
-virXMLValidatorPtr
-virXMLValidatorInit(const char *schemafile)
+/* Parsing a schema is expensive (domain.rng pulls in dozens of
+ * included files), while the parsed schema is immutable and can be
+ * shared by any number of validation contexts, so keep each parsed
+ * schema around for the lifetime of the process. The entries are
+ * owned by the cache and never freed */
+static virHashTablePtr virXMLSchemaCache;
+static virMutex virXMLSchemaCacheLock = VIR_MUTEX_INITIALIZER;
+
+static xmlRelaxNGPtr
+virXMLSchemaLoad(const char *schemafile)
 {
-    virXMLValidatorPtr validator = NULL;
+    xmlRelaxNGPtr rng = NULL;
+    xmlRelaxNGParserCtxtPtr rngParser = NULL;
+    virBuffer buf = VIR_BUFFER_INITIALIZER;
 
-    if (VIR_ALLOC(validator) < 0)
-        return NULL;
+    virMutexLock(&virXMLSchemaCacheLock);
 
-    if (VIR_STRDUP(validator->schemafile, schemafile) < 0)
-        goto error;
+    if (!virXMLSchemaCache &&
+        !(virXMLSchemaCache = virHashCreate(4, NULL)))
+        goto cleanup;
+
+    if ((rng = virHashLookup(virXMLSchemaCache, schemafile)))
+        goto cleanup;
 
-    if (!(validator->rngParser =
-              xmlRelaxNGNewParserCtxt(validator->schemafile))) {
+    if (!(rngParser = xmlRelaxNGNewParserCtxt(schemafile))) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("Unable to create RNG parser for %s"),
-                       validator->schemafile);
-        goto error;
+                       schemafile);
+        goto cleanup;
     }
 
-    xmlRelaxNGSetParserErrors(validator->rngParser,
+    xmlRelaxNGSetParserErrors(rngParser,
                               catchRNGError,
                               ignoreRNGError,
-                              &validator->buf);
+                              &buf);
 
-    if (!(validator->rng = xmlRelaxNGParse(validator->rngParser))) {
+    if (!(rng = xmlRelaxNGParse(rngParser))) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("Unable to parse RNG %s: %s"),
-                       validator->schemafile,
-                       virBufferCurrentContent(&validator->buf));
-        goto error;
+                       schemafile,
+                       virBufferCurrentContent(&buf));
+        goto cleanup;
     }
 
+    if (virHashAddEntry(virXMLSchemaCache, schemafile, rng) < 0) {
+        /* failing to cache the schema is no reason to fail the
+         * validation; the next caller simply parses it again */
+        virResetLastError();
+    }
+
+ cleanup:
+    xmlRelaxNGFreeParserCtxt(rngParser);
+    virBufferFreeAndReset(&buf);
+    virMutexUnlock(&virXMLSchemaCacheLock);
+    return rng;
+}
+
+
+virXMLValidatorPtr
+virXMLValidatorInit(const char *schemafile)
+{
+    virXMLValidatorPtr validator = NULL;
+
+    if (VIR_ALLOC(validator) < 0)
+        return NULL;
+
+    if (VIR_STRDUP(validator->schemafile, schemafile) < 0)
+        goto error;
+
+    if (!(validator->rng = virXMLSchemaLoad(validator->schemafile)))
+        goto error;
+
     if (!(validator->rngValid = xmlRelaxNGNewValidCtxt(validator->rng))) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("Unable to create RNG validation context %s"),
@@ -1283,8 +1405,7 @@ virXMLValidatorFree(virXMLValidatorPtr validator)
 
     VIR_FREE(validator->schemafile);
     virBufferFreeAndReset(&validator->buf);
-    xmlRelaxNGFreeParserCtxt(validator->rngParser);
     xmlRelaxNGFreeValidCtxt(validator->rngValid);
-    xmlRelaxNGFree(validator->rng);
+    /* validator->rng belongs to the schema cache */
     VIR_FREE(validator);
 }
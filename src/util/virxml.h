@@ -73,6 +73,11 @@ int              virXPathNodeSet(const char *xpath,
                                  xmlNodePtr **list);
 char *          virXMLPropString(xmlNodePtr node,
                                  const char *name);
+xmlNodePtr virXMLNodeGetSubelement(xmlNodePtr node,
+                                   const char *name);
+char *    virXMLChildPropString(xmlNodePtr node,
+                                const char *child,
+                                const char *name);
 long     virXMLChildElementCount(xmlNodePtr node);
 
 /* Internal function; prefer the macros below.  */
@@ -186,8 +191,7 @@ int virXMLCheckIllegalChars(const char *nodeName,
                             const char *illegal);
 
 struct _virXMLValidator {
-    xmlRelaxNGParserCtxtPtr rngParser;
-    xmlRelaxNGPtr rng;
+    xmlRelaxNGPtr rng;          /* borrowed from the schema cache */
     xmlRelaxNGValidCtxtPtr rngValid;
     virBuffer buf;
     char *schemafile;
@@ -309,48 +309,100 @@ static int openSessionForMachine(vboxDriverPtr data, const unsigned char *dom_uu
  *
  */
 
-static bool vboxGetMaxPortSlotValues(IVirtualBox *vbox,
-                                     PRUint32 *maxPortPerInst,
-                                     PRUint32 *maxSlotPerPort)
+/**
+ * Fill the driver's mirror of the host-wide ISystemProperties limits.
+ * Every property access is a COM round trip, but the limits never
+ * change for the lifetime of the VirtualBox installation, so they
+ * are fetched once and served from the driver struct afterwards.
+ *
+ * @returns     0 on success, -1 on failure.
+ * @param       data            Input vbox driver data
+ */
+static int vboxSystemPropertiesCacheFill(vboxDriverPtr data)
 {
     ISystemProperties *sysProps = NULL;
+    size_t i;
 
-    if (!vbox)
-        return false;
+    if (data->sysPropsCached)
+        return 0;
 
-    gVBoxAPI.UIVirtualBox.GetSystemProperties(vbox, &sysProps);
+    if (!data->vboxObj)
+        return -1;
 
-    if (!sysProps)
-        return false;
+    virObjectLock(data);
+
+    if (data->sysPropsCached) {
+        virObjectUnlock(data);
+        return 0;
+    }
+
+    gVBoxAPI.UIVirtualBox.GetSystemProperties(data->vboxObj, &sysProps);
+
+    if (!sysProps) {
+        virObjectUnlock(data);
+        return -1;
+    }
+
+    gVBoxAPI.UISystemProperties.GetMaxGuestRAM(sysProps,
+                                               &data->sysPropMaxGuestRAM);
+    gVBoxAPI.UISystemProperties.GetMaxGuestCPUCount(sysProps,
+                                                    &data->sysPropMaxGuestCPUCount);
+    gVBoxAPI.UISystemProperties.GetMaxBootPosition(sysProps,
+                                                   &data->sysPropMaxBootPosition);
+    gVBoxAPI.UISystemProperties.GetSerialPortCount(sysProps,
+                                                   &data->sysPropSerialPortCount);
+    gVBoxAPI.UISystemProperties.GetParallelPortCount(sysProps,
+                                                     &data->sysPropParallelPortCount);
+
+    for (i = 0; i < ARRAY_CARDINALITY(data->sysPropMaxNetworkAdapters); i++)
+        gVBoxAPI.UISystemProperties.GetMaxNetworkAdapters(sysProps, i,
+                                                          &data->sysPropMaxNetworkAdapters[i]);
 
     gVBoxAPI.UISystemProperties.GetMaxPortCountForStorageBus(sysProps,
                                                              StorageBus_IDE,
-                                                             &maxPortPerInst[StorageBus_IDE]);
+                                                             &data->sysPropMaxPortPerInst[StorageBus_IDE]);
     gVBoxAPI.UISystemProperties.GetMaxPortCountForStorageBus(sysProps,
                                                              StorageBus_SATA,
-                                                             &maxPortPerInst[StorageBus_SATA]);
+                                                             &data->sysPropMaxPortPerInst[StorageBus_SATA]);
     gVBoxAPI.UISystemProperties.GetMaxPortCountForStorageBus(sysProps,
                                                              StorageBus_SCSI,
-                                                             &maxPortPerInst[StorageBus_SCSI]);
+                                                             &data->sysPropMaxPortPerInst[StorageBus_SCSI]);
     gVBoxAPI.UISystemProperties.GetMaxPortCountForStorageBus(sysProps,
                                                              StorageBus_Floppy,
-                                                             &maxPortPerInst[StorageBus_Floppy]);
+                                                             &data->sysPropMaxPortPerInst[StorageBus_Floppy]);
 
     gVBoxAPI.UISystemProperties.GetMaxDevicesPerPortForStorageBus(sysProps,
                                                                   StorageBus_IDE,
-                                                                  &maxSlotPerPort[StorageBus_IDE]);
+                                                                  &data->sysPropMaxSlotPerPort[StorageBus_IDE]);
     gVBoxAPI.UISystemProperties.GetMaxDevicesPerPortForStorageBus(sysProps,
                                                                   StorageBus_SATA,
-                                                                  &maxSlotPerPort[StorageBus_SATA]);
+                                                                  &data->sysPropMaxSlotPerPort[StorageBus_SATA]);
     gVBoxAPI.UISystemProperties.GetMaxDevicesPerPortForStorageBus(sysProps,
                                                                   StorageBus_SCSI,
-                                                                  &maxSlotPerPort[StorageBus_SCSI]);
+                                                                  &data->sysPropMaxSlotPerPort[StorageBus_SCSI]);
     gVBoxAPI.UISystemProperties.GetMaxDevicesPerPortForStorageBus(sysProps,
                                                                   StorageBus_Floppy,
-                                                                  &maxSlotPerPort[StorageBus_Floppy]);
+                                                                  &data->sysPropMaxSlotPerPort[StorageBus_Floppy]);
 
     VBOX_RELEASE(sysProps);
 
+    data->sysPropsCached = true;
+    virObjectUnlock(data);
+    return 0;
+}
+
+static bool vboxGetMaxPortSlotValues(vboxDriverPtr data,
+                                     PRUint32 *maxPortPerInst,
+                                     PRUint32 *maxSlotPerPort)
+{
+    if (vboxSystemPropertiesCacheFill(data) < 0)
+        return false;
+
+    memcpy(maxPortPerInst, data->sysPropMaxPortPerInst,
+           sizeof(data->sysPropMaxPortPerInst));
+    memcpy(maxSlotPerPort, data->sysPropMaxSlotPerPort,
+           sizeof(data->sysPropMaxSlotPerPort));
+
     return true;
 }
 
@@ -642,18 +694,13 @@ vboxConnectGetMaxVcpus(virConnectPtr conn, const char *type ATTRIBUTE_UNUSED)
     /* VirtualBox Supports only hvm and thus the type passed to it
      * has no meaning, setting it to ATTRIBUTE_UNUSED
      */
-    ISystemProperties *systemProperties = NULL;
-
-    gVBoxAPI.UIVirtualBox.GetSystemProperties(data->vboxObj, &systemProperties);
-    if (!systemProperties)
-        goto cleanup;
-    gVBoxAPI.UISystemProperties.GetMaxGuestCPUCount(systemProperties, &maxCPUCount);
+    if (vboxSystemPropertiesCacheFill(data) < 0)
+        return ret;
+    maxCPUCount = data->sysPropMaxGuestCPUCount;
 
     if (maxCPUCount > 0)
         ret = maxCPUCount;
 
- cleanup:
-    VBOX_RELEASE(systemProperties);
     return ret;
 }
 
@@ -985,7 +1032,6 @@ static void
 vboxSetBootDeviceOrder(virDomainDefPtr def, vboxDriverPtr data,
                        IMachine *machine)
 {
-    ISystemProperties *systemProperties = NULL;
     PRUint32 maxBootPosition = 0;
     size_t i = 0;
 
@@ -1011,12 +1057,8 @@ vboxSetBootDeviceOrder(virDomainDefPtr def, vboxDriverPtr data,
     VIR_DEBUG("def->os.bootloader       %s", def->os.bootloader);
     VIR_DEBUG("def->os.bootloaderArgs   %s", def->os.bootloaderArgs);
 
-    gVBoxAPI.UIVirtualBox.GetSystemProperties(data->vboxObj, &systemProperties);
-    if (systemProperties) {
-        gVBoxAPI.UISystemProperties.GetMaxBootPosition(systemProperties,
-                                                       &maxBootPosition);
-        VBOX_RELEASE(systemProperties);
-    }
+    if (vboxSystemPropertiesCacheFill(data) == 0)
+        maxBootPosition = data->sysPropMaxBootPosition;
 
     /* Clear the defaults first */
     for (i = 0; i < maxBootPosition; i++)
@@ -1053,7 +1095,7 @@ vboxAttachDrivesNew(virDomainDefPtr def, vboxDriverPtr data, IMachine *machine)
         VIR_WARN("This function may not work in current vbox version");
 
     /* get the max port/slots/etc for the given storage bus */
-    error = !vboxGetMaxPortSlotValues(data->vboxObj, maxPortPerInst,
+    error = !vboxGetMaxPortSlotValues(data, maxPortPerInst,
                                       maxSlotPerPort);
 
     /* add a storage controller for the mediums to be attached */
@@ -1321,7 +1363,6 @@ vboxAttachSound(virDomainDefPtr def, IMachine *machine)
 static int
 vboxAttachNetwork(virDomainDefPtr def, vboxDriverPtr data, IMachine *machine)
 {
-    ISystemProperties *systemProperties = NULL;
     PRUint32 chipsetType = ChipsetType_Null;
     PRUint32 networkAdapterCount = 0;
     size_t i = 0;
@@ -1329,12 +1370,9 @@ vboxAttachNetwork(virDomainDefPtr def, vboxDriverPtr data, IMachine *machine)
     if (gVBoxAPI.chipsetType)
         gVBoxAPI.UIMachine.GetChipsetType(machine, &chipsetType);
 
-    gVBoxAPI.UIVirtualBox.GetSystemProperties(data->vboxObj, &systemProperties);
-    if (systemProperties) {
-        gVBoxAPI.UISystemProperties.GetMaxNetworkAdapters(systemProperties, chipsetType,
-                                                          &networkAdapterCount);
-        VBOX_RELEASE(systemProperties);
-    }
+    if (vboxSystemPropertiesCacheFill(data) == 0 &&
+        chipsetType < ARRAY_CARDINALITY(data->sysPropMaxNetworkAdapters))
+        networkAdapterCount = data->sysPropMaxNetworkAdapters[chipsetType];
 
     VIR_DEBUG("Number of Network Cards to be connected: %zu", def->nnets);
     VIR_DEBUG("Number of Network Cards available: %d", networkAdapterCount);
@@ -1467,16 +1505,11 @@ vboxAttachNetwork(virDomainDefPtr def, vboxDriverPtr data, IMachine *machine)
 static void
 vboxAttachSerial(virDomainDefPtr def, vboxDriverPtr data, IMachine *machine)
 {
-    ISystemProperties *systemProperties = NULL;
     PRUint32 serialPortCount = 0;
     size_t i = 0;
 
-    gVBoxAPI.UIVirtualBox.GetSystemProperties(data->vboxObj, &systemProperties);
-    if (systemProperties) {
-        gVBoxAPI.UISystemProperties.GetSerialPortCount(systemProperties,
-                                                       &serialPortCount);
-        VBOX_RELEASE(systemProperties);
-    }
+    if (vboxSystemPropertiesCacheFill(data) == 0)
+        serialPortCount = data->sysPropSerialPortCount;
 
     VIR_DEBUG("Number of Serial Ports to be connected: %zu", def->nserials);
     VIR_DEBUG("Number of Serial Ports available: %d", serialPortCount);
@@ -1543,16 +1576,11 @@ vboxAttachSerial(virDomainDefPtr def, vboxDriverPtr data, IMachine *machine)
 static void
 vboxAttachParallel(virDomainDefPtr def, vboxDriverPtr data, IMachine *machine)
 {
-    ISystemProperties *systemProperties = NULL;
     PRUint32 parallelPortCount = 0;
     size_t i = 0;
 
-    gVBoxAPI.UIVirtualBox.GetSystemProperties(data->vboxObj, &systemProperties);
-    if (systemProperties) {
-        gVBoxAPI.UISystemProperties.GetParallelPortCount(systemProperties,
-                                                         &parallelPortCount);
-        VBOX_RELEASE(systemProperties);
-    }
+    if (vboxSystemPropertiesCacheFill(data) == 0)
+        parallelPortCount = data->sysPropParallelPortCount;
 
     VIR_DEBUG("Number of Parallel Ports to be connected: %zu", def->nparallels);
     VIR_DEBUG("Number of Parallel Ports available: %d", parallelPortCount);
@@ -2888,14 +2916,9 @@ static int vboxDomainGetInfo(virDomainPtr dom, virDomainInfoPtr info)
             PRUint32 memorySize = 0;
             PRUint32 state;
             PRUint32 maxMemorySize = 4 * 1024;
-            ISystemProperties *systemProperties = NULL;
 
-            gVBoxAPI.UIVirtualBox.GetSystemProperties(data->vboxObj, &systemProperties);
-            if (systemProperties) {
-                gVBoxAPI.UISystemProperties.GetMaxGuestRAM(systemProperties, &maxMemorySize);
-                VBOX_RELEASE(systemProperties);
-                systemProperties = NULL;
-            }
+            if (vboxSystemPropertiesCacheFill(data) == 0)
+                maxMemorySize = data->sysPropMaxGuestRAM;
 
             gVBoxAPI.UIMachine.GetCPUCount(machine, &CPUCount);
             gVBoxAPI.UIMachine.GetMemorySize(machine, &memorySize);
@@ -3012,7 +3035,6 @@ static int vboxDomainSetVcpus(virDomainPtr dom, unsigned int nvcpus)
 static int vboxDomainGetVcpusFlags(virDomainPtr dom, unsigned int flags)
 {
     vboxDriverPtr data = dom->conn->privateData;
-    ISystemProperties *systemProperties = NULL;
     PRUint32 maxCPUCount = 0;
     int ret = -1;
 
@@ -3029,11 +3051,8 @@ static int vboxDomainGetVcpusFlags(virDomainPtr dom, unsigned int flags)
      * the systemproperties.
      */
 
-    gVBoxAPI.UIVirtualBox.GetSystemProperties(data->vboxObj, &systemProperties);
-    if (systemProperties) {
-        gVBoxAPI.UISystemProperties.GetMaxGuestCPUCount(systemProperties, &maxCPUCount);
-        VBOX_RELEASE(systemProperties);
-    }
+    if (vboxSystemPropertiesCacheFill(data) == 0)
+        maxCPUCount = data->sysPropMaxGuestCPUCount;
 
     if (maxCPUCount > 0)
         ret = maxCPUCount;
@@ -3200,7 +3219,7 @@ vboxDumpIDEHDDsNew(virDomainDefPtr def, vboxDriverPtr data, IMachine *machine)
     }
 
     if (!error)
-        error = !vboxGetMaxPortSlotValues(data->vboxObj, maxPortPerInst, maxSlotPerPort);
+        error = !vboxGetMaxPortSlotValues(data, maxPortPerInst, maxSlotPerPort);
 
     /* get the attachment details here */
     for (i = 0; i < mediumAttachments.count && diskCount < def->ndisks && !error; i++) {
@@ -3894,7 +3913,6 @@ static char *vboxDomainGetXMLDesc(virDomainPtr dom, unsigned int flags)
     PRUint32 parallelPortCount = 0;
     IBIOSSettings *bios = NULL;
     PRUint32 chipsetType = ChipsetType_Null;
-    ISystemProperties *systemProperties = NULL;
     char *ret = NULL;
 
     if (!data->vboxObj)
@@ -3924,15 +3942,13 @@ static char *vboxDomainGetXMLDesc(virDomainPtr dom, unsigned int flags)
     if (gVBoxAPI.chipsetType)
         gVBoxAPI.UIMachine.GetChipsetType(machine, &chipsetType);
 
-    gVBoxAPI.UIVirtualBox.GetSystemProperties(data->vboxObj, &systemProperties);
-    if (systemProperties) {
-        gVBoxAPI.UISystemProperties.GetMaxGuestRAM(systemProperties, &maxMemorySize);
-        gVBoxAPI.UISystemProperties.GetMaxBootPosition(systemProperties, &maxBootPosition);
-        gVBoxAPI.UISystemProperties.GetMaxNetworkAdapters(systemProperties, chipsetType, &networkAdapterCount);
-        gVBoxAPI.UISystemProperties.GetSerialPortCount(systemProperties, &serialPortCount);
-        gVBoxAPI.UISystemProperties.GetParallelPortCount(systemProperties, &parallelPortCount);
-        VBOX_RELEASE(systemProperties);
-        systemProperties = NULL;
+    if (vboxSystemPropertiesCacheFill(data) == 0) {
+        maxMemorySize = data->sysPropMaxGuestRAM;
+        maxBootPosition = data->sysPropMaxBootPosition;
+        serialPortCount = data->sysPropSerialPortCount;
+        parallelPortCount = data->sysPropParallelPortCount;
+        if (chipsetType < ARRAY_CARDINALITY(data->sysPropMaxNetworkAdapters))
+            networkAdapterCount = data->sysPropMaxNetworkAdapters[chipsetType];
     }
     /* Currently setting memory and maxMemory as same, cause
      * the notation here seems to be inconsistent while
@@ -5686,7 +5702,7 @@ static int vboxSnapshotGetReadWriteDisks(virDomainSnapshotDefPtr def,
             goto cleanup;
     }
 
-    if (!vboxGetMaxPortSlotValues(data->vboxObj, maxPortPerInst, maxSlotPerPort))
+    if (!vboxGetMaxPortSlotValues(data, maxPortPerInst, maxSlotPerPort))
         goto cleanup;
 
     /* get the attachment details here */
@@ -5905,7 +5921,7 @@ int vboxSnapshotGetReadOnlyDisks(virDomainSnapshotPtr snapshot,
         goto cleanup;
     }
 
-    if (!vboxGetMaxPortSlotValues(data->vboxObj, maxPortPerInst, maxSlotPerPort))
+    if (!vboxGetMaxPortSlotValues(data, maxPortPerInst, maxSlotPerPort))
         goto cleanup;
 
     /* get the attachment details here */
@@ -129,6 +129,20 @@ struct _vboxDriver {
 # endif
     unsigned long version;
 
+    /* Lazily filled mirror of the host-wide ISystemProperties limits,
+     * which are constant for the lifetime of the VirtualBox
+     * installation; saves a COM round trip per property per query.
+     * Use vboxSystemPropertiesCacheFill before reading the values. */
+    bool sysPropsCached;
+    PRUint32 sysPropMaxGuestRAM;
+    PRUint32 sysPropMaxGuestCPUCount;
+    PRUint32 sysPropMaxBootPosition;
+    PRUint32 sysPropSerialPortCount;
+    PRUint32 sysPropParallelPortCount;
+    PRUint32 sysPropMaxNetworkAdapters[4]; /* indexed by chipset type */
+    PRUint32 sysPropMaxPortPerInst[StorageBus_Floppy + 1];
+    PRUint32 sysPropMaxSlotPerPort[StorageBus_Floppy + 1];
+
     /* reference counting of vbox connections */
     int volatile connectionCount;
 };
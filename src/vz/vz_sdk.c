@@ -2245,6 +2245,12 @@ prlsdkHandleMigrationProgress(vzDriverPtr driver,
     virObjectUnlock(dom);
 }
 
+/* Dispatcher events are the only mechanism keeping driver->domains in
+ * sync with the SDK between API calls.  State transitions, config
+ * changes and VM addition/removal are all applied to the local list
+ * here, so the read-only driver entry points (vzDomainGetState,
+ * vzDomainGetInfo, vzDomainGetXMLDesc, ...) must never need to query
+ * the SDK and should keep serving from the list only. */
 static PRL_RESULT
 prlsdkEventsHandler(PRL_HANDLE prlEvent, PRL_VOID_PTR opaque)
 {
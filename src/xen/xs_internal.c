@@ -738,9 +738,11 @@ xenStoreWatchEvent(int watch ATTRIBUTE_UNUSED,
                    int events, void *data)
 {
     char		 **event;
+    char		 ***batch = NULL;
     char		 *path;
     char		 *token;
-    unsigned int	 stringCount;
+    size_t		 nbatch = 0;
+    size_t		 i;
     xenStoreWatchPtr     sw;
 
     virConnectPtr        conn = data;
@@ -756,19 +758,39 @@ xenStoreWatchEvent(int watch ATTRIBUTE_UNUSED,
     if (!priv->xshandle)
         goto cleanup;
 
-    event = xs_read_watch(priv->xshandle, &stringCount);
-    if (!event)
-        goto cleanup;
+    /* Drain every watch event that is already queued, coalescing
+     * duplicates of the same watch; the callbacks recompute the whole
+     * domain list, so a burst of identical events needs only one
+     * pass instead of a full relist per event.  Events arriving while
+     * the callbacks run keep the fd readable and are picked up on the
+     * next wakeup. */
+    while ((event = xs_check_watch(priv->xshandle))) {
+        bool dup = false;
+
+        for (i = 0; i < nbatch; i++) {
+            if (STREQ(batch[i][XS_WATCH_PATH], event[XS_WATCH_PATH]) &&
+                STREQ(batch[i][XS_WATCH_TOKEN], event[XS_WATCH_TOKEN])) {
+                dup = true;
+                break;
+            }
+        }
 
-    path  = event[XS_WATCH_PATH];
-    token = event[XS_WATCH_TOKEN];
+        if (dup || VIR_APPEND_ELEMENT_COPY_QUIET(batch, nbatch, event) < 0)
+            VIR_FREE(event);
+    }
+
+    for (i = 0; i < nbatch; i++) {
+        path  = batch[i][XS_WATCH_PATH];
+        token = batch[i][XS_WATCH_TOKEN];
 
-    sw = xenStoreFindWatch(priv->xsWatchList, path, token);
-    if (sw)
-        sw->cb(conn, path, token, sw->opaque);
-    VIR_FREE(event);
+        sw = xenStoreFindWatch(priv->xsWatchList, path, token);
+        if (sw)
+            sw->cb(conn, path, token, sw->opaque);
+        VIR_FREE(batch[i]);
+    }
 
  cleanup:
+    VIR_FREE(batch);
     xenUnifiedUnlock(priv);
 }
 
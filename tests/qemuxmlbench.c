@@ -0,0 +1,273 @@
+/*
+ * qemuxmlbench.c: domain XML parse/format benchmark over the argv corpus
+ *
+ * Copyright (C) 2017 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "testutils.h"
+#include "testutilsqemu.h"
+#include "viralloc.h"
+#include "virerror.h"
+#include "domain_conf.h"
+
+#define VIR_FROM_THIS VIR_FROM_QEMU
+
+/* Replays every XML file of the qemuxml2argvdata corpus through
+ * virDomainDefParseString + virDomainDefFormat in a timed loop so
+ * domain_conf.c changes can be justified with numbers rather than
+ * guesses.  Files the parser rejects (the corpus contains negative
+ * tests) are skipped and counted.  The allocation column is only
+ * non-zero when the tree is built with --enable-test-oom, which is
+ * what makes the viralloc counters live.
+ *
+ * Not part of 'make check'; run standalone via `make bench-xml`.
+ * VIR_XML_BENCH_REPS sets parse+format iterations per file (default
+ * 20); VIR_BENCH_CSV emits one "file,usec_per_iter,allocs_per_iter"
+ * line per corpus file instead of the aggregate report.
+ */
+
+static virQEMUDriver driver;
+
+struct benchFileResult {
+    char *name;
+    double usecPerIter;
+    double allocsPerIter;
+};
+
+static unsigned long long
+benchNowUsec(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+static int
+benchFileCompareName(const void *a, const void *b)
+{
+    const char *const *sa = a;
+    const char *const *sb = b;
+
+    return strcmp(*sa, *sb);
+}
+
+static int
+benchFileCompareCost(const void *a, const void *b)
+{
+    const struct benchFileResult *ra = a;
+    const struct benchFileResult *rb = b;
+
+    if (ra->usecPerIter > rb->usecPerIter)
+        return -1;
+    if (ra->usecPerIter < rb->usecPerIter)
+        return 1;
+    return 0;
+}
+
+/* Returns 1 on success, 0 if the file doesn't parse (negative test),
+ * -1 on real failure */
+static int
+benchOneFile(const char *path,
+             size_t reps,
+             double *usecPerIter,
+             double *allocsPerIter)
+{
+    char *xml = NULL;
+    virDomainDefPtr def = NULL;
+    char *formatted = NULL;
+    unsigned long long start;
+    unsigned long long elapsed;
+    size_t i;
+    int ret = -1;
+
+    if (virTestLoadFile(path, &xml) < 0)
+        goto cleanup;
+
+    /* One untimed pass both warms up and weeds out negative tests */
+    if (!(def = virDomainDefParseString(xml, driver.caps, driver.xmlopt,
+                                        NULL,
+                                        VIR_DOMAIN_DEF_PARSE_INACTIVE))) {
+        virResetLastError();
+        ret = 0;
+        goto cleanup;
+    }
+    virDomainDefFree(def);
+    def = NULL;
+
+    virAllocTestInit();
+    start = benchNowUsec();
+
+    for (i = 0; i < reps; i++) {
+        if (!(def = virDomainDefParseString(xml, driver.caps, driver.xmlopt,
+                                            NULL,
+                                            VIR_DOMAIN_DEF_PARSE_INACTIVE)))
+            goto cleanup;
+
+        if (!(formatted = virDomainDefFormat(def, driver.caps,
+                                             VIR_DOMAIN_DEF_FORMAT_SECURE |
+                                             VIR_DOMAIN_DEF_FORMAT_INACTIVE)))
+            goto cleanup;
+
+        VIR_FREE(formatted);
+        virDomainDefFree(def);
+        def = NULL;
+    }
+
+    elapsed = benchNowUsec() - start;
+
+    *usecPerIter = (double)elapsed / reps;
+    *allocsPerIter = (double)virAllocTestCount() / reps;
+    ret = 1;
+
+ cleanup:
+    virDomainDefFree(def);
+    VIR_FREE(formatted);
+    VIR_FREE(xml);
+    return ret;
+}
+
+static int
+mymain(void)
+{
+    const char *repsStr = getenv("VIR_XML_BENCH_REPS");
+    bool csv = getenv("VIR_BENCH_CSV") != NULL;
+    size_t reps = 20;
+    char *dirpath = NULL;
+    DIR *dir = NULL;
+    struct dirent *ent;
+    char **names = NULL;
+    size_t nnames = 0;
+    struct benchFileResult *results = NULL;
+    size_t nresults = 0;
+    size_t nskipped = 0;
+    double usecTotal = 0;
+    double allocsTotal = 0;
+    size_t i;
+    int rc;
+    int ret = EXIT_FAILURE;
+
+    if (repsStr) {
+        int val;
+        if (virStrToLong_i(repsStr, NULL, 10, &val) < 0 || val <= 0) {
+            fprintf(stderr, "Malformed VIR_XML_BENCH_REPS='%s'\n", repsStr);
+            goto cleanup;
+        }
+        reps = val;
+    }
+
+    if (qemuTestDriverInit(&driver) < 0)
+        goto cleanup;
+
+    if (virAsprintf(&dirpath, "%s/qemuxml2argvdata", abs_srcdir) < 0)
+        goto cleanup;
+
+    if (virDirOpen(&dir, dirpath) < 0)
+        goto cleanup;
+
+    while ((rc = virDirRead(dir, &ent, dirpath)) > 0) {
+        char *name;
+
+        if (!virFileHasSuffix(ent->d_name, ".xml"))
+            continue;
+
+        if (VIR_STRDUP(name, ent->d_name) < 0 ||
+            VIR_APPEND_ELEMENT(names, nnames, name) < 0) {
+            VIR_FREE(name);
+            goto cleanup;
+        }
+    }
+    if (rc < 0)
+        goto cleanup;
+
+    qsort(names, nnames, sizeof(*names), benchFileCompareName);
+
+    if (VIR_ALLOC_N(results, nnames) < 0)
+        goto cleanup;
+
+    for (i = 0; i < nnames; i++) {
+        struct benchFileResult *res = &results[nresults];
+        char *path;
+
+        if (virAsprintf(&path, "%s/%s", dirpath, names[i]) < 0)
+            goto cleanup;
+
+        rc = benchOneFile(path, reps, &res->usecPerIter, &res->allocsPerIter);
+        VIR_FREE(path);
+
+        if (rc < 0) {
+            fprintf(stderr, "Benchmarking %s failed\n", names[i]);
+            virDispatchError(NULL);
+            goto cleanup;
+        }
+        if (rc == 0) {
+            nskipped++;
+            continue;
+        }
+
+        res->name = names[i];
+        usecTotal += res->usecPerIter;
+        allocsTotal += res->allocsPerIter;
+        nresults++;
+
+        if (csv)
+            printf("%s,%.1f,%.1f\n",
+                   res->name, res->usecPerIter, res->allocsPerIter);
+    }
+
+    if (nresults == 0) {
+        fprintf(stderr, "No parsable XML files found in %s\n", dirpath);
+        goto cleanup;
+    }
+
+    if (!csv) {
+        printf("%zu files x %zu parse+format iterations "
+               "(%zu unparsable files skipped)\n",
+               nresults, reps, nskipped);
+        printf("  total     %10.0f usec/iter %10.0f allocs/iter\n",
+               usecTotal, allocsTotal);
+        printf("  mean      %10.1f usec/file %10.1f allocs/file\n",
+               usecTotal / nresults, allocsTotal / nresults);
+
+        qsort(results, nresults, sizeof(*results), benchFileCompareCost);
+        printf("Slowest files:\n");
+        for (i = 0; i < nresults && i < 10; i++)
+            printf("  %-50s %10.1f usec %10.1f allocs\n",
+                   results[i].name, results[i].usecPerIter,
+                   results[i].allocsPerIter);
+    }
+
+    ret = EXIT_SUCCESS;
+
+ cleanup:
+    VIR_DIR_CLOSE(dir);
+    for (i = 0; i < nnames; i++)
+        VIR_FREE(names[i]);
+    VIR_FREE(names);
+    VIR_FREE(results);
+    VIR_FREE(dirpath);
+    qemuTestDriverFree(&driver);
+    return ret;
+}
+
+VIRT_TEST_MAIN(mymain)
@@ -0,0 +1,261 @@
+/*
+ * virbench.c: microbenchmarks for the util primitives
+ *
+ * Copyright (C) 2017 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include "testutils.h"
+#include "viralloc.h"
+#include "virbitmap.h"
+#include "virbuffer.h"
+#include "virhash.h"
+#include "virjson.h"
+#include "virtime.h"
+
+/* Each benchmark performs @reps repetitions of its scenario and
+ * returns the total number of primitive operations executed, or 0 on
+ * error.  The harness reports ns/op and, when the tree is built with
+ * --enable-test-oom so the viralloc counters exist, allocations/op.
+ *
+ * Run standalone via `make bench`; set VIR_BENCH_CSV=1 for the
+ * machine readable "name,ns_per_op,allocs_per_op" output consumed by
+ * the CI trend job.
+ */
+
+typedef size_t (*virBenchFunc)(size_t reps);
+
+static size_t
+benchHashInsertLookup(size_t reps)
+{
+    size_t ops = 0;
+    size_t i;
+    size_t r;
+
+    for (r = 0; r < reps; r++) {
+        virHashTablePtr hash;
+        char key[32];
+
+        if (!(hash = virHashCreate(32, NULL)))
+            return 0;
+
+        for (i = 0; i < 1000; i++) {
+            snprintf(key, sizeof(key), "key-%zu", i);
+            if (virHashAddEntry(hash, key, (void *) 0x1) < 0) {
+                virHashFree(hash);
+                return 0;
+            }
+        }
+
+        for (i = 0; i < 1000; i++) {
+            snprintf(key, sizeof(key), "key-%zu", i);
+            if (!virHashLookup(hash, key)) {
+                virHashFree(hash);
+                return 0;
+            }
+        }
+
+        ops += 2000;
+        virHashFree(hash);
+    }
+
+    return ops;
+}
+
+static size_t
+benchBitmapSetCount(size_t reps)
+{
+    virBitmapPtr map;
+    size_t ops = 0;
+    size_t i;
+    size_t r;
+
+    if (!(map = virBitmapNew(4096)))
+        return 0;
+
+    for (r = 0; r < reps; r++) {
+        for (i = 0; i < 4096; i += 3)
+            ignore_value(virBitmapSetBit(map, i));
+
+        if (virBitmapCountBits(map) == 0)
+            goto error;
+
+        virBitmapClearAll(map);
+        ops += 4096 / 3 + 2;
+    }
+
+    virBitmapFree(map);
+    return ops;
+
+ error:
+    virBitmapFree(map);
+    return 0;
+}
+
+static size_t
+benchBufferGrow(size_t reps)
+{
+    size_t ops = 0;
+    size_t i;
+    size_t r;
+
+    for (r = 0; r < reps; r++) {
+        virBuffer buf = VIR_BUFFER_INITIALIZER;
+        char *result;
+
+        for (i = 0; i < 1000; i++)
+            virBufferAsprintf(&buf, "<element index='%zu'/>\n", i);
+
+        if (!(result = virBufferContentAndReset(&buf)))
+            return 0;
+
+        VIR_FREE(result);
+        ops += 1000;
+    }
+
+    return ops;
+}
+
+static size_t
+benchJSONParseFormat(size_t reps)
+{
+    const char *doc =
+        "{\"name\": \"benchmark\", \"enabled\": true, \"count\": 42,"
+        " \"devices\": [{\"alias\": \"virtio-disk0\", \"bus\": 0},"
+        "               {\"alias\": \"virtio-disk1\", \"bus\": 1},"
+        "               {\"alias\": \"net0\", \"bus\": 2}],"
+        " \"nested\": {\"a\": [1, 2, 3, 4], \"b\": \"string value\"}}";
+    size_t ops = 0;
+    size_t r;
+
+    for (r = 0; r < reps; r++) {
+        virJSONValuePtr json;
+        char *str;
+
+        if (!(json = virJSONValueFromString(doc)))
+            return 0;
+
+        str = virJSONValueToString(json, false);
+        virJSONValueFree(json);
+        if (!str)
+            return 0;
+        VIR_FREE(str);
+
+        ops += 2;
+    }
+
+    return ops;
+}
+
+static size_t
+benchTypedParamsBuild(size_t reps)
+{
+    size_t ops = 0;
+    size_t i;
+    size_t r;
+
+    for (r = 0; r < reps; r++) {
+        virTypedParameterPtr params = NULL;
+        int nparams = 0;
+        int maxparams = 0;
+        char name[VIR_TYPED_PARAM_FIELD_LENGTH];
+
+        for (i = 0; i < 64; i++) {
+            snprintf(name, sizeof(name), "param.%zu", i);
+            if (virTypedParamsAddULLong(&params, &nparams, &maxparams,
+                                        name, i) < 0) {
+                virTypedParamsFree(params, nparams);
+                return 0;
+            }
+        }
+
+        virTypedParamsFree(params, nparams);
+        ops += 64;
+    }
+
+    return ops;
+}
+
+static int
+virBenchRun(const char *name,
+            virBenchFunc func,
+            size_t reps)
+{
+    bool csv = getenv("VIR_BENCH_CSV") != NULL;
+    unsigned long long before;
+    unsigned long long after;
+    double nsPerOp;
+    double allocsPerOp;
+    size_t ops;
+    int allocs;
+
+    /* Warm up caches and lazy initialization outside the timed run */
+    if (func(reps / 10 + 1) == 0)
+        goto error;
+
+    virAllocTestInit();
+
+    if (virTimeMillisNowRaw(&before) < 0)
+        goto error;
+    ops = func(reps);
+    if (virTimeMillisNowRaw(&after) < 0 || ops == 0)
+        goto error;
+
+    allocs = virAllocTestCount();
+
+    nsPerOp = (after - before) * 1000000.0 / ops;
+    allocsPerOp = (double) allocs / ops;
+
+    if (csv) {
+        printf("%s,%.1f,%.4f\n", name, nsPerOp, allocsPerOp);
+    } else if (allocs > 0) {
+        printf("%-24s %12.1f ns/op %10.2f allocs/op\n",
+               name, nsPerOp, allocsPerOp);
+    } else {
+        printf("%-24s %12.1f ns/op\n", name, nsPerOp);
+    }
+
+    return 0;
+
+ error:
+    fprintf(stderr, "benchmark %s failed\n", name);
+    return -1;
+}
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (virBenchRun("virhash-insert-lookup", benchHashInsertLookup, 200) < 0)
+        ret = -1;
+    if (virBenchRun("virbitmap-set-count", benchBitmapSetCount, 5000) < 0)
+        ret = -1;
+    if (virBenchRun("virbuffer-grow", benchBufferGrow, 500) < 0)
+        ret = -1;
+    if (virBenchRun("virjson-parse-format", benchJSONParseFormat, 20000) < 0)
+        ret = -1;
+    if (virBenchRun("virtypedparams-build", benchTypedParamsBuild, 5000) < 0)
+        ret = -1;
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIRT_TEST_MAIN(mymain)
@@ -922,19 +922,25 @@ mymain(void)
     if (virTestRun("virCgroupGetPercpuStats works", testCgroupGetPercpuStats, NULL) < 0)
         ret = -1;
 
+    /* The mock mode changes the mount layout the process sees, so the
+     * process-lifetime mount cache must be dropped at each switch */
     setenv("VIR_CGROUP_MOCK_MODE", "allinone", 1);
+    virCgroupClearMountCache();
     if (virTestRun("New cgroup for self (allinone)", testCgroupNewForSelfAllInOne, NULL) < 0)
         ret = -1;
     if (virTestRun("Cgroup available", testCgroupAvailable, (void*)0x1) < 0)
         ret = -1;
     unsetenv("VIR_CGROUP_MOCK_MODE");
+    virCgroupClearMountCache();
 
     setenv("VIR_CGROUP_MOCK_MODE", "logind", 1);
+    virCgroupClearMountCache();
     if (virTestRun("New cgroup for self (logind)", testCgroupNewForSelfLogind, NULL) < 0)
         ret = -1;
     if (virTestRun("Cgroup available", testCgroupAvailable, (void*)0x0) < 0)
         ret = -1;
     unsetenv("VIR_CGROUP_MOCK_MODE");
+    virCgroupClearMountCache();
 
     if (getenv("LIBVIRT_SKIP_CLEANUP") == NULL)
         virFileDeleteTree(fakerootdir);
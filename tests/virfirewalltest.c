@@ -1123,6 +1123,119 @@ testFirewallQuery(const void *opaque ATTRIBUTE_UNUSED)
     return ret;
 }
 
+static void
+testFirewallAutoBatchHook(const char *const*args ATTRIBUTE_UNUSED,
+                          const char *const*env ATTRIBUTE_UNUSED,
+                          const char *input,
+                          char **output ATTRIBUTE_UNUSED,
+                          char **error ATTRIBUTE_UNUSED,
+                          int *status ATTRIBUTE_UNUSED,
+                          void *opaque)
+{
+    virBufferPtr inputbuf = opaque;
+
+    if (input)
+        virBufferAdd(inputbuf, input, -1);
+}
+
+static int
+testFirewallAutoBatch(const void *opaque)
+{
+    virBuffer cmdbuf = VIR_BUFFER_INITIALIZER;
+    virBuffer inputbuf = VIR_BUFFER_INITIALIZER;
+    virFirewallPtr fw = NULL;
+    int ret = -1;
+    const char *actual = NULL;
+    const char *expectedDirect =
+        IPTABLES_RESTORE_PATH " -n\n"
+        EBTABLES_PATH " -t nat -A PREROUTING --jump ACCEPT\n";
+    const char *expectedInput =
+        "*nat\n"
+        "-A POSTROUTING --jump MASQUERADE\n"
+        "COMMIT\n"
+        "*filter\n"
+        "-A INPUT --source-host 192.168.122.1 --jump ACCEPT\n"
+        "-A INPUT --jump DROP\n"
+        "COMMIT\n";
+    const char *expectedFirewallD =
+        IPTABLES_PATH " -A INPUT --source-host 192.168.122.1 --jump ACCEPT\n"
+        IPTABLES_PATH " -t nat -A POSTROUTING --jump MASQUERADE\n"
+        IPTABLES_PATH " -A INPUT --jump DROP\n"
+        EBTABLES_PATH " -t nat -A PREROUTING --jump ACCEPT\n";
+    const char *expected;
+    const struct testFirewallData *data = opaque;
+
+    fwDisabled = data->fwDisabled;
+    if (virFirewallSetBackend(data->tryBackend) < 0)
+        goto cleanup;
+
+    if (data->expectBackend == VIR_FIREWALL_BACKEND_DIRECT) {
+        virCommandSetDryRun(&cmdbuf, testFirewallAutoBatchHook, &inputbuf);
+        expected = expectedDirect;
+    } else {
+        fwBuf = &cmdbuf;
+        fwError = false;
+        expected = expectedFirewallD;
+    }
+
+    fw = virFirewallNew();
+
+    virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_AUTO_BATCH);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "-A", "INPUT",
+                       "--source-host", "192.168.122.1",
+                       "--jump", "ACCEPT", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "-t", "nat",
+                       "-A", "POSTROUTING",
+                       "--jump", "MASQUERADE", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "-A", "INPUT",
+                       "--jump", "DROP", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_ETHERNET,
+                       "-t", "nat",
+                       "-A", "PREROUTING",
+                       "--jump", "ACCEPT", NULL);
+
+    if (virFirewallApply(fw) < 0)
+        goto cleanup;
+
+    if (virBufferError(&cmdbuf) ||
+        virBufferError(&inputbuf))
+        goto cleanup;
+
+    actual = virBufferCurrentContent(&cmdbuf);
+
+    if (STRNEQ_NULLABLE(expected, actual)) {
+        fprintf(stderr, "Unexpected command execution\n");
+        virTestDifference(stderr, expected, actual);
+        goto cleanup;
+    }
+
+    if (data->expectBackend == VIR_FIREWALL_BACKEND_DIRECT) {
+        actual = virBufferCurrentContent(&inputbuf);
+
+        if (STRNEQ_NULLABLE(expectedInput, actual)) {
+            fprintf(stderr, "Unexpected batch input\n");
+            virTestDifference(stderr, expectedInput, actual);
+            goto cleanup;
+        }
+    }
+
+    ret = 0;
+ cleanup:
+    virBufferFreeAndReset(&cmdbuf);
+    virBufferFreeAndReset(&inputbuf);
+    fwBuf = NULL;
+    virCommandSetDryRun(NULL, NULL, NULL);
+    virFirewallFree(fw);
+    return ret;
+}
+
 static int
 mymain(void)
 {
@@ -1179,6 +1292,7 @@ mymain(void)
     RUN_TEST("many rollback", testFirewallManyRollback);
     RUN_TEST("chained rollback", testFirewallChainedRollback);
     RUN_TEST("query transaction", testFirewallQuery);
+    RUN_TEST("autobatch group", testFirewallAutoBatch);
 
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
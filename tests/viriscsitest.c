@@ -107,6 +107,8 @@ testISCSIGetSession(const void *data)
     char *actual_session = NULL;
     int ret = -1;
 
+    /* force each run to parse a fresh iscsiadm listing */
+    virISCSISessionCacheInvalidate();
     virCommandSetDryRun(NULL, testIscsiadmCb, &ver);
 
     actual_session = virISCSIGetSession(info->device_path, true);
@@ -127,6 +129,72 @@ testISCSIGetSession(const void *data)
     return ret;
 }
 
+static void testIscsiadmFailCb(const char *const*args ATTRIBUTE_UNUSED,
+                               const char *const*env ATTRIBUTE_UNUSED,
+                               const char *input ATTRIBUTE_UNUSED,
+                               char **output ATTRIBUTE_UNUSED,
+                               char **error ATTRIBUTE_UNUSED,
+                               int *status,
+                               void *opaque ATTRIBUTE_UNUSED)
+{
+    *status = -1;
+}
+
+static int
+testISCSISessionCache(const void *data ATTRIBUTE_UNUSED)
+{
+    int ver = 0;
+    char *session = NULL;
+    int ret = -1;
+
+    /* prime the cache from a full session listing */
+    virISCSISessionCacheInvalidate();
+    virCommandSetDryRun(NULL, testIscsiadmCb, &ver);
+
+    session = virISCSIGetSession("iqn.2004-06.example:example1:iscsi.test",
+                                 true);
+    if (STRNEQ_NULLABLE(session, "1")) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "Expected session '1' got '%s'", NULLSTR(session));
+        goto cleanup;
+    }
+    VIR_FREE(session);
+
+    /* a lookup within the cache TTL must not run iscsiadm again;
+     * any command spawned here reports failure */
+    virCommandSetDryRun(NULL, testIscsiadmFailCb, NULL);
+
+    session = virISCSIGetSession("iqn.2009-04.example:example1:iscsi.seven",
+                                 true);
+    if (STRNEQ_NULLABLE(session, "7")) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "Expected cached session '7' got '%s'",
+                       NULLSTR(session));
+        goto cleanup;
+    }
+    VIR_FREE(session);
+
+    /* invalidating forces a fresh listing, which now finds nothing */
+    virISCSISessionCacheInvalidate();
+
+    session = virISCSIGetSession("iqn.2009-04.example:example1:iscsi.seven",
+                                 true);
+    if (session) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "Expected no session after invalidation, got '%s'",
+                       session);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virCommandSetDryRun(NULL, NULL, NULL);
+    virISCSISessionCacheInvalidate();
+    VIR_FREE(session);
+    return ret;
+}
+
 struct testScanTargetsInfo {
     const char *fake_cmd_output;
     const char *portal;
@@ -195,6 +263,9 @@ mymain(void)
     DO_SESSION_TEST("iqn.2009-04.example:example1:iscsi.seven", "7");
     DO_SESSION_TEST("iqn.2009-04.example:example1:iscsi.eight", NULL);
 
+    if (virTestRun("ISCSI session cache", testISCSISessionCache, NULL) < 0)
+        rv = -1;
+
     const char *targets[] = {
         "iqn.2004-06.example:example1:iscsi.test",
         "iqn.2005-05.example:example1:iscsi.hello",
@@ -0,0 +1,408 @@
+/*
+ * virnetserverbench.c: loopback benchmark of the RPC dispatch path
+ *
+ * Copyright (C) 2017 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "testutils.h"
+#include "viralloc.h"
+#include "virerror.h"
+#include "virstring.h"
+#include "virthread.h"
+#include "rpc/virnetdaemon.h"
+#include "rpc/virnetserver.h"
+#include "rpc/virnetserverservice.h"
+#include "rpc/virnetserverprogram.h"
+#include "rpc/virnetclient.h"
+#include "rpc/virnetclientprogram.h"
+#include "rpc/virnetsocket.h"
+
+#define VIR_FROM_THIS VIR_FROM_RPC
+
+#ifndef WIN32
+
+/* Measures the full client -> UNIX socket -> virNetServer worker pool
+ * -> client round trip using a trivial "ping" procedure, so any time
+ * reported is pure RPC framing, wakeup and dispatch overhead rather
+ * than API work.  Reported are aggregate throughput, p50/p99 call
+ * latency and worker pool occupancy sampled during the run.
+ *
+ * Not part of 'make check'; run standalone via `make bench-rpc`.
+ * Tunables via the environment:
+ *
+ *   VIR_RPC_BENCH_CLIENTS  concurrent client connections (default 4)
+ *   VIR_RPC_BENCH_CALLS    calls per client (default 2000)
+ *   VIR_RPC_BENCH_WORKERS  server worker threads (default 5)
+ *   VIR_BENCH_CSV          machine readable one line summary
+ */
+
+# define BENCH_PROGRAM 0x20170901
+# define BENCH_PROGRAM_VERSION 1
+# define BENCH_PROC_PING 1
+
+static int
+benchDispatchPing(virNetServerPtr server ATTRIBUTE_UNUSED,
+                  virNetServerClientPtr client ATTRIBUTE_UNUSED,
+                  virNetMessagePtr msg ATTRIBUTE_UNUSED,
+                  virNetMessageErrorPtr rerr ATTRIBUTE_UNUSED,
+                  void *args ATTRIBUTE_UNUSED,
+                  void *ret ATTRIBUTE_UNUSED)
+{
+    return 0;
+}
+
+static virNetServerProgramProc benchProcs[] = {
+    { NULL, 0, NULL, 0, NULL, false, 0 }, /* Procs are 1 based */
+    { benchDispatchPing, 0, (xdrproc_t)xdr_void, 0, (xdrproc_t)xdr_void,
+      false, 0 },
+};
+
+static unsigned long long
+benchNowUsec(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+struct benchClientData {
+    const char *sockpath;
+    size_t ncalls;
+    unsigned long long *latency; /* one slot per call, in usec */
+    int result;
+};
+
+static void
+benchClientWorker(void *opaque)
+{
+    struct benchClientData *data = opaque;
+    virNetClientPtr client = NULL;
+    virNetClientProgramPtr prog = NULL;
+    size_t i;
+
+    data->result = -1;
+
+    if (!(client = virNetClientNewUNIX(data->sockpath, false, NULL)))
+        goto cleanup;
+
+    if (!(prog = virNetClientProgramNew(BENCH_PROGRAM,
+                                        BENCH_PROGRAM_VERSION,
+                                        NULL, 0, NULL)))
+        goto cleanup;
+
+    for (i = 0; i < data->ncalls; i++) {
+        unsigned long long start = benchNowUsec();
+
+        if (virNetClientProgramCall(prog, client, i,
+                                    BENCH_PROC_PING,
+                                    0, NULL, NULL, NULL,
+                                    (xdrproc_t)xdr_void, NULL,
+                                    (xdrproc_t)xdr_void, NULL) < 0)
+            goto cleanup;
+
+        data->latency[i] = benchNowUsec() - start;
+    }
+
+    data->result = 0;
+
+ cleanup:
+    if (data->result < 0)
+        virDispatchError(NULL);
+    if (client)
+        virNetClientClose(client);
+    virObjectUnref(prog);
+    virObjectUnref(client);
+}
+
+struct benchPoolSampler {
+    virNetServerPtr srv;
+    volatile bool quit;
+    size_t nsamples;
+    unsigned long long busySum;
+    size_t busyMax;
+    size_t queueMax;
+};
+
+static void
+benchPoolSamplerWorker(void *opaque)
+{
+    struct benchPoolSampler *sampler = opaque;
+
+    while (!sampler->quit) {
+        size_t minWorkers, maxWorkers, nWorkers, freeWorkers;
+        size_t nPrioWorkers, jobQueueDepth;
+        size_t busy;
+
+        if (virNetServerGetThreadPoolParameters(sampler->srv,
+                                                &minWorkers, &maxWorkers,
+                                                &nWorkers, &freeWorkers,
+                                                &nPrioWorkers,
+                                                &jobQueueDepth) < 0)
+            break;
+
+        busy = nWorkers - freeWorkers;
+        sampler->busySum += busy;
+        if (busy > sampler->busyMax)
+            sampler->busyMax = busy;
+        if (jobQueueDepth > sampler->queueMax)
+            sampler->queueMax = jobQueueDepth;
+        sampler->nsamples++;
+
+        usleep(2 * 1000);
+    }
+}
+
+static void
+benchServerWorker(void *opaque)
+{
+    virNetDaemonPtr dmn = opaque;
+
+    virNetDaemonRun(dmn);
+}
+
+static int
+benchLatencyCompare(const void *a, const void *b)
+{
+    unsigned long long la = *(const unsigned long long *)a;
+    unsigned long long lb = *(const unsigned long long *)b;
+
+    if (la < lb)
+        return -1;
+    if (la > lb)
+        return 1;
+    return 0;
+}
+
+static size_t
+benchEnvSize(const char *name, size_t defval)
+{
+    const char *str = getenv(name);
+    int val;
+
+    if (!str)
+        return defval;
+    if (virStrToLong_i(str, NULL, 10, &val) < 0 || val <= 0) {
+        fprintf(stderr, "Ignoring malformed %s='%s'\n", name, str);
+        return defval;
+    }
+    return val;
+}
+
+
+static int
+mymain(void)
+{
+    size_t nclients = benchEnvSize("VIR_RPC_BENCH_CLIENTS", 4);
+    size_t ncalls = benchEnvSize("VIR_RPC_BENCH_CALLS", 2000);
+    size_t nworkers = benchEnvSize("VIR_RPC_BENCH_WORKERS", 5);
+    char template[] = "/tmp/virnetserverbench-XXXXXX";
+    char *tmpdir = NULL;
+    char *sockpath = NULL;
+    virNetDaemonPtr dmn = NULL;
+    virNetServerPtr srv = NULL;
+    virNetServerServicePtr svc = NULL;
+    virNetServerProgramPtr prog = NULL;
+    virNetSocketPtr wakeup = NULL;
+    virThread serverThread;
+    bool serverThreadStarted = false;
+    virThread samplerThread;
+    bool samplerThreadStarted = false;
+    struct benchPoolSampler sampler = { NULL, false, 0, 0, 0, 0 };
+    struct benchClientData *clients = NULL;
+    virThread *clientThreads = NULL;
+    size_t nclientThreads = 0;
+    unsigned long long *all = NULL;
+    unsigned long long wallStart, wallUsec;
+    double wallSec, throughput;
+    size_t total, i;
+    int ret = EXIT_FAILURE;
+
+    if (!(tmpdir = mkdtemp(template))) {
+        fprintf(stderr, "Failed to create temporary dir\n");
+        goto cleanup;
+    }
+
+    if (virAsprintf(&sockpath, "%s/sock", tmpdir) < 0)
+        goto cleanup;
+
+    if (virEventRegisterDefaultImpl() < 0)
+        goto cleanup;
+
+    if (!(srv = virNetServerNew("rpc-bench", 1,
+                                nworkers, nworkers, 0,
+                                nclients + 1, nclients + 1,
+                                -1, 0, NULL,
+                                NULL, NULL, NULL, NULL)))
+        goto cleanup;
+
+    if (!(svc = virNetServerServiceNewUNIX(sockpath, 0700, getegid(),
+                                           VIR_NET_SERVER_SERVICE_AUTH_NONE,
+# if WITH_GNUTLS
+                                           NULL,
+# endif
+                                           false, nclients + 1, 5)))
+        goto cleanup;
+
+    if (virNetServerAddService(srv, svc, NULL) < 0)
+        goto cleanup;
+
+    if (!(prog = virNetServerProgramNew(BENCH_PROGRAM,
+                                        BENCH_PROGRAM_VERSION,
+                                        benchProcs,
+                                        ARRAY_CARDINALITY(benchProcs))))
+        goto cleanup;
+
+    if (virNetServerAddProgram(srv, prog) < 0)
+        goto cleanup;
+
+    if (!(dmn = virNetDaemonNew()))
+        goto cleanup;
+
+    if (virNetDaemonAddServer(dmn, srv) < 0)
+        goto cleanup;
+
+    if (virThreadCreate(&serverThread, true, benchServerWorker, dmn) < 0)
+        goto cleanup;
+    serverThreadStarted = true;
+
+    sampler.srv = srv;
+    if (virThreadCreate(&samplerThread, true,
+                        benchPoolSamplerWorker, &sampler) < 0)
+        goto cleanup;
+    samplerThreadStarted = true;
+
+    if (VIR_ALLOC_N(clients, nclients) < 0 ||
+        VIR_ALLOC_N(clientThreads, nclients) < 0)
+        goto cleanup;
+
+    for (i = 0; i < nclients; i++) {
+        clients[i].sockpath = sockpath;
+        clients[i].ncalls = ncalls;
+        if (VIR_ALLOC_N(clients[i].latency, ncalls) < 0)
+            goto cleanup;
+    }
+
+    wallStart = benchNowUsec();
+
+    for (i = 0; i < nclients; i++) {
+        if (virThreadCreate(&clientThreads[i], true,
+                            benchClientWorker, &clients[i]) < 0)
+            goto cleanup;
+        nclientThreads++;
+    }
+
+    for (i = 0; i < nclientThreads; i++)
+        virThreadJoin(&clientThreads[i]);
+    nclientThreads = 0;
+
+    wallUsec = benchNowUsec() - wallStart;
+
+    for (i = 0; i < nclients; i++) {
+        if (clients[i].result < 0) {
+            fprintf(stderr, "Client %zu failed\n", i);
+            goto cleanup;
+        }
+    }
+
+    total = nclients * ncalls;
+    if (VIR_ALLOC_N(all, total) < 0)
+        goto cleanup;
+    for (i = 0; i < nclients; i++)
+        memcpy(all + i * ncalls, clients[i].latency,
+               ncalls * sizeof(*all));
+    qsort(all, total, sizeof(*all), benchLatencyCompare);
+
+    wallSec = wallUsec / 1000000.0;
+    throughput = total / wallSec;
+
+    if (getenv("VIR_BENCH_CSV")) {
+        printf("%zu,%zu,%zu,%.0f,%llu,%llu,%.2f,%zu,%zu\n",
+               nclients, ncalls, nworkers, throughput,
+               all[total * 50 / 100], all[total * 99 / 100],
+               sampler.nsamples ?
+               (double)sampler.busySum / sampler.nsamples : 0.0,
+               sampler.busyMax, sampler.queueMax);
+    } else {
+        printf("%zu clients x %zu calls against %zu workers in %.2fs\n",
+               nclients, ncalls, nworkers, wallSec);
+        printf("  throughput     %10.0f calls/sec\n", throughput);
+        printf("  latency p50    %10llu usec\n", all[total * 50 / 100]);
+        printf("  latency p99    %10llu usec\n", all[total * 99 / 100]);
+        printf("  pool busy avg  %10.2f workers\n",
+               sampler.nsamples ?
+               (double)sampler.busySum / sampler.nsamples : 0.0);
+        printf("  pool busy max  %10zu workers\n", sampler.busyMax);
+        printf("  queue depth max%10zu jobs\n", sampler.queueMax);
+    }
+
+    ret = EXIT_SUCCESS;
+
+ cleanup:
+    for (i = 0; i < nclientThreads; i++)
+        virThreadJoin(&clientThreads[i]);
+
+    if (samplerThreadStarted) {
+        sampler.quit = true;
+        virThreadJoin(&samplerThread);
+    }
+
+    if (serverThreadStarted) {
+        virNetDaemonQuit(dmn);
+        /* Poke the event loop so it notices the quit request */
+        if (virNetSocketNewConnectUNIX(sockpath, false, NULL, &wakeup) == 0)
+            virObjectUnref(wakeup);
+        virThreadJoin(&serverThread);
+    }
+
+    if (clients) {
+        for (i = 0; i < nclients; i++)
+            VIR_FREE(clients[i].latency);
+    }
+    VIR_FREE(clients);
+    VIR_FREE(clientThreads);
+    VIR_FREE(all);
+    virObjectUnref(prog);
+    virObjectUnref(svc);
+    virObjectUnref(srv);
+    virObjectUnref(dmn);
+    if (sockpath)
+        unlink(sockpath);
+    if (tmpdir)
+        rmdir(tmpdir);
+    VIR_FREE(sockpath);
+    return ret;
+}
+
+#else /* WIN32 */
+
+static int
+mymain(void)
+{
+    return EXIT_AM_SKIP;
+}
+
+#endif /* WIN32 */
+
+VIRT_TEST_MAIN(mymain)
@@ -646,6 +646,41 @@ static int testStripControlChars(const void *args)
     return ret;
 }
 
+static int testStringIntern(const void *args ATTRIBUTE_UNUSED)
+{
+    char *a = NULL;
+    char *b = NULL;
+    char *plain = NULL;
+    int ret = -1;
+
+    if (!(a = virStringIntern("virtio-disk0")) ||
+        !(b = virStringIntern("virtio-disk0")))
+        goto cleanup;
+
+    if (a != b) {
+        fprintf(stderr, "Equal strings were not interned to one copy\n");
+        goto cleanup;
+    }
+
+    /* a malloc'ed duplicate of an interned string must still be
+     * released safely through virStringInternFree */
+    if (VIR_STRDUP(plain, a) < 0)
+        goto cleanup;
+
+    if (plain == a) {
+        fprintf(stderr, "Expected a private copy of the string\n");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virStringInternFree(a);
+    virStringInternFree(b);
+    virStringInternFree(plain);
+    return ret;
+}
+
 static int
 mymain(void)
 {
@@ -897,6 +932,10 @@ mymain(void)
     TEST_STRIP_CONTROL_CHARS("\x01H\x02" "E\x03L\x04L\x05O", "HELLO");
     TEST_STRIP_CONTROL_CHARS("\x01\x02\x03\x04HELL\x05O", "HELLO");
     TEST_STRIP_CONTROL_CHARS("\nhello \x01\x07hello\t", "\nhello hello\t");
+
+    if (virTestRun("virStringIntern", testStringIntern, NULL) < 0)
+        ret = -1;
+
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
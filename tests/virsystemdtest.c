@@ -234,6 +234,7 @@ static int testCreateNoSystemd(const void *opaque ATTRIBUTE_UNUSED)
     int rv;
 
     setenv("FAIL_NO_SERVICE", "1", 1);
+    virSystemdHasMachinedResetCachedValue();
 
     if ((rv = virSystemdCreateMachine("demo",
                                       "qemu",
@@ -244,10 +245,12 @@ static int testCreateNoSystemd(const void *opaque ATTRIBUTE_UNUSED)
                                       0, NULL,
                                       NULL)) == 0) {
         unsetenv("FAIL_NO_SERVICE");
+        virSystemdHasMachinedResetCachedValue();
         fprintf(stderr, "%s", "Unexpected create machine success\n");
         return -1;
     }
     unsetenv("FAIL_NO_SERVICE");
+    virSystemdHasMachinedResetCachedValue();
 
     if (rv != -2) {
         fprintf(stderr, "%s", "Unexpected create machine error\n");
@@ -268,6 +271,7 @@ static int testCreateSystemdNotRunning(const void *opaque ATTRIBUTE_UNUSED)
     int rv;
 
     setenv("FAIL_NOT_REGISTERED", "1", 1);
+    virSystemdHasMachinedResetCachedValue();
 
     if ((rv = virSystemdCreateMachine("demo",
                                       "qemu",
@@ -278,10 +282,12 @@ static int testCreateSystemdNotRunning(const void *opaque ATTRIBUTE_UNUSED)
                                       0, NULL,
                                       NULL)) == 0) {
         unsetenv("FAIL_NOT_REGISTERED");
+        virSystemdHasMachinedResetCachedValue();
         fprintf(stderr, "%s", "Unexpected create machine success\n");
         return -1;
     }
     unsetenv("FAIL_NOT_REGISTERED");
+    virSystemdHasMachinedResetCachedValue();
 
     if (rv != -2) {
         fprintf(stderr, "%s", "Unexpected create machine error\n");
@@ -302,6 +308,7 @@ static int testCreateBadSystemd(const void *opaque ATTRIBUTE_UNUSED)
     int rv;
 
     setenv("FAIL_BAD_SERVICE", "1", 1);
+    virSystemdHasMachinedResetCachedValue();
 
     if ((rv = virSystemdCreateMachine("demo",
                                       "qemu",
@@ -312,10 +319,12 @@ static int testCreateBadSystemd(const void *opaque ATTRIBUTE_UNUSED)
                                       0, NULL,
                                       NULL)) == 0) {
         unsetenv("FAIL_BAD_SERVICE");
+        virSystemdHasMachinedResetCachedValue();
         fprintf(stderr, "%s", "Unexpected create machine success\n");
         return -1;
     }
     unsetenv("FAIL_BAD_SERVICE");
+    virSystemdHasMachinedResetCachedValue();
 
     if (rv != -1) {
         fprintf(stderr, "%s", "Unexpected create machine error\n");
@@ -468,13 +477,16 @@ static int testPMSupportHelperNoSystemd(const void *opaque)
     const struct testPMSupportData *data = opaque;
 
     setenv("FAIL_NO_SERVICE", "1", 1);
+    virSystemdHasLogindResetCachedValue();
 
     if ((rv = data->tested(&result)) == 0) {
         unsetenv("FAIL_NO_SERVICE");
+        virSystemdHasLogindResetCachedValue();
         fprintf(stderr, "%s", "Unexpected canSuspend success\n");
         return -1;
     }
     unsetenv("FAIL_NO_SERVICE");
+    virSystemdHasLogindResetCachedValue();
 
     if (rv != -2) {
         fprintf(stderr, "%s", "Unexpected canSuspend error\n");
@@ -491,13 +503,16 @@ static int testPMSupportSystemdNotRunning(const void *opaque)
     const struct testPMSupportData *data = opaque;
 
     setenv("FAIL_NOT_REGISTERED", "1", 1);
+    virSystemdHasLogindResetCachedValue();
 
     if ((rv = data->tested(&result)) == 0) {
         unsetenv("FAIL_NOT_REGISTERED");
+        virSystemdHasLogindResetCachedValue();
         fprintf(stderr, "%s", "Unexpected canSuspend success\n");
         return -1;
     }
     unsetenv("FAIL_NOT_REGISTERED");
+    virSystemdHasLogindResetCachedValue();
 
     if (rv != -2) {
         fprintf(stderr, "%s", "Unexpected canSuspend error\n");
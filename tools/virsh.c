@@ -134,6 +134,90 @@ virshCatchDisconnect(virConnectPtr conn,
     }
 }
 
+/*
+ * Cached domain name directory used for readline completion.  The list
+ * is fetched lazily on the first completion request and kept until a
+ * domain lifecycle event invalidates it, so completing against hosts
+ * with many domains doesn't trigger a full list RPC on every keypress.
+ */
+static void
+virshDomainNameCacheReset(vshControl *ctl)
+{
+    virshControlPtr priv = ctl->privData;
+
+    virStringListFree(priv->domNameCache);
+    priv->domNameCache = NULL;
+    priv->domNameCacheValid = false;
+}
+
+static int
+virshDomainNameCacheEvent(virConnectPtr conn ATTRIBUTE_UNUSED,
+                          virDomainPtr dom ATTRIBUTE_UNUSED,
+                          int event ATTRIBUTE_UNUSED,
+                          int detail ATTRIBUTE_UNUSED,
+                          void *opaque)
+{
+    vshControl *ctl = opaque;
+    virshControlPtr priv = ctl->privData;
+
+    /* Only flip the flag here; the stale list is freed and refetched
+     * by the next completion request.  A racing completer may serve
+     * one outdated list, which is harmless for completion purposes. */
+    priv->domNameCacheValid = false;
+    return 0;
+}
+
+char **
+virshDomainNameCompleter(void *opaque, unsigned int flags ATTRIBUTE_UNUSED)
+{
+    vshControl *ctl = opaque;
+    virshControlPtr priv = ctl->privData;
+    virDomainPtr *domains = NULL;
+    int ndomains;
+    size_t i;
+    size_t ncopied = 0;
+    char **ret = NULL;
+
+    /* Don't force a (re)connect just to offer completions */
+    if (!priv->conn || virConnectIsAlive(priv->conn) <= 0) {
+        vshResetLibvirtError();
+        return NULL;
+    }
+
+    if (!priv->domNameCacheValid) {
+        virshDomainNameCacheReset(ctl);
+
+        if ((ndomains = virConnectListAllDomains(priv->conn, &domains, 0)) < 0) {
+            vshResetLibvirtError();
+            return NULL;
+        }
+
+        priv->domNameCache = vshCalloc(ctl, ndomains + 1,
+                                       sizeof(*priv->domNameCache));
+
+        for (i = 0; i < ndomains; i++) {
+            const char *name = virDomainGetName(domains[i]);
+
+            if (name)
+                priv->domNameCache[ncopied++] = vshStrdup(ctl, name);
+            virDomainFree(domains[i]);
+        }
+        VIR_FREE(domains);
+
+        /* Without lifecycle events nothing would ever invalidate the
+         * cache, so treat the list as valid for this request only */
+        priv->domNameCacheValid = priv->domEventId >= 0;
+    }
+
+    /* The caller frees the result, so hand out a copy of the cache */
+    ret = vshCalloc(ctl, virStringListLength((const char **)priv->domNameCache) + 1,
+                    sizeof(*ret));
+    for (i = 0; priv->domNameCache[i]; i++)
+        ret[i] = vshStrdup(ctl, priv->domNameCache[i]);
+
+    return ret;
+}
+
 /* Main Function which should be used for connecting.
  * This function properly handles keepalive settings. */
 virConnectPtr
@@ -221,6 +305,11 @@ virshReconnect(vshControl *ctl, const char *name, bool readonly, bool force)
         int ret;
         connected = true;
 
+        if (priv->domEventId >= 0) {
+            virConnectDomainEventDeregisterAny(priv->conn, priv->domEventId);
+            priv->domEventId = -1;
+        }
+        virshDomainNameCacheReset(ctl);
         virConnectUnregisterCloseCallback(priv->conn, virshCatchDisconnect);
         ret = virConnectClose(priv->conn);
         if (ret < 0)
@@ -247,6 +336,15 @@ virshReconnect(vshControl *ctl, const char *name, bool readonly, bool force)
         if (virConnectRegisterCloseCallback(priv->conn, virshCatchDisconnect,
                                             ctl, NULL) < 0)
             vshError(ctl, "%s", _("Unable to register disconnect callback"));
+        /* Lifecycle events keep the completion name cache fresh; if the
+         * driver doesn't support them the cache degrades to per-request */
+        priv->domEventId =
+            virConnectDomainEventRegisterAny(priv->conn, NULL,
+                                             VIR_DOMAIN_EVENT_ID_LIFECYCLE,
+                                             VIR_DOMAIN_EVENT_CALLBACK(virshDomainNameCacheEvent),
+                                             ctl, NULL);
+        if (priv->domEventId < 0)
+            vshResetLibvirtError();
         if (connected && !force)
             vshError(ctl, "%s", _("Reconnected to the hypervisor"));
     }
@@ -444,6 +542,10 @@ virshDeinit(vshControl *ctl)
     VIR_FREE(ctl->connname);
     if (priv->conn) {
         int ret;
+        if (priv->domEventId >= 0) {
+            virConnectDomainEventDeregisterAny(priv->conn, priv->domEventId);
+            priv->domEventId = -1;
+        }
         virConnectUnregisterCloseCallback(priv->conn, virshCatchDisconnect);
         ret = virConnectClose(priv->conn);
         if (ret < 0)
@@ -452,6 +554,7 @@ virshDeinit(vshControl *ctl)
             vshError(ctl, "%s", _("One or more references were leaked after "
                                   "disconnect from the hypervisor"));
     }
+    virshDomainNameCacheReset(ctl);
     virResetLastError();
 
     if (ctl->eventLoopStarted) {
@@ -491,6 +594,8 @@ virshUsage(void)
     fprintf(stdout, _("\n%s [options]... [<command_string>]"
                       "\n%s [options]... <command> [args...]\n\n"
                       "  options:\n"
+                      "    -b | --batch            read commands from stdin, one per line,\n"
+                      "                            and print a delimiter after each result\n"
                       "    -c | --connect=URI      hypervisor connection URI\n"
                       "    -d | --debug=NUM        debug level [0-4]\n"
                       "    -e | --escape <char>    set escape sequence for console\n"
@@ -703,6 +808,7 @@ virshParseArgv(vshControl *ctl, int argc, char **argv)
     int longindex = -1;
     virshControlPtr priv = ctl->privData;
     struct option opt[] = {
+        {"batch", no_argument, NULL, 'b'},
         {"connect", required_argument, NULL, 'c'},
         {"debug", required_argument, NULL, 'd'},
         {"escape", required_argument, NULL, 'e'},
@@ -720,8 +826,11 @@ virshParseArgv(vshControl *ctl, int argc, char **argv)
     /* Standard (non-command) options. The leading + ensures that no
      * argument reordering takes place, so that command options are
      * not confused with top-level virsh options. */
-    while ((arg = getopt_long(argc, argv, "+:c:d:e:hk:K:l:qrtvV", opt, &longindex)) != -1) {
+    while ((arg = getopt_long(argc, argv, "+:bc:d:e:hk:K:l:qrtvV", opt, &longindex)) != -1) {
         switch (arg) {
+        case 'b':
+            ctl->batch = true;
+            break;
         case 'c':
             VIR_FREE(ctl->connname);
             ctl->connname = vshStrdup(ctl, optarg);
@@ -837,6 +946,13 @@ virshParseArgv(vshControl *ctl, int argc, char **argv)
     if (argc == optind) {
         ctl->imode = true;
     } else {
+        if (ctl->batch) {
+            vshError(ctl, "%s",
+                     _("Option --batch doesn't accept commands as arguments, "
+                       "they are read from stdin"));
+            exit(EXIT_FAILURE);
+        }
+
         /* parse command */
         ctl->imode = false;
         if (argc - optind == 1) {
@@ -909,6 +1025,7 @@ main(int argc, char **argv)
     ctl->eventPipe[1] = -1;
     ctl->eventTimerId = -1;
     virshCtl.escapeChar = "^]";     /* Same default as telnet */
+    virshCtl.domEventId = -1;       /* No lifecycle events registered yet */
     ctl->privData = &virshCtl;
 
     if (!(progname = strrchr(argv[0], '/')))
@@ -956,6 +1073,8 @@ main(int argc, char **argv)
 
     if (!ctl->imode) {
         ret = vshCommandRun(ctl, ctl->cmd);
+    } else if (ctl->batch) {
+        ret = vshCommandStreamRun(ctl);
     } else {
         /* interactive mode */
         if (!ctl->quiet) {
@@ -74,6 +74,7 @@
     {.name = "domain",                                            \
      .type = VSH_OT_DATA,                                         \
      .flags = VSH_OFLAG_REQ,                                      \
+     .completer = virshDomainNameCompleter,                       \
      .help = _helpstr                                             \
     }                                                             \
 
@@ -123,6 +124,12 @@ struct _virshControl {
                                    are missing */
     const char *escapeChar;     /* String representation of
                                    console escape character */
+    char **domNameCache;        /* cached domain names for completion,
+                                   NULL-terminated (MAY BE NULL) */
+    bool domNameCacheValid;     /* false if domNameCache must be refetched */
+    int domEventId;             /* lifecycle event callback id used to
+                                   invalidate domNameCache, -1 if the
+                                   connection doesn't support events */
 };
 
 /* Typedefs, function prototypes for job progress reporting.
@@ -146,6 +153,7 @@ typedef enum {
 
 virConnectPtr virshConnect(vshControl *ctl, const char *uri, bool readonly);
 int virshDomainState(vshControl *ctl, virDomainPtr dom, int *reason);
+char **virshDomainNameCompleter(void *opaque, unsigned int flags);
 
 int virshStreamSink(virStreamPtr st, const char *bytes, size_t nbytes,
                     void *opaque);
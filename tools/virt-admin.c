@@ -469,6 +469,66 @@ cmdSrvThreadpoolInfo(vshControl *ctl, const vshCmd *cmd)
     return ret;
 }
 
+/* -----------------------
+ * Command srv-proc-stats
+ * -----------------------
+ */
+
+static const vshCmdInfo info_srv_proc_stats[] = {
+    {.name = "help",
+     .data = N_("get server per-procedure dispatch statistics")
+    },
+    {.name = "desc",
+     .data = N_("Retrieve per-procedure call counters, latencies and "
+                "byte counts from a server.")
+    },
+    {.name = NULL}
+};
+
+static const vshCmdOptDef opts_srv_proc_stats[] = {
+    {.name = "server",
+     .type = VSH_OT_DATA,
+     .flags = VSH_OFLAG_REQ,
+     .help = N_("Server to retrieve procedure statistics from."),
+    },
+    {.name = NULL}
+};
+
+static bool
+cmdSrvProcStats(vshControl *ctl, const vshCmd *cmd)
+{
+    bool ret = false;
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+    size_t i;
+    const char *srvname = NULL;
+    virAdmServerPtr srv = NULL;
+    vshAdmControlPtr priv = ctl->privData;
+
+    if (vshCommandOptStringReq(ctl, cmd, "server", &srvname) < 0)
+        return false;
+
+    if (!(srv = virAdmConnectLookupServer(priv->conn, srvname, 0)))
+        goto cleanup;
+
+    if (virAdmServerGetProcStats(srv, &params, &nparams, 0) < 0) {
+        vshError(ctl, "%s",
+                 _("Unable to get server procedure statistics"));
+        goto cleanup;
+    }
+
+    for (i = 0; i < nparams; i++)
+        vshPrint(ctl, "%-40s: %llu\n", params[i].field, params[i].value.ul);
+
+    ret = true;
+
+ cleanup:
+    virTypedParamsFree(params, nparams);
+    if (srv)
+        virAdmServerFree(srv);
+    return ret;
+}
+
 /* --------------------------
  * Command srv-threadpool-set
  * --------------------------
@@ -1393,6 +1453,16 @@ static const vshCmdDef monitoringCmds[] = {
      .info = info_srv_threadpool_info,
      .flags = 0
     },
+    {.name = "srv-proc-stats",
+     .flags = VSH_CMD_FLAG_ALIAS,
+     .alias = "server-proc-stats"
+    },
+    {.name = "server-proc-stats",
+     .handler = cmdSrvProcStats,
+     .opts = opts_srv_proc_stats,
+     .info = info_srv_proc_stats,
+     .flags = 0
+    },
     {.name = "srv-clients-list",
      .flags = VSH_CMD_FLAG_ALIAS,
      .alias = "client-list"
@@ -1348,6 +1348,55 @@ vshCommandRun(vshControl *ctl, const vshCmd *cmd)
     return ret;
 }
 
+/*
+ * Reads a stream of commands from stdin, one command (or semicolon
+ * separated command list) per line, and executes them over the single
+ * already established connection. After each line a delimiter line with
+ * the line's sequence number and outcome is emitted, so that a caller
+ * multiplexing many commands through one process can split the combined
+ * output again. Empty lines and lines starting with '#' are ignored and
+ * a failed command doesn't terminate the stream.
+ *
+ * Returns true if all executed commands succeeded.
+ */
+bool
+vshCommandStreamRun(vshControl *ctl)
+{
+    bool ret = true;
+    char *line = NULL;
+    size_t line_size = 0;
+    ssize_t len;
+    size_t lineno = 0;
+
+    while (ctl->imode && (len = getline(&line, &line_size, stdin)) > 0) {
+        const char *str = line;
+        bool ok;
+
+        ++lineno;
+
+        if (line[len - 1] == '\n')
+            line[len - 1] = '\0';
+
+        virSkipSpaces(&str);
+
+        if (*str == '\0' || *str == '#')
+            continue;
+
+        ok = vshCommandStringParse(ctl, (char *)str) &&
+             vshCommandRun(ctl, ctl->cmd);
+
+        vshPrint(ctl, "### %zu %s\n", lineno, ok ? "OK" : "ERROR");
+        fflush(stdout);
+
+        if (!ok)
+            ret = false;
+    }
+
+    VIR_FREE(line);
+
+    return ret;
+}
+
 /* ---------------
  * Command parsing
  * ---------------
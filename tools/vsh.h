@@ -204,6 +204,7 @@ struct _vshControl {
     vshCmd *cmd;                /* the current command */
     char *cmdstr;               /* string with command */
     bool imode;                 /* interactive mode? */
+    bool batch;                 /* read command stream from stdin? */
     bool quiet;                 /* quiet mode */
     bool timing;                /* print timing info? */
     int debug;                  /* print debug messages? */
@@ -299,6 +300,7 @@ int vshBlockJobOptionBandwidth(vshControl *ctl,
                                unsigned long *bandwidth);
 bool vshCommandOptBool(const vshCmd *cmd, const char *name);
 bool vshCommandRun(vshControl *ctl, const vshCmd *cmd);
+bool vshCommandStreamRun(vshControl *ctl);
 bool vshCommandStringParse(vshControl *ctl, char *cmdstr);
 
 const vshCmdOpt *vshCommandOptArgv(vshControl *ctl, const vshCmd *cmd,